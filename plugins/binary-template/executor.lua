@@ -36,6 +36,10 @@ local FLOWCTRL_TYPE_RETURN   = 1
 local FLOWCTRL_TYPE_BREAK    = 2
 local FLOWCTRL_TYPE_CONTINUE = 4
 
+-- Arrays of structs with fewer elements than this are commented element by element even if the
+-- interface supports set_comment_array().
+local ARRAY_COMMENT_MIN_ELEMENTS = 16
+
 local _find_type;
 local _builtin_types
 
@@ -2762,6 +2766,21 @@ end
 --
 -- Periodically called by the executor to allow processing UI events.
 -- An error() may be raised within to abort the interpreter.
+--
+-- The interface table may also have the following functions:
+--
+-- interface.read_numbers(offset, type_name, count)
+--
+-- Reads an array of numbers of the named type (e.g. "u32le") and returns them
+-- in a table, with fewer than count values at the end of the file. Used to
+-- decode elements of arrays in bulk rather than calling read_data() for each.
+--
+-- interface.set_comment_array(offset, length, comment_text, element_length, fields)
+--
+-- Sets a single comment over an array of structs whose elements are all laid
+-- out identically, rather than commenting every element and every member of
+-- each one. fields is a table of { offset, length, comment_text } tables with
+-- offsets relative to the start of each element.
 
 local function execute(interface, statements)
 	statements = util.deep_copy_table(statements)
@@ -2814,10 +2833,141 @@ local function execute(interface, statements)
 	
 	_exec_statements(context, statements)
 	
-	local process_variable = function(process_variable, name, type_info, value)
+	-- Comments are passed through emit_comment so the comments under an element of an array can
+	-- be captured and compared against the other elements.
+	local emit_comment = context.interface.set_comment
+	local capturing = false
+	
+	local process_variable
+	
+	-- Process an element of a struct array, returning the comments under it (relative to the
+	-- start of the element) rather than setting them.
+	local capture_element = function(element)
+		local data_start, data_end = element:data_range()
+		local fields = {}
+		
+		local outer_emit_comment, outer_capturing = emit_comment, capturing
+		
+		emit_comment = function(offset, length, text)
+			table.insert(fields, { offset - (data_start or 0), length, text })
+		end
+		
+		capturing = true
+		
+		for k,m in _sorted_pairs(element)
+		do
+			process_variable(process_variable, k, m[1], m[2])
+		end
+		
+		emit_comment, capturing = outer_emit_comment, outer_capturing
+		
+		return data_start, data_end, fields
+	end
+	
+	local fields_match = function(a, b)
+		if #a ~= #b
+		then
+			return false
+		end
+		
+		for i = 1, #a
+		do
+			if a[i][1] ~= b[i][1] or a[i][2] ~= b[i][2] or a[i][3] ~= b[i][3]
+			then
+				return false
+			end
+		end
+		
+		return true
+	end
+	
+	local fields_fit = function(fields, element_length)
+		for _, field in ipairs(fields)
+		do
+			if field[1] < 0 or (field[1] + field[2]) > element_length
+			then
+				return false
+			end
+		end
+		
+		return true
+	end
+	
+	local emit_element = function(name, index, data_start, data_end, fields)
+		for _, field in ipairs(fields)
+		do
+			emit_comment(data_start + field[1], field[2], field[3])
+		end
+		
+		emit_comment(data_start, (data_end - data_start), name .. "[" .. (index - 1) .. "]")
+	end
+	
+	process_variable = function(process_variable, name, type_info, value)
 		interface.yield("Cataloguing variables...")
 		
 		if type_info.is_array and type_info.base == "struct"
+		and context.interface.set_comment_array ~= nil and not capturing and #value >= ARRAY_COMMENT_MIN_ELEMENTS
+		then
+			-- Comment the array using a single comment if every element is contiguous and has
+			-- the same comments at the same relative offsets, falling back to commenting each
+			-- element from the first one which differs.
+			
+			local array_start, element_length, layout
+			local compressed = true
+			local next_start
+			
+			for i = 1, #value
+			do
+				if compressed
+				then
+					local data_start, data_end, fields = capture_element(value[i])
+					
+					if i == 1 and data_start ~= nil and data_end > data_start and fields_fit(fields, (data_end - data_start))
+					then
+						array_start = data_start
+						element_length = data_end - data_start
+						layout = fields
+					elseif i == 1 or data_start ~= next_start or (data_end - data_start) ~= element_length or not fields_match(fields, layout)
+					then
+						compressed = false
+						
+						for j = 1, i - 1
+						do
+							local j_start = array_start + ((j - 1) * element_length)
+							emit_element(name, j, j_start, (j_start + element_length), layout)
+						end
+						
+						if data_start ~= nil
+						then
+							emit_element(name, i, data_start, data_end, fields)
+						else
+							for _, field in ipairs(fields)
+							do
+								emit_comment(field[1], field[2], field[3])
+							end
+						end
+					end
+					
+					next_start = data_end
+				else
+					for k,m in _sorted_pairs(value[i])
+					do
+						process_variable(process_variable, k, m[1], m[2])
+					end
+					
+					local data_start, data_end = value[i]:data_range()
+					if data_start ~= nil
+					then
+						emit_comment(data_start, (data_end - data_start), name .. "[" .. (i - 1) .. "]")
+					end
+				end
+			end
+			
+			if compressed
+			then
+				context.interface.set_comment_array(array_start, (element_length * #value), name, element_length, layout)
+			end
+		elseif type_info.is_array and type_info.base == "struct"
 		then
 			local elem_type = util.make_nonarray_type(type_info)
 			
@@ -2831,7 +2981,7 @@ local function execute(interface, statements)
 				local data_start, data_end = value[i]:data_range()
 				if data_start ~= nil
 				then
-					context.interface.set_comment(data_start, (data_end - data_start), name .. "[" .. (i - 1) .. "]")
+					emit_comment(data_start, (data_end - data_start), name .. "[" .. (i - 1) .. "]")
 				end
 			end
 		else
@@ -2867,7 +3017,7 @@ local function execute(interface, statements)
 			local data_start, data_end = value:data_range()
 			if data_start ~= nil
 			then
-				context.interface.set_comment(data_start, (data_end - data_start), name)
+				emit_comment(data_start, (data_end - data_start), name)
 			end
 		end
 		
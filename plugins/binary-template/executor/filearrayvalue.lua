@@ -25,10 +25,33 @@ local FileValue  = require 'executor.filevalue'
 --
 -- Once constructed this can be accessed using the Lua [] and # operators like
 -- an ordinary ArrayValue.
+--
+-- Elements are decoded in chunks when first accessed, using the bulk
+-- interface.read_numbers() function where the interface provides it, so
+-- looping over a large array doesn't read from the document once per element.
 
 local FileArrayValue = {}
 FileArrayValue.__index = ArrayValue
 
+-- Number of elements decoded at once.
+local DECODE_CHUNK = 1024
+
+-- Names of the number types accepted by interface.read_numbers() for each
+-- string.unpack() format used for array elements.
+local NUMBER_TYPES = {}
+
+for fmt, name in pairs({ i1 = "s8", I1 = "u8", i2 = "s16", I2 = "u16", i4 = "s32", I4 = "u32", i8 = "s64", I8 = "u64", f = "f32", d = "f64" })
+do
+	if name:len() == 2
+	then
+		NUMBER_TYPES["<" .. fmt] = name
+		NUMBER_TYPES[">" .. fmt] = name
+	else
+		NUMBER_TYPES["<" .. fmt] = name .. "le"
+		NUMBER_TYPES[">" .. fmt] = name .. "be"
+	end
+end
+
 --- Construct a new FileArrayValue object.
 --
 -- @param context      Reference to executor internal context table
@@ -51,7 +74,12 @@ function FileArrayValue:new(context, offset, n_elements, elem_length, fmt)
 			then
 				if k >= 1 and k <= self.n_elements
 				then
-					return FileValue:new(context, (self.offset + ((k - 1) * self.elem_length)), self.elem_length, self.fmt)
+					if self.decoded == nil or k < self.decoded_base or k >= (self.decoded_base + DECODE_CHUNK)
+					then
+						self:_decode_chunk(context, k)
+					end
+					
+					return FileValue:new(context, (self.offset + ((k - 1) * self.elem_length)), self.elem_length, self.fmt, self.decoded[k - self.decoded_base + 1])
 				end
 			else
 				return FileArrayValue[k]
@@ -72,6 +100,39 @@ end
 --
 function FileArrayValue:resize(n_elements)
 	self.n_elements = n_elements
+	self.decoded = nil
+end
+
+--- Decode the chunk of elements containing the given index.
+--
+-- Elements which couldn't be read (past the end of the file) are left as nil
+-- and read again (and fail) when accessed.
+--
+function FileArrayValue:_decode_chunk(context, k)
+	local base = k - ((k - 1) % DECODE_CHUNK)
+	local count = math.min(DECODE_CHUNK, (self.n_elements - base + 1))
+	local offset = self.offset + ((base - 1) * self.elem_length)
+	
+	local type_name = NUMBER_TYPES[self.fmt]
+	local values
+	
+	if type_name ~= nil and context.interface.read_numbers ~= nil
+	then
+		values = context.interface.read_numbers(offset, type_name, count)
+	else
+		values = {}
+		
+		local data = context.interface.read_data(offset, (count * self.elem_length))
+		local pos = 1
+		
+		for i = 1, math.min(count, data:len() // self.elem_length)
+		do
+			values[i], pos = string.unpack(self.fmt, data, pos)
+		end
+	end
+	
+	self.decoded = values
+	self.decoded_base = base
 end
 
 function FileArrayValue:data_range()
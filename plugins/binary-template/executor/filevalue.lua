@@ -25,14 +25,17 @@ FileValue.__index = FileValue
 -- @param offset  Offset to the value within the document
 -- @param length  Length of the value within the document
 -- @param fmt     Format token for string.unpack() to read the raw value
+-- @param value   Value already read from the document (optional)
 --
-function FileValue:new(context, offset, length, fmt)
+function FileValue:new(context, offset, length, fmt, value)
 	local self = {
 		context = context,
 		
 		offset = offset,
 		length = length,
 		fmt = fmt,
+		
+		value = value,
 	}
 	
 	setmetatable(self, FileValue)
@@ -40,13 +43,21 @@ function FileValue:new(context, offset, length, fmt)
 end
 
 function FileValue:get()
-	local data = self.context.interface.read_data(self.offset, self.length)
-	if data:len() < self.length
+	-- The document can't change while a template is running, so the value only needs to be
+	-- read once.
+	
+	if self.value == nil
 	then
-		return nil
+		local data = self.context.interface.read_data(self.offset, self.length)
+		if data:len() < self.length
+		then
+			return nil
+		end
+		
+		self.value = string.unpack(self.fmt, data)
 	end
 	
-	return string.unpack(self.fmt, data)
+	return self.value
 end
 
 function FileValue:set(value)
@@ -54,7 +65,7 @@ function FileValue:set(value)
 end
 
 function FileValue:copy()
-	return FileValue:new(self.context, self.offset, self.length, self.fmt)
+	return FileValue:new(self.context, self.offset, self.length, self.fmt, self.value)
 end
 
 function FileValue:data_range()
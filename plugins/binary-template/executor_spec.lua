@@ -619,6 +619,51 @@ describe("executor", function()
 		assert.are.same(expect_log, log)
 	end)
 	
+	it("reads array values in bulk using read_numbers", function()
+		local interface, log = test_interface(string.char(
+			0x00, 0x01,
+			0x00, 0x02,
+			0xFF, 0xFE
+		))
+		
+		interface.read_numbers = function(offset, type_name, count)
+			table.insert(log, "read_numbers(" .. offset .. ", " .. type_name .. ", " .. count .. ")")
+			
+			local values = {}
+			for i = 1, count
+			do
+				values[i] = string.unpack(">I2", interface._data, offset + ((i - 1) * 2) + 1)
+			end
+			
+			return values
+		end
+		
+		executor.execute(interface, {
+			{ "test.bt", 1, "call", "BigEndian", {} },
+			
+			{ "test.bt", 1, "variable", "uint16_t", "a", nil, { "test.bt", 1, "num", 3 } },
+			
+			{ "test.bt", 1, "call", "Printf", {
+				{ "test.bt", 1, "str", "a[2] = %d" },
+				{ "test.bt", 1, "ref", { "a", { "test.bt", 1, "num", 2 } } } } },
+			
+			{ "test.bt", 1, "call", "Printf", {
+				{ "test.bt", 1, "str", "a[0] = %d" },
+				{ "test.bt", 1, "ref", { "a", { "test.bt", 1, "num", 0 } } } } },
+		})
+		
+		local expect_log = {
+			"read_numbers(0, u16be, 3)",
+			"print(a[2] = 65534)",
+			"print(a[0] = 1)",
+			
+			"set_data_type(0, 6, u16be)",
+			"set_comment(0, 6, a)",
+		}
+		
+		assert.are.same(expect_log, log)
+	end)
+	
 	it("errors on invalid array index operands", function()
 		local interface, log = test_interface(string.char(
 			0x01, 0x00, 0x00, 0x00,
@@ -782,6 +827,103 @@ describe("executor", function()
 		assert.are.same(expect_log, log)
 	end)
 	
+	it("sets a single comment over struct arrays using set_comment_array", function()
+		local interface, log = test_interface(string.rep(string.char(0x01, 0x00, 0x00, 0x00), 32))
+		
+		interface.set_comment_array = function(offset, length, comment_text, element_length, fields)
+			local s = "set_comment_array(" .. offset .. ", " .. length .. ", " .. comment_text .. ", " .. element_length
+			
+			for _, field in ipairs(fields)
+			do
+				s = s .. ", {" .. field[1] .. ", " .. field[2] .. ", " .. field[3] .. "}"
+			end
+			
+			table.insert(log, s .. ")")
+		end
+		
+		executor.execute(interface, {
+			{ "test.bt", 1, "call", "LittleEndian", {} },
+			
+			{ "test.bt", 1, "struct", "mystruct", {},
+			{
+				{ "test.bt", 1, "variable", "int", "x", nil, nil },
+				{ "test.bt", 1, "variable", "int", "y", nil, nil },
+			} },
+			
+			{ "test.bt", 1, "variable", "struct mystruct", "a", nil, { "test.bt", 1, "num", 16 } },
+		})
+		
+		local expect_log = {}
+		
+		for i = 0, 15
+		do
+			table.insert(expect_log, "set_data_type(" .. (i * 8) .. ", 4, s32le)")
+			table.insert(expect_log, "set_data_type(" .. (i * 8 + 4) .. ", 4, s32le)")
+		end
+		
+		table.insert(expect_log, "set_comment_array(0, 128, a, 8, {0, 4, x}, {4, 4, y})")
+		
+		assert.are.same(expect_log, log)
+	end)
+	
+	it("comments each element of struct arrays whose elements differ", function()
+		-- Elements are { int x; if(x == 99) { int y; } }, the sixth element has a y.
+		
+		local data = string.rep(string.char(0x00, 0x00, 0x00, 0x00), 5)
+			.. string.char(0x63, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00)
+			.. string.rep(string.char(0x00, 0x00, 0x00, 0x00), 14)
+		
+		local interface, log = test_interface(data)
+		
+		interface.set_comment_array = function(offset, length, comment_text, element_length, fields)
+			table.insert(log, "set_comment_array(" .. offset .. ", " .. length .. ", " .. comment_text .. ")")
+		end
+		
+		executor.execute(interface, {
+			{ "test.bt", 1, "call", "LittleEndian", {} },
+			
+			{ "test.bt", 1, "struct", "mystruct", {},
+			{
+				{ "test.bt", 1, "variable", "int", "x", nil, nil },
+				
+				{ "test.bt", 1, "if",
+					{ { "test.bt", 1, "equal", { "test.bt", 1, "ref", { "x" } }, { "test.bt", 1, "num", 99 } }, {
+						{ "test.bt", 1, "variable", "int", "y", nil, nil },
+					} } },
+			} },
+			
+			{ "test.bt", 1, "variable", "struct mystruct", "a", nil, { "test.bt", 1, "num", 20 } },
+		})
+		
+		local expect_log = {}
+		
+		for i = 0, 5
+		do
+			table.insert(expect_log, "set_data_type(" .. (i * 4) .. ", 4, s32le)")
+		end
+		
+		table.insert(expect_log, "set_data_type(24, 4, s32le)")
+		
+		for i = 0, 4
+		do
+			table.insert(expect_log, "set_comment(" .. (i * 4) .. ", 4, x)")
+			table.insert(expect_log, "set_comment(" .. (i * 4) .. ", 4, a[" .. i .. "])")
+		end
+		
+		table.insert(expect_log, "set_comment(20, 4, x)")
+		table.insert(expect_log, "set_comment(24, 4, y)")
+		table.insert(expect_log, "set_comment(20, 8, a[5])")
+		
+		for i = 6, 19
+		do
+			table.insert(expect_log, "set_data_type(" .. (i * 4 + 4) .. ", 4, s32le)")
+			table.insert(expect_log, "set_comment(" .. (i * 4 + 4) .. ", 4, x)")
+			table.insert(expect_log, "set_comment(" .. (i * 4 + 4) .. ", 4, a[" .. i .. "])")
+		end
+		
+		assert.are.same(expect_log, log)
+	end)
+	
 	it("handles nested structs", function()
 		local interface, log = test_interface(string.char(
 			0x01, 0x00, 0x00, 0x00,
@@ -16,9 +16,8 @@
 
 require 'stable_sort';
 
-local preprocessor = require 'preprocessor';
-local parser = require 'parser';
 local executor = require 'executor';
+local template_cache = require 'template_cache';
 
 local function _find_templates(path)
 	local templates = {}
@@ -57,6 +56,33 @@ local function _find_templates(path)
 	return templates
 end
 
+-- Returns the directory to cache compiled templates in, or nil if it can't be created.
+local function _get_cache_dir()
+	local base
+	
+	if package.config:sub(1, 1) == "\\"
+	then
+		base = wx.wxStandardPaths.Get():GetUserLocalDataDir()
+	elseif os.getenv("XDG_CACHE_HOME") ~= nil and os.getenv("XDG_CACHE_HOME") ~= ""
+	then
+		base = os.getenv("XDG_CACHE_HOME") .. "/rehex"
+	elseif os.getenv("HOME") ~= nil and os.getenv("HOME") ~= ""
+	then
+		base = os.getenv("HOME") .. "/.cache/rehex"
+	else
+		return nil
+	end
+	
+	local cache_dir = base .. "/binary-template"
+	
+	if not wx.wxFileName.DirExists(cache_dir) and not wx.wxFileName.Mkdir(cache_dir, 511, wx.wxPATH_MKDIR_FULL)
+	then
+		return nil
+	end
+	
+	return cache_dir
+end
+
 local ID_BROWSE = 1
 local ID_RANGE_FILE = 2
 local ID_RANGE_SEL = 3
@@ -187,6 +213,11 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 		local yield_counter = 0
 		local data_types = {}
 		local comments = {}
+		local comment_arrays = {}
+		
+		-- Templates mostly read small values in order, so read through a DocumentReader rather
+		-- than asking the document for each one.
+		local reader = rehex.DocumentReader(doc, selection_off)
 		
 		local interface = {
 			set_data_type = function(offset, length, data_type)
@@ -197,6 +228,10 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 				table.insert(comments, { (selection_off:byte() + offset), selection_off:bit(), length, 0, text })
 			end,
 			
+			set_comment_array = function(offset, length, text, element_length, fields)
+				table.insert(comment_arrays, { offset, length, text, element_length, fields })
+			end,
+			
 			allocate_highlight_colour = function(label, primary_colour, secondary_colour)
 				return doc:allocate_highlight_colour(label, primary_colour, secondary_colour)
 			end,
@@ -206,7 +241,13 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 			end,
 			
 			read_data = function(offset, length)
-				return doc:read_data(selection_off + rehex.BitOffset(offset, 0), length)
+				reader:seek(selection_off + rehex.BitOffset(offset, 0))
+				return reader:read(length)
+			end,
+			
+			read_numbers = function(offset, type_name, count)
+				reader:seek(selection_off + rehex.BitOffset(offset, 0))
+				return reader:read_numbers(type_name, count)
 			end,
 			
 			file_length = function()
@@ -282,7 +323,8 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 		local start_time = os.time()
 		
 		local ok, err = pcall(function()
-			executor.execute(interface, parser.parse_text(preprocessor.preprocess_file(template_path)))
+			local print_warning = function(s) rehex.print_info(s .. "\n") end
+			executor.execute(interface, template_cache.load_template(template_path, _get_cache_dir(), print_warning))
 			
 			progress_dialog:Pulse("Setting data types...")
 			
@@ -319,6 +361,20 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 			wx.wxGetApp():ProcessPendingEvents()
 			
 			doc:set_comment_bulk(comments)
+			
+			for _, array in ipairs(comment_arrays)
+			do
+				local fields = {}
+				
+				for _, field in ipairs(array[5])
+				do
+					table.insert(fields, { field[1], 0, field[2], 0, field[3] })
+				end
+				
+				doc:set_comment_array(
+					(selection_off + rehex.BitOffset(array[1], 0)), rehex.BitOffset(array[2], 0), array[3],
+					rehex.BitOffset(array[4], 0), fields)
+			end
 		end)
 		
 		local end_time = os.time()
@@ -75,6 +75,12 @@ local function _preprocess_file(filename, context)
 		error("Unable to open " .. filename .. ": " .. err)
 	end
 	
+	if context.files ~= nil
+	then
+		table.insert(context.files, { filename, file:read("*a") })
+		file:seek("set", 0)
+	end
+	
 	local line_num = 0
 	local in_comment = false
 	local defining_macro_name = nil
@@ -293,13 +299,19 @@ local function _preprocess_file(filename, context)
 	return output;
 end
 
-M.preprocess_file = function(filename, print_func)
+-- Preprocess a template file and return the resulting text.
+--
+-- If the files table is provided, a { filename, content } pair is appended to it for each file
+-- read (the main file and anything it includes), so the caller can tell when the output would
+-- change.
+M.preprocess_file = function(filename, print_func, files)
 	local context = {}
 	
 	context.if_stack = {}
 	context.no_depth = 0
 	context.macros = {}
 	context.print_func = print_func
+	context.files = files
 	
 	local result = _preprocess_file(filename, context)
 	
@@ -0,0 +1,461 @@
+-- Binary Template plugin for REHex
+-- Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License version 2 as published by
+-- the Free Software Foundation.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+-- more details.
+--
+-- You should have received a copy of the GNU General Public License along with
+-- this program; if not, write to the Free Software Foundation, Inc., 51
+-- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+-- Cache of compiled templates.
+--
+-- Preprocessing and parsing a template usually takes far longer than executing it against a small
+-- file, so the AST produced for each template is kept in memory and written to a cache directory
+-- as a Lua chunk. Later loads of the same template reuse the AST as long as none of the files it
+-- was built from (the template and anything it includes) have changed.
+--
+-- Cache entries are keyed by the path and content of the template, plus the source of the modules
+-- which produce the AST, so upgrading the plugin doesn't reuse entries from an older parser.
+--
+-- Only the most recently used templates are kept in memory. The cache directory also holds an
+-- index of its entries in the order they were last used, which is used to delete entries that
+-- haven't been used for a while (including any left behind by an older parser).
+
+local preprocessor = require 'preprocessor'
+local parser = require 'parser'
+
+local M = {}
+
+-- Bump whenever the layout of the cache files changes.
+local _FORMAT_VERSION = 1
+
+-- Maximum number of templates to keep in memory.
+M.MEMORY_CACHE_SIZE = 16
+
+-- Maximum number of entries to keep in the cache directory, and how long (in seconds) to keep an
+-- entry which isn't used.
+M.DIR_CACHE_SIZE = 256
+M.DIR_CACHE_MAX_AGE = 30 * 24 * 60 * 60
+
+local _INDEX_NAME = "index.lua"
+
+local _memory_cache = {}
+local _memory_cache_order = {} -- Keys in _memory_cache, least recently used first.
+
+local _implementation_hash = nil
+
+local function _hash(s)
+	-- 64-bit FNV-1a, relies on integer arithmetic wrapping around.
+	
+	local h = 0xcbf29ce484222325
+	
+	for i = 1, #s, 256
+	do
+		local bytes = { s:byte(i, i + 255) }
+		
+		for j = 1, #bytes
+		do
+			h = (h ~ bytes[j]) * 0x100000001b3
+		end
+	end
+	
+	return string.format("%016x%x", h, #s)
+end
+
+-- Reads files in text mode, the same as the preprocessor does.
+local function _read_file(filename)
+	local file = io.open(filename, "r")
+	if not file
+	then
+		return nil
+	end
+	
+	local content = file:read("*a")
+	file:close()
+	
+	return content
+end
+
+local function _get_implementation_hash()
+	if _implementation_hash == nil
+	then
+		local sources = { tostring(_FORMAT_VERSION) }
+		
+		for _, module in ipairs({ "preprocessor", "parser", "template_cache" })
+		do
+			local path = package.searchpath(module, package.path)
+			table.insert(sources, (path and _read_file(path)) or "")
+		end
+		
+		_implementation_hash = _hash(table.concat(sources, "\0"))
+	end
+	
+	return _implementation_hash
+end
+
+-- Serialise a value as a Lua chunk which returns an equivalent value.
+--
+-- Each table is assigned to a slot in a flat array as it is written, rather than writing nested
+-- table constructors, so deeply nested ASTs don't run into the limit on syntax levels when the
+-- chunk is loaded, and tables referenced from more than one place are only written once.
+local function _serialise(root)
+	local out = { "local T = {}\n" }
+	local ids = {}
+	local next_id = 1
+	
+	local value_str
+	
+	local table_id = function(t)
+		local id = ids[t]
+		
+		if id == false
+		then
+			error("Cannot serialise a table which contains itself")
+		elseif id ~= nil
+		then
+			return id
+		end
+		
+		ids[t] = false
+		
+		local parts = {}
+		local n = #t
+		
+		for i = 1, n
+		do
+			parts[i] = value_str(t[i])
+		end
+		
+		for k, v in pairs(t)
+		do
+			if math.type(k) ~= "integer" or k < 1 or k > n
+			then
+				table.insert(parts, "[" .. value_str(k) .. "]=" .. value_str(v))
+			end
+		end
+		
+		id = next_id
+		next_id = next_id + 1
+		
+		ids[t] = id
+		table.insert(out, "T[" .. id .. "]={" .. table.concat(parts, ",") .. "}\n")
+		
+		return id
+	end
+	
+	value_str = function(v)
+		local t = type(v)
+		
+		if t == "string"
+		then
+			return string.format("%q", v)
+		elseif math.type(v) == "integer"
+		then
+			if v == math.mininteger
+			then
+				-- Can't be written in decimal without being read back as a float.
+				return "0x8000000000000000"
+			end
+			
+			return string.format("%d", v)
+		elseif t == "number"
+		then
+			if v ~= v
+			then
+				return "(0/0)"
+			elseif v == math.huge
+			then
+				return "(1/0)"
+			elseif v == -math.huge
+			then
+				return "(-1/0)"
+			end
+			
+			local s = string.format("%.17g", v)
+			
+			-- Make sure floats with integral values are read back as floats.
+			if not s:match("[.e]")
+			then
+				s = s .. ".0"
+			end
+			
+			return s
+		elseif t == "boolean" or t == "nil"
+		then
+			return tostring(v)
+		elseif t == "table"
+		then
+			return "T[" .. table_id(v) .. "]"
+		else
+			error("Cannot serialise a " .. t .. " value")
+		end
+	end
+	
+	local root_str = value_str(root)
+	table.insert(out, "return " .. root_str .. "\n")
+	
+	return table.concat(out)
+end
+
+-- Check that all the files a cache entry was built from still have the same content.
+local function _entry_valid(entry)
+	if type(entry) ~= "table" or type(entry.files) ~= "table" or type(entry.warnings) ~= "table" or type(entry.ast) ~= "table"
+	then
+		return false
+	end
+	
+	for _, file in ipairs(entry.files)
+	do
+		local content = _read_file(file[1])
+		
+		if content == nil or _hash(content) ~= file[2]
+		then
+			return false
+		end
+	end
+	
+	return true
+end
+
+local function _load_entry(path)
+	local chunk = loadfile(path, "t", {})
+	if not chunk
+	then
+		return nil
+	end
+	
+	local ok, entry = pcall(chunk)
+	if not ok
+	then
+		return nil
+	end
+	
+	return entry
+end
+
+local function _save_entry(path, entry)
+	local ok, data = pcall(_serialise, entry)
+	if not ok
+	then
+		return
+	end
+	
+	-- Write to a temporary file first so a concurrent load never sees a partial entry.
+	local tmp_path = path .. ".tmp"
+	
+	local file = io.open(tmp_path, "wb")
+	if not file
+	then
+		return
+	end
+	
+	local written = file:write(data)
+	file:close()
+	
+	if written
+	then
+		os.remove(path)
+		
+		if os.rename(tmp_path, path)
+		then
+			return
+		end
+	end
+	
+	os.remove(tmp_path)
+end
+
+local function _cache_key(filename, content)
+	return _hash(table.concat({ _get_implementation_hash(), filename, content }, "\0"))
+end
+
+local function _entry_path(cache_dir, key)
+	return cache_dir .. "/" .. key .. ".lua"
+end
+
+local function _memory_cache_get(key)
+	local entry = _memory_cache[key]
+	
+	if entry ~= nil
+	then
+		for i, k in ipairs(_memory_cache_order)
+		do
+			if k == key
+			then
+				table.remove(_memory_cache_order, i)
+				break
+			end
+		end
+		
+		table.insert(_memory_cache_order, key)
+	end
+	
+	return entry
+end
+
+local function _memory_cache_put(key, entry)
+	if _memory_cache[key] == nil
+	then
+		table.insert(_memory_cache_order, key)
+		
+		while #_memory_cache_order > M.MEMORY_CACHE_SIZE
+		do
+			_memory_cache[ table.remove(_memory_cache_order, 1) ] = nil
+		end
+	end
+	
+	_memory_cache[key] = entry
+end
+
+-- Mark the entry for key as the most recently used one in the cache directory's index, deleting
+-- any entries which are too old or don't fit in DIR_CACHE_SIZE.
+local function _touch_dir_entry(cache_dir, key)
+	local index_path = cache_dir .. "/" .. _INDEX_NAME
+	local now = os.time()
+	
+	-- Each entry in the index is a { key, last used time } pair, least recently used first.
+	local old_index = _load_entry(index_path)
+	
+	local index = {}
+	local seen = { [key] = true }
+	
+	if type(old_index) == "table"
+	then
+		for _, e in ipairs(old_index)
+		do
+			-- Skip anything that doesn't look like one of our entries, so nothing else in the
+			-- directory is ever deleted.
+			if type(e) == "table" and type(e[1]) == "string" and e[1]:match("^%x+$") and type(e[2]) == "number" and not seen[ e[1] ]
+			then
+				seen[ e[1] ] = true
+				
+				if (now - e[2]) > M.DIR_CACHE_MAX_AGE
+				then
+					os.remove(_entry_path(cache_dir, e[1]))
+				else
+					table.insert(index, e)
+				end
+			end
+		end
+	end
+	
+	table.insert(index, { key, now })
+	
+	while #index > M.DIR_CACHE_SIZE
+	do
+		local e = table.remove(index, 1)
+		os.remove(_entry_path(cache_dir, e[1]))
+	end
+	
+	_save_entry(index_path, index)
+end
+
+-- Get the name of the file in cache_dir which the template would be cached in, based on its
+-- current content.
+M.cache_filename = function(filename, cache_dir)
+	local content = _read_file(filename)
+	if content == nil
+	then
+		error("Unable to open " .. filename)
+	end
+	
+	return _entry_path(cache_dir, _cache_key(filename, content))
+end
+
+-- Load a template and return its AST, preprocessing and parsing it only if there is no valid
+-- cached copy.
+--
+-- cache_dir is the directory to store cache entries in, if nil the AST is only cached in memory.
+-- print_func is called with any #warning messages from the template, these are replayed when the
+-- template is loaded from the cache.
+--
+-- The returned AST may be shared with other callers and must not be modified.
+M.load_template = function(filename, cache_dir, print_func)
+	local content = _read_file(filename)
+	if content == nil
+	then
+		error("Unable to open " .. filename)
+	end
+	
+	local key = _cache_key(filename, content)
+	local cache_path = cache_dir ~= nil and _entry_path(cache_dir, key) or nil
+	
+	local entry = _memory_cache_get(key)
+	
+	if entry == nil and cache_path ~= nil
+	then
+		entry = _load_entry(cache_path)
+	end
+	
+	if entry ~= nil and _entry_valid(entry)
+	then
+		_memory_cache_put(key, entry)
+		
+		if cache_path ~= nil
+		then
+			_touch_dir_entry(cache_dir, key)
+		end
+		
+		if print_func ~= nil
+		then
+			for _, warning in ipairs(entry.warnings)
+			do
+				print_func(warning)
+			end
+		end
+		
+		return entry.ast
+	end
+	
+	local files = {}
+	local warnings = {}
+	
+	local text = preprocessor.preprocess_file(filename, function(s)
+		table.insert(warnings, s)
+		
+		if print_func ~= nil
+		then
+			print_func(s)
+		end
+	end, files)
+	
+	local ast = parser.parse_text(text)
+	
+	entry = {
+		files = {},
+		warnings = warnings,
+		ast = ast,
+	}
+	
+	for _, file in ipairs(files)
+	do
+		table.insert(entry.files, { file[1], _hash(file[2]) })
+	end
+	
+	_memory_cache_put(key, entry)
+	
+	if cache_path ~= nil
+	then
+		_save_entry(cache_path, entry)
+		_touch_dir_entry(cache_dir, key)
+	end
+	
+	return ast
+end
+
+-- Discard any templates cached in memory (the cache directory is left alone).
+M.clear_memory_cache = function()
+	_memory_cache = {}
+	_memory_cache_order = {}
+end
+
+M._serialise = _serialise
+
+return M
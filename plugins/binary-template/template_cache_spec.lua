@@ -0,0 +1,326 @@
+-- Binary Template plugin for REHex
+-- Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License version 2 as published by
+-- the Free Software Foundation.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+-- more details.
+--
+-- You should have received a copy of the GNU General Public License along with
+-- this program; if not, write to the Free Software Foundation, Inc., 51
+-- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+local parser = require 'parser'
+local preprocessor = require 'preprocessor'
+local template_cache = require 'template_cache'
+
+local function write_file(filename, content)
+	local file = assert(io.open(filename, "wb"))
+	file:write(content)
+	file:close()
+end
+
+-- Creates a template which includes a second file, both in the temporary directory.
+local function make_template(template_text, include_text)
+	local template = os.tmpname()
+	local include = os.tmpname()
+	
+	local include_name = include:match("[^\\/]+$")
+	
+	write_file(include, include_text)
+	write_file(template, "#include \"" .. include_name .. "\"\n" .. template_text)
+	
+	return template, include
+end
+
+-- Counts calls to parser.parse_text() made by fn.
+local function count_parses(fn)
+	local real_parse_text = parser.parse_text
+	local parses = 0
+	
+	parser.parse_text = function(text)
+		parses = parses + 1
+		return real_parse_text(text)
+	end
+	
+	local ok, err = pcall(fn)
+	parser.parse_text = real_parse_text
+	
+	if not ok
+	then
+		error(err, 0)
+	end
+	
+	return parses
+end
+
+describe("template_cache", function()
+	it("returns the same AST as preprocessing and parsing the template", function()
+		local template, include = make_template("local int y = x + 1.5;\n", "local int x = 10;\n")
+		
+		template_cache.clear_memory_cache()
+		local got = template_cache.load_template(template, nil, error)
+		
+		local expect = parser.parse_text(preprocessor.preprocess_file(template, error))
+		
+		os.remove(template)
+		os.remove(include)
+		
+		assert.are.same(expect, got)
+	end)
+	
+	it("only parses a template once", function()
+		local template, include = make_template("int y;\n", "local int x;\n")
+		
+		template_cache.clear_memory_cache()
+		
+		local first, second
+		local parses = count_parses(function()
+			first = template_cache.load_template(template, nil, error)
+			second = template_cache.load_template(template, nil, error)
+		end)
+		
+		os.remove(template)
+		os.remove(include)
+		
+		assert.are.same(1, parses)
+		assert.are.same(first, second)
+	end)
+	
+	it("parses a template again when an included file changes", function()
+		local template, include = make_template("int y;\n", "local int x;\n")
+		
+		template_cache.clear_memory_cache()
+		
+		local first, second
+		local parses = count_parses(function()
+			first = template_cache.load_template(template, nil, error)
+			
+			write_file(include, "local int z;\n")
+			second = template_cache.load_template(template, nil, error)
+		end)
+		
+		os.remove(template)
+		os.remove(include)
+		
+		assert.are.same(2, parses)
+		assert.are.same("x", first[1][5])
+		assert.are.same("z", second[1][5])
+	end)
+	
+	it("loads the AST from the cache directory", function()
+		local template, include = make_template("local int y = 1.0;\nlocal string s = \"a\\r\\nb\";\n", "local int x;\n")
+		local cache_dir = template:match("^(.*)[\\/]") or "."
+		local cache_file = template_cache.cache_filename(template, cache_dir)
+		
+		template_cache.clear_memory_cache()
+		
+		local first, second
+		local parses = count_parses(function()
+			first = template_cache.load_template(template, cache_dir, error)
+			
+			template_cache.clear_memory_cache()
+			second = template_cache.load_template(template, cache_dir, error)
+		end)
+		
+		local cache_file_exists = io.open(cache_file, "rb")
+		if cache_file_exists
+		then
+			cache_file_exists:close()
+		end
+		
+		os.remove(cache_file)
+		os.remove(cache_dir .. "/index.lua")
+		os.remove(template)
+		os.remove(include)
+		
+		assert.are.same(1, parses)
+		assert.are.same(first, second)
+		assert.truthy(cache_file_exists)
+	end)
+	
+	it("replays warnings when loading a cached template", function()
+		local template, include = make_template("#warning hello\nint y;\n", "local int x;\n")
+		
+		template_cache.clear_memory_cache()
+		
+		local warnings = {}
+		local print_func = function(s) table.insert(warnings, s) end
+		
+		template_cache.load_template(template, nil, print_func)
+		template_cache.load_template(template, nil, print_func)
+		
+		os.remove(template)
+		os.remove(include)
+		
+		assert.are.same(2, #warnings)
+		assert.are.same(warnings[1], warnings[2])
+	end)
+	
+	it("only keeps the most recently used templates in memory", function()
+		local a, a_include = make_template("int a;\n", "local int x;\n")
+		local b, b_include = make_template("int b;\n", "local int x;\n")
+		local c, c_include = make_template("int c;\n", "local int x;\n")
+		
+		template_cache.clear_memory_cache()
+		
+		local real_size = template_cache.MEMORY_CACHE_SIZE
+		template_cache.MEMORY_CACHE_SIZE = 2
+		
+		local ok, parses = pcall(count_parses, function()
+			template_cache.load_template(a, nil, error)
+			template_cache.load_template(b, nil, error)
+			template_cache.load_template(a, nil, error)
+			template_cache.load_template(c, nil, error) -- Evicts b
+			template_cache.load_template(a, nil, error)
+			template_cache.load_template(b, nil, error)
+		end)
+		
+		template_cache.MEMORY_CACHE_SIZE = real_size
+		template_cache.clear_memory_cache()
+		
+		for _, f in ipairs({ a, a_include, b, b_include, c, c_include })
+		do
+			os.remove(f)
+		end
+		
+		assert(ok, parses)
+		assert.are.same(4, parses)
+	end)
+	
+	it("deletes the least recently used entries from the cache directory", function()
+		local a, a_include = make_template("int a;\n", "local int x;\n")
+		local b, b_include = make_template("int b;\n", "local int x;\n")
+		local c, c_include = make_template("int c;\n", "local int x;\n")
+		
+		local cache_dir = a:match("^(.*)[\\/]") or "."
+		
+		local real_size = template_cache.DIR_CACHE_SIZE
+		template_cache.DIR_CACHE_SIZE = 2
+		
+		local ok, err = pcall(function()
+			template_cache.load_template(a, cache_dir, error)
+			template_cache.load_template(b, cache_dir, error)
+			template_cache.load_template(a, cache_dir, error)
+			template_cache.load_template(c, cache_dir, error) -- Evicts b
+		end)
+		
+		template_cache.DIR_CACHE_SIZE = real_size
+		template_cache.clear_memory_cache()
+		
+		local exists = {}
+		
+		for _, f in ipairs({ a, b, c })
+		do
+			local cache_file = template_cache.cache_filename(f, cache_dir)
+			
+			local file = io.open(cache_file, "rb")
+			if file
+			then
+				file:close()
+			end
+			
+			table.insert(exists, file ~= nil)
+			os.remove(cache_file)
+		end
+		
+		os.remove(cache_dir .. "/index.lua")
+		
+		for _, f in ipairs({ a, a_include, b, b_include, c, c_include })
+		do
+			os.remove(f)
+		end
+		
+		assert(ok, err)
+		assert.are.same({ true, false, true }, exists)
+	end)
+	
+	it("deletes entries which haven't been used recently from the cache directory", function()
+		local a, a_include = make_template("int a;\n", "local int x;\n")
+		local b, b_include = make_template("int b;\n", "local int x;\n")
+		
+		local cache_dir = a:match("^(.*)[\\/]") or "."
+		
+		local real_max_age = template_cache.DIR_CACHE_MAX_AGE
+		template_cache.DIR_CACHE_MAX_AGE = -1
+		
+		local ok, err = pcall(function()
+			template_cache.load_template(a, cache_dir, error)
+			template_cache.load_template(b, cache_dir, error)
+		end)
+		
+		template_cache.DIR_CACHE_MAX_AGE = real_max_age
+		template_cache.clear_memory_cache()
+		
+		local exists = {}
+		
+		for _, f in ipairs({ a, b })
+		do
+			local cache_file = template_cache.cache_filename(f, cache_dir)
+			
+			local file = io.open(cache_file, "rb")
+			if file
+			then
+				file:close()
+			end
+			
+			table.insert(exists, file ~= nil)
+			os.remove(cache_file)
+		end
+		
+		os.remove(cache_dir .. "/index.lua")
+		
+		for _, f in ipairs({ a, a_include, b, b_include })
+		do
+			os.remove(f)
+		end
+		
+		assert(ok, err)
+		assert.are.same({ false, true }, exists)
+	end)
+	
+	it("serialises values which round trip exactly", function()
+		local shared = { "shared" }
+		local value = {
+			1, -2, math.mininteger, 1.0, 0.1, 1e300, math.huge, -math.huge,
+			"string\0with\r\nescapes\"\\", true, false,
+			{ shared, shared },
+			named = { x = 1 },
+		}
+		
+		local chunk = load(template_cache._serialise(value), "=serialised", "t", {})
+		local got = chunk()
+		
+		assert.are.same(value, got)
+		assert.are.same("float", math.type(got[4]))
+		assert.are.same("integer", math.type(got[3]))
+		assert.are.same(true, got[12][1] == got[12][2])
+	end)
+	
+	it("serialises deeply nested tables", function()
+		local value = {}
+		local node = value
+		
+		for i = 1, 1000
+		do
+			node[1] = {}
+			node = node[1]
+		end
+		
+		local chunk = load(template_cache._serialise(value), "=serialised", "t", {})
+		
+		assert.are.same(value, chunk())
+	end)
+	
+	it("errors when serialising a table which contains itself", function()
+		local value = {}
+		value[1] = value
+		
+		assert.has_error(function() template_cache._serialise(value) end,
+			"Cannot serialise a table which contains itself")
+	end)
+end)
@@ -10,6 +10,7 @@ local DocumentStream = class.class()
 function DocumentStream:_init(s)
 	self._doc = s
 	self._pos = 0
+	self._reader = rehex.DocumentReader(s, rehex.BitOffset(0, 0))
 end
 
 function DocumentStream:close()
@@ -36,6 +37,8 @@ function DocumentStream:seek(whence, offset)
 		self._pos = len
 	end
 
+	self._reader:seek(rehex.BitOffset(self._pos, 0))
+
 	return self._pos
 end
 
@@ -47,7 +50,7 @@ function DocumentStream:read(num)
 			return nil
 		end
 
-		local ret = self._doc:read_data(self._pos)
+		local ret = self._reader:read(len - self._pos)
 		self._pos = len
 
 		return ret
@@ -55,7 +58,7 @@ function DocumentStream:read(num)
 		return ""
 	end
 
-	local ret = self._doc:read_data(self._pos, num)
+	local ret = self._reader:read(num)
 
 	if ret:len() == 0 then
 		return nil
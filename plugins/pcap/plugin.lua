@@ -14,64 +14,77 @@
 -- this program; if not, write to the Free Software Foundation, Inc., 51
 -- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
-function process_packet_record(doc, offset, num)
-	doc:set_comment(offset, 4, rehex.Comment.new("Timestamp (Seconds)"))
-	doc:set_comment(offset + 4, 4, rehex.Comment.new("Timestamp (Microseconds or nanoseconds)"))
-	doc:set_comment(offset + 8, 4, rehex.Comment.new("Captured Packet Length"))
-	doc:set_data_type(offset + 8, 4, "u32le")
-	doc:set_comment(offset + 12, 4, rehex.Comment.new("Original Packet Length"))
-	doc:set_data_type(offset + 12, 4, "u32le")
-	local PacketLength = string.unpack('<I4', doc:read_data(offset+12, 4))
-	doc:set_comment(offset + 16, PacketLength, rehex.Comment.new("Packet Data"))
-	doc:set_comment(offset, PacketLength+16, rehex.Comment.new("Packet #" .. num))
+local function comment(session, offset, length, text)
+	session:set_comment(rehex.BitOffset(offset, 0), rehex.BitOffset(length, 0), rehex.Comment.new(text))
+end
+
+local function data_type(session, offset, length, type)
+	session:set_data_type(rehex.BitOffset(offset, 0), rehex.BitOffset(length, 0), type)
+end
+
+local function read_number(reader, offset, type)
+	reader:seek(rehex.BitOffset(offset, 0))
+	return reader:read_numbers(type, 1)[1]
+end
+
+function process_packet_record(reader, session, offset, num)
+	comment(session, offset, 4, "Timestamp (Seconds)")
+	comment(session, offset + 4, 4, "Timestamp (Microseconds or nanoseconds)")
+	comment(session, offset + 8, 4, "Captured Packet Length")
+	data_type(session, offset + 8, 4, "u32le")
+	comment(session, offset + 12, 4, "Original Packet Length")
+	data_type(session, offset + 12, 4, "u32le")
+	local PacketLength = read_number(reader, offset+12, "u32le")
+	comment(session, offset + 16, PacketLength, "Packet Data")
+	comment(session, offset, PacketLength+16, "Packet #" .. num)
 	if (PacketLength >= 14) then
-		doc:set_comment(offset+16, 6, rehex.Comment.new("Ethernet Destination"))
-		doc:set_comment(offset+22, 6, rehex.Comment.new("Ethernet Source"))
-		doc:set_comment(offset+28, 2, rehex.Comment.new("Type"))
-		local PacketType = string.unpack('<I2', doc:read_data(offset+28,2))
+		comment(session, offset+16, 6, "Ethernet Destination")
+		comment(session, offset+22, 6, "Ethernet Source")
+		comment(session, offset+28, 2, "Type")
+		local PacketType = read_number(reader, offset+28, "u16le")
 		if (PacketType == 8) then
-			doc:set_comment(offset+30,1,rehex.Comment.new("Version + Header Length"))
-			doc:set_comment(offset+31,1,rehex.Comment.new("Differentiated Services Field"))
-			doc:set_comment(offset+32,2,rehex.Comment.new("IP Total Length"))
-			doc:set_data_type(offset+32, 2, "u16be")
-			doc:set_comment(offset+34,2,rehex.Comment.new("IP Identification"))
-			doc:set_comment(offset+36,2,rehex.Comment.new("IP Flags"))
-			doc:set_comment(offset+38,1,rehex.Comment.new("IP TTL"))
-			local Proto = string.unpack('<I1', doc:read_data(offset+39,1))
+			comment(session, offset+30, 1, "Version + Header Length")
+			comment(session, offset+31, 1, "Differentiated Services Field")
+			comment(session, offset+32, 2, "IP Total Length")
+			data_type(session, offset+32, 2, "u16be")
+			comment(session, offset+34, 2, "IP Identification")
+			comment(session, offset+36, 2, "IP Flags")
+			comment(session, offset+38, 1, "IP TTL")
+			local Proto = read_number(reader, offset+39, "u8")
 			if (Proto == 6) then
-				doc:set_comment(offset+39,1,rehex.Comment.new("TCP Protocol"))
+				comment(session, offset+39, 1, "TCP Protocol")
 			elseif (Proto == 17) then
-				doc:set_comment(offset+39,1,rehex.Comment.new("UDP Protocol"))
+				comment(session, offset+39, 1, "UDP Protocol")
 			end
-			doc:set_comment(offset+40,2,rehex.Comment.new("IP Checksum"))
-			doc:set_comment(offset+42,4,rehex.Comment.new("IP SRC"))
-			doc:set_comment(offset+46,4,rehex.Comment.new("IP DST"))
+			comment(session, offset+40, 2, "IP Checksum")
+			comment(session, offset+42, 4, "IP SRC")
+			comment(session, offset+46, 4, "IP DST")
 			if (Proto == 6) then
-				doc:set_comment(offset+50,2,rehex.Comment.new("TCP SRC Port"))
-				doc:set_data_type(offset+50, 2, "u16be")
-				doc:set_comment(offset+52,2,rehex.Comment.new("TCP DST Port"))
-				doc:set_data_type(offset+52, 2, "u16be")
-				doc:set_comment(offset+54,4,rehex.Comment.new("TCP Sequence Number"))
-				doc:set_data_type(offset+54, 4, "u32be")
-				doc:set_comment(offset+58,4,rehex.Comment.new("TCP Acknowledgment Number"))
-				doc:set_data_type(offset+58, 4, "u32be")
-				local TCPHeaderLength = string.unpack('<I1', doc:read_data(offset+62,1)) // 15 * 4
-				doc:set_comment(offset+62,2,rehex.Comment.new("TCP Header Length = " .. tostring(TCPHeaderLength) .. " and TCP Flags field"))
-				doc:set_comment(offset+64,2,rehex.Comment.new("TCP Window"))
-				doc:set_data_type(offset+64, 2, "u16be")
-				doc:set_comment(offset+66,2,rehex.Comment.new("TCP Checksum"))
-				doc:set_comment(offset+68,2,rehex.Comment.new("TCP Urgent Pointer"))
+				comment(session, offset+50, 2, "TCP SRC Port")
+				data_type(session, offset+50, 2, "u16be")
+				comment(session, offset+52, 2, "TCP DST Port")
+				data_type(session, offset+52, 2, "u16be")
+				comment(session, offset+54, 4, "TCP Sequence Number")
+				data_type(session, offset+54, 4, "u32be")
+				comment(session, offset+58, 4, "TCP Acknowledgment Number")
+				data_type(session, offset+58, 4, "u32be")
+				local TCPHeaderLength = read_number(reader, offset+62, "u8") // 15 * 4
+				comment(session, offset+62, 2, "TCP Header Length = " .. tostring(TCPHeaderLength) .. " and TCP Flags field")
+				comment(session, offset+64, 2, "TCP Window")
+				data_type(session, offset+64, 2, "u16be")
+				comment(session, offset+66, 2, "TCP Checksum")
+				comment(session, offset+68, 2, "TCP Urgent Pointer")
 				if (TCPHeaderLength > 20) then
-					doc:set_comment(offset+70,TCPHeaderLength-20,rehex.Comment.new("TCP Options"))
+					comment(session, offset+70, TCPHeaderLength-20, "TCP Options")
 				end
 			elseif (Proto == 17) then
-				doc:set_comment(offset+50,2,rehex.Comment.new("UDP SRC Port"))
-				doc:set_data_type(offset+50, 2, "u16be")
-				doc:set_comment(offset+52,2,rehex.Comment.new("UDP DST Port"))
-				doc:set_data_type(offset+52, 2, "u16be")
-				doc:set_comment(offset+54,2,rehex.Comment.new("UDP Length"))
-				doc:set_data_type(offset+54, 2, "u16be")
-				doc:set_comment(offset+56,2,rehex.Comment.new("UDP Checksum"))
+				comment(session, offset+50, 2, "UDP SRC Port")
+				data_type(session, offset+50, 2, "u16be")
+				comment(session, offset+52, 2, "UDP DST Port")
+				data_type(session, offset+52, 2, "u16be")
+				comment(session, offset+54, 2, "UDP Length")
+				data_type(session, offset+54, 2, "u16be")
+				comment(session, offset+56, 2, "UDP Checksum")
 			end
 		end
 	end
@@ -79,25 +92,30 @@ function process_packet_record(doc, offset, num)
 end
 
 function process_document(doc)
-	doc:set_comment(0, 24, rehex.Comment.new("File Header"))
-	doc:set_comment(0, 4, rehex.Comment.new("Magic Number"))
-	doc:set_comment(4, 2, rehex.Comment.new("Major Version"))
-	doc:set_comment(6, 2, rehex.Comment.new("Minor Version"))
-	doc:set_comment(8, 4, rehex.Comment.new("Reserved1"))
-	doc:set_comment(12, 4, rehex.Comment.new("Reserved2"))
-	doc:set_comment(16, 4, rehex.Comment.new("SnapLen"))
-	doc:set_comment(20, 4, rehex.Comment.new("LinkType"))
+	local session = rehex.AnnotationSession(doc, "Processing pcap")
+	local reader = rehex.DocumentReader(doc, rehex.BitOffset(0, 0))
+	
+	comment(session, 0, 24, "File Header")
+	comment(session, 0, 4, "Magic Number")
+	comment(session, 4, 2, "Major Version")
+	comment(session, 6, 2, "Minor Version")
+	comment(session, 8, 4, "Reserved1")
+	comment(session, 12, 4, "Reserved2")
+	comment(session, 16, 4, "SnapLen")
+	comment(session, 20, 4, "LinkType")
 	local DataLen = doc:buffer_length() - 24
 	local CurrentIndex = 24
 	local Packet = 1
-	doc:set_comment(24, DataLen, rehex.Comment.new("Packet Records"))
+	comment(session, 24, DataLen, "Packet Records")
 	while( DataLen > 0 )
 	do
-		local Offset = process_packet_record(doc, CurrentIndex, Packet)
+		local Offset = process_packet_record(reader, session, CurrentIndex, Packet)
 		DataLen = DataLen - Offset
 		CurrentIndex = CurrentIndex + Offset
 		Packet = Packet + 1
 	end
+	
+	session:commit()
 end
 
 rehex.OnTabCreated(function(mainwindow, tab)
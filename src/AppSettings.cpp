@@ -48,6 +48,7 @@ wxDEFINE_EVENT(REHex::PREFERRED_ASM_SYNTAX_CHANGED, wxCommandEvent);
 wxDEFINE_EVENT(REHex::BYTE_COLOUR_MAPS_CHANGED, wxCommandEvent);
 wxDEFINE_EVENT(REHex::MAIN_WINDOW_ACCELERATORS_CHANGED, wxCommandEvent);
 wxDEFINE_EVENT(REHex::PRIMARY_FONT_CHANGED, wxCommandEvent);
+wxDEFINE_EVENT(REHex::BUFFER_CACHE_SIZE_CHANGED, wxCommandEvent);
 
 REHex::AppSettings::AppSettings():
 	preferred_asm_syntax(AsmSyntax::INTEL),
@@ -63,7 +64,8 @@ REHex::AppSettings::AppSettings():
 	#endif
 	dirty_byte_display_mode(DirtyByteDisplayMode::COLOURED_UNLESS_BCM),
 	primary_font(get_default_primary_font()),
-	auto_save_state(false)
+	auto_save_state(false),
+	buffer_cache_size(DEFAULT_BUFFER_CACHE_SIZE)
 {
 	ByteColourMap bcm_types;
 	bcm_types.set_label("ASCII Values");
@@ -290,6 +292,12 @@ REHex::AppSettings::AppSettings(wxConfig *config): AppSettings()
 		config->ReadDouble("primary-font-scale", primary_font.scale()));
 
 	auto_save_state = config->ReadBool("auto-save-state", auto_save_state);
+	
+	long buffer_cache_size_mb = config->ReadLong("buffer-cache-size-mb", -1);
+	if(buffer_cache_size_mb > 0)
+	{
+		buffer_cache_size = buffer_cache_size_from_mb(buffer_cache_size_mb);
+	}
 }
 
 REHex::AppSettings::~AppSettings()
@@ -349,6 +357,7 @@ void REHex::AppSettings::write(wxConfig *config)
 	config->Write("primary-font-scale", primary_font.scale());
 
 	config->Write("auto-save-state", auto_save_state);
+	config->Write("buffer-cache-size-mb", (long)(buffer_cache_size / (1024 * 1024)));
 }
 
 REHex::AsmSyntax REHex::AppSettings::get_preferred_asm_syntax() const
@@ -587,6 +596,40 @@ void REHex::AppSettings::set_auto_save_state(bool auto_save_state)
 	this->auto_save_state = auto_save_state;
 }
 
+size_t REHex::AppSettings::get_buffer_cache_size() const
+{
+	return buffer_cache_size;
+}
+
+void REHex::AppSettings::set_buffer_cache_size(size_t buffer_cache_size)
+{
+	buffer_cache_size -= buffer_cache_size % (1024 * 1024);
+	
+	if(this->buffer_cache_size != buffer_cache_size)
+	{
+		this->buffer_cache_size = buffer_cache_size;
+		
+		wxCommandEvent event(BUFFER_CACHE_SIZE_CHANGED);
+		event.SetEventObject(this);
+		
+		wxPostEvent(this, event);
+	}
+}
+
+size_t REHex::AppSettings::buffer_cache_size_from_mb(uint64_t buffer_cache_size_mb)
+{
+	/* The settings allow far more than a 32-bit size_t can hold. */
+	
+	static const uint64_t MAX_MB = (uint64_t)(SIZE_MAX) / (1024 * 1024);
+	
+	if(buffer_cache_size_mb > MAX_MB)
+	{
+		buffer_cache_size_mb = MAX_MB;
+	}
+	
+	return (size_t)(buffer_cache_size_mb * 1024 * 1024);
+}
+
 REHex::ScaledFont::ScaledFont(const std::string &name, float scale):
 	m_name(name),
 	m_scale(scale) {}
@@ -20,6 +20,7 @@
 
 #include <map>
 #include <memory>
+#include <stdint.h>
 #include <wx/config.h>
 #include <wx/font.h>
 #include <wx/wx.h>
@@ -162,6 +163,25 @@ namespace REHex
 			*/
 			void set_auto_save_state(bool auto_save_state);
 			
+			static constexpr size_t DEFAULT_BUFFER_CACHE_SIZE = 64 * 1024 * 1024; /* 64MiB */
+			
+			/**
+			 * @brief Get the maximum amount of unmodified file data (in bytes) to keep in memory per file.
+			*/
+			size_t get_buffer_cache_size() const;
+			
+			/**
+			 * @brief Set the maximum amount of unmodified file data (in bytes) to keep in memory per file.
+			 *
+			 * The size is rounded down to a whole number of MiB.
+			*/
+			void set_buffer_cache_size(size_t buffer_cache_size);
+			
+			/**
+			 * @brief Convert a cache size in MiB to bytes, clamped to what fits in a size_t.
+			*/
+			static size_t buffer_cache_size_from_mb(uint64_t buffer_cache_size_mb);
+			
 		private:
 			AsmSyntax preferred_asm_syntax;
 			GotoOffsetBase goto_offset_base;
@@ -176,6 +196,7 @@ namespace REHex
 			DirtyByteDisplayMode dirty_byte_display_mode;
 			ScaledFont primary_font;
 			bool auto_save_state;
+			size_t buffer_cache_size;
 			
 			void OnColourPaletteChanged(wxCommandEvent &event);
 	};
@@ -184,6 +205,7 @@ namespace REHex
 	wxDECLARE_EVENT(BYTE_COLOUR_MAPS_CHANGED, wxCommandEvent);
 	wxDECLARE_EVENT(MAIN_WINDOW_ACCELERATORS_CHANGED, wxCommandEvent);
 	wxDECLARE_EVENT(PRIMARY_FONT_CHANGED, wxCommandEvent);
+	wxDECLARE_EVENT(BUFFER_CACHE_SIZE_CHANGED, wxCommandEvent);
 }
 
 #endif /* !REHEX_APPSETTINGS_HPP */
@@ -17,8 +17,11 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
+#include <math.h>
 #include <unistr.h>
 #include <wx/dcmemory.h>
+#include <wx/rawbmp.h>
 #include <wx/settings.h>
 
 #include "BatchedCharacterRenderer.hpp"
@@ -39,7 +42,11 @@ wxRect REHex::BatchedCharacterRenderer::draw_char_fast(int column, ucs4_t codepo
 {
 	PROFILE_BLOCK("REHex::BatchedCharacterRenderer::draw_char_fast()");
 	
-	#ifdef REHEX_FORCE_SLOW_TEXT_PATH
+	#if defined(REHEX_GLYPH_ATLAS)
+	
+	return draw_char_atlas(column, codepoint, m_cache.fixed_char_size(), fg_colour, bg_colour);
+	
+	#elif defined(REHEX_FORCE_SLOW_TEXT_PATH)
 	
 	return draw_char_slow(column, codepoint, char_size, fg_colour, bg_colour);
 	
@@ -80,6 +87,10 @@ wxRect REHex::BatchedCharacterRenderer::draw_char_slow(int column, ucs4_t codepo
 {
 	PROFILE_BLOCK("REHex::BatchedCharacterRenderer::draw_char_slow()");
 	
+	#ifdef REHEX_GLYPH_ATLAS
+	return draw_char_atlas(column, codepoint, char_size, fg_colour, bg_colour);
+	#endif
+	
 	#if defined(REHEX_CACHE_CHARACTER_BITMAPS) && defined(REHEX_CACHE_STRING_BITMAPS) && defined(REHEX_BROKEN_BITMAP_TRANSPARENCY)
 	/* Okay... wxBitmap masks/transparency don't work on macOS, so if we draw multiple
 	 * contiguous lines interleaved, relying on spaces in the string not being drawn
@@ -193,6 +204,11 @@ void REHex::BatchedCharacterRenderer::flush()
 {
 	PROFILE_BLOCK("REHex::BatchedCharacterRenderer::flush()");
 	
+	#ifdef REHEX_GLYPH_ATLAS
+	flush_atlas();
+	return;
+	#endif
+	
 	#if !(defined(REHEX_FORCE_SLOW_PATH)) || (defined(REHEX_CACHE_CHARACTER_BITMAPS) && defined(REHEX_CACHE_STRING_BITMAPS) && !(defined(REHEX_BROKEN_BITMAP_TRANSPARENCY)))
 	/* Paint background colours for any characters on the fast path (or cached strings with working transparency). */
 	m_bgfill.flush();
@@ -304,3 +320,176 @@ void REHex::BatchedCharacterRenderer::flush()
 		#endif
 	}
 }
+
+#ifdef REHEX_GLYPH_ATLAS
+wxRect REHex::BatchedCharacterRenderer::draw_char_atlas(int column, ucs4_t codepoint, const wxSize &char_size, const wxColour &fg_colour, const wxColour &bg_colour)
+{
+	m_deferred_glyphs.push_back(DeferredGlyph{ column, codepoint, char_size, fg_colour, bg_colour });
+	
+	return wxRect(
+		wxPoint((m_base_x + m_cache.fixed_string_width(column)), m_base_y),
+		char_size);
+}
+
+/* Glyph atlas rendering path - every queued character is composited into one off-screen bitmap
+ * using cached colour-independent coverage masks from the FontCharacterCache, then each run of
+ * contiguous characters is copied to the DC. This avoids any text drawing or per-character
+ * bitmap blits once the masks are cached, no matter how many colours are in use.
+*/
+void REHex::BatchedCharacterRenderer::flush_atlas()
+{
+	if(m_deferred_glyphs.empty())
+	{
+		return;
+	}
+	
+	/* Sort the characters into column order, if the same column was drawn more than once, the
+	 * most recent one should win so we need a stable sort.
+	*/
+	std::stable_sort(m_deferred_glyphs.begin(), m_deferred_glyphs.end(),
+		[](const DeferredGlyph &a, const DeferredGlyph &b)
+		{
+			return a.column < b.column;
+		});
+	
+	int line_w = 0;
+	int line_h = m_cache.fixed_char_height();
+	
+	for(auto g = m_deferred_glyphs.begin(); g != m_deferred_glyphs.end(); ++g)
+	{
+		line_w = std::max(line_w, (m_cache.fixed_string_width(g->column) + g->char_size.GetWidth()));
+		line_h = std::max(line_h, g->char_size.GetHeight());
+	}
+	
+	wxBitmap &bitmap = m_cache.scratch_bitmap(wxSize(line_w, line_h));
+	double scale = m_cache.bitmap_scale_factor();
+	
+	int phys_w = std::min<int>(ceil(line_w * scale), bitmap.GetWidth());
+	int phys_h = std::min<int>(ceil(line_h * scale), bitmap.GetHeight());
+	
+	{
+		PROFILE_INNER_BLOCK("compositing glyphs");
+		
+		wxNativePixelData pixels(bitmap);
+		if(!pixels)
+		{
+			/* Can't access the bitmap directly, fall back to drawing each character. */
+			
+			m_dc.SetFont(m_cache.get_font());
+			m_dc.SetBackgroundMode(wxSOLID);
+			
+			for(auto g = m_deferred_glyphs.begin(); g != m_deferred_glyphs.end(); ++g)
+			{
+				m_dc.SetTextForeground(g->fg_colour);
+				m_dc.SetTextBackground(g->bg_colour);
+				
+				char c_utf8[6];
+				int c_utf8_len = u8_uctomb((uint8_t*)(c_utf8), g->codepoint, sizeof(c_utf8));
+				
+				if(c_utf8_len > 0)
+				{
+					m_dc.DrawText(wxString::FromUTF8Unchecked(c_utf8, c_utf8_len), (m_base_x + m_cache.fixed_string_width(g->column)), m_base_y);
+				}
+			}
+			
+			m_deferred_glyphs.clear();
+			return;
+		}
+		
+		for(auto g = m_deferred_glyphs.begin(); g != m_deferred_glyphs.end(); ++g)
+		{
+			int cell_x = m_cache.fixed_string_width(g->column);
+			
+			int x0 = cell_x * scale;
+			int x1 = std::min<int>(((cell_x + g->char_size.GetWidth()) * scale), phys_w);
+			
+			if(x0 >= x1)
+			{
+				continue;
+			}
+			
+			const unsigned char fg[] = { g->fg_colour.Red(), g->fg_colour.Green(), g->fg_colour.Blue() };
+			const unsigned char bg[] = { g->bg_colour.Red(), g->bg_colour.Green(), g->bg_colour.Blue() };
+			
+			/* Fill the background of the cell. */
+			
+			wxNativePixelData::Iterator row(pixels);
+			row.MoveTo(pixels, x0, 0);
+			
+			for(int y = 0; y < phys_h; ++y)
+			{
+				wxNativePixelData::Iterator p = row;
+				
+				for(int x = x0; x < x1; ++x, ++p)
+				{
+					p.Red()   = bg[0];
+					p.Green() = bg[1];
+					p.Blue()  = bg[2];
+				}
+				
+				row.OffsetY(pixels, 1);
+			}
+			
+			/* Blend the foreground colour over it, weighted by the glyph coverage. */
+			
+			const FontCharacterCache::GlyphMask &mask = m_cache.glyph_mask(g->codepoint, g->char_size);
+			
+			int mask_w = std::min(mask.width, (phys_w - x0));
+			int mask_h = std::min(mask.height, phys_h);
+			
+			row.MoveTo(pixels, x0, 0);
+			
+			for(int y = 0; y < mask_h; ++y)
+			{
+				wxNativePixelData::Iterator p = row;
+				const unsigned char *coverage = mask.coverage.data() + (y * mask.width * 3);
+				
+				for(int x = 0; x < mask_w; ++x, ++p, coverage += 3)
+				{
+					if(coverage[0] != 0 || coverage[1] != 0 || coverage[2] != 0)
+					{
+						p.Red()   = p.Red()   + (((int)(fg[0]) - (int)(p.Red()))   * coverage[0]) / 255;
+						p.Green() = p.Green() + (((int)(fg[1]) - (int)(p.Green())) * coverage[1]) / 255;
+						p.Blue()  = p.Blue()  + (((int)(fg[2]) - (int)(p.Blue()))  * coverage[2]) / 255;
+					}
+				}
+				
+				row.OffsetY(pixels, 1);
+			}
+		}
+	}
+	
+	{
+		PROFILE_INNER_BLOCK("blitting glyphs");
+		
+		/* Copy each run of adjacent characters to the DC, leaving anything between them
+		 * (e.g. the gaps between groups of bytes) untouched.
+		*/
+		
+		wxMemoryDC mdc(bitmap);
+		
+		int run_x0 = m_cache.fixed_string_width(m_deferred_glyphs.front().column);
+		int run_x1 = run_x0;
+		
+		for(auto g = m_deferred_glyphs.begin(); g != m_deferred_glyphs.end(); ++g)
+		{
+			int cell_x0 = m_cache.fixed_string_width(g->column);
+			int cell_x1 = cell_x0 + g->char_size.GetWidth();
+			
+			if(cell_x0 > run_x1)
+			{
+				m_dc.Blit((m_base_x + run_x0), m_base_y, (run_x1 - run_x0), line_h, &mdc, run_x0, 0);
+				run_x0 = cell_x0;
+			}
+			
+			run_x1 = std::max(run_x1, cell_x1);
+		}
+		
+		m_dc.Blit((m_base_x + run_x0), m_base_y, (run_x1 - run_x0), line_h, &mdc, run_x0, 0);
+		
+		mdc.SelectObject(wxNullBitmap);
+	}
+	
+	m_deferred_glyphs.clear();
+}
+#endif
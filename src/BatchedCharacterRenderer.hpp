@@ -174,6 +174,23 @@ namespace REHex
 			#ifdef REHEX_BROKEN_BITMAP_TRANSPARENCY
 			const DeferredDrawTextSlowKey *m_deferred_drawtext_slow_last_key = NULL;
 			#endif
+			
+			#ifdef REHEX_GLYPH_ATLAS
+			struct DeferredGlyph
+			{
+				int column;
+				ucs4_t codepoint;
+				wxSize char_size;
+				
+				wxColour fg_colour;
+				wxColour bg_colour;
+			};
+			
+			std::vector<DeferredGlyph> m_deferred_glyphs;
+			
+			wxRect draw_char_atlas(int column, ucs4_t codepoint, const wxSize &char_size, const wxColour &fg_colour, const wxColour &bg_colour);
+			void flush_atlas();
+			#endif
 	};
 }
 
@@ -121,7 +121,7 @@ void REHex::BitArrayRegion::draw(DocumentCtrl &doc_ctrl, wxDC &dc, int x, int64_
 		data_length = BitOffset(max_data_in_client_area, 0);
 	}
 	
-	std::vector<bool> data;
+	BitVector data;
 	try {
 		data = doc->read_bits(data_base, ((data_length.byte() * 8) + data_length.bit()));
 	}
@@ -214,13 +214,10 @@ void REHex::BitArrayRegion::draw(DocumentCtrl &doc_ctrl, wxDC &dc, int x, int64_
 		
 		off_t data_avail = (off_t)(data.size()) - data_offset;
 		
-		std::vector<bool> line_data;
+		BitVector line_data;
 		if(data_avail >= 0)
 		{
-			auto begin = std::next(data.begin(), data_offset);
-			auto end = std::next(begin, std::min(line_len.total_bits(), data_avail));
-			
-			line_data.insert(line_data.end(), begin, end);
+			line_data = data.slice(data_offset, std::min(line_len.total_bits(), data_avail));
 		}
 		
 		draw_bin_line(&doc_ctrl, dc, (x + data_text_x), y, line_data, line_len, 0, data_cur, alternate_row, has_focus, doc_ctrl.special_view_active(), highlight_func, false);
@@ -509,7 +506,7 @@ bool REHex::BitArrayRegion::OnChar(DocumentCtrl *doc_ctrl, wxKeyEvent &event)
 		BitOffset cursor_position = doc_ctrl->get_cursor_position();
 		
 		try {
-			std::vector<bool> bit = { (key == '1') };
+			BitVector bit = { (key == '1') };
 			doc->overwrite_bits(cursor_position, bit, (cursor_position + BitOffset(0, 1)));
 		}
 		catch(const std::exception &e)
@@ -534,14 +531,14 @@ wxDataObject *REHex::BitArrayRegion::OnCopy(DocumentCtrl &doc_ctrl)
 	if(doc_ctrl.special_view_active())
 	{
 		try {
-			std::vector<bool> data = doc->read_bits(selection_first, ((selection_last - selection_first).total_bits() + 1));
+			BitVector data = doc->read_bits(selection_first, ((selection_last - selection_first).total_bits() + 1));
 			
 			std::string data_string;
 			data_string.reserve(data.size());
 			
-			for(auto p = data.begin(); p != data.end(); ++p)
+			for(size_t i = 0; i < data.size(); ++i)
 			{
-				data_string.append(1, (*p ? '1' : '0'));
+				data_string.append(1, (data[i] ? '1' : '0'));
 			}
 			
 			return new wxTextDataObject(data_string);
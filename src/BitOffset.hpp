@@ -19,6 +19,7 @@
 #define REHEX_BITOFFSET_HPP
 
 #include <assert.h>
+#include <functional>
 #include <jansson.h>
 #include <stdint.h>
 #include <string>
@@ -229,4 +230,15 @@ namespace REHex
 	};
 }
 
+namespace std
+{
+	template<> struct hash<REHex::BitOffset>
+	{
+		size_t operator()(const REHex::BitOffset &bo) const
+		{
+			return std::hash<int64_t>()(bo.total_bits());
+		}
+	};
+}
+
 #endif /* !REHEX_BITOFFSET_HPP */
@@ -0,0 +1,228 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <ostream>
+#include <string.h>
+
+#include "BitVector.hpp"
+#include "util.hpp"
+
+REHex::BitVector::BitVector():
+	m_size(0) {}
+
+REHex::BitVector::BitVector(size_t size, bool value):
+	m_data(((size + 7) / 8), (value ? 0xFF : 0x00)),
+	m_size(size)
+{
+	clear_tail();
+}
+
+REHex::BitVector::BitVector(std::initializer_list<bool> bits):
+	m_data(((bits.size() + 7) / 8), 0x00),
+	m_size(bits.size())
+{
+	size_t i = 0;
+	for(auto b = bits.begin(); b != bits.end(); ++b, ++i)
+	{
+		set(i, *b);
+	}
+}
+
+REHex::BitVector::BitVector(const std::vector<bool> &bits):
+	m_data(((bits.size() + 7) / 8), 0x00),
+	m_size(bits.size())
+{
+	for(size_t i = 0; i < bits.size(); ++i)
+	{
+		set(i, bits[i]);
+	}
+}
+
+REHex::BitVector::BitVector(const unsigned char *data, size_t offset, size_t length):
+	m_data(((length + 7) / 8), 0x00),
+	m_size(length)
+{
+	copy_bits(m_data.data(), 0, data, offset, length);
+}
+
+void REHex::BitVector::clear_tail()
+{
+	if((m_size % 8) != 0)
+	{
+		m_data.back() &= (unsigned char)(0xFF << (8 - (m_size % 8)));
+	}
+}
+
+void REHex::BitVector::push_back(bool value)
+{
+	if((m_size % 8) == 0)
+	{
+		m_data.push_back(0x00);
+	}
+	
+	++m_size;
+	set((m_size - 1), value);
+}
+
+void REHex::BitVector::append(const BitVector &bits)
+{
+	size_t old_size = m_size;
+	resize(m_size + bits.m_size);
+	
+	copy_bits(m_data.data(), old_size, bits.m_data.data(), 0, bits.m_size);
+}
+
+void REHex::BitVector::resize(size_t size)
+{
+	if(size < m_size)
+	{
+		m_size = size;
+		m_data.resize((size + 7) / 8);
+		
+		clear_tail();
+	}
+	else{
+		m_size = size;
+		m_data.resize(((size + 7) / 8), 0x00);
+	}
+}
+
+void REHex::BitVector::clear()
+{
+	m_data.clear();
+	m_size = 0;
+}
+
+REHex::BitVector REHex::BitVector::slice(size_t offset, size_t length) const
+{
+	if(offset >= m_size)
+	{
+		return BitVector();
+	}
+	
+	length = std::min(length, (m_size - offset));
+	
+	return BitVector(m_data.data(), offset, length);
+}
+
+void REHex::BitVector::copy_to(unsigned char *dst, size_t offset) const
+{
+	copy_bits(dst, offset, m_data.data(), 0, m_size);
+}
+
+void REHex::BitVector::copy_to(unsigned char *dst, size_t dst_offset, size_t src_offset, size_t length) const
+{
+	assert(src_offset <= m_size);
+	assert(length <= (m_size - src_offset));
+	
+	copy_bits(dst, dst_offset, m_data.data(), src_offset, length);
+}
+
+std::vector<bool> REHex::BitVector::to_vector() const
+{
+	std::vector<bool> bits(m_size);
+	
+	for(size_t i = 0; i < m_size; ++i)
+	{
+		bits[i] = (*this)[i];
+	}
+	
+	return bits;
+}
+
+void REHex::BitVector::copy_bits(unsigned char *dst, size_t dst_offset, const unsigned char *src, size_t src_offset, size_t length)
+{
+	if(length == 0)
+	{
+		return;
+	}
+	
+	dst += dst_offset / 8;
+	src += src_offset / 8;
+	
+	int dst_shift = dst_offset % 8;
+	int src_shift = src_offset % 8;
+	
+	size_t dst_bytes = (dst_shift + length + 7) / 8;
+	size_t src_bytes = (src_shift + length + 7) / 8;
+	
+	/* Bits at the end of the final destination byte which must be preserved. */
+	int tail_bits = (dst_bytes * 8) - (dst_shift + length);
+	unsigned char tail_mask = (unsigned char)((1 << tail_bits) - 1);
+	unsigned char tail_save = dst[dst_bytes - 1];
+	
+	if(src_shift == dst_shift)
+	{
+		/* Same alignment, copy the bytes in between and merge the ends. */
+		
+		unsigned char head_mask = (unsigned char)(0xFF << (8 - dst_shift));
+		unsigned char head_save = dst[0];
+		
+		memcpy(dst, src, dst_bytes);
+		
+		dst[0] = (dst[0] & ~head_mask) | (head_save & head_mask);
+	}
+	else{
+		/* Shift the source bits to the start of a temporary buffer and then shift them
+		 * into place in the destination. memcpy_right() preserves the leading bits of
+		 * the first destination byte.
+		*/
+		
+		unsigned char stack_buf[64];
+		std::vector<unsigned char> heap_buf;
+		
+		unsigned char *aligned = stack_buf;
+		if(src_bytes > sizeof(stack_buf))
+		{
+			heap_buf.resize(src_bytes);
+			aligned = heap_buf.data();
+		}
+		
+		memcpy_left(aligned, src, src_bytes, src_shift);
+		
+		size_t aligned_bytes = (length + 7) / 8;
+		
+		if(dst_shift == 0)
+		{
+			memcpy(dst, aligned, aligned_bytes);
+		}
+		else{
+			CarryBits carry = memcpy_right(dst, aligned, aligned_bytes, dst_shift);
+			
+			if(dst_bytes > aligned_bytes)
+			{
+				dst[aligned_bytes] = carry.value;
+			}
+		}
+	}
+	
+	dst[dst_bytes - 1] = (dst[dst_bytes - 1] & ~tail_mask) | (tail_save & tail_mask);
+}
+
+std::ostream &REHex::operator<<(std::ostream &os, const BitVector &bits)
+{
+	for(size_t i = 0; i < bits.size(); ++i)
+	{
+		os << (bits[i] ? '1' : '0');
+	}
+	
+	return os;
+}
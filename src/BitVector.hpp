@@ -0,0 +1,201 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_BITVECTOR_HPP
+#define REHEX_BITVECTOR_HPP
+
+#include <assert.h>
+#include <initializer_list>
+#include <iosfwd>
+#include <stddef.h>
+#include <vector>
+
+namespace REHex
+{
+	/**
+	 * @brief A packed sequence of bits.
+	 *
+	 * Bits are stored most significant first, in the same order they appear in a file, so
+	 * data read from a Buffer can be moved in and out of a BitVector a byte (or more) at a
+	 * time rather than handling each bit individually like a std::vector<bool>.
+	 *
+	 * Any unused bits at the end of the final byte are always zero.
+	*/
+	class BitVector
+	{
+		private:
+			std::vector<unsigned char> m_data;
+			size_t m_size;
+			
+			void clear_tail();
+			
+		public:
+			BitVector();
+			
+			/**
+			 * @brief Construct a BitVector of the given length with every bit set to value.
+			*/
+			explicit BitVector(size_t size, bool value = false);
+			
+			/**
+			 * @brief Construct a BitVector from a sequence of bits.
+			*/
+			BitVector(std::initializer_list<bool> bits);
+			
+			/**
+			 * @brief Construct a BitVector from a std::vector<bool>.
+			*/
+			BitVector(const std::vector<bool> &bits);
+			
+			/**
+			 * @brief Construct a BitVector from a range of bits in a buffer.
+			 *
+			 * @param data    Buffer to copy from.
+			 * @param offset  Offset of the first bit to copy (from the most significant bit of data[0]).
+			 * @param length  Number of bits to copy.
+			*/
+			BitVector(const unsigned char *data, size_t offset, size_t length);
+			
+			/**
+			 * @brief Get the number of bits in the BitVector.
+			*/
+			size_t size() const
+			{
+				return m_size;
+			}
+			
+			bool empty() const
+			{
+				return m_size == 0;
+			}
+			
+			bool operator[](size_t index) const
+			{
+				assert(index < m_size);
+				return (m_data[index / 8] & (0x80 >> (index % 8))) != 0;
+			}
+			
+			/**
+			 * @brief Set or clear a single bit.
+			*/
+			void set(size_t index, bool value)
+			{
+				assert(index < m_size);
+				
+				if(value)
+				{
+					m_data[index / 8] |= (0x80 >> (index % 8));
+				}
+				else{
+					m_data[index / 8] &= ~(0x80 >> (index % 8));
+				}
+			}
+			
+			/**
+			 * @brief Append a single bit.
+			*/
+			void push_back(bool value);
+			
+			/**
+			 * @brief Append the bits from another BitVector.
+			*/
+			void append(const BitVector &bits);
+			
+			/**
+			 * @brief Change the number of bits, new bits are cleared.
+			*/
+			void resize(size_t size);
+			
+			void clear();
+			
+			/**
+			 * @brief Get a new BitVector containing a range of bits from this one.
+			 *
+			 * The range is clamped to the end of the BitVector.
+			*/
+			BitVector slice(size_t offset, size_t length) const;
+			
+			/**
+			 * @brief Get the packed bytes.
+			 *
+			 * Returns (size() + 7) / 8 bytes, any unused bits in the final byte are zero.
+			*/
+			const std::vector<unsigned char> &bytes() const
+			{
+				return m_data;
+			}
+			
+			/**
+			 * @brief Copy the bits into a buffer at a bit offset.
+			 *
+			 * @param dst     Buffer to write to.
+			 * @param offset  Offset of the first bit to write (from the most significant bit of dst[0]).
+			 *
+			 * Any bits in dst outside of the range written to are preserved.
+			*/
+			void copy_to(unsigned char *dst, size_t offset) const;
+			
+			/**
+			 * @brief Copy a range of bits into a buffer at a bit offset.
+			 *
+			 * @param dst         Buffer to write to.
+			 * @param dst_offset  Offset of the first bit to write (from the most significant bit of dst[0]).
+			 * @param src_offset  Offset of the first bit to copy from this BitVector.
+			 * @param length      Number of bits to copy.
+			 *
+			 * Any bits in dst outside of the range written to are preserved.
+			*/
+			void copy_to(unsigned char *dst, size_t dst_offset, size_t src_offset, size_t length) const;
+			
+			/**
+			 * @brief Convert to a std::vector<bool>.
+			*/
+			std::vector<bool> to_vector() const;
+			
+			/**
+			 * @brief Copy a range of bits between buffers.
+			 *
+			 * @param dst         Buffer to write to.
+			 * @param dst_offset  Offset of the first bit to write.
+			 * @param src         Buffer to copy from.
+			 * @param src_offset  Offset of the first bit to copy.
+			 * @param length      Number of bits to copy.
+			 *
+			 * Offsets count from the most significant bit of the first byte. Any bits in
+			 * dst outside of the range written to are preserved. The buffers must not
+			 * overlap.
+			*/
+			static void copy_bits(unsigned char *dst, size_t dst_offset, const unsigned char *src, size_t src_offset, size_t length);
+			
+			bool operator==(const BitVector &rhs) const
+			{
+				return m_size == rhs.m_size && m_data == rhs.m_data;
+			}
+			
+			bool operator!=(const BitVector &rhs) const
+			{
+				return !(*this == rhs);
+			}
+	};
+	
+	/**
+	 * @brief Write a BitVector to a stream as a string of '0' and '1' characters.
+	*/
+	std::ostream &operator<<(std::ostream &os, const BitVector &bits);
+}
+
+#endif /* !REHEX_BITVECTOR_HPP */
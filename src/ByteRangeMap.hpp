@@ -31,6 +31,7 @@
 
 #include "BitOffset.hpp"
 #include "ByteRangeSet.hpp"
+#include "ChunkedVector.hpp"
 #include "profile.hpp"
 #include "shared_mutex.hpp"
 
@@ -46,8 +47,12 @@ namespace REHex
 	 *
 	 * You probably want to use the BitRangeMap<T> and/or ByteRangeMap<T> specialisations of
 	 * this class.
+	 *
+	 * Like RangeSet, the Container parameter selects the underlying sequence - use
+	 * ChunkedVector (see ChunkedByteRangeMap) for maps which may hold a very large number of
+	 * ranges and are modified anywhere.
 	*/
-	template<typename OT, typename T> class RangeMap
+	template<typename OT, typename T, template<typename...> class Container = std::vector> class RangeMap
 	{
 		public:
 			/**
@@ -78,8 +83,8 @@ namespace REHex
 				}
 			};
 			
-			typedef typename std::vector< std::pair<Range, T> >::iterator iterator;
-			typedef typename std::vector< std::pair<Range, T> >::const_iterator const_iterator;
+			typedef typename Container< std::pair<Range, T> >::iterator iterator;
+			typedef typename Container< std::pair<Range, T> >::const_iterator const_iterator;
 			
 			template<typename OT2 = OT>
 			static typename std::enable_if<std::is_same<OT2, off_t>::value, OT>::type
@@ -98,12 +103,12 @@ namespace REHex
 		private:
 			T default_value;
 			
-			std::vector< std::pair<Range, T> > ranges;
+			Container< std::pair<Range, T> > ranges;
 			
 			/* Last iterator returned by get_range(), used to avoid a lookup from
 			 * scratch when a nearby offset is requested again.
 			*/
-			mutable typename std::vector< std::pair<Range, T> >::const_iterator last_get_iter;
+			mutable const_iterator last_get_iter;
 			mutable shared_mutex lgi_mutex;
 			
 		public:
@@ -119,7 +124,7 @@ namespace REHex
 				ranges(src.ranges),
 				last_get_iter(ranges.end()) {}
 			
-			RangeMap &operator=(const RangeMap<OT, T> &rhs)
+			RangeMap &operator=(const RangeMap<OT, T, Container> &rhs)
 			{
 				default_value = rhs.default_value;
 				ranges = rhs.ranges;
@@ -128,12 +133,12 @@ namespace REHex
 				return *this;
 			}
 			
-			bool operator==(const RangeMap<OT, T> &rhs) const
+			bool operator==(const RangeMap<OT, T, Container> &rhs) const
 			{
 				return ranges == rhs.ranges;
 			}
 			
-			bool operator!=(const RangeMap<OT, T> &rhs) const
+			bool operator!=(const RangeMap<OT, T, Container> &rhs) const
 			{
 				return ranges != rhs.ranges;
 			}
@@ -200,7 +205,7 @@ namespace REHex
 			 * This method builds a RangeMap containing any ranges intersecting the
 			 * given range, clamped to the ends of the range.
 			*/
-			RangeMap<OT, T> get_slice(OT offset, OT length) const;
+			RangeMap<OT, T, Container> get_slice(OT offset, OT length) const;
 			
 			/**
 			 * @brief Set all keys defined in another RangeMap.
@@ -208,7 +213,7 @@ namespace REHex
 			 * This method copies ranges from another RangeMap, overwriting any
 			 * already set in this one.
 			*/
-			void set_slice(const RangeMap<OT, T> &slice);
+			void set_slice(const RangeMap<OT, T, Container> &slice);
 			
 			/**
 			 * @brief Transform all values defined in the map.
@@ -221,12 +226,12 @@ namespace REHex
 			 * WARNING: The transform MUST NOT cause values that were previously equal
 			 * to become not-equal or vice-versa.
 			*/
-			RangeMap<OT, T> &transform(const std::function<T(const T &value)> &func);
+			RangeMap<OT, T, Container> &transform(const std::function<T(const T &value)> &func);
 			
 			/**
-			 * @brief Get a reference to the internal std::vector.
+			 * @brief Get a reference to the internal container.
 			*/
-			const std::vector< std::pair<Range, T> > &get_ranges() const
+			const Container< std::pair<Range, T> > &get_ranges() const
 			{
 				return ranges;
 			}
@@ -237,7 +242,7 @@ namespace REHex
 			size_t size() const { return ranges.size(); }
 			const std::pair<Range, T> &front() const { assert(!ranges.empty()); return ranges.front(); }
 			const std::pair<Range, T> &back() const { assert(!ranges.empty()); return ranges.back(); }
-			void clear() { ranges.clear(); }
+			void clear() { ranges.clear(); last_get_iter = ranges.end(); }
 			
 		private:
 			bool data_inserted_impl(OT offset, OT length);
@@ -297,9 +302,12 @@ namespace REHex
 	
 	template<typename T> using ByteRangeMap = RangeMap<off_t, T>;
 	template<typename T> using BitRangeMap = RangeMap<BitOffset, T>;
+	
+	template<typename T> using ChunkedByteRangeMap = RangeMap<off_t, T, ChunkedVector>;
+	template<typename T> using ChunkedBitRangeMap = RangeMap<BitOffset, T, ChunkedVector>;
 }
 
-template<typename OT, typename T> typename REHex::RangeMap<OT, T>::const_iterator REHex::RangeMap<OT, T>::get_range(OT offset) const
+template<typename OT, typename T, template<typename...> class Container> typename REHex::RangeMap<OT, T, Container>::const_iterator REHex::RangeMap<OT, T, Container>::get_range(OT offset) const
 {
 	{
 		shared_lock lock_guard(lgi_mutex);
@@ -336,7 +344,7 @@ template<typename OT, typename T> typename REHex::RangeMap<OT, T>::const_iterato
 	return end();
 }
 
-template<typename OT, typename T> typename REHex::RangeMap<OT, T>::const_iterator REHex::RangeMap<OT, T>::get_range_in(OT offset, OT length) const
+template<typename OT, typename T, template<typename...> class Container> typename REHex::RangeMap<OT, T, Container>::const_iterator REHex::RangeMap<OT, T, Container>::get_range_in(OT offset, OT length) const
 {
 	if(length <= 0)
 	{
@@ -368,7 +376,7 @@ template<typename OT, typename T> typename REHex::RangeMap<OT, T>::const_iterato
 	return ranges.end();
 }
 
-template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_range(OT offset, OT length, const T &value)
+template<typename OT, typename T, template<typename...> class Container> void REHex::RangeMap<OT, T, Container>::set_range(OT offset, OT length, const T &value)
 {
 	PROFILE_BLOCK("REHex::RangeMap::set_range()");
 	
@@ -384,8 +392,8 @@ template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_range(OT offs
 	/* Starting from the first element after us (or the end of the vector)... */
 	auto next = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(Range((offset + length), 0), default_value), &elem_key_less);
 	
-	typename std::vector< std::pair<Range, T> >::iterator erase_begin = next;
-	typename std::vector< std::pair<Range, T> >::iterator erase_end   = next;
+	typename Container< std::pair<Range, T> >::iterator erase_begin = next;
+	typename Container< std::pair<Range, T> >::iterator erase_end   = next;
 	
 	std::vector< std::pair<Range, T> > insert_before;
 	std::vector< std::pair<Range, T> > insert_after;
@@ -506,89 +514,168 @@ template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_range(OT offs
 	last_get_iter = ranges.end();
 }
 
-template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_bulk(std::vector< std::pair<Range, T> > &&bulk_ranges)
+template<typename OT, typename T, template<typename...> class Container> void REHex::RangeMap<OT, T, Container>::set_bulk(std::vector< std::pair<Range, T> > &&bulk_ranges)
 {
-	/* Work backwards from the end of bulk_ranges, removing any earlier overlaps. */
+	PROFILE_BLOCK("REHex::RangeMap::set_bulk()");
+	
+	bool in_order = true;
+	
+	for(size_t i = 1; i < bulk_ranges.size() && in_order; ++i)
+	{
+		const Range &prev = bulk_ranges[i - 1].first;
+		in_order = (prev.offset + prev.length) <= bulk_ranges[i].first.offset;
+	}
 	
-	RangeSet<OT> seen_ranges;
-	for(auto it = bulk_ranges.end(); it != bulk_ranges.begin();)
+	if(!in_order)
 	{
-		--it;
+		/* Work backwards from the end of bulk_ranges, keeping only the parts of each range
+		 * which aren't overwritten by a later one.
+		*/
 		
-		OT range_off = it->first.offset;
-		OT range_len = it->first.length;
+		std::vector< std::pair<Range, T> > deduped;
+		deduped.reserve(bulk_ranges.size());
 		
-		auto collision = seen_ranges.find_last_in(range_off, range_len);
-		if(collision != seen_ranges.end())
+		RangeSet<OT> seen_ranges;
+		for(auto it = bulk_ranges.rbegin(); it != bulk_ranges.rend(); ++it)
 		{
-			OT collision_end = collision->offset + collision->length;
+			OT range_off = it->first.offset;
+			OT range_len = it->first.length;
 			OT range_end = range_off + range_len;
 			
-			if(range_end > collision_end && range_off < collision->offset)
+			if(range_len <= 0)
 			{
-				/* Collision is in the middle of the range to be set.
-				 * Split this range in two around the collision.
-				*/
-				
-				it = bulk_ranges.emplace(it, Range(range_off, (collision->offset - range_off)), it->second);
-				++it;
-				
-				it->first.offset = collision_end;
-				it->first.length = range_end - collision_end;
+				continue;
 			}
-			else if(range_end > collision_end)
+			
+			OT next_off = range_off;
+			
+			for(auto collision = seen_ranges.find_first_in(range_off, range_len);
+				collision != seen_ranges.end() && collision->offset < range_end;
+				++collision)
 			{
-				/* Collision is from the beginning of the range.
-				 * Move the range up to the end of the collision.
-				*/
+				if(collision->offset > next_off)
+				{
+					deduped.emplace_back(Range(next_off, (collision->offset - next_off)), it->second);
+				}
 				
-				it->first.offset = collision_end;
-				it->first.length = range_end - collision_end;
+				next_off = std::max<OT>(next_off, (collision->offset + collision->length));
 			}
-			else if(range_off < collision->offset)
+			
+			if(next_off < range_end)
 			{
-				/* Collision is to the end of the range.
-				 * Truncate the range up to the collision.
-				*/
-				
-				it->first.length = collision->offset - range_off;
+				deduped.emplace_back(Range(next_off, (range_end - next_off)), it->second);
 			}
-			else{
-				/* Collision entirely encompasses the range.
-				 * Discard the range.
-				*/
-				
-				it = bulk_ranges.erase(it);
-				continue;
-			}
-		}
-		else{
-			/* No collision found. */
+			
+			seen_ranges.set_range(range_off, range_len);
 		}
 		
-		assert(!(seen_ranges.isset_any(it->first.offset, it->first.length)));
-		seen_ranges.set_range(it->first.offset, it->first.length);
+		bulk_ranges = std::move(deduped);
+		
+		/* Sort bulk_ranges by its elements offsets. There should be no overlaps at this point. */
+		
+		std::sort(bulk_ranges.begin(), bulk_ranges.end(), [](const std::pair<Range, T> &a, const std::pair<Range, T> &b)
+		{
+			return a.first.offset < b.first.offset;
+		});
 	}
+			
+	/* bulk_ranges is now in order with no overlaps, so we can build the new vector by merging
+	 * it with the existing ranges in a single pass, rather than searching for and inserting
+	 * each range in turn.
+	*/
+	
+	Container< std::pair<Range, T> > merged;
+	merged.reserve(ranges.size() + bulk_ranges.size());
+	
+	auto push = [&merged](OT offset, OT length, const T &value)
+	{
+		if(length <= 0)
+		{
+			return;
+		}
+		
+		if(!merged.empty()
+			&& (merged.back().first.offset + merged.back().first.length) == offset
+			&& merged.back().second == value)
+		{
+			/* Adjacent to the previous range with the same value, merge them. */
+			merged.back().first.length += length;
+		}
+		else{
+			merged.emplace_back(Range(offset, length), value);
+		}
+	};
 	
-	/* Sort bulk_ranges by its elements offsets. There should be no overlaps at this point. */
+	/* The existing range being copied and the offset of the part not yet copied. */
+	auto e = ranges.begin();
+	OT e_off = e != ranges.end() ? e->first.offset : OT();
 	
-	std::sort(bulk_ranges.begin(), bulk_ranges.end(), [](const std::pair<Range, T> &a, const std::pair<Range, T> &b)
+	auto next_e = [&]()
 	{
-		return a.first.offset < b.first.offset;
-	});
+		++e;
+		
+		if(e != ranges.end())
+		{
+			e_off = e->first.offset;
+		}
+	};
 	
-	/* Call set_range() for each range in order. There are further optimisations that could
-	 * probably be made here, but just ensuring elements are inserted sequentially already nets
-	 * a significant performance boost when populating large sets.
-	*/
+	for(auto b = bulk_ranges.begin(); b != bulk_ranges.end(); ++b)
+	{
+		if(b->first.length <= 0)
+		{
+			continue;
+		}
+		
+		OT b_off = b->first.offset;
+		OT b_end = b->first.offset + b->first.length;
+		
+		/* Copy any existing ranges (or parts of) before this one... */
+		
+		while(e != ranges.end() && e_off < b_off)
+		{
+			OT e_end = e->first.offset + e->first.length;
+			
+			push(e_off, (std::min(e_end, b_off) - e_off), e->second);
+			
+			if(e_end > b_off)
+			{
+				e_off = b_off;
+				break;
+			}
+			
+			next_e();
+		}
+		
+		push(b_off, b->first.length, b->second);
+		
+		/* ...and skip over any which are replaced by it. */
+		
+		while(e != ranges.end())
+		{
+			OT e_end = e->first.offset + e->first.length;
+			
+			if(e_end <= b_end)
+			{
+				next_e();
+			}
+			else{
+				e_off = std::max(e_off, b_end);
+				break;
+			}
+		}
+	}
 	
-	for(auto it = bulk_ranges.begin(); it != bulk_ranges.end(); ++it)
+	for(; e != ranges.end(); next_e())
 	{
-		set_range(it->first.offset, it->first.length, it->second);
+		push(e_off, ((e->first.offset + e->first.length) - e_off), e->second);
 	}
+	
+	ranges = std::move(merged);
+	last_get_iter = ranges.end();
 }
 
-template<typename OT, typename T> void REHex::RangeMap<OT, T>::clear_range(OT offset, OT length)
+template<typename OT, typename T, template<typename...> class Container> void REHex::RangeMap<OT, T, Container>::clear_range(OT offset, OT length)
 {
 	if(length <= 0)
 	{
@@ -602,8 +689,8 @@ template<typename OT, typename T> void REHex::RangeMap<OT, T>::clear_range(OT of
 	/* Starting from the first element after us (or the end of the vector)... */
 	auto next = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(Range((offset + length), 0), default_value), &elem_key_less);
 	
-	typename std::vector< std::pair<Range, T> >::iterator erase_begin = next;
-	typename std::vector< std::pair<Range, T> >::iterator erase_end   = next;
+	typename Container< std::pair<Range, T> >::iterator erase_begin = next;
+	typename Container< std::pair<Range, T> >::iterator erase_end   = next;
 	
 	std::vector< std::pair<Range, T> > insert_before;
 	std::vector< std::pair<Range, T> > insert_after;
@@ -666,11 +753,11 @@ template<typename OT, typename T> void REHex::RangeMap<OT, T>::clear_range(OT of
 	last_get_iter = ranges.end();
 }
 
-template<typename OT, typename T> REHex::RangeMap<OT, T> REHex::RangeMap<OT, T>::get_slice(OT offset, OT length) const
+template<typename OT, typename T, template<typename...> class Container> REHex::RangeMap<OT, T, Container> REHex::RangeMap<OT, T, Container>::get_slice(OT offset, OT length) const
 {
 	OT end = offset + length;
 	
-	RangeMap<OT, T> slice;
+	RangeMap<OT, T, Container> slice;
 	
 	for(auto i = get_range_in(offset, length); i != this->end() && i->first.offset < end; ++i)
 	{
@@ -683,7 +770,7 @@ template<typename OT, typename T> REHex::RangeMap<OT, T> REHex::RangeMap<OT, T>:
 	return slice;
 }
 
-template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_slice(const RangeMap<OT, T> &slice)
+template<typename OT, typename T, template<typename...> class Container> void REHex::RangeMap<OT, T, Container>::set_slice(const RangeMap<OT, T, Container> &slice)
 {
 	for(auto i = slice.begin(); i != slice.end(); ++i)
 	{
@@ -691,7 +778,7 @@ template<typename OT, typename T> void REHex::RangeMap<OT, T>::set_slice(const R
 	}
 }
 
-template<typename OT, typename T> REHex::RangeMap<OT, T> &REHex::RangeMap<OT, T>::transform(const std::function<T(const T &value)> &func)
+template<typename OT, typename T, template<typename...> class Container> REHex::RangeMap<OT, T, Container> &REHex::RangeMap<OT, T, Container>::transform(const std::function<T(const T &value)> &func)
 {
 	for(auto i = ranges.begin(); i != ranges.end(); ++i)
 	{
@@ -701,7 +788,7 @@ template<typename OT, typename T> REHex::RangeMap<OT, T> &REHex::RangeMap<OT, T>
 	return *this;
 }
 
-template<typename OT, typename T> bool REHex::RangeMap<OT, T>::data_inserted_impl(OT offset, OT length)
+template<typename OT, typename T, template<typename...> class Container> bool REHex::RangeMap<OT, T, Container>::data_inserted_impl(OT offset, OT length)
 {
 	std::mutex lock;
 	std::vector< std::pair<Range, T> > insert_elem;
@@ -711,10 +798,10 @@ template<typename OT, typename T> bool REHex::RangeMap<OT, T>::data_inserted_imp
 	
 	auto process_block = [&](size_t work_base, size_t work_length)
 	{
-		for(size_t i = work_base; i < (work_base + work_length); ++i)
+		auto range = std::next(ranges.begin(), work_base);
+		
+		for(size_t i = work_base; i < (work_base + work_length); ++i, ++range)
 		{
-			std::pair<Range, T> *range = &(ranges[i]);
-			
 			if(range->first.offset >= offset)
 			{
 				/* Range begins after the insertion point, offset it. */
@@ -794,14 +881,14 @@ template<typename OT, typename T> bool REHex::RangeMap<OT, T>::data_inserted_imp
 	return elements_changed;
 }
 
-template<typename OT, typename T> bool REHex::RangeMap<OT, T>::data_erased_impl(OT offset, OT length)
+template<typename OT, typename T, template<typename...> class Container> bool REHex::RangeMap<OT, T, Container>::data_erased_impl(OT offset, OT length)
 {
 	/* Find the range of elements overlapping the range to be erased. */
 	
 	auto next = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(Range((offset + length), 0), default_value), &elem_key_less);
 	
-	typename std::vector< std::pair<Range, T> >::iterator erase_begin = next;
-	typename std::vector< std::pair<Range, T> >::iterator erase_end   = next;
+	typename Container< std::pair<Range, T> >::iterator erase_begin = next;
+	typename Container< std::pair<Range, T> >::iterator erase_end   = next;
 	
 	while(erase_begin != ranges.begin())
 	{
@@ -881,7 +968,7 @@ template<typename OT, typename T> bool REHex::RangeMap<OT, T>::data_erased_impl(
 	return elements_changed;
 }
 
-template<typename OT, typename T> bool REHex::RangeMap<OT, T>::elem_key_less(const std::pair<Range, T> &a, const std::pair<Range, T> &b)
+template<typename OT, typename T, template<typename...> class Container> bool REHex::RangeMap<OT, T, Container>::elem_key_less(const std::pair<Range, T> &a, const std::pair<Range, T> &b)
 {
 	return a.first < b.first;
 }
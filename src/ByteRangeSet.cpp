@@ -28,17 +28,24 @@
 static const long long INT61_MIN = -0x1000000000000000LL;
 static const long long INT61_MAX = 0xFFFFFFFFFFFFFFFLL;
 
-template<> off_t REHex::RangeSet<off_t>::MAX()
+template<typename OT> static OT range_set_max();
+
+template<> off_t range_set_max<off_t>()
 {
 	return std::numeric_limits<off_t>::max();
 }
 
-template<> REHex::BitOffset REHex::RangeSet<REHex::BitOffset>::MAX()
+template<> REHex::BitOffset range_set_max<REHex::BitOffset>()
+{
+	return REHex::BitOffset(INT61_MAX, 7);
+}
+
+template<typename OT, template<typename...> class Container> OT REHex::RangeSet<OT, Container>::MAX()
 {
-	return BitOffset(INT61_MAX, 7);
+	return range_set_max<OT>();
 }
 
-template<typename OT> REHex::RangeSet<OT> &REHex::RangeSet<OT>::set_range(OT offset, OT length)
+template<typename OT, template<typename...> class Container> REHex::RangeSet<OT, Container> &REHex::RangeSet<OT, Container>::set_range(OT offset, OT length)
 {
 	if(length <= 0)
 	{
@@ -51,7 +58,7 @@ template<typename OT> REHex::RangeSet<OT> &REHex::RangeSet<OT>::set_range(OT off
 	return *this;
 }
 
-template<typename OT> void REHex::RangeSet<OT>::clear_range(OT offset, OT length)
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::clear_range(OT offset, OT length)
 {
 	if(length <= 0)
 	{
@@ -62,12 +69,12 @@ template<typename OT> void REHex::RangeSet<OT>::clear_range(OT offset, OT length
 	clear_ranges(&range, (&range) + 1);
 }
 
-template<typename OT> void REHex::RangeSet<OT>::clear_all()
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::clear_all()
 {
 	ranges.clear();
 }
 
-template<typename OT> bool REHex::RangeSet<OT>::isset(OT offset, OT length) const
+template<typename OT, template<typename...> class Container> bool REHex::RangeSet<OT, Container>::isset(OT offset, OT length) const
 {
 	auto lb = std::lower_bound(ranges.begin(), ranges.end(), Range(offset, 0));
 	
@@ -88,17 +95,17 @@ template<typename OT> bool REHex::RangeSet<OT>::isset(OT offset, OT length) cons
 	return false;
 }
 
-template<typename OT> bool REHex::RangeSet<OT>::isset_any(OT offset, OT length) const
+template<typename OT, template<typename...> class Container> bool REHex::RangeSet<OT, Container>::isset_any(OT offset, OT length) const
 {
-	RangeSet<OT> check;
+	RangeSet<OT, Container> check;
 	check.set_range(offset, length);
 	
-	RangeSet<OT> i = intersection(*this, check);
+	RangeSet<OT, Container> i = intersection(*this, check);
 	
 	return !i.empty();
 }
 
-template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeSet<OT>::find_first_in(OT offset, OT length) const
+template<typename OT, template<typename...> class Container> typename REHex::RangeSet<OT, Container>::const_iterator REHex::RangeSet<OT, Container>::find_first_in(OT offset, OT length) const
 {
 	auto i = std::lower_bound(ranges.begin(), ranges.end(), Range(offset, 0));
 	
@@ -125,7 +132,7 @@ template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeS
 	return ranges.end();
 }
 
-template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeSet<OT>::find_last_in(OT offset, OT length) const
+template<typename OT, template<typename...> class Container> typename REHex::RangeSet<OT, Container>::const_iterator REHex::RangeSet<OT, Container>::find_last_in(OT offset, OT length) const
 {
 	auto i = find_first_in((offset + length), MAX());
 	
@@ -151,7 +158,7 @@ template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeS
 	return ranges.end();
 }
 
-template<typename OT> OT REHex::RangeSet<OT>::total_bytes() const
+template<typename OT, template<typename...> class Container> OT REHex::RangeSet<OT, Container>::total_bytes() const
 {
 	OT total_bytes = std::accumulate(ranges.begin(), ranges.end(),
 		(OT)(0), [](OT sum, const Range &range) { return sum + range.length; });
@@ -159,38 +166,38 @@ template<typename OT> OT REHex::RangeSet<OT>::total_bytes() const
 	return total_bytes;
 }
 
-template<typename OT> const std::vector<typename REHex::RangeSet<OT>::Range> &REHex::RangeSet<OT>::get_ranges() const
+template<typename OT, template<typename...> class Container> const Container<typename REHex::RangeSet<OT, Container>::Range> &REHex::RangeSet<OT, Container>::get_ranges() const
 {
 	return ranges;
 }
 
-template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeSet<OT>::begin() const
+template<typename OT, template<typename...> class Container> typename REHex::RangeSet<OT, Container>::const_iterator REHex::RangeSet<OT, Container>::begin() const
 {
 	return ranges.begin();
 }
 
-template<typename OT> typename REHex::RangeSet<OT>::const_iterator REHex::RangeSet<OT>::end() const
+template<typename OT, template<typename...> class Container> typename REHex::RangeSet<OT, Container>::const_iterator REHex::RangeSet<OT, Container>::end() const
 {
 	return ranges.end();
 }
 
-template<typename OT> const typename REHex::RangeSet<OT>::Range &REHex::RangeSet<OT>::operator[](size_t idx) const
+template<typename OT, template<typename...> class Container> const typename REHex::RangeSet<OT, Container>::Range &REHex::RangeSet<OT, Container>::operator[](size_t idx) const
 {
 	assert(idx < ranges.size());
 	return ranges[idx];
 }
 
-template<typename OT> size_t REHex::RangeSet<OT>::size() const
+template<typename OT, template<typename...> class Container> size_t REHex::RangeSet<OT, Container>::size() const
 {
 	return ranges.size();
 }
 
-template<typename OT> bool REHex::RangeSet<OT>::empty() const
+template<typename OT, template<typename...> class Container> bool REHex::RangeSet<OT, Container>::empty() const
 {
 	return ranges.empty();
 }
 
-template<typename OT> void REHex::RangeSet<OT>::data_inserted_impl(OT offset, OT length)
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::data_inserted_impl(OT offset, OT length)
 {
 	REHEX_BYTERANGESET_CHECK_PRE(ranges.begin(), ranges.end());
 	
@@ -200,10 +207,10 @@ template<typename OT> void REHex::RangeSet<OT>::data_inserted_impl(OT offset, OT
 	
 	auto process_block = [&](size_t work_base, size_t work_length)
 	{
-		for(size_t i = work_base; i < (work_base + work_length); ++i)
+		auto range = std::next(ranges.begin(), work_base);
+		
+		for(size_t i = work_base; i < (work_base + work_length); ++i, ++range)
 		{
-			Range *range = &(ranges[i]);
-			
 			if(range->offset >= offset)
 			{
 				/* Range begins after the insertion point, offset it. */
@@ -277,17 +284,12 @@ template<typename OT> void REHex::RangeSet<OT>::data_inserted_impl(OT offset, OT
 	REHEX_BYTERANGESET_CHECK_POST(ranges.begin(), ranges.end());
 }
 
-template<> void REHex::RangeSet<off_t>::data_inserted(off_t offset, off_t length)
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::data_inserted(off_t offset, off_t length)
 {
-	data_inserted_impl(offset, length);
+	data_inserted_impl(OT(offset), OT(length));
 }
 
-template<> void REHex::RangeSet<REHex::BitOffset>::data_inserted(off_t offset, off_t length)
-{
-	data_inserted_impl(BitOffset(offset, 0), BitOffset(length, 0));
-}
-
-template<typename OT> void REHex::RangeSet<OT>::data_erased_impl(OT offset, OT length)
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::data_erased_impl(OT offset, OT length)
 {
 	REHEX_BYTERANGESET_CHECK_PRE(ranges.begin(), ranges.end());
 	
@@ -295,8 +297,8 @@ template<typename OT> void REHex::RangeSet<OT>::data_erased_impl(OT offset, OT l
 	
 	auto next = std::lower_bound(ranges.begin(), ranges.end(), Range((offset + length + 1), 0));
 	
-	typename std::vector<Range>::iterator erase_begin = next;
-	typename std::vector<Range>::iterator erase_end   = next;
+	typename Container<Range>::iterator erase_begin = next;
+	typename Container<Range>::iterator erase_end   = next;
 	
 	while(erase_begin != ranges.begin())
 	{
@@ -349,24 +351,19 @@ template<typename OT> void REHex::RangeSet<OT>::data_erased_impl(OT offset, OT l
 	REHEX_BYTERANGESET_CHECK_POST(ranges.begin(), ranges.end());
 }
 
-template<> void REHex::RangeSet<off_t>::data_erased(off_t offset, off_t length)
-{
-	data_erased_impl(offset, length);
-}
-
-template<> void REHex::RangeSet<REHex::BitOffset>::data_erased(off_t offset, off_t length)
+template<typename OT, template<typename...> class Container> void REHex::RangeSet<OT, Container>::data_erased(off_t offset, off_t length)
 {
-	data_erased_impl(BitOffset(offset, 0), BitOffset(length, 0));
+	data_erased_impl(OT(offset), OT(length));
 }
 
-template<typename OT> REHex::RangeSet<OT> REHex::RangeSet<OT>::intersection(const RangeSet<OT> &a, const RangeSet<OT> &b)
+template<typename OT, template<typename...> class Container> REHex::RangeSet<OT, Container> REHex::RangeSet<OT, Container>::intersection(const RangeSet<OT, Container> &a, const RangeSet<OT, Container> &b)
 {
 	if(a.empty() || b.empty())
 	{
-		return RangeSet<OT>();
+		return RangeSet<OT, Container>();
 	}
 	
-	RangeSet<OT> intersection;
+	RangeSet<OT, Container> intersection;
 	
 	auto ai = a.begin();
 	auto bi = b.begin();
@@ -417,6 +414,10 @@ template<typename OT> REHex::RangeSet<OT> REHex::RangeSet<OT>::intersection(cons
 template class REHex::RangeSet<off_t>;
 template class REHex::RangeSet<REHex::BitOffset>;
 
+/* Instantiate ChunkedByteRangeSet and ChunkedBitRangeSet methods. */
+template class REHex::RangeSet<off_t, REHex::ChunkedVector>;
+template class REHex::RangeSet<REHex::BitOffset, REHex::ChunkedVector>;
+
 template<typename OT> REHex::OrderedRangeSet<OT> &REHex::OrderedRangeSet<OT>::set_range(OT offset, OT length)
 {
 	/* Exclude any ranges already set from the offset/length so we can push exclusive ranges
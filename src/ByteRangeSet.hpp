@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "BitOffset.hpp"
+#include "ChunkedVector.hpp"
 #include "MathUtils.hpp"
 
 #ifdef MAX
@@ -80,8 +81,13 @@ namespace REHex
 	 * This class is a wrapper around std::vector that can be used for efficiently storing
 	 * ranges. Any ranges which are adjacent or overlapping will be merged to reduce memory
 	 * consumption, so only each unique contiguous range added will take space in memory.
+	 *
+	 * The Container parameter selects the underlying sequence. Setting or clearing ranges in
+	 * the middle of a std::vector moves every range after it, which gets slow once the set
+	 * holds hundreds of thousands of disjoint ranges - use ChunkedVector (see
+	 * ChunkedByteRangeSet) for sets which may grow that large and are modified anywhere.
 	*/
-	template<typename OT> class RangeSet
+	template<typename OT, template<typename...> class Container = std::vector> class RangeSet
 	{
 		public:
 			/**
@@ -114,11 +120,11 @@ namespace REHex
 			
 			static OT MAX();
 			
-			typedef typename std::vector<Range>::iterator iterator;
-			typedef typename std::vector<Range>::const_iterator const_iterator;
+			typedef typename Container<Range>::iterator iterator;
+			typedef typename Container<Range>::const_iterator const_iterator;
 			
 		private:
-			std::vector<Range> ranges;
+			Container<Range> ranges;
 			
 		public:
 			/**
@@ -134,7 +140,7 @@ namespace REHex
 			template<typename T> RangeSet(const T begin, const T end):
 				ranges(begin, end) {}
 			
-			bool operator==(const RangeSet<OT> &rhs) const
+			bool operator==(const RangeSet<OT, Container> &rhs) const
 			{
 				return ranges == rhs.ranges;
 			}
@@ -148,7 +154,7 @@ namespace REHex
 			 *
 			 * Returns a reference to the set to allow for chaining.
 			*/
-			RangeSet<OT> &set_range(OT offset, OT length);
+			RangeSet<OT, Container> &set_range(OT offset, OT length);
 			
 			/**
 			 * @brief Set multiple ranges of bytes in the set.
@@ -203,13 +209,13 @@ namespace REHex
 			
 			/**
 			 * @brief Find the first Range that intersects the given range.
-			 * @return An iterator into the internal vector, or end.
+			 * @return An iterator into the internal container, or end.
 			*/
 			const_iterator find_first_in(OT offset, OT length) const;
 			
 			/**
 			 * @brief Find the last Range that intersects the given range.
-			 * @return An iterator into the internal vector, or end.
+			 * @return An iterator into the internal container, or end.
 			*/
 			const_iterator find_last_in(OT offset, OT length) const;
 			
@@ -219,9 +225,9 @@ namespace REHex
 			OT total_bytes() const;
 			
 			/**
-			 * @brief Get a reference to the internal std::vector.
+			 * @brief Get a reference to the internal container.
 			*/
-			const std::vector<Range> &get_ranges() const;
+			const Container<Range> &get_ranges() const;
 			
 			/**
 			 * @brief Returns a const_iterator to the first Range in the set.
@@ -283,14 +289,27 @@ namespace REHex
 			/**
 			 * @brief Find the intersection of two sets.
 			 *
-			 * Returns a RangeSet<OT> containing only the ranges of bytes which are set
-			 * in BOTH sets.
+			 * Returns a RangeSet containing only the ranges of bytes which are set in
+			 * BOTH sets.
 			*/
-			static RangeSet<OT> intersection(const RangeSet<OT> &a, const RangeSet<OT> &b);
+			static RangeSet<OT, Container> intersection(const RangeSet<OT, Container> &a, const RangeSet<OT, Container> &b);
 			
 			#ifndef NDEBUG
 			template<typename T> static bool dbg_check_order(T begin, T end);
 			template<typename T> static void dbg_dump(T begin, T end);
+			
+		private:
+			static void dbg_dump_range(off_t offset, off_t length)
+			{
+				fprintf(stderr, "{ offset = %lld, length = %lld }\n", (long long)(offset), (long long)(length));
+			}
+			
+			static void dbg_dump_range(const BitOffset &offset, const BitOffset &length)
+			{
+				fprintf(stderr, "{ offset = %lld.%d, length = %lld.%d }\n",
+					(long long)(offset.byte()), offset.bit(),
+					(long long)(length.byte()), length.bit());
+			}
 			#endif
 			
 		private:
@@ -301,6 +320,9 @@ namespace REHex
 	using ByteRangeSet = RangeSet<off_t>;
 	using BitRangeSet = RangeSet<BitOffset>;
 	
+	using ChunkedByteRangeSet = RangeSet<off_t, ChunkedVector>;
+	using ChunkedBitRangeSet = RangeSet<BitOffset, ChunkedVector>;
+	
 	/**
 	 * @brief Variant of RangeSet that preserves insertion order of ranges.
 	 *
@@ -390,7 +412,7 @@ namespace REHex
 }
 
 #ifndef NDEBUG
-template<typename OT> template<typename T> bool REHex::RangeSet<OT>::dbg_check_order(T begin, T end)
+template<typename OT, template<typename...> class Container> template<typename T> bool REHex::RangeSet<OT, Container>::dbg_check_order(T begin, T end)
 {
 	for(auto r = begin; r != end; ++r)
 	{
@@ -403,26 +425,16 @@ template<typename OT> template<typename T> bool REHex::RangeSet<OT>::dbg_check_o
 	return true;
 }
 
-template<> template<typename T> void REHex::RangeSet<off_t>::dbg_dump(T begin, T end)
-{
-	for(auto r = begin; r != end; ++r)
-	{
-		fprintf(stderr, "{ offset = %lld, length = %lld }\n", (long long)(r->offset), (long long)(r->length));
-	}
-}
-
-template<> template<typename T> void REHex::RangeSet<REHex::BitOffset>::dbg_dump(T begin, T end)
+template<typename OT, template<typename...> class Container> template<typename T> void REHex::RangeSet<OT, Container>::dbg_dump(T begin, T end)
 {
 	for(auto r = begin; r != end; ++r)
 	{
-		fprintf(stderr, "{ offset = %lld.%d, length = %lld.%d }\n",
-			(long long)(r->offset.byte()), r->offset.bit(),
-			(long long)(r->length.byte()), r->length.bit());
+		dbg_dump_range(r->offset, r->length);
 	}
 }
 #endif
 
-template<typename OT> template<typename T> void REHex::RangeSet<OT>::set_ranges(const T begin, const T end, size_t size_hint)
+template<typename OT, template<typename...> class Container> template<typename T> void REHex::RangeSet<OT, Container>::set_ranges(const T begin, const T end, size_t size_hint)
 {
 	REHEX_BYTERANGESET_CHECK_PRE(ranges.begin(), ranges.end());
 	
@@ -447,8 +459,8 @@ template<typename OT> template<typename T> void REHex::RangeSet<OT>::set_ranges(
 	 * and group_erase_end iterators encompass the full range of adjacent elements to be erased
 	 * from sequential inserts and group_ranges contains all adjacent elements to be inserted.
 	*/
-	typename std::vector<Range>::iterator group_erase_begin;
-	typename std::vector<Range>::iterator group_erase_end;
+	typename Container<Range>::iterator group_erase_begin;
+	typename Container<Range>::iterator group_erase_end;
 	typename std::vector<Range> group_ranges;
 	
 	for(auto r = begin; r != end;)
@@ -464,8 +476,8 @@ template<typename OT> template<typename T> void REHex::RangeSet<OT>::set_ranges(
 		
 		next = std::lower_bound(next, ranges.end(), Range((offset + length), 0));
 		
-		typename std::vector<Range>::iterator erase_begin = next;
-		typename std::vector<Range>::iterator erase_end   = next;
+		typename Container<Range>::iterator erase_begin = next;
+		typename Container<Range>::iterator erase_end   = next;
 		
 		while(erase_begin != ranges.begin())
 		{
@@ -554,7 +566,7 @@ template<typename OT> template<typename T> void REHex::RangeSet<OT>::set_ranges(
 	REHEX_BYTERANGESET_CHECK_POST(ranges.begin(), ranges.end());
 }
 
-template<typename OT> template<typename T> void REHex::RangeSet<OT>::clear_ranges(const T begin, const T end)
+template<typename OT, template<typename...> class Container> template<typename T> void REHex::RangeSet<OT, Container>::clear_ranges(const T begin, const T end)
 {
 	REHEX_BYTERANGESET_CHECK_PRE(ranges.begin(), ranges.end());
 	
@@ -568,8 +580,8 @@ template<typename OT> template<typename T> void REHex::RangeSet<OT>::clear_range
 	 * from sequential inserts and group_replacements contains all adjacent ranges to be
 	 * re-inserted at the same position.
 	*/
-	typename std::vector<Range>::iterator group_erase_begin = ranges.end();
-	typename std::vector<Range>::iterator group_erase_end   = ranges.end();
+	typename Container<Range>::iterator group_erase_begin = ranges.end();
+	typename Container<Range>::iterator group_erase_end   = ranges.end();
 	typename std::vector<Range> group_replacements;
 	
 	for(auto r = begin; r != end;)
@@ -583,8 +595,8 @@ template<typename OT> template<typename T> void REHex::RangeSet<OT>::clear_range
 		
 		next = std::lower_bound(next, ranges.end(), Range(add_clamp_overflow(offset, length), 0));
 		
-		typename std::vector<Range>::iterator erase_begin = next;
-		typename std::vector<Range>::iterator erase_end   = next;
+		typename Container<Range>::iterator erase_begin = next;
+		typename Container<Range>::iterator erase_end   = next;
 		
 		while(erase_begin != ranges.begin())
 		{
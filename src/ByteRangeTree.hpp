@@ -22,8 +22,11 @@
 #include <assert.h>
 #include <functional>
 #include <memory>
+#include <new>
 #include <set>
 #include <stdlib.h>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "BitOffset.hpp"
@@ -76,6 +79,10 @@ namespace REHex
 	 *
 	 * Unless otherwise noted, iterators and Node* pointers obtained from this class are stable
 	 * and will not be invalidated by modifications to other elements.
+	 *
+	 * Nodes are allocated from a pool owned by the tree rather than individually, so
+	 * building a large tree doesn't hammer the allocator and nodes created together (e.g.
+	 * by the copy or bulk constructors) are laid out in depth-first order in memory.
 	*/
 	template<typename OT, typename T> class RangeTree
 	{
@@ -211,14 +218,14 @@ namespace REHex
 					{
 						return children.empty()
 							? NULL
-							: children.front().node.get();
+							: children.front().node;
 					}
 					
 					const Node *get_first_child() const
 					{
 						return children.empty()
 							? NULL
-							: children.front().node.get();
+							: children.front().node;
 					}
 					
 					/**
@@ -229,25 +236,31 @@ namespace REHex
 					{
 						return children.empty()
 							? NULL
-							: children.back().node.get();
+							: children.back().node;
 					}
 					
 					const Node *get_last_child() const
 					{
 						return children.empty()
 							? NULL
-							: children.back().node.get();
+							: children.back().node;
 					}
 			};
 			
 		private:
+			/**
+			 * @brief Sorted reference to a Node within a parent's list of children.
+			 *
+			 * The Node itself is owned by the tree's NodePool and must be released
+			 * using free_node() when removed from the tree.
+			*/
 			struct NodeRef
 			{
 				RangeTreeKey<OT> key;
-				std::unique_ptr<Node> node;
+				Node *node;
 				
 				NodeRef(OT offset, OT length):
-					key(offset, length) {}
+					key(offset, length), node(NULL) {}
 				
 				NodeRef(const RangeTreeKey<OT> &key, Node *node = NULL):
 					key(key), node(node) {}
@@ -260,13 +273,13 @@ namespace REHex
 				operator Node*() const
 				{
 					assert(node);
-					return node.get();
+					return node;
 				}
 				
 				Node* operator->() const
 				{
 					assert(node);
-					return node.get();
+					return node;
 				}
 				
 				static bool offset_lt(const NodeRef &lhs, const NodeRef &rhs)
@@ -280,9 +293,147 @@ namespace REHex
 				}
 			};
 			
+			/**
+			 * @brief Pool of storage for Node objects.
+			 *
+			 * Storage is allocated in slabs which grow geometrically up to
+			 * MAX_SLAB_NODES, so Node pointers remain stable. Released slots
+			 * are kept on a free list for reuse and the slabs are only returned
+			 * to the system by clear() or when the pool is destroyed.
+			*/
+			class NodePool
+			{
+				private:
+					typedef typename std::aligned_storage<sizeof(Node), alignof(Node)>::type Slot;
+					
+					static const size_t MIN_SLAB_NODES = 16;
+					static const size_t MAX_SLAB_NODES = 4096;
+					
+					std::vector< std::unique_ptr<Slot[]> > slabs;
+					size_t next_slab_nodes;
+					size_t total_slots;
+					
+					Slot *slab_next;  /**< Next never-used slot in the newest slab. */
+					Slot *slab_end;
+					
+					Slot *free_list;  /**< Released slots, linked through their first bytes. */
+					
+				public:
+					NodePool():
+						next_slab_nodes(MIN_SLAB_NODES),
+						total_slots(0),
+						slab_next(NULL),
+						slab_end(NULL),
+						free_list(NULL) {}
+					
+					NodePool(NodePool &&src):
+						NodePool()
+					{
+						swap(src);
+					}
+					
+					NodePool(const NodePool&) = delete;
+					NodePool &operator=(const NodePool&) = delete;
+					
+					void swap(NodePool &other)
+					{
+						slabs.swap(other.slabs);
+						std::swap(next_slab_nodes, other.next_slab_nodes);
+						std::swap(total_slots, other.total_slots);
+						std::swap(slab_next, other.slab_next);
+						std::swap(slab_end, other.slab_end);
+						std::swap(free_list, other.free_list);
+					}
+					
+					/**
+					 * @brief Get uninitialised storage for a Node.
+					*/
+					void *allocate()
+					{
+						if(free_list != NULL)
+						{
+							Slot *slot = free_list;
+							free_list = *(reinterpret_cast<Slot**>(slot));
+							
+							return slot;
+						}
+						
+						if(slab_next == slab_end)
+						{
+							slabs.emplace_back(new Slot[next_slab_nodes]);
+							
+							slab_next = slabs.back().get();
+							slab_end = slab_next + next_slab_nodes;
+							
+							total_slots += next_slab_nodes;
+							
+							if(next_slab_nodes < MAX_SLAB_NODES)
+							{
+								next_slab_nodes *= 2;
+							}
+						}
+						
+						return slab_next++;
+					}
+					
+					/**
+					 * @brief Return storage from allocate() to the pool.
+					 *
+					 * The Node must already have been destroyed.
+					*/
+					void deallocate(void *ptr)
+					{
+						Slot *slot = reinterpret_cast<Slot*>(ptr);
+						
+						*(reinterpret_cast<Slot**>(slot)) = free_list;
+						free_list = slot;
+					}
+					
+					/**
+					 * @brief Release all storage.
+					 *
+					 * Any Nodes in the pool must already have been destroyed.
+					*/
+					void clear()
+					{
+						slabs.clear();
+						next_slab_nodes = MIN_SLAB_NODES;
+						total_slots = 0;
+						slab_next = NULL;
+						slab_end = NULL;
+						free_list = NULL;
+					}
+					
+					/**
+					 * @brief Get the total number of Node slots allocated.
+					*/
+					size_t capacity() const
+					{
+						return total_slots;
+					}
+			};
+			
 			std::vector<NodeRef> root;
 			size_t total_size;
 			
+			NodePool pool;
+			
+			template<typename... Args> Node *alloc_node(Args&&... args)
+			{
+				void *storage = pool.allocate();
+				return new(storage) Node(std::forward<Args>(args)...);
+			}
+			
+			void free_node(Node *node)
+			{
+				node->~Node();
+				pool.deallocate(node);
+			}
+			
+			void free_recursive(Node *node);
+			void rekey_node(Node *node, OT offset, OT length);
+			void copy_children(std::vector<NodeRef> &dest, Node *dest_parent, const std::vector<NodeRef> &src);
+			
 			size_t erase_recursive_impl(Node *node);
 			
 			void check() const;
@@ -507,19 +658,70 @@ namespace REHex
 			RangeTree(const RangeTree<OT, T> &rhs):
 				total_size(0)
 			{
-				for(auto it = rhs.begin(); it != rhs.end(); ++it)
-				{
-					set(it->key.offset, it->key.length, it->value);
-				}
+				copy_children(root, NULL, rhs.root);
+				check();
 			}
 			
-			RangeTree<OT, T> &operator=(const RangeTree<OT, T> &rhs)
+			/**
+			 * @brief Move constructor.
+			 *
+			 * Node pointers from the source tree remain valid and now belong to
+			 * this one. Iterators are invalidated.
+			*/
+			RangeTree(RangeTree<OT, T> &&rhs):
+				root(std::move(rhs.root)),
+				total_size(rhs.total_size),
+				pool(std::move(rhs.pool))
+			{
+				rhs.root.clear();
+				rhs.total_size = 0;
+			}
+			
+			/**
+			 * @brief Construct a tree from a sorted sequence of elements.
+			 *
+			 * Builds the tree in a single pass from a sequence of elements with
+			 * pair-like first (key) and second (value) members, such as
+			 * std::pair<RangeTreeKey<OT>, T> or the iterators of another tree.
+			 *
+			 * The elements should be in depth-first order, i.e. ascending offset
+			 * with longer elements before shorter ones at the same offset, which
+			 * is the order they are visited when iterating over a RangeTree.
+			 *
+			 * The result is the same as calling set() for each element in turn;
+			 * elements which straddle an earlier one are skipped and repeated
+			 * keys take the later value. If an element is out of order, it and
+			 * any following elements are inserted using set() instead.
+			*/
+			template<typename I> RangeTree(I begin, I end);
+			
+			~RangeTree()
 			{
 				clear();
+			}
+			
+			RangeTree<OT, T> &operator=(const RangeTree<OT, T> &rhs)
+			{
+				if(&rhs != this)
+				{
+					clear();
 				
-				for(auto it = rhs.begin(); it != rhs.end(); ++it)
+					copy_children(root, NULL, rhs.root);
+					check();
+				}
+				
+				return *this;
+			}
+			
+			RangeTree<OT, T> &operator=(RangeTree<OT, T> &&rhs)
+			{
+				if(&rhs != this)
 				{
-					set(it->key.offset, it->key.length, it->value);
+					clear();
+					
+					root.swap(rhs.root);
+					std::swap(total_size, rhs.total_size);
+					pool.swap(rhs.pool);
 				}
 				
 				return *this;
@@ -584,10 +786,25 @@ namespace REHex
 			*/
 			void clear()
 			{
+				for(auto r = root.begin(); r != root.end(); ++r)
+				{
+					free_recursive(r->node);
+				}
+				
 				root.clear();
 				total_size = 0;
+				
+				pool.clear();
 			}
 			
+			/**
+			 * @brief Get the approximate amount of memory used by the tree.
+			 *
+			 * Counts the node pool and the arrays of child references, but not
+			 * any memory owned by the values themselves.
+			*/
+			size_t memory_usage() const;
+			
 			/**
 			 * @brief Get the first node at the root of the tree.
 			*/
@@ -595,14 +812,14 @@ namespace REHex
 			{
 				return root.empty()
 					? NULL
-					: root.front().node.get();
+					: root.front().node;
 			}
 			
 			const Node *first_root_node() const
 			{
 				return root.empty()
 					? NULL
-					: root.front().node.get();
+					: root.front().node;
 			}
 			
 			/**
@@ -612,14 +829,14 @@ namespace REHex
 			{
 				return root.empty()
 					? NULL
-					: root.back().node.get();
+					: root.back().node;
 			}
 			
 			const Node *last_root_node() const
 			{
 				return root.empty()
 					? NULL
-					: root.back().node.get();
+					: root.back().node;
 			}
 			
 			/**
@@ -880,6 +1097,168 @@ namespace REHex
 	using BitRangeTreeKey = RangeTreeKey<BitOffset>;
 }
 
+template<typename OT, typename T> template<typename I>
+REHex::RangeTree<OT, T>::RangeTree(I begin, I end):
+	total_size(0)
+{
+	/* The chain of most recently inserted nodes from the root down, which are the only
+	 * nodes a following element in depth-first order can be nested under.
+	*/
+	std::vector<Node*> open_nodes;
+	
+	RangeTreeKey<OT> prev_key((OT()), (OT()));
+	Node *prev_node = NULL;
+	bool have_prev = false;
+	
+	I i = begin;
+	
+	for(; i != end; ++i)
+	{
+		RangeTreeKey<OT> key(i->first.offset, i->first.length);
+		OT key_end = key.offset + key.length;
+		
+		if(have_prev)
+		{
+			if(key == prev_key)
+			{
+				/* Repeated key - replace the value, as set() would. */
+				
+				if(prev_node != NULL)
+				{
+					prev_node->value = i->second;
+				}
+				
+				continue;
+			}
+			else if(key.offset < prev_key.offset || (key.offset == prev_key.offset && key.length > prev_key.length))
+			{
+				/* Out of order - insert the rest the slow way. */
+				break;
+			}
+		}
+		
+		prev_key = key;
+		prev_node = NULL;
+		have_prev = true;
+		
+		/* Find the deepest open node which encompasses this one. */
+		
+		size_t depth = open_nodes.size();
+		while(depth > 0)
+		{
+			const Node *parent = open_nodes[depth - 1];
+			OT parent_end = parent->key.offset + parent->key.length;
+			
+			if(parent_end > key.offset && parent_end >= key_end)
+			{
+				break;
+			}
+			
+			--depth;
+		}
+		
+		Node *parent = depth > 0 ? open_nodes[depth - 1] : NULL;
+		std::vector<NodeRef> &container = parent != NULL ? parent->children : root;
+		
+		Node *prev_sibling = container.empty() ? NULL : container.back().node;
+		
+		if(prev_sibling != NULL && (prev_sibling->key.offset + prev_sibling->key.length) > key.offset)
+		{
+			/* We are straddling the end of another node. */
+			continue;
+		}
+		
+		Node *node = alloc_node(key.offset, key.length, i->second);
+		
+		node->parent = parent;
+		node->prev_sibling = prev_sibling;
+		
+		if(prev_sibling != NULL)
+		{
+			prev_sibling->next_sibling = node;
+		}
+		
+		container.emplace_back(key, node);
+		++total_size;
+		
+		open_nodes.resize(depth);
+		open_nodes.push_back(node);
+		
+		prev_node = node;
+	}
+	
+	check();
+	
+	for(; i != end; ++i)
+	{
+		set(i->first.offset, i->first.length, i->second);
+	}
+}
+
+template<typename OT, typename T>
+void REHex::RangeTree<OT, T>::free_recursive(Node *node)
+{
+	for(auto c = node->children.begin(); c != node->children.end(); ++c)
+	{
+		free_recursive(c->node);
+	}
+	
+	free_node(node);
+}
+
+/* Change the key of a Node without moving it, so pointers to it (and the layout of
+ * the pool) are preserved.
+*/
+template<typename OT, typename T>
+void REHex::RangeTree<OT, T>::rekey_node(Node *node, OT offset, OT length)
+{
+	Node tmp(offset, length, std::move(*node));
+	
+	node->~Node();
+	new(node) Node(offset, length, std::move(tmp));
+}
+
+template<typename OT, typename T>
+void REHex::RangeTree<OT, T>::copy_children(std::vector<NodeRef> &dest, Node *dest_parent, const std::vector<NodeRef> &src)
+{
+	dest.reserve(src.size());
+	
+	Node *prev = NULL;
+	
+	for(auto s = src.begin(); s != src.end(); ++s)
+	{
+		Node *node = alloc_node(s->key.offset, s->key.length, (*s)->value);
+		
+		node->parent = dest_parent;
+		node->prev_sibling = prev;
+		
+		if(prev != NULL)
+		{
+			prev->next_sibling = node;
+		}
+		
+		dest.emplace_back(s->key, node);
+		++total_size;
+		
+		copy_children(node->children, node, (*s)->children);
+		
+		prev = node;
+	}
+}
+
+template<typename OT, typename T>
+size_t REHex::RangeTree<OT, T>::memory_usage() const
+{
+	size_t bytes = (pool.capacity() * sizeof(Node)) + (root.capacity() * sizeof(NodeRef));
+	
+	for(auto it = begin(); it != end(); ++it)
+	{
+		bytes += it->children.capacity() * sizeof(NodeRef);
+	}
+	
+	return bytes;
+}
+
 template<typename OT, typename T>
 typename REHex::RangeTree<OT, T>::Node *REHex::RangeTree<OT, T>::find_node(const RangeTreeKey<OT> &key)
 {
@@ -1093,7 +1472,7 @@ bool REHex::RangeTree<OT, T>::set(OT offset, OT length, const T &value)
 				return false;
 			}
 			
-			n.node.reset(new Node(offset, length, value));
+			n.node = alloc_node(offset, length, value);
 			n->parent = n_parent;
 			
 			if(ia_offset == offset)
@@ -1107,7 +1486,7 @@ bool REHex::RangeTree<OT, T>::set(OT offset, OT length, const T &value)
 			}
 		}
 		else{
-			n.node.reset(new Node(offset, length, value));
+			n.node = alloc_node(offset, length, value);
 			n->parent = n_parent;
 		}
 		
@@ -1124,7 +1503,7 @@ bool REHex::RangeTree<OT, T>::set(OT offset, OT length, const T &value)
 			
 			for(auto c = consume_begin; c != consume_end; ++c)
 			{
-				(*c)->parent = n.node.get();
+				(*c)->parent = n.node;
 			}
 			
 			n->children.insert(
@@ -1152,13 +1531,13 @@ bool REHex::RangeTree<OT, T>::set(OT offset, OT length, const T &value)
 		
 		if(n->prev_sibling != NULL)
 		{
-			n->prev_sibling->next_sibling = n.node.get();
+			n->prev_sibling->next_sibling = n.node;
 		}
 		
 		if(insert_before != container->end())
 		{
 			n->next_sibling = *insert_before;
-			(*insert_before)->prev_sibling = n.node.get();
+			(*insert_before)->prev_sibling = n.node;
 		}
 		
 		container->insert(insert_before, std::move(n));
@@ -1182,7 +1561,7 @@ size_t REHex::RangeTree<OT, T>::erase(Node *node)
 	
 	auto erase_iter = std::lower_bound(container.begin(), container.end(), NodeRef(node->key), &NodeRef::key_lt);
 	assert(erase_iter != container.end());
-	assert(erase_iter->node.get() == node);
+	assert(erase_iter->node == node);
 	
 	size_t num_children = node->children.size();
 	if(num_children > 0)
@@ -1233,7 +1612,7 @@ size_t REHex::RangeTree<OT, T>::erase(Node *node)
 		
 		erase_iter = std::next(first_inserted_elem, num_children);
 		assert(erase_iter != container.end());
-		assert(erase_iter->node.get() == node);
+		assert(erase_iter->node == node);
 	}
 	else{
 		if(node->prev_sibling != NULL)
@@ -1250,6 +1629,8 @@ size_t REHex::RangeTree<OT, T>::erase(Node *node)
 	container.erase(erase_iter);
 	--total_size;
 	
+	free_node(node);
+	
 	check();
 	
 	return 1;
@@ -1258,6 +1639,14 @@ size_t REHex::RangeTree<OT, T>::erase(Node *node)
 template<typename OT, typename T>
 size_t REHex::RangeTree<OT, T>::erase_recursive_impl(Node *node)
 {
+	std::vector<NodeRef> &container = node->parent != NULL
+		? node->parent->children
+		: root;
+	
+	auto erase_iter = std::lower_bound(container.begin(), container.end(), NodeRef(node->key), &NodeRef::key_lt);
+	assert(erase_iter != container.end());
+	assert(erase_iter->node == node);
+	
 	std::function<void(Node*)> visit_node;
 	size_t total_nodes = 0;
 	
@@ -1279,20 +1668,14 @@ size_t REHex::RangeTree<OT, T>::erase_recursive_impl(Node *node)
 		
 		for(auto it = n->children.begin(); it != n->children.end(); ++it)
 		{
-			visit_node(it->node.get());
+			visit_node(it->node);
 		}
+		
+		free_node(n);
 	};
 	
 	visit_node(node);
 	
-	std::vector<NodeRef> &container = node->parent != NULL
-		? node->parent->children
-		: root;
-	
-	auto erase_iter = std::lower_bound(container.begin(), container.end(), NodeRef(node->key), &NodeRef::key_lt);
-	assert(erase_iter != container.end());
-	assert(erase_iter->node.get() == node);
-	
 	container.erase(erase_iter);
 	total_size -= total_nodes;
 	
@@ -1349,10 +1732,8 @@ size_t REHex::RangeTree<OT, T>::data_inserted_impl(OT offset, OT length)
 			{
 				i_offset += length;
 				
-				Node *new_node = new Node(i_offset, i_length, std::move(*n));
-				
+				rekey_node(n.node, i_offset, i_length);
 				n.key.offset = i_offset;
-				n.node.reset(new_node);
 				
 				++keys_modified;
 			}
@@ -1360,10 +1741,8 @@ size_t REHex::RangeTree<OT, T>::data_inserted_impl(OT offset, OT length)
 			{
 				i_length += length;
 				
-				Node *new_node = new Node(i_offset, i_length, std::move(*n));
-				
+				rekey_node(n.node, i_offset, i_length);
 				n.key.length = i_length;
-				n.node.reset(new_node);
 				
 				++keys_modified;
 			}
@@ -1420,11 +1799,10 @@ size_t REHex::RangeTree<OT, T>::data_erased_impl(OT offset, OT length)
 			
 			if(i_offset != n.key.offset || i_length != n.key.length)
 			{
-				Node *new_node = new Node(i_offset, i_length, std::move(*n));
+				rekey_node(n.node, i_offset, i_length);
 				
 				n.key.offset = i_offset;
 				n.key.length = i_length;
-				n.node.reset(new_node);
 				
 				++keys_modified;
 			}
@@ -1503,7 +1881,7 @@ void REHex::RangeTree<OT, T>::check() const
 				fprintf(stderr, "  ");
 			}
 			
-			fprintf(stderr, "node %p offset = %zd length = %zd\n", container[i].node.get(), container[i]->key.offset, container[i]->key.length);
+			fprintf(stderr, "node %p offset = %zd length = %zd\n", container[i].node, container[i]->key.offset, container[i]->key.length);
 			#endif
 			
 			assert(container[i].key.offset == container[i].node->key.offset);
@@ -1527,10 +1905,10 @@ void REHex::RangeTree<OT, T>::check() const
 				assert(container[i]->next_sibling == container[i + 1]);
 			}
 			
-			check_container(container[i].node.get(), depth + 1, container[i]->children);
+			check_container(container[i].node, depth + 1, container[i]->children);
 			
-			assert(seen_nodes.find(container[i].node.get()) == seen_nodes.end());
-			seen_nodes.insert(container[i].node.get());
+			assert(seen_nodes.find(container[i].node) == seen_nodes.end());
+			seen_nodes.insert(container[i].node);
 		}
 	};
 	
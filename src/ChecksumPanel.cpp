@@ -138,6 +138,14 @@ void REHex::ChecksumPanel::update()
 	}
 }
 
+void REHex::ChecksumPanel::visibility_changed()
+{
+	if(work_task)
+	{
+		work_task->change_priority(is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW);
+	}
+}
+
 void REHex::ChecksumPanel::restart()
 {
 	if(work_task)
@@ -174,7 +182,7 @@ void REHex::ChecksumPanel::restart()
 	int algo_idx = algo_choice->GetSelection();
 	cs_gen.reset(cs_algos[algo_idx]->factory());
 	
-	work_task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]() { return process(); }, 1)));
+	work_task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]() { return process(); }, 1, (is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW))));
 }
 
 bool REHex::ChecksumPanel::process()
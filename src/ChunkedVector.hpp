@@ -0,0 +1,588 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_CHUNKEDVECTOR_HPP
+#define REHEX_CHUNKEDVECTOR_HPP
+
+#include <algorithm>
+#include <assert.h>
+#include <initializer_list>
+#include <iterator>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace REHex
+{
+	/**
+	 * @brief Sequence container for large sorted data which is modified in the middle.
+	 *
+	 * Provides the subset of the std::vector interface used by RangeSet and RangeMap, but
+	 * stores the elements in a list of chunks holding up to CHUNK_SIZE elements each, so
+	 * inserting or erasing an element only moves the elements in one chunk (and the list
+	 * of chunks), rather than every element after it.
+	 *
+	 * Iterators are random access, moving an iterator more than a few elements is
+	 * O(log(size() / CHUNK_SIZE)). Like std::vector, any insertion or erasure invalidates
+	 * all iterators.
+	*/
+	template<typename T> class ChunkedVector
+	{
+		public:
+			/**
+			 * @brief Maximum number of elements in a chunk (roughly 4KiB of data).
+			*/
+			static const size_t CHUNK_SIZE = sizeof(T) >= 256 ? 16 : (4096 / sizeof(T));
+			
+			typedef T value_type;
+			typedef size_t size_type;
+			typedef ptrdiff_t difference_type;
+			typedef T& reference;
+			typedef const T& const_reference;
+		
+		private:
+			typedef std::vector<T> chunk_t;
+			
+			std::vector<chunk_t> chunks;
+			
+			/* Index of the first element in each chunk. */
+			std::vector<size_t> chunk_base;
+			
+			size_t n_elements;
+			
+			template<bool IS_CONST> class iterator_base
+			{
+				public:
+					typedef std::random_access_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef ptrdiff_t difference_type;
+					typedef typename std::conditional<IS_CONST, const T*, T*>::type pointer;
+					typedef typename std::conditional<IS_CONST, const T&, T&>::type reference;
+				
+				private:
+					typedef typename std::conditional<IS_CONST, const ChunkedVector*, ChunkedVector*>::type container_ptr;
+					
+					container_ptr cv;
+					
+					/* Position of the element in cv. The end iterator points to the
+					 * first element of a chunk one past the last.
+					*/
+					size_t chunk;
+					size_t idx;
+					
+					iterator_base(container_ptr cv, size_t chunk, size_t idx):
+						cv(cv), chunk(chunk), idx(idx) {}
+					
+					size_t index() const
+					{
+						return chunk < cv->chunks.size()
+							? cv->chunk_base[chunk] + idx
+							: cv->n_elements;
+					}
+				
+				public:
+					iterator_base():
+						cv(NULL), chunk(0), idx(0) {}
+					
+					/* Allow conversion from iterator to const_iterator. */
+					template<bool RHS_CONST, typename = typename std::enable_if<IS_CONST && !RHS_CONST>::type>
+						iterator_base(const iterator_base<RHS_CONST> &rhs):
+						cv(rhs.cv), chunk(rhs.chunk), idx(rhs.idx) {}
+					
+					reference operator*() const
+					{
+						return cv->chunks[chunk][idx];
+					}
+					
+					pointer operator->() const
+					{
+						return &(cv->chunks[chunk][idx]);
+					}
+					
+					reference operator[](difference_type n) const
+					{
+						return *(*this + n);
+					}
+					
+					iterator_base &operator++()
+					{
+						if(++idx == cv->chunks[chunk].size())
+						{
+							++chunk;
+							idx = 0;
+						}
+						
+						return *this;
+					}
+					
+					iterator_base operator++(int)
+					{
+						iterator_base old = *this;
+						++(*this);
+						return old;
+					}
+					
+					iterator_base &operator--()
+					{
+						if(idx == 0)
+						{
+							--chunk;
+							idx = cv->chunks[chunk].size() - 1;
+						}
+						else{
+							--idx;
+						}
+						
+						return *this;
+					}
+					
+					iterator_base operator--(int)
+					{
+						iterator_base old = *this;
+						--(*this);
+						return old;
+					}
+					
+					iterator_base &operator+=(difference_type n)
+					{
+						if(chunk < cv->chunks.size() && (difference_type)(idx) + n >= 0 && (size_t)((difference_type)(idx) + n) < cv->chunks[chunk].size())
+						{
+							/* Fast path - still within the same chunk. */
+							idx += n;
+						}
+						else{
+							*this = cv->template iterator_at<iterator_base>(cv, (size_t)((difference_type)(index()) + n));
+						}
+						
+						return *this;
+					}
+					
+					iterator_base &operator-=(difference_type n)
+					{
+						return *this += -n;
+					}
+					
+					iterator_base operator+(difference_type n) const
+					{
+						iterator_base i = *this;
+						i += n;
+						return i;
+					}
+					
+					friend iterator_base operator+(difference_type n, const iterator_base &i)
+					{
+						return i + n;
+					}
+					
+					iterator_base operator-(difference_type n) const
+					{
+						iterator_base i = *this;
+						i -= n;
+						return i;
+					}
+					
+					difference_type operator-(const iterator_base &rhs) const
+					{
+						if(chunk == rhs.chunk)
+						{
+							return (difference_type)(idx) - (difference_type)(rhs.idx);
+						}
+						
+						return (difference_type)(index()) - (difference_type)(rhs.index());
+					}
+					
+					bool operator==(const iterator_base &rhs) const { return chunk == rhs.chunk && idx == rhs.idx; }
+					bool operator!=(const iterator_base &rhs) const { return chunk != rhs.chunk || idx != rhs.idx; }
+					bool operator<(const iterator_base &rhs) const { return chunk < rhs.chunk || (chunk == rhs.chunk && idx < rhs.idx); }
+					bool operator>(const iterator_base &rhs) const { return rhs < *this; }
+					bool operator<=(const iterator_base &rhs) const { return !(rhs < *this); }
+					bool operator>=(const iterator_base &rhs) const { return !(*this < rhs); }
+				
+				friend ChunkedVector;
+				friend iterator_base<!IS_CONST>;
+			};
+		
+		public:
+			typedef iterator_base<false> iterator;
+			typedef iterator_base<true> const_iterator;
+			
+			ChunkedVector():
+				n_elements(0) {}
+			
+			template<typename I, typename = typename std::enable_if<!std::is_integral<I>::value>::type>
+				ChunkedVector(I begin, I end):
+				n_elements(0)
+			{
+				insert(this->end(), begin, end);
+			}
+			
+			ChunkedVector(std::initializer_list<T> init):
+				n_elements(0)
+			{
+				insert(end(), init.begin(), init.end());
+			}
+			
+			bool operator==(const ChunkedVector<T> &rhs) const
+			{
+				return n_elements == rhs.n_elements && std::equal(begin(), end(), rhs.begin());
+			}
+			
+			bool operator!=(const ChunkedVector<T> &rhs) const
+			{
+				return !(*this == rhs);
+			}
+			
+			iterator begin() { return iterator(this, 0, 0); }
+			iterator end() { return iterator(this, chunks.size(), 0); }
+			
+			const_iterator begin() const { return const_iterator(this, 0, 0); }
+			const_iterator end() const { return const_iterator(this, chunks.size(), 0); }
+			
+			const_iterator cbegin() const { return begin(); }
+			const_iterator cend() const { return end(); }
+			
+			size_t size() const { return n_elements; }
+			bool empty() const { return n_elements == 0; }
+			
+			T &operator[](size_t idx) { return *(iterator_at<iterator>(this, idx)); }
+			const T &operator[](size_t idx) const { return *(iterator_at<const_iterator>(this, idx)); }
+			
+			T &front() { assert(n_elements > 0); return chunks.front().front(); }
+			const T &front() const { assert(n_elements > 0); return chunks.front().front(); }
+			
+			T &back() { assert(n_elements > 0); return chunks.back().back(); }
+			const T &back() const { assert(n_elements > 0); return chunks.back().back(); }
+			
+			/**
+			 * @brief Reserve space (no-op, provided for compatibility with std::vector).
+			 *
+			 * Storage is allocated a chunk at a time, so there is nothing to reserve.
+			*/
+			void reserve(size_t) {}
+			
+			/**
+			 * @brief Returns the number of elements which can be stored before more
+			 * chunks need to be allocated.
+			*/
+			size_t capacity() const { return chunks.size() * CHUNK_SIZE; }
+			
+			void clear();
+			
+			void push_back(const T &value);
+			void push_back(T &&value);
+			
+			template<typename... Args> void emplace_back(Args&&... args);
+			
+			iterator insert(const_iterator pos, const T &value);
+			iterator insert(const_iterator pos, T &&value);
+			template<typename I, typename = typename std::enable_if<!std::is_integral<I>::value>::type>
+				iterator insert(const_iterator pos, I first, I last);
+			iterator insert(const_iterator pos, std::initializer_list<T> ilist);
+			
+			template<typename... Args> iterator emplace(const_iterator pos, Args&&... args);
+			
+			iterator erase(const_iterator pos);
+			iterator erase(const_iterator first, const_iterator last);
+		
+		private:
+			template<typename IT, typename CP> static IT iterator_at(CP cv, size_t idx);
+			
+			/* Recalculate chunk_base for every chunk from first_chunk onwards. */
+			void update_bases(size_t first_chunk);
+			
+			/* Split a chunk which has grown over CHUNK_SIZE into several chunks. */
+			void split_chunk(size_t chunk);
+			
+			/* Merge a chunk with its neighbours if they have shrunk enough to fit. */
+			void merge_chunk(size_t chunk);
+			
+			template<typename I> iterator insert_impl(const_iterator pos, I first, I last, std::forward_iterator_tag);
+			template<typename I> iterator insert_impl(const_iterator pos, I first, I last, std::input_iterator_tag);
+	};
+}
+
+template<typename T> const size_t REHex::ChunkedVector<T>::CHUNK_SIZE;
+
+template<typename T> template<typename IT, typename CP> IT REHex::ChunkedVector<T>::iterator_at(CP cv, size_t idx)
+{
+	assert(idx <= cv->n_elements);
+	
+	if(idx >= cv->n_elements)
+	{
+		return IT(cv, cv->chunks.size(), 0);
+	}
+	
+	auto c = std::upper_bound(cv->chunk_base.begin(), cv->chunk_base.end(), idx);
+	size_t chunk = std::distance(cv->chunk_base.begin(), c) - 1;
+	
+	return IT(cv, chunk, (idx - cv->chunk_base[chunk]));
+}
+
+template<typename T> void REHex::ChunkedVector<T>::update_bases(size_t first_chunk)
+{
+	chunk_base.resize(chunks.size());
+	
+	size_t base = first_chunk > 0
+		? chunk_base[first_chunk - 1] + chunks[first_chunk - 1].size()
+		: 0;
+	
+	for(size_t i = first_chunk; i < chunks.size(); ++i)
+	{
+		chunk_base[i] = base;
+		base += chunks[i].size();
+	}
+	
+	assert(base == n_elements);
+}
+
+template<typename T> void REHex::ChunkedVector<T>::split_chunk(size_t chunk)
+{
+	size_t chunk_len = chunks[chunk].size();
+	
+	if(chunk_len <= CHUNK_SIZE)
+	{
+		return;
+	}
+	
+	/* Split into half-full chunks so there is room to insert more elements on either side
+	 * of the split without having to split again immediately.
+	*/
+	
+	size_t n_chunks = (chunk_len + (CHUNK_SIZE / 2) - 1) / (CHUNK_SIZE / 2);
+	
+	std::vector<chunk_t> new_chunks(n_chunks);
+	auto src = std::make_move_iterator(chunks[chunk].begin());
+	
+	for(size_t i = 0, done = 0; i < n_chunks; ++i)
+	{
+		size_t this_len = (chunk_len - done) / (n_chunks - i);
+		
+		new_chunks[i].reserve(CHUNK_SIZE);
+		new_chunks[i].insert(new_chunks[i].end(), src, std::next(src, this_len));
+		
+		std::advance(src, this_len);
+		done += this_len;
+	}
+	
+	chunks[chunk] = std::move(new_chunks[0]);
+	chunks.insert(std::next(chunks.begin(), chunk + 1),
+		std::make_move_iterator(std::next(new_chunks.begin())),
+		std::make_move_iterator(new_chunks.end()));
+}
+
+template<typename T> void REHex::ChunkedVector<T>::merge_chunk(size_t chunk)
+{
+	/* Merge with the following chunk if both fit into a single chunk, then with the
+	 * preceeding one, so sparse chunks left behind by erase() don't accumulate.
+	*/
+	
+	if((chunk + 1) < chunks.size() && (chunks[chunk].size() + chunks[chunk + 1].size()) <= (CHUNK_SIZE / 2))
+	{
+		chunks[chunk].insert(chunks[chunk].end(),
+			std::make_move_iterator(chunks[chunk + 1].begin()),
+			std::make_move_iterator(chunks[chunk + 1].end()));
+		
+		chunks.erase(std::next(chunks.begin(), chunk + 1));
+	}
+	
+	if(chunk > 0 && chunk < chunks.size() && (chunks[chunk - 1].size() + chunks[chunk].size()) <= (CHUNK_SIZE / 2))
+	{
+		chunks[chunk - 1].insert(chunks[chunk - 1].end(),
+			std::make_move_iterator(chunks[chunk].begin()),
+			std::make_move_iterator(chunks[chunk].end()));
+		
+		chunks.erase(std::next(chunks.begin(), chunk));
+	}
+}
+
+template<typename T> void REHex::ChunkedVector<T>::clear()
+{
+	chunks.clear();
+	chunk_base.clear();
+	n_elements = 0;
+}
+
+template<typename T> void REHex::ChunkedVector<T>::push_back(const T &value)
+{
+	insert(end(), value);
+}
+
+template<typename T> void REHex::ChunkedVector<T>::push_back(T &&value)
+{
+	insert(end(), std::move(value));
+}
+
+template<typename T> template<typename... Args> void REHex::ChunkedVector<T>::emplace_back(Args&&... args)
+{
+	insert(end(), T(std::forward<Args>(args)...));
+}
+
+template<typename T> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert(const_iterator pos, const T &value)
+{
+	return insert(pos, &value, (&value) + 1);
+}
+
+template<typename T> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert(const_iterator pos, T &&value)
+{
+	return insert(pos, std::make_move_iterator(&value), std::make_move_iterator((&value) + 1));
+}
+
+template<typename T> template<typename I, typename> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert(const_iterator pos, I first, I last)
+{
+	return insert_impl(pos, first, last, typename std::iterator_traits<I>::iterator_category());
+}
+
+template<typename T> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert(const_iterator pos, std::initializer_list<T> ilist)
+{
+	return insert(pos, ilist.begin(), ilist.end());
+}
+
+template<typename T> template<typename... Args> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::emplace(const_iterator pos, Args&&... args)
+{
+	return insert(pos, T(std::forward<Args>(args)...));
+}
+
+template<typename T> template<typename I> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert_impl(const_iterator pos, I first, I last, std::input_iterator_tag)
+{
+	std::vector<T> tmp(first, last);
+	return insert(pos, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+}
+
+template<typename T> template<typename I> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::insert_impl(const_iterator pos, I first, I last, std::forward_iterator_tag)
+{
+	assert(pos.cv == this);
+	
+	size_t insert_idx = pos.index();
+	size_t count = std::distance(first, last);
+	
+	if(count == 0)
+	{
+		return iterator(this, pos.chunk, pos.idx);
+	}
+	
+	size_t chunk, chunk_idx;
+	
+	if(chunks.empty())
+	{
+		chunks.emplace_back();
+		chunks.back().reserve(CHUNK_SIZE);
+		
+		chunk = 0;
+		chunk_idx = 0;
+	}
+	else if(pos.chunk >= chunks.size())
+	{
+		/* Appending to the end. */
+		chunk = chunks.size() - 1;
+		chunk_idx = chunks[chunk].size();
+	}
+	else if(pos.idx == 0 && pos.chunk > 0 && (chunks[pos.chunk - 1].size() + count) <= CHUNK_SIZE)
+	{
+		/* Inserting at the start of a chunk, put it at the end of the previous one if
+		 * there is space there.
+		*/
+		
+		chunk = pos.chunk - 1;
+		chunk_idx = chunks[chunk].size();
+	}
+	else{
+		chunk = pos.chunk;
+		chunk_idx = pos.idx;
+	}
+	
+	chunks[chunk].insert(std::next(chunks[chunk].begin(), chunk_idx), first, last);
+	n_elements += count;
+	
+	split_chunk(chunk);
+	update_bases(chunk);
+	
+	return iterator_at<iterator>(this, insert_idx);
+}
+
+template<typename T> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::erase(const_iterator pos)
+{
+	return erase(pos, std::next(pos));
+}
+
+template<typename T> typename REHex::ChunkedVector<T>::iterator REHex::ChunkedVector<T>::erase(const_iterator first, const_iterator last)
+{
+	assert(first.cv == this);
+	assert(last.cv == this);
+	assert(first <= last);
+	
+	if(first == last)
+	{
+		return iterator(this, first.chunk, first.idx);
+	}
+	
+	size_t erase_idx = first.index();
+	size_t count = last.index() - erase_idx;
+	
+	if(first.chunk == last.chunk)
+	{
+		/* Erasing from within a single chunk. */
+		chunks[first.chunk].erase(
+			std::next(chunks[first.chunk].begin(), first.idx),
+			std::next(chunks[first.chunk].begin(), last.idx));
+	}
+	else{
+		/* Erase the tail of the first chunk, any whole chunks in the middle and the head
+		 * of the last chunk (if there is one).
+		*/
+		
+		chunks[first.chunk].erase(std::next(chunks[first.chunk].begin(), first.idx), chunks[first.chunk].end());
+		
+		if(last.chunk < chunks.size())
+		{
+			chunks[last.chunk].erase(chunks[last.chunk].begin(), std::next(chunks[last.chunk].begin(), last.idx));
+		}
+		
+		chunks.erase(
+			std::next(chunks.begin(), first.chunk + 1),
+			std::next(chunks.begin(), last.chunk));
+	}
+	
+	n_elements -= count;
+	
+	/* Remove the first chunk if it is now empty, then tidy up any sparse chunks. */
+	
+	size_t chunk = first.chunk;
+	
+	if(chunks[chunk].empty())
+	{
+		chunks.erase(std::next(chunks.begin(), chunk));
+	}
+	
+	if(chunk < chunks.size())
+	{
+		merge_chunk(chunk);
+	}
+	else if(chunk > 0)
+	{
+		merge_chunk(chunk - 1);
+	}
+	
+	size_t update_from = std::min(chunk, chunks.size());
+	update_from = update_from > 0 ? update_from - 1 : 0;
+	
+	update_bases(update_from);
+	
+	return iterator_at<iterator>(this, erase_idx);
+}
+
+#endif /* !REHEX_CHUNKEDVECTOR_HPP */
@@ -17,6 +17,7 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <utility>
@@ -302,6 +303,10 @@ void REHex::CommentTree::OnContextMenu(wxDataViewEvent &event)
 	menu.Append(ID_EDIT_COMMENT,  "&Edit comment");
 	menu.Append(ID_COPY_COMMENT,  "&Copy comment(s)");
 	
+	bool is_array_item = model->is_array_item(event.GetItem());
+	menu.Enable(ID_EDIT_COMMENT, !is_array_item);
+	menu.Enable(ID_COPY_COMMENT, !is_array_item);
+	
 	menu.Bind(wxEVT_MENU, [this, key](wxCommandEvent &event)
 	{
 		switch(event.GetId())
@@ -473,20 +478,23 @@ bool REHex::CommentTreeModel::refresh_comments()
 			return;
 		}
 		
-		auto x = values.emplace(std::make_pair(comment->key, CommentData(parent, comment->value.text)));
+		auto x = values.emplace(std::make_pair(comment->key, CommentData(parent, comment->value.text, comment->value.array)));
 		values_elem_t *value = &(*(x.first));
 		
-		if(value->second.parent != parent)
+		if(value->second.parent != parent
+			|| value->second.array.get() != comment->value.array.get()
+			|| (value->second.array && value->second.text.get() != comment->value.text.get()))
 		{
 			/* Remove the item so we can re-add it if a new parent has been
-			 * created around it.
+			 * created around it, or if the array elements under it need to be
+			 * generated again.
 			*/
 			
 			assert(!x.second);
 			
 			erase_value(x.first);
 			
-			x = values.emplace(std::make_pair(comment->key, CommentData(parent, comment->value.text)));
+			x = values.emplace(std::make_pair(comment->key, CommentData(parent, comment->value.text, comment->value.array)));
 			value = &(*(x.first));
 			
 			assert(x.second);
@@ -578,6 +586,105 @@ const REHex::BitRangeTreeKey *REHex::CommentTreeModel::dv_item_to_key(const wxDa
 	return (const BitRangeTreeKey*)(item.GetID());
 }
 
+bool REHex::CommentTreeModel::is_array_item(const wxDataViewItem &item) const
+{
+	return array_items.find((const ArrayItem*)(item.GetID())) != array_items.end();
+}
+
+void REHex::CommentTreeModel::populate_array_range(values_elem_t *array, void *parent, off_t first_index, off_t count, std::vector< std::unique_ptr<ArrayItem> > &items) const
+{
+	const Document::Comment::ArrayLayout &layout = *(array->second.array);
+	int64_t element_bits = layout.element_length.total_bits();
+	
+	if(count <= ARRAY_PAGE_SIZE)
+	{
+		for(off_t i = 0; i < count; ++i)
+		{
+			off_t index = first_index + i;
+			
+			BitRangeTreeKey key(
+				(array->first.offset + BitOffset::from_int64(element_bits * index)),
+				layout.element_length);
+			
+			items.emplace_back(new ArrayItem(key, array, parent, ArrayItem::Kind::ELEMENT, index, 1, 0));
+			array_items.insert(items.back().get());
+		}
+	}
+	else{
+		/* Split into pages, each of which is further split into pages if it still
+		 * has too many elements.
+		*/
+		
+		off_t per_page = ARRAY_PAGE_SIZE;
+		while(((count + per_page - 1) / per_page) > ARRAY_PAGE_SIZE)
+		{
+			per_page *= ARRAY_PAGE_SIZE;
+		}
+		
+		for(off_t page_first = 0; page_first < count; page_first += per_page)
+		{
+			off_t index = first_index + page_first;
+			off_t page_count = std::min<off_t>(per_page, (count - page_first));
+			
+			BitRangeTreeKey key(
+				(array->first.offset + BitOffset::from_int64(element_bits * index)),
+				BitOffset::from_int64(element_bits * page_count));
+			
+			items.emplace_back(new ArrayItem(key, array, parent, ArrayItem::Kind::PAGE, index, page_count, 0));
+			array_items.insert(items.back().get());
+		}
+	}
+}
+
+void REHex::CommentTreeModel::populate_array_element(ArrayItem *element) const
+{
+	const Document::Comment::ArrayLayout &layout = *(element->array->second.array);
+	
+	/* The fields are sorted so any field enclosing another comes before it, so we can
+	 * nest them by keeping a stack of the fields enclosing the current one.
+	*/
+	
+	std::vector<ArrayItem*> enclosing;
+	
+	for(size_t i = 0; i < layout.fields.size(); ++i)
+	{
+		BitRangeTreeKey key(
+			(element->key.offset + layout.fields[i].offset),
+			layout.fields[i].length);
+		
+		while(!enclosing.empty()
+			&& !(enclosing.back()->key.length > BitOffset::ZERO
+				&& key.offset >= enclosing.back()->key.offset
+				&& (key.offset + key.length) <= (enclosing.back()->key.offset + enclosing.back()->key.length)))
+		{
+			enclosing.pop_back();
+		}
+		
+		ArrayItem *parent = enclosing.empty() ? element : enclosing.back();
+		
+		parent->children.emplace_back(new ArrayItem(key, element->array, parent, ArrayItem::Kind::FIELD, element->first_index, 1, i));
+		
+		ArrayItem *field = parent->children.back().get();
+		field->populated = true;
+		
+		array_items.insert(field);
+		enclosing.push_back(field);
+	}
+}
+
+void REHex::CommentTreeModel::release_array_items(std::vector< std::unique_ptr<ArrayItem> > &items, void *parent)
+{
+	for(auto i = items.begin(); i != items.end(); ++i)
+	{
+		release_array_items((*i)->children, i->get());
+		
+		array_items.erase(i->get());
+		batched_item_deleted(wxDataViewItem(parent), wxDataViewItem(i->get()));
+	}
+	
+	items.clear();
+}
+
 void REHex::CommentTreeModel::set_filter_text(const wxString &filter_text)
 {
 	this->filter_text = filter_text;
@@ -599,6 +706,8 @@ std::map<REHex::BitRangeTreeKey, REHex::CommentTreeModel::CommentData>::iterator
 		erase_value(values.find(child->first));
 	}
 	
+	release_array_items(value->second.array_items, value);
+	
 	#ifdef COMMENTTREEMODEL_BATCH_MODEL_UPDATES
 	if(!accumulated_items_to_add.IsEmpty() || !accumulated_items_to_change.IsEmpty())
 	{
@@ -613,7 +722,7 @@ std::map<REHex::BitRangeTreeKey, REHex::CommentTreeModel::CommentData>::iterator
 	}
 	else{
 		parent->second.children.erase(value);
-		parent_became_empty = parent->second.children.empty();
+		parent_became_empty = parent->second.children.empty() && !parent->second.array;
 	}
 	
 	auto next_value_i = values.erase(value_i);
@@ -642,7 +751,7 @@ void REHex::CommentTreeModel::re_add_item(values_elem_t *value, bool as_containe
 	*/
 	
 	std::shared_ptr<const wxString> placeholder_text(new wxString(""));
-	values_elem_t placeholder(BitRangeTreeKey(BitOffset(-1, 0), BitOffset(0, 0)), CommentData(parent, placeholder_text));
+	values_elem_t placeholder(BitRangeTreeKey(BitOffset(-1, 0), BitOffset(0, 0)), CommentData(parent, placeholder_text, NULL));
 	bool added_placeholder = false;
 	
 	if(parent != NULL && parent->second.children.size() == 1U)
@@ -823,10 +932,47 @@ int REHex::CommentTreeModel::Compare(const wxDataViewItem &item1, const wxDataVi
 
 unsigned int REHex::CommentTreeModel::GetChildren(const wxDataViewItem &item, wxDataViewItemArray &children) const
 {
+	if(is_array_item(item))
+	{
+		ArrayItem *array_item = (ArrayItem*)(item.GetID());
+		
+		if(!array_item->populated)
+		{
+			if(array_item->kind == ArrayItem::Kind::PAGE)
+			{
+				populate_array_range(array_item->array, array_item, array_item->first_index, array_item->count, array_item->children);
+			}
+			else{
+				populate_array_element(array_item);
+			}
+			
+			array_item->populated = true;
+		}
+		
+		children.Alloc(array_item->children.size());
+		
+		for(auto c = array_item->children.begin(); c != array_item->children.end(); ++c)
+		{
+			children.Add(wxDataViewItem((void*)(c->get())));
+		}
+		
+		return array_item->children.size();
+	}
+	
 	values_elem_t *value = (values_elem_t*)(item.GetID());
 	auto v_children = (value != NULL ? &(value->second.children) : &root);
 	
-	children.Alloc(v_children->size());
+	if(value != NULL && value->second.array && !value->second.array_populated)
+	{
+		off_t element_count = value->second.array->element_count(value->first.length);
+		populate_array_range(value, value, 0, element_count, value->second.array_items);
+		
+		value->second.array_populated = true;
+	}
+	
+	size_t num_array_items = (value != NULL ? value->second.array_items.size() : 0);
+	
+	children.Alloc(v_children->size() + num_array_items);
 	
 	for(auto v = v_children->begin(); v != v_children->end(); ++v)
 	{
@@ -834,7 +980,12 @@ unsigned int REHex::CommentTreeModel::GetChildren(const wxDataViewItem &item, wx
 		children.Add(wxDataViewItem((void*)(v_data)));
 	}
 	
-	return v_children->size();
+	for(size_t i = 0; i < num_array_items; ++i)
+	{
+		children.Add(wxDataViewItem((void*)(value->second.array_items[i].get())));
+	}
+	
+	return v_children->size() + num_array_items;
 }
 
 unsigned int REHex::CommentTreeModel::GetColumnCount() const
@@ -855,6 +1006,12 @@ wxDataViewItem REHex::CommentTreeModel::GetParent(const wxDataViewItem &item) co
 		return wxDataViewItem(NULL);
 	}
 	
+	if(is_array_item(item))
+	{
+		ArrayItem *array_item = (ArrayItem*)(item.GetID());
+		return wxDataViewItem(array_item->parent);
+	}
+	
 	values_elem_t *value = (values_elem_t*)(item.GetID());
 	return wxDataViewItem(value->second.parent);
 }
@@ -868,7 +1025,34 @@ void REHex::CommentTreeModel::GetValue(wxVariant &variant, const wxDataViewItem
 		return;
 	}
 	
-	values_elem_t *value = (values_elem_t*)(item.GetID());
+	const BitRangeTreeKey *key = dv_item_to_key(item);
+	wxString text;
+	
+	if(is_array_item(item))
+	{
+		ArrayItem *array_item = (ArrayItem*)(item.GetID());
+		const wxString &array_text = *(array_item->array->second.text);
+		
+		switch(array_item->kind)
+		{
+			case ArrayItem::Kind::PAGE:
+				text = Document::Comment::ArrayLayout::element_text(array_text, array_item->first_index)
+					+ " ... " + Document::Comment::ArrayLayout::element_text(array_text, (array_item->first_index + array_item->count - 1));
+				break;
+				
+			case ArrayItem::Kind::ELEMENT:
+				text = Document::Comment::ArrayLayout::element_text(array_text, array_item->first_index);
+				break;
+				
+			case ArrayItem::Kind::FIELD:
+				text = *(array_item->array->second.array->fields[array_item->field].text);
+				break;
+		}
+	}
+	else{
+		values_elem_t *value = (values_elem_t*)(item.GetID());
+		text = *(value->second.text);
+	}
 	
 	if(col == MODEL_TEXT_COLUMN)
 	{
@@ -877,12 +1061,12 @@ void REHex::CommentTreeModel::GetValue(wxVariant &variant, const wxDataViewItem
 		 * if it doesn't find a match.
 		*/
 		
-		size_t line_len = value->second.text->find_first_of("\r\n");
-		variant = value->second.text->substr(0, line_len);
+		size_t line_len = text.find_first_of("\r\n");
+		variant = text.substr(0, line_len);
 	}
 	else /* if(col == MODEL_OFFSET_COLUMN) */
 	{
-		variant = format_offset(value->first.offset, document_ctrl->get_offset_display_base(), document->buffer_length());
+		variant = format_offset(key->offset, document_ctrl->get_offset_display_base(), document->buffer_length());
 	}
 }
 
@@ -894,6 +1078,25 @@ bool REHex::CommentTreeModel::IsContainer(const wxDataViewItem &item) const
 		return true;
 	}
 	
+	if(is_array_item(item))
+	{
+		ArrayItem *array_item = (ArrayItem*)(item.GetID());
+		
+		if(array_item->kind == ArrayItem::Kind::PAGE)
+		{
+			return true;
+		}
+		else if(array_item->kind == ArrayItem::Kind::ELEMENT)
+		{
+			return !array_item->array->second.array->fields.empty();
+		}
+		else /* if(array_item->kind == ArrayItem::Kind::FIELD) */
+		{
+			/* Fields are all created along with their element. */
+			return !array_item->children.empty();
+		}
+	}
+	
 	values_elem_t *value = (values_elem_t*)(item.GetID());
 	return value->second.is_container;
 }
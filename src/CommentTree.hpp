@@ -18,8 +18,10 @@
 #ifndef REHEX_COMMENTTREE_HPP
 #define REHEX_COMMENTTREE_HPP
 
+#include <memory>
 #include <set>
 #include <string>
+#include <vector>
 #include <wx/dataview.h>
 #include <wx/panel.h>
 #include <wx/textctrl.h>
@@ -61,6 +63,14 @@ namespace REHex {
 			int get_max_comment_depth() const;
 			static const BitRangeTreeKey *dv_item_to_key(const wxDataViewItem &item);
 			
+			/**
+			 * @brief Check if an item is an array element (or a field within one).
+			 *
+			 * Array elements are generated from the layout of an array comment
+			 * rather than being comments in the Document, so they can't be edited.
+			*/
+			bool is_array_item(const wxDataViewItem &item) const;
+			
 			void set_filter_text(const wxString &filter_text);
 			wxString get_filter_text() const;
 			
@@ -81,6 +91,39 @@ namespace REHex {
 			struct CommentData;
 			typedef std::pair<const BitRangeTreeKey, CommentData> values_elem_t;
 			
+			/* Maximum number of children under an array comment (or page) before
+			 * the elements are split into pages.
+			*/
+			static const off_t ARRAY_PAGE_SIZE = 1000;
+			
+			/**
+			 * @brief An item generated from the layout of an array comment.
+			 *
+			 * The elements of an array (and the fields within them) are only created
+			 * when their parent is expanded, so an array of millions of elements
+			 * costs nothing until the user starts looking at it.
+			*/
+			struct ArrayItem
+			{
+				enum class Kind { PAGE, ELEMENT, FIELD };
+				
+				const BitRangeTreeKey key;  /* Must be first, see dv_item_to_key(). */
+				
+				values_elem_t *array;  /**< Array comment this item was generated from. */
+				void *parent;          /**< Parent item - array comment or another ArrayItem. */
+				
+				Kind kind;
+				off_t first_index;     /**< Index of first element (PAGE and ELEMENT). */
+				off_t count;           /**< Number of elements (PAGE only). */
+				size_t field;          /**< Index into ArrayLayout::fields (FIELD only). */
+				
+				bool populated;
+				std::vector< std::unique_ptr<ArrayItem> > children;
+				
+				ArrayItem(const BitRangeTreeKey &key, values_elem_t *array, void *parent, Kind kind, off_t first_index, off_t count, size_t field):
+					key(key), array(array), parent(parent), kind(kind), first_index(first_index), count(count), field(field), populated(false) {}
+			};
+			
 			struct ChildElemCompare
 			{
 				bool operator()(const values_elem_t *a, const values_elem_t *b) const
@@ -96,8 +139,14 @@ namespace REHex {
 				bool is_container;
 				
 				std::shared_ptr<const wxString> text;
+				std::shared_ptr<const Document::Comment::ArrayLayout> array;
 				
-				CommentData(values_elem_t *parent, const std::shared_ptr<const wxString> &text): parent(parent), is_container(false), text(text) {}
+				/* Items generated from the array layout, after any real children. */
+				mutable bool array_populated;
+				mutable std::vector< std::unique_ptr<ArrayItem> > array_items;
+				
+				CommentData(values_elem_t *parent, const std::shared_ptr<const wxString> &text, const std::shared_ptr<const Document::Comment::ArrayLayout> &array):
+					parent(parent), is_container(array != NULL), text(text), array(array), array_populated(false) {}
 			};
 			
 			std::map<BitRangeTreeKey, CommentData> values;
@@ -108,6 +157,12 @@ namespace REHex {
 			
 			wxString filter_text;
 			
+			mutable std::set<const ArrayItem*> array_items;  /**< All ArrayItem objects which currently exist. */
+			
+			void populate_array_range(values_elem_t *array, void *parent, off_t first_index, off_t count, std::vector< std::unique_ptr<ArrayItem> > &items) const;
+			void populate_array_element(ArrayItem *element) const;
+			void release_array_items(std::vector< std::unique_ptr<ArrayItem> > &items, void *parent);
+			
 			std::map<BitRangeTreeKey, CommentData>::iterator erase_value(std::map<BitRangeTreeKey, CommentData>::iterator value_i);
 			void re_add_item(values_elem_t *value, bool as_container);
 			
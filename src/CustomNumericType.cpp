@@ -159,17 +159,29 @@ REHex::DataType REHex::CustomNumericType::get_DataType() const
 		}, REHex::BitOffset((bits / 8), (bits % 8)));
 }
 
-std::string REHex::CustomNumericType::format_value(const std::vector<bool> &data) const
+std::string REHex::CustomNumericType::format_value(const BitVector &data) const
 {
 	assert(data.size() == bits);
+	assert(bits <= 64);
 	
-	std::vector<bool> swapped_data;
+	/* Load the packed bits into an integer, the first bit in the data is the most
+	 * significant in big endian order.
+	*/
+	
+	const std::vector<unsigned char> &bytes = data.bytes();
+	uint64_t raw = 0;
 	
 	switch(endianness)
 	{
 		case Endianness::BIG:
 		{
-			swapped_data = data;
+			for(auto b = bytes.begin(); b != bytes.end(); ++b)
+			{
+				raw = (raw << 8) | *b;
+			}
+			
+			raw >>= (bytes.size() * 8) - bits;
+			
 			break;
 		}
 		
@@ -177,12 +189,9 @@ std::string REHex::CustomNumericType::format_value(const std::vector<bool> &data
 		{
 			assert((bits % 8) == 0);
 			
-			swapped_data.reserve(bits);
-			
-			for(int i = bits - 8; i >= 0; i -= 8)
+			for(auto b = bytes.rbegin(); b != bytes.rend(); ++b)
 			{
-				swapped_data.insert(swapped_data.end(),
-					(data.begin() + i), (data.begin() + i + 8));
+				raw = (raw << 8) | *b;
 			}
 			
 			break;
@@ -193,79 +202,49 @@ std::string REHex::CustomNumericType::format_value(const std::vector<bool> &data
 	{
 		case BaseType::UNSIGNED_INT:
 		{
-			uint64_t value = 0;
-			
-			for(auto b = swapped_data.begin(); b != swapped_data.end(); ++b)
-			{
-				value <<= 1;
-				value |= *b;
-			}
-			
-			return std::to_string(value);
+			return std::to_string(raw);
 		}
 		
 		case BaseType::SIGNED_INT:
-			int64_t value = 0;
-			
-			for(auto b = swapped_data.rbegin(); b != swapped_data.rend(); ++b)
+			if(bits < 64 && (raw & (1ULL << (bits - 1))) != 0)
 			{
-				int64_t high_bit = 1LL << 63;
-				
-				value >>= 1;
-				
-				if(*b)
-				{
-					value |= high_bit;
-				}
-				else{
-					value &= ~high_bit;
-				}
+				/* Sign extend. */
+				raw |= ~((1ULL << bits) - 1);
 			}
 			
-			value >>= 64 - swapped_data.size();
-			
-			return std::to_string(value);
+			return std::to_string((int64_t)(raw));
 	}
 	
 	abort(); /* Unreachable */
 }
 
-std::vector<bool> REHex::CustomNumericType::parse_value(const std::string &value) const
+REHex::BitVector REHex::CustomNumericType::parse_value(const std::string &value) const
 {
-	std::vector<bool> data;
-	data.reserve(bits);
+	assert(bits <= 64);
+	
+	uint64_t raw = 0;
 	
 	switch(base_type)
 	{
 		case BaseType::UNSIGNED_INT:
 		{
-			assert(bits <= 64);
-			
 			uint64_t value_max = bits < 64
 				? (1ULL << bits) - 1
 				: std::numeric_limits<uint64_t>::max();
 			
-			uint64_t value_u;
 			try {
-				value_u = NumericTextCtrl::ParseValue<uint64_t>(value, 0, value_max);
+				raw = NumericTextCtrl::ParseValue<uint64_t>(value, 0, value_max);
 			}
 			catch(const NumericTextCtrl::InputError &e)
 			{
 				throw std::invalid_argument(e.what());
 			}
 			
-			for(size_t i = 0; i < bits; ++i)
-			{
-				data.insert(data.begin(), (value_u & (1ULL << i)) != 0);
-			}
-			
 			break;
 		}
 		
 		case BaseType::SIGNED_INT:
 		{
-			assert(bits <= 64);
-			
 			int64_t value_min = bits < 64
 				? -(1LL << (bits - 1))
 				: std::numeric_limits<int64_t>::min();
@@ -283,32 +262,52 @@ std::vector<bool> REHex::CustomNumericType::parse_value(const std::string &value
 				throw std::invalid_argument(e.what());
 			}
 			
-			for(size_t i = 0; i < bits; ++i)
+			raw = (uint64_t)(value_s);
+			
+			if(bits < 64)
 			{
-				data.insert(data.begin(), (value_s & (1LL << i)) != 0);
+				raw &= (1ULL << bits) - 1;
 			}
 			
 			break;
 		}
 	}
 	
-	if(endianness == Endianness::LITTLE)
+	/* Store the integer into packed bytes in the order they appear in the file. */
+	
+	unsigned char bytes[8];
+	size_t n_bytes = (bits + 7) / 8;
+	
+	switch(endianness)
 	{
-		assert((bits % 8) == 0);
+		case Endianness::BIG:
+		{
+			raw <<= (n_bytes * 8) - bits;
 		
-		std::vector<bool> swapped;
-		swapped.reserve(bits);
+			for(size_t i = n_bytes; i > 0; --i)
+			{
+				bytes[i - 1] = raw & 0xFF;
+				raw >>= 8;
+			}
 		
-		for(int i = bits - 8; i >= 0; i -= 8)
-		{
-			swapped.insert(swapped.end(),
-				(data.begin() + i), (data.begin() + i + 8));
+			break;
 		}
 		
-		data = swapped;
+		case Endianness::LITTLE:
+		{
+			assert((bits % 8) == 0);
+			
+			for(size_t i = 0; i < n_bytes; ++i)
+			{
+				bytes[i] = raw & 0xFF;
+				raw >>= 8;
+			}
+			
+			break;
+		}
 	}
 	
-	return data;
+	return BitVector(bytes, 0, bits);
 }
 
 BEGIN_EVENT_TABLE(REHex::CustomNumericTypeDialog, wxDialog)
@@ -411,7 +410,7 @@ REHex::CustomNumericTypeRegion::CustomNumericTypeRegion(SharedDocumentPointer &d
 
 std::string REHex::CustomNumericTypeRegion::load_value() const
 {
-	std::vector<bool> data = doc->read_bits(d_offset, type.get_bits());
+	BitVector data = doc->read_bits(d_offset, type.get_bits());
 	if(data.size() != type.get_bits())
 	{
 		throw std::runtime_error("Unexpected end of file");
@@ -422,7 +421,7 @@ std::string REHex::CustomNumericTypeRegion::load_value() const
 
 bool REHex::CustomNumericTypeRegion::store_value(const std::string &value)
 {
-	std::vector<bool> data;
+	BitVector data;
 	try {
 		data = type.parse_value(value);
 	}
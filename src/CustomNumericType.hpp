@@ -22,6 +22,7 @@
 #include <wx/dialog.h>
 #include <wx/spinctrl.h>
 
+#include "BitVector.hpp"
 #include "DataType.hpp"
 #include "DocumentCtrl.hpp"
 #include "FixedSizeValueRegion.hpp"
@@ -91,12 +92,12 @@ namespace REHex
 			/**
 			 * @brief Decode and format the value as a string.
 			*/
-			std::string format_value(const std::vector<bool> &data) const;
+			std::string format_value(const BitVector &data) const;
 			
 			/**
 			 * @brief Parse and encode the value from a string.
 			*/
-			std::vector<bool> parse_value(const std::string &value) const;
+			BitVector parse_value(const std::string &value) const;
 			
 		private:
 			BaseType base_type;
@@ -47,6 +47,11 @@ namespace REHex
 			
 			virtual double get_progress() const = 0;
 			
+			/**
+			 * @brief Set the scheduling priority of the background processing.
+			*/
+			virtual void set_priority(ThreadPool::TaskPriority priority) = 0;
+			
 			virtual DataHistogramAccumulatorInterface *subdivide_bucket(size_t bucket_idx) const = 0;
 	};
 	
@@ -85,6 +90,8 @@ namespace REHex
 			
 			virtual double get_progress() const override;
 			
+			virtual void set_priority(ThreadPool::TaskPriority priority) override;
+			
 			virtual DataHistogramAccumulatorInterface *subdivide_bucket(size_t bucket_idx) const override;
 			
 		private:
@@ -342,6 +349,11 @@ template<typename T> double REHex::DataHistogramAccumulator<T>::get_progress() c
 	return (double)(processed) / (double)(length);
 }
 
+template<typename T> void REHex::DataHistogramAccumulator<T>::set_priority(ThreadPool::TaskPriority priority)
+{
+	rp->set_priority(priority);
+}
+
 template<typename T> REHex::DataHistogramAccumulatorInterface *REHex::DataHistogramAccumulator<T>::subdivide_bucket(size_t bucket_idx) const
 {
 	assert(bucket_idx < buckets.size());
@@ -416,6 +416,11 @@ void REHex::DataHistogramPanel::update()
 	dataset->DatasetChanged();
 }
 
+void REHex::DataHistogramPanel::visibility_changed()
+{
+	accumulator->set_priority(is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW);
+}
+
 void REHex::DataHistogramPanel::reset_accumulator()
 {
 	BitOffset range_offset, range_length;
@@ -425,6 +430,7 @@ void REHex::DataHistogramPanel::reset_accumulator()
 	assert(range_length.byte_aligned());
 	
 	accumulator.reset(new DataHistogramAccumulator<uint8_t>(document, range_offset.byte(), 1, range_length.byte(), 256));
+	accumulator->set_priority(is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW);
 	
 	spinner->Show();
 	spinner->Play();
@@ -54,6 +54,9 @@ namespace REHex {
 			
 			virtual wxSize DoGetBestClientSize() const override;
 			
+		protected:
+			virtual void visibility_changed() override;
+			
 		private:
 			SharedDocumentPointer document;
 			SafeWindowPointer<DocumentCtrl> document_ctrl;
@@ -69,6 +69,7 @@ REHex::DataMapScrollbar::DataMapScrollbar(wxWindow *parent, wxWindowID id, const
 	m_data_update_timer.Start(REDRAW_INTERVAL, wxTIMER_CONTINUOUS);
 	
 	this->document_ctrl.auto_cleanup_bind(SCROLL_UPDATE, &REHex::DataMapScrollbar::OnDocumentCtrlScroll, this);
+	this->document_ctrl.auto_cleanup_bind(SELECTION_MATCHES_UPDATED, &REHex::DataMapScrollbar::OnSelectionMatchesUpdated, this);
 	
 	SetMinSize(wxSize(40, 100));
 }
@@ -107,8 +108,23 @@ void REHex::DataMapScrollbar::OnPaint(wxPaintEvent &event)
 	int box_top_y = -1;
 	int box_bottom_y = -1;
 	
+	const SelectionMatchFinder *match_finder = document_ctrl->get_selection_match_finder();
+	wxPen match_pen((*active_palette)[Palette::PAL_SECONDARY_SELECTED_TEXT_BG], 1);
+	
 	for(int y = 0; y < client_size.GetHeight(); ++y)
 	{
+		/* Mark any data matching the selection in the right hand margin. */
+		if(match_finder != NULL && next_off < view->view_length())
+		{
+			off_t real_off = view->view_offset_to_real_offset(BitOffset(next_off, 0)).byte();
+			
+			if(match_finder->match_in(real_off, std::max<off_t>(bytes_per_y, 1)))
+			{
+				dc.SetPen(match_pen);
+				dc.DrawLine((client_size.GetWidth() - 3), y, client_size.GetWidth(), y);
+			}
+		}
+		
 		auto dm_it = m_data.get_range(BitOffset(next_off, 0));
 		if(dm_it != m_data.end())
 		{
@@ -293,6 +309,12 @@ void REHex::DataMapScrollbar::OnDocumentCtrlScroll(ScrollUpdateEvent &event)
 	event.Skip(); /* Continue propagation. */
 }
 
+void REHex::DataMapScrollbar::OnSelectionMatchesUpdated(wxCommandEvent &event)
+{
+	Refresh();
+	event.Skip(); /* Continue propagation. */
+}
+
 void REHex::DataMapScrollbar::OnSourceProcessing(wxCommandEvent &event)
 {
 	if(!(m_data_update_timer.IsRunning()))
@@ -60,6 +60,7 @@ namespace REHex {
 			void OnLeftUp(wxMouseEvent &event);
 			void OnMouseCaptureLost(wxMouseCaptureLostEvent &event);
 			void OnDocumentCtrlScroll(ScrollUpdateEvent &event);
+			void OnSelectionMatchesUpdated(wxCommandEvent &event);
 			void OnSourceProcessing(wxCommandEvent &event);
 			
 			/* Stays at the bottom because it changes the protection... */
@@ -55,7 +55,7 @@ std::vector<unsigned char> REHex::FlatDocumentView::read_data(BitOffset view_off
 	return document->read_data(view_offset, max_length);
 }
 
-std::vector<bool> REHex::FlatDocumentView::read_bits(BitOffset view_offset, size_t max_length) const
+REHex::BitVector REHex::FlatDocumentView::read_bits(BitOffset view_offset, size_t max_length) const
 {
 	return document->read_bits(view_offset, max_length);
 }
@@ -147,14 +147,14 @@ std::vector<unsigned char> REHex::FlatRangeView::read_data(BitOffset view_offset
 	return document->read_data((m_base_offset + view_offset), clamped_length);
 }
 
-std::vector<bool> REHex::FlatRangeView::read_bits(BitOffset view_offset, size_t max_length) const
+REHex::BitVector REHex::FlatRangeView::read_bits(BitOffset view_offset, size_t max_length) const
 {
 	assert(view_offset >= BitOffset::ZERO);
 	
 	BitOffset buffer_length_from_offset = std::max((BitOffset(view_length(), 0) - view_offset), BitOffset::ZERO);
 	if(buffer_length_from_offset < BitOffset::ZERO)
 	{
-		return std::vector<bool>();
+		return BitVector();
 	}
 	
 	int64_t blfo_bits = buffer_length_from_offset.total_bits();
@@ -457,17 +457,17 @@ std::vector<unsigned char> REHex::LinearVirtualDocumentView::read_data(BitOffset
 	return data;
 }
 
-std::vector<bool> REHex::LinearVirtualDocumentView::read_bits(BitOffset view_offset, size_t max_length) const
+REHex::BitVector REHex::LinearVirtualDocumentView::read_bits(BitOffset view_offset, size_t max_length) const
 {
-	std::vector<bool> data;
+	BitVector data;
 	
 	for(auto it = view_to_real_segs.get_range(view_offset.byte()); it != view_to_real_segs.end() && max_length > 0; ++it)
 	{
 		BitOffset seg_offset = view_offset - BitOffset(it->first.offset);
 		int64_t seg_read = std::min<int64_t>((BitOffset((it->first.offset + it->first.length), 0) - view_offset).total_bits(), max_length);
 		
-		std::vector<bool> seg_data = document->read_bits((BitOffset(it->second, 0) + seg_offset), seg_read);
-		data.insert(data.end(), seg_data.begin(), seg_data.end());
+		BitVector seg_data = document->read_bits((BitOffset(it->second, 0) + seg_offset), seg_read);
+		data.append(seg_data);
 		
 		max_length -= seg_read;
 		view_offset += BitOffset::from_int64(seg_read);
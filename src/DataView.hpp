@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "BitOffset.hpp"
+#include "BitVector.hpp"
 #include "ByteRangeMap.hpp"
 #include "ByteRangeSet.hpp"
 #include "Events.hpp"
@@ -79,7 +80,7 @@ namespace REHex
 			 * @param view_offset  Offset into the view to read from.
 			 * @param max_length   Maximum number of bits to read.
 			*/
-			virtual std::vector<bool> read_bits(BitOffset view_offset, size_t max_length) const = 0;
+			virtual BitVector read_bits(BitOffset view_offset, size_t max_length) const = 0;
 			
 			/**
 			 * @brief Convert a view offset into the real file offset.
@@ -117,7 +118,7 @@ namespace REHex
 			
 			virtual std::vector<unsigned char> read_data(BitOffset view_offset, off_t max_length) const override;
 			
-			virtual std::vector<bool> read_bits(BitOffset view_offset, size_t max_length) const override;
+			virtual BitVector read_bits(BitOffset view_offset, size_t max_length) const override;
 			
 			virtual BitOffset view_offset_to_real_offset(BitOffset view_offset) const override;
 			virtual BitOffset real_offset_to_view_offset(BitOffset real_offset) const override;
@@ -150,7 +151,7 @@ namespace REHex
 			
 			virtual std::vector<unsigned char> read_data(BitOffset view_offset, off_t max_length) const override;
 			
-			virtual std::vector<bool> read_bits(BitOffset view_offset, size_t max_length) const override;
+			virtual BitVector read_bits(BitOffset view_offset, size_t max_length) const override;
 			
 			virtual BitOffset view_offset_to_real_offset(BitOffset view_offset) const override;
 			virtual BitOffset real_offset_to_view_offset(BitOffset real_offset) const override;
@@ -191,7 +192,7 @@ namespace REHex
 			
 			virtual std::vector<unsigned char> read_data(BitOffset view_offset, off_t max_length) const override;
 			
-			virtual std::vector<bool> read_bits(BitOffset view_offset, size_t max_length) const override;
+			virtual BitVector read_bits(BitOffset view_offset, size_t max_length) const override;
 			
 			virtual BitOffset view_offset_to_real_offset(BitOffset view_offset) const override;
 			virtual BitOffset real_offset_to_view_offset(BitOffset real_offset) const override;
@@ -163,8 +163,8 @@ namespace REHex {
 			
 			bool recalc_bytes_per_line_pending;
 			
-			ByteRangeSet offsets_pending;    /**< Bytes which need to be processed (relative to Range base). */
-			ByteRangeSet offsets_different;  /**< Bytes which have been processed and have differences (relative to Range base). */
+			ByteRangeSet offsets_pending;           /**< Bytes which need to be processed (relative to Range base). */
+			ChunkedByteRangeSet offsets_different;  /**< Bytes which have been processed and have differences (relative to Range base). */
 			wxTimer update_regions_timer;
 			
 			off_t relative_cursor_pos;  /**< Current cursor position (relative to Range base). */
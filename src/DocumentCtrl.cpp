@@ -59,8 +59,15 @@ static_assert(std::numeric_limits<json_int_t>::max() >= std::numeric_limits<off_
 enum {
 	ID_REDRAW_CURSOR = 1,
 	ID_SELECT_TIMER,
+	ID_SELECTION_MATCH_TIMER,
 };
 
+/* Maximum length of a selection to search for matches of. */
+static const int SECONDARY_SELECTION_MAX = 4096;
+
+/* Interval between redraws while searching for data matching the selection. */
+static const int SELECTION_MATCH_REDRAW_INTERVAL = 250;
+
 BEGIN_EVENT_TABLE(REHex::DocumentCtrl, wxControl)
 	EVT_PAINT(REHex::DocumentCtrl::OnPaint)
 	EVT_ERASE_BACKGROUND(REHex::DocumentCtrl::OnErase)
@@ -75,6 +82,7 @@ BEGIN_EVENT_TABLE(REHex::DocumentCtrl, wxControl)
 	EVT_MOTION(REHex::DocumentCtrl::OnMotion)
 	EVT_TIMER(ID_SELECT_TIMER, REHex::DocumentCtrl::OnSelectTick)
 	EVT_TIMER(ID_REDRAW_CURSOR, REHex::DocumentCtrl::OnRedrawCursor)
+	EVT_TIMER(ID_SELECTION_MATCH_TIMER, REHex::DocumentCtrl::OnSelectionMatchTick)
 	EVT_IDLE(REHex::DocumentCtrl::OnIdle)
 	EVT_SET_FOCUS(REHex::DocumentCtrl::OnFocus)
 	EVT_KILL_FOCUS(REHex::DocumentCtrl::OnFocus)
@@ -84,6 +92,8 @@ REHex::DocumentCtrl::DocumentCtrl(wxWindow *parent, SharedDocumentPointer &doc,
 	wxControl(),
 	doc(doc),
 	hex_font(wxGetApp().settings->get_primary_font().create_font()),
+	selection_match_generation(0),
+	selection_match_timer(this, ID_SELECTION_MATCH_TIMER),
 	linked_scroll_prev(NULL),
 	linked_scroll_next(NULL),
 	selection_begin(BitOffset::INVALID),
@@ -100,6 +110,8 @@ REHex::DocumentCtrl::DocumentCtrl(wxWindow *parent, SharedDocumentPointer &doc,
 	
 	client_width      = 0;
 	client_height     = 0;
+	paint_y_begin     = 0;
+	paint_y_end       = 0;
 	visible_lines     = 1;
 	bytes_per_line    = BYTES_PER_LINE_FIT_BYTES;
 	bytes_per_group   = 4;
@@ -239,9 +251,63 @@ bool REHex::DocumentCtrl::get_highlight_selection_match()
 void REHex::DocumentCtrl::set_highlight_selection_match(bool highlight_selection_match)
 {
 	this->highlight_selection_match = highlight_selection_match;
+	
+	if(highlight_selection_match)
+	{
+		if(!selection_match_finder)
+		{
+			selection_match_finder.reset(new SelectionMatchFinder(doc));
+		}
+	}
+	else{
+		selection_match_finder.reset();
+		selection_match_timer.Stop();
+		
+		wxCommandEvent event(SELECTION_MATCHES_UPDATED);
+		event.SetEventObject(this);
+		
+		ProcessWindowEvent(event);
+	}
+	
 	Refresh();
 }
 
+const REHex::SelectionMatchFinder *REHex::DocumentCtrl::get_selection_match_finder() const
+{
+	return selection_match_finder.get();
+}
+
+void REHex::DocumentCtrl::_update_selection_match()
+{
+	if(!selection_match_finder)
+	{
+		return;
+	}
+	
+	BitOffset selection_off, selection_len;
+	std::tie(selection_off, selection_len) = get_selection_linear();
+	
+	std::vector<unsigned char> selection_data;
+	if(selection_len.byte() > 0 && selection_len.byte() <= SECONDARY_SELECTION_MAX && selection_len.byte_aligned())
+	{
+		try {
+			selection_data = doc->read_data(selection_off, selection_len.byte());
+		}
+		catch(const std::exception &e)
+		{
+			fprintf(stderr, "Exception in REHex::DocumentCtrl::_update_selection_match: %s\n", e.what());
+		}
+	}
+	
+	selection_match_finder->set_needle(selection_data);
+	
+	if((selection_match_finder->processing() || selection_match_finder->get_generation() != selection_match_generation)
+		&& !(selection_match_timer.IsRunning()))
+	{
+		selection_match_timer.Start(SELECTION_MATCH_REDRAW_INTERVAL, wxTIMER_CONTINUOUS);
+	}
+}
+
 std::shared_ptr<const REHex::ByteColourMap> REHex::DocumentCtrl::get_byte_colour_map() const
 {
 	return byte_colour_map;
@@ -352,14 +418,32 @@ void REHex::DocumentCtrl::set_cursor_position(BitOffset position, Document::Curs
 		cpos_next.clear();
 	}
 	
+	BitOffset old_cpos_off = cpos_off;
+	Document::CursorState old_cursor_state = this->cursor_state;
+	
+	int64_t old_scroll_yoff = scroll_yoff;
+	int old_scroll_xoff = scroll_xoff;
+	
 	cpos_off = position;
 	this->cursor_state = cursor_state;
 	
 	_make_byte_visible(cpos_off);
 	save_scroll_position();
 	
-	/* TODO: Limit paint to affected area */
-	Refresh();
+	/* If only the cursor has moved, we just need to redraw the lines it moved between. A
+	 * change in the active view changes how any selection is drawn, so that needs a full
+	 * redraw.
+	*/
+	
+	bool cursor_only = scroll_yoff == old_scroll_yoff
+		&& scroll_xoff == old_scroll_xoff
+		&& this->cursor_state == old_cursor_state
+		&& !has_selection();
+	
+	if(!cursor_only || !_refresh_cursor(old_cpos_off) || !_refresh_cursor(cpos_off))
+	{
+		Refresh();
+	}
 }
 
 bool REHex::DocumentCtrl::check_cursor_position(BitOffset position)
@@ -719,17 +803,35 @@ void REHex::DocumentCtrl::OnPaint(wxPaintEvent &event)
 		/* Control hasn't been set up yet. */
 		return;
 	}
+	
+	_update_selection_match();
 
 	wxBufferedPaintDC dc(this);
 	
+	/* Only draw the lines which need repainting, anything outside of the update region
+	 * won't make it to the screen anyway.
+	*/
+	
+	wxRect update_box = GetUpdateRegion().GetBox();
+	if(update_box.IsEmpty())
+	{
+		update_box = wxRect(0, 0, client_width, client_height);
+	}
+	
+	paint_y_begin = std::max(update_box.GetTop(), 0);
+	paint_y_end = std::min((update_box.GetBottom() + 1), client_height);
+	
+	dc.SetClippingRegion(update_box);
+	
 	dc.SetFont(hex_font);
 	
 	dc.SetBackground(wxBrush((*active_palette)[Palette::PAL_NORMAL_TEXT_BG]));
 	dc.Clear();
 	
-	/* Find the region containing the first visible line. */
-	auto base_region = region_by_y_offset(scroll_yoff);
-	int64_t yo_end = scroll_yoff + visible_lines + 1;
+	/* Find the region containing the first line to be drawn. */
+	int line_height = hex_font_cache->fixed_char_height();
+	auto base_region = region_by_y_offset(scroll_yoff + (paint_y_begin / line_height));
+	int64_t yo_end = scroll_yoff + (paint_y_end / line_height) + 1;
 	
 	/* Iterate over the visible regions and draw them. */
 	for(auto region = base_region; region != regions.end() && (*region)->y_offset < yo_end; ++region)
@@ -751,6 +853,9 @@ void REHex::DocumentCtrl::OnPaint(wxPaintEvent &event)
 	bool height_changed = false;
 	bool redraw = false;
 	
+	base_region = region_by_y_offset(scroll_yoff);
+	yo_end = scroll_yoff + visible_lines + 1;
+	
 	for(auto region = base_region; region != regions.end() && (*region)->y_offset < yo_end; ++region)
 	{
 		if(std::find_if(processing_regions.begin(), processing_regions.end(),
@@ -1115,6 +1220,87 @@ void REHex::DocumentCtrl::_update_vscroll_pos(bool update_linked_scroll_others)
 	}
 }
 
+void REHex::DocumentCtrl::_refresh_lines(int64_t line, int64_t count)
+{
+	int64_t begin = std::max(line, scroll_yoff);
+	int64_t end = std::min((line + count), (scroll_yoff + (int64_t)(visible_lines) + 1));
+	
+	if(begin < end)
+	{
+		int line_height = hex_font_cache->fixed_char_height();
+		RefreshRect(wxRect(0, ((begin - scroll_yoff) * line_height), client_width, ((end - begin) * line_height)), false);
+	}
+}
+
+bool REHex::DocumentCtrl::_refresh_cursor(BitOffset position)
+{
+	GenericDataRegion *dr = data_region_by_offset(position);
+	if(dr == NULL)
+	{
+		return false;
+	}
+	
+	Rect bounds = dr->calc_offset_bounds(position, this);
+	_refresh_lines(bounds.y, bounds.h);
+	
+	return true;
+}
+
+void REHex::DocumentCtrl::_scroll_refresh(int64_t old_scroll_yoff)
+{
+	int64_t scroll_lines = old_scroll_yoff - scroll_yoff;
+	
+	if(scroll_lines == 0)
+	{
+		return;
+	}
+	
+	if(scroll_lines > -(int64_t)(visible_lines) && scroll_lines < (int64_t)(visible_lines))
+	{
+		ScrollWindow(0, (scroll_lines * hex_font_cache->fixed_char_height()));
+	}
+	else{
+		Refresh();
+	}
+}
+
+void REHex::DocumentCtrl::refresh_range(BitOffset offset, BitOffset length)
+{
+	if(length <= BitOffset::ZERO)
+	{
+		return;
+	}
+	
+	if(highlight_selection_match && has_selection())
+	{
+		/* Any data on screen may have started or stopped matching the selection. */
+		Refresh();
+		return;
+	}
+	
+	/* Only plain data regions are known to lay out each line independently of the data,
+	 * anything else might need to move things around when it changes.
+	*/
+	
+	GenericDataRegion *dr = data_region_by_offset(offset);
+	
+	if(dr == NULL || dynamic_cast<DataRegion*>(dr) == NULL || (offset + length) > (dr->d_offset + dr->d_length))
+	{
+		Refresh();
+		return;
+	}
+	
+	/* Multi-byte characters in the text column may start before or run past the range. */
+	
+	BitOffset begin = std::max((offset - BitOffset::BYTES(MAX_CHAR_SIZE)), dr->d_offset);
+	BitOffset end = std::min((offset + length + BitOffset::BYTES(MAX_CHAR_SIZE)), (dr->d_offset + dr->d_length));
+	
+	Rect begin_bounds = dr->calc_offset_bounds(begin, this);
+	Rect end_bounds = dr->calc_offset_bounds(end, this);
+	
+	_refresh_lines(begin_bounds.y, ((end_bounds.y + end_bounds.h) - begin_bounds.y));
+}
+
 REHex::DocumentCtrl::FuzzyScrollPosition REHex::DocumentCtrl::get_scroll_position_fuzzy()
 {
 	FuzzyScrollPosition fsp;
@@ -1238,6 +1424,8 @@ void REHex::DocumentCtrl::OnScroll(wxScrollWinEvent &event)
 	
 	if(orientation == wxVERTICAL)
 	{
+		int64_t old_scroll_yoff = scroll_yoff;
+		
 		if(type == wxEVT_SCROLLWIN_THUMBTRACK || type == wxEVT_SCROLLWIN_THUMBRELEASE)
 		{
 			int position = event.GetPosition();
@@ -1288,7 +1476,7 @@ void REHex::DocumentCtrl::OnScroll(wxScrollWinEvent &event)
 		}
 		
 		_update_vscroll_pos();
-		Refresh();
+		_scroll_refresh(old_scroll_yoff);
 		
 		save_scroll_position();
 	}
@@ -1344,6 +1532,8 @@ void REHex::DocumentCtrl::OnWheel(wxMouseEvent &event)
 	
 	if(axis == wxMOUSE_WHEEL_VERTICAL)
 	{
+		int64_t old_scroll_yoff = scroll_yoff;
+		
 		wheel_vert_accum += event.GetWheelRotation();
 		
 		scroll_yoff -= (wheel_vert_accum / delta) * ticks_per_delta;
@@ -1360,7 +1550,7 @@ void REHex::DocumentCtrl::OnWheel(wxMouseEvent &event)
 		}
 		
 		_update_vscroll_pos();
-		Refresh();
+		_scroll_refresh(old_scroll_yoff);
 		
 		save_scroll_position();
 	}
@@ -2195,8 +2385,42 @@ void REHex::DocumentCtrl::OnRedrawCursor(wxTimerEvent &event)
 		redraw_cursor_timer.Start(time_until_flip, wxTIMER_ONE_SHOT);
 	}
 	
-	/* TODO: Limit paint to cursor area */
-	Refresh();
+	if(!_refresh_cursor(get_cursor_position()))
+	{
+		Refresh();
+	}
+}
+
+void REHex::DocumentCtrl::OnSelectionMatchTick(wxTimerEvent &event)
+{
+	if(!selection_match_finder)
+	{
+		selection_match_timer.Stop();
+		return;
+	}
+	
+	/* Check if the search has finished before fetching the generation so we don't miss
+	 * any results which come in between.
+	*/
+	bool finished = !(selection_match_finder->processing());
+	
+	unsigned int generation = selection_match_finder->get_generation();
+	if(generation != selection_match_generation)
+	{
+		selection_match_generation = generation;
+		
+		Refresh();
+		
+		wxCommandEvent update_event(SELECTION_MATCHES_UPDATED);
+		update_event.SetEventObject(this);
+		
+		ProcessWindowEvent(update_event);
+	}
+	
+	if(finished)
+	{
+		selection_match_timer.Stop();
+	}
 }
 
 void REHex::DocumentCtrl::OnIdle(wxIdleEvent &event)
@@ -3428,7 +3652,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	/* If we are scrolled part-way into a data region, don't render data above the client area
 	 * as it would get expensive very quickly with large files.
 	*/
-	int64_t skip_lines = (y < 0 ? (-y / fcc.fixed_char_height()) : 0);
+	int64_t skip_lines = (y < doc.paint_y_begin ? ((doc.paint_y_begin - y) / fcc.fixed_char_height()) : 0);
 	off_t skip_bytes  = skip_lines * bytes_per_line_actual;
 	
 	wxPen norm_fg_1px((*active_palette)[Palette::PAL_NORMAL_TEXT_FG], 1);
@@ -3465,7 +3689,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	 * of the client area. Drawing more than this would be pointless and very expensive in the
 	 * case of large files.
 	*/
-	int max_lines = ((doc.client_height - y) / fcc.fixed_char_height()) + 1;
+	int max_lines = ((doc.paint_y_end - y) / fcc.fixed_char_height()) + 1;
 	off_t max_bytes = (off_t)(max_lines) * (off_t)(bytes_per_line_actual);
 	
 	if((int64_t)(max_lines) > (y_lines - indent_final - skip_lines))
@@ -3489,21 +3713,16 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 		dc.DrawLine(ascii_vl_x, y, ascii_vl_x, y + (max_lines * fcc.fixed_char_height()));
 	}
 	
-	static const int SECONDARY_SELECTION_MAX = 4096;
+	/* The selected data is searched for by selection_match_finder, which was pointed at
+	 * the current selection before painting began.
+	*/
 	
-	BitOffset linear_selection_off, linear_selection_len;
-	std::tie(linear_selection_off, linear_selection_len) = doc.get_selection_linear();
+	const SelectionMatchFinder *match_finder = doc.selection_match_finder.get();
 	
 	std::vector<unsigned char> selection_data;
-	if(doc.get_highlight_selection_match() && linear_selection_len.byte() > 0 && linear_selection_len.byte() <= SECONDARY_SELECTION_MAX && linear_selection_len.byte_aligned())
+	if(match_finder != NULL)
 	{
-		try {
-			selection_data = doc.doc->read_data(linear_selection_off, linear_selection_len.byte());
-		}
-		catch(const std::exception &e)
-		{
-			fprintf(stderr, "Exception in REHex::Document::Region::Data::draw: %s\n", e.what());
-		}
+		selection_data = match_finder->get_needle();
 	}
 	
 	/* Fetch the data to be drawn. */
@@ -3537,15 +3756,26 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 		
 		if(!selection_data.empty())
 		{
-			for(size_t i = 0; (i + selection_data.size()) <= data.size();)
+			if(data_base.byte_aligned() && match_finder->complete_in(data_base.byte(), data.size()))
 			{
-				if(memcmp((data.data() + i), selection_data.data(), selection_data.size()) == 0)
+				ByteRangeSet matches = match_finder->get_matches_in(data_base.byte(), data.size());
+				
+				for(auto r = matches.begin(); r != matches.end(); ++r)
 				{
-					ranges_matching_selection.set_range(data_base + BitOffset(i, 0), selection_data.size());
-					i += selection_data.size();
+					ranges_matching_selection.set_range(BitOffset(r->offset, 0), BitOffset(r->length, 0));
 				}
-				else{
-					++i;
+			}
+			else{
+				/* The background search hasn't got here yet (or gave up), search the
+				 * data we are about to draw so matches appear immediately.
+				*/
+				
+				for(size_t i = 0; (i + selection_data.size()) <= data.size(); ++i)
+				{
+					if(memcmp((data.data() + i), selection_data.data(), selection_data.size()) == 0)
+					{
+						ranges_matching_selection.set_range(data_base + BitOffset(i, 0), selection_data.size());
+					}
 				}
 			}
 		}
@@ -3563,41 +3793,73 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	/* The offset of the character in the Buffer currently being drawn. */
 	BitOffset cur_off = d_offset + BitOffset::BYTES(skip_bytes);
 	
-	wxSize client_size = doc.GetClientSize();
+	/* Resolve the highlighting of everything we might draw up front, rather than querying
+	 * each source of highlighting for every nibble/character.
+	*/
+	
+	HighlightRuns hex_highlights, ascii_highlights;
 	
-	auto highlight_func = [&](BitOffset offset, BitOffset dirty_check_length)
 	{
-		if(ranges_matching_selection.isset(offset))
+		PROFILE_INNER_BLOCK("resolve highlights");
+		
+		BitOffset resolve_length = BitOffset::BYTES(data_to_draw);
+		
+		resolve_highlights(cur_off, resolve_length, BitOffset(0, 4), &doc, hex_highlights);
+		
+		if(doc.show_ascii)
 		{
-			return Highlight(
-				(*active_palette)[Palette::PAL_SECONDARY_SELECTED_TEXT_FG],
-				(*active_palette)[Palette::PAL_SECONDARY_SELECTED_TEXT_BG]);
+			resolve_highlights(cur_off, resolve_length, BitOffset(1, 0), &doc, ascii_highlights);
 		}
-		else{
-			Highlight h = highlight_at_off(offset, dirty_check_length, &doc);
-			if(h.enable)
-			{
-				return h;
-			}
+		
+		const Highlight secondary_selection_highlight(
+			(*active_palette)[Palette::PAL_SECONDARY_SELECTED_TEXT_FG],
+			(*active_palette)[Palette::PAL_SECONDARY_SELECTED_TEXT_BG]);
+		
+		BitOffset resolve_end = cur_off + resolve_length;
+		
+		for(auto r = ranges_matching_selection.begin(); r != ranges_matching_selection.end(); ++r)
+		{
+			BitOffset r_begin = std::max(r->offset, cur_off);
+			BitOffset r_end = std::min((r->offset + r->length), resolve_end);
 			
-			auto byte_colour_map = doc.get_byte_colour_map();
-			if(byte_colour_map)
+			if(r_begin < r_end)
 			{
-				BitOffset offset_within_data = offset - data_base;
-				assert(offset_within_data >= BitOffset::ZERO);
+				hex_highlights.set_range(r_begin, (r_end - r_begin), secondary_selection_highlight);
 				
-				if(offset_within_data.byte() < (off_t)(data.size()))
+				if(doc.show_ascii)
 				{
-					unsigned char byte = data[offset_within_data.byte()];
-					
-					return Highlight(
-						byte_colour_map->get_colour(byte),
-						(*active_palette)[Palette::PAL_NORMAL_TEXT_BG]);
+					ascii_highlights.set_range(r_begin, (r_end - r_begin), secondary_selection_highlight);
 				}
 			}
+		}
+	}
+	
+	auto byte_colour_map = doc.get_byte_colour_map();
+	
+	auto highlight_func = [&](HighlightRuns &highlights, BitOffset offset)
+	{
+		const Highlight *h = highlights.get(offset);
+		if(h != NULL)
+		{
+			return *h;
+		}
+		
+		if(byte_colour_map)
+		{
+			BitOffset offset_within_data = offset - data_base;
+			assert(offset_within_data >= BitOffset::ZERO);
 			
-			return Highlight(NoHighlight());
+			if(offset_within_data.byte() < (off_t)(data.size()))
+			{
+				unsigned char byte = data[offset_within_data.byte()];
+				
+				return Highlight(
+					byte_colour_map->get_colour(byte),
+					(*active_palette)[Palette::PAL_NORMAL_TEXT_BG]);
+			}
 		}
+		
+		return Highlight(NoHighlight());
 	};
 	
 	BitOffset scoped_selection_offset, scoped_selection_length;
@@ -3618,7 +3880,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 			return hex_selection_highlight;
 		}
 		else{
-			return highlight_func(offset, BitOffset(0, 4));
+			return highlight_func(hex_highlights, offset);
 		}
 	};
 	
@@ -3635,7 +3897,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 			return ascii_selection_highlight;
 		}
 		else{
-			return highlight_func(offset, BitOffset(1, 0));
+			return highlight_func(ascii_highlights, offset);
 		}
 	};
 	
@@ -3649,7 +3911,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	/* NOTE: Checks for cur_off < file_size to avoid running off the end of the file if we happen
 	 * to be doing a paint between the file size changing and the regions being updated.
 	*/
-	while(y < client_size.GetHeight() && cur_line < (y_offset + y_lines - indent_final) && cur_off <= file_size)
+	while(y < doc.paint_y_end && cur_line < (y_offset + y_lines - indent_final) && cur_off <= file_size)
 	{
 		if(doc.offset_column)
 		{
@@ -3707,6 +3969,65 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	}
 }
 
+REHex::DocumentCtrl::Region::HighlightRuns::HighlightRuns():
+	cursor(runs.begin()) {}
+
+void REHex::DocumentCtrl::Region::HighlightRuns::set_range(BitOffset offset, BitOffset length, const Highlight &highlight)
+{
+	assert(highlight.enable);
+	
+	if(length <= BitOffset::ZERO)
+	{
+		return;
+	}
+	
+	/* There are only ever a handful of distinct highlights, so we store each once and map
+	 * ranges to their index, allowing adjacent ranges of the same highlight to merge.
+	*/
+	
+	size_t idx = 0;
+	while(idx < highlights.size() && (highlights[idx].fg_colour != highlight.fg_colour || highlights[idx].bg_colour != highlight.bg_colour))
+	{
+		++idx;
+	}
+	
+	if(idx == highlights.size())
+	{
+		highlights.push_back(highlight);
+	}
+	
+	runs.set_range(offset, length, idx);
+	cursor = runs.begin();
+}
+
+const REHex::DocumentCtrl::Region::Highlight *REHex::DocumentCtrl::Region::HighlightRuns::get(BitOffset offset)
+{
+	if(cursor != runs.begin() && (std::prev(cursor)->first.offset + std::prev(cursor)->first.length) > offset)
+	{
+		/* Went backwards, search from the start. */
+		
+		cursor = std::upper_bound(runs.begin(), runs.end(), offset,
+			[](BitOffset offset, const std::pair<BitRangeMap<size_t>::Range, size_t> &run)
+			{
+				return offset < (run.first.offset + run.first.length);
+			});
+	}
+	else{
+		while(cursor != runs.end() && (cursor->first.offset + cursor->first.length) <= offset)
+		{
+			++cursor;
+		}
+	}
+	
+	if(cursor != runs.end() && cursor->first.offset <= offset)
+	{
+		return &(highlights[cursor->second]);
+	}
+	else{
+		return NULL;
+	}
+}
+
 void REHex::DocumentCtrl::Region::draw_hex_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const unsigned char *data, size_t data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line)
 {
 	PROFILE_BLOCK("REHex::DocumentCtrl:Region::draw_hex_line");
@@ -4096,7 +4417,7 @@ void REHex::DocumentCtrl::Region::draw_ascii_line(DocumentCtrl *doc_ctrl, wxDC &
 	}
 }
 
-void REHex::DocumentCtrl::Region::draw_bin_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const std::vector<bool> &data, BitOffset data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line)
+void REHex::DocumentCtrl::Region::draw_bin_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const BitVector &data, BitOffset data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line)
 {
 	PROFILE_BLOCK("REHex::DocumentCtrl:Region::draw_bin_line");
 	
@@ -4916,6 +5237,20 @@ REHex::DocumentCtrl::DataRegion::Highlight REHex::DocumentCtrl::DataRegion::high
 	return NoHighlight();
 }
 
+void REHex::DocumentCtrl::DataRegion::resolve_highlights(BitOffset offset, BitOffset length, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl, HighlightRuns &runs) const
+{
+	BitOffset end = offset + length;
+	
+	for(BitOffset off = offset; off < end; off += dirty_check_length)
+	{
+		Highlight h = highlight_at_off(off, dirty_check_length, doc_ctrl);
+		if(h.enable)
+		{
+			runs.set_range(off, dirty_check_length, h);
+		}
+	}
+}
+
 REHex::DocumentCtrl::DataRegionDocHighlight::DataRegionDocHighlight(SharedDocumentPointer &document, BitOffset d_offset, BitOffset d_length, BitOffset virt_offset):
 	DataRegion(document, d_offset, d_length, virt_offset) {}
 
@@ -4977,6 +5312,80 @@ REHex::DocumentCtrl::DataRegion::Highlight REHex::DocumentCtrl::DataRegionDocHig
 	return NoHighlight();
 }
 
+void REHex::DocumentCtrl::DataRegionDocHighlight::resolve_highlights(BitOffset offset, BitOffset length, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl, HighlightRuns &runs) const
+{
+	PROFILE_BLOCK("REHex::DocumentCtrl::DataRegionDocHighlight::resolve_highlights");
+	
+	BitOffset end = offset + length;
+	
+	/* Dirty bytes first, since they are overridden by highlights. */
+	
+	bool dirty_enabled = false, dirty_inverted = false;
+	
+	DirtyByteDisplayMode dbd = wxGetApp().settings->get_dirty_byte_display_mode();
+	switch(dbd)
+	{
+		case DirtyByteDisplayMode::NORMAL:
+			break;
+			
+		case DirtyByteDisplayMode::COLOURED_UNLESS_BCM:
+			dirty_enabled = doc_ctrl->get_byte_colour_map() == nullptr;
+			break;
+			
+		case DirtyByteDisplayMode::COLOURED:
+			dirty_enabled = true;
+			break;
+			
+		case DirtyByteDisplayMode::INVERTED_UNLESS_BCM:
+			dirty_enabled = doc_ctrl->get_byte_colour_map() == nullptr;
+			dirty_inverted = true;
+			break;
+			
+		case DirtyByteDisplayMode::INVERTED:
+			dirty_enabled = true;
+			dirty_inverted = true;
+			break;
+	}
+	
+	if(dirty_enabled)
+	{
+		const Highlight dirty_highlight = dirty_inverted
+			? Highlight((*active_palette)[Palette::PAL_DIRTY_TEXT_BG], (*active_palette)[Palette::PAL_DIRTY_TEXT_FG])
+			: Highlight((*active_palette)[Palette::PAL_DIRTY_TEXT_FG], (*active_palette)[Palette::PAL_DIRTY_TEXT_BG]);
+		
+		off_t dirty_check_base = offset.byte();
+		off_t dirty_check_end = (end + dirty_check_length).byte_round_up();
+		
+		ByteRangeSet dirty = document->get_dirty_ranges(dirty_check_base, (dirty_check_end - dirty_check_base));
+		for(auto r = dirty.begin(); r != dirty.end(); ++r)
+		{
+			/* Anything drawn overlapping the start of a dirty byte is drawn as dirty,
+			 * so each range extends back to the first offset of that which overlaps it.
+			*/
+			
+			BitOffset dirty_begin = std::max((BitOffset(r->offset, 0) - dirty_check_length + BitOffset(0, 1)), offset);
+			BitOffset dirty_end = std::min(BitOffset((r->offset + r->length), 0), end);
+			
+			runs.set_range(dirty_begin, (dirty_end - dirty_begin), dirty_highlight);
+		}
+	}
+	
+	const BitRangeMap<int> &highlights = document->get_highlights();
+	const HighlightColourMap &highlight_colours = document->get_highlight_colours();
+	
+	for(auto h = highlights.get_range_in(offset, length); h != highlights.end() && h->first.offset < end; ++h)
+	{
+		auto hc = highlight_colours.find(h->second);
+		if(hc != highlight_colours.end())
+		{
+			BitOffset h_begin = std::max(h->first.offset, offset);
+			BitOffset h_end = std::min((h->first.offset + h->first.length), end);
+			
+			runs.set_range(h_begin, (h_end - h_begin), Highlight(hc->second.secondary_colour, hc->second.primary_colour));
+		}
+	}
+}
+
 REHex::DocumentCtrl::CommentRegion::CommentRegion(BitOffset c_offset, BitOffset c_length, const wxString &c_text, bool truncate, BitOffset indent_offset, BitOffset indent_length):
 	Region(indent_offset, indent_length),
 	c_offset(c_offset),
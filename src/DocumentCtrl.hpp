@@ -30,8 +30,10 @@
 #include <wx/wx.h>
 
 #include "BitOffset.hpp"
+#include "BitVector.hpp"
 #include "buffer.hpp"
 #include "ByteColourMap.hpp"
+#include "ByteRangeMap.hpp"
 #include "ByteRangeSet.hpp"
 #include "CharacterFinder.hpp"
 #include "document.hpp"
@@ -40,6 +42,7 @@
 #include "LRUCache.hpp"
 #include "NestedOffsetLengthMap.hpp"
 #include "Palette.hpp"
+#include "SelectionMatchFinder.hpp"
 #include "SharedDocumentPointer.hpp"
 #include "util.hpp"
 
@@ -142,9 +145,45 @@ namespace REHex {
 						NoHighlight(): Highlight() {}
 					};
 					
+					/**
+					 * @brief Highlight colours resolved over a range of offsets.
+					 *
+					 * DataRegion builds these for the visible part of the region once
+					 * per draw, so each nibble/character being drawn only needs to step
+					 * through a list of runs rather than consulting every highlight
+					 * source individually.
+					*/
+					class HighlightRuns
+					{
+						public:
+							HighlightRuns();
+							
+							/**
+							 * @brief Apply a highlight to a range.
+							 *
+							 * Any highlight previously applied to the range is replaced,
+							 * so sources should be applied in increasing order of priority.
+							*/
+							void set_range(BitOffset offset, BitOffset length, const Highlight &highlight);
+							
+							/**
+							 * @brief Get the highlight at an offset, NULL if none.
+							 *
+							 * Lookups are fastest when made in ascending order.
+							*/
+							const Highlight *get(BitOffset offset);
+							
+						private:
+							std::vector<Highlight> highlights;
+							BitRangeMap<size_t> runs;
+							
+							/* First run which ends after the last looked up offset. */
+							BitRangeMap<size_t>::const_iterator cursor;
+					};
+					
 					static void draw_hex_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const unsigned char *data, size_t data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line);
 					static void draw_ascii_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const unsigned char *data, size_t data_len, size_t data_extra_pre, size_t data_extra_post, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line);
-					static void draw_bin_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const std::vector<bool> &data, BitOffset data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line);
+					static void draw_bin_line(DocumentCtrl *doc_ctrl, wxDC &dc, int x, int y, const BitVector &data, BitOffset data_len, unsigned int pad_bytes, BitOffset base_off, bool alternate_row, bool has_focus, bool view_active, const std::function<Highlight(BitOffset)> &highlight_at_off, bool is_last_line);
 					
 					/**
 					 * @brief Calculate offset of byte at X co-ordinate.
@@ -375,6 +414,21 @@ namespace REHex {
 					
 					virtual Highlight highlight_at_off(BitOffset off, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl) const;
 					
+					/**
+					 * @brief Resolve the highlighting of a range of the region for drawing.
+					 *
+					 * @param offset              Offset of the range to resolve.
+					 * @param length              Length of the range to resolve.
+					 * @param dirty_check_length  Length of each nibble/character which will be drawn.
+					 * @param doc_ctrl            The parent DocumentCtrl.
+					 * @param runs                HighlightRuns to apply highlights to.
+					 *
+					 * The default implementation calls highlight_at_off() at every
+					 * dirty_check_length step through the range. Subclasses can
+					 * override this to apply whole ranges at once.
+					*/
+					virtual void resolve_highlights(BitOffset offset, BitOffset length, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl, HighlightRuns &runs) const;
+					
 				private:
 					std::unique_ptr<CharacterFinder> char_finder;
 					std::pair<BitOffset,off_t> get_char_at(BitOffset offset);
@@ -389,6 +443,7 @@ namespace REHex {
 					
 				protected:
 					virtual Highlight highlight_at_off(BitOffset off, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl) const override;
+					virtual void resolve_highlights(BitOffset offset, BitOffset length, BitOffset dirty_check_length, DocumentCtrl *doc_ctrl, HighlightRuns &runs) const override;
 			};
 			
 			class CommentRegion: public Region
@@ -436,6 +491,13 @@ namespace REHex {
 			bool get_highlight_selection_match();
 			void set_highlight_selection_match(bool highlight_selection_match);
 			
+			/**
+			 * @brief Get the background search for data matching the selection.
+			 *
+			 * Returns NULL if highlighting data matching the selection is disabled.
+			*/
+			const SelectionMatchFinder *get_selection_match_finder() const;
+			
 			std::shared_ptr<const ByteColourMap> get_byte_colour_map() const;
 			void set_byte_colour_map(const std::shared_ptr<const ByteColourMap> &map);
 			
@@ -458,6 +520,14 @@ namespace REHex {
 			bool get_insert_mode();
 			void set_insert_mode(bool enabled);
 			
+			/**
+			 * @brief Redraw the lines displaying a range of data.
+			 *
+			 * Redraws the whole control instead if the change could affect anything
+			 * other than the lines displaying the range.
+			*/
+			void refresh_range(BitOffset offset, BitOffset length);
+			
 			void linked_scroll_insert_self_after(DocumentCtrl *p);
 			void linked_scroll_remove_self();
 
@@ -641,6 +711,7 @@ namespace REHex {
 			void OnSelectTick(wxTimerEvent &event);
 			void OnMotionTick(int mouse_x, int mouse_y);
 			void OnRedrawCursor(wxTimerEvent &event);
+			void OnSelectionMatchTick(wxTimerEvent &event);
 			void OnClearHighlight(wxCommandEvent &event);
 			void OnIdle(wxIdleEvent &event);
 			void OnFontChanged(wxCommandEvent &event);
@@ -673,6 +744,12 @@ namespace REHex {
 			int client_width;
 			int client_height;
 			
+			/* Vertical extent of the area being redrawn by OnPaint(), in pixels. Regions
+			 * may skip drawing anything outside of it.
+			*/
+			int paint_y_begin;
+			int paint_y_end;
+			
 			/* Height of client area in lines. */
 			unsigned int visible_lines;
 			
@@ -692,6 +769,10 @@ namespace REHex {
 			bool highlight_selection_match;
 			std::shared_ptr<const ByteColourMap> byte_colour_map;
 			
+			std::unique_ptr<SelectionMatchFinder> selection_match_finder;
+			unsigned int selection_match_generation;
+			wxTimer selection_match_timer;
+			
 			int     scroll_xoff;
 			int64_t scroll_yoff;
 			int64_t scroll_yoff_max;
@@ -745,6 +826,25 @@ namespace REHex {
 			void _update_vscroll();
 			void _update_vscroll_pos(bool update_linked_scroll_others = true);
 			
+			void _refresh_lines(int64_t line, int64_t count);
+			bool _refresh_cursor(BitOffset position);
+			
+			/**
+			 * @brief Repaint the control after a change to scroll_yoff.
+			 *
+			 * If the control has been scrolled by less than a screenful, the existing
+			 * content is moved and only the newly exposed lines are redrawn.
+			*/
+			void _scroll_refresh(int64_t old_scroll_yoff);
+			
+			/**
+			 * @brief Point selection_match_finder at the currently selected data.
+			 *
+			 * Called before painting so the search follows both changes to the
+			 * selection and edits to the selected data.
+			*/
+			void _update_selection_match();
+			
 			/**
 			 * @brief Fuzzy description of the DocumentCtrl scroll position.
 			 *
@@ -0,0 +1,299 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <iterator>
+#include <portable_endian.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DocumentReader.hpp"
+#include "profile.hpp"
+
+constexpr size_t REHex::DocumentReader::READ_AHEAD;
+
+REHex::DocumentReader::NumberType REHex::DocumentReader::NumberType::parse(const std::string &name)
+{
+	NumberType type;
+	
+	if(name.length() < 2)
+	{
+		throw std::invalid_argument("Unknown number type '" + name + "'");
+	}
+	
+	switch(name[0])
+	{
+		case 'u':
+			type.kind = UNSIGNED;
+			break;
+		
+		case 's':
+			type.kind = SIGNED;
+			break;
+		
+		case 'f':
+			type.kind = FLOAT;
+			break;
+		
+		default:
+			throw std::invalid_argument("Unknown number type '" + name + "'");
+	}
+	
+	/* Single byte types have no endianness suffix, everything else must have one. */
+	
+	std::string bits = name.substr(1);
+	type.big_endian = false;
+	
+	if(bits != "8")
+	{
+		if(bits.length() > 2 && bits.compare(bits.length() - 2, 2, "le") == 0)
+		{
+			type.big_endian = false;
+		}
+		else if(bits.length() > 2 && bits.compare(bits.length() - 2, 2, "be") == 0)
+		{
+			type.big_endian = true;
+		}
+		else{
+			throw std::invalid_argument("Unknown number type '" + name + "'");
+		}
+		
+		bits.erase(bits.length() - 2);
+	}
+	
+	if(name.length() == 2 && bits == "8" && type.kind != FLOAT)
+	{
+		type.size = 1;
+	}
+	else if(bits == "16" && type.kind != FLOAT)
+	{
+		type.size = 2;
+	}
+	else if(bits == "32")
+	{
+		type.size = 4;
+	}
+	else if(bits == "64")
+	{
+		type.size = 8;
+	}
+	else{
+		throw std::invalid_argument("Unknown number type '" + name + "'");
+	}
+	
+	return type;
+}
+
+int64_t REHex::DocumentReader::NumberType::decode_integer(const unsigned char *data) const
+{
+	assert(kind != FLOAT);
+	
+	switch(size)
+	{
+		case 1:
+			return kind == SIGNED
+				? (int64_t)(*(const int8_t*)(data))
+				: (int64_t)(*data);
+		
+		case 2:
+		{
+			uint16_t u16;
+			memcpy(&u16, data, 2);
+			u16 = big_endian ? be16toh(u16) : le16toh(u16);
+			
+			return kind == SIGNED
+				? (int64_t)((int16_t)(u16))
+				: (int64_t)(u16);
+		}
+		
+		case 4:
+		{
+			uint32_t u32;
+			memcpy(&u32, data, 4);
+			u32 = big_endian ? be32toh(u32) : le32toh(u32);
+			
+			return kind == SIGNED
+				? (int64_t)((int32_t)(u32))
+				: (int64_t)(u32);
+		}
+		
+		case 8:
+		{
+			uint64_t u64;
+			memcpy(&u64, data, 8);
+			u64 = big_endian ? be64toh(u64) : le64toh(u64);
+			
+			return (int64_t)(u64);
+		}
+		
+		default:
+			abort();
+	}
+}
+
+double REHex::DocumentReader::NumberType::decode_float(const unsigned char *data) const
+{
+	if(kind != FLOAT)
+	{
+		return kind == UNSIGNED
+			? (double)((uint64_t)(decode_integer(data)))
+			: (double)(decode_integer(data));
+	}
+	
+	if(size == 4)
+	{
+		uint32_t u32;
+		memcpy(&u32, data, 4);
+		u32 = big_endian ? be32toh(u32) : le32toh(u32);
+		
+		float f;
+		memcpy(&f, &u32, 4);
+		
+		return f;
+	}
+	else{
+		assert(size == 8);
+		
+		uint64_t u64;
+		memcpy(&u64, data, 8);
+		u64 = big_endian ? be64toh(u64) : le64toh(u64);
+		
+		double d;
+		memcpy(&d, &u64, 8);
+		
+		return d;
+	}
+}
+
+REHex::DocumentReader::DocumentReader(const Document *doc, BitOffset offset):
+	doc(doc),
+	buffer_base(std::max(offset, BitOffset::ZERO)),
+	buffer_pos(0) {}
+
+void REHex::DocumentReader::seek(BitOffset offset)
+{
+	offset = std::max(offset, BitOffset::ZERO);
+	
+	if(offset >= buffer_base)
+	{
+		BitOffset rel = offset - buffer_base;
+		
+		if(rel.byte_aligned() && rel.byte() <= (off_t)(buffer.size()))
+		{
+			buffer_pos = rel.byte();
+			return;
+		}
+	}
+	
+	buffer.clear();
+	buffer_base = offset;
+	buffer_pos = 0;
+}
+
+bool REHex::DocumentReader::eof()
+{
+	return buffer_pos >= buffer.size()
+		&& (tell() + BitOffset(1, 0)) > BitOffset(doc->buffer_length(), 0);
+}
+
+const unsigned char *REHex::DocumentReader::read_slow(size_t length, size_t *read_length)
+{
+	PROFILE_BLOCK("REHex::DocumentReader::read_slow");
+	
+	/* Discard the data we've already consumed and append the next block to what's left. */
+	
+	buffer.erase(buffer.begin(), std::next(buffer.begin(), buffer_pos));
+	buffer_base += BitOffset(buffer_pos, 0);
+	buffer_pos = 0;
+	
+	size_t want = std::max(READ_AHEAD, (length - buffer.size()));
+	std::vector<unsigned char> block = doc->read_data((buffer_base + BitOffset(buffer.size(), 0)), want);
+	
+	if(buffer.empty())
+	{
+		buffer = std::move(block);
+	}
+	else{
+		buffer.insert(buffer.end(), block.begin(), block.end());
+	}
+	
+	*read_length = std::min(length, buffer.size());
+	buffer_pos = *read_length;
+	
+	return buffer.data();
+}
+
+template<typename T, typename F> size_t REHex::DocumentReader::read_numbers(const NumberType &type, size_t count, std::vector<T> *values, const F &decode)
+{
+	/* Don't trust count when reserving space, it may come from a script. */
+	off_t remain = std::max<off_t>((doc->buffer_length() - tell().byte()), 0);
+	values->reserve(values->size() + std::min<size_t>(count, (remain / type.size)));
+	
+	size_t n = 0;
+	
+	while(n < count)
+	{
+		size_t buffered = (buffer.size() - buffer_pos) / type.size;
+		
+		if(buffered == 0)
+		{
+			/* Fetch the next block, then decode the rest from it directly. */
+			
+			size_t got;
+			const unsigned char *data = read_slow(type.size, &got);
+			
+			if(got < type.size)
+			{
+				buffer_pos -= got;
+				break;
+			}
+			
+			values->push_back(decode(data));
+			++n;
+			
+			continue;
+		}
+		
+		size_t batch = std::min(buffered, (count - n));
+		
+		for(size_t i = 0; i < batch; ++i)
+		{
+			values->push_back(decode(buffer.data() + buffer_pos));
+			buffer_pos += type.size;
+		}
+		
+		n += batch;
+	}
+	
+	return n;
+}
+
+size_t REHex::DocumentReader::read_integers(const NumberType &type, size_t count, std::vector<int64_t> *values)
+{
+	assert(type.kind != NumberType::FLOAT);
+	
+	return read_numbers(type, count, values, [&type](const unsigned char *data) { return type.decode_integer(data); });
+}
+
+size_t REHex::DocumentReader::read_floats(const NumberType &type, size_t count, std::vector<double> *values)
+{
+	return read_numbers(type, count, values, [&type](const unsigned char *data) { return type.decode_float(data); });
+}
@@ -0,0 +1,158 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_DOCUMENTREADER_HPP
+#define REHEX_DOCUMENTREADER_HPP
+
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "BitOffset.hpp"
+#include "document.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Sequential reader over the data in a Document.
+	 *
+	 * Reads data from the Document in large blocks and hands out pointers into the
+	 * current block, so a parser reading one small field at a time doesn't need a
+	 * round trip to the Document (and a new vector) for each field.
+	 *
+	 * Data is cached, so a DocumentReader shouldn't be used after the Document has
+	 * been modified - create a new one instead.
+	*/
+	class DocumentReader
+	{
+		public:
+			/**
+			 * @brief A fixed-size integer or floating point number format.
+			 *
+			 * The names match the equivalent data types ("u8", "s16le", "f64be", etc).
+			*/
+			struct NumberType
+			{
+				enum Kind { UNSIGNED, SIGNED, FLOAT };
+				
+				Kind kind;
+				size_t size;       /**< Size in bytes (1, 2, 4 or 8). */
+				bool big_endian;
+				
+				/**
+				 * @brief Get the NumberType with the given name.
+				 *
+				 * Throws std::invalid_argument if the name isn't recognised.
+				*/
+				static NumberType parse(const std::string &name);
+				
+				/**
+				 * @brief Decode an integer value of this type.
+				 *
+				 * Unsigned 64-bit values above INT64_MAX wrap around, like
+				 * string.unpack() in Lua. Must not be called on FLOAT types.
+				*/
+				int64_t decode_integer(const unsigned char *data) const;
+				
+				/**
+				 * @brief Decode a value of this type as a double.
+				*/
+				double decode_float(const unsigned char *data) const;
+			};
+			
+			/**
+			 * @brief Size of the blocks read from the Document.
+			*/
+			static constexpr size_t READ_AHEAD = 64 * 1024; /* 64KiB */
+			
+			/**
+			 * @brief Create a reader starting from the given offset.
+			*/
+			DocumentReader(const Document *doc, BitOffset offset = BitOffset::ZERO);
+			
+			/**
+			 * @brief Get the current read position.
+			*/
+			BitOffset tell() const
+			{
+				return buffer_base + BitOffset(buffer_pos, 0);
+			}
+			
+			/**
+			 * @brief Move the read position.
+			 *
+			 * The current block is kept if the new position falls within it, so
+			 * skipping over small amounts of data is cheap.
+			*/
+			void seek(BitOffset offset);
+			
+			/**
+			 * @brief Check if the read position is at (or beyond) the end of the Document.
+			*/
+			bool eof();
+			
+			/**
+			 * @brief Read data and advance the read position.
+			 *
+			 * Returns a pointer to the data, which is valid until the next call to
+			 * any method of this reader. The number of bytes available is written
+			 * to *read_length, which will only be less than length at the end of
+			 * the Document.
+			*/
+			const unsigned char *read(size_t length, size_t *read_length)
+			{
+				if(length <= (buffer.size() - buffer_pos))
+				{
+					const unsigned char *data = buffer.data() + buffer_pos;
+					
+					buffer_pos += length;
+					*read_length = length;
+					
+					return data;
+				}
+				else{
+					return read_slow(length, read_length);
+				}
+			}
+			
+			/**
+			 * @brief Read up to count numbers of the given type.
+			 *
+			 * Decoded values are appended to the given vector. Returns the number of
+			 * values read, which will only be less than count at the end of the
+			 * Document. Any trailing bytes too short to hold a value are not consumed.
+			*/
+			size_t read_integers(const NumberType &type, size_t count, std::vector<int64_t> *values);
+			size_t read_floats(const NumberType &type, size_t count, std::vector<double> *values);
+		
+		private:
+			const Document *doc;
+			
+			std::vector<unsigned char> buffer;
+			BitOffset buffer_base;  /**< Document offset of the start of buffer. */
+			size_t buffer_pos;      /**< Read position relative to buffer_base. */
+			
+			const unsigned char *read_slow(size_t length, size_t *read_length);
+			
+			template<typename T, typename F> size_t read_numbers(const NumberType &type, size_t count, std::vector<T> *values, const F &decode);
+	};
+}
+
+#endif /* !REHEX_DOCUMENTREADER_HPP */
@@ -29,6 +29,10 @@ void REHex::EditCommentDialog::run_modal(wxWindow *parent, Document *doc, BitOff
 		? *(old_comment->second.text)
 		: wxString("");
 	
+	std::shared_ptr<const Document::Comment::ArrayLayout> old_comment_array = old_comment != comments.end()
+		? old_comment->second.array
+		: NULL;
+	
 	REHex::TextEntryDialog te(parent, "Enter comment", old_comment_text);
 	
 	int rc = te.ShowModal();
@@ -45,6 +49,11 @@ void REHex::EditCommentDialog::run_modal(wxWindow *parent, Document *doc, BitOff
 		{
 			doc->erase_comment(offset, length);
 		}
+		else if(old_comment_array)
+		{
+			/* Keep the element layout when renaming an array. */
+			doc->set_comment(offset, length, Document::Comment(new_comment_text, old_comment_array));
+		}
 		else{
 			doc->set_comment(offset, length, new_comment_text);
 		}
@@ -37,6 +37,8 @@ wxDEFINE_EVENT(REHex::DATA_OVERWRITE_ABORTED,    REHex::OffsetLengthEvent);
 wxDEFINE_EVENT(REHex::CURSOR_UPDATE,    REHex::CursorUpdateEvent);
 wxDEFINE_EVENT(REHex::SCROLL_UPDATE,    REHex::ScrollUpdateEvent);
 
+wxDEFINE_EVENT(REHex::SELECTION_MATCHES_UPDATED, wxCommandEvent);
+
 wxDEFINE_EVENT(REHex::DOCUMENT_TITLE_CHANGED,  REHex::DocumentTitleEvent);
 
 wxDEFINE_EVENT(REHex::PALETTE_CHANGED, wxCommandEvent);
@@ -131,6 +131,8 @@ namespace REHex
 	wxDECLARE_EVENT(CURSOR_UPDATE,    CursorUpdateEvent);
 	wxDECLARE_EVENT(SCROLL_UPDATE,    ScrollUpdateEvent);
 	
+	wxDECLARE_EVENT(SELECTION_MATCHES_UPDATED, wxCommandEvent);
+	
 	wxDECLARE_EVENT(DOCUMENT_TITLE_CHANGED,  DocumentTitleEvent);
 	
 	wxDECLARE_EVENT(PALETTE_CHANGED, wxCommandEvent);
@@ -21,6 +21,7 @@
 #include <unistr.h>
 #include <wx/dcclient.h>
 #include <wx/dcmemory.h>
+#include <wx/rawbmp.h>
 #include <wx/settings.h>
 #include <wx/version.h>
 
@@ -53,6 +54,10 @@ REHex::FontCharacterCache::FontCharacterCache(wxWindow *window):
 	#ifdef REHEX_CACHE_STRING_BITMAPS
 	, m_string_bitmap_cache(STRING_BITMAP_CACHE_SIZE)
 	#endif
+	
+	#ifdef REHEX_GLYPH_ATLAS
+	, m_glyph_mask_cache(GLYPH_MASK_CACHE_SIZE)
+	#endif
 {
 #if wxCHECK_VERSION(3, 1, 3)
 	m_window->Bind(wxEVT_DPI_CHANGED, &FontCharacterCache::OnDPIChanged, this);
@@ -73,6 +78,10 @@ REHex::FontCharacterCache::FontCharacterCache(wxWindow *window, const wxFont &fo
 	#ifdef REHEX_CACHE_STRING_BITMAPS
 	, m_string_bitmap_cache(STRING_BITMAP_CACHE_SIZE)
 	#endif
+	
+	#ifdef REHEX_GLYPH_ATLAS
+	, m_glyph_mask_cache(GLYPH_MASK_CACHE_SIZE)
+	#endif
 {
 #if wxCHECK_VERSION(3, 1, 3)
 	m_window->Bind(wxEVT_DPI_CHANGED, &FontCharacterCache::OnDPIChanged, this);
@@ -128,6 +137,11 @@ void REHex::FontCharacterCache::reset()
 	#ifdef REHEX_CACHE_STRING_BITMAPS
 	m_string_bitmap_cache.clear();
 	#endif
+	
+	#ifdef REHEX_GLYPH_ATLAS
+	m_glyph_mask_cache.clear();
+	m_scratch_bitmap = wxNullBitmap;
+	#endif
 }
 
 wxSize REHex::FontCharacterCache::fixed_char_size() const
@@ -417,6 +431,138 @@ bool REHex::FontCharacterCache::StringBitmapCacheKey::operator<(const StringBitm
 		return packed_bg_colour < rhs.packed_bg_colour;
 	}
 }
+
+bool REHex::FontCharacterCache::StringBitmapCacheKey::operator==(const StringBitmapCacheKey &rhs) const
+{
+	return
+		#ifndef REHEX_ASSUME_INTEGER_CHARACTER_WIDTHS
+		base_column == rhs.base_column &&
+		#endif
+		characters == rhs.characters
+		&& packed_fg_colour == rhs.packed_fg_colour
+		&& packed_bg_colour == rhs.packed_bg_colour;
+}
+
+size_t REHex::FontCharacterCache::StringBitmapCacheKey::Hash::operator()(const StringBitmapCacheKey &key) const
+{
+	size_t h = 0;
+	
+	#ifndef REHEX_ASSUME_INTEGER_CHARACTER_WIDTHS
+	h = lru_cache_hash_combine(h, std::hash<int>()(key.base_column));
+	#endif
+	
+	for(auto c = key.characters.begin(); c != key.characters.end(); ++c)
+	{
+		h = lru_cache_hash_combine(h, std::hash<ucs4_t>()(*c));
+	}
+	
+	h = lru_cache_hash_combine(h, std::hash<unsigned int>()(key.packed_fg_colour));
+	h = lru_cache_hash_combine(h, std::hash<unsigned int>()(key.packed_bg_colour));
+	
+	return h;
+}
+#endif
+
+#ifdef REHEX_GLYPH_ATLAS
+const REHex::FontCharacterCache::GlyphMask &REHex::FontCharacterCache::glyph_mask(ucs4_t unicode_char, const wxSize &char_size) const
+{
+	PROFILE_BLOCK("REHex::FontCharacterCache::glyph_mask()");
+	
+	auto cache_key = std::make_tuple(unicode_char, char_size.GetWidth(), char_size.GetHeight());
+	
+	const GlyphMask *cached_mask = m_glyph_mask_cache.get(cache_key);
+	if(cached_mask != NULL)
+	{
+		return *cached_mask;
+	}
+	
+	/* The character is drawn white-on-black, so the intensity of each channel of each pixel
+	 * is how much of it is covered by the glyph. Keeping the channels separate rather than
+	 * reducing to a single alpha value preserves any subpixel anti-aliasing.
+	*/
+	
+#if wxCHECK_VERSION(3, 1, 6)
+	wxBitmap char_bitmap;
+	char_bitmap.CreateWithDIPSize(char_size, m_window->GetDPIScaleFactor(), 24);
+#else
+	wxBitmap char_bitmap(char_size, 24);
+#endif
+	
+	wxMemoryDC mdc(char_bitmap);
+	
+	mdc.SetFont(m_font);
+	
+	mdc.SetBackground(*wxBLACK_BRUSH);
+	mdc.Clear();
+	
+	mdc.SetTextForeground(*wxWHITE);
+	mdc.SetBackgroundMode(wxTRANSPARENT);
+	mdc.DrawText(wxString_FromUnicodeChar(unicode_char), 0, 0);
+	
+	mdc.SelectObject(wxNullBitmap);
+	
+	GlyphMask mask;
+	mask.width = char_bitmap.GetWidth();
+	mask.height = char_bitmap.GetHeight();
+	mask.coverage.resize(mask.width * mask.height * 3, 0);
+	
+	wxNativePixelData pixels(char_bitmap);
+	if(pixels)
+	{
+		wxNativePixelData::Iterator row(pixels);
+		unsigned char *out = mask.coverage.data();
+		
+		for(int y = 0; y < mask.height; ++y)
+		{
+			wxNativePixelData::Iterator p = row;
+			
+			for(int x = 0; x < mask.width; ++x, ++p)
+			{
+				*(out++) = p.Red();
+				*(out++) = p.Green();
+				*(out++) = p.Blue();
+			}
+			
+			row.OffsetY(pixels, 1);
+		}
+	}
+	
+	return *(m_glyph_mask_cache.set(cache_key, mask));
+}
+
+wxBitmap &REHex::FontCharacterCache::scratch_bitmap(const wxSize &size) const
+{
+#if wxCHECK_VERSION(3, 1, 6)
+	wxSize current_size = m_scratch_bitmap.IsOk() ? m_scratch_bitmap.GetLogicalSize() : wxSize(0, 0);
+#else
+	wxSize current_size = m_scratch_bitmap.IsOk() ? m_scratch_bitmap.GetSize() : wxSize(0, 0);
+#endif
+	
+	if(current_size.GetWidth() < size.GetWidth() || current_size.GetHeight() < size.GetHeight())
+	{
+		/* Grow to fit, but never shrink, so we aren't reallocating when line widths vary. */
+		
+		wxSize new_size = size;
+		new_size.IncTo(current_size);
+		
+#if wxCHECK_VERSION(3, 1, 6)
+		m_scratch_bitmap.CreateWithDIPSize(new_size, m_window->GetDPIScaleFactor(), 24);
+#else
+		m_scratch_bitmap.Create(new_size, 24);
+#endif
+	}
+	
+	return m_scratch_bitmap;
+}
+
+double REHex::FontCharacterCache::bitmap_scale_factor() const
+{
+#if wxCHECK_VERSION(3, 1, 6)
+	return m_window->GetDPIScaleFactor();
+#else
+	return 1.0;
+#endif
+}
 #endif
 
 #if wxCHECK_VERSION(3, 1, 3)
@@ -18,6 +18,7 @@
 #ifndef REHEX_FONTCHARACTERCACHE_HPP
 #define REHEX_FONTCHARACTERCACHE_HPP
 
+#include <tuple>
 #include <unitypes.h>
 #include <vector>
 #include <wx/bitmap.h>
@@ -176,6 +177,49 @@ namespace REHex
 			wxBitmap string_bitmap(int base_column, const std::vector<ucs4_t> &characters, const wxColour &fg_colour, const wxColour &bg_colour) const;
 			#endif
 			
+			#ifdef REHEX_GLYPH_ATLAS
+			/**
+			 * @brief Colour-independent coverage mask of a rendered character.
+			 *
+			 * Holds the coverage of each colour channel of each pixel by the glyph, from
+			 * 0 (background) to 255 (foreground), as three bytes per pixel in RGB order.
+			 * Dimensions are in physical pixels.
+			*/
+			struct GlyphMask
+			{
+				int width;
+				int height;
+				
+				std::vector<unsigned char> coverage;
+			};
+			
+			/**
+			 * @brief Render a character to a coverage mask (cached).
+			 *
+			 * @param unicode_char  Unicode code point of the character.
+			 * @param char_size     Character size obtained from dc.GetTextExtent() method.
+			 *
+			 * Unlike char_bitmap(), the mask can be composited in any colours, so each
+			 * character only needs rendering once. The returned reference is only valid
+			 * until the next call.
+			*/
+			const GlyphMask &glyph_mask(ucs4_t unicode_char, const wxSize &char_size) const;
+			
+			/**
+			 * @brief Get a scratch bitmap to composite characters into.
+			 *
+			 * @param size  Minimum logical size of the bitmap.
+			 *
+			 * The bitmap is reused between calls, its contents are undefined.
+			*/
+			wxBitmap &scratch_bitmap(const wxSize &size) const;
+			
+			/**
+			 * @brief Get the number of physical pixels per logical pixel in bitmaps.
+			*/
+			double bitmap_scale_factor() const;
+			#endif
+			
 		private:
 			wxWindow *m_window;
 			wxFont m_font;
@@ -212,10 +256,23 @@ namespace REHex
 				StringBitmapCacheKey(int base_column, const std::vector<ucs4_t> &characters, unsigned int packed_fg_colour, unsigned int packed_bg_colour);
 				
 				bool operator<(const StringBitmapCacheKey &rhs) const;
+				bool operator==(const StringBitmapCacheKey &rhs) const;
+				
+				struct Hash
+				{
+					size_t operator()(const StringBitmapCacheKey &key) const;
+				};
 			};
 			
 			static const size_t STRING_BITMAP_CACHE_SIZE = 256;
-			mutable LRUCache<StringBitmapCacheKey, wxBitmap> m_string_bitmap_cache;
+			mutable LRUCache<StringBitmapCacheKey, wxBitmap, StringBitmapCacheKey::Hash> m_string_bitmap_cache;
+			#endif
+			
+			#ifdef REHEX_GLYPH_ATLAS
+			static const size_t GLYPH_MASK_CACHE_SIZE = 8192;
+			mutable LRUCache<std::tuple<ucs4_t, int, int>, GlyphMask> m_glyph_mask_cache;
+			
+			mutable wxBitmap m_scratch_bitmap;
 			#endif
 
 #if wxCHECK_VERSION(3, 1, 3)
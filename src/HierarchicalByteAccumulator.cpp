@@ -410,18 +410,7 @@ bool REHex::HierarchicalByteAccumulator::task_func()
 void REHex::HierarchicalByteAccumulator::process_chunk(off_t chunk_offset, off_t chunk_length, size_t l1_slot_idx)
 {
 	ByteAccumulator prev_chunk_accumulator;
-	bool l2_cache_hit = false;
-	
-	{
-		std::unique_lock<std::mutex> l2_lock_guard(l2_mutex);
-		
-		const ByteAccumulator *l2_cache_ptr = l2_cache.get(chunk_offset);
-		if(l2_cache_ptr != NULL)
-		{
-			prev_chunk_accumulator = *l2_cache_ptr;
-			l2_cache_hit = true;
-		}
-	}
+	bool l2_cache_hit = l2_cache.get(chunk_offset, &prev_chunk_accumulator);
 	
 	if(!l2_cache_hit)
 	{
@@ -446,8 +435,6 @@ void REHex::HierarchicalByteAccumulator::process_chunk(off_t chunk_offset, off_t
 				queue_range(i->offset, i->length);
 			}
 			
-			std::unique_lock<std::mutex> l2_lock_guard(l2_mutex);
-			
 			l2_cache.erase(l1_cache[l1_slot_idx].offset, (l1_cache[l1_slot_idx].offset + l1_cache[l1_slot_idx].length));
 		}
 	}
@@ -469,10 +456,7 @@ void REHex::HierarchicalByteAccumulator::process_chunk(off_t chunk_offset, off_t
 		chunk_accumulator.add_byte(data[i]);
 	}
 	
-	{
-		std::unique_lock<std::mutex> l2_lock_guard(l2_mutex);
-		l2_cache.set(chunk_offset, chunk_accumulator);
-	}
+	l2_cache.set(chunk_offset, chunk_accumulator);
 	
 	{
 		std::unique_lock<std::mutex> l1_lock_guard(l1_mutex);
@@ -113,9 +113,7 @@ namespace REHex
 			 * when the range is modified, the entire L1 cache slot must be re-counted
 			 * from scratch.
 			*/
-			LRUCache<off_t, ByteAccumulator> l2_cache;
-			
-			std::mutex l2_mutex;
+			ShardedLRUCache<off_t, ByteAccumulator> l2_cache;
 			
 			std::mutex queue_mutex;
 			ByteRangeSet pending;  /**< Ranges waiting to be processed. */
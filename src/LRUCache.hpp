@@ -1,5 +1,5 @@
 /* Reverse Engineer's Hex Editor
- * Copyright (C) 2021-2022 Daniel Collins <solemnwarning@solemnwarning.net>
+ * Copyright (C) 2021-2026 Daniel Collins <solemnwarning@solemnwarning.net>
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms of the GNU General Public License version 2 as published by
@@ -18,39 +18,157 @@
 #ifndef REHEX_LRUCACHE_HPP
 #define REHEX_LRUCACHE_HPP
 
+#include <algorithm>
 #include <assert.h>
-#include <list>
-#include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace REHex
 {
+	/**
+	 * @brief Mix the bits of a hash value.
+	 *
+	 * std::hash is the identity function for integers on most implementations, which
+	 * would put keys which are multiples of a power of two (e.g. chunk offsets) into
+	 * the same few buckets of a power-of-two sized table.
+	*/
+	inline size_t lru_cache_mix(uint64_t h)
+	{
+		/* Finalizer from MurmurHash3. */
+		
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+		
+		return (size_t)(h);
+	}
+	
+	inline size_t lru_cache_hash_combine(size_t seed, size_t h)
+	{
+		return seed ^ (h + (size_t)(0x9E3779B97F4A7C15ULL) + (seed << 6) + (seed >> 2));
+	}
+	
+	/**
+	 * @brief Default hash function for LRUCache keys.
+	 *
+	 * Uses std::hash, with a specialisation to support std::tuple keys.
+	*/
+	template<typename K> struct LRUCacheHash
+	{
+		size_t operator()(const K &k) const
+		{
+			return std::hash<K>()(k);
+		}
+	};
+	
+	template<typename... T> struct LRUCacheHash< std::tuple<T...> >
+	{
+		size_t operator()(const std::tuple<T...> &k) const
+		{
+			return hash_from<0>(k, 0);
+		}
+		
+		private:
+			template<size_t I> static typename std::enable_if<(I < sizeof...(T)), size_t>::type hash_from(const std::tuple<T...> &k, size_t seed)
+			{
+				typedef typename std::tuple_element< I, std::tuple<T...> >::type element_t;
+				return hash_from<I + 1>(k, lru_cache_hash_combine(seed, LRUCacheHash<element_t>()(std::get<I>(k))));
+			}
+			
+			template<size_t I> static typename std::enable_if<(I == sizeof...(T)), size_t>::type hash_from(const std::tuple<T...>&, size_t seed)
+			{
+				return seed;
+			}
+	};
+	
 	/**
 	 * @brief Least-Recently Used Cache implementation.
+	 *
+	 * Entries live in an array of max_items slots which is allocated the first time
+	 * a value is stored, so storing a value never allocates after that (besides any
+	 * allocations made by copying the key/value). Slots are found through an open
+	 * addressing hash table and linked into a list in order of use, so get() and
+	 * set() take constant time.
+	 *
+	 * Pointers returned by get() and set() remain valid until the entry is replaced,
+	 * evicted or erased.
+	 *
+	 * Not thread safe, see ShardedLRUCache.
 	*/
-	template<typename K, typename V> class LRUCache
+	template<typename K, typename V, typename Hash = LRUCacheHash<K>, typename KeyEqual = std::equal_to<K>> class LRUCache
 	{
 		private:
+			typedef uint32_t slot_idx_t;
+			static const slot_idx_t NO_SLOT = (slot_idx_t)(-1);
+			
+			struct Slot
+			{
+				alignas(std::pair<K, V>) unsigned char storage[sizeof(std::pair<K, V>)];
+				
+				size_t hash;
+				
+				/* Neighbours in the recently used list, or next free slot if unused. */
+				slot_idx_t prev;
+				slot_idx_t next;
+				
+				std::pair<K, V> &kv()
+				{
+					return *(reinterpret_cast<std::pair<K, V>*>(storage));
+				}
+			};
+			
 			const size_t max_items;
 			
-			/* "queue" contains a list of key/value pairs in the cache, with the more
-			 * recently accessed elements nearer the front.
-			 *
-			 * "map" contains a mapping of keys to iterators within the queue.
-			 *
-			 * When an element is read or written, it is moved to the front of "queue".
+			Hash hasher;
+			KeyEqual key_equal;
+			
+			/* "slots" holds the cached key/value pairs. Used slots form a doubly linked
+			 * list with the more recently accessed elements nearer the head, when the
+			 * cache is full elements are evicted from the tail.
 			 *
-			 * When an element is added and the cache is full, elements are removed
-			 * starting from the back of the queue.
+			 * "buckets" is a linear probing hash table of slot indices, with at least
+			 * twice as many buckets as slots.
 			*/
 			
-			mutable std::list< std::pair<K, V> > queue;
+			std::unique_ptr<Slot[]> slots;
+			std::unique_ptr<slot_idx_t[]> buckets;
+			size_t bucket_mask;
 			
-			typedef typename std::list< std::pair<K, V> >::iterator queue_iter_t;
-			std::map<K, queue_iter_t> map;
+			mutable slot_idx_t head;  /**< Most recently used slot. */
+			mutable slot_idx_t tail;  /**< Least recently used slot. */
 			
+			slot_idx_t free_head;   /**< First slot in the free list. */
+			size_t slots_touched;   /**< Number of slots which have ever been used. */
+			size_t n_items;
+			
+			void allocate();
+			
+			size_t find_bucket(const K &k, size_t hash) const;
+			void erase_bucket(size_t bucket_idx);
+			
+			void unlink(slot_idx_t slot_idx) const;
+			void link_front(slot_idx_t slot_idx) const;
+			
+			void erase_slot(slot_idx_t slot_idx);
+			
+			template<typename VV> const V *set_impl(const K &k, VV &&v);
+		
 		public:
-			LRUCache(size_t max_items):
-				max_items(max_items) {}
+			LRUCache(size_t max_items);
+			~LRUCache();
+			
+			LRUCache(const LRUCache&) = delete;
+			LRUCache &operator=(const LRUCache&) = delete;
 			
 			/**
 			 * @brief Search the cache for an element with the given key.
@@ -62,6 +180,7 @@ namespace REHex
 			 * @brief Store a value in the cache.
 			*/
 			const V *set(const K &k, const V &v);
+			const V *set(const K &k, V &&v);
 			
 			/**
 			 * @brief Erase a value from the cache.
@@ -70,6 +189,8 @@ namespace REHex
 			
 			/**
 			 * @brief Erase any values in a range from the cache.
+			 *
+			 * Unlike the other operations, this visits every element in the cache.
 			*/
 			void erase(const K &begin, const K &end);
 			
@@ -77,84 +198,438 @@ namespace REHex
 			 * @brief Remove all values from the cache.
 			*/
 			void clear();
+			
+			/**
+			 * @brief Get the number of values in the cache.
+			*/
+			size_t size() const
+			{
+				return n_items;
+			}
+	};
+	
+	/**
+	 * @brief Thread safe LRUCache.
+	 *
+	 * Keys are spread over a number of independently locked LRUCache shards, so
+	 * threads working on different keys rarely wait for each other. Each shard
+	 * holds up to (max_items / num_shards) values and evicts its own least recently
+	 * used values.
+	 *
+	 * Values are copied out of the cache, since another thread may evict them at any
+	 * time.
+	*/
+	template<typename K, typename V, typename Hash = LRUCacheHash<K>, typename KeyEqual = std::equal_to<K>> class ShardedLRUCache
+	{
+		private:
+			struct Shard
+			{
+				mutable std::mutex lock;
+				LRUCache<K, V, Hash, KeyEqual> cache;
+				
+				Shard(size_t max_items):
+					cache(max_items) {}
+			};
+			
+			Hash hasher;
+			std::vector< std::unique_ptr<Shard> > shards;
+			
+			Shard &shard_for(const K &k) const
+			{
+				/* Use the high bits so the choice of shard is independent of the
+				 * bucket used within the shard.
+				*/
+				size_t h = lru_cache_mix(hasher(k));
+				return *(shards[(h >> (sizeof(size_t) * 4)) % shards.size()]);
+			}
+		
+		public:
+			static const size_t DEFAULT_SHARDS = 8;
+			
+			ShardedLRUCache(size_t max_items, size_t num_shards = DEFAULT_SHARDS)
+			{
+				assert(num_shards > 0);
+				
+				size_t shard_items = (max_items + num_shards - 1) / num_shards;
+				
+				for(size_t i = 0; i < num_shards; ++i)
+				{
+					shards.emplace_back(new Shard(shard_items));
+				}
+			}
+			
+			/**
+			 * @brief Search the cache for an element with the given key.
+			 *
+			 * Copies the value to *v and returns true if found.
+			*/
+			bool get(const K &k, V *v) const
+			{
+				Shard &shard = shard_for(k);
+				std::unique_lock<std::mutex> l(shard.lock);
+				
+				const V *cached = shard.cache.get(k);
+				if(cached != NULL)
+				{
+					*v = *cached;
+					return true;
+				}
+				
+				return false;
+			}
+			
+			/**
+			 * @brief Store a value in the cache.
+			*/
+			void set(const K &k, const V &v)
+			{
+				Shard &shard = shard_for(k);
+				std::unique_lock<std::mutex> l(shard.lock);
+				
+				shard.cache.set(k, v);
+			}
+			
+			/**
+			 * @brief Erase a value from the cache.
+			*/
+			void erase(const K &k)
+			{
+				Shard &shard = shard_for(k);
+				std::unique_lock<std::mutex> l(shard.lock);
+				
+				shard.cache.erase(k);
+			}
+			
+			/**
+			 * @brief Erase any values in a range from the cache.
+			*/
+			void erase(const K &begin, const K &end)
+			{
+				for(auto s = shards.begin(); s != shards.end(); ++s)
+				{
+					std::unique_lock<std::mutex> l((*s)->lock);
+					(*s)->cache.erase(begin, end);
+				}
+			}
+			
+			/**
+			 * @brief Remove all values from the cache.
+			*/
+			void clear()
+			{
+				for(auto s = shards.begin(); s != shards.end(); ++s)
+				{
+					std::unique_lock<std::mutex> l((*s)->lock);
+					(*s)->cache.clear();
+				}
+			}
+			
+			/**
+			 * @brief Get the number of values in the cache.
+			*/
+			size_t size() const
+			{
+				size_t total = 0;
+				
+				for(auto s = shards.begin(); s != shards.end(); ++s)
+				{
+					std::unique_lock<std::mutex> l((*s)->lock);
+					total += (*s)->cache.size();
+				}
+				
+				return total;
+			}
 	};
 }
 
-template<typename K, typename V> const V *REHex::LRUCache<K,V>::get(const K &k) const
+template<typename K, typename V, typename Hash, typename KeyEqual> const typename REHex::LRUCache<K,V,Hash,KeyEqual>::slot_idx_t REHex::LRUCache<K,V,Hash,KeyEqual>::NO_SLOT;
+
+template<typename K, typename V, typename Hash, typename KeyEqual> REHex::LRUCache<K,V,Hash,KeyEqual>::LRUCache(size_t max_items):
+	max_items(max_items),
+	bucket_mask(0),
+	head(NO_SLOT),
+	tail(NO_SLOT),
+	free_head(NO_SLOT),
+	slots_touched(0),
+	n_items(0)
+{
+	assert(max_items > 0);
+	assert(max_items < (size_t)(NO_SLOT));
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> REHex::LRUCache<K,V,Hash,KeyEqual>::~LRUCache()
+{
+	clear();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::allocate()
+{
+	size_t n_buckets = 8;
+	while(n_buckets < (max_items * 2))
+	{
+		n_buckets *= 2;
+	}
+	
+	slots.reset(new Slot[max_items]);
+	
+	buckets.reset(new slot_idx_t[n_buckets]);
+	std::fill(buckets.get(), buckets.get() + n_buckets, NO_SLOT);
+	
+	bucket_mask = n_buckets - 1;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> size_t REHex::LRUCache<K,V,Hash,KeyEqual>::find_bucket(const K &k, size_t hash) const
 {
-	auto i = map.find(k);
+	/* Returns the bucket holding the key, or the empty bucket where it would go. */
 	
-	if(i != map.end())
+	for(size_t bucket_idx = hash & bucket_mask;; bucket_idx = (bucket_idx + 1) & bucket_mask)
 	{
-		queue.splice(queue.begin(), queue, i->second);
-		return &(i->second->second);
+		slot_idx_t slot_idx = buckets[bucket_idx];
+		
+		if(slot_idx == NO_SLOT || (slots[slot_idx].hash == hash && key_equal(slots[slot_idx].kv().first, k)))
+		{
+			return bucket_idx;
+		}
+	}
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::erase_bucket(size_t bucket_idx)
+{
+	/* Shift any following entries in the probe sequence back into the gap, so that
+	 * lookups never need to skip over deleted buckets.
+	*/
+	
+	size_t hole = bucket_idx;
+	
+	for(size_t i = (hole + 1) & bucket_mask; buckets[i] != NO_SLOT; i = (i + 1) & bucket_mask)
+	{
+		size_t home = slots[ buckets[i] ].hash & bucket_mask;
+		
+		/* Entry can move to the hole unless its home bucket is cyclically within (hole, i]. */
+		bool stays = hole <= i
+			? (home > hole && home <= i)
+			: (home > hole || home <= i);
+		
+		if(!stays)
+		{
+			buckets[hole] = buckets[i];
+			hole = i;
+		}
+	}
+	
+	buckets[hole] = NO_SLOT;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::unlink(slot_idx_t slot_idx) const
+{
+	Slot &slot = slots[slot_idx];
+	
+	if(slot.prev != NO_SLOT)
+	{
+		slots[slot.prev].next = slot.next;
 	}
 	else{
-		return NULL;
+		head = slot.next;
+	}
+	
+	if(slot.next != NO_SLOT)
+	{
+		slots[slot.next].prev = slot.prev;
+	}
+	else{
+		tail = slot.prev;
+	}
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::link_front(slot_idx_t slot_idx) const
+{
+	Slot &slot = slots[slot_idx];
+	
+	slot.prev = NO_SLOT;
+	slot.next = head;
+	
+	if(head != NO_SLOT)
+	{
+		slots[head].prev = slot_idx;
 	}
+	else{
+		tail = slot_idx;
+	}
+	
+	head = slot_idx;
 }
 
-template<typename K, typename V> const V *REHex::LRUCache<K,V>::set(const K &k, const V &v)
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::erase_slot(slot_idx_t slot_idx)
 {
-	/* Check if we already have this key, and move it to the front of queue if we do. */
-	const V *old_v = get(k);
+	Slot &slot = slots[slot_idx];
 	
-	if(old_v != NULL)
+	size_t bucket_idx = slot.hash & bucket_mask;
+	while(buckets[bucket_idx] != slot_idx)
 	{
-		/* Replace the existing value. */
-		
-		assert(!(queue.front().first < k || k < queue.front().first));
+		assert(buckets[bucket_idx] != NO_SLOT);
+		bucket_idx = (bucket_idx + 1) & bucket_mask;
+	}
+	
+	erase_bucket(bucket_idx);
+	unlink(slot_idx);
+	
+	slot.kv().~pair();
+	
+	slot.next = free_head;
+	free_head = slot_idx;
+	
+	--n_items;
+}
 
-		queue.pop_front();
+template<typename K, typename V, typename Hash, typename KeyEqual> const V *REHex::LRUCache<K,V,Hash,KeyEqual>::get(const K &k) const
+{
+	if(n_items == 0)
+	{
+		return NULL;
+	}
+	
+	size_t hash = lru_cache_mix(hasher(k));
+	slot_idx_t slot_idx = buckets[ find_bucket(k, hash) ];
+	
+	if(slot_idx != NO_SLOT)
+	{
+		if(slot_idx != head)
+		{
+			unlink(slot_idx);
+			link_front(slot_idx);
+		}
 		
-		queue.push_front(std::make_pair(k, v));
-		map[k] = queue.begin();
+		return &(slots[slot_idx].kv().second);
 	}
 	else{
-		/* Make space to keep us under the limit (if necessary) and add the new element. */
+		return NULL;
+	}
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> const V *REHex::LRUCache<K,V,Hash,KeyEqual>::set(const K &k, const V &v)
+{
+	return set_impl(k, v);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> const V *REHex::LRUCache<K,V,Hash,KeyEqual>::set(const K &k, V &&v)
+{
+	return set_impl(k, std::move(v));
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual> template<typename VV> const V *REHex::LRUCache<K,V,Hash,KeyEqual>::set_impl(const K &k, VV &&v)
+{
+	if(!slots)
+	{
+		allocate();
+	}
+	
+	size_t hash = lru_cache_mix(hasher(k));
+	size_t bucket_idx = find_bucket(k, hash);
+	
+	slot_idx_t slot_idx = buckets[bucket_idx];
+	
+	if(slot_idx != NO_SLOT)
+	{
+		/* Replace the existing value and move it to the front of the list. */
 		
-		while(queue.size() >= max_items)
+		slots[slot_idx].kv().second = std::forward<VV>(v);
+		
+		if(slot_idx != head)
 		{
-			map.erase(queue.back().first);
-			queue.pop_back();
+			unlink(slot_idx);
+			link_front(slot_idx);
 		}
 		
-		queue.push_front(std::make_pair(k, v));
-		map[k] = queue.begin();
+		return &(slots[slot_idx].kv().second);
 	}
-
-	return &(queue.front().second);
+	
+	if(n_items >= max_items)
+	{
+		/* Make space by evicting the least recently used element, which may move
+		 * other entries in the hash table, so the insertion point must be found
+		 * again.
+		*/
+		
+		erase_slot(tail);
+		bucket_idx = find_bucket(k, hash);
+	}
+	
+	if(free_head != NO_SLOT)
+	{
+		slot_idx = free_head;
+		free_head = slots[slot_idx].next;
+	}
+	else{
+		assert(slots_touched < max_items);
+		slot_idx = slots_touched++;
+	}
+	
+	Slot &slot = slots[slot_idx];
+	
+	new(slot.storage) std::pair<K, V>(k, std::forward<VV>(v));
+	slot.hash = hash;
+	
+	buckets[bucket_idx] = slot_idx;
+	link_front(slot_idx);
+	
+	++n_items;
+	
+	return &(slot.kv().second);
 }
 
-template<typename K, typename V> void REHex::LRUCache<K,V>::erase(const K &k)
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::erase(const K &k)
 {
-	auto i = map.find(k);
+	if(n_items == 0)
+	{
+		return;
+	}
 	
-	if(i != map.end())
+	size_t hash = lru_cache_mix(hasher(k));
+	slot_idx_t slot_idx = buckets[ find_bucket(k, hash) ];
+	
+	if(slot_idx != NO_SLOT)
 	{
-		queue.erase(i->second);
-		map.erase(i);
+		erase_slot(slot_idx);
 	}
 }
 
-template<typename K, typename V> void REHex::LRUCache<K,V>::erase(const K &begin, const K &end)
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::erase(const K &begin, const K &end)
 {
-	auto i = map.lower_bound(begin);
+	slot_idx_t slot_idx = head;
 	
-	while(i != map.end() && i->first < end)
+	while(slot_idx != NO_SLOT)
 	{
-		auto del = i;
-		++i;
+		slot_idx_t next_idx = slots[slot_idx].next;
+		const K &k = slots[slot_idx].kv().first;
+		
+		if(!(k < begin) && k < end)
+		{
+			erase_slot(slot_idx);
+		}
 		
-		queue.erase(del->second);
-		map.erase(del);
+		slot_idx = next_idx;
 	}
 }
 
-template<typename K, typename V> void REHex::LRUCache<K,V>::clear()
+template<typename K, typename V, typename Hash, typename KeyEqual> void REHex::LRUCache<K,V,Hash,KeyEqual>::clear()
 {
-	map.clear();
-	queue.clear();
+	if(!slots)
+	{
+		return;
+	}
+	
+	for(slot_idx_t slot_idx = head; slot_idx != NO_SLOT; slot_idx = slots[slot_idx].next)
+	{
+		slots[slot_idx].kv().~pair();
+	}
+	
+	std::fill(buckets.get(), buckets.get() + bucket_mask + 1, NO_SLOT);
+	
+	head = NO_SLOT;
+	tail = NO_SLOT;
+	free_head = NO_SLOT;
+	slots_touched = 0;
+	n_items = 0;
 }
 
 #endif /* !REHEX_LRUCACHE_HPP */
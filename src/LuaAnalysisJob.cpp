@@ -0,0 +1,599 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <exception>
+#include <stdexcept>
+#include <wxlua/wxlua.h>
+
+#include "App.hpp"
+#include "LuaAnalysisJob.hpp"
+#include "profile.hpp"
+
+/* Address used as the registry key for the LuaAnalysisJob pointer in the worker interpreter. */
+static const char JOB_REGISTRY_KEY = 0;
+
+/* Number of Lua VM instructions between checks for cancellation. */
+static const int CANCEL_HOOK_INTERVAL = 1000;
+
+REHex::LuaAnalysisJob::LuaAnalysisJob(const SharedDocumentPointer &document, const std::string &script, const std::string &desc):
+	document(document),
+	script(script),
+	desc(desc),
+	state(State::IDLE),
+	cancelling(false),
+	progress_done(0),
+	progress_total(-1),
+	reader(document)
+{
+	this->document.auto_cleanup_bind(DATA_ERASING,     &REHex::LuaAnalysisJob::OnDataModifying, this);
+	this->document.auto_cleanup_bind(DATA_INSERTING,   &REHex::LuaAnalysisJob::OnDataModifying, this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITING, &REHex::LuaAnalysisJob::OnDataModifying, this);
+}
+
+REHex::LuaAnalysisJob::~LuaAnalysisJob()
+{
+	if(worker.joinable())
+	{
+		cancelling = true;
+		worker.join();
+	}
+}
+
+bool REHex::LuaAnalysisJob::start()
+{
+	if(state != State::IDLE)
+	{
+		return false;
+	}
+	
+	state = State::RUNNING;
+	worker = std::thread([this]() { worker_main(); });
+	
+	wxCommandEvent *start_event = new wxCommandEvent(PROCESSING_START);
+	start_event->SetEventObject(this);
+	QueueEvent(start_event);
+	
+	return true;
+}
+
+void REHex::LuaAnalysisJob::cancel()
+{
+	if(state != State::RUNNING)
+	{
+		return;
+	}
+	
+	stop_worker();
+	finish(State::CANCELLED, "Cancelled");
+}
+
+REHex::LuaAnalysisJob::State REHex::LuaAnalysisJob::get_state() const
+{
+	return state;
+}
+
+std::string REHex::LuaAnalysisJob::get_error() const
+{
+	return error;
+}
+
+double REHex::LuaAnalysisJob::get_progress() const
+{
+	int64_t done = progress_done;
+	int64_t total = progress_total;
+	
+	if(state == State::FINISHED)
+	{
+		return 1.0;
+	}
+	else if(total <= 0)
+	{
+		return -1.0;
+	}
+	else{
+		return std::min(((double)(done) / (double)(total)), 1.0);
+	}
+}
+
+void REHex::LuaAnalysisJob::worker_main()
+{
+	PROFILE_SET_THREAD_GROUP(NONE);
+	
+	lua_State *L = luaL_newstate();
+	if(L != NULL)
+	{
+		luaL_openlibs(L);
+		worker_setup(L);
+		
+		int res = luaL_loadfile(L, script.c_str());
+		if(res == 0)
+		{
+			res = lua_pcall(L, 0, 0, 0);
+		}
+		
+		if(res != 0)
+		{
+			const char *msg = lua_tostring(L, -1);
+			worker_error = msg != NULL ? msg : "Unknown error";
+		}
+		
+		lua_close(L);
+	}
+	else{
+		worker_error = "Unable to create Lua interpreter";
+	}
+	
+	if(worker_error.empty())
+	{
+		worker_flush();
+	}
+	
+	CallAfter(&REHex::LuaAnalysisJob::OnWorkerFinished);
+}
+
+void REHex::LuaAnalysisJob::worker_setup(lua_State *L)
+{
+	lua_pushlightuserdata(L, (void*)(&JOB_REGISTRY_KEY));
+	lua_pushlightuserdata(L, this);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	
+	static const struct { const char *name; lua_CFunction func; } JOB_FUNCS[] = {
+		{ "length",        &lua_job_length },
+		{ "read",          &lua_job_read },
+		{ "read_numbers",  &lua_job_read_numbers },
+		{ "set_comment",   &lua_job_set_comment },
+		{ "set_data_type", &lua_job_set_data_type },
+		{ "set_highlight", &lua_job_set_highlight },
+		{ "progress",      &lua_job_progress },
+		{ "flush",         &lua_job_flush },
+		{ "cancelled",     &lua_job_cancelled },
+	};
+	
+	lua_newtable(L);
+	
+	for(size_t i = 0; i < (sizeof(JOB_FUNCS) / sizeof(*JOB_FUNCS)); ++i)
+	{
+		lua_pushlightuserdata(L, this);
+		lua_pushcclosure(L, JOB_FUNCS[i].func, 1);
+		lua_setfield(L, -2, JOB_FUNCS[i].name);
+	}
+	
+	lua_setglobal(L, "job");
+	
+	/* Send print() output to the console rather than stdout. */
+	lua_pushcfunction(L, &lua_job_print);
+	lua_setglobal(L, "print");
+	
+	/* Let the script load modules from the directory it is in. */
+	
+	size_t dir_end = script.find_last_of("/\\");
+	if(dir_end != std::string::npos)
+	{
+		lua_getglobal(L, "package");
+		
+		lua_pushlstring(L, script.data(), (dir_end + 1));
+		lua_pushstring(L, "?.lua;");
+		lua_getfield(L, -3, "path");
+		lua_concat(L, 3);
+		lua_setfield(L, -2, "path");
+		
+		lua_pop(L, 1);
+	}
+	
+	lua_sethook(L, &lua_cancel_hook, LUA_MASKCOUNT, CANCEL_HOOK_INTERVAL);
+}
+
+bool REHex::LuaAnalysisJob::worker_read(off_t offset, off_t length, const unsigned char **data, size_t *read_length)
+{
+	try {
+		reader.seek(BitOffset(offset, 0));
+		*data = reader.read(length, read_length);
+		
+		return true;
+	}
+	catch(const std::exception &e)
+	{
+		wxGetApp().printf_error("Exception in REHex::LuaAnalysisJob (worker thread): %s\n", e.what());
+		return false;
+	}
+}
+
+bool REHex::LuaAnalysisJob::worker_read_numbers(off_t offset, const char *type, size_t count, bool *is_float)
+{
+	DocumentReader::NumberType nt;
+	
+	try {
+		nt = DocumentReader::NumberType::parse(type);
+	}
+	catch(const std::invalid_argument&)
+	{
+		return false;
+	}
+	
+	*is_float = nt.kind == DocumentReader::NumberType::FLOAT;
+	
+	int_values.clear();
+	float_values.clear();
+	
+	try {
+		reader.seek(BitOffset(offset, 0));
+		
+		if(*is_float)
+		{
+			reader.read_floats(nt, count, &float_values);
+		}
+		else{
+			reader.read_integers(nt, count, &int_values);
+		}
+	}
+	catch(const std::exception &e)
+	{
+		wxGetApp().printf_error("Exception in REHex::LuaAnalysisJob (worker thread): %s\n", e.what());
+	}
+	
+	return true;
+}
+
+bool REHex::LuaAnalysisJob::worker_queue(Annotation::Kind kind, off_t offset, off_t length, const char *text, size_t text_length, int colour)
+{
+	try {
+		batch.emplace_back(kind, offset, length, std::string(text, text_length), colour);
+	}
+	catch(const std::bad_alloc&)
+	{
+		return false;
+	}
+	
+	if(batch.size() >= FLUSH_THRESHOLD)
+	{
+		worker_flush();
+	}
+	
+	return true;
+}
+
+void REHex::LuaAnalysisJob::worker_flush()
+{
+	if(batch.empty())
+	{
+		return;
+	}
+	
+	{
+		std::unique_lock<std::mutex> pl(pending_lock);
+		
+		pending.push_back(std::move(batch));
+		batch.clear();
+	}
+	
+	CallAfter(&REHex::LuaAnalysisJob::apply_pending);
+}
+
+void REHex::LuaAnalysisJob::apply_pending()
+{
+	PROFILE_BLOCK("REHex::LuaAnalysisJob::apply_pending");
+	
+	std::list< std::vector<Annotation> > batches;
+	
+	{
+		std::unique_lock<std::mutex> pl(pending_lock);
+		batches.swap(pending);
+	}
+	
+	if(state != State::RUNNING)
+	{
+		/* Job was cancelled while these were in flight. */
+		return;
+	}
+	
+	for(auto b = batches.begin(); b != batches.end(); ++b)
+	{
+		Document::AnnotationSession session(document, desc);
+		
+		for(auto a = b->begin(); a != b->end(); ++a)
+		{
+			BitOffset offset(a->offset, 0);
+			BitOffset length(a->length, 0);
+			
+			switch(a->kind)
+			{
+				case Annotation::Kind::COMMENT:
+					session.set_comment(offset, length, Document::Comment(wxString::FromUTF8(a->text.c_str())));
+					break;
+				
+				case Annotation::Kind::DATA_TYPE:
+					session.set_data_type(offset, length, a->text);
+					break;
+				
+				case Annotation::Kind::HIGHLIGHT:
+					session.set_highlight(offset, length, a->colour);
+					break;
+			}
+		}
+		
+		session.commit();
+	}
+}
+
+void REHex::LuaAnalysisJob::stop_worker()
+{
+	/* The worker notices this within CANCEL_HOOK_INTERVAL instructions, but it may be
+	 * stuck in a long read for much longer than that, so rather than joining it here
+	 * and blocking the UI thread, we leave it to be joined by OnWorkerFinished().
+	*/
+	cancelling = true;
+	
+	std::unique_lock<std::mutex> pl(pending_lock);
+	pending.clear();
+}
+
+void REHex::LuaAnalysisJob::finish(State state, const std::string &error)
+{
+	this->state = state;
+	this->error = error;
+	
+	wxCommandEvent *stop_event = new wxCommandEvent(PROCESSING_STOP);
+	stop_event->SetEventObject(this);
+	QueueEvent(stop_event);
+}
+
+void REHex::LuaAnalysisJob::OnWorkerFinished()
+{
+	/* The worker calls this just before returning, so this won't block for long. */
+	worker.join();
+	
+	if(state != State::RUNNING)
+	{
+		/* Already cancelled. */
+		return;
+	}
+	
+	apply_pending();
+	
+	if(worker_error.empty())
+	{
+		finish(State::FINISHED, "");
+	}
+	else{
+		wxGetApp().printf_error("Error in analysis job (%s): %s\n", desc.c_str(), worker_error.c_str());
+		finish(State::FAILED, worker_error);
+	}
+}
+
+void REHex::LuaAnalysisJob::OnDataModifying(OffsetLengthEvent &event)
+{
+	if(state == State::RUNNING)
+	{
+		stop_worker();
+		finish(State::CANCELLED, "The document was modified");
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+static REHex::LuaAnalysisJob *lua_get_job(lua_State *L)
+{
+	return (REHex::LuaAnalysisJob*)(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+int REHex::LuaAnalysisJob::lua_job_length(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_pushinteger(L, job->document->buffer_length());
+	return 1;
+}
+
+int REHex::LuaAnalysisJob::lua_job_read(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_Integer offset = luaL_checkinteger(L, 1);
+	lua_Integer length = luaL_checkinteger(L, 2);
+	
+	luaL_argcheck(L, (offset >= 0), 1, "offset must not be negative");
+	luaL_argcheck(L, (length >= 0), 2, "length must not be negative");
+	
+	const unsigned char *data;
+	size_t read_length;
+	
+	if(!job->worker_read(offset, length, &data, &read_length))
+	{
+		return luaL_error(L, "Error reading from document");
+	}
+	
+	lua_pushlstring(L, (const char*)(data), read_length);
+	return 1;
+}
+
+int REHex::LuaAnalysisJob::lua_job_read_numbers(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_Integer offset = luaL_checkinteger(L, 1);
+	const char *type = luaL_checkstring(L, 2);
+	lua_Integer count = luaL_checkinteger(L, 3);
+	
+	luaL_argcheck(L, (offset >= 0), 1, "offset must not be negative");
+	luaL_argcheck(L, (count >= 0), 3, "count must not be negative");
+	
+	bool is_float;
+	if(!job->worker_read_numbers(offset, type, count, &is_float))
+	{
+		return luaL_argerror(L, 2, "unknown number type");
+	}
+	
+	lua_newtable(L);
+	
+	if(is_float)
+	{
+		for(size_t i = 0; i < job->float_values.size(); ++i)
+		{
+			lua_pushnumber(L, job->float_values[i]);
+			lua_rawseti(L, -2, (i + 1));
+		}
+	}
+	else{
+		for(size_t i = 0; i < job->int_values.size(); ++i)
+		{
+			lua_pushinteger(L, job->int_values[i]);
+			lua_rawseti(L, -2, (i + 1));
+		}
+	}
+	
+	return 1;
+}
+
+int REHex::LuaAnalysisJob::lua_job_set_comment(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_Integer offset = luaL_checkinteger(L, 1);
+	lua_Integer length = luaL_checkinteger(L, 2);
+	
+	size_t text_length;
+	const char *text = luaL_checklstring(L, 3, &text_length);
+	
+	luaL_argcheck(L, (offset >= 0), 1, "offset must not be negative");
+	luaL_argcheck(L, (length >= 0), 2, "length must not be negative");
+	
+	if(!job->worker_queue(Annotation::Kind::COMMENT, offset, length, text, text_length, 0))
+	{
+		return luaL_error(L, "Out of memory");
+	}
+	
+	return 0;
+}
+
+int REHex::LuaAnalysisJob::lua_job_set_data_type(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_Integer offset = luaL_checkinteger(L, 1);
+	lua_Integer length = luaL_checkinteger(L, 2);
+	
+	size_t type_length;
+	const char *type = luaL_checklstring(L, 3, &type_length);
+	
+	luaL_argcheck(L, (offset >= 0), 1, "offset must not be negative");
+	luaL_argcheck(L, (length > 0), 2, "length must be greater than zero");
+	
+	if(!job->worker_queue(Annotation::Kind::DATA_TYPE, offset, length, type, type_length, 0))
+	{
+		return luaL_error(L, "Out of memory");
+	}
+	
+	return 0;
+}
+
+int REHex::LuaAnalysisJob::lua_job_set_highlight(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_Integer offset = luaL_checkinteger(L, 1);
+	lua_Integer length = luaL_checkinteger(L, 2);
+	lua_Integer colour = luaL_checkinteger(L, 3);
+	
+	luaL_argcheck(L, (offset >= 0), 1, "offset must not be negative");
+	luaL_argcheck(L, (length > 0), 2, "length must be greater than zero");
+	
+	if(!job->worker_queue(Annotation::Kind::HIGHLIGHT, offset, length, "", 0, colour))
+	{
+		return luaL_error(L, "Out of memory");
+	}
+	
+	return 0;
+}
+
+int REHex::LuaAnalysisJob::lua_job_progress(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	job->progress_done = (int64_t)(luaL_checknumber(L, 1));
+	job->progress_total = (int64_t)(luaL_checknumber(L, 2));
+	
+	return 0;
+}
+
+int REHex::LuaAnalysisJob::lua_job_flush(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	job->worker_flush();
+	return 0;
+}
+
+int REHex::LuaAnalysisJob::lua_job_cancelled(lua_State *L)
+{
+	LuaAnalysisJob *job = lua_get_job(L);
+	
+	lua_pushboolean(L, job->cancelling.load());
+	return 1;
+}
+
+int REHex::LuaAnalysisJob::lua_job_print(lua_State *L)
+{
+	int nargs = lua_gettop(L);
+	
+	lua_getglobal(L, "tostring");
+	
+	for(int i = 1; i <= nargs; ++i)
+	{
+		if(i > 1)
+		{
+			lua_pushstring(L, "\t");
+		}
+		
+		lua_pushvalue(L, (nargs + 1));
+		lua_pushvalue(L, i);
+		lua_call(L, 1, 1);
+		
+		if(!lua_isstring(L, -1))
+		{
+			return luaL_error(L, "'tostring' must return a string to 'print'");
+		}
+	}
+	
+	lua_pushstring(L, "\n");
+	lua_concat(L, (lua_gettop(L) - (nargs + 1)));
+	
+	size_t len;
+	const char *s = lua_tolstring(L, -1, &len);
+	
+	wxGetApp().print_info(std::string(s, len));
+	
+	return 0;
+}
+
+void REHex::LuaAnalysisJob::lua_cancel_hook(lua_State *L, lua_Debug *ar)
+{
+	lua_pushlightuserdata(L, (void*)(&JOB_REGISTRY_KEY));
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	
+	LuaAnalysisJob *job = (LuaAnalysisJob*)(lua_touserdata(L, -1));
+	lua_pop(L, 1);
+	
+	if(job->cancelling)
+	{
+		luaL_error(L, "Job cancelled");
+	}
+}
@@ -0,0 +1,196 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_LUAANALYSISJOB_HPP
+#define REHEX_LUAANALYSISJOB_HPP
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+#include <wx/event.h>
+
+#include "DocumentReader.hpp"
+#include "Events.hpp"
+#include "SharedDocumentPointer.hpp"
+
+struct lua_State;
+
+namespace REHex
+{
+	/**
+	 * @brief Runs a Lua script against a Document on a background thread.
+	 *
+	 * The script runs in its own Lua interpreter on a dedicated thread, so a long
+	 * analysis doesn't block the UI, and several jobs may run at once. The worker
+	 * interpreter has none of the wxWidgets or rehex bindings, instead the script is
+	 * given a "job" table with functions to read from the Document and to queue
+	 * comments, data types and highlights (see AnalysisJob.luadoc).
+	 *
+	 * Queued annotations are delivered to the UI thread in batches and each batch is
+	 * applied to the Document using a Document::AnnotationSession.
+	 *
+	 * The job sees the Document's data as it was when the job was started - if the
+	 * data is modified while the job is running, the job is cancelled and any
+	 * annotations which haven't been applied yet are discarded.
+	 *
+	 * PROCESSING_START and PROCESSING_STOP events are raised on the job when it
+	 * starts and when it finishes (for any reason).
+	*/
+	class LuaAnalysisJob: public wxEvtHandler
+	{
+		public:
+			enum class State
+			{
+				IDLE,       /**< start() hasn't been called yet. */
+				RUNNING,    /**< The script is running. */
+				FINISHED,   /**< The script ran to completion. */
+				FAILED,     /**< The script raised an error. */
+				CANCELLED,  /**< The job was cancelled, or the Document was modified. */
+			};
+			
+			/**
+			 * @brief Number of annotations queued by the script before they are
+			 * automatically sent to the UI thread.
+			*/
+			static constexpr size_t FLUSH_THRESHOLD = 16384;
+			
+			/**
+			 * @brief Create a job (doesn't start it).
+			 *
+			 * @param document  Document to analyse.
+			 * @param script    Filename of the Lua script to run.
+			 * @param desc      Description of the changes for the undo history.
+			*/
+			LuaAnalysisJob(const SharedDocumentPointer &document, const std::string &script, const std::string &desc);
+			
+			/**
+			 * @brief Destroy the job, cancelling it if still running.
+			*/
+			virtual ~LuaAnalysisJob();
+			
+			LuaAnalysisJob(const LuaAnalysisJob&) = delete;
+			LuaAnalysisJob &operator=(const LuaAnalysisJob&) = delete;
+			
+			/**
+			 * @brief Start running the script.
+			 *
+			 * Returns false if the job has already been started.
+			*/
+			bool start();
+			
+			/**
+			 * @brief Cancel the job.
+			 *
+			 * Stops the script and discards any annotations which haven't been
+			 * applied to the Document yet. Any annotations that were already applied
+			 * are left in place.
+			 *
+			 * The job is in the CANCELLED state when this returns, but doesn't wait
+			 * for the worker thread, which exits in the background.
+			*/
+			void cancel();
+			
+			State get_state() const;
+			
+			/**
+			 * @brief Get the error message if the job failed or was cancelled.
+			*/
+			std::string get_error() const;
+			
+			/**
+			 * @brief Get the progress reported by the script.
+			 *
+			 * Returns a value between 0.0 and 1.0, or -1.0 if the script hasn't
+			 * reported any progress.
+			*/
+			double get_progress() const;
+		
+		private:
+			struct Annotation
+			{
+				enum class Kind { COMMENT, DATA_TYPE, HIGHLIGHT };
+				
+				Kind kind;
+				off_t offset;
+				off_t length;
+				std::string text;  /**< Comment text or data type name. */
+				int colour;
+				
+				Annotation(Kind kind, off_t offset, off_t length, const std::string &text, int colour):
+					kind(kind), offset(offset), length(length), text(text), colour(colour) {}
+			};
+			
+			SharedDocumentPointer document;
+			const std::string script;
+			const std::string desc;
+			
+			State state;         /**< Only accessed from the UI thread. */
+			std::string error;   /**< Only accessed from the UI thread. */
+			
+			std::thread worker;
+			std::atomic<bool> cancelling;
+			
+			std::atomic<int64_t> progress_done;
+			std::atomic<int64_t> progress_total;
+			
+			/* Worker thread state. */
+			
+			DocumentReader reader;
+			std::vector<int64_t> int_values;
+			std::vector<double> float_values;
+			std::vector<Annotation> batch;
+			std::string worker_error;
+			
+			std::mutex pending_lock;                       /**< Mutex protecting access to this block of members: */
+			std::list< std::vector<Annotation> > pending;  /**< Batches waiting to be applied by the UI thread. */
+			
+			void worker_main();
+			void worker_setup(lua_State *L);
+			
+			bool worker_read(off_t offset, off_t length, const unsigned char **data, size_t *read_length);
+			bool worker_read_numbers(off_t offset, const char *type, size_t count, bool *is_float);
+			bool worker_queue(Annotation::Kind kind, off_t offset, off_t length, const char *text, size_t text_length, int colour);
+			void worker_flush();
+			
+			void apply_pending();
+			void stop_worker();
+			void finish(State state, const std::string &error);
+			
+			void OnWorkerFinished();
+			void OnDataModifying(OffsetLengthEvent &event);
+			
+			static int lua_job_length(lua_State *L);
+			static int lua_job_read(lua_State *L);
+			static int lua_job_read_numbers(lua_State *L);
+			static int lua_job_set_comment(lua_State *L);
+			static int lua_job_set_data_type(lua_State *L);
+			static int lua_job_set_highlight(lua_State *L);
+			static int lua_job_progress(lua_State *L);
+			static int lua_job_flush(lua_State *L);
+			static int lua_job_cancelled(lua_State *L);
+			static int lua_job_print(lua_State *L);
+			
+			static void lua_cancel_hook(lua_State *L, struct lua_Debug *ar);
+	};
+}
+
+#endif /* !REHEX_LUAANALYSISJOB_HPP */
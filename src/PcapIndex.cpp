@@ -0,0 +1,861 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "PcapIndex.hpp"
+#include "profile.hpp"
+
+#define PCAP_HEADER_SIZE 24
+#define PCAP_RECORD_SIZE 16
+
+#define PCAPNG_SHB_TYPE 0x0A0D0D0A
+#define PCAPNG_IDB_TYPE 0x00000001
+#define PCAPNG_OPB_TYPE 0x00000002 /* Obsolete Packet Block */
+#define PCAPNG_SPB_TYPE 0x00000003
+#define PCAPNG_EPB_TYPE 0x00000006
+
+#define PCAPNG_BLOCK_HEADER_SIZE 12  /* Block type, block length and trailing block length. */
+#define PCAPNG_EPB_DATA_OFFSET   28
+#define PCAPNG_SPB_DATA_OFFSET   12
+
+#define PCAPNG_OPT_ENDOFOPT   0
+#define PCAPNG_OPT_IF_TSRESOL 9
+#define PCAPNG_OPT_IF_TSOFFSET 14
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_IPV6 0x86DD
+
+#define IPPROTO_NUM_TCP 6
+#define IPPROTO_NUM_UDP 17
+
+constexpr uint8_t REHex::PcapIndex::PF_BIG_ENDIAN;
+constexpr uint8_t REHex::PcapIndex::PF_NANOSECOND;
+constexpr int64_t REHex::PcapIndex::NO_TIMESTAMP;
+constexpr uint16_t REHex::PcapIndex::LINKTYPE_NULL;
+constexpr uint16_t REHex::PcapIndex::LINKTYPE_ETHERNET;
+constexpr uint16_t REHex::PcapIndex::LINKTYPE_RAW;
+constexpr uint16_t REHex::PcapIndex::LINKTYPE_IPV4;
+constexpr uint16_t REHex::PcapIndex::LINKTYPE_IPV6;
+constexpr size_t REHex::PcapIndex::PACKETS_PER_STEP;
+
+static std::string offset_str(off_t offset)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "0x%08" PRIX64, (uint64_t)(offset));
+	
+	return buf;
+}
+
+REHex::PcapIndex::PcapIndex(const Document *document):
+	document(document),
+	format(Format::UNKNOWN),
+	is_finished(false),
+	reader(document),
+	next_offset(0),
+	big_endian(false),
+	pcap_link_type(0),
+	pcap_nanosecond(false) {}
+
+bool REHex::PcapIndex::build_step(size_t max_packets)
+{
+	PROFILE_BLOCK("REHex::PcapIndex::build_step");
+	
+	{
+		std::unique_lock<std::mutex> l(lock);
+		
+		if(is_finished)
+		{
+			return true;
+		}
+	}
+	
+	/* format is only ever written by this thread, so reading it without the lock is safe. */
+	bool done = (format == Format::UNKNOWN && !detect_format());
+	
+	std::vector<Packet> batch;
+	batch.reserve(std::min<size_t>(max_packets, 1024));
+	
+	while(!done && batch.size() < max_packets)
+	{
+		done = format == Format::PCAP
+			? step_pcap(&batch)
+			: step_pcapng(&batch);
+	}
+	
+	std::unique_lock<std::mutex> l(lock);
+	
+	packets.insert(packets.end(), batch.begin(), batch.end());
+	
+	if(done)
+	{
+		is_finished = true;
+	}
+	
+	return done;
+}
+
+bool REHex::PcapIndex::finished() const
+{
+	std::unique_lock<std::mutex> l(lock);
+	return is_finished;
+}
+
+REHex::PcapIndex::Format REHex::PcapIndex::get_format() const
+{
+	std::unique_lock<std::mutex> l(lock);
+	return format;
+}
+
+std::string REHex::PcapIndex::get_error() const
+{
+	std::unique_lock<std::mutex> l(lock);
+	return error;
+}
+
+size_t REHex::PcapIndex::size() const
+{
+	std::unique_lock<std::mutex> l(lock);
+	return packets.size();
+}
+
+REHex::PcapIndex::Packet REHex::PcapIndex::get_packet(size_t index) const
+{
+	std::unique_lock<std::mutex> l(lock);
+	
+	assert(index < packets.size());
+	return packets[index];
+}
+
+bool REHex::PcapIndex::find_packet(off_t offset, size_t *index) const
+{
+	std::unique_lock<std::mutex> l(lock);
+	
+	/* Packets are indexed in file order, so the first packet ending after the offset is
+	 * the only one which can contain it.
+	*/
+	
+	auto p = std::upper_bound(packets.begin(), packets.end(), offset,
+		[](off_t offset, const Packet &packet) { return offset < (off_t)(packet.offset + packet.length); });
+	
+	if(p != packets.end() && p->offset <= offset)
+	{
+		*index = p - packets.begin();
+		return true;
+	}
+	
+	return false;
+}
+
+std::string REHex::PcapIndex::link_type_name(uint16_t link_type)
+{
+	switch(link_type)
+	{
+		case LINKTYPE_NULL:     return "BSD loopback";
+		case LINKTYPE_ETHERNET: return "Ethernet";
+		case LINKTYPE_RAW:      return "Raw IP";
+		case 105:               return "IEEE 802.11";
+		case 113:               return "Linux cooked";
+		case 127:               return "IEEE 802.11 radiotap";
+		case LINKTYPE_IPV4:     return "Raw IPv4";
+		case LINKTYPE_IPV6:     return "Raw IPv6";
+		case 276:               return "Linux cooked v2";
+		
+		default:
+			return "Link type " + std::to_string(link_type);
+	}
+}
+
+std::string REHex::PcapIndex::format_timestamp(int64_t timestamp_ns)
+{
+	if(timestamp_ns == NO_TIMESTAMP)
+	{
+		return "";
+	}
+	
+	int64_t secs = timestamp_ns / 1000000000;
+	int64_t nsecs = timestamp_ns % 1000000000;
+	
+	if(nsecs < 0)
+	{
+		secs -= 1;
+		nsecs += 1000000000;
+	}
+	
+	int64_t days = secs / 86400;
+	int64_t day_secs = secs % 86400;
+	
+	if(day_secs < 0)
+	{
+		days -= 1;
+		day_secs += 86400;
+	}
+	
+	/* Convert days since 1970-01-01 to a proleptic Gregorian calendar date. */
+	
+	int64_t z = days + 719468;
+	int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	int64_t doe = z - era * 146097;
+	int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	int64_t mp = (5 * doy + 2) / 153;
+	
+	int64_t day = doy - (153 * mp + 2) / 5 + 1;
+	int64_t month = mp < 10 ? mp + 3 : mp - 9;
+	int64_t year = yoe + era * 400 + (month <= 2);
+	
+	char buf[128];
+	snprintf(buf, sizeof(buf), "%04" PRId64 "-%02" PRId64 "-%02" PRId64 " %02" PRId64 ":%02" PRId64 ":%02" PRId64 ".%09" PRId64,
+		year, month, day, (day_secs / 3600), ((day_secs / 60) % 60), (day_secs % 60), nsecs);
+	
+	return buf;
+}
+
+uint16_t REHex::PcapIndex::u16(const unsigned char *data, bool big_endian)
+{
+	return big_endian
+		? (((uint16_t)(data[0]) << 8) | (uint16_t)(data[1]))
+		: (((uint16_t)(data[1]) << 8) | (uint16_t)(data[0]));
+}
+
+uint32_t REHex::PcapIndex::u32(const unsigned char *data, bool big_endian)
+{
+	return big_endian
+		? (((uint32_t)(u16(data, true)) << 16) | (uint32_t)(u16(data + 2, true)))
+		: (((uint32_t)(u16(data + 2, false)) << 16) | (uint32_t)(u16(data, false)));
+}
+
+int64_t REHex::PcapIndex::interface_timestamp(const Interface &interface, uint64_t units)
+{
+	uint64_t secs = units / interface.ts_units_per_sec;
+	uint64_t frac = units % interface.ts_units_per_sec;
+	
+	int64_t frac_ns;
+	if(interface.ts_units_per_sec <= 1000000000 && (1000000000 % interface.ts_units_per_sec) == 0)
+	{
+		frac_ns = frac * (1000000000 / interface.ts_units_per_sec);
+	}
+	else{
+		frac_ns = (int64_t)(((double)(frac) * 1000000000.0) / (double)(interface.ts_units_per_sec));
+	}
+	
+	return ((int64_t)(secs) + interface.ts_offset_sec) * 1000000000 + frac_ns;
+}
+
+bool REHex::PcapIndex::read_exact(off_t offset, size_t length, const unsigned char **data)
+{
+	reader.seek(BitOffset(offset, 0));
+	
+	size_t read_length;
+	*data = reader.read(length, &read_length);
+	
+	return read_length == length;
+}
+
+void REHex::PcapIndex::set_error(const std::string &error)
+{
+	std::unique_lock<std::mutex> l(lock);
+	this->error = error;
+}
+
+bool REHex::PcapIndex::detect_format()
+{
+	const unsigned char *magic;
+	if(!read_exact(0, 4, &magic))
+	{
+		set_error("Not a pcap or pcapng file");
+		return false;
+	}
+	
+	if(u32(magic, false) == PCAPNG_SHB_TYPE)
+	{
+		/* Byte order is determined by each Section Header Block. */
+		
+		std::unique_lock<std::mutex> l(lock);
+		format = Format::PCAPNG;
+		
+		return true;
+	}
+	
+	uint32_t magic_le = u32(magic, false);
+	uint32_t magic_be = u32(magic, true);
+	
+	if(magic_le == 0xA1B2C3D4 || magic_le == 0xA1B23C4D)
+	{
+		big_endian = false;
+		pcap_nanosecond = (magic_le == 0xA1B23C4D);
+	}
+	else if(magic_be == 0xA1B2C3D4 || magic_be == 0xA1B23C4D)
+	{
+		big_endian = true;
+		pcap_nanosecond = (magic_be == 0xA1B23C4D);
+	}
+	else{
+		set_error("Not a pcap or pcapng file");
+		return false;
+	}
+	
+	const unsigned char *header;
+	if(!read_exact(0, PCAP_HEADER_SIZE, &header))
+	{
+		set_error("Truncated pcap file header");
+		return false;
+	}
+	
+	/* The upper bits of the link type field may hold FCS information. */
+	pcap_link_type = u32(header + 20, big_endian) & 0xFFFF;
+	
+	next_offset = PCAP_HEADER_SIZE;
+	
+	std::unique_lock<std::mutex> l(lock);
+	format = Format::PCAP;
+	
+	return true;
+}
+
+bool REHex::PcapIndex::step_pcap(std::vector<Packet> *batch)
+{
+	if(next_offset >= document->buffer_length())
+	{
+		return true;
+	}
+	
+	const unsigned char *header;
+	if(!read_exact(next_offset, PCAP_RECORD_SIZE, &header))
+	{
+		set_error("Truncated packet record at offset " + offset_str(next_offset));
+		return true;
+	}
+	
+	Packet packet;
+	packet.offset = next_offset;
+	packet.data_offset = PCAP_RECORD_SIZE;
+	packet.flags = (big_endian ? PF_BIG_ENDIAN : 0) | (pcap_nanosecond ? PF_NANOSECOND : 0);
+	packet.link_type = pcap_link_type;
+	
+	uint32_t ts_sec = u32(header, big_endian);
+	uint32_t ts_frac = u32(header + 4, big_endian);
+	
+	packet.timestamp_ns = (int64_t)(ts_sec) * 1000000000 + (int64_t)(ts_frac) * (pcap_nanosecond ? 1 : 1000);
+	
+	packet.captured_length = u32(header + 8, big_endian);
+	packet.original_length = u32(header + 12, big_endian);
+	
+	if(packet.captured_length > (document->buffer_length() - next_offset - PCAP_RECORD_SIZE))
+	{
+		set_error("Truncated packet record at offset " + offset_str(next_offset));
+		return true;
+	}
+	
+	packet.length = PCAP_RECORD_SIZE + packet.captured_length;
+	
+	batch->push_back(packet);
+	next_offset += packet.length;
+	
+	return false;
+}
+
+bool REHex::PcapIndex::step_pcapng(std::vector<Packet> *batch)
+{
+	if(next_offset >= document->buffer_length())
+	{
+		return true;
+	}
+	
+	const unsigned char *header;
+	if(!read_exact(next_offset, PCAPNG_BLOCK_HEADER_SIZE, &header))
+	{
+		set_error("Truncated block at offset " + offset_str(next_offset));
+		return true;
+	}
+	
+	if(u32(header, false) == PCAPNG_SHB_TYPE)
+	{
+		/* A new section, which may have a different byte order and has its own interfaces. */
+		
+		uint32_t bom = u32(header + 8, true);
+		
+		if(bom == 0x1A2B3C4D)
+		{
+			big_endian = true;
+		}
+		else if(bom == 0x4D3C2B1A)
+		{
+			big_endian = false;
+		}
+		else{
+			set_error("Invalid byte-order magic in section header at offset " + offset_str(next_offset));
+			return true;
+		}
+		
+		interfaces.clear();
+	}
+	
+	uint32_t block_type = u32(header, big_endian);
+	uint32_t block_length = u32(header + 4, big_endian);
+	
+	if(block_length < PCAPNG_BLOCK_HEADER_SIZE || (block_length % 4) != 0)
+	{
+		set_error("Invalid block length at offset " + offset_str(next_offset));
+		return true;
+	}
+	
+	if(block_length > (document->buffer_length() - next_offset))
+	{
+		set_error("Truncated block at offset " + offset_str(next_offset));
+		return true;
+	}
+	
+	switch(block_type)
+	{
+		case PCAPNG_IDB_TYPE:
+			if(!parse_interface(next_offset, block_length))
+			{
+				return true;
+			}
+			
+			break;
+		
+		case PCAPNG_EPB_TYPE:
+		case PCAPNG_OPB_TYPE:
+		{
+			if(block_length < (PCAPNG_EPB_DATA_OFFSET + 4) || !read_exact(next_offset, PCAPNG_EPB_DATA_OFFSET, &header))
+			{
+				set_error("Truncated packet block at offset " + offset_str(next_offset));
+				return true;
+			}
+			
+			uint32_t interface_id = block_type == PCAPNG_EPB_TYPE
+				? u32(header + 8, big_endian)
+				: u16(header + 8, big_endian);
+			
+			if(!add_pcapng_packet(batch, header, block_length, interface_id))
+			{
+				return true;
+			}
+			
+			break;
+		}
+		
+		case PCAPNG_SPB_TYPE:
+		{
+			if(block_length < (PCAPNG_SPB_DATA_OFFSET + 4) || !read_exact(next_offset, PCAPNG_SPB_DATA_OFFSET, &header))
+			{
+				set_error("Truncated packet block at offset " + offset_str(next_offset));
+				return true;
+			}
+			
+			if(interfaces.empty())
+			{
+				set_error("Simple packet block without an interface at offset " + offset_str(next_offset));
+				return true;
+			}
+			
+			Packet packet;
+			packet.offset = next_offset;
+			packet.timestamp_ns = NO_TIMESTAMP;
+			packet.length = block_length;
+			packet.original_length = u32(header + 8, big_endian);
+			packet.captured_length = std::min<uint32_t>(packet.original_length, (block_length - PCAPNG_SPB_DATA_OFFSET - 4));
+			packet.data_offset = PCAPNG_SPB_DATA_OFFSET;
+			packet.flags = big_endian ? PF_BIG_ENDIAN : 0;
+			packet.link_type = interfaces[0].link_type;
+			
+			batch->push_back(packet);
+			
+			break;
+		}
+		
+		default:
+			/* Statistics, name resolution, custom blocks, etc. */
+			break;
+	}
+	
+	next_offset += block_length;
+	return false;
+}
+
+bool REHex::PcapIndex::parse_interface(off_t offset, uint32_t block_length)
+{
+	std::vector<unsigned char> block;
+	try {
+		block = document->read_data(offset, block_length);
+	}
+	catch(const std::exception &e)
+	{
+		set_error(std::string("Read error: ") + e.what());
+		return false;
+	}
+	
+	if(block.size() < (size_t)(block_length) || block_length < 20)
+	{
+		set_error("Truncated interface description block at offset " + offset_str(offset));
+		return false;
+	}
+	
+	Interface interface;
+	interface.link_type = u16(block.data() + 8, big_endian);
+	interface.ts_units_per_sec = 1000000;  /* Microseconds unless if_tsresol says otherwise. */
+	interface.ts_offset_sec = 0;
+	
+	/* Options run from after the fixed fields to the trailing block length. */
+	
+	size_t pos = 16;
+	size_t end = block_length - 4;
+	
+	while((end - pos) >= 4)
+	{
+		uint16_t opt_code = u16(block.data() + pos, big_endian);
+		uint16_t opt_length = u16(block.data() + pos + 2, big_endian);
+		
+		pos += 4;
+		
+		if(opt_code == PCAPNG_OPT_ENDOFOPT || opt_length > (end - pos))
+		{
+			break;
+		}
+		
+		if(opt_code == PCAPNG_OPT_IF_TSRESOL && opt_length >= 1)
+		{
+			uint8_t tsresol = block[pos];
+			
+			if(tsresol & 0x80)
+			{
+				interface.ts_units_per_sec = (uint64_t)(1) << std::min(63, (tsresol & 0x7F));
+			}
+			else{
+				interface.ts_units_per_sec = 1;
+				
+				for(int i = 0; i < std::min(19, (int)(tsresol)); ++i)
+				{
+					interface.ts_units_per_sec *= 10;
+				}
+			}
+		}
+		else if(opt_code == PCAPNG_OPT_IF_TSOFFSET && opt_length >= 8)
+		{
+			uint64_t hi = u32(block.data() + pos + (big_endian ? 0 : 4), big_endian);
+			uint64_t lo = u32(block.data() + pos + (big_endian ? 4 : 0), big_endian);
+			
+			interface.ts_offset_sec = (int64_t)((hi << 32) | lo);
+		}
+		
+		/* Option values are padded to 32 bits. */
+		pos += std::min<size_t>(((opt_length + 3) & ~3), (end - pos));
+	}
+	
+	interfaces.push_back(interface);
+	
+	return true;
+}
+
+bool REHex::PcapIndex::add_pcapng_packet(std::vector<Packet> *batch, const unsigned char *header, uint32_t block_length, uint32_t interface_id)
+{
+	if(interface_id >= interfaces.size())
+	{
+		set_error("Packet block references an undefined interface at offset " + offset_str(next_offset));
+		return false;
+	}
+	
+	const Interface &interface = interfaces[interface_id];
+	
+	Packet packet;
+	packet.offset = next_offset;
+	packet.length = block_length;
+	packet.captured_length = u32(header + 20, big_endian);
+	packet.original_length = u32(header + 24, big_endian);
+	packet.data_offset = PCAPNG_EPB_DATA_OFFSET;
+	packet.flags = big_endian ? PF_BIG_ENDIAN : 0;
+	packet.link_type = interface.link_type;
+	
+	uint64_t ts_units = ((uint64_t)(u32(header + 12, big_endian)) << 32) | (uint64_t)(u32(header + 16, big_endian));
+	packet.timestamp_ns = interface_timestamp(interface, ts_units);
+	
+	if(packet.captured_length > (block_length - PCAPNG_EPB_DATA_OFFSET - 4))
+	{
+		set_error("Captured length exceeds packet block at offset " + offset_str(next_offset));
+		return false;
+	}
+	
+	batch->push_back(packet);
+	
+	return true;
+}
+
+std::vector<REHex::PcapIndex::Field> REHex::PcapIndex::dissect(size_t index) const
+{
+	Packet packet = get_packet(index);
+	Format format = get_format();
+	
+	std::vector<unsigned char> data = document->read_data(packet.offset, packet.length);
+	
+	std::vector<Field> fields;
+	fields.emplace_back(packet.offset, packet.length, "Packet #" + std::to_string(index + 1));
+	
+	if(data.size() < packet.length)
+	{
+		/* The Document has been truncated since the packet was indexed. */
+		return fields;
+	}
+	
+	dissect_record(packet, format, data, &fields);
+	
+	size_t data_begin = packet.data_offset;
+	size_t data_end = data_begin + packet.captured_length;
+	
+	if(packet.captured_length > 0)
+	{
+		fields.emplace_back(packet.data_begin(), packet.captured_length, "Packet data");
+	}
+	
+	switch(packet.link_type)
+	{
+		case LINKTYPE_ETHERNET:
+			dissect_ethernet(packet.offset, data, data_begin, data_end, &fields);
+			break;
+		
+		case LINKTYPE_RAW:
+		case LINKTYPE_IPV4:
+		case LINKTYPE_IPV6:
+			dissect_ip(packet.offset, data, data_begin, data_end, &fields);
+			break;
+		
+		default:
+			break;
+	}
+	
+	return fields;
+}
+
+void REHex::PcapIndex::dissect_record(const Packet &packet, Format format, const std::vector<unsigned char> &data, std::vector<Field> *fields)
+{
+	bool big_endian = (packet.flags & PF_BIG_ENDIAN) != 0;
+	
+	const char *u16_type = big_endian ? "u16be" : "u16le";
+	const char *u32_type = big_endian ? "u32be" : "u32le";
+	
+	off_t base = packet.offset;
+	
+	if(format == Format::PCAP)
+	{
+		fields->emplace_back((base + 0), 4, "Timestamp (seconds)", u32_type);
+		fields->emplace_back((base + 4), 4, ((packet.flags & PF_NANOSECOND) ? "Timestamp (nanoseconds)" : "Timestamp (microseconds)"), u32_type);
+		fields->emplace_back((base + 8), 4, "Captured length", u32_type);
+		fields->emplace_back((base + 12), 4, "Original length", u32_type);
+		
+		return;
+	}
+	
+	uint32_t block_type = u32(data.data(), big_endian);
+	
+	fields->emplace_back((base + 0), 4, "Block type", u32_type);
+	fields->emplace_back((base + 4), 4, "Block total length", u32_type);
+	
+	if(block_type == PCAPNG_SPB_TYPE)
+	{
+		fields->emplace_back((base + 8), 4, "Original length", u32_type);
+	}
+	else{
+		if(block_type == PCAPNG_OPB_TYPE)
+		{
+			fields->emplace_back((base + 8), 2, "Interface ID", u16_type);
+			fields->emplace_back((base + 10), 2, "Drops count", u16_type);
+		}
+		else{
+			fields->emplace_back((base + 8), 4, "Interface ID", u32_type);
+		}
+		
+		fields->emplace_back((base + 12), 4, "Timestamp (high)", u32_type);
+		fields->emplace_back((base + 16), 4, "Timestamp (low)", u32_type);
+		fields->emplace_back((base + 20), 4, "Captured length", u32_type);
+		fields->emplace_back((base + 24), 4, "Original length", u32_type);
+		
+		/* Packet data is padded to 32 bits, anything after that is options. */
+		
+		size_t options_begin = packet.data_offset + ((packet.captured_length + 3) & ~3);
+		size_t options_end = packet.length - 4;
+		
+		if(options_begin < options_end)
+		{
+			fields->emplace_back((base + options_begin), (options_end - options_begin), "Options");
+		}
+	}
+	
+	fields->emplace_back((base + packet.length - 4), 4, "Block total length", u32_type);
+}
+
+void REHex::PcapIndex::dissect_ethernet(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, std::vector<Field> *fields)
+{
+	if((end - pos) < 14)
+	{
+		return;
+	}
+	
+	size_t header_begin = pos;
+	size_t header_field = fields->size();
+	
+	fields->emplace_back((base + pos), 6, "Ethernet destination");
+	fields->emplace_back((base + pos + 6), 6, "Ethernet source");
+	pos += 12;
+	
+	uint16_t ethertype = u16(data.data() + pos, true);
+	
+	while(ethertype == ETHERTYPE_VLAN && (end - pos) >= 6)
+	{
+		fields->emplace_back((base + pos), 4, "VLAN tag");
+		pos += 4;
+		
+		ethertype = u16(data.data() + pos, true);
+	}
+	
+	fields->emplace_back((base + pos), 2, "EtherType", "u16be");
+	pos += 2;
+	
+	fields->insert(std::next(fields->begin(), header_field), Field((base + header_begin), (pos - header_begin), "Ethernet header"));
+	
+	if(ethertype == ETHERTYPE_IPV4 || ethertype == ETHERTYPE_IPV6)
+	{
+		dissect_ip(base, data, pos, end, fields);
+	}
+}
+
+void REHex::PcapIndex::dissect_ip(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, std::vector<Field> *fields)
+{
+	if(pos >= end)
+	{
+		return;
+	}
+	
+	unsigned version = data[pos] >> 4;
+	
+	if(version == 4)
+	{
+		size_t ihl = (data[pos] & 0x0F) * 4;
+		
+		if(ihl < 20 || (end - pos) < ihl)
+		{
+			return;
+		}
+		
+		uint16_t frag = u16(data.data() + pos + 6, true);
+		uint8_t protocol = data[pos + 9];
+		
+		fields->emplace_back((base + pos), ihl, "IPv4 header");
+		fields->emplace_back((base + pos), 1, "IPv4 version / header length");
+		fields->emplace_back((base + pos + 1), 1, "IPv4 DSCP / ECN");
+		fields->emplace_back((base + pos + 2), 2, "IPv4 total length", "u16be");
+		fields->emplace_back((base + pos + 4), 2, "IPv4 identification", "u16be");
+		fields->emplace_back((base + pos + 6), 2, "IPv4 flags / fragment offset");
+		fields->emplace_back((base + pos + 8), 1, "IPv4 TTL", "u8");
+		fields->emplace_back((base + pos + 9), 1, "IPv4 protocol", "u8");
+		fields->emplace_back((base + pos + 10), 2, "IPv4 header checksum");
+		fields->emplace_back((base + pos + 12), 4, "IPv4 source address");
+		fields->emplace_back((base + pos + 16), 4, "IPv4 destination address");
+		
+		if(ihl > 20)
+		{
+			fields->emplace_back((base + pos + 20), (ihl - 20), "IPv4 options");
+		}
+		
+		/* Only the first fragment has the transport header. */
+		if((frag & 0x1FFF) == 0)
+		{
+			dissect_transport(base, data, (pos + ihl), end, protocol, fields);
+		}
+	}
+	else if(version == 6)
+	{
+		if((end - pos) < 40)
+		{
+			return;
+		}
+		
+		uint8_t next_header = data[pos + 6];
+		
+		fields->emplace_back((base + pos), 40, "IPv6 header");
+		fields->emplace_back((base + pos), 4, "IPv6 version / traffic class / flow label");
+		fields->emplace_back((base + pos + 4), 2, "IPv6 payload length", "u16be");
+		fields->emplace_back((base + pos + 6), 1, "IPv6 next header", "u8");
+		fields->emplace_back((base + pos + 7), 1, "IPv6 hop limit", "u8");
+		fields->emplace_back((base + pos + 8), 16, "IPv6 source address");
+		fields->emplace_back((base + pos + 24), 16, "IPv6 destination address");
+		
+		dissect_transport(base, data, (pos + 40), end, next_header, fields);
+	}
+}
+
+void REHex::PcapIndex::dissect_transport(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, uint8_t protocol, std::vector<Field> *fields)
+{
+	if(protocol == IPPROTO_NUM_TCP)
+	{
+		if((end - pos) < 20)
+		{
+			return;
+		}
+		
+		size_t data_offset = (data[pos + 12] >> 4) * 4;
+		if(data_offset < 20 || (end - pos) < data_offset)
+		{
+			return;
+		}
+		
+		fields->emplace_back((base + pos), data_offset, "TCP header");
+		fields->emplace_back((base + pos), 2, "TCP source port", "u16be");
+		fields->emplace_back((base + pos + 2), 2, "TCP destination port", "u16be");
+		fields->emplace_back((base + pos + 4), 4, "TCP sequence number", "u32be");
+		fields->emplace_back((base + pos + 8), 4, "TCP acknowledgement number", "u32be");
+		fields->emplace_back((base + pos + 12), 2, "TCP data offset / flags");
+		fields->emplace_back((base + pos + 14), 2, "TCP window size", "u16be");
+		fields->emplace_back((base + pos + 16), 2, "TCP checksum");
+		fields->emplace_back((base + pos + 18), 2, "TCP urgent pointer", "u16be");
+		
+		if(data_offset > 20)
+		{
+			fields->emplace_back((base + pos + 20), (data_offset - 20), "TCP options");
+		}
+		
+		if((end - pos) > data_offset)
+		{
+			fields->emplace_back((base + pos + data_offset), (end - pos - data_offset), "TCP payload");
+		}
+	}
+	else if(protocol == IPPROTO_NUM_UDP)
+	{
+		if((end - pos) < 8)
+		{
+			return;
+		}
+		
+		fields->emplace_back((base + pos), 8, "UDP header");
+		fields->emplace_back((base + pos), 2, "UDP source port", "u16be");
+		fields->emplace_back((base + pos + 2), 2, "UDP destination port", "u16be");
+		fields->emplace_back((base + pos + 4), 2, "UDP length", "u16be");
+		fields->emplace_back((base + pos + 6), 2, "UDP checksum");
+		
+		if((end - pos) > 8)
+		{
+			fields->emplace_back((base + pos + 8), (end - pos - 8), "UDP payload");
+		}
+	}
+}
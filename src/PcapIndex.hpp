@@ -0,0 +1,223 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_PCAPINDEX_HPP
+#define REHEX_PCAPINDEX_HPP
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "document.hpp"
+#include "DocumentReader.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Index of the packets in a pcap or pcapng capture file.
+	 *
+	 * The index is built in a single sequential pass over the Document by calling
+	 * build_step() until it returns true, usually from a ThreadPool task. Only the
+	 * position, length, timestamp and link type of each packet are recorded, packets
+	 * are only dissected when dissect() is called for them.
+	 *
+	 * build_step() must only be called from one thread at a time, the other methods
+	 * may be called from any thread while the index is being built.
+	*/
+	class PcapIndex
+	{
+		public:
+			enum class Format
+			{
+				UNKNOWN,  /**< Not determined yet, or not a capture file. */
+				PCAP,     /**< Classic libpcap format. */
+				PCAPNG,   /**< pcapng format. */
+			};
+			
+			/**
+			 * @brief A packet in the capture.
+			*/
+			struct Packet
+			{
+				off_t offset;              /**< Offset of the packet record (or block). */
+				int64_t timestamp_ns;      /**< Capture time in nanoseconds since the epoch. */
+				uint32_t length;           /**< Length of the record (or block). */
+				uint32_t captured_length;  /**< Length of the captured packet data. */
+				uint32_t original_length;  /**< Length of the packet on the wire. */
+				uint8_t data_offset;       /**< Offset of the packet data within the record. */
+				uint8_t flags;             /**< Bitwise OR of PF_* values. */
+				uint16_t link_type;        /**< LINKTYPE_* value of the packet data. */
+				
+				off_t data_begin() const
+				{
+					return offset + data_offset;
+				}
+			};
+			
+			/**
+			 * @brief A field found by dissect().
+			*/
+			struct Field
+			{
+				off_t offset;
+				off_t length;
+				
+				std::string text;  /**< Comment text. */
+				std::string type;  /**< Data type to apply, empty if none. */
+				
+				Field(off_t offset, off_t length, const std::string &text, const std::string &type = ""):
+					offset(offset), length(length), text(text), type(type) {}
+			};
+			
+			static constexpr uint8_t PF_BIG_ENDIAN = 1;  /**< Record headers are big endian. */
+			static constexpr uint8_t PF_NANOSECOND = 2;  /**< Classic pcap timestamp has nanosecond resolution. */
+			
+			/**
+			 * @brief Packet::timestamp_ns value of packets without a timestamp.
+			*/
+			static constexpr int64_t NO_TIMESTAMP = INT64_MIN;
+			
+			static constexpr uint16_t LINKTYPE_NULL     = 0;
+			static constexpr uint16_t LINKTYPE_ETHERNET = 1;
+			static constexpr uint16_t LINKTYPE_RAW      = 101;
+			static constexpr uint16_t LINKTYPE_IPV4     = 228;
+			static constexpr uint16_t LINKTYPE_IPV6     = 229;
+			
+			/**
+			 * @brief Maximum number of packets processed by each call to build_step().
+			*/
+			static constexpr size_t PACKETS_PER_STEP = 16384;
+			
+			/**
+			 * @brief Create an empty index of a Document.
+			*/
+			PcapIndex(const Document *document);
+			
+			/**
+			 * @brief Index the next packets in the Document.
+			 *
+			 * Returns true once the end of the capture has been reached (or an error
+			 * was found), false if there are more packets to index.
+			*/
+			bool build_step(size_t max_packets = PACKETS_PER_STEP);
+			
+			/**
+			 * @brief Check if the whole capture has been indexed.
+			*/
+			bool finished() const;
+			
+			/**
+			 * @brief Get the format of the capture.
+			*/
+			Format get_format() const;
+			
+			/**
+			 * @brief Get the reason indexing stopped early, empty if it didn't.
+			 *
+			 * Packets indexed before the error are kept.
+			*/
+			std::string get_error() const;
+			
+			/**
+			 * @brief Get the number of packets indexed so far.
+			*/
+			size_t size() const;
+			
+			/**
+			 * @brief Get a packet from the index.
+			*/
+			Packet get_packet(size_t index) const;
+			
+			/**
+			 * @brief Find the packet which contains an offset.
+			 *
+			 * Returns true and sets *index if a packet record contains the offset.
+			*/
+			bool find_packet(off_t offset, size_t *index) const;
+			
+			/**
+			 * @brief Get the name of a link type.
+			*/
+			static std::string link_type_name(uint16_t link_type);
+			
+			/**
+			 * @brief Format a Packet::timestamp_ns value as a UTC date and time.
+			*/
+			static std::string format_timestamp(int64_t timestamp_ns);
+			
+			/**
+			 * @brief Describe the fields of a packet.
+			 *
+			 * Returns the fields of the packet record followed by the headers of
+			 * any protocols recognised in the packet data, outermost first.
+			*/
+			std::vector<Field> dissect(size_t index) const;
+		
+		private:
+			struct Interface
+			{
+				uint16_t link_type;
+				
+				uint64_t ts_units_per_sec;  /**< Resolution of timestamps (if_tsresol). */
+				int64_t ts_offset_sec;      /**< Offset added to timestamps (if_tsoffset). */
+			};
+			
+			const Document *document;
+			
+			mutable std::mutex lock;   /**< Mutex protecting access to this block of members: */
+			Format format;
+			bool is_finished;
+			std::string error;
+			std::vector<Packet> packets;
+			
+			/* Build state, only accessed by build_step(). */
+			
+			DocumentReader reader;
+			off_t next_offset;
+			
+			bool big_endian;
+			
+			uint16_t pcap_link_type;
+			bool pcap_nanosecond;
+			
+			std::vector<Interface> interfaces;
+			
+			static uint16_t u16(const unsigned char *data, bool big_endian);
+			static uint32_t u32(const unsigned char *data, bool big_endian);
+			static int64_t interface_timestamp(const Interface &interface, uint64_t units);
+			
+			bool read_exact(off_t offset, size_t length, const unsigned char **data);
+			
+			bool detect_format();
+			bool step_pcap(std::vector<Packet> *batch);
+			bool step_pcapng(std::vector<Packet> *batch);
+			bool parse_interface(off_t offset, uint32_t block_length);
+			bool add_pcapng_packet(std::vector<Packet> *batch, const unsigned char *header, uint32_t block_length, uint32_t interface_id);
+			
+			void set_error(const std::string &error);
+			
+			static void dissect_record(const Packet &packet, Format format, const std::vector<unsigned char> &data, std::vector<Field> *fields);
+			static void dissect_ethernet(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, std::vector<Field> *fields);
+			static void dissect_ip(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, std::vector<Field> *fields);
+			static void dissect_transport(off_t base, const std::vector<unsigned char> &data, size_t pos, size_t end, uint8_t protocol, std::vector<Field> *fields);
+	};
+}
+
+#endif /* !REHEX_PCAPINDEX_HPP */
@@ -0,0 +1,403 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <assert.h>
+#include <wx/menu.h>
+#include <wx/msgdlg.h>
+#include <wx/numformatter.h>
+#include <wx/sizer.h>
+#include <wx/utils.h>
+
+#include "App.hpp"
+#include "PcapPanel.hpp"
+#include "util.hpp"
+
+#define PCAP_PANEL_PADDING 4
+
+/* Interval between list updates while the capture is being indexed. */
+#define PCAP_PANEL_REFRESH_MS 200
+
+static REHex::ToolPanel *pcappanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::PcapPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("PcapPanel", "Packets", REHex::ToolPanel::TPS_TALL, &pcappanel_factory);
+
+enum {
+	ID_GOTO_TEXT = 1,
+	ID_GOTO_BUTTON,
+};
+
+BEGIN_EVENT_TABLE(REHex::PcapPanel, wxPanel)
+	EVT_TIMER(wxID_ANY, REHex::PcapPanel::OnTimerTick)
+	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::PcapPanel::OnItemActivate)
+	EVT_LIST_ITEM_RIGHT_CLICK(wxID_ANY, REHex::PcapPanel::OnItemRightClick)
+	EVT_TEXT_ENTER(ID_GOTO_TEXT, REHex::PcapPanel::OnGoto)
+	EVT_BUTTON(ID_GOTO_BUTTON, REHex::PcapPanel::OnGoto)
+END_EVENT_TABLE()
+
+REHex::PcapPanel::PcapPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	index_pending(false),
+	timer(this, wxID_ANY)
+{
+	list_ctrl = new PcapPanelListCtrl(this);
+	
+	list_ctrl->AppendColumn("#");
+	list_ctrl->AppendColumn("Offset");
+	list_ctrl->AppendColumn("Time (UTC)");
+	list_ctrl->AppendColumn("Length");
+	list_ctrl->AppendColumn("Link type");
+	
+	status_text = new wxStaticText(this, wxID_ANY, "");
+	
+	goto_text = new NumericTextCtrl(this, ID_GOTO_TEXT, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER);
+	goto_button = new wxButton(this, ID_GOTO_BUTTON, "Go", wxDefaultPosition, wxDefaultSize, wxBU_EXACTFIT);
+	
+	wxBoxSizer *goto_sizer = new wxBoxSizer(wxHORIZONTAL);
+	goto_sizer->Add(new wxStaticText(this, wxID_ANY, "Go to packet:"), 0, wxALIGN_CENTER_VERTICAL);
+	goto_sizer->Add(goto_text, 1, wxALIGN_CENTER_VERTICAL | wxLEFT, PCAP_PANEL_PADDING);
+	goto_sizer->Add(goto_button, 0, wxALIGN_CENTER_VERTICAL | wxLEFT, PCAP_PANEL_PADDING);
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(status_text, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), PCAP_PANEL_PADDING);
+	sizer->Add(goto_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), PCAP_PANEL_PADDING);
+	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), PCAP_PANEL_PADDING);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::PcapPanel::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::PcapPanel::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::PcapPanel::OnDataModified, this);
+	
+	restart();
+}
+
+REHex::PcapPanel::~PcapPanel()
+{
+	stop();
+}
+
+std::string REHex::PcapPanel::name() const
+{
+	return "PcapPanel";
+}
+
+std::string REHex::PcapPanel::label() const
+{
+	return "Packets";
+}
+
+REHex::ToolPanel::Shape REHex::PcapPanel::shape() const
+{
+	return ToolPanel::TPS_TALL;
+}
+
+void REHex::PcapPanel::save_state(wxConfigBase *config) const {}
+void REHex::PcapPanel::load_state(wxConfigBase *config) {}
+
+wxSize REHex::PcapPanel::DoGetBestClientSize() const
+{
+	return wxSize(300, -1);
+}
+
+void REHex::PcapPanel::update()
+{
+	if(!is_visible)
+	{
+		/* There is no sense in indexing the file if we are not visible */
+		return;
+	}
+	
+	if(index_pending)
+	{
+		index_pending = false;
+		
+		work_task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]() { return index->build_step(); }, 1, (is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW))));
+		timer.Start(PCAP_PANEL_REFRESH_MS, wxTIMER_CONTINUOUS);
+	}
+	
+	refresh();
+}
+
+void REHex::PcapPanel::visibility_changed()
+{
+	if(work_task)
+	{
+		work_task->change_priority(is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW);
+	}
+}
+
+void REHex::PcapPanel::restart()
+{
+	stop();
+	
+	index.reset(new PcapIndex(document));
+	index_pending = true;
+	
+	list_ctrl->SetItemCount(0);
+	
+	update();
+}
+
+void REHex::PcapPanel::stop()
+{
+	timer.Stop();
+	
+	if(work_task)
+	{
+		work_task->finish();
+		work_task->join();
+		work_task.reset(NULL);
+	}
+}
+
+void REHex::PcapPanel::refresh()
+{
+	size_t packet_count = index->size();
+	list_ctrl->SetItemCount(packet_count);
+	
+	std::string status;
+	
+	if(index_pending)
+	{
+		status = "";
+	}
+	else if(!index->finished())
+	{
+		status = "Indexing... " + wxNumberFormatter::ToString((long)(packet_count)).ToStdString() + " packets";
+	}
+	else{
+		std::string error = index->get_error();
+		
+		if(index->get_format() == PcapIndex::Format::UNKNOWN)
+		{
+			status = error;
+		}
+		else{
+			status = wxNumberFormatter::ToString((long)(packet_count)).ToStdString()
+				+ (index->get_format() == PcapIndex::Format::PCAPNG ? " packets (pcapng)" : " packets (pcap)");
+			
+			if(!error.empty())
+			{
+				status += "\n" + error;
+			}
+		}
+	}
+	
+	status_text->SetLabelText(status);
+}
+
+void REHex::PcapPanel::jump_to_packet(size_t packet_idx)
+{
+	assert(packet_idx < index->size());
+	
+	PcapIndex::Packet packet = index->get_packet(packet_idx);
+	
+	const BitRangeTree<Document::Comment> &comments = document->get_comments();
+	if(comments.find(BitRangeTreeKey(BitOffset(packet.offset, 0), BitOffset(packet.length, 0))) == comments.end())
+	{
+		annotate_packets({ packet_idx });
+	}
+	
+	document->set_cursor_position(packet.offset);
+	document_ctrl->set_selection_raw(packet.offset, (packet.offset + packet.length - 1));
+}
+
+void REHex::PcapPanel::annotate_packets(const std::vector<size_t> &indices)
+{
+	wxBusyCursor busy;
+	
+	Document::AnnotationSession session(document, (indices.size() == 1 ? "Annotate packet" : "Annotate packets"));
+	
+	for(auto i = indices.begin(); i != indices.end(); ++i)
+	{
+		std::vector<PcapIndex::Field> fields;
+		
+		try {
+			fields = index->dissect(*i);
+		}
+		catch(const std::exception &e)
+		{
+			/* Skip the packet rather than discarding the ones already annotated. */
+			wxGetApp().printf_error("Data read error in PcapPanel: %s\n", e.what());
+			continue;
+		}
+		
+		for(auto f = fields.begin(); f != fields.end(); ++f)
+		{
+			session.set_comment(BitOffset(f->offset, 0), BitOffset(f->length, 0), Document::Comment(wxString::FromUTF8(f->text.c_str())));
+			
+			if(!f->type.empty())
+			{
+				session.set_data_type(BitOffset(f->offset, 0), BitOffset(f->length, 0), f->type);
+			}
+		}
+	}
+	
+	session.commit();
+}
+
+void REHex::PcapPanel::OnDataModified(OffsetLengthEvent &event)
+{
+	/* Any change to the data may move or invalidate every packet after it. */
+	restart();
+	
+	event.Skip();
+}
+
+void REHex::PcapPanel::OnItemActivate(wxListEvent &event)
+{
+	long item_idx = event.GetIndex();
+	assert(item_idx >= 0);
+	
+	if((size_t)(item_idx) >= index->size())
+	{
+		/* UI thread probably hasn't caught up with the index yet. */
+		return;
+	}
+	
+	jump_to_packet(item_idx);
+}
+
+void REHex::PcapPanel::OnItemRightClick(wxListEvent &event)
+{
+	std::vector<size_t> selected;
+	size_t packet_count = index->size();
+	
+	for(long item_idx = list_ctrl->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+		item_idx >= 0;
+		item_idx = list_ctrl->GetNextItem(item_idx, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED))
+	{
+		if((size_t)(item_idx) < packet_count)
+		{
+			selected.push_back(item_idx);
+		}
+	}
+	
+	wxMenu menu;
+	
+	wxMenuItem *annotate = menu.Append(wxID_ANY, "&Annotate selected packets");
+	menu.Bind(wxEVT_MENU, [&](wxCommandEvent &event)
+	{
+		annotate_packets(selected);
+	}, annotate->GetId(), annotate->GetId());
+	
+	annotate->Enable(!selected.empty());
+	
+	PopupMenu(&menu);
+}
+
+void REHex::PcapPanel::OnGoto(wxCommandEvent &event)
+{
+	size_t packet_count = index->size();
+	
+	if(packet_count == 0)
+	{
+		wxBell();
+		return;
+	}
+	
+	size_t packet_num;
+	
+	try {
+		packet_num = goto_text->GetNumericValue<size_t>(1, packet_count, 0, 10);
+	}
+	catch(const NumericTextCtrl::InputError &e)
+	{
+		std::string message = std::string(e.what()) + "\n\nPlease enter a packet number";
+		wxMessageBox(message, "Error", (wxOK | wxICON_ERROR | wxCENTRE), this);
+		return;
+	}
+	
+	size_t packet_idx = packet_num - 1;
+	
+	long prev_item = -1;
+	while((prev_item = list_ctrl->GetNextItem(prev_item, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED)) >= 0)
+	{
+		list_ctrl->SetItemState(prev_item, 0, wxLIST_STATE_SELECTED);
+	}
+	
+	list_ctrl->SetItemState(packet_idx, (wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED), (wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED));
+	list_ctrl->EnsureVisible(packet_idx);
+	
+	jump_to_packet(packet_idx);
+}
+
+void REHex::PcapPanel::OnTimerTick(wxTimerEvent &event)
+{
+	refresh();
+	
+	if(index->finished())
+	{
+		timer.Stop();
+	}
+}
+
+REHex::PcapPanel::PcapPanelListCtrl::PcapPanelListCtrl(PcapPanel *parent):
+	wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, (wxLC_REPORT | wxLC_VIRTUAL)) {}
+
+wxString REHex::PcapPanel::PcapPanelListCtrl::OnGetItemText(long item, long column) const
+{
+	PcapPanel *parent = dynamic_cast<PcapPanel*>(GetParent());
+	assert(parent != NULL);
+	
+	if((size_t)(item) >= parent->index->size())
+	{
+		/* The index has been reset but SetItemCount() hasn't been called yet. */
+		return "???";
+	}
+	
+	PcapIndex::Packet packet = parent->index->get_packet(item);
+	
+	switch(column)
+	{
+		case 0:
+			/* Packet number column */
+			return wxNumberFormatter::ToString((long)(item + 1));
+		
+		case 1:
+			/* Offset column */
+			return format_offset(packet.offset, parent->document_ctrl->get_offset_display_base(), parent->document->buffer_length());
+		
+		case 2:
+			/* Time column */
+			return PcapIndex::format_timestamp(packet.timestamp_ns);
+		
+		case 3:
+			/* Length column */
+			if(packet.captured_length != packet.original_length)
+			{
+				return wxString::Format("%u / %u", (unsigned)(packet.captured_length), (unsigned)(packet.original_length));
+			}
+			else{
+				return wxString::Format("%u", (unsigned)(packet.captured_length));
+			}
+		
+		case 4:
+			/* Link type column */
+			return PcapIndex::link_type_name(packet.link_type);
+		
+		default:
+			/* Unknown column */
+			abort();
+	}
+}
@@ -0,0 +1,119 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_PCAPPANEL_HPP
+#define REHEX_PCAPPANEL_HPP
+
+#include <memory>
+#include <vector>
+#include <wx/button.h>
+#include <wx/listctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "NumericTextCtrl.hpp"
+#include "PcapIndex.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
+#include "ToolPanel.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel listing the packets in a pcap or pcapng capture.
+	 *
+	 * The capture is indexed by a PcapIndex on the ThreadPool and the list is filled
+	 * in as packets are found. Packets are only dissected and annotated when they
+	 * are opened from the list (or annotated from the context menu), so very large
+	 * captures don't flood the Document with comments.
+	*/
+	class PcapPanel: public ToolPanel
+	{
+		private:
+			class PcapPanelListCtrl: public wxListCtrl
+			{
+				public:
+					PcapPanelListCtrl(PcapPanel *parent);
+				
+				public:
+					virtual wxString OnGetItemText(long item, long column) const override;
+			};
+		
+		public:
+			PcapPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~PcapPanel();
+			
+			virtual std::string name() const override;
+			virtual std::string label() const override;
+			virtual Shape shape() const override;
+			
+			virtual void save_state(wxConfigBase *config) const override;
+			virtual void load_state(wxConfigBase *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+			
+			/**
+			 * @brief Move the cursor to a packet and select it.
+			 *
+			 * The packet is annotated first if it doesn't already have a comment.
+			*/
+			void jump_to_packet(size_t index);
+			
+			/**
+			 * @brief Comment the fields of the given packets.
+			*/
+			void annotate_packets(const std::vector<size_t> &indices);
+		
+		protected:
+			virtual void visibility_changed() override;
+			
+		private:
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			PcapPanelListCtrl *list_ctrl;
+			wxStaticText *status_text;
+			NumericTextCtrl *goto_text;
+			wxButton *goto_button;
+			
+			std::unique_ptr<PcapIndex> index;
+			std::unique_ptr<ThreadPool::TaskHandle> work_task;
+			bool index_pending;  /**< Index needs (re)building when the panel is visible. */
+			
+			wxTimer timer;
+			
+			void restart();
+			void stop();
+			void refresh();
+			
+			void OnDataModified(OffsetLengthEvent &event);
+			void OnItemActivate(wxListEvent &event);
+			void OnItemRightClick(wxListEvent &event);
+			void OnGoto(wxCommandEvent &event);
+			void OnTimerTick(wxTimerEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+		
+		friend PcapPanelListCtrl;
+	};
+}
+
+#endif /* !REHEX_PCAPPANEL_HPP */
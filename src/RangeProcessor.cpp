@@ -17,8 +17,10 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
 #include <assert.h>
-#include <numeric>
+#include <chrono>
+#include <limits>
 
 #include "App.hpp"
 #include "RangeProcessor.hpp"
@@ -27,11 +29,50 @@
 thread_local bool REHex::RangeProcessor::in_work_func = false;
 #endif
 
+thread_local off_t REHex::RangeProcessor::work_progress = 0;
+
+/* Maximum number of chunks in a single ChunkArray. Any ranges beyond this are left in the fragments
+ * set until the workers have claimed everything in the current array.
+*/
+static const size_t MAX_CHUNKS = 65536;
+
+/* Workers keep claiming chunks until this much time has passed before returning to the ThreadPool,
+ * so small windows don't spend most of their time in the pool's bookkeeping.
+*/
+static const std::chrono::milliseconds WORKER_SLICE(5);
+
+REHex::RangeProcessor::ChunkArray::ChunkArray(size_t size):
+	chunks(new Chunk[size]),
+	size(size),
+	next(0) {}
+
+bool REHex::RangeProcessor::ChunkArray::exhausted() const
+{
+	return next.load() >= size;
+}
+
+size_t REHex::RangeProcessor::ChunkArray::find_chunk(off_t offset) const
+{
+	const Chunk *first = std::partition_point(chunks.get(), chunks.get() + size, [&](const Chunk &chunk)
+	{
+		return (chunk.offset + chunk.length) <= offset;
+	});
+	
+	return first - chunks.get();
+}
+
 REHex::RangeProcessor::RangeProcessor(const std::function<void(off_t, off_t)> &work_func, size_t max_window_size):
 	work_func(work_func),
 	max_window_size(max_window_size),
 	max_threads(0),
-	task_paused(false)
+	priority(ThreadPool::TaskPriority::NORMAL),
+	task_paused(false),
+	cancelling(false),
+	current_chunks(NULL),
+	active_workers(0),
+	outstanding(0),
+	have_retired_chunks(false),
+	sets_empty(true)
 {}
 
 REHex::RangeProcessor::~RangeProcessor()
@@ -45,12 +86,35 @@ REHex::ByteRangeSet REHex::RangeProcessor::get_queue() const
 	
 	std::lock_guard<std::mutex> pl(pause_lock);
 	
-	/* Merge the all the ranges in queued, pending and working. */
+	/* Merge the all the ranges in fragments and queued with any unfinished chunks. */
 	
 	ByteRangeSet merged;
-	merged.set_ranges(queued.begin(),  queued.end());
-	merged.set_ranges(pending.begin(), pending.end());
-	merged.set_ranges(working.begin(), working.end());
+	merged.set_ranges(fragments.begin(), fragments.end());
+	merged.set_ranges(queued.begin(),    queued.end());
+	
+	auto merge_chunks = [&](const ChunkArray *array)
+	{
+		for(size_t i = 0; i < array->size; ++i)
+		{
+			const Chunk &chunk = array->chunks[i];
+			int state = chunk.state.load();
+			
+			if(state == CHUNK_PENDING || state == CHUNK_WORKING || state == CHUNK_REQUEUED)
+			{
+				merged.set_range(chunk.offset, chunk.length);
+			}
+		}
+	};
+	
+	for(auto r = retired_chunks.begin(); r != retired_chunks.end(); ++r)
+	{
+		merge_chunks(r->get());
+	}
+	
+	if(chunks)
+	{
+		merge_chunks(chunks.get());
+	}
 	
 	return merged;
 }
@@ -58,9 +122,7 @@ REHex::ByteRangeSet REHex::RangeProcessor::get_queue() const
 bool REHex::RangeProcessor::queue_empty() const
 {
 	assert(!in_work_func);
-	
-	std::lock_guard<std::mutex> pl(pause_lock);
-	return queued.empty() && pending.empty() && working.empty();
+	return outstanding.load() == 0;
 }
 
 void REHex::RangeProcessor::queue_range(off_t offset, off_t length)
@@ -71,7 +133,7 @@ void REHex::RangeProcessor::queue_range(off_t offset, off_t length)
 	
 	queue_range_locked(offset, length);
 	
-	if(!pending.empty() && task)
+	if(outstanding.load() > 0 && task)
 	{
 		/* Notify any sleeping workers that there is now work to be done. */
 		task.restart();
@@ -94,120 +156,402 @@ void REHex::RangeProcessor::unqueue_range(off_t offset, off_t length)
 	assert(!in_work_func);
 	
 	std::lock_guard<std::mutex> pl(pause_lock);
-	pending.clear_range(offset, length);
+	
+	fragments.clear_range(offset, length);
 	queued.clear_range(offset, length);
+	
+	off_t end = offset + length;
+	size_t cancelled = 0;
+	
+	for_each_chunk(offset, length, [&](Chunk *chunk)
+	{
+		int expect = CHUNK_PENDING;
+		if(chunk->state.compare_exchange_strong(expect, CHUNK_CANCELLED))
+		{
+			/* Put back any part of the chunk outside of the range being removed. */
+			
+			off_t chunk_end = chunk->offset + chunk->length;
+			
+			if(chunk->offset < offset)
+			{
+				fragments.set_range(chunk->offset, (offset - chunk->offset));
+			}
+			
+			if(chunk_end > end)
+			{
+				fragments.set_range(end, (chunk_end - end));
+			}
+			
+			++cancelled;
+		}
+	});
+	
+	update_sets_empty();
+	
+	if(cancelled > 0 && outstanding.fetch_sub(cancelled) == cancelled)
+	{
+		idle_cv.notify_all();
+	}
+	
+	if(outstanding.load() > 0 && task)
+	{
+		/* Make sure any fragments put back get picked up. */
+		task.restart();
+	}
 }
 
 void REHex::RangeProcessor::clear_queue()
 {
-	assert(!in_work_func);
-	
-	std::lock_guard<std::mutex> pl(pause_lock);
-	pending.clear_all();
-	queued.clear_all();
+	unqueue_range(0, std::numeric_limits<off_t>::max());
 }
 
 void REHex::RangeProcessor::data_inserted(off_t offset, off_t length)
 {
 	assert(task_paused);
-	pending.data_inserted(offset, length);
+	
+	std::lock_guard<std::mutex> pl(pause_lock);
+	
+	flatten_chunks();
+	fragments.data_inserted(offset, length);
 }
 
 void REHex::RangeProcessor::data_erased(off_t offset, off_t length)
 {
 	assert(task_paused);
-	pending.data_erased(offset, length);
+	
+	std::lock_guard<std::mutex> pl(pause_lock);
+	
+	flatten_chunks();
+	fragments.data_erased(offset, length);
+	
+	update_sets_empty();
 }
 
 void REHex::RangeProcessor::queue_range_locked(off_t offset, off_t length)
 {
-	ByteRangeSet to_pending;
-	to_pending.set_range(offset, length);
+	ByteRangeSet to_fragments;
+	to_fragments.set_range(offset, length);
+	
+	off_t end = offset + length;
+	
+	for_each_chunk(offset, length, [&](Chunk *chunk)
+	{
+		off_t isect_base = std::max(offset, chunk->offset);
+		off_t isect_end  = std::min(end, (chunk->offset + chunk->length));
+		
+		int state = chunk->state.load();
+		
+		if(state == CHUNK_PENDING)
+		{
+			/* Chunk hasn't been claimed yet, so the new data will be processed. */
+			to_fragments.clear_range(isect_base, (isect_end - isect_base));
+			return;
+		}
+		
+		/* The chunk is being processed, flag it so the worker moves the intersection from
+		 * the queued set to the fragments set when it finishes. If the worker has already
+		 * finished then the intersection goes straight to the fragments set instead.
+		*/
+		
+		while(state == CHUNK_WORKING && !chunk->state.compare_exchange_weak(state, CHUNK_REQUEUED)) {}
+		
+		if(state == CHUNK_WORKING || state == CHUNK_REQUEUED)
+		{
+			queued.set_range(isect_base, (isect_end - isect_base));
+			to_fragments.clear_range(isect_base, (isect_end - isect_base));
+		}
+	});
 	
-	ByteRangeSet to_queued = ByteRangeSet::intersection(to_pending, working);
+	fragments.set_ranges(to_fragments.begin(), to_fragments.end());
 	
-	to_pending.clear_ranges(to_queued.begin(), to_queued.end());
+	update_sets_empty();
+}
+
+void REHex::RangeProcessor::update_sets_empty()
+{
+	bool now_empty = fragments.empty() && queued.empty();
 	
-	queued .set_ranges( to_queued.begin(),  to_queued.end());
-	pending.set_ranges(to_pending.begin(), to_pending.end());
+	if(now_empty != sets_empty)
+	{
+		sets_empty = now_empty;
+		
+		if(!now_empty)
+		{
+			++outstanding;
+		}
+		else if(outstanding.fetch_sub(1) == 1)
+		{
+			idle_cv.notify_all();
+		}
+	}
 }
 
-void REHex::RangeProcessor::mark_work_done(off_t offset, off_t length)
+void REHex::RangeProcessor::refill_chunks()
 {
-	ByteRangeSet work_done;
-	work_done.set_range(offset, length);
+	ChunkArray *array = chunks.get();
 	
-	ByteRangeSet to_pending = ByteRangeSet::intersection(work_done, queued);
+	if((array != NULL && !array->exhausted()) || fragments.empty())
+	{
+		return;
+	}
+	
+	/* Break the lowest fragments into windows, up to MAX_CHUNKS of them. */
+	
+	std::vector< std::pair<off_t, off_t> > windows;
+	off_t taken_end = 0;
+	
+	for(auto r = fragments.begin(); r != fragments.end() && windows.size() < MAX_CHUNKS; ++r)
+	{
+		off_t r_end = r->offset + r->length;
+		
+		for(off_t w = r->offset; w < r_end && windows.size() < MAX_CHUNKS; w += max_window_size)
+		{
+			off_t w_length = std::min<off_t>((r_end - w), max_window_size);
+			
+			windows.push_back(std::make_pair(w, w_length));
+			taken_end = w + w_length;
+		}
+	}
+	
+	std::unique_ptr<ChunkArray> new_array(new ChunkArray(windows.size()));
+	
+	for(size_t i = 0; i < windows.size(); ++i)
+	{
+		new_array->chunks[i].offset = windows[i].first;
+		new_array->chunks[i].length = windows[i].second;
+		new_array->chunks[i].state = CHUNK_PENDING;
+	}
+	
+	/* Add the new chunks to the outstanding count before removing them from the fragments
+	 * so queue_empty() doesn't see it hit zero in between.
+	*/
+	
+	outstanding += windows.size();
 	
-	working.clear_range(offset, length);
+	fragments.clear_range(0, taken_end);
+	update_sets_empty();
+	
+	if(chunks)
+	{
+		retired_chunks.push_back(std::move(chunks));
+		have_retired_chunks = true;
+	}
 	
-	queued.clear_ranges(to_pending.begin(), to_pending.end());
-	pending.set_ranges(to_pending.begin(), to_pending.end());
+	chunks = std::move(new_array);
+	current_chunks = chunks.get();
 }
 
-bool REHex::RangeProcessor::task_function()
+void REHex::RangeProcessor::free_retired_chunks()
 {
-	std::unique_lock<std::mutex> pl(pause_lock);
+	/* Workers increment active_workers before loading current_chunks, so if there are no
+	 * active workers now then none of them can have a pointer to a retired array.
+	*/
 	
-	/* Take up to WINDOW_SIZE bytes from the next range in the pending pool to be
-	 * processed in this thread.
+	if(active_workers.load() == 0)
+	{
+		retired_chunks.clear();
+		have_retired_chunks = false;
+	}
+}
+
+void REHex::RangeProcessor::flatten_chunks()
+{
+	/* Move any unclaimed chunks back into the fragments set and free all the chunk arrays.
+	 * This may only be called while there are no workers running.
 	*/
 	
-	auto next_dirty_range = pending.begin();
-	if(next_dirty_range == pending.end())
+	assert(active_workers.load() == 0);
+	
+	size_t unclaimed = 0;
+	
+	for_each_chunk(0, std::numeric_limits<off_t>::max(), [&](Chunk *chunk)
 	{
-		if(queued.empty())
+		int state = chunk->state.load();
+		assert(state != CHUNK_WORKING && state != CHUNK_REQUEUED);
+		
+		if(state == CHUNK_PENDING)
 		{
-			/* All ranges processed. */
-			idle_cv.notify_all();
-			return true;
-		}
-		else{
-			/* A range currently being processed in another thread has been queued
-			 * for processing again, don't let the task go to sleep.
-			*/
-			
-			return false;
+			fragments.set_range(chunk->offset, chunk->length);
+			++unclaimed;
 		}
-	}
+	});
+	
+	update_sets_empty();
+	outstanding -= unclaimed;
+	
+	chunks.reset(NULL);
+	current_chunks = NULL;
+	
+	free_retired_chunks();
+}
+
+template<typename F> void REHex::RangeProcessor::for_each_chunk(off_t offset, off_t length, const F &func)
+{
+	off_t end = add_clamp_overflow(offset, length);
 	
-	off_t  window_base   = next_dirty_range->offset;
-	size_t window_length = next_dirty_range->length;
+	auto visit = [&](ChunkArray *array)
+	{
+		for(size_t i = array->find_chunk(offset); i < array->size && array->chunks[i].offset < end; ++i)
+		{
+			func(&(array->chunks[i]));
+		}
+	};
 	
-	window_length = std::min<off_t>(window_length, max_window_size);
+	for(auto r = retired_chunks.begin(); r != retired_chunks.end(); ++r)
+	{
+		visit(r->get());
+	}
 	
-	pending.clear_range(window_base, window_length);
-	working.set_range(  window_base, window_length);
+	if(chunks)
+	{
+		visit(chunks.get());
+	}
+}
+
+REHex::RangeProcessor::Chunk *REHex::RangeProcessor::claim_chunk(ChunkArray *array)
+{
+	while(true)
+	{
+		size_t idx = array->next.fetch_add(1);
+		if(idx >= array->size)
+		{
+			return NULL;
+		}
+		
+		int expect = CHUNK_PENDING;
+		if(array->chunks[idx].state.compare_exchange_strong(expect, CHUNK_WORKING))
+		{
+			return &(array->chunks[idx]);
+		}
+		
+		/* Chunk was removed from the queue, skip it. */
+	}
+}
+
+void REHex::RangeProcessor::finish_chunk(Chunk *chunk)
+{
+	off_t chunk_end = chunk->offset + chunk->length;
 	
-	#ifndef NDEBUG
-	in_work_func = true;
-	#endif
+	int prev_state = chunk->state.exchange(CHUNK_DONE);
 	
-	pl.unlock();
-	work_func(window_base, window_length);
-	pl.lock();
+	if(prev_state == CHUNK_REQUEUED || work_progress < chunk_end)
+	{
+		/* Some of the chunk needs processing again, put it into the fragments set to be
+		 * built into a new chunk array.
+		*/
+		
+		std::lock_guard<std::mutex> pl(pause_lock);
+		
+		if(prev_state == CHUNK_REQUEUED)
+		{
+			ByteRangeSet chunk_range;
+			chunk_range.set_range(chunk->offset, chunk->length);
+			
+			ByteRangeSet to_fragments = ByteRangeSet::intersection(chunk_range, queued);
+			
+			queued.clear_range(chunk->offset, chunk->length);
+			fragments.set_ranges(to_fragments.begin(), to_fragments.end());
+		}
+		
+		if(work_progress < chunk_end)
+		{
+			off_t resume_base = std::max(work_progress, chunk->offset);
+			fragments.set_range(resume_base, (chunk_end - resume_base));
+		}
+		
+		update_sets_empty();
+		
+		if(outstanding.fetch_sub(1) == 1)
+		{
+			idle_cv.notify_all();
+		}
+	}
+	else if(outstanding.fetch_sub(1) == 1)
+	{
+		/* Take the lock so the notification can't slip in between wait_for_completion()
+		 * checking the count and going to sleep.
+		*/
+		
+		std::lock_guard<std::mutex> pl(pause_lock);
+		idle_cv.notify_all();
+	}
+}
+
+bool REHex::RangeProcessor::task_function()
+{
+	++active_workers;
 	
-	#ifndef NDEBUG
-	in_work_func = false;
-	#endif
+	auto slice_end = std::chrono::steady_clock::now() + WORKER_SLICE;
+	bool idle = false;
 	
-	mark_work_done(window_base, window_length);
+	while(!cancelling.load())
+	{
+		ChunkArray *array = current_chunks.load();
+		
+		Chunk *chunk = array != NULL
+			? claim_chunk(array)
+			: NULL;
+		
+		if(chunk == NULL)
+		{
+			/* Every chunk in the array has been claimed, build a new one from any ranges
+			 * in the fragments set.
+			*/
+			
+			std::lock_guard<std::mutex> pl(pause_lock);
+			
+			if(current_chunks.load() == array)
+			{
+				refill_chunks();
+			}
+			
+			if(current_chunks.load() != array)
+			{
+				continue;
+			}
+			
+			/* Nothing left to do. If a range currently being processed in another thread
+			 * has been queued for processing again, don't let the task go to sleep.
+			*/
+			
+			idle = queued.empty();
+			break;
+		}
+		
+		#ifndef NDEBUG
+		in_work_func = true;
+		#endif
+		
+		work_progress = chunk->offset + chunk->length;
+		work_func(chunk->offset, chunk->length);
+		
+		#ifndef NDEBUG
+		in_work_func = false;
+		#endif
+		
+		finish_chunk(chunk);
+		
+		if(std::chrono::steady_clock::now() >= slice_end)
+		{
+			break;
+		}
+	}
 	
-	idle_cv.notify_all();
+	if(--active_workers == 0 && have_retired_chunks.load())
+	{
+		std::lock_guard<std::mutex> pl(pause_lock);
+		free_retired_chunks();
+	}
 	
-	return pending.empty() && queued.empty();
+	return idle;
 }
 
 void REHex::RangeProcessor::start_threads()
 {
-	ByteRangeSet merged;
-	merged.set_ranges(queued.begin(),  queued.end());
-	merged.set_ranges(pending.begin(), pending.end());
-	merged.set_ranges(working.begin(), working.end());
-	
-	off_t working_total = merged.total_bytes();
+	/* Estimate how many windows are waiting to be processed. */
+	size_t windows = outstanding.load() + (fragments.total_bytes() / max_window_size);
 	
-	if(working_total > 0)
+	if(windows > 0)
 	{
 		#if 0
 		if(dirty_total >= (off_t)(UI_THREAD_THRESH))
@@ -219,16 +563,7 @@ void REHex::RangeProcessor::start_threads()
 			*/
 			
 			unsigned int max_threads  = calc_max_threads();
-			unsigned int want_threads = working_total / max_window_size;
-			
-			if(want_threads == 0)
-			{
-				want_threads = 1;
-			}
-			else if(want_threads > max_threads)
-			{
-				want_threads = max_threads;
-			}
+			unsigned int want_threads = std::min<size_t>(windows, max_threads);
 			
 			if(task)
 			{
@@ -237,7 +572,7 @@ void REHex::RangeProcessor::start_threads()
 			}
 			else if(!task_paused)
 			{
-				task = wxGetApp().thread_pool->queue_task([this]() { return task_function(); }, want_threads);
+				task = wxGetApp().thread_pool->queue_task([this]() { return task_function(); }, want_threads, priority);
 			}
 		#if 0
 		}
@@ -258,6 +593,8 @@ void REHex::RangeProcessor::stop_threads()
 {
 	if(task)
 	{
+		cancelling = true;
+		
 		task.finish();
 		task.join();
 	}
@@ -269,7 +606,9 @@ void REHex::RangeProcessor::pause_threads()
 	
 	if(task && !task_paused)
 	{
+		cancelling = true;
 		task.pause();
+		cancelling = false;
 	}
 	
 	task_paused = true;
@@ -304,7 +643,7 @@ bool REHex::RangeProcessor::paused() const
 void REHex::RangeProcessor::wait_for_completion()
 {
 	std::unique_lock<std::mutex> pl(pause_lock);
-	idle_cv.wait(pl, [&]() { return queued.empty() && pending.empty() && working.empty(); });
+	idle_cv.wait(pl, [&]() { return outstanding.load() == 0; });
 }
 
 void REHex::RangeProcessor::set_max_threads(unsigned int max_threads)
@@ -312,6 +651,29 @@ void REHex::RangeProcessor::set_max_threads(unsigned int max_threads)
 	this->max_threads = max_threads;
 }
 
+void REHex::RangeProcessor::set_priority(ThreadPool::TaskPriority priority)
+{
+	assert(!in_work_func);
+	
+	this->priority = priority;
+	
+	if(task)
+	{
+		task.change_priority(priority);
+	}
+}
+
+bool REHex::RangeProcessor::cancel_requested() const
+{
+	return cancelling.load();
+}
+
+void REHex::RangeProcessor::report_progress(off_t processed_end)
+{
+	assert(in_work_func);
+	work_progress = processed_end;
+}
+
 unsigned int REHex::RangeProcessor::calc_max_threads() const
 {
 	if(max_threads > 0)
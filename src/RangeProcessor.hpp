@@ -22,9 +22,11 @@
 #include <condition_variable>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <stddef.h>
 #include <thread>
+#include <vector>
 
 #include "ByteRangeSet.hpp"
 #include "ThreadPool.hpp"
@@ -36,6 +38,11 @@ namespace REHex
 	 *
 	 * This class breaks up one or more ranges of bytes to be processed into smaller blocks
 	 * and processes them using a callback function on worker threads.
+	 *
+	 * Queued ranges are collected in a set of fragments which the workers periodically
+	 * build into an array of windows. Workers claim windows from the array using an atomic
+	 * cursor, so the lock is only taken when the array runs out or when a window which is
+	 * being processed gets queued again.
 	*/
 	class RangeProcessor
 	{
@@ -153,28 +160,141 @@ namespace REHex
 			
 			void set_max_threads(unsigned int max_threads);
 			
+			/**
+			 * @brief Set the scheduling priority of the worker threads.
+			 *
+			 * Tools should use this to lower the priority of their background work
+			 * when not visible, so the worker threads are given over to the tools
+			 * which the user is looking at.
+			*/
+			void set_priority(ThreadPool::TaskPriority priority);
+			
+			/**
+			 * @brief Check if the work function should stop processing early.
+			 *
+			 * This method may be polled from within the work callback function during
+			 * processing of large blocks. If it returns true, the RangeProcessor is
+			 * being paused or destroyed and the work function should return as soon
+			 * as possible.
+			 *
+			 * A work function which returns early must call report_progress() first,
+			 * so the unprocessed remainder of its block is returned to the queue.
+			*/
+			REHEX_NODISCARD bool cancel_requested() const;
+			
+			/**
+			 * @brief Report how much of the current block has been processed.
+			 *
+			 * May be called from within the work callback function to indicate that
+			 * all data in the block before processed_end is finished. When the work
+			 * function returns, any data in the block from processed_end onwards is
+			 * returned to the queue and will be processed later.
+			 *
+			 * Blocks whose work function returns without reporting progress are
+			 * assumed to have been processed in full.
+			*/
+			void report_progress(off_t processed_end);
+			
 		private:
+			/**
+			 * @brief Processing state of a Chunk.
+			*/
+			enum ChunkState
+			{
+				CHUNK_PENDING,    /**< Waiting to be claimed by a worker. */
+				CHUNK_WORKING,    /**< Being processed by a worker. */
+				CHUNK_REQUEUED,   /**< Being processed, and some of it has been queued again. */
+				CHUNK_DONE,       /**< Finished processing. */
+				CHUNK_CANCELLED,  /**< Removed from the queue before being claimed. */
+			};
+			
+			/**
+			 * @brief A single window of data to be processed.
+			*/
+			struct Chunk
+			{
+				off_t offset;
+				off_t length;
+				
+				std::atomic<int> state;
+			};
+			
+			/**
+			 * @brief An array of windows which worker threads claim in order.
+			 *
+			 * Workers claim the next Chunk by incrementing the cursor and then moving
+			 * the Chunk from CHUNK_PENDING to CHUNK_WORKING, so taking a window and
+			 * marking it as done doesn't need to take any locks in the common case.
+			 *
+			 * Chunks are sorted by offset and never overlap. Once built, only the
+			 * cursor and the chunk states change.
+			*/
+			struct ChunkArray
+			{
+				std::unique_ptr<Chunk[]> chunks;
+				size_t size;
+				
+				std::atomic<size_t> next;
+				
+				ChunkArray(size_t size);
+				
+				bool exhausted() const;
+				
+				/**
+				 * @brief Find the first Chunk which ends after the given offset.
+				*/
+				size_t find_chunk(off_t offset) const;
+			};
+			
 			const std::function<void(off_t, off_t)> work_func;
 			const size_t max_window_size;
 			unsigned int max_threads;
+			ThreadPool::TaskPriority priority;
 			
 			ThreadPool::TaskHandle task;
 			bool task_paused;
 			
+			std::atomic<bool> cancelling;
+			
+			std::atomic<ChunkArray*> current_chunks;   /**< Chunks currently being handed out to workers. */
+			std::atomic<unsigned int> active_workers;  /**< Number of workers currently in task_function(). */
+			
+			/**
+			 * @brief Number of outstanding units of work.
+			 *
+			 * This is the number of chunks which are pending or being processed, plus
+			 * one if there are any ranges in the fragments or queued sets. The queue
+			 * is empty when this reaches zero.
+			*/
+			std::atomic<size_t> outstanding;
+			
+			std::atomic<bool> have_retired_chunks;
+			
 			mutable std::mutex pause_lock;      /**< Mutex protecting access to this block of members: */
-			std::condition_variable paused_cv;  /**< Notifies pause_threads() that a thread has paused. */
-			std::condition_variable resume_cv;  /**< Notifies paused threads that they should resume. */
 			std::condition_variable idle_cv;    /**< Notifies wait_for_completion() that a thread has gone idle. */
+			ByteRangeSet fragments;             /**< Ranges waiting to be built into chunks. */
 			ByteRangeSet queued;                /**< Ranges which are queued, but already being worked. */
-			ByteRangeSet pending;               /**< Ranges waiting to be processed. */
-			ByteRangeSet working;               /**< Ranges currently being processed. */
+			bool sets_empty;                    /**< fragments and queued are both empty. */
+			
+			std::unique_ptr<ChunkArray> chunks;                         /**< Owner of current_chunks. */
+			std::vector< std::unique_ptr<ChunkArray> > retired_chunks;  /**< Replaced arrays which workers may still be using. */
 			
 			#ifndef NDEBUG
 			static thread_local bool in_work_func;
 			#endif
 			
+			static thread_local off_t work_progress;  /**< End of processed data in the current block. */
+			
 			void queue_range_locked(off_t offset, off_t length);
-			void mark_work_done(off_t offset, off_t length);
+			void update_sets_empty();
+			void refill_chunks();
+			void free_retired_chunks();
+			void flatten_chunks();
+			
+			template<typename F> void for_each_chunk(off_t offset, off_t length, const F &func);
+			
+			Chunk *claim_chunk(ChunkArray *array);
+			void finish_chunk(Chunk *chunk);
 			
 			bool task_function();
 			void start_threads();
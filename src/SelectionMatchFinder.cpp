@@ -0,0 +1,331 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include "profile.hpp"
+#include "SelectionMatchFinder.hpp"
+
+static const size_t WINDOW_SIZE = 2 * 1024 * 1024; /* 2MiB */
+
+REHex::SelectionMatchFinder::SelectionMatchFinder(const SharedDocumentPointer &document):
+	document(document),
+	truncated(false),
+	generation(0),
+	processor([this](off_t window_base, off_t window_length) { work_func(window_base, window_length); }, WINDOW_SIZE)
+{
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::SelectionMatchFinder::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::SelectionMatchFinder::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::SelectionMatchFinder::OnDataOverwrite, this);
+	
+	this->document.auto_cleanup_bind(DATA_ERASING,              &REHex::SelectionMatchFinder::OnDataModifying,        this);
+	this->document.auto_cleanup_bind(DATA_ERASE_ABORTED,        &REHex::SelectionMatchFinder::OnDataModifyAborted,    this);
+	this->document.auto_cleanup_bind(DATA_INSERTING,            &REHex::SelectionMatchFinder::OnDataModifying,        this);
+	this->document.auto_cleanup_bind(DATA_INSERT_ABORTED,       &REHex::SelectionMatchFinder::OnDataModifyAborted,    this);
+}
+
+REHex::SelectionMatchFinder::~SelectionMatchFinder()
+{
+	processor.pause_threads();
+}
+
+void REHex::SelectionMatchFinder::set_needle(const std::vector<unsigned char> &needle)
+{
+	if(needle == this->needle)
+	{
+		return;
+	}
+	
+	processor.pause_threads();
+	processor.clear_queue();
+	
+	{
+		std::lock_guard<std::mutex> sl(starts_lock);
+		starts.clear_all();
+	}
+	
+	this->needle = needle;
+	truncated = false;
+	++generation;
+	
+	if(!needle.empty())
+	{
+		processor.queue_range(0, document->buffer_length());
+	}
+	
+	processor.resume_threads();
+}
+
+const std::vector<unsigned char> &REHex::SelectionMatchFinder::get_needle() const
+{
+	return needle;
+}
+
+bool REHex::SelectionMatchFinder::processing() const
+{
+	return !(processor.queue_empty()) && !truncated;
+}
+
+bool REHex::SelectionMatchFinder::is_truncated() const
+{
+	return truncated;
+}
+
+bool REHex::SelectionMatchFinder::complete_in(off_t offset, off_t length) const
+{
+	if(truncated)
+	{
+		return false;
+	}
+	
+	if(needle.empty() || processor.queue_empty())
+	{
+		return true;
+	}
+	
+	off_t pre = std::min<off_t>((needle.size() - 1), offset);
+	
+	ByteRangeSet queue = processor.get_queue();
+	return !(queue.isset_any((offset - pre), (length + pre)));
+}
+
+REHex::ByteRangeSet REHex::SelectionMatchFinder::get_matches_in(off_t offset, off_t length) const
+{
+	ByteRangeSet matches;
+	
+	if(needle.empty() || length <= 0)
+	{
+		return matches;
+	}
+	
+	off_t pre = std::min<off_t>((needle.size() - 1), offset);
+	off_t end = offset + length;
+	
+	std::lock_guard<std::mutex> sl(starts_lock);
+	
+	for(auto i = starts.find_first_in((offset - pre), (length + pre)); i != starts.end() && i->offset < end; ++i)
+	{
+		/* A run of starts at consecutive offsets covers everything from the first
+		 * start to the end of a match at the last one.
+		*/
+		matches.set_range(i->offset, (i->length + needle.size() - 1));
+	}
+	
+	return matches;
+}
+
+bool REHex::SelectionMatchFinder::match_in(off_t offset, off_t length) const
+{
+	if(needle.empty() || length <= 0)
+	{
+		return false;
+	}
+	
+	off_t pre = std::min<off_t>((needle.size() - 1), offset);
+	
+	std::lock_guard<std::mutex> sl(starts_lock);
+	return starts.isset_any((offset - pre), (length + pre));
+}
+
+unsigned int REHex::SelectionMatchFinder::get_generation() const
+{
+	return generation;
+}
+
+void REHex::SelectionMatchFinder::wait_for_completion()
+{
+	processor.wait_for_completion();
+}
+
+void REHex::SelectionMatchFinder::work_func(off_t window_base, off_t window_length)
+{
+	PROFILE_BLOCK("REHex::SelectionMatchFinder::work_func");
+	
+	if(truncated)
+	{
+		/* Skip through the rest of the queue. */
+		return;
+	}
+	
+	assert(!needle.empty());
+	
+	/* Extend the end of the window so we can match sequences which start within it. */
+	
+	std::vector<unsigned char> data;
+	try {
+		data = document->read_data(window_base, (window_length + needle.size() - 1));
+	}
+	catch(const std::exception&)
+	{
+		return;
+	}
+	
+	if(data.size() < needle.size())
+	{
+		std::lock_guard<std::mutex> sl(starts_lock);
+		starts.clear_range(window_base, window_length);
+		
+		return;
+	}
+	
+	size_t search_end = std::min<size_t>(window_length, (data.size() - needle.size() + 1));
+	
+	std::vector<ByteRangeSet::Range> found;
+	
+	for(size_t i = 0; i < search_end && !processor.cancel_requested();)
+	{
+		const unsigned char *candidate = (const unsigned char*)(memchr((data.data() + i), needle[0], (search_end - i)));
+		if(candidate == NULL)
+		{
+			break;
+		}
+		
+		i = candidate - data.data();
+		
+		if(memcmp(candidate, needle.data(), needle.size()) == 0)
+		{
+			off_t match_off = window_base + i;
+			
+			if(!found.empty() && (found.back().offset + found.back().length) == match_off)
+			{
+				++(found.back().length);
+			}
+			else{
+				found.emplace_back(match_off, 1);
+			}
+		}
+		
+		++i;
+	}
+	
+	if(processor.cancel_requested())
+	{
+		/* This block will be searched again when we are resumed. */
+		return;
+	}
+	
+	std::lock_guard<std::mutex> sl(starts_lock);
+	
+	/* Replace anything we had for this window, in case the data changed while we were
+	 * reading it and the window was queued again behind us.
+	*/
+	starts.clear_range(window_base, window_length);
+	starts.set_ranges(found.begin(), found.end());
+	
+	if(starts.size() > MAX_MATCH_RANGES)
+	{
+		starts.clear_all();
+		truncated = true;
+	}
+	
+	++generation;
+}
+
+void REHex::SelectionMatchFinder::research_range(off_t offset, off_t length)
+{
+	if(needle.empty() || truncated)
+	{
+		return;
+	}
+	
+	off_t pre = std::min<off_t>((needle.size() - 1), offset);
+	offset -= pre;
+	length += pre;
+	
+	if(length <= 0)
+	{
+		return;
+	}
+	
+	{
+		std::lock_guard<std::mutex> sl(starts_lock);
+		starts.clear_range(offset, length);
+	}
+	
+	++generation;
+	
+	processor.queue_range(offset, length);
+}
+
+void REHex::SelectionMatchFinder::OnDataModifying(OffsetLengthEvent &event)
+{
+	processor.pause_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SelectionMatchFinder::OnDataModifyAborted(OffsetLengthEvent &event)
+{
+	processor.resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SelectionMatchFinder::OnDataErase(OffsetLengthEvent &event)
+{
+	assert(processor.paused());
+	
+	{
+		std::lock_guard<std::mutex> sl(starts_lock);
+		starts.data_erased(event.offset, event.length);
+	}
+	
+	processor.data_erased(event.offset, event.length);
+	
+	/* Matches starting after the erased range are still valid, only those which
+	 * spanned the start of it need to be searched for again.
+	*/
+	research_range(event.offset, 0);
+	
+	processor.resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SelectionMatchFinder::OnDataInsert(OffsetLengthEvent &event)
+{
+	assert(processor.paused());
+	
+	{
+		std::lock_guard<std::mutex> sl(starts_lock);
+		starts.data_inserted(event.offset, event.length);
+	}
+	
+	processor.data_inserted(event.offset, event.length);
+	
+	research_range(event.offset, event.length);
+	
+	processor.resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SelectionMatchFinder::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	research_range(event.offset, event.length);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
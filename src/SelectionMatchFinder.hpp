@@ -0,0 +1,157 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_SELECTIONMATCHFINDER_HPP
+#define REHEX_SELECTIONMATCHFINDER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "ByteRangeSet.hpp"
+#include "document.hpp"
+#include "Events.hpp"
+#include "RangeProcessor.hpp"
+#include "SharedDocumentPointer.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Finds every occurrence of a byte sequence in a Document in the background.
+	 *
+	 * This is used by DocumentCtrl to highlight data which matches the current selection.
+	 * The whole document is searched on worker threads and the results are kept up to
+	 * date as the document is modified, only the data around any changes is searched
+	 * again.
+	 *
+	 * The results are retained until a different byte sequence is set, so moving the
+	 * selection between copies of the same data doesn't restart the search.
+	*/
+	class SelectionMatchFinder
+	{
+		public:
+			/**
+			 * @brief Maximum number of distinct runs of matches to record.
+			 *
+			 * Searching for something very common (like a single byte) in a large
+			 * file could otherwise consume a great deal of memory. The search stops
+			 * once this many runs have been found and is_truncated() will return true.
+			*/
+			static constexpr size_t MAX_MATCH_RANGES = 1000000;
+			
+			SelectionMatchFinder(const SharedDocumentPointer &document);
+			~SelectionMatchFinder();
+			
+			SelectionMatchFinder(const SelectionMatchFinder&) = delete;
+			SelectionMatchFinder &operator=(const SelectionMatchFinder&) = delete;
+			
+			/**
+			 * @brief Set the byte sequence to search for.
+			 *
+			 * Any results for the previous sequence are discarded and a new search of
+			 * the whole document is started. Does nothing if the sequence is unchanged.
+			 * An empty sequence stops any search in progress.
+			*/
+			void set_needle(const std::vector<unsigned char> &needle);
+			
+			/**
+			 * @brief Get the byte sequence being searched for.
+			*/
+			const std::vector<unsigned char> &get_needle() const;
+			
+			/**
+			 * @brief Check if the search is still running.
+			*/
+			REHEX_NODISCARD bool processing() const;
+			
+			/**
+			 * @brief Check if the search was abandoned after finding too many matches.
+			*/
+			REHEX_NODISCARD bool is_truncated() const;
+			
+			/**
+			 * @brief Check if the results are complete for a range of the document.
+			 *
+			 * Returns true if every match which would overlap the given range has been
+			 * found, i.e. no part of the range (or the data leading up to it) is still
+			 * waiting to be searched.
+			*/
+			REHEX_NODISCARD bool complete_in(off_t offset, off_t length) const;
+			
+			/**
+			 * @brief Get the bytes covered by matches overlapping a range.
+			 *
+			 * Overlapping or adjacent matches are merged together. The returned ranges
+			 * may extend outside of the requested range.
+			*/
+			ByteRangeSet get_matches_in(off_t offset, off_t length) const;
+			
+			/**
+			 * @brief Check if any match overlaps a range of the document.
+			*/
+			REHEX_NODISCARD bool match_in(off_t offset, off_t length) const;
+			
+			/**
+			 * @brief Get a counter which is incremented whenever the results change.
+			 *
+			 * This can be polled to find out when anything displaying the results
+			 * needs to be redrawn.
+			*/
+			unsigned int get_generation() const;
+			
+			/**
+			 * @brief Wait for the search to finish.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+		
+		private:
+			SharedDocumentPointer document;
+			
+			std::vector<unsigned char> needle;
+			
+			mutable std::mutex starts_lock;
+			ByteRangeSet starts;               /**< Offsets at which a match begins. */
+			
+			std::atomic<bool> truncated;
+			std::atomic<unsigned int> generation;
+			
+			RangeProcessor processor;
+			
+			void work_func(off_t window_base, off_t window_length);
+			
+			/**
+			 * @brief Search the data around a modified range again.
+			 *
+			 * Discards any matches which begin within the given range, or close enough
+			 * before it to overlap it and queues that area to be searched again.
+			*/
+			void research_range(off_t offset, off_t length);
+			
+			void OnDataModifying(OffsetLengthEvent &event);
+			void OnDataModifyAborted(OffsetLengthEvent &event);
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+	};
+}
+
+#endif /* !REHEX_SELECTIONMATCHFINDER_HPP */
@@ -141,6 +141,18 @@ bool REHex::SettingsDialogGeneral::Create(wxWindow *parent)
 	auto_save_state = new wxCheckBox(this, wxID_ANY, "Save editor state and exit and restore at launch");
 	top_sizer->Add(auto_save_state, 0, wxBOTTOM, SettingsDialog::MARGIN);
 	
+	wxBoxSizer *buffer_cache_sizer = new wxBoxSizer(wxHORIZONTAL);
+	top_sizer->Add(buffer_cache_sizer, 0, wxBOTTOM, SettingsDialog::MARGIN);
+	
+	buffer_cache_sizer->Add(new wxStaticText(this, wxID_ANY, "Unmodified file data cache size:"), 0, wxALIGN_CENTER_VERTICAL);
+	
+	buffer_cache_mb = new wxSpinCtrl(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 1048576);
+	buffer_cache_sizer->Add(buffer_cache_mb, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), SettingsDialog::MARGIN);
+	
+	buffer_cache_mb->SetToolTip("Maximum amount of data read from each open file to keep in memory for quick access.");
+	
+	buffer_cache_sizer->Add(new wxStaticText(this, wxID_ANY, "MiB"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), SettingsDialog::MARGIN);
+	
 	load(wxGetApp().settings);
 	
 	SetSizerAndFit(top_sizer);
@@ -213,6 +225,7 @@ void REHex::SettingsDialogGeneral::save()
 	}
 
 	wxGetApp().settings->set_auto_save_state(auto_save_state->GetValue());
+	wxGetApp().settings->set_buffer_cache_size(AppSettings::buffer_cache_size_from_mb(buffer_cache_mb->GetValue()));
 }
 
 void REHex::SettingsDialogGeneral::reset() {
@@ -307,4 +320,5 @@ void REHex::SettingsDialogGeneral::load(const AppSettings *settings)
 	}
 
 	auto_save_state->SetValue(settings->get_auto_save_state());
+	buffer_cache_mb->SetValue(settings->get_buffer_cache_size() / (1024 * 1024));
 }
@@ -52,6 +52,7 @@ namespace REHex
 			wxCheckBox *dbd_disable_vcm;
 
 			wxCheckBox *auto_save_state;
+			wxSpinCtrl *buffer_cache_mb;
 			
 			void load(const AppSettings *settings);
 			
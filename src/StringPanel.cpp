@@ -200,6 +200,11 @@ wxSize REHex::StringPanel::DoGetBestClientSize() const
 	return wxSize(100, -1);
 }
 
+void REHex::StringPanel::visibility_changed()
+{
+	processor.set_priority(is_visible ? ThreadPool::TaskPriority::NORMAL : ThreadPool::TaskPriority::LOW);
+}
+
 void REHex::StringPanel::update()
 {
 	if (!is_visible)
@@ -309,7 +314,11 @@ off_t REHex::StringPanel::sum_clean_bytes()
 REHex::ByteRangeSet REHex::StringPanel::get_strings()
 {
 	std::lock_guard<std::mutex> sl(strings_lock);
-	return strings;
+	
+	ByteRangeSet copy;
+	copy.set_ranges(strings.begin(), strings.end(), strings.size());
+	
+	return copy;
 }
 
 off_t REHex::StringPanel::get_clean_bytes()
@@ -452,7 +461,9 @@ void REHex::StringPanel::work_func(off_t window_base, off_t window_length)
 	
 	Batch batch = next_batch();
 	
-	for(size_t i = 0; i < data.size();)
+	size_t i = 0;
+	
+	while(i < data.size() && !processor.cancel_requested())
 	{
 		off_t string_base = window_base_adj + i;
 		off_t string_end  = string_base;
@@ -520,6 +531,12 @@ void REHex::StringPanel::work_func(off_t window_base, off_t window_length)
 		}
 	}
 	
+	if(i < data.size())
+	{
+		/* Cancelled part-way through, requeue whatever we didn't get to. */
+		processor.report_progress(window_base_adj + i);
+	}
+	
 	release_batch(std::move(batch));
 }
 
@@ -831,7 +848,7 @@ void REHex::StringPanel::OnItemActivate(wxListEvent &event)
 		return;
 	}
 	
-	const ByteRangeSet::Range &string_range = strings[item_idx];
+	const ChunkedByteRangeSet::Range &string_range = strings[item_idx];
 	
 	document->set_cursor_position(string_range.offset);
 	document_ctrl->set_selection_raw(string_range.offset, (string_range.offset + string_range.length - 1));
@@ -976,7 +993,7 @@ wxString REHex::StringPanel::StringPanelListCtrl::OnGetItemText(long item, long
 		return "???";
 	}
 	
-	const ByteRangeSet::Range &si = parent->strings.get_ranges()[item];
+	const ChunkedByteRangeSet::Range &si = parent->strings.get_ranges()[item];
 	
 	switch(column)
 	{
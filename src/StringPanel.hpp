@@ -109,6 +109,9 @@ namespace REHex {
 			
 			bool search_pending() const;
 			
+		protected:
+			virtual void visibility_changed() override;
+			
 		private:
 			SharedDocumentPointer document;
 			SafeWindowPointer<DocumentCtrl> document_ctrl;
@@ -130,7 +133,7 @@ namespace REHex {
 			wxAnimationCtrl *spinner;
 			
 			std::mutex strings_lock;
-			ByteRangeSet strings;
+			ChunkedByteRangeSet strings;  /**< Strings found in the document, chunked so batches merging into the middle don't shift every later range. */
 			bool update_needed;
 			
 			RangeProcessor processor;
@@ -747,7 +747,7 @@ void REHex::Tab::OnDocumentCtrlChar(wxKeyEvent &event)
 			doc->insert_data(cursor_pos.byte(), &byte, 1, (cursor_pos + BitOffset(0, 4)), Document::CSTATE_GOTO, "change data");
 		}
 		else{
-			std::vector<bool> nibble_bits = {
+			BitVector nibble_bits = {
 				((nibble & 8) != 0),
 				((nibble & 4) != 0),
 				((nibble & 2) != 0),
@@ -1339,7 +1339,7 @@ void REHex::Tab::OnDocumentDataInsert(OffsetLengthEvent &event)
 
 void REHex::Tab::OnDocumentDataOverwrite(OffsetLengthEvent &event)
 {
-	doc_ctrl->Refresh();
+	doc_ctrl->refresh_range(BitOffset(event.offset, 0), BitOffset(event.length, 0));
 	event.Skip();
 }
 
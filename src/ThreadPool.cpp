@@ -75,24 +75,10 @@ REHex::ThreadPool::TaskHandle REHex::ThreadPool::queue_task(const std::function<
 {
 	assert(!in_worker_thread());
 	
-	std::vector<Task*> &queue = task_queues[ (size_t)(priority) ];
-	
 	Task *task = new Task(func, max_concurrency);
-	size_t task_idx;
 	
 	task_queues_mutex.lock();
-	
-	auto null_iter = std::find(queue.begin(), queue.end(), nullptr);
-	if(null_iter != queue.end())
-	{
-		*null_iter = task;
-		task_idx = std::distance(queue.begin(), null_iter);
-	}
-	else{
-		task_idx = queue.size();
-		queue.push_back(task);
-	}
-	
+	size_t task_idx = insert_task(task, priority);
 	task_queues_mutex.unlock();
 	task_queues_cv.notify_all();
 	
@@ -110,6 +96,22 @@ REHex::ThreadPool::TaskHandle REHex::ThreadPool::queue_task(const std::function<
 	}, 1, priority);
 }
 
+size_t REHex::ThreadPool::insert_task(Task *task, TaskPriority priority)
+{
+	std::vector<Task*> &queue = task_queues[ (size_t)(priority) ];
+	
+	auto null_iter = std::find(queue.begin(), queue.end(), nullptr);
+	if(null_iter != queue.end())
+	{
+		*null_iter = task;
+		return std::distance(queue.begin(), null_iter);
+	}
+	else{
+		queue.push_back(task);
+		return queue.size() - 1;
+	}
+}
+
 void REHex::ThreadPool::worker_main()
 {
 	PROFILE_SET_THREAD_GROUP(POOL);
@@ -394,3 +396,32 @@ void REHex::ThreadPool::TaskHandle::change_concurrency(int max_concurrency)
 	
 	pool->task_queues_cv.notify_all();
 }
+
+void REHex::ThreadPool::TaskHandle::change_priority(TaskPriority priority)
+{
+	assert(task != NULL);
+	assert(!pool->in_worker_thread());
+	
+	if(priority == this->priority)
+	{
+		return;
+	}
+	
+	pool->task_queues_mutex.lock();
+	
+	assert(pool->task_queues[ (size_t)(this->priority) ][task_idx] == task);
+	pool->task_queues[ (size_t)(this->priority) ][task_idx] = NULL;
+	
+	task_idx = pool->insert_task(task, priority);
+	this->priority = priority;
+	
+	pool->task_queues_mutex.unlock();
+	
+	pool->task_queues_cv.notify_all();
+}
+
+REHex::ThreadPool::TaskPriority REHex::ThreadPool::TaskHandle::get_priority() const
+{
+	assert(task != NULL);
+	return priority;
+}
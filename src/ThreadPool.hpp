@@ -181,6 +181,24 @@ namespace REHex
 					void restart();
 					
 					void change_concurrency(int max_concurrency);
+					
+					/**
+					 * @brief Move the task to a different priority level.
+					 *
+					 * This method may be used to adjust the scheduling of a task
+					 * after it has been queued, for example to deprioritise work
+					 * for a tool which is no longer visible to the user.
+					 *
+					 * Any in-progress calls to the task function will continue,
+					 * the new priority takes effect when workers next look for
+					 * a task to service.
+					*/
+					void change_priority(TaskPriority priority);
+					
+					/**
+					 * @brief Get the current priority level of the task.
+					*/
+					TaskPriority get_priority() const;
 			};
 			
 			friend TaskHandle;
@@ -254,6 +272,15 @@ namespace REHex
 			void worker_main();
 			void clear_threads();
 			
+			/**
+			 * @brief Insert a task into the first free slot of a priority queue.
+			 *
+			 * @return Index of the task within the queue.
+			 *
+			 * The caller must hold an exclusive lock on task_queues_mutex.
+			*/
+			size_t insert_task(Task *task, TaskPriority priority);
+			
 			#ifndef NDEBUG
 			/**
 			 * @brief Check if the caller is running in a worker thread.
@@ -30,13 +30,20 @@ REHex::ToolPanel::~ToolPanel() {}
 
 void REHex::ToolPanel::set_visible(bool visible)
 {
-	is_visible = visible;
+	if(visible != is_visible)
+	{
+		is_visible = visible;
+		visibility_changed();
+	}
+	
 	if (is_visible)
 	{
 		update();
 	}
 }
 
+void REHex::ToolPanel::visibility_changed() {}
+
 std::map<std::string, const REHex::ToolPanelRegistration*> *REHex::ToolPanelRegistry::registrations = NULL;
 const std::map<std::string, const REHex::ToolPanelRegistration*> REHex::ToolPanelRegistry::no_registrations;
 
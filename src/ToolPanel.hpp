@@ -110,6 +110,15 @@ namespace REHex {
 			 * updates when the ToolPanel becomes visible.
 			*/
 			bool is_visible;
+			
+			/**
+			 * @brief Called when the ToolPanel becomes (in)visible.
+			 *
+			 * Tools which do work in the background should override this to adjust
+			 * the priority of that work, so the worker threads are given over to
+			 * the tools the user is looking at.
+			*/
+			virtual void visibility_changed();
 	};
 	
 	class ToolPanelRegistration;
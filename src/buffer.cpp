@@ -27,6 +27,7 @@
 #include <list>
 #include <portable_endian.h>
 #include <stdexcept>
+#include <stdint.h>
 #include <stdio.h>
 #include <string>
 #include <string.h>
@@ -40,9 +41,18 @@
 #endif
 #include <vector>
 #include <algorithm>
+#include <wx/filefn.h>
+
+/* copy_file_range() lets the kernel copy data between (or within) files without passing it
+ * through userspace, and can create reflinks on filesystems which support them.
+*/
+#if defined(__linux__) && defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define REHEX_HAVE_COPY_FILE_RANGE
+#endif
 
 #include "App.hpp"
 #include "buffer.hpp"
+#include "ByteRangeSet.hpp"
 #include "FileReader.hpp"
 #include "FileWriter.hpp"
 #include "MacFileName.hpp"
@@ -52,6 +62,26 @@
 wxDEFINE_EVENT(REHex::BACKING_FILE_DELETED, wxCommandEvent);
 wxDEFINE_EVENT(REHex::BACKING_FILE_MODIFIED, wxCommandEvent);
 
+/* Save journal format, see Buffer::_journal_name(). */
+static const char JOURNAL_MAGIC[] = "REHEXJNL";
+static const size_t JOURNAL_MAGIC_SIZE = 8;
+static const off_t JOURNAL_HEADER_SIZE = JOURNAL_MAGIC_SIZE + sizeof(uint64_t);
+static const off_t JOURNAL_RECORD_SIZE = 7 * sizeof(uint64_t);
+
+/* 64-bit FNV-1a, used to detect journal records which weren't completely written. */
+static const uint64_t JOURNAL_CHECKSUM_INIT = 0xCBF29CE484222325ULL;
+
+static uint64_t journal_checksum(uint64_t hash, const unsigned char *data, size_t length)
+{
+	for(size_t i = 0; i < length; ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+	
+	return hash;
+}
+
 REHex::Buffer::Block *REHex::Buffer::_block_by_virt_offset(off_t virt_offset)
 {
 	if(virt_offset >= _length())
@@ -99,6 +129,8 @@ REHex::Buffer::BlockPtr REHex::Buffer::load_block(Block *block)
 	int my_refcount = ++(block->refcount);
 	assert(my_refcount > 0);
 	
+	bool sequential = false;
+	
 	if(my_refcount > 1)
 	{
 		/* The first thread which attains the lock on a Block is responsible for ensuring
@@ -116,15 +148,18 @@ REHex::Buffer::BlockPtr REHex::Buffer::load_block(Block *block)
 	else{
 		if(block->state == Block::CLEAN)
 		{
-			auto lab_it = std::find(last_accessed_blocks.begin(), last_accessed_blocks.end(), block);
-			assert(lab_it != last_accessed_blocks.end());
+			assert(block->lab_linked);
+			_last_access_remove(block);
 			
-			if(lab_it != last_accessed_blocks.end())
-			{
-				last_accessed_blocks.erase(lab_it);
-			}
+			PROFILE_COUNT("REHex::Buffer clean cache hits", 1);
+		}
+		else if(block->state == Block::UNLOADED)
+		{
+			PROFILE_COUNT("REHex::Buffer clean cache misses", 1);
 		}
 		
+		sequential = _read_stream_advance(block - blocks.data());
+		
 		lab_guard.unlock();
 	}
 	
@@ -160,6 +195,11 @@ REHex::Buffer::BlockPtr REHex::Buffer::load_block(Block *block)
 					throw std::runtime_error(std::string("Read error: ") + strerror(errno));
 				}
 			}
+			
+			if(sequential)
+			{
+				_prefetch_blocks(fh, block);
+			}
 		}
 		
 		block->state = Block::CLEAN;
@@ -174,21 +214,8 @@ void REHex::Buffer::release_block(Block *block)
 	
 	if(--(block->refcount) == 0 && block->state == Block::CLEAN)
 	{
-		last_accessed_blocks.push_back(block);
-		
-		if(last_accessed_blocks.size() > MAX_CLEAN_BLOCKS)
-		{
-			Block *unload_me = last_accessed_blocks.front();
-			
-			assert(unload_me->refcount == 0);
-			
-			unload_me->state = Block::UNLOADED;
-			
-			unload_me->data.clear();
-			unload_me->data.shrink_to_fit();
-			
-			last_accessed_blocks.erase(last_accessed_blocks.begin());
-		}
+		_last_access_push(block);
+		_last_access_trim();
 	}
 }
 
@@ -301,10 +328,17 @@ bool REHex::Buffer::_same_file(FILE *file1, const std::string &name1, FILE *file
 }
 
 REHex::Buffer::Buffer(off_t block_size):
+	saving_thread(std::thread::id()),
 	_file_deleted(false),
 	_file_modified(false),
+	lab_head(NULL),
+	lab_tail(NULL),
+	last_accessed_bytes(0),
+	clean_cache_limit(DEFAULT_CLEAN_CACHE_LIMIT),
 	block_size(block_size)
 {
+	_read_streams_reset();
+	
 	blocks.push_back(Block(0,0));
 	blocks.back().state = Block::DIRTY;
 	
@@ -313,12 +347,21 @@ REHex::Buffer::Buffer(off_t block_size):
 
 REHex::Buffer::Buffer(const FileName &filename, off_t block_size):
 	filename(filename),
+	saving_thread(std::thread::id()),
 	_file_deleted(false),
 	_file_modified(false),
+	lab_head(NULL),
+	lab_tail(NULL),
+	last_accessed_bytes(0),
+	clean_cache_limit(DEFAULT_CLEAN_CACHE_LIMIT),
 	block_size(block_size)
 {
+	_read_streams_reset();
+	
 	timer.Bind(wxEVT_TIMER, &REHex::Buffer::OnTimerTick, this);
 	
+	_recover_journal(filename.GetFullPath().ToStdString());
+	
 	handles[0].fh = fopen(filename.GetFullPath().c_str(), "rb");
 	if(handles[0].fh == NULL)
 	{
@@ -332,6 +375,12 @@ REHex::Buffer::Buffer(const FileName &filename, off_t block_size):
 		throw std::runtime_error(std::string("Could not open file: Not a regular file"));
 	}
 	
+	/* Read handles are unbuffered - blocks are read in one go so stdio buffering gains us
+	 * nothing, and a stale buffer could return old data after write_inplace() has moved
+	 * data around within the file.
+	*/
+	setbuf(handles[0].fh, NULL);
+	
 	reload();
 }
 
@@ -340,10 +389,28 @@ REHex::Buffer::~Buffer()
 	close_handles();
 }
 
+void REHex::Buffer::set_clean_cache_limit(size_t limit)
+{
+	shared_lock l(general_lock);
+	std::unique_lock<std::mutex> lab_guard(lab_mutex);
+	
+	clean_cache_limit = limit;
+	_last_access_trim();
+}
+
+size_t REHex::Buffer::get_clean_cache_limit()
+{
+	std::unique_lock<std::mutex> lab_guard(lab_mutex);
+	return clean_cache_limit;
+}
+
 void REHex::Buffer::reload()
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
+	_recover_journal(filename.GetFullPath().ToStdString());
+	
 	/* Re-open file (in case file has been replaced) */
 	FILE *inode_fh = fopen(filename.GetFullPath().c_str(), "rb");
 	if(inode_fh == NULL)
@@ -375,6 +442,8 @@ void REHex::Buffer::reload()
 		throw std::runtime_error(std::string("ftello: ") + strerror(err));
 	}
 	
+	setbuf(inode_fh, NULL);
+	
 	close_handles();
 	handles[0].fh = inode_fh;
 	
@@ -391,9 +460,13 @@ void REHex::Buffer::_reinit_blocks(off_t file_length)
 	
 	/* Clear any existing blocks and references. */
 	
-	last_accessed_blocks.clear();
+	lab_head = NULL;
+	lab_tail = NULL;
+	last_accessed_bytes = 0;
 	blocks.clear();
 	
+	_read_streams_reset();
+	
 	/* Populate the blocks list with appropriate offsets and sizes. */
 	
 	for(off_t offset = 0; offset < file_length; offset += block_size)
@@ -407,264 +480,686 @@ void REHex::Buffer::_reinit_blocks(off_t file_length)
 	}
 }
 
-void REHex::Buffer::write_inplace()
+std::unique_lock<std::mutex> REHex::Buffer::_lock_for_write()
+{
+	if(saving_thread == std::this_thread::get_id())
+	{
+		throw std::runtime_error("The file cannot be modified while it is being saved");
+	}
+	
+	return std::unique_lock<std::mutex>(write_lock);
+}
+
+bool REHex::Buffer::write_inplace(const WriteProgressFunc &progress)
 {
-	write_inplace(filename);
+	return write_inplace(filename, progress);
 }
 
-void REHex::Buffer::write_inplace(const FileName &filename)
+bool REHex::Buffer::write_inplace(const FileName &filename, const WriteProgressFunc &progress)
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
+	std::string path = filename.GetFullPath().ToStdString();
+	
+	FILE *wfh = NULL;
+	
+	/* Are we updating the file we originally read data in from? */
+	bool updating_file = false;
+	
 	/* Need to open the file with open() since fopen() can't be told to open
-	 * the file, creating it if it doesn't exist, WITHOUT truncating and letting
-	 * us write at arbitrary positions.
+	 * the file WITHOUT truncating and letting us write at arbitrary positions.
+	 *
+	 * An existing file is always written in place (rather than replaced) so that
+	 * any links to it, its ownership and its permissions are left intact.
 	*/
 	#ifdef _WIN32
-	int fd = open(filename.GetFullPath().c_str(), (O_RDWR | O_CREAT | O_NOCTTY | _O_BINARY), 0666);
+	int fd = open(path.c_str(), (O_RDWR | O_NOCTTY | _O_BINARY));
 	#else
-	int fd = open(filename.GetFullPath().c_str(), (O_RDWR | O_CREAT | O_NOCTTY), 0666);
+	int fd = open(path.c_str(), (O_RDWR | O_NOCTTY));
 	#endif
-	if(fd == -1)
+	if(fd == -1 && errno != ENOENT)
 	{
 		throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
 	}
 	
-	struct stat st;
-	if(fstat(fd, &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+	/* Whether we created the destination file, and should remove it if cancelled. */
+	bool created_file = (fd == -1);
+	
+	if(created_file)
 	{
-		close(fd);
-		throw std::runtime_error(std::string("Could not open file: Not a regular file"));
+		#ifdef _WIN32
+		fd = open(path.c_str(), (O_RDWR | O_CREAT | O_EXCL | O_NOCTTY | _O_BINARY), 0666);
+		#else
+		fd = open(path.c_str(), (O_RDWR | O_CREAT | O_EXCL | O_NOCTTY), 0666);
+		#endif
+		if(fd == -1)
+		{
+			throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
+		}
+	}
+	else{
+		struct stat st;
+		if(fstat(fd, &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+		{
+			close(fd);
+			throw std::runtime_error(std::string("Could not open file: Not a regular file"));
+		}
 	}
 	
-	FILE *wfh = fdopen(fd, "r+b");
+	wfh = fdopen(fd, "r+b");
 	if(wfh == NULL)
 	{
 		close(fd);
 		throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
 	}
 	
+	if(!created_file)
+	{
+		updating_file = (handles[0].fh != NULL && _same_file(handles[0].fh, this->filename.GetFullPath().ToStdString(), wfh, path));
+	}
+	
 	/* Disable write buffering */
 	setbuf(wfh, NULL);
 	
 	off_t out_length = _length();
 	
-	/* Reserve space in the output file if it isn't already at least as large
-	 * as the file we want to write out.
+	if(fseeko(wfh, 0, SEEK_END) != 0)
+	{
+		int err = errno;
+		fclose(wfh);
+		throw std::runtime_error(std::string("fseeko: ") + strerror(err));
+	}
+	
+	off_t orig_length = ftello(wfh);
+	if(orig_length == -1)
+	{
+		int err = errno;
+		fclose(wfh);
+		throw std::runtime_error(std::string("ftello: ") + strerror(err));
+	}
+	
+	/* When writing over an existing file, the original data in any part of the file we overwrite
+	 * is saved to a journal first, so we can put it back if the save doesn't complete.
 	*/
 	
+	std::string journal_path;
+	FILE *jfh = NULL;
+	off_t journal_end = 0;
+	std::vector<JournalRecord> journal;
+	
+	/* Ranges of the original file which have been (or are being) moved elsewhere, and so can
+	 * be restored by moving them back rather than from data saved in the journal.
+	*/
+	ByteRangeSet moved_out;
+	
+	std::vector<off_t> orig_real_offsets;
+	
+	if(!created_file)
 	{
-		if(fseeko(wfh, 0, SEEK_END) != 0)
-		{
-			int err = errno;
-			fclose(wfh);
-			throw std::runtime_error(std::string("fseeko: ") + strerror(err));
-		}
-		
-		off_t wfh_initial_size = ftello(wfh);
-		if(wfh_initial_size == -1)
-		{
-			int err = errno;
-			fclose(wfh);
-			throw std::runtime_error(std::string("ftello: ") + strerror(err));
-		}
+		journal_path = _journal_name(path);
 		
-		if(wfh_initial_size < out_length)
+		jfh = fopen(journal_path.c_str(), "w+b");
+		if(jfh != NULL)
 		{
-			/* Windows (or GCC/MinGW) provides an ftruncate(), but for some reason it
-			 * fails with "File too large" if you try expanding a file with it.
-			*/
+			setbuf(jfh, NULL);
 			
-			#ifdef _WIN32
-			if(_chsize_s(fileno(wfh), out_length) != 0)
-			#else
-			if(ftruncate(fileno(wfh), out_length) == -1)
-			#endif
+			uint64_t length_le = htole64(orig_length);
+			
+			try {
+				if(fwrite(JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE, 1, jfh) == 0 || fwrite(&length_le, sizeof(length_le), 1, jfh) == 0)
+				{
+					throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+				}
+				
+				_sync_file(jfh);
+				
+				journal_end = JOURNAL_HEADER_SIZE;
+			}
+			catch(const std::exception &e)
 			{
-				int err = errno;
-				fclose(wfh);
-				throw std::runtime_error(std::string("Could not expand file: ") + strerror(err));
+				wxGetApp().printf_error("Could not write save journal %s: %s\n", journal_path.c_str(), e.what());
+				
+				fclose(jfh);
+				jfh = NULL;
+				
+				wxRemoveFile(journal_path);
 			}
 		}
+		else{
+			wxGetApp().printf_error("Could not create save journal %s: %s\n", journal_path.c_str(), strerror(errno));
+		}
 	}
 	
-	/* Are we updating the file we originally read data in from? */
-	bool updating_file = (handles[0].fh != NULL && _same_file(handles[0].fh, this->filename.GetFullPath().ToStdString(), wfh, filename.GetFullPath().ToStdString()));
-	
-	std::list<Block*> pending;
-	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	if(updating_file && jfh != NULL)
 	{
-		pending.push_back(&(*b));
+		orig_real_offsets.reserve(blocks.size());
+		
+		for(auto b = blocks.begin(); b != blocks.end(); ++b)
+		{
+			orig_real_offsets.push_back(b->real_offset);
+		}
 	}
 	
-	for(auto b = pending.begin(); b != pending.end();)
+	std::vector<unsigned char> copy_buf;
+	
+	/* Cleans up after a cancelled or failed write, leaving the destination as it was. */
+	auto abort_write = [&]()
 	{
-		if(updating_file && ((*b)->virt_offset == (*b)->real_offset && (*b)->state != Block::DIRTY))
+		if(jfh != NULL)
 		{
-			/* We're updating the file we originally read data in from and this block
-			 * hasn't changed (in contents or offset), don't need to do anything.
+			/* If the original data can't be restored, the journal is left behind to
+			 * be recovered from the next time the file is opened.
 			*/
-			b = pending.erase(b);
-			continue;
+			
+			try {
+				_journal_rollback(jfh, wfh, journal, orig_length, copy_buf);
+				
+				fclose(jfh);
+				wxRemoveFile(journal_path);
+			}
+			catch(const std::exception &e)
+			{
+				wxGetApp().printf_error("Could not roll back changes to %s: %s\n", path.c_str(), e.what());
+				fclose(jfh);
+			}
+			
+			for(size_t i = 0; i < orig_real_offsets.size(); ++i)
+			{
+				blocks[i].real_offset = orig_real_offsets[i];
+			}
 		}
 		
-		auto next = std::next(b);
+		fclose(wfh);
+		
+		if(created_file)
+		{
+			wxRemoveFile(path);
+		}
 		
-		if(next != pending.end() && (*b)->virt_offset + (*b)->virt_length > (*next)->real_offset)
+		if(updating_file)
 		{
-			/* Can't flush this block yet; we'd write into the data of the next one.
-			 *
-			 * In order for this to happen, the set of blocks before the next one must
-			 * have grown in length, which means the virt_offset of the next block MUST
-			 * be greater than its real_offset and so it won't be written to the file
-			 * preceeding it, where it could overwrite data still needed to shuffle
-			 * clean blocks to higher offsets.
+			/* Any blocks we've moved without a journal to undo it have had their
+			 * real_offset updated, so the Buffer is still consistent with the file.
 			*/
 			
-			++b;
-			continue;
+			last_mtime = _get_file_mtime(handles[0].fh, this->filename.GetFullPath().ToStdString());
+		}
+	};
+	
+	/* Records the next step of the save in the journal before it starts. Each part of the file is
+	 * only written once during a save, so whatever is there now is the original data.
+	 *
+	 * Only data which couldn't be recovered from elsewhere in the file is saved: parts of the
+	 * destination which haven't been moved out of the way already and, if a range is being moved
+	 * over part of itself, the overlap between the source and destination for as long as it takes
+	 * to move it. This keeps the journal to the data the save is actually destroying rather than
+	 * everything that moves.
+	*/
+	auto journal_step = [&](JournalRecord::Type type, off_t src_offset, off_t dst_offset, off_t length)
+	{
+		if(jfh == NULL)
+		{
+			return;
 		}
 		
-		if((*b)->virt_length > 0)
+		if(!journal.empty())
 		{
-			load_block(*b);
+			/* Make sure the previous step has finished before we write any records after
+			 * it, since they will be taken to mean it did finish.
+			*/
 			
-			if(fseeko(wfh, (*b)->virt_offset, SEEK_SET) != 0)
-			{
-				int err = errno;
-				fclose(wfh);
-				throw std::runtime_error(std::string("fseeko: ") + strerror(err));
-			}
+			_sync_file(wfh);
 			
-			if(fwrite((*b)->data.data(), (*b)->virt_length, 1, wfh) == 0)
-			{
-				if(updating_file)
-				{
-					/* Ensure the block is marked as dirty, since we may have
-					 * partially rewritten it in the underlying file and no
-					 * longer be able to correctly reload it.
-					*/
-					(*b)->state = Block::DIRTY;
-					_last_access_remove(*b);
-				}
-				
-				int err = errno;
-				fclose(wfh);
-				throw std::runtime_error(std::string("Write error: ") + strerror(err));
-			}
+			JournalRecord &prev = journal.back();
 			
-			if(updating_file)
+			if(prev.type == JournalRecord::MOVE && prev.data_length > 0)
 			{
-				/* We've successfuly updated this block in the underlying file.
-				 * Mark it as clean and fix the offsets.
+				/* The previous move has finished, so the overlap saved from it is
+				 * no longer needed and can be overwritten by the next records.
 				*/
 				
-				(*b)->real_offset = (*b)->virt_offset;
-				(*b)->state       = Block::CLEAN;
+				journal_end = prev.data_offset;
+				prev.data_length = 0;
 				
-				last_accessed_blocks.push_back(*b);
+				if(ftruncate(fileno(jfh), journal_end) == -1)
+				{
+					throw std::runtime_error(std::string("Could not truncate journal: ") + strerror(errno));
+				}
 			}
 		}
 		
-		b = pending.erase(b);
+		std::vector<JournalRecord> records;
 		
-		if(b != pending.begin())
+		JournalRecord step;
+		step.type        = type;
+		step.src_offset  = src_offset;
+		step.dst_offset  = dst_offset;
+		step.length      = length;
+		step.data_length = 0;
+		
+		if(type == JournalRecord::MOVE)
 		{
-			/* This isn't the first pending block, so we must've stepped
-			 * forwards to make a hole for one or more previous ones.
-			 * 
-			 * We've made the hole, so start walking backwards and writing
-			 * out the new blocks.
-			*/
+			moved_out.set_range(src_offset, length);
 			
-			--b;
+			off_t overlap_begin = std::max(src_offset, dst_offset);
+			off_t overlap_end   = std::min(src_offset, dst_offset) + length;
+			
+			if(overlap_begin < overlap_end)
+			{
+				step.data_length = overlap_end - overlap_begin;
+			}
 		}
-	}
-	
-	if(ftruncate(fileno(wfh), out_length) == -1)
-	{
-		int err = errno;
-		fclose(wfh);
-		throw std::runtime_error(std::string("Could not truncate file: ") + strerror(err));
-	}
-	
-	close_handles();
-	
-	/* The Buffer is now backed by the new file (which might be the old one). */
-	
-	handles[0].fh = wfh;
-	this->filename = filename;
-	
-	if(updating_file)
-	{
-		_file_deleted  = false;
-		_file_modified = false;
-		last_mtime     = _get_file_mtime(handles[0].fh, filename.GetFullPath().ToStdString());
 		
-		while(last_accessed_blocks.size() > MAX_CLEAN_BLOCKS)
+		off_t restore_end = std::min((dst_offset + length), orig_length);
+		
+		for(off_t at = dst_offset; at < restore_end;)
 		{
-			Block *unload_me = last_accessed_blocks.front();
+			auto r = moved_out.find_first_in(at, (restore_end - at));
+			
+			if(r != moved_out.end() && r->offset <= at)
+			{
+				at = r->offset + r->length;
+				continue;
+			}
 			
-			unload_me->state = Block::UNLOADED;
+			off_t gap_end = r != moved_out.end() ? r->offset : restore_end;
 			
-			unload_me->data.clear();
-			unload_me->data.shrink_to_fit();
+			JournalRecord restore;
+			restore.type        = JournalRecord::RESTORE;
+			restore.src_offset  = 0;
+			restore.dst_offset  = at;
+			restore.length      = gap_end - at;
+			restore.data_length = gap_end - at;
 			
-			last_accessed_blocks.erase(last_accessed_blocks.begin());
+			records.push_back(restore);
+			
+			at = gap_end;
 		}
-	}
-	else{
-		/* We've written out a complete new file, and it is now the backing store for this
-		 * Buffer. Rebuild the block list so the offsets are correct.
+		
+		records.push_back(step);
+		
+		/* The saved data is written out before the records which refer to it, so any
+		 * record which made it to disk has all of its data, and data which is missing
+		 * later on must have been dropped after the step it belongs to finished.
 		*/
 		
-		_reinit_blocks(out_length);
-	}
+		std::vector<uint64_t> data_checksums;
+		off_t record_offset = journal_end;
+		bool saved_data = false;
+		
+		for(auto r = records.begin(); r != records.end(); ++r)
+		{
+			r->data_offset = record_offset + JOURNAL_RECORD_SIZE;
+			record_offset = r->data_offset + r->data_length;
+			
+			saved_data = saved_data || r->data_length > 0;
+			
+			off_t data_src = r->type == JournalRecord::MOVE
+				? std::max(r->src_offset, r->dst_offset)
+				: r->dst_offset;
+			
+			data_checksums.push_back(_journal_checksum(wfh, data_src, r->data_length, copy_buf));
+			_copy_file_data(wfh, data_src, jfh, r->data_offset, r->data_length, false, copy_buf);
+		}
+		
+		if(saved_data)
+		{
+			_sync_file(jfh);
+		}
+		
+		for(size_t i = 0; i < records.size(); ++i)
+		{
+			_journal_write_record(jfh, records[i], data_checksums[i]);
+		}
+		
+		_sync_file(jfh);
+		
+		journal.insert(journal.end(), records.begin(), records.end());
+		journal_end = record_offset;
+	};
 	
-	timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
-}
-
-void REHex::Buffer::write_copy(const std::string &filename)
-{
-	std::unique_lock<shared_mutex> l(general_lock);
+	std::list<SaveOp> pending;
+	off_t total_bytes = 0;
 	
-	FILE *out = fopen(filename.c_str(), "wb");
-	if(out == NULL)
+	try {
+		/* Reserve space in the output file if it isn't already at least as large
+		 * as the file we want to write out.
+		*/
+		
+		if(orig_length < out_length)
+		{
+			/* Windows (or GCC/MinGW) provides an ftruncate(), but for some reason it
+			 * fails with "File too large" if you try expanding a file with it.
+			*/
+			
+			#ifdef _WIN32
+			if(_chsize_s(fileno(wfh), out_length) != 0)
+			#else
+			if(ftruncate(fileno(wfh), out_length) == -1)
+			#endif
+			{
+				throw std::runtime_error(std::string("Could not expand file: ") + strerror(errno));
+			}
+		}
+		
+		/* Blocks can only be copied over the top of their old location if there is a
+		 * journal to restore it from should the copy fail part way through.
+		*/
+		pending = _plan_save(updating_file, (jfh != NULL));
+	}
+	catch(...)
 	{
-		throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
+		abort_write();
+		throw;
 	}
 	
-	struct stat st;
-	if(fstat(fileno(out), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+	for(auto op = pending.begin(); op != pending.end(); ++op)
 	{
-		fclose(out);
-		throw std::runtime_error(std::string("Could not open file: Not a regular file"));
+		total_bytes += op->length;
 	}
 	
-	/* Disable write buffering */
-	setbuf(out, NULL);
+	off_t done_bytes = 0;
 	
-	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	auto report_progress = [&]()
 	{
-		if(b->virt_length > 0)
+		if(!progress)
 		{
-			load_block(&(*b));
-			
-			if(fwrite(b->data.data(), b->virt_length, 1, out) == 0)
-			{
-				fclose(out);
-				throw std::runtime_error(std::string("Write error: ") + strerror(errno));
-			}
+			return true;
 		}
-	}
-	
-	fclose(out);
-}
-
-void REHex::Buffer::serialise(FileWriter *file)
-{
-	std::unique_lock<shared_mutex> l(general_lock);
-	
+		
+		/* The progress callback will probably yield to the event loop, which may
+		 * repaint views of this Buffer, so let readers in while it runs. The Buffer
+		 * is consistent with the file between blocks and write_lock keeps any
+		 * writers out - any attempt to modify the Buffer from within the callback
+		 * would deadlock on it, so saving_thread makes those throw instead.
+		 *
+		 * The file is being modified under our feet, so don't let the timer flag
+		 * it as having been changed externally in the meantime.
+		*/
+		
+		bool timer_running = timer.IsRunning();
+		timer.Stop();
+		
+		saving_thread = std::this_thread::get_id();
+		l.unlock();
+		
+		bool keep_going;
+		
+		try {
+			keep_going = progress(done_bytes, total_bytes);
+		}
+		catch(...)
+		{
+			l.lock();
+			saving_thread = std::thread::id();
+			
+			throw;
+		}
+		
+		l.lock();
+		saving_thread = std::thread::id();
+		
+		if(timer_running)
+		{
+			timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
+		}
+		
+		return keep_going;
+	};
+	
+	bool cancelled;
+	
+	try {
+		cancelled = !report_progress();
+	
+		for(auto op = pending.begin(); op != pending.end() && !cancelled;)
+		{
+			auto next = std::next(op);
+		
+			if(updating_file && next != pending.end() && (op->dst_offset + op->length) > next->src_offset)
+			{
+				/* Can't write this step yet; we'd write into the data of the next one.
+				 *
+				 * In order for this to happen, the set of blocks before the next one must
+				 * have grown in length, which means the virt_offset of the next block MUST
+				 * be greater than its real_offset and so it won't be written to the file
+				 * preceeding it, where it could overwrite data still needed to shuffle
+				 * clean blocks to higher offsets.
+				*/
+		
+				++op;
+				continue;
+			}
+			
+			if(op->from_memory)
+			{
+				Block *block = &(blocks[op->first_block]);
+				
+				journal_step(JournalRecord::WRITE, 0, op->dst_offset, op->length);
+				
+				{
+					BlockPtr block_ref = load_block(block);
+					
+					if(fseeko(wfh, op->dst_offset, SEEK_SET) != 0)
+					{
+						throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+					}
+					
+					if(fwrite(block->data.data(), op->length, 1, wfh) == 0)
+					{
+						throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+					}
+				}
+				
+				if(updating_file)
+				{
+					/* Modified blocks are left dirty until the save has completed, in
+					 * case it needs to be rolled back.
+					*/
+					block->real_offset = block->virt_offset;
+				}
+				
+				done_bytes += op->length;
+				cancelled = !report_progress();
+			}
+			else{
+				/* Copy the blocks one at a time, starting from whichever end avoids
+				 * overwriting any which haven't been moved yet, so the Buffer remains
+				 * consistent with the file whenever the progress callback runs.
+				*/
+			
+				bool backwards = updating_file && op->dst_offset > op->src_offset;
+				size_t op_blocks = op->end_block - op->first_block;
+				
+				for(size_t i = 0; i < op_blocks && !cancelled; ++i)
+				{
+					Block *block = &(blocks[backwards ? (op->end_block - i - 1) : (op->first_block + i)]);
+					
+					if(block->virt_length == 0)
+					{
+						continue;
+					}
+					
+					if(updating_file)
+					{
+						journal_step(JournalRecord::MOVE, block->real_offset, block->virt_offset, block->virt_length);
+					}
+					else{
+						journal_step(JournalRecord::WRITE, 0, block->virt_offset, block->virt_length);
+					}
+					
+					{
+						HandlePtr fh = acquire_read_handle();
+						if(!fh)
+						{
+							throw std::runtime_error("Read error: unable to access file");
+						}
+						
+						_copy_file_data(fh, block->real_offset, wfh, block->virt_offset, block->virt_length, updating_file, copy_buf);
+					}
+					
+					if(updating_file)
+					{
+						block->real_offset = block->virt_offset;
+					}
+					
+					done_bytes += block->virt_length;
+					cancelled = !report_progress();
+				}
+			}
+			
+			if(cancelled)
+			{
+				break;
+			}
+			
+			op = pending.erase(op);
+			
+			if(op != pending.begin())
+			{
+				/* This isn't the first pending step, so we must've stepped
+				 * forwards to make a hole for one or more previous ones.
+				 * 
+				 * We've made the hole, so start walking backwards and writing
+				 * out the new blocks.
+				*/
+				
+				--op;
+			}
+		}
+		
+		if(!cancelled)
+		{
+			if(jfh != NULL)
+			{
+				/* Make sure everything has hit the disk before marking the journal
+				 * as complete, after which an interrupted save will be finished off
+				 * rather than rolled back when the file is next opened.
+				*/
+		
+				_sync_file(wfh);
+				
+				JournalRecord commit;
+				commit.type        = JournalRecord::COMMIT;
+				commit.src_offset  = 0;
+				commit.dst_offset  = 0;
+				commit.length      = out_length;
+				commit.data_offset = journal_end + JOURNAL_RECORD_SIZE;
+				commit.data_length = 0;
+				
+				_journal_write_record(jfh, commit, JOURNAL_CHECKSUM_INIT);
+				_sync_file(jfh);
+			}
+			
+			if(ftruncate(fileno(wfh), out_length) == -1)
+			{
+				throw std::runtime_error(std::string("Could not truncate file: ") + strerror(errno));
+			}
+			
+			_sync_file(wfh);
+		}
+	}
+	catch(...)
+	{
+		abort_write();
+		throw;
+	}
+	
+	if(cancelled)
+	{
+		abort_write();
+		return false;
+	}
+	
+	if(jfh != NULL)
+	{
+		fclose(jfh);
+		wxRemoveFile(journal_path);
+	}
+	
+	close_handles();
+	
+	/* The Buffer is now backed by the new file (which might be the old one). */
+	
+	handles[0].fh = wfh;
+	this->filename = filename;
+	
+	if(updating_file)
+	{
+		for(auto b = blocks.begin(); b != blocks.end(); ++b)
+		{
+			b->real_offset = b->virt_offset;
+			
+			if(b->state == Block::DIRTY && b->virt_length > 0)
+			{
+				b->state = Block::CLEAN;
+				
+				_last_access_remove(&(*b));
+				_last_access_push(&(*b));
+			}
+		}
+		
+		_file_deleted  = false;
+		_file_modified = false;
+		last_mtime     = _get_file_mtime(handles[0].fh, filename.GetFullPath().ToStdString());
+		
+		_last_access_trim();
+	}
+	else{
+		/* We've written out a complete new file, and it is now the backing store for this
+		 * Buffer. Rebuild the block list so the offsets are correct.
+		*/
+		
+		_reinit_blocks(out_length);
+	}
+	
+	timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
+	
+	return true;
+}
+
+void REHex::Buffer::write_copy(const std::string &filename)
+{
+	std::unique_lock<shared_mutex> l(general_lock);
+	
+	FILE *out = fopen(filename.c_str(), "wb");
+	if(out == NULL)
+	{
+		throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
+	}
+	
+	struct stat st;
+	if(fstat(fileno(out), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+	{
+		fclose(out);
+		throw std::runtime_error(std::string("Could not open file: Not a regular file"));
+	}
+	
+	/* Disable write buffering */
+	setbuf(out, NULL);
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		if(b->virt_length > 0)
+		{
+			load_block(&(*b));
+			
+			if(fwrite(b->data.data(), b->virt_length, 1, out) == 0)
+			{
+				fclose(out);
+				throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+			}
+		}
+	}
+	
+	fclose(out);
+}
+
+void REHex::Buffer::serialise(FileWriter *file)
+{
+	std::unique_lock<shared_mutex> l(general_lock);
+	
 	if(filename.IsOk())
 	{
 		wxFileName wxfn(filename.GetFullPath());
@@ -692,195 +1187,799 @@ void REHex::Buffer::serialise(FileWriter *file)
 #endif
 	}
 	
-	file->write_tlv("MTIM", [&]()
+	file->write_tlv("MTIM", [&]()
+	{
+		file->write<int64_t>(htole64(last_mtime.tv_sec));
+		file->write<int32_t>(htole32(last_mtime.tv_nsec));
+	});
+	
+	if(_file_deleted)
+	{
+		file->write_tlv("FDEL", NULL, 0);
+	}
+	else if(_file_modified)
+	{
+		file->write_tlv("FMOD", NULL, 0);
+	}
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		file->write_tlv("BLCK", [&]()
+		{
+			file->write<int64_t>(htole64(b->real_offset));
+			file->write<int32_t>(htole32(b->virt_length));
+		});
+	}
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		if(b->state == Block::State::DIRTY)
+		{
+			file->write_tlv("DBLK", [&]()
+			{
+				file->write<int64_t>(htole64(b->virt_offset));
+				file->write(b->data.data(), b->virt_length);
+			});
+		}
+	}
+}
+
+std::unique_ptr<REHex::Buffer> REHex::Buffer::deserialise(FileReader *file)
+{
+	std::unique_ptr<Buffer> buffer;
+	buffer.reset(new Buffer());
+	
+	buffer->blocks.clear();
+	
+	int64_t next_virt_off = 0;
+	
+	while(file->read_tlv([&](const FourCC &type, uint32_t length)
+	{
+		if(type == "FNAM")
+		{
+			std::vector<char> buf(length);
+			file->read(buf.data(), length, length);
+			
+			wxFileName wxfn(wxString::FromUTF8(buf.data(), length));
+			
+			if(wxfn.IsRelative())
+			{
+				wxfn = wxFileName(file->get_filename()).GetPathWithSep() + wxfn.GetFullPath();
+			}
+
+			buffer->filename = wxfn;
+		}
+#ifdef REHEX_MACFILENAME_ENABLE_SS_BOOKMARKS
+		else if(type == "BMRK")
+		{
+			std::vector<char> buf(length);
+			file->read(buf.data(), length, length);
+			
+			wxString bookmark = wxString::FromUTF8(buf.data(), length);
+
+			try {
+				buffer->filename = MacFileName::CreateFromBookmark(bookmark);
+			}
+			catch(const std::exception &e)
+			{
+				wxGetApp().printf_error("Unable to restore bookmark (%s), file may not be accessible\n", e.what());
+			}
+		}
+#endif
+		else if(type == "MTIM")
+		{
+			buffer->last_mtime.tv_sec = le64toh(file->read<int64_t>());
+			buffer->last_mtime.tv_nsec = le32toh(file->read<int32_t>());
+		}
+		else if(type == "FDEL")
+		{
+			buffer->_file_deleted = true;
+		}
+		else if(type == "FMOD")
+		{
+			buffer->_file_modified = true;
+		}
+		else if(type == "BLCK")
+		{
+			int64_t real_offset = le64toh(file->read<int64_t>());
+			int32_t virt_length = le32toh(file->read<int32_t>());
+			
+			Block block(next_virt_off, virt_length);
+			block.real_offset = real_offset;
+			
+			buffer->blocks.emplace_back(std::move(block));
+			next_virt_off += virt_length;
+		}
+		else if(type == "DBLK")
+		{
+			int64_t virt_offset = le64toh(file->read<int64_t>());
+			int64_t virt_length = length - 8;
+
+			Block *block;
+			if((virt_offset + virt_length) == buffer->_length())
+			{
+				block = &(buffer->blocks.back());
+			}
+			else{
+				block = buffer->_block_by_virt_offset(virt_offset);
+			}
+
+			if(block == NULL || block->virt_offset != virt_offset || block->virt_length != virt_length)
+			{
+				throw std::runtime_error("Error deserialising Buffer: Invalid dirty block");
+			}
+			
+			block->data.resize(virt_length);
+			file->read(block->data.data(), virt_length, virt_length);
+			
+			block->state = Block::State::DIRTY;
+		}
+	})) {}
+	
+	if(buffer->blocks.empty())
+	{
+		throw std::runtime_error("Error deserialising Buffer: No blocks found");
+	}
+	
+	if(buffer->filename.IsOk() && !(buffer->_file_deleted))
+	{
+		_recover_journal(buffer->filename.GetFullPath().ToStdString());
+		
+		FILE *inode_fh = fopen(buffer->filename.GetFullPath().c_str(), "rb");
+		if(inode_fh == NULL)
+		{
+			buffer->_file_deleted = true;
+			return buffer;
+		}
+		
+		struct stat st;
+		if(fstat(fileno(inode_fh), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+		{
+			fclose(inode_fh);
+			
+			buffer->_file_deleted = true;
+			return buffer;
+		}
+		
+		setbuf(inode_fh, NULL);
+		buffer->handles[0].fh = inode_fh;
+		
+		if(!(buffer->_file_modified))
+		{
+			FileTime current_mtime = _get_file_mtime(inode_fh, buffer->filename.GetFullPath().ToStdString());
+			
+			if(current_mtime == buffer->last_mtime)
+			{
+				/* File not modified - check again later. */
+				buffer->timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
+			}
+			else{
+				buffer->_file_modified = true;
+			}
+		}
+	}
+	
+	return buffer;
+}
+
+off_t REHex::Buffer::length()
+{
+	shared_lock l(general_lock);
+	return _length();
+}
+
+off_t REHex::Buffer::_length()
+{
+	return blocks.back().virt_offset + blocks.back().virt_length;
+}
+
+void REHex::Buffer::_last_access_push(Block *block)
+{
+	assert(!block->lab_linked);
+	
+	block->lab_bytes = block->data.size();
+	
+	block->lab_prev = lab_tail;
+	block->lab_next = NULL;
+	block->lab_linked = true;
+	
+	if(lab_tail != NULL)
+	{
+		lab_tail->lab_next = block;
+	}
+	else{
+		lab_head = block;
+	}
+	
+	lab_tail = block;
+	
+	last_accessed_bytes += block->lab_bytes;
+}
+
+void REHex::Buffer::_last_access_remove(Block *block)
+{
+	if(!block->lab_linked)
+	{
+		return;
+	}
+	
+	if(block->lab_prev != NULL)
+	{
+		block->lab_prev->lab_next = block->lab_next;
+	}
+	else{
+		assert(lab_head == block);
+		lab_head = block->lab_next;
+	}
+	
+	if(block->lab_next != NULL)
+	{
+		block->lab_next->lab_prev = block->lab_prev;
+	}
+	else{
+		assert(lab_tail == block);
+		lab_tail = block->lab_prev;
+	}
+	
+	block->lab_prev = NULL;
+	block->lab_next = NULL;
+	block->lab_linked = false;
+	
+	assert(last_accessed_bytes >= block->lab_bytes);
+	last_accessed_bytes -= block->lab_bytes;
+}
+
+void REHex::Buffer::_last_access_trim()
+{
+	/* Unload the oldest clean blocks until we are within budget, always keeping the most
+	 * recently released block since it is probably about to be accessed again.
+	*/
+	
+	while(last_accessed_bytes > clean_cache_limit && lab_head != lab_tail)
+	{
+		Block *unload_me = lab_head;
+		
+		assert(unload_me->refcount == 0);
+		
+		_last_access_remove(unload_me);
+		
+		unload_me->state = Block::UNLOADED;
+		
+		unload_me->data.clear();
+		unload_me->data.shrink_to_fit();
+		
+		PROFILE_COUNT("REHex::Buffer clean cache evictions", 1);
+	}
+}
+
+bool REHex::Buffer::_read_stream_advance(size_t block_idx)
+{
+	for(size_t i = 0; i < MAX_READ_STREAMS; ++i)
+	{
+		if(read_streams[i] == block_idx)
+		{
+			/* Reader has moved on to the next block. */
+			read_streams[i] = block_idx + 1;
+			return true;
+		}
+		else if(read_streams[i] == (block_idx + 1))
+		{
+			/* Reader is still working through the current block. */
+			return true;
+		}
+	}
+	
+	/* Not part of any stream we know about, replace the oldest one. */
+	
+	read_streams[next_read_stream] = block_idx + 1;
+	next_read_stream = (next_read_stream + 1) % MAX_READ_STREAMS;
+	
+	return false;
+}
+
+void REHex::Buffer::_read_streams_reset()
+{
+	std::fill(read_streams, read_streams + MAX_READ_STREAMS, (size_t)(-1));
+	next_read_stream = 0;
+}
+
+void REHex::Buffer::_prefetch_blocks(FILE *fh, Block *after_block)
+{
+	#ifdef POSIX_FADV_WILLNEED
+	Block *end = std::min((after_block + 1 + READAHEAD_BLOCKS), (blocks.data() + blocks.size()));
+	
+	for(Block *block = after_block + 1; block < end; ++block)
+	{
+		if(block->state == Block::UNLOADED && block->virt_length > 0)
+		{
+			/* Ask the kernel to start reading the next block into the page cache in
+			 * the background, so the data is (hopefully) ready by the time the
+			 * reader gets there. This is purely a hint and errors are ignored.
+			*/
+			posix_fadvise(fileno(fh), block->real_offset, block->virt_length, POSIX_FADV_WILLNEED);
+		}
+	}
+	#endif
+}
+
+std::list<REHex::Buffer::SaveOp> REHex::Buffer::_plan_save(bool updating_file, bool overlapping_moves)
+{
+	std::list<SaveOp> plan;
+	
+	for(size_t i = 0; i < blocks.size(); ++i)
+	{
+		Block *block = &(blocks[i]);
+	
+		if(block->virt_length == 0)
+		{
+			continue;
+		}
+		
+		if(updating_file && block->state != Block::DIRTY && block->virt_offset == block->real_offset)
+		{
+			/* We're updating the file we originally read data in from and this block
+			 * hasn't changed (in contents or offset), don't need to do anything.
+			*/
+			continue;
+		}
+		
+		bool overlaps_self = updating_file
+			&& block->real_offset < (block->virt_offset + block->virt_length)
+			&& block->virt_offset < (block->real_offset + block->virt_length);
+		
+		/* Modified blocks have to be written out from memory. Unmodified blocks are
+		 * copied straight across from the backing file without churning the clean
+		 * block cache, unless they are already loaded and being written to a new file.
+		*/
+		bool from_memory = block->state == Block::DIRTY
+			|| (!updating_file && block->state == Block::CLEAN)
+			|| (overlaps_self && !overlapping_moves);
+		
+		if(!from_memory && !plan.empty())
+		{
+			SaveOp &prev = plan.back();
+			
+			if(!prev.from_memory
+				&& (prev.src_offset + prev.length) == block->real_offset
+				&& (prev.dst_offset + prev.length) == block->virt_offset)
+			{
+				/* This block has moved by the same amount as the previous one. */
+				
+				prev.end_block = i + 1;
+				prev.length += block->virt_length;
+				
+				continue;
+			}
+		}
+		
+		SaveOp op;
+		op.first_block = i;
+		op.end_block   = i + 1;
+		op.src_offset  = block->real_offset;
+		op.dst_offset  = block->virt_offset;
+		op.length      = block->virt_length;
+		op.from_memory = from_memory;
+		
+		plan.push_back(op);
+	}
+	
+	return plan;
+}
+
+void REHex::Buffer::_copy_file_data(FILE *in, off_t src_offset, FILE *out, off_t dst_offset, off_t length, bool same_file, std::vector<unsigned char> &copy_buf)
+{
+	bool overlapping = same_file
+		&& src_offset < (dst_offset + length)
+		&& dst_offset < (src_offset + length);
+	
+	#ifdef REHEX_HAVE_COPY_FILE_RANGE
+	while(!overlapping && length > 0)
+	{
+		off64_t in_off  = src_offset;
+		off64_t out_off = dst_offset;
+		
+		ssize_t copied = copy_file_range(fileno(in), &in_off, fileno(out), &out_off, length, 0);
+		if(copied > 0)
+		{
+			src_offset += copied;
+			dst_offset += copied;
+			length     -= copied;
+		}
+		else if(copied == 0)
+		{
+			throw std::runtime_error("Read error: unexpected end of file");
+		}
+		else if(errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+		{
+			/* Not supported between these files (or by this kernel), fall back to
+			 * copying via userspace.
+			*/
+			break;
+		}
+		else{
+			throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+		}
+	}
+	#endif
+	
+	if(length > 0 && copy_buf.size() < COPY_CHUNK_SIZE)
+	{
+		copy_buf.resize(COPY_CHUNK_SIZE);
+	}
+	
+	/* When moving data to a higher offset within the same file, work backwards from the end so
+	 * we never overwrite any of the source before it has been read.
+	*/
+	bool backwards = overlapping && dst_offset > src_offset;
+	
+	while(length > 0)
+	{
+		size_t chunk = std::min((off_t)(copy_buf.size()), length);
+		
+		off_t chunk_src = backwards ? (src_offset + length - chunk) : src_offset;
+		off_t chunk_dst = backwards ? (dst_offset + length - chunk) : dst_offset;
+		
+		if(fseeko(in, chunk_src, SEEK_SET) != 0)
+		{
+			throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+		}
+		
+		if(fread(copy_buf.data(), chunk, 1, in) == 0)
+		{
+			if(feof(in))
+			{
+				clearerr(in);
+				throw std::runtime_error("Read error: unexpected end of file");
+			}
+			else{
+				throw std::runtime_error(std::string("Read error: ") + strerror(errno));
+			}
+		}
+		
+		if(fseeko(out, chunk_dst, SEEK_SET) != 0)
+		{
+			throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+		}
+		
+		if(fwrite(copy_buf.data(), chunk, 1, out) == 0)
+		{
+			throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+		}
+		
+		if(!backwards)
+		{
+			src_offset += chunk;
+			dst_offset += chunk;
+		}
+		
+		length -= chunk;
+	}
+}
+
+/* While an existing file is being written over, each step of the save is recorded in a journal
+ * file alongside it before the step is carried out, along with any original data the step
+ * destroys. The journal consists of:
+ *
+ * - The JOURNAL_MAGIC string.
+ * - The original length of the file (64-bit little endian).
+ * - Any number of records, each consisting of the following 64-bit little endian fields followed
+ *   by data_length bytes of saved data:
+ *
+ *   - type (a JournalRecord::Type)
+ *   - src_offset
+ *   - dst_offset
+ *   - length
+ *   - data_length
+ *   - Checksum of the saved data.
+ *   - Checksum of the record's offset in the journal and the preceeding fields.
+ *
+ * Each step of the save is journalled as a WRITE or MOVE record, preceeded by RESTORE records
+ * holding the original data of any part of the destination which hasn't already been moved
+ * elsewhere. A MOVE over part of itself carries the overlapping part of the source, which is
+ * discarded (and overwritten by the next records) once the move has finished.
+ *
+ * Once the save has finished, a COMMIT record with the length of the new file is appended, the
+ * file is truncated to its new length and the journal is deleted.
+ *
+ * If the journal is found when opening the file, the previous save was interrupted, so it is
+ * rolled back by _journal_rollback(), unless the COMMIT record is present, in which case the save
+ * only needs finishing off by truncating the file.
+*/
+
+std::string REHex::Buffer::_journal_name(const std::string &filename)
+{
+	return filename + ".rehex-journal";
+}
+
+void REHex::Buffer::_journal_write_record(FILE *jfh, const JournalRecord &record, uint64_t data_checksum)
+{
+	off_t record_offset = record.data_offset - JOURNAL_RECORD_SIZE;
+	
+	uint64_t record_le[7] = {
+		htole64(record.type),
+		htole64(record.src_offset),
+		htole64(record.dst_offset),
+		htole64(record.length),
+		htole64(record.data_length),
+		htole64(data_checksum),
+		0,
+	};
+	
+	uint64_t record_offset_le = htole64(record_offset);
+	
+	uint64_t checksum = journal_checksum(JOURNAL_CHECKSUM_INIT, (const unsigned char*)(&record_offset_le), sizeof(record_offset_le));
+	checksum = journal_checksum(checksum, (const unsigned char*)(record_le), (6 * sizeof(uint64_t)));
+	
+	record_le[6] = htole64(checksum);
+	
+	if(fseeko(jfh, record_offset, SEEK_SET) != 0)
 	{
-		file->write<int64_t>(htole64(last_mtime.tv_sec));
-		file->write<int32_t>(htole32(last_mtime.tv_nsec));
-	});
+		throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+	}
 	
-	if(_file_deleted)
+	if(fwrite(record_le, sizeof(record_le), 1, jfh) == 0)
 	{
-		file->write_tlv("FDEL", NULL, 0);
+		throw std::runtime_error(std::string("Write error: ") + strerror(errno));
 	}
-	else if(_file_modified)
+}
+
+bool REHex::Buffer::_journal_read_record(FILE *jfh, off_t record_offset, JournalRecord *record, bool *data_valid, std::vector<unsigned char> &copy_buf)
+{
+	uint64_t record_le[7];
+	
+	if(fseeko(jfh, record_offset, SEEK_SET) != 0 || fread(record_le, sizeof(record_le), 1, jfh) == 0)
 	{
-		file->write_tlv("FMOD", NULL, 0);
+		/* End of the journal. */
+		return false;
 	}
 	
-	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	uint64_t record_offset_le = htole64(record_offset);
+	
+	uint64_t checksum = journal_checksum(JOURNAL_CHECKSUM_INIT, (const unsigned char*)(&record_offset_le), sizeof(record_offset_le));
+	checksum = journal_checksum(checksum, (const unsigned char*)(record_le), (6 * sizeof(uint64_t)));
+	
+	uint64_t type = le64toh(record_le[0]);
+	
+	if(checksum != le64toh(record_le[6]) || type < JournalRecord::RESTORE || type > JournalRecord::COMMIT)
 	{
-		file->write_tlv("BLCK", [&]()
-		{
-			file->write<int64_t>(htole64(b->real_offset));
-			file->write<int32_t>(htole32(b->virt_length));
-		});
+		/* Record wasn't completely written, so the step it belongs to never started. */
+		return false;
 	}
 	
-	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	record->type        = (JournalRecord::Type)(type);
+	record->src_offset  = le64toh(record_le[1]);
+	record->dst_offset  = le64toh(record_le[2]);
+	record->length      = le64toh(record_le[3]);
+	record->data_offset = record_offset + JOURNAL_RECORD_SIZE;
+	record->data_length = le64toh(record_le[4]);
+	
+	try {
+		*data_valid = _journal_checksum(jfh, record->data_offset, record->data_length, copy_buf) == le64toh(record_le[5]);
+	}
+	catch(const std::exception &e)
 	{
-		if(b->state == Block::State::DIRTY)
-		{
-			file->write_tlv("DBLK", [&]()
-			{
-				file->write<int64_t>(htole64(b->virt_offset));
-				file->write(b->data.data(), b->virt_length);
-			});
-		}
+		/* Data has been truncated away. */
+		clearerr(jfh);
+		*data_valid = false;
 	}
+	
+	return true;
 }
 
-std::unique_ptr<REHex::Buffer> REHex::Buffer::deserialise(FileReader *file)
+uint64_t REHex::Buffer::_journal_checksum(FILE *fh, off_t offset, off_t length, std::vector<unsigned char> &copy_buf)
 {
-	std::unique_ptr<Buffer> buffer;
-	buffer.reset(new Buffer());
+	if(length > 0 && copy_buf.size() < COPY_CHUNK_SIZE)
+	{
+		copy_buf.resize(COPY_CHUNK_SIZE);
+	}
 	
-	buffer->blocks.clear();
+	if(length > 0 && fseeko(fh, offset, SEEK_SET) != 0)
+	{
+		throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+	}
 	
-	int64_t next_virt_off = 0;
+	uint64_t checksum = JOURNAL_CHECKSUM_INIT;
 	
-	while(file->read_tlv([&](const FourCC &type, uint32_t length)
+	while(length > 0)
 	{
-		if(type == "FNAM")
+		size_t chunk = std::min((off_t)(copy_buf.size()), length);
+		
+		if(fread(copy_buf.data(), chunk, 1, fh) == 0)
 		{
-			std::vector<char> buf(length);
-			file->read(buf.data(), length, length);
-			
-			wxFileName wxfn(wxString::FromUTF8(buf.data(), length));
-			
-			if(wxfn.IsRelative())
-			{
-				wxfn = wxFileName(file->get_filename()).GetPathWithSep() + wxfn.GetFullPath();
-			}
-
-			buffer->filename = wxfn;
+			throw std::runtime_error(std::string("Read error: ") + (feof(fh) ? "unexpected end of file" : strerror(errno)));
 		}
-#ifdef REHEX_MACFILENAME_ENABLE_SS_BOOKMARKS
-		else if(type == "BMRK")
-		{
-			std::vector<char> buf(length);
-			file->read(buf.data(), length, length);
-			
-			wxString bookmark = wxString::FromUTF8(buf.data(), length);
+		
+		checksum = journal_checksum(checksum, copy_buf.data(), chunk);
+		length -= chunk;
+	}
+	
+	return checksum;
+}
 
-			try {
-				buffer->filename = MacFileName::CreateFromBookmark(bookmark);
-			}
-			catch(const std::exception &e)
-			{
-				wxGetApp().printf_error("Unable to restore bookmark (%s), file may not be accessible\n", e.what());
-			}
-		}
-#endif
-		else if(type == "MTIM")
-		{
-			buffer->last_mtime.tv_sec = le64toh(file->read<int64_t>());
-			buffer->last_mtime.tv_nsec = le32toh(file->read<int32_t>());
-		}
-		else if(type == "FDEL")
+/* Each part of the file is only written once during a save and the source of any move must not
+ * have been overwritten when it is read, so the steps can be undone in reverse order:
+ *
+ * - A RESTORE record puts back the original data of part of a destination.
+ *
+ * - A MOVE which has finished is undone by moving the data back. Any part of its destination
+ *   which isn't covered by a RESTORE record was the source of an earlier move, which will be
+ *   moved back over it in turn.
+ *
+ * - The last step may not have finished. A MOVE which doesn't overlap itself hasn't touched its
+ *   source, while one which does has the overlapping part of its source saved in the journal.
+ *   A MOVE over itself whose saved data has been discarded must have finished.
+*/
+
+void REHex::Buffer::_journal_rollback(FILE *jfh, FILE *wfh, const std::vector<JournalRecord> &records, off_t orig_length, std::vector<unsigned char> &copy_buf)
+{
+	size_t last_step = records.size();
+	
+	for(size_t i = 0; i < records.size(); ++i)
+	{
+		if(records[i].type == JournalRecord::WRITE || records[i].type == JournalRecord::MOVE)
 		{
-			buffer->_file_deleted = true;
+			last_step = i;
 		}
-		else if(type == "FMOD")
+	}
+	
+	for(size_t i = records.size(); i > 0; --i)
+	{
+		const JournalRecord &r = records[i - 1];
+		
+		if(r.type == JournalRecord::RESTORE)
 		{
-			buffer->_file_modified = true;
+			_copy_file_data(jfh, r.data_offset, wfh, r.dst_offset, r.data_length, false, copy_buf);
 		}
-		else if(type == "BLCK")
+		else if(r.type == JournalRecord::MOVE)
 		{
-			int64_t real_offset = le64toh(file->read<int64_t>());
-			int32_t virt_length = le32toh(file->read<int32_t>());
-			
-			Block block(next_virt_off, virt_length);
-			block.real_offset = real_offset;
+			bool overlaps_self = r.src_offset < (r.dst_offset + r.length) && r.dst_offset < (r.src_offset + r.length);
 			
-			buffer->blocks.emplace_back(std::move(block));
-			next_virt_off += virt_length;
-		}
-		else if(type == "DBLK")
-		{
-			int64_t virt_offset = le64toh(file->read<int64_t>());
-			int64_t virt_length = length - 8;
-
-			Block *block;
-			if((virt_offset + virt_length) == buffer->_length())
+			if((i - 1) != last_step || (overlaps_self && r.data_length == 0))
 			{
-				block = &(buffer->blocks.back());
+				_copy_file_data(wfh, r.dst_offset, wfh, r.src_offset, r.length, true, copy_buf);
 			}
-			else{
-				block = buffer->_block_by_virt_offset(virt_offset);
-			}
-
-			if(block == NULL || block->virt_offset != virt_offset || block->virt_length != virt_length)
+			else if(r.data_length > 0)
 			{
-				throw std::runtime_error("Error deserialising Buffer: Invalid dirty block");
+				_copy_file_data(jfh, r.data_offset, wfh, std::max(r.src_offset, r.dst_offset), r.data_length, false, copy_buf);
 			}
-			
-			block->data.resize(virt_length);
-			file->read(block->data.data(), virt_length, virt_length);
-			
-			block->state = Block::State::DIRTY;
 		}
-	})) {}
+	}
 	
-	if(buffer->blocks.empty())
+	if(ftruncate(fileno(wfh), orig_length) == -1)
 	{
-		throw std::runtime_error("Error deserialising Buffer: No blocks found");
+		throw std::runtime_error(std::string("Could not truncate file: ") + strerror(errno));
 	}
 	
-	if(buffer->filename.IsOk() && !(buffer->_file_deleted))
+	_sync_file(wfh);
+}
+
+void REHex::Buffer::_recover_journal(const std::string &filename)
+{
+	std::string journal_path = _journal_name(filename);
+	
+	FILE *jfh = fopen(journal_path.c_str(), "rb");
+	if(jfh == NULL)
 	{
-		FILE *inode_fh = fopen(buffer->filename.GetFullPath().c_str(), "rb");
-		if(inode_fh == NULL)
+		/* No interrupted save to recover. */
+		return;
+	}
+	
+	setbuf(jfh, NULL);
+	
+	char magic[JOURNAL_MAGIC_SIZE];
+	uint64_t orig_length_le;
+	
+	if(fread(magic, sizeof(magic), 1, jfh) == 0 || fread(&orig_length_le, sizeof(orig_length_le), 1, jfh) == 0)
+	{
+		/* The journal header is written before the file is touched, so the save
+		 * didn't get as far as modifying it.
+		*/
+		
+		fclose(jfh);
+		wxRemoveFile(journal_path);
+		
+		return;
+	}
+	
+	if(memcmp(magic, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) != 0)
+	{
+		wxGetApp().printf_error("Ignoring %s: Not a valid save journal\n", journal_path.c_str());
+		
+		fclose(jfh);
+		return;
+	}
+	
+	std::vector<unsigned char> copy_buf;
+	
+	std::vector<JournalRecord> records;
+	off_t commit_length = -1;
+	
+	for(off_t record_offset = JOURNAL_HEADER_SIZE;;)
+	{
+		JournalRecord record;
+		bool data_valid;
+		
+		if(!_journal_read_record(jfh, record_offset, &record, &data_valid, copy_buf))
 		{
-			buffer->_file_deleted = true;
-			return buffer;
+			break;
 		}
 		
-		struct stat st;
-		if(fstat(fileno(inode_fh), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+		if(record.type == JournalRecord::COMMIT)
 		{
-			fclose(inode_fh);
+			commit_length = record.length;
+			break;
+		}
+		
+		if(!data_valid)
+		{
+			if(record.type != JournalRecord::MOVE)
+			{
+				break;
+			}
 			
-			buffer->_file_deleted = true;
-			return buffer;
+			/* Data saved from a move is discarded once the move has finished. */
+			record.data_length = 0;
 		}
 		
-		buffer->handles[0].fh = inode_fh;
+		records.push_back(record);
+		record_offset = record.data_offset + record.data_length;
+	}
+	
+	FILE *wfh = fopen(filename.c_str(), "r+b");
+	if(wfh == NULL)
+	{
+		/* Leave the journal alone so the save can still be recovered once the file is
+		 * writable, and let the caller open the file as it is.
+		*/
 		
-		if(!(buffer->_file_modified))
+		wxGetApp().printf_error("%s has an interrupted save which can't be recovered until the file can be written to (%s), its content may be incomplete\n",
+			filename.c_str(), strerror(errno));
+		
+		fclose(jfh);
+		return;
+	}
+	
+	setbuf(wfh, NULL);
+	
+	try {
+		if(commit_length >= 0)
 		{
-			FileTime current_mtime = _get_file_mtime(inode_fh, buffer->filename.GetFullPath().ToStdString());
-			
-			if(current_mtime == buffer->last_mtime)
+			if(ftruncate(fileno(wfh), commit_length) == -1)
 			{
-				/* File not modified - check again later. */
-				buffer->timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
-			}
-			else{
-				buffer->_file_modified = true;
+				throw std::runtime_error(std::string("Could not truncate file: ") + strerror(errno));
 			}
+			
+			_sync_file(wfh);
 		}
+		else{
+			_journal_rollback(jfh, wfh, records, le64toh(orig_length_le), copy_buf);
+		}
+	}
+	catch(const std::exception &e)
+	{
+		wxGetApp().printf_error("Could not recover interrupted save of %s: %s\n", filename.c_str(), e.what());
+		
+		fclose(wfh);
+		fclose(jfh);
+		
+		return;
 	}
 	
-	return buffer;
-}
-
-off_t REHex::Buffer::length()
-{
-	shared_lock l(general_lock);
-	return _length();
-}
-
-off_t REHex::Buffer::_length()
-{
-	return blocks.back().virt_offset + blocks.back().virt_length;
+	fclose(wfh);
+	fclose(jfh);
+	
+	wxRemoveFile(journal_path);
 }
 
-void REHex::Buffer::_last_access_remove(Block *block)
+void REHex::Buffer::_sync_file(FILE *fh)
 {
-	auto lab_it = std::find(last_accessed_blocks.begin(), last_accessed_blocks.end(), block);
-	if(lab_it != last_accessed_blocks.end())
+	#ifdef _WIN32
+	if(fflush(fh) != 0 || _commit(fileno(fh)) != 0)
+	#else
+	if(fflush(fh) != 0 || fsync(fileno(fh)) != 0)
+	#endif
 	{
-		last_accessed_blocks.erase(lab_it);
+		throw std::runtime_error(std::string("Could not flush file: ") + strerror(errno));
 	}
 }
 
@@ -929,6 +2028,8 @@ FILE *REHex::Buffer::reopen_file(FILE *fh, const std::string &filename)
 		return NULL;
 	}
 	
+	setbuf(dup_fh, NULL);
+	
 	return dup_fh;
 }
 
@@ -1007,33 +2108,28 @@ std::vector<unsigned char> REHex::Buffer::read_data(const BitOffset &offset, off
 	return data;
 }
 
-std::vector<bool> REHex::Buffer::read_bits(const BitOffset &offset, size_t max_length)
+REHex::BitVector REHex::Buffer::read_bits(const BitOffset &offset, size_t max_length)
 {
-	BitOffset file_data_base = BitOffset(offset.byte(), 0);
+	PROFILE_BLOCK("REHex::Buffer::read_bits");
 	
-	std::vector<unsigned char> file_data = read_data(file_data_base, ((max_length + 7) / 8) + 1);
+	/* Read enough whole bytes to cover the requested bits, then shift them into place. */
 	
-	std::vector<bool> file_bits;
-	file_bits.reserve(std::min(max_length, (file_data.size() * 8)));
+	size_t read_bytes = (max_length + offset.bit() + 7) / 8;
+	std::vector<unsigned char> file_data = read_data(BitOffset(offset.byte(), 0), read_bytes);
 	
-	int next_bit = 7 - offset.bit();
-	
-	for(size_t i = 0, j = 0; i < file_data.size() && j < max_length; ++i)
+	if((file_data.size() * 8) <= (size_t)(offset.bit()))
 	{
-		for(; next_bit >= 0 && j < max_length; ++j, --next_bit)
-		{
-			bool bit = ((file_data[i] & (1 << next_bit)) != 0);
-			file_bits.push_back(bit);
-		}
-		
-		next_bit = 7;
+		return BitVector();
 	}
 	
-	return file_bits;
+	size_t length = std::min(max_length, ((file_data.size() * 8) - offset.bit()));
+	
+	return BitVector(file_data.data(), offset.bit(), length);
 }
 
 bool REHex::Buffer::overwrite_data(BitOffset offset, unsigned const char *data, off_t length)
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
 	if((offset + BitOffset(length, 0)) > BitOffset(_length(), 0))
@@ -1086,8 +2182,9 @@ bool REHex::Buffer::overwrite_data(BitOffset offset, unsigned const char *data,
 	return true;
 }
 
-bool REHex::Buffer::overwrite_bits(BitOffset offset, const std::vector<bool> &data)
+bool REHex::Buffer::overwrite_bits(BitOffset offset, const BitVector &data)
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
 	if((offset + BitOffset::from_int64(data.size())) > BitOffset(_length(), 0))
@@ -1108,28 +2205,14 @@ bool REHex::Buffer::overwrite_bits(BitOffset offset, const std::vector<bool> &da
 		
 		load_block(block);
 		
-		bool touched_block = false;
+		size_t block_bits = (size_t)((BitOffset(block->virt_length, 0) - block_offset).total_bits());
+		size_t to_copy = std::min(block_bits, (data.size() - data_pos));
 		
-		while(data_pos < data.size() && block_offset < block->virt_length)
+		if(to_copy > 0)
 		{
-			unsigned char bit = 128 >> block_offset.bit();
-			
-			if(data[data_pos])
-			{
-				block->data[block_offset.byte()] |= bit;
-			}
-			else{
-				block->data[block_offset.byte()] &= ~bit;
-			}
-			
-			++data_pos;
-			block_offset += BitOffset(0, 1);
+			data.copy_to(block->data.data(), block_offset.total_bits(), data_pos, to_copy);
+			data_pos += to_copy;
 			
-			touched_block = true;
-		}
-		
-		if(touched_block)
-		{
 			block->state = Block::DIRTY;
 			_last_access_remove(block);
 		}
@@ -1143,6 +2226,7 @@ bool REHex::Buffer::overwrite_bits(BitOffset offset, const std::vector<bool> &da
 
 bool REHex::Buffer::insert_data(off_t offset, unsigned const char *data, off_t length)
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
 	if(offset > _length())
@@ -1189,6 +2273,7 @@ bool REHex::Buffer::insert_data(off_t offset, unsigned const char *data, off_t l
 
 bool REHex::Buffer::erase_data(off_t offset, off_t length)
 {
+	std::unique_lock<std::mutex> wl = _lock_for_write();
 	std::unique_lock<shared_mutex> l(general_lock);
 	
 	if((offset + length) > _length())
@@ -1315,7 +2400,11 @@ REHex::Buffer::Block::Block(off_t offset, off_t length):
 	virt_offset(offset),
 	virt_length(length),
 	state(UNLOADED),
-	refcount(0) {}
+	refcount(0),
+	lab_bytes(0),
+	lab_prev(NULL),
+	lab_next(NULL),
+	lab_linked(false) {}
 
 REHex::Buffer::Block::Block(Block &&block):
 	real_offset(block.real_offset),
@@ -1323,7 +2412,17 @@ REHex::Buffer::Block::Block(Block &&block):
 	virt_length(block.virt_length),
 	state(block.state),
 	data(std::move(block.data)),
-	refcount(block.refcount.load()) {}
+	refcount(block.refcount.load()),
+	lab_bytes(block.lab_bytes),
+	lab_prev(NULL),
+	lab_next(NULL),
+	lab_linked(false)
+{
+	/* Blocks are only moved while the block list is being (re)built, before any of them
+	 * could have been linked into the last accessed list.
+	*/
+	assert(!block.lab_linked);
+}
 
 void REHex::Buffer::Block::grow(size_t min_size)
 {
@@ -20,8 +20,13 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
+#include <list>
 #include <mutex>
+#include <stdint.h>
 #include <string>
+#include <sys/stat.h>
+#include <thread>
 #include <time.h>
 #include <vector>
 #include <wx/event.h>
@@ -33,6 +38,7 @@
 #endif
 
 #include "BitOffset.hpp"
+#include "BitVector.hpp"
 #include "FileName.hpp"
 #include "FileReader.hpp"
 #include "FileWriter.hpp"
@@ -118,6 +124,26 @@ namespace REHex {
 			*/
 			shared_mutex general_lock;
 			
+			/**
+			 * Serialises operations which modify the Buffer.
+			 *
+			 * This is taken before general_lock and held for the whole of
+			 * write_inplace(), which releases general_lock while the progress
+			 * callback runs so that other threads (or event handlers run from the
+			 * callback) can continue to read from the Buffer.
+			 *
+			 * Always take this using _lock_for_write().
+			*/
+			std::mutex write_lock;
+			
+			/**
+			 * The thread running the progress callback of write_inplace(), if any.
+			 *
+			 * Any attempt to modify the Buffer from within the callback would
+			 * deadlock on write_lock, so _lock_for_write() throws instead.
+			*/
+			std::atomic<std::thread::id> saving_thread;
+			
 			struct FileTime: public timespec
 			{
 				public:
@@ -163,6 +189,18 @@ namespace REHex {
 					*/
 					std::atomic<int> refcount;
 					
+					/**
+					 * @brief Bytes charged to last_accessed_bytes while this
+					 * block is in the last accessed list.
+					*/
+					size_t lab_bytes;
+					
+					/* Links in the last accessed list, only valid when
+					 * lab_linked is true.
+					*/
+					Block *lab_prev, *lab_next;
+					bool lab_linked;
+					
 					Block(off_t offset, off_t length);
 					Block(Block&&);
 					
@@ -190,26 +228,84 @@ namespace REHex {
 					BlockPtr &operator=(const BlockPtr&);
 			};
 			
+			/**
+			 * @brief A single step in writing out the Buffer.
+			 *
+			 * Either copies a run of one or more unmodified blocks which have all
+			 * shifted by the same amount from the backing file, or writes a single
+			 * block out from memory.
+			*/
+			struct SaveOp
+			{
+				size_t first_block;  /**< Index of the first block in this step. */
+				size_t end_block;    /**< Index of the block after the last one in this step. */
+				
+				off_t src_offset;    /**< Offset of the data in the backing file. */
+				off_t dst_offset;    /**< Offset of the data in the file being written. */
+				off_t length;        /**< Length of the data. */
+				
+				bool from_memory;    /**< Whether to write the block from memory. */
+			};
+			
+			/**
+			 * @brief A record in a save journal.
+			*/
+			struct JournalRecord
+			{
+				enum Type
+				{
+					RESTORE = 1,  /**< Original data of a range which is about to be overwritten. */
+					WRITE   = 2,  /**< A range is about to be written from memory. */
+					MOVE    = 3,  /**< A range is about to be moved within the file. */
+					COMMIT  = 4,  /**< The save has finished and the file is being truncated. */
+				};
+				
+				Type type;
+				
+				off_t src_offset;   /**< Offset the range is being moved from (MOVE only). */
+				off_t dst_offset;   /**< Offset of the range being written. */
+				off_t length;       /**< Length of the range (new file length for COMMIT). */
+				
+				off_t data_offset;  /**< Offset of any saved original data in the journal. */
+				off_t data_length;  /**< Length of any saved original data. */
+			};
+			
 			std::vector<Block> blocks;
 			
 			bool _file_deleted, _file_modified;
 			FileTime last_mtime;
 			wxTimer timer;
 			
-			/* last_accessed_blocks is a list of recently released CLEAN blocks, sorted
-			 * from oldest to newest.
+			/* The last accessed list is an intrusive doubly-linked list of recently
+			 * released CLEAN blocks, running from oldest (lab_head) to newest
+			 * (lab_tail), so that blocks can be added, removed and evicted in
+			 * constant time regardless of how many are resident.
 			 *
-			 * When the number of loaded clean blocks in last_accessed_blocks exceeds
-			 * MAX_CLEAN_BLOCKS, the oldest block in last_accessed_blocks is unloaded to
-			 * save memory.
+			 * When the total size of the loaded clean blocks in the list exceeds
+			 * clean_cache_limit, the oldest blocks in the list are unloaded to save
+			 * memory.
 			 *
-			 * When a block is unloaded or dirtied it is removed from last_accessed_blocks
-			 * to make it no longer eligible for unloading.
+			 * When a block is unloaded or dirtied it is removed from the list to make
+			 * it no longer eligible for unloading.
 			*/
 			
-			std::vector<Block*> last_accessed_blocks;
+			Block *lab_head, *lab_tail;
+			size_t last_accessed_bytes;
+			size_t clean_cache_limit;
 			std::mutex lab_mutex;
 			
+			/* read_streams tracks the index of the next block expected by each of the
+			 * most recent sequential readers (e.g. the strings or checksum tools scanning
+			 * through the file), so that we can ask the OS to start reading the next
+			 * block(s) in before they are needed.
+			 *
+			 * Protected by lab_mutex.
+			*/
+			
+			static constexpr size_t MAX_READ_STREAMS = 8;
+			size_t read_streams[MAX_READ_STREAMS];
+			size_t next_read_stream;
+			
 		private:
 			Block *_block_by_virt_offset(off_t virt_offset);
 			
@@ -229,7 +325,38 @@ namespace REHex {
 			
 			off_t _length();
 			
+			void _last_access_push(Block *block);
 			void _last_access_remove(Block *block);
+			void _last_access_trim();
+			
+			bool _read_stream_advance(size_t block_idx);
+			void _read_streams_reset();
+			
+			void _prefetch_blocks(FILE *fh, Block *after_block);
+			
+			std::unique_lock<std::mutex> _lock_for_write();
+			
+			/**
+			 * @brief Work out the minimal set of steps needed to write out the Buffer.
+			 *
+			 * @param updating_file Whether the backing file is being updated in place.
+			 * @param overlapping_moves Whether blocks may be copied over their old location.
+			 *
+			 * When updating the backing file in place, unmodified blocks which haven't
+			 * moved are skipped entirely, and runs of unmodified blocks which have
+			 * moved by the same amount are coalesced into a single copy.
+			*/
+			std::list<SaveOp> _plan_save(bool updating_file, bool overlapping_moves);
+			
+			static void _copy_file_data(FILE *in, off_t src_offset, FILE *out, off_t dst_offset, off_t length, bool same_file, std::vector<unsigned char> &copy_buf);
+			
+			static std::string _journal_name(const std::string &filename);
+			static void _journal_write_record(FILE *jfh, const JournalRecord &record, uint64_t data_checksum);
+			static bool _journal_read_record(FILE *jfh, off_t record_offset, JournalRecord *record, bool *data_valid, std::vector<unsigned char> &copy_buf);
+			static uint64_t _journal_checksum(FILE *fh, off_t offset, off_t length, std::vector<unsigned char> &copy_buf);
+			static void _journal_rollback(FILE *jfh, FILE *wfh, const std::vector<JournalRecord> &records, off_t orig_length, std::vector<unsigned char> &copy_buf);
+			static void _recover_journal(const std::string &filename);
+			static void _sync_file(FILE *fh);
 			
 			void _reinit_blocks(off_t file_length);
 			
@@ -241,8 +368,10 @@ namespace REHex {
 			
 		public:
 			static const unsigned int DEFAULT_BLOCK_SIZE = 4194304; /* 4MiB */
-			static const unsigned int MAX_CLEAN_BLOCKS   = 4;
+			static const unsigned int DEFAULT_CLEAN_CACHE_LIMIT = 67108864; /* 64MiB */
+			static const unsigned int READAHEAD_BLOCKS   = 1;
 			static const unsigned int BLOCK_TRIM_THRESH  = 262144; /* 256KiB */
+			static const unsigned int COPY_CHUNK_SIZE    = 1048576; /* 1MiB */
 			static const unsigned int FILE_CHECK_INTERVAL_MS = 1000;
 			
 			const off_t block_size;
@@ -259,31 +388,79 @@ namespace REHex {
 			
 			~Buffer();
 			
+			/**
+			 * @brief Set the maximum amount of clean (unmodified) file data to keep in memory.
+			 *
+			 * Clean blocks which aren't in use are kept in memory after being read
+			 * until this limit is exceeded, at which point the least recently used
+			 * ones are discarded and will be read in from the file again if needed.
+			 *
+			 * At least one clean block is always retained, even if it exceeds the
+			 * limit. Modified blocks are never discarded and don't count towards it.
+			*/
+			void set_clean_cache_limit(size_t limit);
+			
+			/**
+			 * @brief Get the maximum amount of clean file data to keep in memory.
+			*/
+			size_t get_clean_cache_limit();
+			
 			/**
 			 * @brief Reload the file, discarding any changes made.
 			*/
 			void reload();
 			
+			/**
+			 * @brief Progress callback for write operations.
+			 *
+			 * Called with the number of bytes written so far and the total number of
+			 * bytes which need to be written. Return false to cancel the operation.
+			*/
+			typedef std::function<bool(off_t done, off_t total)> WriteProgressFunc;
+			
 			/**
 			 * @brief Write changes to backing file.
 			 *
+			 * @param progress Optional progress callback.
+			 *
 			 * Writes pending changes to the current backing file.
 			 *
+			 * The original contents of any part of the file which is overwritten are
+			 * first copied into a journal file alongside it, so that a cancelled or
+			 * failed save can be rolled back, and a save interrupted by a crash is
+			 * rolled back the next time the file is opened. If the journal can't be
+			 * created the file is updated directly.
+			 *
+			 * The progress callback may read from the Buffer, but any attempt to
+			 * modify it from within the callback will throw.
+			 *
+			 * Returns false if the write was cancelled by the progress callback, in
+			 * which case the file is left unchanged and the changes remain pending.
+			 *
 			 * Throws on I/O errors.
 			*/
-			void write_inplace();
+			bool write_inplace(const WriteProgressFunc &progress = WriteProgressFunc());
 			
 			/**
 			 * @brief Write out buffer to a new backing file.
 			 *
 			 * @param filename Filename of new backing file.
+			 * @param progress Optional progress callback.
 			 *
 			 * Writes out the current buffer state to a file and makes it the new
 			 * backing file of the buffer. The old backing file is unchanged.
 			 *
+			 * The data is written to a temporary file which is renamed over the
+			 * destination once complete, so an existing file is never left partially
+			 * overwritten.
+			 *
+			 * Returns false if the write was cancelled by the progress callback, in
+			 * which case the Buffer remains backed by the old file and the destination
+			 * is left untouched.
+			 *
 			 * Throws on I/O errors.
 			*/
-			void write_inplace(const FileName &filename);
+			bool write_inplace(const FileName &filename, const WriteProgressFunc &progress = WriteProgressFunc());
 			
 			/**
 			 * @brief Write out buffer to a file.
@@ -344,7 +521,7 @@ namespace REHex {
 			 *
 			 * Throws on I/O or memory allocation error.
 			*/
-			std::vector<bool> read_bits(const BitOffset &offset, size_t max_length);
+			BitVector read_bits(const BitOffset &offset, size_t max_length);
 			
 			/**
 			 * @brief Overwrite a series of bytes in the Buffer.
@@ -374,7 +551,7 @@ namespace REHex {
 			 * This can be used for writing sub-byte quantities of data into the
 			 * buffer, up to the last bit in the file.
 			*/
-			bool overwrite_bits(BitOffset offset, const std::vector<bool> &data);
+			bool overwrite_bits(BitOffset offset, const BitVector &data);
 			
 			/**
 			 * @brief Insert a series of bytes into the buffer.
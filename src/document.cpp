@@ -18,15 +18,19 @@
 #include "platform.hpp"
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <ctype.h>
 #include <inttypes.h>
 #include <iterator>
 #include <jansson.h>
 #include <limits>
 #include <map>
+#include <portable_endian.h>
 #include <stack>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <wx/clipbrd.h>
 #include <wx/dcbuffer.h>
@@ -36,8 +40,11 @@
 #include "CharacterEncoder.hpp"
 #include "DataType.hpp"
 #include "Events.hpp"
+#include "FileReader.hpp"
 #include "Palette.hpp"
+#include "profile.hpp"
 #include "textentrydialog.hpp"
+#include "ThreadPool.hpp"
 #include "util.hpp"
 
 static_assert(std::numeric_limits<json_int_t>::max() >= std::numeric_limits<off_t>::max(),
@@ -72,8 +79,10 @@ REHex::Document::Document():
 	title  = "Untitled";
 	
 	_forward_buffer_events();
+	buffer->set_clean_cache_limit(wxGetApp().settings->get_buffer_cache_size());
 	
 	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
+	wxGetApp().settings->Bind(BUFFER_CACHE_SIZE_CHANGED, &REHex::Document::OnBufferCacheSizeChanged, this);
 }
 
 REHex::Document::Document(const FileName &filename):
@@ -102,8 +111,10 @@ REHex::Document::Document(const FileName &filename):
 	}
 	
 	_forward_buffer_events();
+	buffer->set_clean_cache_limit(wxGetApp().settings->get_buffer_cache_size());
 	
 	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
+	wxGetApp().settings->Bind(BUFFER_CACHE_SIZE_CHANGED, &REHex::Document::OnBufferCacheSizeChanged, this);
 }
 
 REHex::Document::Document(std::unique_ptr<Buffer> &&buffer):
@@ -140,8 +151,10 @@ REHex::Document::Document(std::unique_ptr<Buffer> &&buffer):
 	}
 	
 	_forward_buffer_events();
+	this->buffer->set_clean_cache_limit(wxGetApp().settings->get_buffer_cache_size());
 	
 	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
+	wxGetApp().settings->Bind(BUFFER_CACHE_SIZE_CHANGED, &REHex::Document::OnBufferCacheSizeChanged, this);
 }
 
 void REHex::Document::_forward_buffer_events()
@@ -165,6 +178,7 @@ void REHex::Document::_forward_buffer_events()
 
 REHex::Document::~Document()
 {
+	wxGetApp().settings->Unbind(BUFFER_CACHE_SIZE_CHANGED, &REHex::Document::OnBufferCacheSizeChanged, this);
 	wxGetApp().Unbind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
 	delete buffer;
 }
@@ -190,6 +204,7 @@ void REHex::Document::reload()
 	*/
 	
 	Buffer *new_buffer = new Buffer(filename);
+	new_buffer->set_clean_cache_limit(wxGetApp().settings->get_buffer_cache_size());
 	
 	wxGetApp().bulk_updates_freeze();
 	
@@ -279,13 +294,16 @@ void REHex::Document::reload()
 	_raise_clean();
 }
 
-void REHex::Document::save()
+bool REHex::Document::save(const Buffer::WriteProgressFunc &progress)
 {
 	bool externally_changed = file_deleted() || file_modified();
 	
 	if(is_buffer_dirty() || externally_changed)
 	{
-		buffer->write_inplace();
+		if(!buffer->write_inplace(progress))
+		{
+			return false;
+		}
 	}
 	
 	save_metadata_for(buffer->get_filename().GetFullPath().ToStdString());
@@ -298,13 +316,18 @@ void REHex::Document::save()
 		
 		_raise_clean();
 	}
+	
+	return true;
 }
 
-void REHex::Document::save(const FileName &filename)
+bool REHex::Document::save(const FileName &filename, const Buffer::WriteProgressFunc &progress)
 {
 	bool externally_changed = file_deleted() || file_modified();
 	
-	buffer->write_inplace(filename);
+	if(!buffer->write_inplace(filename, progress))
+	{
+		return false;
+	}
 	
 	title = filename.GetFullName().ToStdString();
 	
@@ -321,6 +344,8 @@ void REHex::Document::save(const FileName &filename)
 	
 	DocumentTitleEvent document_title_event(this, title);
 	ProcessEvent(document_title_event);
+	
+	return true;
 }
 
 std::string REHex::Document::get_title()
@@ -389,6 +414,29 @@ bool REHex::Document::is_range_dirty(BitOffset offset, BitOffset length) const
 	return false;
 }
 
+REHex::ByteRangeSet REHex::Document::get_dirty_ranges(off_t offset, off_t length) const
+{
+	ByteRangeSet dirty;
+	
+	off_t end = offset + length;
+	
+	for(
+		ByteRangeMap<unsigned int>::const_iterator ds = data_seq.get_range_in(offset, length);
+		ds != data_seq.end() && ds->first.offset < end;
+		++ds)
+	{
+		if(ds->second != saved_seq)
+		{
+			off_t dirty_begin = std::max(ds->first.offset, offset);
+			off_t dirty_end = std::min((ds->first.offset + ds->first.length), end);
+			
+			dirty.set_range(dirty_begin, (dirty_end - dirty_begin));
+		}
+	}
+	
+	return dirty;
+}
+
 bool REHex::Document::is_buffer_dirty() const
 {
 	return buffer_seq != saved_seq;
@@ -436,7 +484,7 @@ std::vector<unsigned char> REHex::Document::read_data(BitOffset offset, off_t ma
 	return buffer->read_data(offset, max_length);
 }
 
-std::vector<bool> REHex::Document::read_bits(BitOffset offset, size_t max_length) const
+REHex::BitVector REHex::Document::read_bits(BitOffset offset, size_t max_length) const
 {
 	return buffer->read_bits(offset, max_length);
 }
@@ -521,7 +569,7 @@ REHex::Document::TransOpFunc REHex::Document::_op_overwrite_redo(BitOffset offse
 	});
 }
 
-void REHex::Document::overwrite_bits(BitOffset offset, const std::vector<bool> &data, BitOffset new_cursor_pos, CursorState new_cursor_state, const char *change_desc)
+void REHex::Document::overwrite_bits(BitOffset offset, const BitVector &data, BitOffset new_cursor_pos, CursorState new_cursor_state, const char *change_desc)
 {
 	if(write_protect)
 	{
@@ -534,7 +582,7 @@ void REHex::Document::overwrite_bits(BitOffset offset, const std::vector<bool> &
 	
 	TransOpFunc first_op([&]()
 	{
-		std::shared_ptr< std::vector<bool> > old_data(new std::vector<bool>(std::move( read_bits(offset, data.size()) )));
+		std::shared_ptr<BitVector> old_data(new BitVector(std::move( read_bits(offset, data.size()) )));
 		assert(old_data->size() == data.size());
 		
 		ByteRangeMap<unsigned int> new_data_seq_slice = data_seq
@@ -552,11 +600,11 @@ void REHex::Document::overwrite_bits(BitOffset offset, const std::vector<bool> &
 	transact_step(first_op, change_desc);
 }
 
-REHex::Document::TransOpFunc REHex::Document::_op_overwrite_bits_undo(BitOffset offset, std::shared_ptr< std::vector<bool> > old_data, BitOffset new_cursor_pos, CursorState new_cursor_state)
+REHex::Document::TransOpFunc REHex::Document::_op_overwrite_bits_undo(BitOffset offset, std::shared_ptr<BitVector> old_data, BitOffset new_cursor_pos, CursorState new_cursor_state)
 {
 	return TransOpFunc([this, offset, old_data, new_cursor_pos, new_cursor_state]()
 	{
-		std::shared_ptr< std::vector<bool> > new_data(new std::vector<bool>(std::move( read_bits(offset, old_data->size()) )));
+		std::shared_ptr<BitVector> new_data(new BitVector(std::move( read_bits(offset, old_data->size()) )));
 		assert(new_data->size() == old_data->size());
 		
 		ByteRangeMap<unsigned int> new_data_seq_slice = data_seq
@@ -570,11 +618,11 @@ REHex::Document::TransOpFunc REHex::Document::_op_overwrite_bits_undo(BitOffset
 	});
 }
 
-REHex::Document::TransOpFunc REHex::Document::_op_overwrite_bits_redo(BitOffset offset, std::shared_ptr< std::vector<bool> > new_data, BitOffset new_cursor_pos, CursorState new_cursor_state)
+REHex::Document::TransOpFunc REHex::Document::_op_overwrite_bits_redo(BitOffset offset, std::shared_ptr<BitVector> new_data, BitOffset new_cursor_pos, CursorState new_cursor_state)
 {
 	return TransOpFunc([this, offset, new_data, new_cursor_pos, new_cursor_state]()
 	{
-		std::shared_ptr< std::vector<bool> > old_data(new std::vector<bool>(std::move( read_bits(offset, new_data->size()) )));
+		std::shared_ptr<BitVector> old_data(new BitVector(std::move( read_bits(offset, new_data->size()) )));
 		assert(old_data->size() == new_data->size());
 		
 		ByteRangeMap<unsigned int> new_data_seq_slice = data_seq
@@ -1813,7 +1861,7 @@ void REHex::Document::_UNTRACKED_overwrite_data(BitOffset offset, const unsigned
 	}
 }
 
-void REHex::Document::_UNTRACKED_overwrite_bits(BitOffset offset, const std::vector<bool> &data, const ByteRangeMap<unsigned int> &data_seq_slice)
+void REHex::Document::_UNTRACKED_overwrite_bits(BitOffset offset, const BitVector &data, const ByteRangeMap<unsigned int> &data_seq_slice)
 {
 	/* The overwrite events use byte offsets and lengths, there isn't really much reason to
 	 * refactor them for bit alignment, so we just grow the reported length by one when the
@@ -2074,6 +2122,223 @@ REHex::Document::TransOpFunc REHex::Document::_op_tracked_change(const std::func
 	});
 }
 
+REHex::Document::AnnotationSession::AnnotationSession(Document *doc, const std::string &desc):
+	doc(doc),
+	desc(desc) {}
+
+bool REHex::Document::AnnotationSession::set_comment(BitOffset offset, BitOffset length, const Comment &comment)
+{
+	if(offset < BitOffset::ZERO || length < BitOffset::ZERO || !(doc->comments.can_set(offset, length))
+		|| !(pending_comments.can_set(offset, length)))
+	{
+		return false;
+	}
+	
+	pending_comments.set(offset, length, true);
+	
+	comments.emplace_back(BitRangeTreeKey(offset, length), comment);
+	return true;
+}
+
+bool REHex::Document::AnnotationSession::set_data_type(BitOffset offset, BitOffset length, const std::string &type, const json_t *options)
+{
+	if(offset < BitOffset::ZERO || length <= BitOffset::ZERO || (offset + length).byte() > doc->buffer_length())
+	{
+		return false;
+	}
+	
+	types.emplace_back(BitRangeMap<TypeInfo>::Range(offset, length), TypeInfo(type, options));
+	return true;
+}
+
+bool REHex::Document::AnnotationSession::set_highlight(BitOffset offset, BitOffset length, int highlight_colour_idx)
+{
+	if(offset < BitOffset::ZERO || length < BitOffset(0, 1) || (offset + length) > BitOffset(doc->buffer_length(), 0)
+		|| doc->highlight_colour_map.find(highlight_colour_idx) == doc->highlight_colour_map.end())
+	{
+		return false;
+	}
+	
+	highlights.emplace_back(BitRangeMap<int>::Range(offset, length), highlight_colour_idx);
+	return true;
+}
+
+bool REHex::Document::AnnotationSession::set_virt_mapping(off_t real_offset, off_t virt_offset, off_t length)
+{
+	if(doc->real_to_virt_segs.get_range_in(real_offset, length) != doc->real_to_virt_segs.end()
+		|| doc->virt_to_real_segs.get_range_in(virt_offset, length) != doc->virt_to_real_segs.end())
+	{
+		return false;
+	}
+	
+	auto overlaps = [](const std::map<off_t, off_t> &pending, off_t offset, off_t length)
+	{
+		auto next = pending.upper_bound(offset);
+		
+		if(next != pending.begin() && std::prev(next)->second > offset)
+		{
+			return true;
+		}
+		
+		return next != pending.end() && next->first < (offset + length);
+	};
+	
+	if(overlaps(pending_real, real_offset, length) || overlaps(pending_virt, virt_offset, length))
+	{
+		return false;
+	}
+	
+	pending_real.emplace(real_offset, (real_offset + length));
+	pending_virt.emplace(virt_offset, (virt_offset + length));
+	
+	real_to_virt_segs.emplace_back(ByteRangeMap<off_t>::Range(real_offset, length), virt_offset);
+	return true;
+}
+
+size_t REHex::Document::AnnotationSession::size() const
+{
+	return comments.size() + highlights.size() + types.size() + real_to_virt_segs.size();
+}
+
+void REHex::Document::AnnotationSession::commit()
+{
+	PROFILE_BLOCK("REHex::Document::AnnotationSession::commit");
+	
+	if(size() == 0)
+	{
+		return;
+	}
+	
+	struct Annotations
+	{
+		std::vector< std::pair<BitRangeTreeKey, Comment> > comments;
+		std::vector< std::pair<BitRangeMap<int>::Range, int> > highlights;
+		std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > types;
+		std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > real_to_virt_segs;
+		std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > virt_to_real_segs;
+	};
+	
+	std::shared_ptr<Annotations> a = std::make_shared<Annotations>();
+	
+	/* Sort the comments so that any comments are inserted before the ones nested within
+	 * them, which means each insertion only appends to the end of its parent, with any
+	 * comments set more than once leaving only the last one.
+	*/
+	
+	std::stable_sort(comments.begin(), comments.end(),
+		[](const std::pair<BitRangeTreeKey, Comment> &a, const std::pair<BitRangeTreeKey, Comment> &b)
+		{
+			if(a.first.offset != b.first.offset)
+			{
+				return a.first.offset < b.first.offset;
+			}
+			else{
+				return a.first.length > b.first.length;
+			}
+		});
+	
+	a->comments.reserve(comments.size());
+	
+	for(auto c = comments.begin(); c != comments.end(); ++c)
+	{
+		if(!(a->comments.empty()) && a->comments.back().first == c->first)
+		{
+			a->comments.back().second = std::move(c->second);
+		}
+		else{
+			a->comments.push_back(std::move(*c));
+		}
+	}
+	
+	a->highlights = std::move(highlights);
+	a->types = std::move(types);
+	
+	/* Mappings can't overlap each other, so their order doesn't matter. */
+	
+	std::sort(real_to_virt_segs.begin(), real_to_virt_segs.end(),
+		[](const std::pair<ByteRangeMap<off_t>::Range, off_t> &a, const std::pair<ByteRangeMap<off_t>::Range, off_t> &b)
+		{
+			return a.first.offset < b.first.offset;
+		});
+	
+	a->virt_to_real_segs.reserve(real_to_virt_segs.size());
+	
+	for(auto s = real_to_virt_segs.begin(); s != real_to_virt_segs.end(); ++s)
+	{
+		a->virt_to_real_segs.emplace_back(ByteRangeMap<off_t>::Range(s->second, s->first.length), s->first.offset);
+	}
+	
+	std::sort(a->virt_to_real_segs.begin(), a->virt_to_real_segs.end(),
+		[](const std::pair<ByteRangeMap<off_t>::Range, off_t> &a, const std::pair<ByteRangeMap<off_t>::Range, off_t> &b)
+		{
+			return a.first.offset < b.first.offset;
+		});
+	
+	a->real_to_virt_segs = std::move(real_to_virt_segs);
+	
+	comments.clear();
+	pending_comments.clear();
+	highlights.clear();
+	types.clear();
+	real_to_virt_segs.clear();
+	pending_real.clear();
+	pending_virt.clear();
+	
+	Document *doc = this->doc;
+	
+	doc->_tracked_change(desc.c_str(),
+		[doc, a]()
+		{
+			if(!(a->comments.empty()))
+			{
+				for(auto c = a->comments.begin(); c != a->comments.end(); ++c)
+				{
+					/* Fails if the Document gained a comment this one straddles
+					 * after it was queued.
+					*/
+					doc->comments.set(c->first.offset, c->first.length, c->second);
+				}
+				
+				doc->_raise_comment_modified();
+			}
+			
+			if(!(a->highlights.empty()))
+			{
+				doc->highlights.set_bulk(std::vector< std::pair<BitRangeMap<int>::Range, int> >(a->highlights));
+				doc->_raise_highlights_changed();
+			}
+			
+			if(!(a->types.empty()))
+			{
+				doc->types.set_bulk(std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> >(a->types));
+				doc->_raise_types_changed();
+			}
+			
+			if(!(a->real_to_virt_segs.empty()))
+			{
+				doc->real_to_virt_segs.set_bulk(std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> >(a->real_to_virt_segs));
+				doc->virt_to_real_segs.set_bulk(std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> >(a->virt_to_real_segs));
+				
+				doc->_raise_mappings_changed();
+			}
+		},
+		
+		[doc, a]()
+		{
+			/* Annotations are restored implicitly. */
+			
+			if(!(a->comments.empty()))
+			{
+				doc->_raise_comment_modified();
+			}
+			
+			if(!(a->highlights.empty()))
+			{
+				doc->_raise_highlights_changed();
+			}
+		});
+}
+
 json_t *REHex::Document::serialise_metadata(bool even_if_empty) const
 {
 	bool has_data = even_if_empty;
@@ -2110,7 +2375,8 @@ json_t *REHex::Document::serialise_metadata(bool even_if_empty) const
 		if(json_array_append_new(comments, comment) == -1
 			|| json_object_set_new(comment, "offset", c->first.offset.to_json()) == -1
 			|| json_object_set_new(comment, "length", c->first.length.to_json()) == -1
-			|| json_object_set_new(comment, "text",   json_stringn(utf8_text.data(), utf8_text.length())) == -1)
+			|| json_object_set_new(comment, "text",   json_stringn(utf8_text.data(), utf8_text.length())) == -1
+			|| (c->second.array && json_object_set_new(comment, "array", c->second.array->to_json()) == -1))
 		{
 			json_decref(root);
 			return NULL;
@@ -2229,11 +2495,16 @@ void REHex::Document::save_metadata_for(const std::string &filename)
 {
 	/* TODO: Atomically replace file. */
 	
-	json_t *meta = serialise_metadata(false);
+	/* Large sets of metadata are written in the binary format straight from the Document,
+	 * so don't waste time building a JSON tree of them first.
+	*/
+	bool binary = (comments.size() + highlights.size() + types.size()) >= BINARY_METADATA_THRESHOLD;
+	
+	json_t *meta = binary ? NULL : serialise_metadata(false);
 	int res = 0;
-	if (meta != NULL)
+	if (binary || meta != NULL)
 	{
-		res = json_dump_file(meta, (filename + ".rehex-meta").c_str(), JSON_INDENT(2));
+		res = _save_metadata_file((filename + ".rehex-meta"), meta) ? 0 : -1;
 		
 #ifdef __APPLE__
 		std::string sandbox = App::get_home_directory();
@@ -2259,7 +2530,7 @@ void REHex::Document::save_metadata_for(const std::string &filename)
 			*/
 			
 			recursive_mkdir(fn.GetPath().ToStdString());
-			res = json_dump_file(meta, fn.GetFullPath().ToStdString().c_str(), JSON_INDENT(2));
+			res = _save_metadata_file(fn.GetFullPath().ToStdString(), meta) ? 0 : -1;
 		}
 #endif
 	}
@@ -2278,112 +2549,894 @@ void REHex::Document::save_metadata_for(const std::string &filename)
 	}
 }
 
-REHex::BitRangeTree<REHex::Document::Comment> REHex::Document::_load_comments(const json_t *meta, off_t buffer_length)
+bool REHex::Document::_save_metadata_file(const std::string &filename, const json_t *meta) const
 {
-	BitRangeTree<Comment> comments;
-	
-	json_t *j_comments = json_object_get(meta, "comments");
-	
-	size_t index;
-	json_t *value;
-	
-	json_array_foreach(j_comments, index, value)
+	if(meta == NULL)
 	{
-		if(!json_is_string(json_object_get(value, "text")))
-		{
-			continue;
+		try {
+			save_metadata_binary(filename);
+			return true;
 		}
-		
-		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
-		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
-		wxString text = wxString::FromUTF8(json_string_value(json_object_get(value, "text")));
-		
-		if(offset >= BitOffset::ZERO && offset < BitOffset(buffer_length, 0)
-			&& length >= BitOffset::ZERO && (offset + length) <= BitOffset(buffer_length, 0))
+		catch(const std::exception&)
 		{
-			comments.set(offset, length, Comment(text));
+			return false;
 		}
 	}
-	
-	return comments;
-}
-
-REHex::BitRangeMap<int> REHex::Document::_load_highlights(const json_t *meta, off_t buffer_length, const HighlightColourMap &highlight_colour_map)
-{
-	BitRangeMap<int> highlights;
-	
-	json_t *j_highlights = json_object_get(meta, "highlights");
-	
-	size_t index;
-	json_t *value;
-	
-	json_array_foreach(j_highlights, index, value)
-	{
-		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
-		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
-		int       colour = json_integer_value(json_object_get(value, "colour-idx"));
-		
-		if(offset >= 0 && offset < BitOffset(buffer_length, 0)
-			&& length > 0 && (offset + length) <= BitOffset(buffer_length, 0)
-			&& highlight_colour_map.find(colour) != highlight_colour_map.end())
-		{
-			highlights.set_range(offset, length, colour);
-		}
+	else{
+		return json_dump_file(meta, filename.c_str(), JSON_INDENT(2)) == 0;
 	}
-	
-	return highlights;
 }
 
-REHex::BitRangeMap<REHex::Document::TypeInfo> REHex::Document::_load_types(const json_t *meta, off_t buffer_length)
+/* The binary metadata format is a sequence of TLV records (see FileWriter::write_tlv()).
+ *
+ * The first record is always RXMD, which contains the format version as a 32-bit
+ * little endian integer. Any unknown records are skipped when loading.
+ *
+ * Comment text, data type names and data type options are stored once each in STRS
+ * records and referred to by their index, so millions of identical comments or types
+ * generated by a template don't take up any more space than their offsets.
+ *
+ * The CMNT, HLIT, TYPE and VMAP records each hold a series of entries. Integers are
+ * encoded as LEB128 varints, signed ones zigzag encoded first. The offset of each
+ * entry is stored as the difference from the previous entry in the same record.
+ *
+ * Large sets of entries are split into multiple records of roughly
+ * BINARY_METADATA_CHUNK_SIZE bytes, so they can be streamed in without loading the
+ * whole file into memory and never exceed the 32-bit length in a TLV header.
+ *
+ * Sections aren't loaded lazily: the comments, highlights and data types are all
+ * needed as soon as the document is displayed (to build the comment tree and the
+ * regions in DocumentCtrl), so deferring any of them would only delay the cost
+ * until the file has been opened. Streaming the records one at a time instead
+ * keeps the memory needed to load a file bounded by the decoded metadata.
+ *
+ * RXMD  u32 version
+ * WPRT  u8  write protect flag
+ * HCOL  highlight colour map as JSON
+ * STRS  { varint length, UTF-8 data }...
+ * CMNT  { svarint offset delta (bits), varint length (bits), varint text index, varint (array layout index + 1) or 0 }...
+ * HLIT  { svarint offset delta (bits), varint length (bits), varint colour index }...
+ * TYPE  { svarint offset delta (bits), varint length (bits), varint name index, varint (options index + 1) or 0 }...
+ * VMAP  { svarint real offset delta, varint length, svarint (virtual offset - real offset) }...
+ *
+ * Array layouts are stored in the string table as JSON. Version 1 files don't have the
+ * array layout index in CMNT entries.
+*/
+
+static const uint32_t BINARY_METADATA_VERSION = 2;
+static const size_t BINARY_METADATA_CHUNK_SIZE = 1024 * 1024; /* 1MiB */
+
+namespace
 {
-	BitRangeMap<TypeInfo> types;
-	types.set_range(BitOffset(0, 0), BitOffset(buffer_length, 0), TypeInfo(""));
-	
-	json_t *j_types = json_object_get(meta, "data_types");
-	
-	size_t index;
-	json_t *value;
-	
-	json_array_foreach(j_types, index, value)
+	/**
+	 * @brief Encodes entries for one type of binary metadata record.
+	*/
+	class MetadataRecordWriter
 	{
-		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
-		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
-		const char *type_name = json_string_value(json_object_get(value, "type"));
-		json_t *options  = json_object_get(value, "options");
-		
-		if(offset >= BitOffset::ZERO && offset < BitOffset(buffer_length, 0)
-			&& length > BitOffset::ZERO && (offset + length) <= BitOffset(buffer_length, 0)
-			&& type_name != NULL)
-		{
-			std::shared_ptr<const DataType> type;
-			try {
-				type = DataTypeRegistry::get_type(type_name, options);
-				if(type == NULL)
+		private:
+			std::list< std::vector<unsigned char> > chunks;
+			int64_t prev_offset;
+			
+		public:
+			MetadataRecordWriter():
+				prev_offset(0) {}
+			
+			/**
+			 * @brief Start a new entry, beginning a new record if the current one is full.
+			*/
+			void begin_entry()
+			{
+				if(chunks.empty() || chunks.back().size() >= BINARY_METADATA_CHUNK_SIZE)
 				{
-					wxGetApp().printf_error("Ignoring unknown data type '%s' in metadata\n", type_name);
+					chunks.emplace_back();
+					chunks.back().reserve(BINARY_METADATA_CHUNK_SIZE + 64);
+					
+					prev_offset = 0;
 				}
 			}
-			catch(const std::invalid_argument &e)
+			
+			/**
+			 * @brief Start a new entry and write its (delta encoded) offset.
+			*/
+			void begin_entry(int64_t offset)
 			{
-				wxGetApp().printf_error("Ignoring data type with invalid options (%s) in metadata\n", e.what());
+				begin_entry();
+				
+				put_svarint((uint64_t)(offset) - (uint64_t)(prev_offset));
+				prev_offset = offset;
 			}
 			
-			if(type)
+			void put_varint(uint64_t value)
 			{
-				types.set_range(offset, length, TypeInfo(type_name, options));
+				std::vector<unsigned char> &chunk = chunks.back();
+				
+				while(value >= 0x80)
+				{
+					chunk.push_back((value & 0x7F) | 0x80);
+					value >>= 7;
+				}
+				
+				chunk.push_back(value);
 			}
-		}
-	}
-	
-	return types;
-}
-
-std::pair< REHex::ByteRangeMap<off_t>, REHex::ByteRangeMap<off_t> > REHex::Document::_load_virt_mappings(const json_t *meta, off_t buffer_length)
-{
-	ByteRangeMap<off_t> real_to_virt_segs;
-	ByteRangeMap<off_t> virt_to_real_segs;
-	
-	json_t *j_mappings = json_object_get(meta, "virt_mappings");
+			
+			void put_svarint(int64_t value)
+			{
+				put_varint(((uint64_t)(value) << 1) ^ (uint64_t)(value >> 63));
+			}
+			
+			void put_bytes(const void *data, size_t size)
+			{
+				std::vector<unsigned char> &chunk = chunks.back();
+				chunk.insert(chunk.end(), (const unsigned char*)(data), ((const unsigned char*)(data) + size));
+			}
+			
+			void write_records(REHex::FileWriter &file, const REHex::FourCC &type) const
+			{
+				for(auto c = chunks.begin(); c != chunks.end(); ++c)
+				{
+					file.write_tlv(type, c->data(), c->size());
+				}
+			}
+	};
+	
+	/**
+	 * @brief Assigns indices to strings in the order they are first seen.
+	*/
+	class MetadataStringTable
+	{
+		private:
+			std::unordered_map<std::string, uint64_t> indices;
+			MetadataRecordWriter writer;
+			
+		public:
+			uint64_t get_index(const std::string &string)
+			{
+				auto i = indices.find(string);
+				if(i != indices.end())
+				{
+					return i->second;
+				}
+				
+				uint64_t index = indices.size();
+				indices.emplace(string, index);
+				
+				writer.begin_entry();
+				writer.put_varint(string.length());
+				writer.put_bytes(string.data(), string.length());
+				
+				return index;
+			}
+			
+			void write_records(REHex::FileWriter &file) const
+			{
+				writer.write_records(file, "STRS");
+			}
+	};
+	
+	/**
+	 * @brief Decodes the entries in one binary metadata record.
+	*/
+	class MetadataRecordReader
+	{
+		private:
+			const unsigned char *p;
+			const unsigned char *end;
+			int64_t prev_offset;
+			
+		public:
+			MetadataRecordReader(const std::vector<unsigned char> &record):
+				p(record.data()), end(record.data() + record.size()), prev_offset(0) {}
+			
+			bool eof() const
+			{
+				return p == end;
+			}
+			
+			int64_t get_offset()
+			{
+				/* Wrap rather than overflow on a corrupt delta, the caller bounds checks the result. */
+				prev_offset = (uint64_t)(prev_offset) + (uint64_t)(get_svarint());
+				return prev_offset;
+			}
+			
+			uint64_t get_varint()
+			{
+				uint64_t value = 0;
+				
+				for(unsigned int shift = 0; shift < 64; shift += 7)
+				{
+					if(p == end)
+					{
+						throw std::runtime_error("Truncated entry in metadata file");
+					}
+					
+					unsigned char byte = *(p++);
+					value |= (uint64_t)(byte & 0x7F) << shift;
+					
+					if((byte & 0x80) == 0)
+					{
+						return value;
+					}
+				}
+				
+				throw std::runtime_error("Malformed integer in metadata file");
+			}
+			
+			int64_t get_svarint()
+			{
+				uint64_t value = get_varint();
+				return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+			}
+			
+			std::string get_string()
+			{
+				uint64_t length = get_varint();
+				if(length > (uint64_t)(end - p))
+				{
+					throw std::runtime_error("Truncated string in metadata file");
+				}
+				
+				std::string string((const char*)(p), length);
+				p += length;
+				
+				return string;
+			}
+	};
+}
+
+static REHex::BitOffset bits_to_offset(int64_t bits)
+{
+	return REHex::BitOffset((bits / 8), (bits % 8));
+}
+
+/* Array layouts are stored as compact JSON strings in the binary metadata and in the
+ * clipboard, rather than having an encoding of their own.
+*/
+
+static std::string array_layout_to_string(const REHex::Document::Comment::ArrayLayout &layout)
+{
+	std::unique_ptr<json_t, void(*)(json_t*)> j_layout(layout.to_json(), json_decref);
+	
+	char *layout_json = j_layout != NULL ? json_dumps(j_layout.get(), JSON_COMPACT) : NULL;
+	if(layout_json == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	
+	std::string s(layout_json);
+	free(layout_json);
+	
+	return s;
+}
+
+static std::shared_ptr<const REHex::Document::Comment::ArrayLayout> array_layout_from_string(const char *data, size_t length)
+{
+	json_error_t json_err;
+	std::unique_ptr<json_t, void(*)(json_t*)> j_layout(json_loadb(data, length, 0, &json_err), json_decref);
+	
+	return j_layout != NULL
+		? REHex::Document::Comment::ArrayLayout::from_json(j_layout.get())
+		: NULL;
+}
+
+void REHex::Document::save_metadata_binary(const std::string &filename) const
+{
+	MetadataStringTable strings;
+	
+	/* Every comment generated by the same template struct shares one ArrayLayout, so
+	 * we only serialise each one the first time we see it.
+	*/
+	std::unordered_map<const Comment::ArrayLayout*, uint64_t> array_indices;
+	
+	MetadataRecordWriter comment_records;
+	for(auto c = comments.begin(); c != comments.end(); ++c)
+	{
+		const wxScopedCharBuffer utf8_text = c->second.text->utf8_str();
+		
+		comment_records.begin_entry(c->first.offset.total_bits());
+		comment_records.put_varint(c->first.length.total_bits());
+		comment_records.put_varint(strings.get_index(std::string(utf8_text.data(), utf8_text.length())));
+		
+		if(c->second.array)
+		{
+			auto ai = array_indices.find(c->second.array.get());
+			if(ai == array_indices.end())
+			{
+				uint64_t array_idx = strings.get_index(array_layout_to_string(*(c->second.array)));
+				ai = array_indices.emplace(c->second.array.get(), array_idx).first;
+			}
+			
+			comment_records.put_varint(ai->second + 1);
+		}
+		else{
+			comment_records.put_varint(0);
+		}
+	}
+	
+	MetadataRecordWriter highlight_records;
+	for(auto h = highlights.begin(); h != highlights.end(); ++h)
+	{
+		highlight_records.begin_entry(h->first.offset.total_bits());
+		highlight_records.put_varint(h->first.length.total_bits());
+		highlight_records.put_varint(h->second);
+	}
+	
+	MetadataRecordWriter type_records;
+	for(auto dt = types.begin(); dt != types.end(); ++dt)
+	{
+		if(dt->second.name == "")
+		{
+			/* Don't bother serialising "this is data" */
+			continue;
+		}
+		
+		type_records.begin_entry(dt->first.offset.total_bits());
+		type_records.put_varint(dt->first.length.total_bits());
+		type_records.put_varint(strings.get_index(dt->second.name));
+		
+		if(dt->second.options != NULL)
+		{
+			char *options = json_dumps(dt->second.options, JSON_COMPACT | JSON_SORT_KEYS | JSON_ENCODE_ANY);
+			if(options == NULL)
+			{
+				throw std::bad_alloc();
+			}
+			
+			uint64_t options_idx = strings.get_index(options);
+			free(options);
+			
+			type_records.put_varint(options_idx + 1);
+		}
+		else{
+			type_records.put_varint(0);
+		}
+	}
+	
+	MetadataRecordWriter mapping_records;
+	for(auto r2v = real_to_virt_segs.begin(); r2v != real_to_virt_segs.end(); ++r2v)
+	{
+		mapping_records.begin_entry(r2v->first.offset);
+		mapping_records.put_varint(r2v->first.length);
+		mapping_records.put_svarint(r2v->second - r2v->first.offset);
+	}
+	
+	FileWriter file(filename.c_str());
+	
+	uint32_t version = htole32(BINARY_METADATA_VERSION);
+	file.write_tlv("RXMD", &version, sizeof(version));
+	
+	uint8_t write_protect_flag = this->write_protect;
+	file.write_tlv("WPRT", &write_protect_flag, sizeof(write_protect_flag));
+	
+	json_t *highlight_colours = highlight_colour_map.to_json();
+	char *highlight_colours_json = json_dumps(highlight_colours, JSON_COMPACT);
+	json_decref(highlight_colours);
+	
+	if(highlight_colours_json == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	
+	file.write_tlv("HCOL", highlight_colours_json, strlen(highlight_colours_json));
+	free(highlight_colours_json);
+	
+	strings.write_records(file);
+	
+	comment_records.write_records(file, "CMNT");
+	highlight_records.write_records(file, "HLIT");
+	type_records.write_records(file, "TYPE");
+	mapping_records.write_records(file, "VMAP");
+	
+	file.commit();
+}
+
+bool REHex::Document::_is_binary_metadata(const std::string &filename)
+{
+	FileReader file(filename.c_str());
+	
+	char magic[4];
+	size_t magic_len = file.read(magic, sizeof(magic), 0);
+	
+	return magic_len == sizeof(magic) && memcmp(magic, "RXMD", sizeof(magic)) == 0;
+}
+
+void REHex::Document::_load_binary_metadata(const std::string &filename)
+{
+	off_t buffer_length = this->buffer_length();
+	BitOffset buffer_end(buffer_length, 0);
+	
+	bool new_write_protect = false;
+	HighlightColourMap new_highlight_colour_map = highlight_colour_map;
+	
+	BitRangeTree<Comment> new_comments;
+	std::vector< std::pair<BitRangeMap<int>::Range, int> > bulk_highlights;
+	std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > bulk_types;
+	ByteRangeMap<off_t> new_real_to_virt_segs;
+	ByteRangeMap<off_t> new_virt_to_real_segs;
+	
+	/* Strings are only converted to the form they are needed in once, the first time
+	 * they are referenced, and then shared between every entry referencing them.
+	*/
+	
+	std::vector<std::string> strings;
+	std::vector< std::shared_ptr<const wxString> > comment_texts;
+	
+	auto get_string = [&](uint64_t index) -> const std::string&
+	{
+		if(index >= strings.size())
+		{
+			throw std::runtime_error("Invalid string index in metadata file");
+		}
+		
+		return strings[index];
+	};
+	
+	auto get_comment_text = [&](uint64_t index)
+	{
+		const std::string &utf8_text = get_string(index);
+		
+		if(comment_texts.size() <= index)
+		{
+			comment_texts.resize(index + 1);
+		}
+		
+		if(!comment_texts[index])
+		{
+			comment_texts[index] = std::make_shared<const wxString>(wxString::FromUTF8(utf8_text.data(), utf8_text.length()));
+		}
+		
+		return comment_texts[index];
+	};
+	
+	/* A comment with an invalid array layout is kept as a plain comment. */
+	
+	std::unordered_map< uint64_t, std::shared_ptr<const ArrayLayout> > array_layouts;
+	
+	auto get_array_layout = [&](uint64_t index) -> std::shared_ptr<const ArrayLayout>
+	{
+		auto i = array_layouts.find(index);
+		if(i == array_layouts.end())
+		{
+			const std::string &layout_json = get_string(index);
+			i = array_layouts.emplace(index, array_layout_from_string(layout_json.data(), layout_json.length())).first;
+		}
+		
+		return i->second;
+	};
+	
+	/* Validating a data type is relatively expensive, so we only check each distinct
+	 * combination of type name and options once.
+	*/
+	
+	struct TypeCacheEntry
+	{
+		bool valid;
+		TypeInfo type;
+		
+		TypeCacheEntry(bool valid, TypeInfo &&type):
+			valid(valid), type(std::move(type)) {}
+	};
+	
+	std::map< std::pair<uint64_t, uint64_t>, TypeCacheEntry > type_cache;
+	
+	auto get_type = [&](uint64_t name_idx, uint64_t options_idx) -> const TypeCacheEntry&
+	{
+		auto cache_key = std::make_pair(name_idx, options_idx);
+		
+		auto i = type_cache.find(cache_key);
+		if(i != type_cache.end())
+		{
+			return i->second;
+		}
+		
+		const std::string &type_name = get_string(name_idx);
+		
+		std::unique_ptr<json_t, void(*)(json_t*)> options(NULL, json_decref);
+		if(options_idx > 0)
+		{
+			const std::string &options_json = get_string(options_idx - 1);
+			
+			json_error_t json_err;
+			options.reset(json_loadb(options_json.data(), options_json.length(), JSON_DECODE_ANY, &json_err));
+			
+			if(options == NULL)
+			{
+				throw std::runtime_error(std::string("Invalid data type options in metadata file: ") + json_err.text);
+			}
+		}
+		
+		bool valid = false;
+		
+		try {
+			valid = DataTypeRegistry::get_type(type_name, options.get()) != NULL;
+			if(!valid)
+			{
+				wxGetApp().printf_error("Ignoring unknown data type '%s' in metadata\n", type_name.c_str());
+			}
+		}
+		catch(const std::invalid_argument &e)
+		{
+			wxGetApp().printf_error("Ignoring data type with invalid options (%s) in metadata\n", e.what());
+		}
+		
+		return type_cache.emplace(cache_key, TypeCacheEntry(valid, TypeInfo(type_name, options.get()))).first->second;
+	};
+	
+	FileReader file(filename.c_str());
+	bool seen_header = false;
+	uint32_t version = 0;
+	
+	std::vector<unsigned char> record;
+	
+	while(file.read_tlv([&](const FourCC &type, uint32_t length)
+	{
+		if(!seen_header)
+		{
+			if(type != FourCC("RXMD") || length < sizeof(uint32_t))
+			{
+				throw std::runtime_error("Not a binary metadata file");
+			}
+			
+			version = le32toh(file.read<uint32_t>());
+			if(version > BINARY_METADATA_VERSION)
+			{
+				throw std::runtime_error("Metadata file was written by a newer version");
+			}
+			
+			seen_header = true;
+			return;
+		}
+		
+		static const FourCC KNOWN_TYPES[] = { "WPRT", "HCOL", "STRS", "CMNT", "HLIT", "TYPE", "VMAP" };
+		if(std::find(std::begin(KNOWN_TYPES), std::end(KNOWN_TYPES), type) == std::end(KNOWN_TYPES))
+		{
+			/* Unknown record, skip it. */
+			return;
+		}
+		
+		record.resize(length);
+		file.read(record.data(), length, length);
+		
+		MetadataRecordReader reader(record);
+		
+		if(type == FourCC("WPRT"))
+		{
+			new_write_protect = length > 0 && record[0] != 0;
+		}
+		else if(type == FourCC("HCOL"))
+		{
+			json_error_t json_err;
+			std::unique_ptr<json_t, void(*)(json_t*)> highlight_colours(json_loadb((const char*)(record.data()), record.size(), 0, &json_err), json_decref);
+			
+			if(highlight_colours == NULL)
+			{
+				throw std::runtime_error(std::string("Invalid highlight colours in metadata file: ") + json_err.text);
+			}
+			
+			new_highlight_colour_map = HighlightColourMap::from_json(highlight_colours.get());
+		}
+		else if(type == FourCC("STRS"))
+		{
+			while(!reader.eof())
+			{
+				strings.push_back(reader.get_string());
+			}
+		}
+		else if(type == FourCC("CMNT"))
+		{
+			while(!reader.eof())
+			{
+				int64_t offset = reader.get_offset();
+				uint64_t entry_length = reader.get_varint();
+				uint64_t text_idx = reader.get_varint();
+				uint64_t array_idx = version >= 2 ? reader.get_varint() : 0;
+				
+				Comment comment(get_comment_text(text_idx));
+				if(array_idx > 0)
+				{
+					comment.array = get_array_layout(array_idx - 1);
+				}
+				
+				if(offset >= 0 && bits_to_offset(offset) < buffer_end
+					&& entry_length <= (uint64_t)(buffer_end.total_bits() - offset))
+				{
+					new_comments.set(bits_to_offset(offset), bits_to_offset(entry_length), comment);
+				}
+			}
+		}
+		else if(type == FourCC("HLIT"))
+		{
+			while(!reader.eof())
+			{
+				int64_t offset = reader.get_offset();
+				uint64_t entry_length = reader.get_varint();
+				uint64_t colour = reader.get_varint();
+				
+				if(offset >= 0 && bits_to_offset(offset) < buffer_end
+					&& entry_length > 0 && entry_length <= (uint64_t)(buffer_end.total_bits() - offset)
+					&& colour <= (uint64_t)(std::numeric_limits<int>::max())
+					&& new_highlight_colour_map.find(colour) != new_highlight_colour_map.end())
+				{
+					bulk_highlights.emplace_back(BitRangeMap<int>::Range(bits_to_offset(offset), bits_to_offset(entry_length)), colour);
+				}
+			}
+		}
+		else if(type == FourCC("TYPE"))
+		{
+			while(!reader.eof())
+			{
+				int64_t offset = reader.get_offset();
+				uint64_t entry_length = reader.get_varint();
+				uint64_t name_idx = reader.get_varint();
+				uint64_t options_idx = reader.get_varint();
+				
+				const TypeCacheEntry &type_entry = get_type(name_idx, options_idx);
+				
+				if(type_entry.valid
+					&& offset >= 0 && bits_to_offset(offset) < buffer_end
+					&& entry_length > 0 && entry_length <= (uint64_t)(buffer_end.total_bits() - offset))
+				{
+					bulk_types.emplace_back(BitRangeMap<TypeInfo>::Range(bits_to_offset(offset), bits_to_offset(entry_length)), type_entry.type);
+				}
+			}
+		}
+		else if(type == FourCC("VMAP"))
+		{
+			while(!reader.eof())
+			{
+				int64_t real_offset = reader.get_offset();
+				int64_t entry_length = reader.get_varint();
+				int64_t virt_offset = real_offset + reader.get_svarint();
+				
+				if(real_offset >= 0 && real_offset < buffer_length
+					&& entry_length > 0 && entry_length <= (buffer_length - real_offset)
+					&& new_real_to_virt_segs.get_range_in(real_offset, entry_length) == new_real_to_virt_segs.end()
+					&& new_virt_to_real_segs.get_range_in(virt_offset, entry_length) == new_virt_to_real_segs.end())
+				{
+					new_real_to_virt_segs.set_range(real_offset, entry_length, virt_offset);
+					new_virt_to_real_segs.set_range(virt_offset, entry_length, real_offset);
+				}
+			}
+		}
+	})) {}
+	
+	if(!seen_header)
+	{
+		throw std::runtime_error("Not a binary metadata file");
+	}
+	
+	BitRangeMap<int> new_highlights;
+	new_highlights.set_bulk(std::move(bulk_highlights));
+	
+	BitRangeMap<TypeInfo> new_types = _build_types(std::move(bulk_types), buffer_length);
+	
+	/* Everything was loaded successfully, replace the current metadata. */
+	
+	comments = std::move(new_comments);
+	highlight_colour_map = std::move(new_highlight_colour_map);
+	highlights = std::move(new_highlights);
+	types = std::move(new_types);
+	real_to_virt_segs = std::move(new_real_to_virt_segs);
+	virt_to_real_segs = std::move(new_virt_to_real_segs);
+	
+	set_write_protect(new_write_protect);
+}
+
+REHex::BitRangeTree<REHex::Document::Comment> REHex::Document::_load_comments(const json_t *meta, off_t buffer_length)
+{
+	json_t *j_comments = json_object_get(meta, "comments");
+	
+	struct PendingComment
+	{
+		BitOffset offset;
+		BitOffset length;
+		
+		const char *utf8_text;
+		std::shared_ptr<const wxString> text;
+		
+		std::shared_ptr<const ArrayLayout> array;
+		
+		PendingComment(BitOffset offset, BitOffset length, const char *utf8_text, const std::shared_ptr<const ArrayLayout> &array):
+			offset(offset), length(length), utf8_text(utf8_text), array(array) {}
+	};
+	
+	std::vector<PendingComment> pending;
+	pending.reserve(json_array_size(j_comments));
+	
+	size_t index;
+	json_t *value;
+	
+	json_array_foreach(j_comments, index, value)
+	{
+		if(!json_is_string(json_object_get(value, "text")))
+		{
+			continue;
+		}
+		
+		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
+		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
+		
+		/* A comment with an invalid array layout is kept as a plain comment. */
+		json_t *j_array = json_object_get(value, "array");
+		std::shared_ptr<const ArrayLayout> array = j_array != NULL
+			? ArrayLayout::from_json(j_array)
+			: NULL;
+		
+		if(offset >= BitOffset::ZERO && offset < BitOffset(buffer_length, 0)
+			&& length >= BitOffset::ZERO && (offset + length) <= BitOffset(buffer_length, 0))
+		{
+			pending.emplace_back(offset, length, json_string_value(json_object_get(value, "text")), array);
+		}
+	}
+	
+	/* Decoding the comment text is the most expensive part of loading a heavily annotated
+	 * file, so spread it over the thread pool when there is enough of it.
+	*/
+	
+	auto convert_block = [&](size_t base, size_t end)
+	{
+		for(size_t i = base; i < end; ++i)
+		{
+			pending[i].text = std::make_shared<const wxString>(wxString::FromUTF8(pending[i].utf8_text));
+		}
+	};
+	
+	if(pending.size() >= LOAD_COMMENTS_THREAD_MIN)
+	{
+		static const size_t COMMENTS_PER_CHUNK = 1000;
+		std::atomic<size_t> next_chunk(0);
+		
+		ThreadPool::TaskHandle task = wxGetApp().thread_pool->queue_task([&]()
+		{
+			size_t base = next_chunk.fetch_add(COMMENTS_PER_CHUNK);
+			size_t end = std::min((base + COMMENTS_PER_CHUNK), pending.size());
+			
+			convert_block(base, end);
+			
+			return base >= pending.size();
+		}, -1, ThreadPool::TaskPriority::UI);
+		
+		task.join();
+	}
+	else{
+		convert_block(0, pending.size());
+	}
+	
+	/* Comments are saved in depth-first order, so the tree can be built in a single pass
+	 * (files which have been edited by hand fall back to inserting them one at a time).
+	*/
+	
+	std::vector< std::pair<BitRangeTreeKey, Comment> > sorted_comments;
+	sorted_comments.reserve(pending.size());
+	
+	for(auto c = pending.begin(); c != pending.end(); ++c)
+	{
+		Comment comment(c->text);
+		comment.array = c->array;
+		
+		sorted_comments.push_back(std::make_pair(BitRangeTreeKey(c->offset, c->length), comment));
+	}
+	
+	return BitRangeTree<Comment>(sorted_comments.begin(), sorted_comments.end());
+}
+
+REHex::BitRangeMap<int> REHex::Document::_load_highlights(const json_t *meta, off_t buffer_length, const HighlightColourMap &highlight_colour_map)
+{
+	json_t *j_highlights = json_object_get(meta, "highlights");
+	
+	std::vector< std::pair<BitRangeMap<int>::Range, int> > bulk_highlights;
+	bulk_highlights.reserve(json_array_size(j_highlights));
+	
+	size_t index;
+	json_t *value;
+	
+	json_array_foreach(j_highlights, index, value)
+	{
+		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
+		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
+		int       colour = json_integer_value(json_object_get(value, "colour-idx"));
+		
+		if(offset >= 0 && offset < BitOffset(buffer_length, 0)
+			&& length > 0 && (offset + length) <= BitOffset(buffer_length, 0)
+			&& highlight_colour_map.find(colour) != highlight_colour_map.end())
+		{
+			bulk_highlights.emplace_back(BitRangeMap<int>::Range(offset, length), colour);
+		}
+	}
+	
+	BitRangeMap<int> highlights;
+	highlights.set_bulk(std::move(bulk_highlights));
+	
+	return highlights;
+}
+
+REHex::BitRangeMap<REHex::Document::TypeInfo> REHex::Document::_load_types(const json_t *meta, off_t buffer_length)
+{
+	json_t *j_types = json_object_get(meta, "data_types");
+	
+	std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > bulk_types;
+	bulk_types.reserve(json_array_size(j_types));
+	
+	size_t index;
+	json_t *value;
+	
+	json_array_foreach(j_types, index, value)
+	{
+		BitOffset offset = BitOffset::from_json(json_object_get(value, "offset"));
+		BitOffset length = BitOffset::from_json(json_object_get(value, "length"));
+		const char *type_name = json_string_value(json_object_get(value, "type"));
+		json_t *options  = json_object_get(value, "options");
+		
+		if(offset >= BitOffset::ZERO && offset < BitOffset(buffer_length, 0)
+			&& length > BitOffset::ZERO && (offset + length) <= BitOffset(buffer_length, 0)
+			&& type_name != NULL)
+		{
+			std::shared_ptr<const DataType> type;
+			try {
+				type = DataTypeRegistry::get_type(type_name, options);
+				if(type == NULL)
+				{
+					wxGetApp().printf_error("Ignoring unknown data type '%s' in metadata\n", type_name);
+				}
+			}
+			catch(const std::invalid_argument &e)
+			{
+				wxGetApp().printf_error("Ignoring data type with invalid options (%s) in metadata\n", e.what());
+			}
+			
+			if(type)
+			{
+				bulk_types.emplace_back(BitRangeMap<TypeInfo>::Range(offset, length), TypeInfo(type_name, options));
+			}
+		}
+	}
+	
+	return _build_types(std::move(bulk_types), buffer_length);
+}
+
+REHex::BitRangeMap<REHex::Document::TypeInfo> REHex::Document::_build_types(std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > &&bulk_types, off_t buffer_length)
+{
+	BitRangeMap<TypeInfo> set_types;
+	set_types.set_bulk(std::move(bulk_types));
+	
+	/* Fill in the gaps between the types which were set with plain data, so the whole
+	 * buffer is covered.
+	*/
+	
+	std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > all_types;
+	all_types.reserve((set_types.size() * 2) + 1);
+	
+	BitOffset next_offset = BitOffset::ZERO;
+	BitOffset buffer_end(buffer_length, 0);
+	
+	for(auto t = set_types.begin(); t != set_types.end(); ++t)
+	{
+		if(t->first.offset > next_offset)
+		{
+			all_types.emplace_back(BitRangeMap<TypeInfo>::Range(next_offset, (t->first.offset - next_offset)), TypeInfo(""));
+		}
+		
+		all_types.push_back(*t);
+		next_offset = t->first.offset + t->first.length;
+	}
+	
+	if(buffer_end > next_offset)
+	{
+		all_types.emplace_back(BitRangeMap<TypeInfo>::Range(next_offset, (buffer_end - next_offset)), TypeInfo(""));
+	}
+	
+	BitRangeMap<TypeInfo> types;
+	types.set_bulk(std::move(all_types));
+	
+	return types;
+}
+
+std::pair< REHex::ByteRangeMap<off_t>, REHex::ByteRangeMap<off_t> > REHex::Document::_load_virt_mappings(const json_t *meta, off_t buffer_length)
+{
+	ByteRangeMap<off_t> real_to_virt_segs;
+	ByteRangeMap<off_t> virt_to_real_segs;
+	
+	json_t *j_mappings = json_object_get(meta, "virt_mappings");
 	
 	size_t index;
 	json_t *value;
@@ -2409,17 +3462,38 @@ std::pair< REHex::ByteRangeMap<off_t>, REHex::ByteRangeMap<off_t> > REHex::Docum
 
 void REHex::Document::load_metadata(const std::string &filename)
 {
-	json_error_t json_err;
-	json_t *meta = json_load_file(filename.c_str(), 0, &json_err);
-	if(meta == NULL)
+	bool binary = _is_binary_metadata(filename);
+	
+	json_t *meta = NULL;
+	if(!binary)
 	{
-		throw std::runtime_error(json_err.text);
+		json_error_t json_err;
+		meta = json_load_file(filename.c_str(), 0, &json_err);
+		if(meta == NULL)
+		{
+			throw std::runtime_error(json_err.text);
+		}
 	}
 	
 	wxGetApp().bulk_updates_freeze();
 	
 	ScopedTransaction t(this, "Import metadata");
-	load_metadata(meta);
+	
+	if(binary)
+	{
+		try {
+			_load_binary_metadata(filename);
+		}
+		catch(...)
+		{
+			wxGetApp().bulk_updates_thaw();
+			throw;
+		}
+	}
+	else{
+		load_metadata(meta);
+	}
+	
 	t.commit();
 	
 	/* Fire off every metadata change signal. This will trigger an unnecessary amount of
@@ -2440,6 +3514,19 @@ void REHex::Document::_load_metadata(const std::string &filename)
 {
 	/* TODO: Report errors */
 	
+	try {
+		if(_is_binary_metadata(filename))
+		{
+			_load_binary_metadata(filename);
+			return;
+		}
+	}
+	catch(const std::exception &e)
+	{
+		wxGetApp().printf_error("Error loading metadata from %s: %s\n", filename.c_str(), e.what());
+		return;
+	}
+	
 	json_error_t json_err;
 	json_t *meta = json_load_file(filename.c_str(), 0, &json_err);
 	
@@ -2646,6 +3733,12 @@ void REHex::Document::OnColourPaletteChanged(wxCommandEvent &event)
 	event.Skip();
 }
 
+void REHex::Document::OnBufferCacheSizeChanged(wxCommandEvent &event)
+{
+	buffer->set_clean_cache_limit(wxGetApp().settings->get_buffer_cache_size());
+	event.Skip();
+}
+
 bool REHex::Document::ProcessEvent(wxEvent &event)
 {
 	/* When a handler is removed from a wxEvtHandler object, the slot is cleared but the array
@@ -2674,6 +3767,130 @@ bool REHex::Document::ProcessEvent(wxEvent &event)
 REHex::Document::Comment::Comment(const wxString &text):
 	text(new wxString(text)) {}
 
+REHex::Document::Comment::Comment(const std::shared_ptr<const wxString> &text):
+	text(text) {}
+
+REHex::Document::Comment::Comment(const wxString &text, const std::shared_ptr<const ArrayLayout> &array):
+	text(new wxString(text)),
+	array(array) {}
+
+REHex::Document::Comment::ArrayLayout::Field::Field(BitOffset offset, BitOffset length, const wxString &text):
+	offset(offset),
+	length(length),
+	text(new wxString(text)) {}
+
+bool REHex::Document::Comment::ArrayLayout::Field::operator==(const Field &rhs) const
+{
+	return offset == rhs.offset && length == rhs.length && *text == *(rhs.text);
+}
+
+REHex::Document::Comment::ArrayLayout::ArrayLayout(BitOffset element_length, const std::vector<Field> &fields):
+	element_length(element_length),
+	fields(fields)
+{
+	if(element_length <= BitOffset::ZERO)
+	{
+		throw std::invalid_argument("Array element length must be positive");
+	}
+	
+	for(auto f = this->fields.begin(); f != this->fields.end(); ++f)
+	{
+		if(f->offset < BitOffset::ZERO || f->length < BitOffset::ZERO || (f->offset + f->length) > element_length)
+		{
+			throw std::invalid_argument("Array field doesn't fit within an element");
+		}
+	}
+	
+	std::stable_sort(this->fields.begin(), this->fields.end(), [](const Field &a, const Field &b)
+	{
+		return a.offset < b.offset || (a.offset == b.offset && a.length > b.length);
+	});
+}
+
+bool REHex::Document::Comment::ArrayLayout::operator==(const ArrayLayout &rhs) const
+{
+	return element_length == rhs.element_length && fields == rhs.fields;
+}
+
+off_t REHex::Document::Comment::ArrayLayout::element_count(BitOffset comment_length) const
+{
+	return (comment_length.total_bits() / element_length.total_bits());
+}
+
+wxString REHex::Document::Comment::ArrayLayout::element_text(const wxString &array_text, off_t index)
+{
+	return array_text + "[" + std::to_string((long long)(index)) + "]";
+}
+
+json_t *REHex::Document::Comment::ArrayLayout::to_json() const
+{
+	json_t *j_layout = json_object();
+	json_t *j_fields = json_array();
+	
+	if(j_layout == NULL
+		|| json_object_set_new(j_layout, "element_length", element_length.to_json()) == -1
+		|| json_object_set_new(j_layout, "fields", j_fields) == -1)
+	{
+		json_decref(j_layout);
+		return NULL;
+	}
+	
+	for(auto f = fields.begin(); f != fields.end(); ++f)
+	{
+		const wxScopedCharBuffer utf8_text = f->text->utf8_str();
+		
+		json_t *j_field = json_object();
+		if(json_array_append_new(j_fields, j_field) == -1
+			|| json_object_set_new(j_field, "offset", f->offset.to_json()) == -1
+			|| json_object_set_new(j_field, "length", f->length.to_json()) == -1
+			|| json_object_set_new(j_field, "text",   json_stringn(utf8_text.data(), utf8_text.length())) == -1)
+		{
+			json_decref(j_layout);
+			return NULL;
+		}
+	}
+	
+	return j_layout;
+}
+
+std::shared_ptr<const REHex::Document::Comment::ArrayLayout> REHex::Document::Comment::ArrayLayout::from_json(const json_t *json)
+{
+	json_t *j_fields = json_object_get(json, "fields");
+	if(!json_is_array(j_fields))
+	{
+		return NULL;
+	}
+	
+	try {
+		BitOffset element_length = BitOffset::from_json(json_object_get(json, "element_length"));
+		
+		std::vector<Field> fields;
+		fields.reserve(json_array_size(j_fields));
+		
+		size_t index;
+		json_t *value;
+		
+		json_array_foreach(j_fields, index, value)
+		{
+			if(!json_is_string(json_object_get(value, "text")))
+			{
+				return NULL;
+			}
+			
+			fields.emplace_back(
+				BitOffset::from_json(json_object_get(value, "offset")),
+				BitOffset::from_json(json_object_get(value, "length")),
+				wxString::FromUTF8(json_string_value(json_object_get(value, "text"))));
+		}
+		
+		return std::make_shared<const ArrayLayout>(element_length, fields);
+	}
+	catch(const std::exception &e)
+	{
+		return NULL;
+	}
+}
+
 /* Get a preview of the comment suitable for use as a wxMenuItem label. */
 wxString REHex::Document::Comment::menu_preview() const
 {
@@ -2850,7 +4067,7 @@ REHex::Document::TransOpFunc REHex::Document::TransOpFunc::operator()() const
 	return func();
 }
 
-const wxDataFormat REHex::CommentsDataObject::format("rehex/comments/v2");
+const wxDataFormat REHex::CommentsDataObject::format("rehex/comments/v3");
 
 REHex::CommentsDataObject::CommentsDataObject():
 	wxCustomDataObject(format) {}
@@ -2873,17 +4090,24 @@ REHex::BitRangeTree<REHex::Document::Comment> REHex::CommentsDataObject::get_com
 		Header header;
 		memcpy(&header, data, sizeof(Header));
 		
-		if((data + sizeof(Header) + header.text_length) <= end)
+		if((data + sizeof(Header) + header.text_length + header.array_length) <= end)
 		{
-			wxString text(wxString::FromUTF8((const char*)(data + sizeof(Header)), header.text_length));
+			const char *text_data = (const char*)(data + sizeof(Header));
+			wxString text(wxString::FromUTF8(text_data, header.text_length));
+			
+			REHex::Document::Comment comment(text);
+			if(header.array_length > 0)
+			{
+				comment.array = array_layout_from_string((text_data + header.text_length), header.array_length);
+			}
 			
 			#ifndef NDEBUG
 			bool x =
 			#endif
-				comments.set(BitOffset::from_int64(header.file_offset), BitOffset::from_int64(header.file_length), REHex::Document::Comment(text));
+				comments.set(BitOffset::from_int64(header.file_offset), BitOffset::from_int64(header.file_length), comment);
 			assert(x); /* TODO: Raise some kind of error. Beep? */
 			
-			data += sizeof(Header) + header.text_length;
+			data += sizeof(Header) + header.text_length + header.array_length;
 		}
 		else{
 			break;
@@ -2895,18 +4119,23 @@ REHex::BitRangeTree<REHex::Document::Comment> REHex::CommentsDataObject::get_com
 
 void REHex::CommentsDataObject::set_comments(const std::list<BitRangeTree<Document::Comment>::const_iterator> &comments, BitOffset base)
 {
+	std::vector<std::string> arrays;
+	arrays.reserve(comments.size());
+	
 	size_t size = 0;
 	
 	for(auto i = comments.begin(); i != comments.end(); ++i)
 	{
-		size += sizeof(Header) + (*i)->value.text->utf8_str().length();
+		arrays.push_back((*i)->value.array ? array_layout_to_string(*((*i)->value.array)) : std::string());
+		size += sizeof(Header) + (*i)->value.text->utf8_str().length() + arrays.back().length();
 	}
 	
 	void *data = Alloc(size); /* Wrapper around new[] - throws on failure */
 	
 	char *outp = (char*)(data);
 	
-	for(auto i = comments.begin(); i != comments.end(); ++i)
+	auto array = arrays.begin();
+	for(auto i = comments.begin(); i != comments.end(); ++i, ++array)
 	{
 		const wxScopedCharBuffer utf8_text = (*i)->value.text->utf8_str();
 		
@@ -2916,12 +4145,16 @@ void REHex::CommentsDataObject::set_comments(const std::list<BitRangeTree<Docume
 		header.file_offset = ((*i)->key.offset - base).to_int64();
 		header.file_length = (*i)->key.length.to_int64();
 		header.text_length = utf8_text.length();
+		header.array_length = array->length();
 		
 		memcpy(outp, &header, sizeof(Header));
 		outp += sizeof(Header);
 		
 		memcpy(outp, utf8_text.data(), utf8_text.length());
 		outp += utf8_text.length();
+		
+		memcpy(outp, array->data(), array->length());
+		outp += array->length();
 	}
 	
 	assert(((char*)(data) + size) == outp);
@@ -21,13 +21,16 @@
 #include <functional>
 #include <jansson.h>
 #include <list>
+#include <map>
 #include <memory>
 #include <stdint.h>
 #include <utility>
+#include <vector>
 #include <wx/dataobj.h>
 #include <wx/wx.h>
 
 #include "BitOffset.hpp"
+#include "BitVector.hpp"
 #include "buffer.hpp"
 #include "ByteRangeMap.hpp"
 #include "ByteRangeSet.hpp"
@@ -65,6 +68,78 @@ namespace REHex {
 			*/
 			struct Comment
 			{
+				/**
+				 * @brief Comments repeated over each element of an array.
+				 *
+				 * A Comment covering an array of identically laid out elements can
+				 * carry an ArrayLayout rather than the Document holding a separate
+				 * comment for every element and every field within it, so the number
+				 * of comments stays constant however long the array is.
+				 *
+				 * Each element is implicitly commented as "<text>[<index>]" with the
+				 * fields below nested inside it. Nothing is expanded in the Document
+				 * itself, the element comments are generated on demand by whatever
+				 * displays them (see CommentTreeModel).
+				*/
+				struct ArrayLayout
+				{
+					/**
+					 * @brief A comment within each element of an array.
+					*/
+					struct Field
+					{
+						BitOffset offset;  /**< Offset of the comment, relative to the start of the element. */
+						BitOffset length;  /**< Length of the comment. */
+						std::shared_ptr<const wxString> text;
+						
+						Field(BitOffset offset, BitOffset length, const wxString &text);
+						
+						bool operator==(const Field &rhs) const;
+					};
+					
+					BitOffset element_length;
+					
+					/**
+					 * @brief Comments within each element.
+					 *
+					 * Sorted by offset, then by length (largest first) so enclosing
+					 * fields come before the fields nested within them.
+					*/
+					std::vector<Field> fields;
+					
+					/**
+					 * @brief Construct an ArrayLayout.
+					 *
+					 * Throws std::invalid_argument if element_length isn't positive
+					 * or any of the fields don't fit within an element.
+					*/
+					ArrayLayout(BitOffset element_length, const std::vector<Field> &fields);
+					
+					bool operator==(const ArrayLayout &rhs) const;
+					
+					/**
+					 * @brief Get the number of whole elements in a comment of the given length.
+					*/
+					off_t element_count(BitOffset comment_length) const;
+					
+					/**
+					 * @brief Get the text of the implicit comment over an element.
+					*/
+					static wxString element_text(const wxString &array_text, off_t index);
+					
+					/**
+					 * @brief Serialise the layout to JSON.
+					*/
+					json_t *to_json() const;
+					
+					/**
+					 * @brief Deserialise a layout from JSON.
+					 *
+					 * Returns NULL if the JSON isn't a valid layout.
+					*/
+					static std::shared_ptr<const ArrayLayout> from_json(const json_t *json);
+				};
+				
 				/**
 				 * @brief The comment text.
 				 *
@@ -78,6 +153,11 @@ namespace REHex {
 				*/
 				std::shared_ptr<const wxString> text;
 				
+				/**
+				 * @brief Layout of the array covered by this comment, if any.
+				*/
+				std::shared_ptr<const ArrayLayout> array;
+				
 				/**
 				 * @brief Create a new comment.
 				 *
@@ -85,9 +165,25 @@ namespace REHex {
 				*/
 				Comment(const wxString &text);
 				
+				/**
+				 * @brief Create a new comment sharing text with other comments.
+				 *
+				 * @param text Comment text.
+				*/
+				Comment(const std::shared_ptr<const wxString> &text);
+				
+				/**
+				 * @brief Create a new comment covering an array.
+				 *
+				 * @param text   Comment text.
+				 * @param array  Layout of each element in the array.
+				*/
+				Comment(const wxString &text, const std::shared_ptr<const ArrayLayout> &array);
+				
 				bool operator==(const Comment &rhs) const
 				{
-					return *text == *(rhs.text);
+					return *text == *(rhs.text)
+						&& (array == rhs.array || (array && rhs.array && *array == *(rhs.array)));
 				}
 				
 				/**
@@ -131,6 +227,100 @@ namespace REHex {
 				bool operator<(const TypeInfo &rhs) const;
 			};
 			
+			/**
+			 * @brief Collects annotations to be applied to a Document all at once.
+			 *
+			 * Setting each comment, data type, highlight or address mapping on a
+			 * Document individually updates the underlying containers and records an
+			 * undo operation every time, which gets very slow when annotating
+			 * hundreds of thousands of ranges (e.g. every field of every packet in a
+			 * large capture).
+			 *
+			 * An AnnotationSession instead stores the annotations in arrays until
+			 * commit() is called, at which point they are sorted and merged into the
+			 * Document in one pass, as a single undoable change which raises a single
+			 * event for each type of annotation changed.
+			 *
+			 * Annotations within a session take effect in the order they were set.
+			 *
+			 * Any annotations which haven't been committed are discarded when the
+			 * session is destroyed.
+			*/
+			class AnnotationSession
+			{
+				public:
+					/**
+					 * @brief Start a new session.
+					 *
+					 * @param doc   Document to annotate.
+					 * @param desc  Description of the change for the undo history.
+					*/
+					AnnotationSession(Document *doc, const std::string &desc);
+					
+					AnnotationSession(const AnnotationSession&) = delete;
+					AnnotationSession &operator=(const AnnotationSession&) = delete;
+					
+					/**
+					 * @brief Queue a comment to be set.
+					 * @see Document::set_comment()
+					 *
+					 * Returns false if the range is invalid or conflicts with a
+					 * comment already in the Document, or another comment queued
+					 * in this session.
+					*/
+					bool set_comment(BitOffset offset, BitOffset length, const Comment &comment);
+					
+					/**
+					 * @brief Queue a data type to be set.
+					 * @see Document::set_data_type()
+					*/
+					bool set_data_type(BitOffset offset, BitOffset length, const std::string &type, const json_t *options = NULL);
+					
+					/**
+					 * @brief Queue a highlight to be set.
+					 * @see Document::set_highlight()
+					*/
+					bool set_highlight(BitOffset offset, BitOffset length, int highlight_colour_idx);
+					
+					/**
+					 * @brief Queue a virtual address mapping to be set.
+					 * @see Document::set_virt_mapping()
+					 *
+					 * Returns false if the mapping overlaps an existing mapping, or
+					 * another mapping queued in this session.
+					*/
+					bool set_virt_mapping(off_t real_offset, off_t virt_offset, off_t length);
+					
+					/**
+					 * @brief Get the number of annotations waiting to be committed.
+					*/
+					size_t size() const;
+					
+					/**
+					 * @brief Apply the queued annotations to the Document.
+					 *
+					 * The session is empty afterwards and may be used again.
+					*/
+					void commit();
+					
+				private:
+					Document *doc;
+					std::string desc;
+					
+					std::vector< std::pair<BitRangeTreeKey, Comment> > comments;
+					std::vector< std::pair<BitRangeMap<int>::Range, int> > highlights;
+					std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > types;
+					
+					std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > real_to_virt_segs;
+					
+					/* Ranges of queued comments, to check for straddling. */
+					BitRangeTree<bool> pending_comments;
+					
+					/* Queued mappings (start => end), to check for overlaps. */
+					std::map<off_t, off_t> pending_real;
+					std::map<off_t, off_t> pending_virt;
+			};
+			
 			/**
 			 * @brief Create a Document for a new file.
 			*/
@@ -152,13 +342,19 @@ namespace REHex {
 			
 			/**
 			 * @brief Save any changes to the file and its metadata.
+			 *
+			 * Returns false if the save was cancelled by the progress callback.
+			 * @see Buffer::write_inplace()
 			*/
-			void save();
+			bool save(const Buffer::WriteProgressFunc &progress = Buffer::WriteProgressFunc());
 			
 			/**
 			 * @brief Save the file to a new path.
+			 *
+			 * Returns false if the save was cancelled by the progress callback.
+			 * @see Buffer::write_inplace()
 			*/
-			void save(const FileName &filename);
+			bool save(const FileName &filename, const Buffer::WriteProgressFunc &progress = Buffer::WriteProgressFunc());
 			
 			/**
 			 * @brief Get the user-visible title of the document.
@@ -193,6 +389,11 @@ namespace REHex {
 			*/
 			bool is_range_dirty(BitOffset offset, BitOffset length) const;
 			
+			/**
+			 * @brief Get the bytes in a range of the backing file which have been modified since the last save.
+			*/
+			ByteRangeSet get_dirty_ranges(off_t offset, off_t length) const;
+			
 			/**
 			 * @brief Check if the BUFFER has any pending changes to be saved.
 			*/
@@ -365,8 +566,26 @@ namespace REHex {
 			*/
 			void save_metadata(const std::string &filename) const;
 			
+			/**
+			 * @brief Write the metadata to a file in the compact binary format.
+			 *
+			 * The binary format is much faster to load and save than JSON when a
+			 * document has a very large number of comments or data types, but can't
+			 * be read by older versions. The .rehex-meta file for a document is
+			 * written in this format once it grows past BINARY_METADATA_THRESHOLD
+			 * records.
+			*/
+			void save_metadata_binary(const std::string &filename) const;
+			
+			/**
+			 * @brief Number of records at which .rehex-meta files are saved in binary.
+			*/
+			static const size_t BINARY_METADATA_THRESHOLD = 100000;
+			
 			/**
 			 * @brief Replace the document's metadata from a file.
+			 *
+			 * The file may be in either the JSON or binary format.
 			*/
 			void load_metadata(const std::string &filename);
 			
@@ -458,7 +677,7 @@ namespace REHex {
 			void _set_cursor_position(BitOffset position, enum CursorState cursor_state);
 			
 			void _UNTRACKED_overwrite_data(BitOffset offset, const unsigned char *data, off_t length, const ByteRangeMap<unsigned int> &data_seq_slice);
-			void _UNTRACKED_overwrite_bits(BitOffset offset, const std::vector<bool> &data, const ByteRangeMap<unsigned int> &data_seq_slice);
+			void _UNTRACKED_overwrite_bits(BitOffset offset, const BitVector &data, const ByteRangeMap<unsigned int> &data_seq_slice);
 			
 			void _UNTRACKED_insert_data(off_t offset, const unsigned char *data, off_t length, const ByteRangeMap<unsigned int> &data_seq_slice);
 			void _update_mappings_data_inserted(off_t offset, off_t length);
@@ -469,8 +688,8 @@ namespace REHex {
 			TransOpFunc _op_overwrite_undo(BitOffset offset, std::shared_ptr< std::vector<unsigned char> > old_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
 			TransOpFunc _op_overwrite_redo(BitOffset offset, std::shared_ptr< std::vector<unsigned char> > new_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
 			
-			TransOpFunc _op_overwrite_bits_undo(BitOffset offset, std::shared_ptr< std::vector<bool> > old_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
-			TransOpFunc _op_overwrite_bits_redo(BitOffset offset, std::shared_ptr< std::vector<bool> > new_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
+			TransOpFunc _op_overwrite_bits_undo(BitOffset offset, std::shared_ptr<BitVector> old_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
+			TransOpFunc _op_overwrite_bits_redo(BitOffset offset, std::shared_ptr<BitVector> new_data, BitOffset new_cursor_pos, CursorState new_cursor_state);
 			
 			TransOpFunc _op_insert_undo(off_t offset, off_t length, BitOffset new_cursor_pos, CursorState new_cursor_state);
 			TransOpFunc _op_insert_redo(off_t offset, std::shared_ptr< std::vector<unsigned char> > data, BitOffset new_cursor_pos, CursorState new_cursor_state, const ByteRangeMap<unsigned int> &redo_data_seq_slice);
@@ -490,8 +709,26 @@ namespace REHex {
 			static BitRangeMap<int> _load_highlights(const json_t *meta, off_t buffer_length, const HighlightColourMap &highlight_colour_map);
 			static BitRangeMap<TypeInfo> _load_types(const json_t *meta, off_t buffer_length);
 			static std::pair< ByteRangeMap<off_t>, ByteRangeMap<off_t> > _load_virt_mappings(const json_t *meta, off_t buffer_length);
+			static BitRangeMap<TypeInfo> _build_types(std::vector< std::pair<BitRangeMap<TypeInfo>::Range, TypeInfo> > &&bulk_types, off_t buffer_length);
+			
+			/**
+			 * @brief Minimum number of comments to decode on the thread pool when loading.
+			*/
+			static const size_t LOAD_COMMENTS_THREAD_MIN = 10000;
+			
 			void _load_metadata(const std::string &filename);
 			
+			static bool _is_binary_metadata(const std::string &filename);
+			void _load_binary_metadata(const std::string &filename);
+			
+			/**
+			 * @brief Write a .rehex-meta file.
+			 *
+			 * @param filename Name of the file to write.
+			 * @param meta Serialised metadata to write as JSON, NULL to write the binary format.
+			*/
+			bool _save_metadata_file(const std::string &filename, const json_t *meta) const;
+			
 			class CommandEventBuffer
 			{
 				public:
@@ -527,6 +764,7 @@ namespace REHex {
 			void _raise_mappings_changed();
 			
 			void OnColourPaletteChanged(wxCommandEvent &event);
+			void OnBufferCacheSizeChanged(wxCommandEvent &event);
 			
 		public:
 			/**
@@ -539,7 +777,7 @@ namespace REHex {
 			 * @brief Read some data from the file.
 			 * @see Buffer::read_bits()
 			*/
-			std::vector<bool> read_bits(BitOffset offset, size_t max_length) const;
+			BitVector read_bits(BitOffset offset, size_t max_length) const;
 			
 			/**
 			 * @brief Return the current length of the file in bytes.
@@ -590,7 +828,7 @@ namespace REHex {
 			 * @param new_cursor_state  New cursor state. Pass CSTATE_CURRENT to not change the cursor state.
 			 * @param change_desc       Description of change for undo history.
 			*/
-			void overwrite_bits(BitOffset offset, const std::vector<bool> &data, BitOffset new_cursor_pos = BitOffset::INVALID, CursorState new_cursor_state = CSTATE_CURRENT, const char *change_desc = "change data");
+			void overwrite_bits(BitOffset offset, const BitVector &data, BitOffset new_cursor_pos = BitOffset::INVALID, CursorState new_cursor_state = CSTATE_CURRENT, const char *change_desc = "change data");
 			
 			/**
 			 * @brief Insert a range of bytes into the file.
@@ -662,6 +900,7 @@ namespace REHex {
 				int64_t file_length;
 				
 				size_t text_length;
+				size_t array_length;  /**< Length of the array layout JSON following the text, zero if none. */
 			};
 			
 		public:
@@ -3,6 +3,8 @@
 #include "../DataType.hpp"
 #include "../CharacterEncoder.hpp"
 #include "../document.hpp"
+#include "../DocumentReader.hpp"
+#include "../LuaAnalysisJob.hpp"
 #include "../mainwindow.hpp"
 
 void print_debug(const wxString &text);
@@ -89,6 +91,7 @@ class REHex::Document: public wxEvtHandler
 	bool set_comment(REHex::BitOffset offset, REHex::BitOffset length, const REHex::Document::Comment &comment);
 	bool set_comment(off_t offset, off_t length, const REHex::Document::Comment &comment);
 	void set_comment_bulk(LuaTable comments);
+	bool set_comment_array(REHex::BitOffset offset, REHex::BitOffset length, const wxString &text, REHex::BitOffset element_length, LuaTable fields);
 	bool set_data_type(REHex::BitOffset offset, REHex::BitOffset length, const wxString &type);
 	bool set_data_type_bulk(LuaTable types);
 	bool set_data_type(off_t offset, off_t length, const wxString &type);
@@ -113,6 +116,31 @@ class REHex::Document: public wxEvtHandler
 	void transact_rollback();
 };
 
+class %delete REHex::Document::AnnotationSession
+{
+	REHex::Document::AnnotationSession(REHex::Document *doc, const wxString &desc);
+	
+	bool set_comment(REHex::BitOffset offset, REHex::BitOffset length, const REHex::Document::Comment &comment);
+	bool set_data_type(REHex::BitOffset offset, REHex::BitOffset length, const wxString &type);
+	bool set_highlight(REHex::BitOffset offset, REHex::BitOffset length, int colour);
+	bool set_virt_mapping(off_t real_offset, off_t virt_offset, off_t length);
+	
+	size_t size() const;
+	void commit();
+};
+
+class %delete REHex::DocumentReader
+{
+	REHex::DocumentReader(const REHex::Document *doc, REHex::BitOffset offset);
+	
+	REHex::BitOffset tell() const;
+	void seek(REHex::BitOffset offset);
+	bool eof();
+	
+	wxString read(size_t length);
+	LuaTable read_numbers(const wxString &type, size_t count);
+};
+
 class REHex::Tab: public wxPanel
 {
 	const REHex::Document *doc;
@@ -120,6 +148,18 @@ class REHex::Tab: public wxPanel
 	void get_selection_linear();
 };
 
+class %delete REHex::LuaAnalysisJob: public wxEvtHandler
+{
+	REHex::LuaAnalysisJob(REHex::Tab *tab, const wxString &script, const wxString &desc);
+	
+	bool start();
+	void cancel();
+	
+	wxString get_state() const;
+	wxString get_error() const;
+	double get_progress() const;
+};
+
 class REHex::TabCreatedEvent: public wxEvent
 {
 	%wxEventType REHex::TAB_CREATED
@@ -276,58 +276,187 @@ static int LUACALL wxLua_REHex_Document_set_comment_bulk(lua_State *L)
 {
 	REHex::Document *self = (REHex::Document *)wxluaT_getuserdatatype(L, 1, wxluatype_REHex_Document);
 	
-	if(lua_istable(L, 2))
+	if(!lua_istable(L, 2))
 	{
-		size_t num_comments = lua_objlen(L, 2);
+		wxlua_argerror(L, 2, wxT("a table of tables"));
+		return 0;
+	}
+		
+	size_t num_comments = lua_objlen(L, 2);
+	
+	/* Check every element before we start queueing them, raising a Lua error would skip
+	 * the AnnotationSession destructor.
+	*/
+	
+	for(size_t i = 0; i < num_comments; ++i)
+	{
+		/* Get comments[i] and push it onto the Lua stack. */
+		lua_rawgeti(L, 2, (i + 1));
+		
+		bool valid = lua_istable(L, -1) && lua_objlen(L, -1) == 5;
 		
-		for(size_t i = 0; i < num_comments; ++i)
+		for(int j = 1; valid && j <= 5; ++j)
 		{
-			/* Get comments[i] and push it onto the Lua stack. */
-			lua_rawgeti(L, 2, (i + 1));
-			
-			if(lua_istable(L, -1) && lua_objlen(L, -1) == 5)
-			{
-				lua_rawgeti(L, -1, 1);
-				off_t offset_byte = (off_t)(wxlua_getnumbertype(L, -1));
-				lua_pop(L, 1);
-				
-				lua_rawgeti(L, -1, 2);
-				off_t offset_bit = (off_t)(wxlua_getnumbertype(L, -1));
-				lua_pop(L, 1);
-				
-				lua_rawgeti(L, -1, 3);
-				off_t length_byte = (off_t)(wxlua_getnumbertype(L, -1));
-				lua_pop(L, 1);
-				
-				lua_rawgeti(L, -1, 4);
-				off_t length_bit = (off_t)(wxlua_getnumbertype(L, -1));
-				lua_pop(L, 1);
-				
-				lua_rawgeti(L, -1, 5);
-				const wxString comment_text = wxlua_getwxStringtype(L, -1);
-				lua_pop(L, 1);
-				
-				self->set_comment(
-					REHex::BitOffset(offset_byte, offset_bit),
-					REHex::BitOffset(length_byte, length_bit),
-					REHex::Document::Comment(comment_text));
-			}
-			else{
-				wxlua_argerror(L, 2, wxT("a table of tables"));
-			}
-			
-			/* Pop types[i] off the Lua stack. */
+			lua_rawgeti(L, -1, j);
+			valid = j < 5 ? wxlua_isnumbertype(L, -1) : wxlua_isstringtype(L, -1);
 			lua_pop(L, 1);
 		}
+		
+		/* Pop comments[i] off the Lua stack. */
+		lua_pop(L, 1);
+		
+		if(!valid)
+		{
+			wxlua_argerror(L, 2, wxT("a table of tables"));
+			return 0;
+		}
 	}
-	else{
-		wxlua_argerror(L, 2, wxT("a table of tables"));
+	
+	REHex::Document::AnnotationSession session(self, "set comments");
+	
+	for(size_t i = 0; i < num_comments; ++i)
+	{
+		/* Get comments[i] and push it onto the Lua stack. */
+		lua_rawgeti(L, 2, (i + 1));
+		
+		lua_rawgeti(L, -1, 1);
+		off_t offset_byte = (off_t)(wxlua_getnumbertype(L, -1));
+		lua_pop(L, 1);
+		
+		lua_rawgeti(L, -1, 2);
+		off_t offset_bit = (off_t)(wxlua_getnumbertype(L, -1));
+		lua_pop(L, 1);
+		
+		lua_rawgeti(L, -1, 3);
+		off_t length_byte = (off_t)(wxlua_getnumbertype(L, -1));
+		lua_pop(L, 1);
+		
+		lua_rawgeti(L, -1, 4);
+		off_t length_bit = (off_t)(wxlua_getnumbertype(L, -1));
+		lua_pop(L, 1);
+		
+		lua_rawgeti(L, -1, 5);
+		const wxString comment_text = wxlua_getwxStringtype(L, -1);
+		lua_pop(L, 1);
+		
+		session.set_comment(
+			REHex::BitOffset(offset_byte, offset_bit),
+			REHex::BitOffset(length_byte, length_bit),
+			REHex::Document::Comment(comment_text));
+		
+		/* Pop comments[i] off the Lua stack. */
+		lua_pop(L, 1);
 	}
 	
+	session.commit();
+	
 	return 0;
 }
 %end
 
+%override wxLua_REHex_Document_set_comment_array
+static int LUACALL wxLua_REHex_Document_set_comment_array(lua_State *L)
+{
+	REHex::Document *self = (REHex::Document *)wxluaT_getuserdatatype(L, 1, wxluatype_REHex_Document);
+	
+	REHex::BitOffset offset = *(REHex::BitOffset*)(wxluaT_getuserdatatype(L, 2, wxluatype_REHex_BitOffset));
+	REHex::BitOffset length = *(REHex::BitOffset*)(wxluaT_getuserdatatype(L, 3, wxluatype_REHex_BitOffset));
+	const wxString text = wxlua_getwxStringtype(L, 4);
+	REHex::BitOffset element_length = *(REHex::BitOffset*)(wxluaT_getuserdatatype(L, 5, wxluatype_REHex_BitOffset));
+	
+	if(!lua_istable(L, 6))
+	{
+		wxlua_argerror(L, 6, wxT("a table of tables"));
+		return 0;
+	}
+	
+	size_t num_fields = lua_objlen(L, 6);
+	
+	/* Check every field before we start building the layout, raising a Lua error would
+	 * skip the destructors of any objects we had constructed.
+	*/
+	
+	for(size_t i = 0; i < num_fields; ++i)
+	{
+		/* Get fields[i] and push it onto the Lua stack. */
+		lua_rawgeti(L, 6, (i + 1));
+		
+		bool valid = lua_istable(L, -1) && lua_objlen(L, -1) == 5;
+		
+		for(int j = 1; valid && j <= 5; ++j)
+		{
+			lua_rawgeti(L, -1, j);
+			valid = j < 5 ? wxlua_isnumbertype(L, -1) : wxlua_isstringtype(L, -1);
+			lua_pop(L, 1);
+		}
+		
+		/* Pop fields[i] off the Lua stack. */
+		lua_pop(L, 1);
+		
+		if(!valid)
+		{
+			wxlua_argerror(L, 6, wxT("a table of tables"));
+			return 0;
+		}
+	}
+	
+	bool returns;
+	
+	{
+		std::vector<REHex::Document::Comment::ArrayLayout::Field> fields;
+		fields.reserve(num_fields);
+		
+		for(size_t i = 0; i < num_fields; ++i)
+		{
+			/* Get fields[i] and push it onto the Lua stack. */
+			lua_rawgeti(L, 6, (i + 1));
+			
+			lua_rawgeti(L, -1, 1);
+			off_t offset_byte = (off_t)(wxlua_getnumbertype(L, -1));
+			lua_pop(L, 1);
+			
+			lua_rawgeti(L, -1, 2);
+			off_t offset_bit = (off_t)(wxlua_getnumbertype(L, -1));
+			lua_pop(L, 1);
+			
+			lua_rawgeti(L, -1, 3);
+			off_t length_byte = (off_t)(wxlua_getnumbertype(L, -1));
+			lua_pop(L, 1);
+			
+			lua_rawgeti(L, -1, 4);
+			off_t length_bit = (off_t)(wxlua_getnumbertype(L, -1));
+			lua_pop(L, 1);
+			
+			lua_rawgeti(L, -1, 5);
+			const wxString field_text = wxlua_getwxStringtype(L, -1);
+			lua_pop(L, 1);
+			
+			fields.emplace_back(
+				REHex::BitOffset(offset_byte, offset_bit),
+				REHex::BitOffset(length_byte, length_bit),
+				field_text);
+			
+			/* Pop fields[i] off the Lua stack. */
+			lua_pop(L, 1);
+		}
+		
+		try {
+			auto layout = std::make_shared<const REHex::Document::Comment::ArrayLayout>(element_length, fields);
+			returns = self->set_comment(offset, length, REHex::Document::Comment(text, layout));
+		}
+		catch(const std::invalid_argument &e)
+		{
+			/* Field outside of the element or non-positive element length. */
+			returns = false;
+		}
+	}
+	
+	lua_pushboolean(L, returns);
+	
+	return 1;
+}
+%end
+
 %override wxLua_REHex_Document_set_data_type
 static int LUACALL wxLua_REHex_Document_set_data_type(lua_State *L)
 {
@@ -402,6 +531,124 @@ static int LUACALL wxLua_REHex_Document_transact_begin(lua_State *L)
 }
 %end
 
+%override wxLua_REHex_Document_AnnotationSession_constructor
+static int LUACALL wxLua_REHex_Document_AnnotationSession_constructor(lua_State *L)
+{
+	REHex::Document *doc = (REHex::Document*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_Document));
+	const wxString desc = wxlua_getwxStringtype(L, 2);
+	
+	// call constructor
+	REHex::Document::AnnotationSession* returns = new REHex::Document::AnnotationSession(doc, desc.ToStdString());
+	
+	// add to tracked memory list
+	wxluaO_addgcobject(L, returns, wxluatype_REHex_Document_AnnotationSession);
+	// push the constructed class pointer
+	wxluaT_pushuserdatatype(L, returns, wxluatype_REHex_Document_AnnotationSession);
+	
+	return 1;
+}
+%end
+
+%override wxLua_REHex_Document_AnnotationSession_set_data_type
+static int LUACALL wxLua_REHex_Document_AnnotationSession_set_data_type(lua_State *L)
+{
+	REHex::Document::AnnotationSession *self = (REHex::Document::AnnotationSession*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_Document_AnnotationSession));
+	
+	REHex::BitOffset offset = *(REHex::BitOffset*)(wxluaT_getuserdatatype(L, 2, wxluatype_REHex_BitOffset));
+	REHex::BitOffset length = *(REHex::BitOffset*)(wxluaT_getuserdatatype(L, 3, wxluatype_REHex_BitOffset));
+	const wxString type = wxlua_getwxStringtype(L, 4);
+	
+	bool returns = self->set_data_type(offset, length, type.ToStdString());
+	lua_pushboolean(L, returns);
+	
+	return 1;
+}
+%end
+
+%override wxLua_REHex_DocumentReader_read
+static int LUACALL wxLua_REHex_DocumentReader_read(lua_State *L)
+{
+	REHex::DocumentReader *self = (REHex::DocumentReader*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_DocumentReader));
+	lua_Number length = wxlua_getnumbertype(L, 2);
+	
+	if(length < 0)
+	{
+		wxlua_argerror(L, 2, wxT("a length >= 0"));
+		return 0;
+	}
+	
+	/* Push straight from the reader's buffer, without an intermediate vector. */
+	
+	size_t read_length;
+	const unsigned char *data = self->read((size_t)(length), &read_length);
+	
+	lua_pushlstring(L, (const char*)(data), read_length);
+	
+	return 1;
+}
+%end
+
+%override wxLua_REHex_DocumentReader_read_numbers
+static int LUACALL wxLua_REHex_DocumentReader_read_numbers(lua_State *L)
+{
+	REHex::DocumentReader *self = (REHex::DocumentReader*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_DocumentReader));
+	lua_Number count = wxlua_getnumbertype(L, 3);
+	
+	REHex::DocumentReader::NumberType type;
+	bool type_ok = true;
+	
+	{
+		const wxString type_name = wxlua_getwxStringtype(L, 2);
+		
+		try {
+			type = REHex::DocumentReader::NumberType::parse(type_name.ToStdString());
+		}
+		catch(const std::invalid_argument&)
+		{
+			type_ok = false;
+		}
+	}
+	
+	if(!type_ok)
+	{
+		wxlua_argerror(L, 2, wxT("a number type (e.g. \"u32le\")"));
+		return 0;
+	}
+	
+	if(count < 0)
+	{
+		wxlua_argerror(L, 3, wxT("a count >= 0"));
+		return 0;
+	}
+	
+	lua_newtable(L);
+	
+	if(type.kind == REHex::DocumentReader::NumberType::FLOAT)
+	{
+		std::vector<double> values;
+		self->read_floats(type, (size_t)(count), &values);
+		
+		for(size_t i = 0; i < values.size(); ++i)
+		{
+			lua_pushnumber(L, values[i]);
+			lua_rawseti(L, -2, (i + 1));
+		}
+	}
+	else{
+		std::vector<int64_t> values;
+		self->read_integers(type, (size_t)(count), &values);
+		
+		for(size_t i = 0; i < values.size(); ++i)
+		{
+			lua_pushinteger(L, values[i]);
+			lua_rawseti(L, -2, (i + 1));
+		}
+	}
+	
+	return 1;
+}
+%end
+
 %override wxLua_REHex_Tab_get_selection_linear
 static int LUACALL wxLua_REHex_Tab_get_selection_linear(lua_State *L)
 {
@@ -422,6 +669,57 @@ static int LUACALL wxLua_REHex_Tab_get_selection_linear(lua_State *L)
 }
 %end
 
+%override wxLua_REHex_LuaAnalysisJob_constructor
+static int LUACALL wxLua_REHex_LuaAnalysisJob_constructor(lua_State *L)
+{
+	REHex::Tab *tab = (REHex::Tab*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_Tab));
+	const wxString script = wxlua_getwxStringtype(L, 2);
+	const wxString desc = wxlua_getwxStringtype(L, 3);
+	
+	// call constructor
+	REHex::LuaAnalysisJob* returns = new REHex::LuaAnalysisJob(tab->doc, script.ToStdString(), desc.ToStdString());
+	
+	// add to tracked memory list
+	wxluaO_addgcobject(L, returns, wxluatype_REHex_LuaAnalysisJob);
+	// push the constructed class pointer
+	wxluaT_pushuserdatatype(L, returns, wxluatype_REHex_LuaAnalysisJob);
+	
+	return 1;
+}
+%end
+
+%override wxLua_REHex_LuaAnalysisJob_get_state
+static int LUACALL wxLua_REHex_LuaAnalysisJob_get_state(lua_State *L)
+{
+	REHex::LuaAnalysisJob *self = (REHex::LuaAnalysisJob*)(wxluaT_getuserdatatype(L, 1, wxluatype_REHex_LuaAnalysisJob));
+	
+	switch(self->get_state())
+	{
+		case REHex::LuaAnalysisJob::State::IDLE:
+			lua_pushstring(L, "idle");
+			break;
+			
+		case REHex::LuaAnalysisJob::State::RUNNING:
+			lua_pushstring(L, "running");
+			break;
+			
+		case REHex::LuaAnalysisJob::State::FINISHED:
+			lua_pushstring(L, "finished");
+			break;
+			
+		case REHex::LuaAnalysisJob::State::FAILED:
+			lua_pushstring(L, "failed");
+			break;
+			
+		case REHex::LuaAnalysisJob::State::CANCELLED:
+			lua_pushstring(L, "cancelled");
+			break;
+	}
+	
+	return 1;
+}
+%end
+
 %override wxLua_REHex_CharacterEncoding_encoding_by_key
 static int LUACALL wxLua_REHex_CharacterEncoding_encoding_by_key(lua_State *L)
 {
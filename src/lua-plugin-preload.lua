@@ -86,12 +86,15 @@ if _rehex_plugin_dir ~= nil then
 end
 
 -- Bodge in some less-obnoxious aliases for the classes generated by genwxbind.lua
+rehex.AnalysisJob = rehex.REHex_LuaAnalysisJob
+rehex.AnnotationSession = rehex.REHex_Document_AnnotationSession
 rehex.BitOffset = rehex.REHex_BitOffset
 rehex.ByteRangeSet = rehex.REHex_ByteRangeSet
 rehex.CharacterEncoding = rehex.REHex_CharacterEncoding
 rehex.Comment = rehex.REHex_Document_Comment
 rehex.DataTypeRegistration = rehex.REHex_DataTypeRegistration
 rehex.Document = rehex.REHex_Document
+rehex.DocumentReader = rehex.REHex_DocumentReader
 rehex.MainWindow = rehex.REHex_MainWindow
 rehex.Tab = rehex.REHex_Tab
 
@@ -35,7 +35,9 @@
 #include <wx/mstream.h>
 #include <wx/aui/auibook.h>
 #include <wx/numdlg.h>
+#include <wx/progdlg.h>
 #include <wx/sstream.h>
+#include <wx/stopwatch.h>
 #include <wx/wfstream.h>
 
 #include "AboutDialog.hpp"
@@ -907,7 +909,12 @@ void REHex::MainWindow::OnSave(wxCommandEvent &event)
 	}
 	
 	try {
-		tab->doc->save();
+		if(!(tab->doc->save(save_progress_func())))
+		{
+			wxMessageBox(
+				"Saving was cancelled, your changes have not been written to the file.",
+				"Save cancelled", wxICON_WARNING, this);
+		}
 	}
 	catch(const std::exception &e)
 	{
@@ -930,7 +937,12 @@ void REHex::MainWindow::OnSaveAs(wxCommandEvent &event)
 	}
 	
 	try {
-		tab->doc->save(filename);
+		if(!(tab->doc->save(filename, save_progress_func())))
+		{
+			wxMessageBox(
+				"Saving was cancelled, " + filename.GetFullName() + " has not been written.",
+				"Save cancelled", wxICON_WARNING, this);
+		}
 	}
 	catch(const std::exception &e)
 	{
@@ -941,6 +953,33 @@ void REHex::MainWindow::OnSaveAs(wxCommandEvent &event)
 	}
 }
 
+REHex::Buffer::WriteProgressFunc REHex::MainWindow::save_progress_func()
+{
+	/* The progress dialog is only shown once a save has been running for a
+	 * little while, so small saves don't flash a window up.
+	*/
+	
+	std::shared_ptr<wxStopWatch> elapsed(new wxStopWatch());
+	std::shared_ptr<wxProgressDialog> dialog;
+	
+	return [this, elapsed, dialog](off_t done, off_t total) mutable
+	{
+		if(!dialog)
+		{
+			if(elapsed->Time() < 500 || done >= total)
+			{
+				return true;
+			}
+			
+			dialog.reset(new wxProgressDialog("Saving", "Saving file...", 1000, this,
+				(wxPD_CAN_ABORT | wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME)));
+		}
+		
+		int value = total > 0 ? (int)((done * 1000) / total) : 1000;
+		return dialog->Update(value);
+	};
+}
+
 void REHex::MainWindow::OnReload(wxCommandEvent &event)
 {
 	Document *doc = active_document();
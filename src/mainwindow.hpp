@@ -353,6 +353,11 @@ namespace REHex {
 			void _update_cpos_buttons(DocumentCtrl *doc_ctrl);
 			void _update_colour_map_menu(DocumentCtrl *doc_ctrl);
 			
+			/**
+			 * @brief Returns a progress callback for Document::save() which displays a cancellable progress dialog.
+			*/
+			Buffer::WriteProgressFunc save_progress_func();
+			
 			bool confirm_close_tabs(const std::vector<Tab*> &tabs);
 			
 			void close_tab(Tab *tab);
@@ -83,6 +83,17 @@ typedef int ssize_t;
 #define REHEX_ASSUME_INTEGER_CHARACTER_WIDTHS
 #endif
 
+#if defined(REHEX_FORCE_SLOW_TEXT_PATH) && defined(REHEX_ASSUME_INTEGER_CHARACTER_WIDTHS)
+/* Even with cached character bitmaps, blitting every character individually dominates drawing
+ * time when the view is heavily coloured (byte colour maps, highlights, large selections), so
+ * instead we cache a colour-independent coverage mask of each character and composite whole
+ * lines into a single off-screen bitmap, which is copied to the screen in one go.
+ *
+ * Relies on integer character widths to place characters at exact pixel offsets.
+*/
+#define REHEX_GLYPH_ATLAS
+#endif
+
 #if !(defined(_WIN32) || defined(__APPLE__))
 /* Enable handling for X11 (and Wayland) "PRIMARY" selection. */
 #define REHEX_ENABLE_PRIMARY_SELECTION
@@ -17,8 +17,18 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
 #include <wx/button.h>
 #include <wx/checkbox.h>
+#include <wx/filedlg.h>
+#include <wx/msgdlg.h>
 #include <wx/radiobut.h>
 #include <wx/sizer.h>
 #include <wx/time.h>
@@ -27,9 +37,49 @@
 
 #ifdef REHEX_PROFILE
 
+class REHex::ProfilingCollector::ThreadEvents
+{
+	public:
+		struct Event
+		{
+			ProfilingCollector *collector;
+			ThreadGroup thread_group;
+			
+			uint64_t begin_time;
+			uint64_t duration;
+		};
+		
+		static const size_t RING_SIZE = 32768; /* Must be a power of two. */
+		static const size_t FLUSH_THRESHOLD = RING_SIZE / 2;
+		
+		const unsigned int thread_id;
+		
+		Event ring[RING_SIZE];
+		
+		std::atomic<size_t> head; /**< Next slot to be written, only modified by the owning thread. */
+		std::atomic<size_t> tail; /**< Next slot to be read, only modified under flush_mutex. */
+		
+		std::atomic<bool> thread_exited;
+		
+		ThreadEvents(unsigned int thread_id):
+			thread_id(thread_id),
+			head(0),
+			tail(0),
+			thread_exited(false) {}
+};
+
 std::list<REHex::ProfilingCollector*> *REHex::ProfilingCollector::collectors = NULL;
 thread_local REHex::ProfilingCollector::ThreadGroup REHex::ProfilingCollector::thread_group = REHex::ProfilingCollector::ThreadGroup::UNKNOWN;
 
+thread_local std::shared_ptr<REHex::ProfilingCollector::ThreadEvents> REHex::ProfilingCollector::this_thread_events;
+
+std::mutex REHex::ProfilingCollector::flush_mutex;
+std::list< std::shared_ptr<REHex::ProfilingCollector::ThreadEvents> > *REHex::ProfilingCollector::thread_events = NULL;
+std::mutex REHex::ProfilingCollector::thread_events_mutex;
+
+bool REHex::ProfilingCollector::trace_enabled = false;
+std::deque<REHex::ProfilingCollector::TraceEvent> *REHex::ProfilingCollector::trace_events = NULL;
+
 void REHex::ProfilingCollector::set_thread_group(ThreadGroup thread_group)
 {
 	/* Thread group may only be set once per thread. */
@@ -61,6 +111,8 @@ std::list<REHex::ProfilingCollector*> REHex::ProfilingCollector::get_collectors(
 
 void REHex::ProfilingCollector::reset_collectors()
 {
+	std::unique_lock<std::mutex> flush_guard(flush_mutex);
+	
 	if(collectors != NULL)
 	{
 		for(auto c = collectors->begin(); c != collectors->end(); ++c)
@@ -68,6 +120,214 @@ void REHex::ProfilingCollector::reset_collectors()
 			(*c)->reset();
 		}
 	}
+	
+	if(trace_events != NULL)
+	{
+		trace_events->clear();
+	}
+}
+
+REHex::ProfilingCollector::ThreadEvents *REHex::ProfilingCollector::get_thread_events()
+{
+	/* Helper to flag the buffer once the thread exits, so it can be released once any
+	 * remaining events have been processed.
+	*/
+	struct ThreadEventsOwner
+	{
+		~ThreadEventsOwner()
+		{
+			if(this_thread_events)
+			{
+				this_thread_events->thread_exited = true;
+			}
+		}
+	};
+	
+	static thread_local ThreadEventsOwner owner;
+	
+	if(!this_thread_events)
+	{
+		static std::atomic<unsigned int> next_thread_id(1);
+		this_thread_events = std::make_shared<ThreadEvents>(next_thread_id++);
+		
+		std::unique_lock<std::mutex> te_guard(thread_events_mutex);
+		
+		if(thread_events == NULL)
+		{
+			thread_events = new std::list< std::shared_ptr<ThreadEvents> >();
+		}
+		
+		thread_events->push_back(this_thread_events);
+	}
+	
+	return this_thread_events.get();
+}
+
+void REHex::ProfilingCollector::flush_thread_events(ThreadEvents *te, const std::unique_lock<std::mutex> &flush_guard)
+{
+	assert(flush_guard.owns_lock());
+	
+	size_t tail = te->tail.load(std::memory_order_relaxed);
+	size_t head = te->head.load(std::memory_order_acquire);
+	
+	for(; tail != head; ++tail)
+	{
+		const ThreadEvents::Event &event = te->ring[tail & (ThreadEvents::RING_SIZE - 1)];
+		
+		event.collector->aggregate_time(event.thread_group, event.begin_time, event.duration);
+		
+		if(trace_enabled)
+		{
+			if(trace_events == NULL)
+			{
+				trace_events = new std::deque<TraceEvent>();
+			}
+			
+			if(trace_events->size() >= TRACE_MAX_EVENTS)
+			{
+				trace_events->pop_front();
+			}
+			
+			trace_events->emplace_back(event.collector, te->thread_id, event.thread_group, event.begin_time, event.duration);
+		}
+	}
+	
+	te->tail.store(tail, std::memory_order_release);
+}
+
+void REHex::ProfilingCollector::flush_events()
+{
+	std::unique_lock<std::mutex> flush_guard(flush_mutex);
+	std::unique_lock<std::mutex> te_guard(thread_events_mutex);
+	
+	if(thread_events == NULL)
+	{
+		return;
+	}
+	
+	for(auto te = thread_events->begin(); te != thread_events->end();)
+	{
+		/* Check if the thread exited BEFORE flushing, so we don't miss any events it
+		 * wrote between us flushing and checking.
+		*/
+		bool thread_exited = (*te)->thread_exited;
+		
+		flush_thread_events(te->get(), flush_guard);
+		
+		if(thread_exited)
+		{
+			te = thread_events->erase(te);
+		}
+		else{
+			++te;
+		}
+	}
+}
+
+void REHex::ProfilingCollector::set_trace_enabled(bool enabled)
+{
+	std::unique_lock<std::mutex> flush_guard(flush_mutex);
+	trace_enabled = enabled;
+}
+
+static void write_json_string(FILE *fh, const std::string &s)
+{
+	fputc('"', fh);
+	
+	for(auto c = s.begin(); c != s.end(); ++c)
+	{
+		if(*c == '"' || *c == '\\')
+		{
+			fputc('\\', fh);
+			fputc(*c, fh);
+		}
+		else if((unsigned char)(*c) < 0x20)
+		{
+			fprintf(fh, "\\u%04x", (unsigned)(*c));
+		}
+		else{
+			fputc(*c, fh);
+		}
+	}
+	
+	fputc('"', fh);
+}
+
+void REHex::ProfilingCollector::write_trace(const std::string &filename)
+{
+	flush_events();
+	
+	std::vector<TraceEvent> events;
+	
+	{
+		std::unique_lock<std::mutex> flush_guard(flush_mutex);
+		
+		if(trace_events != NULL)
+		{
+			events.assign(trace_events->begin(), trace_events->end());
+		}
+	}
+	
+	FILE *fh = fopen(filename.c_str(), "wb");
+	if(fh == NULL)
+	{
+		throw std::runtime_error(std::string("Unable to open ") + filename + ": " + strerror(errno));
+	}
+	
+	/* Timestamps are written relative to the first event to keep them readable. */
+	
+	uint64_t base_time = UINT64_MAX;
+	for(auto e = events.begin(); e != events.end(); ++e)
+	{
+		base_time = std::min(base_time, e->begin_time);
+	}
+	
+	fprintf(fh, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	
+	std::map<unsigned int, ThreadGroup> threads;
+	bool first = true;
+	
+	for(auto e = events.begin(); e != events.end(); ++e)
+	{
+		threads.emplace(e->thread_id, e->thread_group);
+		
+		fprintf(fh, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 ",\"name\":",
+			(first ? "" : ",\n"), e->thread_id, (e->begin_time - base_time), e->duration);
+		
+		write_json_string(fh, e->collector->get_key());
+		fprintf(fh, "}");
+		
+		first = false;
+	}
+	
+	/* Name each thread after its group, so thread pool workers can be told apart from
+	 * the UI thread in the viewer.
+	*/
+	
+	for(auto t = threads.begin(); t != threads.end(); ++t)
+	{
+		std::string thread_name = t->second == ThreadGroup::MAIN
+			? "Main thread"
+			: "Thread pool #" + std::to_string(t->first);
+		
+		fprintf(fh, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":",
+			(first ? "" : ",\n"), t->first);
+		
+		write_json_string(fh, thread_name);
+		fprintf(fh, "}}");
+		
+		first = false;
+	}
+	
+	fprintf(fh, "\n]}\n");
+	
+	bool write_failed = ferror(fh) != 0;
+	write_failed = (fclose(fh) != 0) || write_failed;
+	
+	if(write_failed)
+	{
+		throw std::runtime_error(std::string("Error writing ") + filename);
+	}
 }
 
 uint64_t REHex::ProfilingCollector::get_monotonic_us()
@@ -93,6 +353,19 @@ REHex::ProfilingCollector::ProfilingCollector(const std::string &key, ProfilingC
 
 REHex::ProfilingCollector::~ProfilingCollector()
 {
+	/* Collectors are only destroyed when the program exits, make sure there aren't any
+	 * events left which refer to this one.
+	*/
+	flush_events();
+	
+	std::unique_lock<std::mutex> flush_guard(flush_mutex);
+	
+	if(trace_events != NULL)
+	{
+		delete trace_events;
+		trace_events = NULL;
+	}
+	
 	collectors->erase(this_iter);
 	
 	if(collectors->empty())
@@ -132,8 +405,6 @@ REHex::ProfilingCollector::Stats REHex::ProfilingCollector::accumulate_stats(Thr
 
 void REHex::ProfilingCollector::record_time(uint64_t begin_time, uint64_t duration)
 {
-	uint64_t now_time_bucket = get_monotonic_us() / (SLOT_DURATION_MS * 1000);
-	
 	if(thread_group == ThreadGroup::UNKNOWN)
 	{
 		abort();
@@ -143,13 +414,50 @@ void REHex::ProfilingCollector::record_time(uint64_t begin_time, uint64_t durati
 		return;
 	}
 	
-	ThreadGroupStats &tgs = tg_stats[ (size_t)(thread_group) ];
+	ThreadEvents *te = get_thread_events();
+	
+	size_t head = te->head.load(std::memory_order_relaxed);
+	size_t tail = te->tail.load(std::memory_order_acquire);
+	
+	if((head - tail) >= ThreadEvents::FLUSH_THRESHOLD)
+	{
+		/* Our buffer is filling up, process it now unless someone else is already
+		 * flushing (in which case they will get to it soon).
+		*/
+		
+		std::unique_lock<std::mutex> flush_guard(flush_mutex, std::try_to_lock);
+		if(flush_guard.owns_lock())
+		{
+			flush_thread_events(te, flush_guard);
+			tail = te->tail.load(std::memory_order_relaxed);
+		}
+	}
+	
+	if((head - tail) >= ThreadEvents::RING_SIZE)
+	{
+		/* Buffer is full, drop the event rather than blocking. */
+		return;
+	}
+	
+	ThreadEvents::Event &event = te->ring[head & (ThreadEvents::RING_SIZE - 1)];
+	event.collector = this;
+	event.thread_group = thread_group;
+	event.begin_time = begin_time;
+	event.duration = duration;
+	
+	te->head.store((head + 1), std::memory_order_release);
+}
+
+void REHex::ProfilingCollector::aggregate_time(ThreadGroup group, uint64_t begin_time, uint64_t duration)
+{
+	uint64_t end_time_bucket = (begin_time + duration) / (SLOT_DURATION_MS * 1000);
+	
+	ThreadGroupStats &tgs = tg_stats[ (size_t)(group) ];
 	std::unique_lock<std::mutex> tgs_lock(tgs.mutex);
 	
-	if(now_time_bucket != tgs.head_time_bucket)
+	if(end_time_bucket > tgs.head_time_bucket)
 	{
-		assert(now_time_bucket > tgs.head_time_bucket);
-		uint64_t shift_by = now_time_bucket - tgs.head_time_bucket;
+		uint64_t shift_by = end_time_bucket - tgs.head_time_bucket;
 		
 		size_t slots_to_keep = 0;
 		if(shift_by < NUM_SLOTS)
@@ -160,7 +468,7 @@ void REHex::ProfilingCollector::record_time(uint64_t begin_time, uint64_t durati
 		
 		tgs.reset(tgs_lock, 0, NUM_SLOTS - slots_to_keep);
 		
-		tgs.head_time_bucket = now_time_bucket;
+		tgs.head_time_bucket = end_time_bucket;
 	}
 	
 	uint64_t begin_time_bucket = begin_time / (SLOT_DURATION_MS * 1000);
@@ -260,6 +568,78 @@ REHex::ProfilingCollector::Stats &REHex::ProfilingCollector::Stats::operator+=(c
 	return *this;
 }
 
+std::list<REHex::ProfilingCounter*> *REHex::ProfilingCounter::counters = NULL;
+std::mutex REHex::ProfilingCounter::counters_lock;
+
+REHex::ProfilingCounter::ProfilingCounter(const std::string &key):
+	key(key),
+	value(0)
+{
+	std::unique_lock<std::mutex> cl_guard(counters_lock);
+	
+	if(counters == NULL)
+	{
+		counters = new std::list<ProfilingCounter*>();
+	}
+	
+	counters->emplace_back(this);
+	this_iter = std::prev(counters->end());
+}
+
+REHex::ProfilingCounter::~ProfilingCounter()
+{
+	std::unique_lock<std::mutex> cl_guard(counters_lock);
+	
+	counters->erase(this_iter);
+	
+	if(counters->empty())
+	{
+		delete counters;
+		counters = NULL;
+	}
+}
+
+const std::string &REHex::ProfilingCounter::get_key() const
+{
+	return key;
+}
+
+uint64_t REHex::ProfilingCounter::get_value() const
+{
+	return value.load(std::memory_order_relaxed);
+}
+
+std::map<std::string, uint64_t> REHex::ProfilingCounter::get_counters()
+{
+	std::unique_lock<std::mutex> cl_guard(counters_lock);
+	
+	std::map<std::string, uint64_t> result;
+	
+	if(counters != NULL)
+	{
+		for(auto c = counters->begin(); c != counters->end(); ++c)
+		{
+			/* The same counter name may be used from more than one place. */
+			result[ (*c)->get_key() ] += (*c)->get_value();
+		}
+	}
+	
+	return result;
+}
+
+void REHex::ProfilingCounter::reset_counters()
+{
+	std::unique_lock<std::mutex> cl_guard(counters_lock);
+	
+	if(counters != NULL)
+	{
+		for(auto c = counters->begin(); c != counters->end(); ++c)
+		{
+			(*c)->value.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
 REHex::AutoBlockProfiler::AutoBlockProfiler(ProfilingCollector *collector):
 	collector(collector)
 {
@@ -323,15 +703,38 @@ REHex::ProfilingWindow::ProfilingWindow(wxWindow *parent):
 	/* NOTE: This has to come after AssociateModel, or it will segfault. */
 	name_col->SetSortOrder(true);
 	
+	wxDataViewListCtrl *counters_dvc = new wxDataViewListCtrl(this, wxID_ANY, wxDefaultPosition, wxSize(-1, 120));
+	counters_dvc->AppendTextColumn("Counter", wxDATAVIEW_CELL_INERT, 400);
+	counters_dvc->AppendTextColumn("Value");
+	
+	auto update_counters = [counters_dvc]()
+	{
+		counters_dvc->DeleteAllItems();
+		
+		std::map<std::string, uint64_t> counters = ProfilingCounter::get_counters();
+		for(auto c = counters.begin(); c != counters.end(); ++c)
+		{
+			wxVector<wxVariant> row;
+			row.push_back(wxVariant(c->first));
+			row.push_back(wxVariant(wxString::Format("%" PRIu64, c->second)));
+			
+			counters_dvc->AppendItem(row);
+		}
+	};
+	
+	update_counters();
+	
 	wxButton *reset_btn = new wxButton(this, wxID_ANY, "Reset");
 	reset_btn->Bind(wxEVT_BUTTON, [](wxCommandEvent &event)
 	{
 		ProfilingCollector::reset_collectors();
+		ProfilingCounter::reset_counters();
 	});
 	
 	Bind(wxEVT_TIMER, [=](wxTimerEvent &event)
 	{
 		model->update();
+		update_counters();
 	}, ID_UPDATE_TIMER, ID_UPDATE_TIMER);
 	
 	wxBoxSizer *duration_sizer = new wxBoxSizer(wxHORIZONTAL);
@@ -372,6 +775,37 @@ REHex::ProfilingWindow::ProfilingWindow(wxWindow *parent):
 	add_tg_button("Main thread",  ProfilingCollector::ThreadGroup::MAIN, true);
 	add_tg_button("Thread pool",  ProfilingCollector::ThreadGroup::POOL);
 	
+	wxCheckBox *trace_btn = new wxCheckBox(this, wxID_ANY, "Record timeline");
+	
+	Bind(wxEVT_CHECKBOX, [=](wxCommandEvent &event)
+	{
+		ProfilingCollector::set_trace_enabled(event.IsChecked());
+	}, trace_btn->GetId(), trace_btn->GetId());
+	
+	wxButton *export_btn = new wxButton(this, wxID_ANY, "Export timeline...");
+	export_btn->Bind(wxEVT_BUTTON, [this](wxCommandEvent &event)
+	{
+		wxFileDialog save_dialog(this, "Export timeline", wxEmptyString, "rehex-trace.json", "Trace files (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+		if(save_dialog.ShowModal() == wxID_CANCEL)
+		{
+			return;
+		}
+		
+		try {
+			ProfilingCollector::write_trace(save_dialog.GetPath().ToStdString());
+		}
+		catch(const std::exception &e)
+		{
+			wxMessageBox(
+				std::string("Error exporting timeline: ") + e.what(),
+				"Error", wxICON_ERROR, this);
+		}
+	});
+	
+	wxBoxSizer *trace_sizer = new wxBoxSizer(wxHORIZONTAL);
+	trace_sizer->Add(trace_btn, 0, wxALIGN_CENTER_VERTICAL);
+	trace_sizer->Add(export_btn);
+	
 	wxCheckBox *pause_btn = new wxCheckBox(this, wxID_ANY, "Pause");
 	
 	Bind(wxEVT_CHECKBOX, [=](wxCommandEvent &event)
@@ -382,15 +816,18 @@ REHex::ProfilingWindow::ProfilingWindow(wxWindow *parent):
 		}
 		else{
 			model->update();
+			update_counters();
 			update_timer.Start(-1, wxTIMER_CONTINUOUS);
 		}
 	}, pause_btn->GetId(), pause_btn->GetId());
 	
 	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 	sizer->Add(dvc, 1, wxEXPAND);
+	sizer->Add(counters_dvc, 0, wxEXPAND);
 	sizer->Add(reset_btn);
 	sizer->Add(duration_sizer);
 	sizer->Add(thread_group_sizer);
+	sizer->Add(trace_sizer);
 	sizer->Add(pause_btn);
 	SetSizer(sizer);
 }
@@ -416,6 +853,8 @@ void REHex::ProfilingDataViewModel::set_thread_group(ProfilingCollector::ThreadG
 
 void REHex::ProfilingDataViewModel::update()
 {
+	ProfilingCollector::flush_events();
+	
 	auto collectors = ProfilingCollector::get_collectors(thread_group);
 	
 	for(auto c = collectors.begin(); c != collectors.end(); ++c)
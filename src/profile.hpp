@@ -20,8 +20,11 @@
 
 #ifdef REHEX_PROFILE
 
+#include <atomic>
+#include <deque>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <stdint.h>
 #include <string>
@@ -43,6 +46,12 @@
 	static ProfilingCollector block_collector(name, block_collector_parent); \
 	AutoBlockProfiler abp(&block_collector);
 
+#define PROFILE_COUNT(name, n) \
+	{ \
+		static ProfilingCounter profile_counter(name); \
+		profile_counter.add(n); \
+	}
+
 namespace REHex
 {
 	class ProfilingCollector
@@ -72,10 +81,56 @@ namespace REHex
 				Stats &operator+=(const Stats &rhs);
 			};
 			
+			/**
+			 * @brief A single completed profiled block, as recorded for the timeline.
+			*/
+			struct TraceEvent
+			{
+				const ProfilingCollector *collector;
+				unsigned int thread_id;
+				ThreadGroup thread_group;
+				
+				uint64_t begin_time;
+				uint64_t duration;
+				
+				TraceEvent(const ProfilingCollector *collector, unsigned int thread_id, ThreadGroup thread_group, uint64_t begin_time, uint64_t duration):
+					collector(collector), thread_id(thread_id), thread_group(thread_group), begin_time(begin_time), duration(duration) {}
+			};
+			
+			/**
+			 * @brief Maximum number of events to keep for the timeline.
+			 *
+			 * Once the limit is reached, the oldest events are discarded.
+			*/
+			static const size_t TRACE_MAX_EVENTS = 2000000;
+			
 		private:
 			static std::list<ProfilingCollector*> *collectors;
 			static thread_local ThreadGroup thread_group;
 			
+			/**
+			 * @brief Ring buffer of blocks completed by a single thread.
+			 *
+			 * Each thread only appends to its own ring, without taking any locks. The
+			 * events are consumed and added to the per-collector stats in batches by
+			 * flush_events(), either periodically from the UI or by the owning thread
+			 * when its ring starts filling up.
+			*/
+			class ThreadEvents;
+			
+			static thread_local std::shared_ptr<ThreadEvents> this_thread_events;
+			
+			static std::mutex flush_mutex;
+			static std::list< std::shared_ptr<ThreadEvents> > *thread_events;
+			static std::mutex thread_events_mutex;
+			
+			static bool trace_enabled;
+			static std::deque<TraceEvent> *trace_events;
+			
+			static ThreadEvents *get_thread_events();
+			
+			static void flush_thread_events(ThreadEvents *te, const std::unique_lock<std::mutex> &flush_guard);
+			
 			std::list<ProfilingCollector*>::iterator this_iter;
 			
 			std::string key;
@@ -100,6 +155,8 @@ namespace REHex
 			
 			void reset(size_t begin_idx = 0, size_t end_idx = NUM_SLOTS);
 			
+			void aggregate_time(ThreadGroup group, uint64_t begin_time, uint64_t duration);
+			
 		public:
 			ProfilingCollector(const std::string &key, ProfilingCollector *parent = NULL);
 			~ProfilingCollector();
@@ -117,9 +174,70 @@ namespace REHex
 			static std::list<ProfilingCollector*> get_collectors(ThreadGroup group);
 			static void reset_collectors();
 			
+			/**
+			 * @brief Process any events waiting in per-thread buffers.
+			*/
+			static void flush_events();
+			
+			/**
+			 * @brief Enable or disable recording events for the timeline.
+			*/
+			static void set_trace_enabled(bool enabled);
+			
+			/**
+			 * @brief Write the recorded timeline to a file.
+			 *
+			 * The file is written in the Chrome trace event JSON format, which can be
+			 * opened in Perfetto (https://ui.perfetto.dev/) or chrome://tracing.
+			 *
+			 * Throws std::runtime_error on failure.
+			*/
+			static void write_trace(const std::string &filename);
+			
 			static uint64_t get_monotonic_us();
 	};
 	
+	/**
+	 * @brief Named event counter for the profiling window.
+	 *
+	 * Unlike ProfilingCollector, counters aren't timed or bucketed by thread group, they
+	 * just accumulate the number of times something (e.g. a cache hit) has happened since
+	 * the last reset. Use the PROFILE_COUNT() macro rather than creating these directly.
+	*/
+	class ProfilingCounter
+	{
+		private:
+			static std::list<ProfilingCounter*> *counters;
+			static std::mutex counters_lock;
+			
+			std::list<ProfilingCounter*>::iterator this_iter;
+			
+			std::string key;
+			std::atomic<uint64_t> value;
+			
+		public:
+			ProfilingCounter(const std::string &key);
+			~ProfilingCounter();
+			
+			ProfilingCounter(const ProfilingCounter&) = delete;
+			ProfilingCounter &operator=(const ProfilingCounter&) = delete;
+			
+			const std::string &get_key() const;
+			uint64_t get_value() const;
+			
+			void add(uint64_t n)
+			{
+				value.fetch_add(n, std::memory_order_relaxed);
+			}
+			
+			/**
+			 * @brief Get a snapshot of the key and value of every counter.
+			*/
+			static std::map<std::string, uint64_t> get_counters();
+			
+			static void reset_counters();
+	};
+	
 	class AutoBlockProfiler
 	{
 		private:
@@ -176,6 +294,7 @@ namespace REHex
 #define PROFILE_SET_THREAD_GROUP(group)
 #define PROFILE_BLOCK(name)
 #define PROFILE_INNER_BLOCK(name)
+#define PROFILE_COUNT(name, n)
 
 #endif /* !REHEX_PROFILE */
 
@@ -21,15 +21,29 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <assert.h>
 #include <ctype.h>
 #include <float.h>
 #include <inttypes.h>
+#include <portable_endian.h>
+#include <stdint.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <wx/filename.h>
 #include <wx/numformatter.h>
 #include <wx/utils.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REHEX_MEMCPY_SHIFT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER) && (defined(__x86_64__) || defined(__i386__))
+#define REHEX_MEMCPY_SHIFT_AVX2
+#include <immintrin.h>
+#endif
+
 #include "App.hpp"
 #include "CharacterEncoder.hpp"
 #include "DataType.hpp"
@@ -493,32 +507,200 @@ double REHex::parse_double(const std::string &s)
 	return n;
 }
 
-REHex::CarryBits REHex::memcpy_left(void *dst, const void *src, size_t n, int shift)
+/* The bit shifting copies below are used whenever data is read or written at an offset which
+ * isn't byte aligned, so they are written to process as many bytes at a time as possible.
+ *
+ * Data is treated as a big-endian stream of bits, so a generic 64-bit implementation loads 8
+ * bytes as a big-endian word, shifts it and fills in the bits shifted in from the adjacent byte.
+ *
+ * On x86, SSE2 (always available on x86-64) and AVX2 (detected at runtime) versions shift 16 or
+ * 32 bytes at a time. There are no 8-bit vector shifts, so each byte is shifted as part of a
+ * 16-bit lane and any bits which crossed into the other byte in the lane are masked off.
+ *
+ * Each kernel processes whole blocks from the start of the range and returns how many bytes it
+ * handled, anything left over is finished off by the next smaller kernel.
+*/
+
+static inline uint64_t load_be64(const unsigned char *p)
 {
-	if(shift == 0)
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	
+	return be64toh(v);
+}
+
+static inline void store_be64(unsigned char *p, uint64_t v)
+{
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/* Kernels for memcpy_left()
+ *
+ * dst[i] = (src[i] << shift) | (src[i + 1] >> (8 - shift))
+ *
+ * Every byte written depends on the byte after it, so each kernel stops one byte short of the
+ * end of the source buffer.
+*/
+
+#ifdef REHEX_MEMCPY_SHIFT_AVX2
+__attribute__((target("avx2")))
+static size_t memcpy_left_avx2(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	const __m128i lcount = _mm_cvtsi32_si128(shift);
+	const __m128i rcount = _mm_cvtsi32_si128(8 - shift);
+	
+	const __m256i hi_mask = _mm256_set1_epi8((char)((0xFF << shift) & 0xFF));
+	const __m256i lo_mask = _mm256_set1_epi8((char)(0xFF >> (8 - shift)));
+	
+	size_t i = 0;
+	
+	for(; (i + 33) <= n; i += 32)
 	{
-		memcpy(dst, src, n);
-		return CarryBits();
+		__m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 1));
+		
+		__m256i hi = _mm256_and_si256(_mm256_sll_epi16(a, lcount), hi_mask);
+		__m256i lo = _mm256_and_si256(_mm256_srl_epi16(b, rcount), lo_mask);
+		
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(hi, lo));
+	}
+	
+	return i;
+}
+#endif
+
+#ifdef REHEX_MEMCPY_SHIFT_SSE2
+static size_t memcpy_left_sse2(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	const __m128i lcount = _mm_cvtsi32_si128(shift);
+	const __m128i rcount = _mm_cvtsi32_si128(8 - shift);
+	
+	const __m128i hi_mask = _mm_set1_epi8((char)((0xFF << shift) & 0xFF));
+	const __m128i lo_mask = _mm_set1_epi8((char)(0xFF >> (8 - shift)));
+	
+	size_t i = 0;
+	
+	for(; (i + 17) <= n; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i + 1));
+		
+		__m128i hi = _mm_and_si128(_mm_sll_epi16(a, lcount), hi_mask);
+		__m128i lo = _mm_and_si128(_mm_srl_epi16(b, rcount), lo_mask);
+		
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(hi, lo));
+	}
+	
+	return i;
+}
+#endif
+
+static size_t memcpy_left_u64(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	size_t i = 0;
+	
+	for(; (i + 9) <= n; i += 8)
+	{
+		uint64_t word = load_be64(src + i);
+		store_be64((dst + i), ((word << shift) | (src[i + 8] >> (8 - shift))));
+	}
+	
+	return i;
+}
+
+/* Kernels for memcpy_right()
+ *
+ * dst[i] = (src[i - 1] << (8 - shift)) | (src[i] >> shift)
+ *
+ * The first byte is merged into the existing destination byte, so the kernels are given
+ * buffers starting from the second byte with the preceeding source byte still readable.
+*/
+
+#ifdef REHEX_MEMCPY_SHIFT_AVX2
+__attribute__((target("avx2")))
+static size_t memcpy_right_avx2(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	const __m128i lcount = _mm_cvtsi32_si128(8 - shift);
+	const __m128i rcount = _mm_cvtsi32_si128(shift);
+	
+	const __m256i hi_mask = _mm256_set1_epi8((char)((0xFF << (8 - shift)) & 0xFF));
+	const __m256i lo_mask = _mm256_set1_epi8((char)(0xFF >> shift));
+	
+	size_t i = 0;
+	
+	for(; (i + 32) <= n; i += 32)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(src + i - 1));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+		
+		__m256i hi = _mm256_and_si256(_mm256_sll_epi16(a, lcount), hi_mask);
+		__m256i lo = _mm256_and_si256(_mm256_srl_epi16(b, rcount), lo_mask);
+		
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(hi, lo));
 	}
 	
-	/* shift = 1, mask_a = 01111111, mask_b = 10000000
-	 * shift = 2, mask_a = 00111111, mask_b = 11000000
-	 * shift = 3, mask_a = 00011111, mask_b = 11100000
-	 * shift = 4, mask_a = 00001111, mask_b = 11110000
-	 * shift = 5, mask_a = 00000111, mask_b = 11111000
-	 * shift = 6, mask_a = 00000011, mask_b = 11111100
-	 * shift = 7, mask_a = 00000001, mask_b = 11111110
-	*/
+	return i;
+}
+#endif
+
+#ifdef REHEX_MEMCPY_SHIFT_SSE2
+static size_t memcpy_right_sse2(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	const __m128i lcount = _mm_cvtsi32_si128(8 - shift);
+	const __m128i rcount = _mm_cvtsi32_si128(shift);
+	
+	const __m128i hi_mask = _mm_set1_epi8((char)((0xFF << (8 - shift)) & 0xFF));
+	const __m128i lo_mask = _mm_set1_epi8((char)(0xFF >> shift));
+	
+	size_t i = 0;
+	
+	for(; (i + 16) <= n; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(src + i - 1));
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+		
+		__m128i hi = _mm_and_si128(_mm_sll_epi16(a, lcount), hi_mask);
+		__m128i lo = _mm_and_si128(_mm_srl_epi16(b, rcount), lo_mask);
+		
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(hi, lo));
+	}
 	
-	unsigned char mask_a = 0xFF;
-	unsigned char mask_b = 0x00;
+	return i;
+}
+#endif
+
+static size_t memcpy_right_u64(unsigned char *dst, const unsigned char *src, size_t n, int shift)
+{
+	size_t i = 0;
 	
-	for(int i = 0; i < shift; ++i)
+	for(; (i + 8) <= n; i += 8)
 	{
-		mask_a &= ~((unsigned char)(128) >> i);
-		mask_b |=  ((unsigned char)(128) >> i);
+		uint64_t word = load_be64(src + i);
+		store_be64((dst + i), (((uint64_t)(src[i - 1]) << (64 - shift)) | (word >> shift)));
 	}
 	
+	return i;
+}
+
+#ifdef REHEX_MEMCPY_SHIFT_AVX2
+static bool cpu_has_avx2()
+{
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	return has_avx2;
+}
+#endif
+
+REHex::CarryBits REHex::memcpy_left(void *dst, const void *src, size_t n, int shift)
+{
+	if(shift == 0)
+	{
+		memcpy(dst, src, n);
+		return CarryBits();
+	}
+	
+	assert(shift > 0 && shift < 8);
+	
 	int rshift = 8 - shift;
 	
 	unsigned char *dst_p = (unsigned char*)(dst);
@@ -528,26 +710,33 @@ REHex::CarryBits REHex::memcpy_left(void *dst, const void *src, size_t n, int sh
 	unsigned char carry_mask = 0;
 	if(n > 1)
 	{
-		carry = (*src_p & mask_b) >> rshift;
-		
-		for(int i = 0; i < shift; ++i)
-		{
-			carry_mask <<= 1;
-			carry_mask |= 1;
-		}
+		carry = *src_p >> rshift;
+		carry_mask = 0xFF >> rshift;
 	}
 	
-	while(n > 1)
+	size_t i = 0;
+	
+	#ifdef REHEX_MEMCPY_SHIFT_AVX2
+	if(cpu_has_avx2())
 	{
-		*dst_p = ((*src_p & mask_a) << shift) | ((*(src_p + 1) & mask_b) >> rshift);
-		++src_p;
-		++dst_p;
-		--n;
+		i += memcpy_left_avx2((dst_p + i), (src_p + i), (n - i), shift);
 	}
+	#endif
+	
+	#ifdef REHEX_MEMCPY_SHIFT_SSE2
+	i += memcpy_left_sse2((dst_p + i), (src_p + i), (n - i), shift);
+	#endif
 	
-	if(n > 0)
+	i += memcpy_left_u64((dst_p + i), (src_p + i), (n - i), shift);
+	
+	for(; (i + 1) < n; ++i)
 	{
-		*dst_p = (*src_p & mask_a) << shift;
+		dst_p[i] = (src_p[i] << shift) | (src_p[i + 1] >> rshift);
+	}
+	
+	if(i < n)
+	{
+		dst_p[i] = src_p[i] << shift;
 	}
 	
 	return CarryBits(carry, carry_mask);
@@ -561,41 +750,39 @@ REHex::CarryBits REHex::memcpy_right(void *dst, const void *src, size_t n, int s
 		return CarryBits();
 	}
 	
-	/* shift = 1, mask_a = 11111110, mask_b = 00000001
-	 * shift = 2, mask_a = 11111100, mask_b = 00000011
-	 * shift = 3, mask_a = 11111000, mask_b = 00000111
-	 * shift = 4, mask_a = 11110000, mask_b = 00001111
-	 * shift = 5, mask_a = 11100000, mask_b = 00011111
-	 * shift = 6, mask_a = 11000000, mask_b = 00111111
-	 * shift = 7, mask_a = 10000000, mask_b = 01111111
-	*/
-	
-	unsigned char mask_a = 0xFF;
-	unsigned char mask_b = 0x00;
-	
-	for(int i = 0; i < shift; ++i)
-	{
-		mask_a &= ~((unsigned char)(1) << i);
-		mask_b |=  ((unsigned char)(1) << i);
-	}
+	assert(shift > 0 && shift < 8);
 	
 	int lshift = 8 - shift;
 	
 	unsigned char *dst_p = (unsigned char*)(dst);
 	const unsigned char *src_p = (const unsigned char*)(src);
 	
-	*dst_p &= ~(mask_a >> shift);
-	*dst_p |= ((*src_p & mask_a) >> shift);
-	--n;
+	/* The first byte is merged with the bits to the left of where we are copying to. */
+	
+	unsigned char first_mask = 0xFF >> shift;
+	dst_p[0] = (dst_p[0] & ~first_mask) | (src_p[0] >> shift);
+	
+	size_t i = 1;
+	
+	#ifdef REHEX_MEMCPY_SHIFT_AVX2
+	if(cpu_has_avx2())
+	{
+		i += memcpy_right_avx2((dst_p + i), (src_p + i), (n - i), shift);
+	}
+	#endif
+	
+	#ifdef REHEX_MEMCPY_SHIFT_SSE2
+	i += memcpy_right_sse2((dst_p + i), (src_p + i), (n - i), shift);
+	#endif
+	
+	i += memcpy_right_u64((dst_p + i), (src_p + i), (n - i), shift);
 	
-	while(n > 0)
+	for(; i < n; ++i)
 	{
-		*(++dst_p) = ((*src_p & mask_b) << lshift) | ((*(src_p + 1) & mask_a) >> shift);
-		++src_p;
-		--n;
+		dst_p[i] = (src_p[i - 1] << lshift) | (src_p[i] >> shift);
 	}
 	
-	return CarryBits(((*src_p & mask_b) << lshift), (mask_b << lshift));
+	return CarryBits((unsigned char)(src_p[n - 1] << lshift), (unsigned char)(0xFF << lshift));
 }
 
 json_t *REHex::colour_to_json(const wxColour &colour)
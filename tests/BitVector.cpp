@@ -0,0 +1,170 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../src/BitVector.hpp"
+
+using namespace REHex;
+
+static bool get_bit(const std::vector<unsigned char> &data, size_t offset)
+{
+	return (data[offset / 8] & (0x80 >> (offset % 8))) != 0;
+}
+
+static void set_bit(std::vector<unsigned char> &data, size_t offset, bool value)
+{
+	if(value)
+	{
+		data[offset / 8] |= (0x80 >> (offset % 8));
+	}
+	else{
+		data[offset / 8] &= ~(0x80 >> (offset % 8));
+	}
+}
+
+TEST(BitVector, Construct)
+{
+	EXPECT_EQ(BitVector().size(), 0U);
+	EXPECT_TRUE(BitVector().empty());
+	
+	BitVector zeros(12);
+	EXPECT_EQ(zeros.size(), 12U);
+	EXPECT_EQ(zeros.bytes(), std::vector<unsigned char>({ 0x00, 0x00 }));
+	
+	BitVector ones(12, true);
+	EXPECT_EQ(ones.size(), 12U);
+	EXPECT_EQ(ones.bytes(), std::vector<unsigned char>({ 0xFF, 0xF0 }));
+	
+	BitVector list = { 1, 0, 1, 1, 0, 0, 0, 0, 1 };
+	EXPECT_EQ(list.size(), 9U);
+	EXPECT_EQ(list.bytes(), std::vector<unsigned char>({ 0xB0, 0x80 }));
+	
+	BitVector vec(std::vector<bool>({ 1, 0, 1, 1, 0, 0, 0, 0, 1 }));
+	EXPECT_EQ(vec, list);
+	EXPECT_EQ(vec.to_vector(), std::vector<bool>({ 1, 0, 1, 1, 0, 0, 0, 0, 1 }));
+	
+	static const unsigned char DATA[] = { 0x12, 0x34, 0x56 };
+	
+	BitVector from_buf(DATA, 4, 12);
+	EXPECT_EQ(from_buf.size(), 12U);
+	EXPECT_EQ(from_buf.bytes(), std::vector<unsigned char>({ 0x23, 0x40 }));
+}
+
+TEST(BitVector, PushBackAndAppend)
+{
+	BitVector bits;
+	
+	bits.push_back(true);
+	bits.push_back(false);
+	bits.push_back(true);
+	
+	EXPECT_EQ(bits, BitVector({ 1, 0, 1 }));
+	
+	bits.append(BitVector({ 1, 1, 1, 1, 0, 0, 0, 0, 1 }));
+	
+	EXPECT_EQ(bits, BitVector({ 1, 0, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1 }));
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>({ 0xBE, 0x10 }));
+	
+	bits.append(BitVector());
+	EXPECT_EQ(bits.size(), 12U);
+}
+
+TEST(BitVector, Resize)
+{
+	BitVector bits(16, true);
+	
+	bits.resize(3);
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>({ 0xE0 }));
+	
+	bits.resize(10);
+	EXPECT_EQ(bits, BitVector({ 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 }));
+	
+	bits.clear();
+	EXPECT_TRUE(bits.empty());
+}
+
+TEST(BitVector, Slice)
+{
+	BitVector bits = { 1, 0, 1, 1, 0, 0, 1, 1, 1, 0 };
+	
+	EXPECT_EQ(bits.slice(0, 10), bits);
+	EXPECT_EQ(bits.slice(2, 4), BitVector({ 1, 1, 0, 0 }));
+	EXPECT_EQ(bits.slice(6, 100), BitVector({ 1, 1, 1, 0 }));
+	EXPECT_EQ(bits.slice(10, 1), BitVector());
+	EXPECT_EQ(bits.slice(20, 1), BitVector());
+}
+
+TEST(BitVector, CopyTo)
+{
+	std::vector<unsigned char> buf = { 0xFF, 0xFF, 0xFF };
+	
+	BitVector({ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }).copy_to(buf.data(), 5);
+	EXPECT_EQ(buf, std::vector<unsigned char>({ 0xF8, 0x01, 0xFF }));
+	
+	BitVector({ 1, 0, 1, 0, 1, 0 }).copy_to(buf.data(), 8, 1, 4);
+	EXPECT_EQ(buf, std::vector<unsigned char>({ 0xF8, 0x51, 0xFF }));
+}
+
+TEST(BitVector, CopyBits)
+{
+	/* Compare copy_bits() against copying one bit at a time for all combinations of
+	 * alignment and a range of lengths.
+	*/
+	
+	srand(0);
+	
+	std::vector<unsigned char> src(64);
+	for(size_t i = 0; i < src.size(); ++i)
+	{
+		src[i] = rand();
+	}
+	
+	for(size_t src_offset = 0; src_offset < 16; ++src_offset)
+	{
+		for(size_t dst_offset = 0; dst_offset < 16; ++dst_offset)
+		{
+			for(size_t length = 0; length < ((src.size() * 8) - 16); length += 7)
+			{
+				std::vector<unsigned char> dst(src.size(), 0xA5);
+				std::vector<unsigned char> expect = dst;
+				
+				for(size_t i = 0; i < length; ++i)
+				{
+					set_bit(expect, (dst_offset + i), get_bit(src, (src_offset + i)));
+				}
+				
+				BitVector::copy_bits(dst.data(), dst_offset, src.data(), src_offset, length);
+				
+				EXPECT_EQ(dst, expect) << "copy_bits(dst, " << dst_offset << ", src, " << src_offset << ", " << length << ")";
+			}
+		}
+	}
+}
+
+TEST(BitVector, Equality)
+{
+	EXPECT_TRUE(BitVector({ 1, 0, 1 }) == BitVector({ 1, 0, 1 }));
+	EXPECT_FALSE(BitVector({ 1, 0, 1 }) == BitVector({ 1, 0, 0 }));
+	EXPECT_FALSE(BitVector({ 1, 0, 1 }) == BitVector({ 1, 0, 1, 0 }));
+	
+	EXPECT_TRUE(BitVector({ 1, 0, 1 }) != BitVector({ 1, 0, 1, 0 }));
+	EXPECT_FALSE(BitVector({ 1, 0, 1 }) != BitVector({ 1, 0, 1 }));
+}
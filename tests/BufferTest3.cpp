@@ -18,6 +18,7 @@
 #include "BufferTest.h"
 
 #include <chrono>
+#include <sys/stat.h>
 #include <thread>
 
 #include "../src/FileReader.hpp"
@@ -802,7 +803,7 @@ TEST(Buffer, ReadBitsWholeFile)
 	
 	REHex::Buffer b(wxFileName(f1.tmpfile));
 	
-	std::vector<bool> bits = b.read_bits(REHex::BitOffset(0, 0), 100);
+	REHex::BitVector bits = b.read_bits(REHex::BitOffset(0, 0), 100);
 	
 	std::vector<bool> EXPECT = {
 		false, false, false, false, false, false, false, false, /* 0x00 */
@@ -825,7 +826,7 @@ TEST(Buffer, ReadBitsFromFile)
 	
 	REHex::Buffer b(wxFileName(f1.tmpfile));
 	
-	std::vector<bool> bits = b.read_bits(REHex::BitOffset(1, 2), 15);
+	REHex::BitVector bits = b.read_bits(REHex::BitOffset(1, 2), 15);
 	
 	std::vector<bool> EXPECT = {
 		/* false, false, false, false, false, false, false, false, */  /* 0x00 */
@@ -848,7 +849,7 @@ TEST(Buffer, ReadBitsAtEOF)
 	
 	REHex::Buffer b(wxFileName(f1.tmpfile));
 	
-	std::vector<bool> bits = b.read_bits(REHex::BitOffset(7, 5), 15);
+	REHex::BitVector bits = b.read_bits(REHex::BitOffset(7, 5), 15);
 	
 	std::vector<bool> EXPECT = {
 		/* false, false, false, false, false, false, false, false, */  /* 0x00 */
@@ -864,6 +865,34 @@ TEST(Buffer, ReadBitsAtEOF)
 	EXPECT_EQ(bits, EXPECT);
 }
 
+TEST(Buffer, ReadBitsPackedBytes)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+	
+	REHex::Buffer b(wxFileName(f1.tmpfile));
+	
+	REHex::BitVector bits = b.read_bits(REHex::BitOffset(1, 2), 15);
+	
+	EXPECT_EQ(bits.size(), 15U);
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>({ 0x04, 0x08 }));
+	
+	bits = b.read_bits(REHex::BitOffset(0, 0), 100);
+	
+	EXPECT_EQ(bits.size(), 64U);
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+	
+	bits = b.read_bits(REHex::BitOffset(7, 5), 15);
+	
+	EXPECT_EQ(bits.size(), 3U);
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>({ 0xE0 }));
+	
+	bits = b.read_bits(REHex::BitOffset(8, 0), 15);
+	
+	EXPECT_EQ(bits.size(), 0U);
+	EXPECT_EQ(bits.bytes(), std::vector<unsigned char>());
+}
+
 TEST(Buffer, SerialiseEmptyBufferNoFile)
 {
 	REHex::Buffer b1;
@@ -1221,3 +1250,521 @@ TEST(Buffer, SerialiseFullyModifiedBufferWithDeletedFile)
 
 	EXPECT_EQ(data_pattern(1024, (1024 * 1024)), read_file(data_file));
 }
+
+TEST(Buffer, CleanCacheLimit)
+{
+	std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	ASSERT_EQ(b.blocks.size(), 8U);
+	
+	EXPECT_EQ(b.get_clean_cache_limit(), (size_t)(REHex::Buffer::DEFAULT_CLEAN_CACHE_LIMIT));
+	
+	EXPECT_EQ(b.read_data(0, 64), file_data);
+	
+	for(size_t i = 0; i < 8; ++i)
+	{
+		EXPECT_EQ(b.blocks[i].state, REHex::Buffer::Block::CLEAN) << "Block " << i << " is loaded";
+	}
+	
+	/* Shrinking the limit should discard the least recently used blocks. */
+	
+	b.set_clean_cache_limit(24);
+	EXPECT_EQ(b.get_clean_cache_limit(), 24U);
+	
+	for(size_t i = 0; i < 8; ++i)
+	{
+		EXPECT_EQ(b.blocks[i].state, (i < 5 ? REHex::Buffer::Block::UNLOADED : REHex::Buffer::Block::CLEAN)) << "Block " << i << " state";
+		EXPECT_EQ(b.blocks[i].data.empty(), (i < 5)) << "Block " << i << " data";
+	}
+	
+	/* Reading an unloaded block should evict the oldest remaining one. */
+	
+	EXPECT_EQ(b.read_data(0, 8), data_pattern(0, 8));
+	
+	EXPECT_EQ(b.blocks[0].state, REHex::Buffer::Block::CLEAN);
+	EXPECT_EQ(b.blocks[5].state, REHex::Buffer::Block::UNLOADED);
+	EXPECT_EQ(b.blocks[6].state, REHex::Buffer::Block::CLEAN);
+	EXPECT_EQ(b.blocks[7].state, REHex::Buffer::Block::CLEAN);
+	
+	/* Dirty blocks don't count towards the limit and the most recently used clean block is
+	 * always retained.
+	*/
+	
+	const unsigned char X = 0xAA;
+	b.overwrite_data(56, &X, 1);
+	
+	b.set_clean_cache_limit(0);
+	
+	for(size_t i = 1; i < 7; ++i)
+	{
+		EXPECT_EQ(b.blocks[i].state, REHex::Buffer::Block::UNLOADED) << "Block " << i << " is unloaded";
+	}
+	
+	EXPECT_EQ(b.blocks[0].state, REHex::Buffer::Block::CLEAN);
+	EXPECT_EQ(b.blocks[7].state, REHex::Buffer::Block::DIRTY);
+	
+	file_data[56] = X;
+	EXPECT_EQ(b.read_data(0, 64), file_data);
+}
+
+TEST(Buffer, WriteInplaceProgress)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	/* Insert enough data at the start that the other blocks can be moved without loading them. */
+	const std::vector<unsigned char> insert_data(16, 0xFF);
+	ASSERT_TRUE(b.insert_data(0, insert_data.data(), insert_data.size()));
+	
+	std::vector<unsigned char> expect_data = insert_data;
+	expect_data.insert(expect_data.end(), file_data.begin(), file_data.end());
+	
+	std::vector< std::pair<off_t, off_t> > progress_calls;
+	
+	EXPECT_TRUE(b.write_inplace([&](off_t done, off_t total)
+	{
+		progress_calls.push_back(std::make_pair(done, total));
+		return true;
+	})) << "write_inplace() returns true when not cancelled";
+	
+	ASSERT_FALSE(progress_calls.empty());
+	EXPECT_EQ(progress_calls.front(), std::make_pair((off_t)(0), (off_t)(80))) << "First progress call reports nothing written";
+	EXPECT_EQ(progress_calls.back(), std::make_pair((off_t)(80), (off_t)(80))) << "Last progress call reports everything written";
+	
+	for(size_t i = 1; i < progress_calls.size(); ++i)
+	{
+		EXPECT_LE(progress_calls[i - 1].first, progress_calls[i].first) << "Progress never goes backwards";
+	}
+	
+	for(size_t i = 1; i < b.blocks.size(); ++i)
+	{
+		EXPECT_EQ(b.blocks[i].state, REHex::Buffer::Block::UNLOADED) << "Unmodified block " << i << " was moved without loading it";
+	}
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), expect_data) << "write_inplace() produces file with correct data";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer::read_data() returns correct data";
+}
+
+TEST(Buffer, WriteInplaceCancel)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	const std::vector<unsigned char> insert_data(16, 0xFF);
+	ASSERT_TRUE(b.insert_data(0, insert_data.data(), insert_data.size()));
+	
+	std::vector<unsigned char> expect_data = insert_data;
+	expect_data.insert(expect_data.end(), file_data.begin(), file_data.end());
+	
+	/* Cancel after the first block has been moved. */
+	
+	EXPECT_FALSE(b.write_inplace([&](off_t done, off_t total)
+	{
+		return done == 0;
+	})) << "write_inplace() returns false when cancelled";
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), file_data) << "Cancelled write_inplace() leaves file unchanged";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer::read_data() returns correct data after cancelled write";
+	
+	struct stat st;
+	EXPECT_NE(stat((std::string(tmpfile.tmpfile) + ".rehex-journal").c_str(), &st), 0) << "Cancelled write_inplace() removes journal";
+	
+	EXPECT_TRUE(b.write_inplace()) << "write_inplace() can complete after cancelled write";
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), expect_data) << "write_inplace() produces file with correct data";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer::read_data() returns correct data";
+	
+	/* Cancelling a write to a new file should leave no trace of it. */
+	
+	TempFilename tmpfile2;
+	
+	EXPECT_FALSE(b.write_inplace(wxFileName(tmpfile2.tmpfile), [&](off_t done, off_t total)
+	{
+		return false;
+	})) << "write_inplace() returns false when cancelled";
+	
+	EXPECT_NE(stat(tmpfile2.tmpfile, &st), 0) << "Cancelled write_inplace() removes new file";
+	
+	EXPECT_EQ(b.get_filename().GetFullPath().ToStdString(), std::string(tmpfile.tmpfile)) << "Cancelled write_inplace() doesn't change backing file";
+}
+
+TEST(Buffer, WriteInplaceCancelOverlappingMoves)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	/* Insert less than a block at the start, so every block moves over part of itself. */
+	const unsigned char X = 0xFF;
+	ASSERT_TRUE(b.insert_data(0, &X, 1));
+	
+	std::vector<unsigned char> expect_data = file_data;
+	expect_data.insert(expect_data.begin(), X);
+	
+	EXPECT_FALSE(b.write_inplace([&](off_t done, off_t total)
+	{
+		return done < (total / 2);
+	})) << "write_inplace() returns false when cancelled";
+	
+	for(size_t i = 1; i < b.blocks.size(); ++i)
+	{
+		EXPECT_EQ(b.blocks[i].state, REHex::Buffer::Block::UNLOADED) << "Unmodified block " << i << " was moved without loading it";
+	}
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), file_data) << "Cancelled write_inplace() leaves file unchanged";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer::read_data() returns correct data after cancelled write";
+	
+	EXPECT_TRUE(b.write_inplace()) << "write_inplace() can complete after cancelled write";
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), expect_data) << "write_inplace() produces file with correct data";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer::read_data() returns correct data";
+}
+
+TEST(Buffer, WriteInplaceCancelReplacingFile)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	const std::vector<unsigned char> other_data = data_pattern(100, 32);
+	TempFile tmpfile2(other_data.data(), other_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	EXPECT_FALSE(b.write_inplace(wxFileName(tmpfile2.tmpfile), [&](off_t done, off_t total)
+	{
+		return done < (total / 2);
+	})) << "write_inplace() returns false when cancelled";
+	
+	EXPECT_EQ(read_file(tmpfile2.tmpfile), other_data) << "Cancelled write_inplace() leaves existing file unchanged";
+	EXPECT_EQ(b.get_filename().GetFullPath().ToStdString(), std::string(tmpfile.tmpfile)) << "Cancelled write_inplace() doesn't change backing file";
+	
+	EXPECT_TRUE(b.write_inplace(wxFileName(tmpfile2.tmpfile))) << "write_inplace() returns true when not cancelled";
+	
+	EXPECT_EQ(read_file(tmpfile2.tmpfile), file_data) << "write_inplace() replaces existing file";
+	EXPECT_EQ(b.get_filename().GetFullPath().ToStdString(), std::string(tmpfile2.tmpfile)) << "write_inplace() changes backing file";
+	EXPECT_EQ(b.read_data(0, 1024), file_data) << "Buffer::read_data() returns correct data";
+}
+
+#ifndef _WIN32
+TEST(Buffer, WriteInplaceReplacingFileKeepsLinks)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	const std::vector<unsigned char> other_data = data_pattern(100, 32);
+	TempFile target(other_data.data(), other_data.size());
+	
+	TempFilename symlink_name, hardlink_name;
+	
+	ASSERT_EQ(chmod(target.tmpfile, 0640), 0);
+	ASSERT_EQ(symlink(target.tmpfile, symlink_name.tmpfile), 0);
+	ASSERT_EQ(link(target.tmpfile, hardlink_name.tmpfile), 0);
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	EXPECT_TRUE(b.write_inplace(wxFileName(symlink_name.tmpfile))) << "write_inplace() returns true when not cancelled";
+	
+	struct stat st;
+	
+	ASSERT_EQ(lstat(symlink_name.tmpfile, &st), 0);
+	EXPECT_TRUE(S_ISLNK(st.st_mode)) << "write_inplace() doesn't replace symlink with a file";
+	
+	ASSERT_EQ(stat(target.tmpfile, &st), 0);
+	EXPECT_EQ((st.st_mode & 07777), (mode_t)(0640)) << "write_inplace() doesn't change permissions of existing file";
+	EXPECT_EQ(st.st_nlink, (nlink_t)(2)) << "write_inplace() doesn't break hard links to existing file";
+	
+	EXPECT_EQ(read_file(target.tmpfile), file_data) << "write_inplace() writes to target of symlink";
+	EXPECT_EQ(read_file(hardlink_name.tmpfile), file_data) << "write_inplace() writes to all hard links of target";
+	EXPECT_EQ(b.read_data(0, 1024), file_data) << "Buffer::read_data() returns correct data";
+}
+#endif
+
+TEST(Buffer, WriteInplaceRecoverJournal)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	TempFilename crash_file;
+	std::string crash_journal = std::string(crash_file.tmpfile) + ".rehex-journal";
+	
+	{
+		REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+		
+		const std::vector<unsigned char> insert_data(4, 0xFF);
+		ASSERT_TRUE(b.insert_data(0, insert_data.data(), insert_data.size()));
+		
+		/* Take a copy of the file and its journal part way through saving, as if we'd
+		 * crashed at that point.
+		*/
+		
+		EXPECT_FALSE(b.write_inplace([&](off_t done, off_t total)
+		{
+			if(done < (total / 2))
+			{
+				return true;
+			}
+			
+			std::vector<unsigned char> partial_data = read_file(tmpfile.tmpfile);
+			EXPECT_NE(partial_data, file_data) << "File is modified during write_inplace()";
+			
+			std::vector<unsigned char> journal_data = read_file(std::string(tmpfile.tmpfile) + ".rehex-journal");
+			
+			FILE *fh = fopen(crash_file.tmpfile, "wb");
+			fwrite(partial_data.data(), partial_data.size(), 1, fh);
+			fclose(fh);
+			
+			fh = fopen(crash_journal.c_str(), "wb");
+			fwrite(journal_data.data(), journal_data.size(), 1, fh);
+			fclose(fh);
+			
+			return false;
+		}));
+	}
+	
+	REHex::Buffer b(wxFileName(crash_file.tmpfile), 8);
+	
+	EXPECT_EQ(read_file(crash_file.tmpfile), file_data) << "Interrupted save is rolled back when file is opened";
+	EXPECT_EQ(b.read_data(0, 1024), file_data) << "Buffer::read_data() returns original data";
+	
+	struct stat st;
+	EXPECT_NE(stat(crash_journal.c_str(), &st), 0) << "Journal is removed after recovery";
+}
+
+TEST(Buffer, WriteInplaceJournalSize)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 8192);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 1024);
+	
+	/* Inserting at the start shifts every block over part of itself, only the overlap of
+	 * the block being moved needs to be kept in the journal rather than the whole file.
+	*/
+	const unsigned char X = 0xFF;
+	ASSERT_TRUE(b.insert_data(0, &X, 1));
+	
+	std::vector<unsigned char> expect_data = file_data;
+	expect_data.insert(expect_data.begin(), X);
+	
+	std::string journal_path = std::string(tmpfile.tmpfile) + ".rehex-journal";
+	off_t max_journal_size = 0;
+	
+	EXPECT_TRUE(b.write_inplace([&](off_t done, off_t total)
+	{
+		struct stat st;
+		if(stat(journal_path.c_str(), &st) == 0)
+		{
+			max_journal_size = std::max(max_journal_size, (off_t)(st.st_size));
+		}
+		
+		return true;
+	}));
+	
+	EXPECT_GT(max_journal_size, 1000) << "Journal holds the overlap of the block being moved";
+	EXPECT_LT(max_journal_size, 2048) << "Journal doesn't hold every block being moved";
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), expect_data) << "write_inplace() produces file with correct data";
+}
+
+/* Takes a copy of the file and its journal at each point the progress callback is called during
+ * a save and checks that, had we crashed there, the save would be rolled back when the file is
+ * next opened.
+ *
+ * Each step is journalled before it touches the file, so the file from before each step is also
+ * checked with the journal from after it, and with the journal from before it cut short where the
+ * two differ, as if we'd crashed after discarding the data saved from the previous step.
+*/
+static void check_journal_recovery(const std::vector<unsigned char> &file_data, const std::function<void(REHex::Buffer&)> &modify)
+{
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	std::vector< std::vector<unsigned char> > file_snapshots;
+	std::vector< std::vector<unsigned char> > journal_snapshots;
+	
+	{
+		REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+		modify(b);
+		
+		EXPECT_TRUE(b.write_inplace([&](off_t done, off_t total)
+		{
+			file_snapshots.push_back(read_file(tmpfile.tmpfile));
+			journal_snapshots.push_back(read_file(std::string(tmpfile.tmpfile) + ".rehex-journal"));
+			
+			return true;
+		}));
+	}
+	
+	auto check_recovery = [&](const std::vector<unsigned char> &crash_data, const std::vector<unsigned char> &journal_data, const std::string &desc)
+	{
+		TempFile crash_file(crash_data.data(), crash_data.size());
+		std::string crash_journal = std::string(crash_file.tmpfile) + ".rehex-journal";
+		
+		FILE *fh = fopen(crash_journal.c_str(), "wb");
+		fwrite(journal_data.data(), journal_data.size(), 1, fh);
+		fclose(fh);
+		
+		REHex::Buffer b(wxFileName(crash_file.tmpfile), 8);
+		
+		EXPECT_EQ(read_file(crash_file.tmpfile), file_data) << "Interrupted save is rolled back when file is opened (" << desc << ")";
+		
+		struct stat st;
+		EXPECT_NE(stat(crash_journal.c_str(), &st), 0) << "Journal is removed after recovery (" << desc << ")";
+	};
+	
+	for(size_t i = 0; i < journal_snapshots.size(); ++i)
+	{
+		check_recovery(file_snapshots[i], journal_snapshots[i], "crashed after step " + std::to_string(i));
+		
+		if(i > 0)
+		{
+			const std::vector<unsigned char> &prev_journal = journal_snapshots[i - 1];
+			
+			check_recovery(file_snapshots[i - 1], journal_snapshots[i], "crashed before step " + std::to_string(i));
+			
+			auto mismatch = std::mismatch(prev_journal.begin(), prev_journal.end(), journal_snapshots[i].begin());
+			std::vector<unsigned char> cut_journal(prev_journal.begin(), mismatch.first);
+			
+			check_recovery(file_snapshots[i - 1], cut_journal, "crashed journalling step " + std::to_string(i));
+		}
+	}
+}
+
+TEST(Buffer, WriteInplaceRecoverJournalInsert)
+{
+	check_journal_recovery(data_pattern(0, 64), [](REHex::Buffer &b)
+	{
+		const std::vector<unsigned char> insert_data(3, 0xFF);
+		ASSERT_TRUE(b.insert_data(0, insert_data.data(), insert_data.size()));
+	});
+}
+
+TEST(Buffer, WriteInplaceRecoverJournalErase)
+{
+	check_journal_recovery(data_pattern(0, 64), [](REHex::Buffer &b)
+	{
+		ASSERT_TRUE(b.erase_data(2, 11));
+	});
+}
+
+TEST(Buffer, WriteInplaceRecoverJournalOverwriteAndInsert)
+{
+	check_journal_recovery(data_pattern(0, 64), [](REHex::Buffer &b)
+	{
+		const std::vector<unsigned char> new_data(12, 0xAA);
+		ASSERT_TRUE(b.overwrite_data(20, new_data.data(), new_data.size()));
+		
+		const std::vector<unsigned char> insert_data(10, 0xFF);
+		ASSERT_TRUE(b.insert_data(4, insert_data.data(), insert_data.size()));
+		
+		ASSERT_TRUE(b.erase_data(50, 6));
+	});
+}
+
+TEST(Buffer, WriteInplaceJournalReadOnlyFile)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	std::string journal_path = std::string(tmpfile.tmpfile) + ".rehex-journal";
+	
+	const std::vector<unsigned char> journal_data = { 'R', 'E', 'H', 'E', 'X', 'J', 'N', 'L', 0x40, 0, 0, 0, 0, 0, 0, 0 };
+	
+	FILE *fh = fopen(journal_path.c_str(), "wb");
+	ASSERT_NE(fh, (FILE*)(NULL));
+	fwrite(journal_data.data(), journal_data.size(), 1, fh);
+	fclose(fh);
+	
+	ASSERT_EQ(chmod(tmpfile.tmpfile, 0444), 0);
+	
+	fh = fopen(tmpfile.tmpfile, "r+b");
+	if(fh != NULL)
+	{
+		/* Permissions aren't enforced (e.g. running as root), nothing to test. */
+		fclose(fh);
+		chmod(tmpfile.tmpfile, 0644);
+		remove(journal_path.c_str());
+		return;
+	}
+	
+	{
+		std::unique_ptr<REHex::Buffer> b;
+		EXPECT_NO_THROW({ b.reset(new REHex::Buffer(wxFileName(tmpfile.tmpfile), 8)); }) << "Read-only file with a pending journal can be opened";
+		
+		if(b)
+		{
+			EXPECT_EQ(b->read_data(0, 1024), file_data) << "Buffer::read_data() returns file data";
+		}
+	}
+	
+	EXPECT_EQ(read_file(journal_path), journal_data) << "Journal is kept until file can be written to";
+	
+	chmod(tmpfile.tmpfile, 0644);
+	remove(journal_path.c_str());
+}
+
+TEST(Buffer, WriteInplaceInvalidJournal)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	std::string journal_path = std::string(tmpfile.tmpfile) + ".rehex-journal";
+	
+	const std::vector<unsigned char> journal_data = data_pattern(200, 32);
+	
+	FILE *fh = fopen(journal_path.c_str(), "wb");
+	ASSERT_NE(fh, (FILE*)(NULL));
+	fwrite(journal_data.data(), journal_data.size(), 1, fh);
+	fclose(fh);
+	
+	{
+		std::unique_ptr<REHex::Buffer> b;
+		EXPECT_NO_THROW({ b.reset(new REHex::Buffer(wxFileName(tmpfile.tmpfile), 8)); }) << "File with an invalid journal can be opened";
+		
+		if(b)
+		{
+			EXPECT_EQ(b->read_data(0, 1024), file_data) << "Buffer::read_data() returns file data";
+		}
+	}
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), file_data) << "File isn't modified by invalid journal";
+	EXPECT_EQ(read_file(journal_path), journal_data) << "Invalid journal isn't removed";
+	
+	remove(journal_path.c_str());
+}
+
+TEST(Buffer, WriteInplaceModifyFromProgress)
+{
+	const std::vector<unsigned char> file_data = data_pattern(0, 64);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	REHex::Buffer b(wxFileName(tmpfile.tmpfile), 8);
+	
+	const std::vector<unsigned char> insert_data(16, 0xFF);
+	ASSERT_TRUE(b.insert_data(0, insert_data.data(), insert_data.size()));
+	
+	std::vector<unsigned char> expect_data = insert_data;
+	expect_data.insert(expect_data.end(), file_data.begin(), file_data.end());
+	
+	EXPECT_TRUE(b.write_inplace([&](off_t done, off_t total)
+	{
+		EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer can be read during write_inplace()";
+		
+		const unsigned char X = 0x00;
+		EXPECT_THROW({ b.insert_data(0, &X, 1); }, std::runtime_error) << "Buffer can't be modified during write_inplace()";
+		
+		return true;
+	}));
+	
+	EXPECT_EQ(read_file(tmpfile.tmpfile), expect_data) << "write_inplace() produces file with correct data";
+	
+	/* The Buffer can be modified once the save has finished. */
+	const unsigned char X = 0x00;
+	EXPECT_TRUE(b.insert_data(0, &X, 1));
+}
@@ -953,6 +953,88 @@ TEST(ByteRangeMap, SetBulkOverlap)
 	);
 }
 
+TEST(ByteRangeMap, SetBulkInOrderMerge)
+{
+	ByteRangeMap<std::string> brm;
+	
+	brm.set_bulk({
+		{ ByteRangeMap<std::string>::Range( 0, 10), "drum" },
+		{ ByteRangeMap<std::string>::Range(10, 10), "drum" },
+		{ ByteRangeMap<std::string>::Range(20,  0), "empty" },
+		{ ByteRangeMap<std::string>::Range(20,  5), "chin" },
+		{ ByteRangeMap<std::string>::Range(30, 10), "chin" },
+		{ ByteRangeMap<std::string>::Range(40, 10), "drum" },
+	});
+	
+	EXPECT_RANGES(
+		std::make_pair(ByteRangeMap<std::string>::Range( 0, 20), "drum"),
+		std::make_pair(ByteRangeMap<std::string>::Range(20,  5), "chin"),
+		std::make_pair(ByteRangeMap<std::string>::Range(30, 10), "chin"),
+		std::make_pair(ByteRangeMap<std::string>::Range(40, 10), "drum"),
+	);
+}
+
+TEST(ByteRangeMap, SetBulkSplitExisting)
+{
+	ByteRangeMap<std::string> brm;
+	
+	brm.set_range( 0, 100, "");
+	brm.set_range(50,  10, "crayon");
+	
+	brm.set_bulk({
+		{ ByteRangeMap<std::string>::Range(10, 10), "lumpy" },
+		{ ByteRangeMap<std::string>::Range(45, 10), "weight" },
+		{ ByteRangeMap<std::string>::Range(55,  5), "" },
+		{ ByteRangeMap<std::string>::Range(90, 20), "lumpy" },
+	});
+	
+	EXPECT_RANGES(
+		std::make_pair(ByteRangeMap<std::string>::Range(  0, 10), ""),
+		std::make_pair(ByteRangeMap<std::string>::Range( 10, 10), "lumpy"),
+		std::make_pair(ByteRangeMap<std::string>::Range( 20, 25), ""),
+		std::make_pair(ByteRangeMap<std::string>::Range( 45, 10), "weight"),
+		std::make_pair(ByteRangeMap<std::string>::Range( 55, 35), ""),
+		std::make_pair(ByteRangeMap<std::string>::Range( 90, 20), "lumpy"),
+	);
+}
+
+TEST(ByteRangeMap, SetBulkMatchesSetRange)
+{
+	srand(0);
+	
+	for(int i = 0; i < 100; ++i)
+	{
+		ByteRangeMap<int> bulk_map;
+		ByteRangeMap<int> expect_map;
+		
+		for(int j = 0; j < 20; ++j)
+		{
+			off_t offset = rand() % 200;
+			off_t length = rand() % 20;
+			int value = rand() % 3;
+			
+			bulk_map.set_range(offset, length, value);
+			expect_map.set_range(offset, length, value);
+		}
+		
+		std::vector< std::pair<ByteRangeMap<int>::Range, int> > bulk;
+		
+		for(int j = 0; j < 20; ++j)
+		{
+			off_t offset = rand() % 200;
+			off_t length = rand() % 20;
+			int value = rand() % 3;
+			
+			bulk.emplace_back(ByteRangeMap<int>::Range(offset, length), value);
+			expect_map.set_range(offset, length, value);
+		}
+		
+		bulk_map.set_bulk(std::move(bulk));
+		
+		EXPECT_EQ(bulk_map.get_ranges(), expect_map.get_ranges());
+	}
+}
+
 TEST(BitRangeMap, SetRange)
 {
 	BitRangeMap<std::string> brm;
@@ -1036,3 +1118,108 @@ TEST(BitRangeMap, DataErased)
 		std::make_pair(BitRangeMap<std::string>::Range(BitOffset(44, 0), BitOffset( 6, 2)), "mourn"),
 	);
 }
+
+TEST(ChunkedByteRangeMap, RandomisedAgainstByteRangeMap)
+{
+	/* Perform the same random operations on a ByteRangeMap and a ChunkedByteRangeMap,
+	 * with enough ranges to span many chunks, and check they always agree.
+	*/
+	
+	ByteRangeMap<int> vec_map;
+	ChunkedByteRangeMap<int> chunked_map;
+	
+	auto flatten = [](const ChunkedByteRangeMap<int> &map)
+	{
+		std::vector< std::pair<ByteRangeMap<int>::Range, int> > flat;
+		
+		for(auto r = map.begin(); r != map.end(); ++r)
+		{
+			flat.push_back(std::make_pair(ByteRangeMap<int>::Range(r->first.offset, r->first.length), r->second));
+		}
+		
+		return flat;
+	};
+	
+	uint64_t lcg = 1;
+	auto rand = [&]()
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return (off_t)(lcg >> 24);
+	};
+	
+	/* Start off with a large number of ranges. */
+	
+	std::vector< std::pair<ByteRangeMap<int>::Range, int> > initial;
+	std::vector< std::pair<ChunkedByteRangeMap<int>::Range, int> > chunked_initial;
+	
+	for(off_t i = 0; i < 20000; ++i)
+	{
+		initial.push_back(std::make_pair(ByteRangeMap<int>::Range((i * 8), 4), (int)(i % 3)));
+		chunked_initial.push_back(std::make_pair(ChunkedByteRangeMap<int>::Range((i * 8), 4), (int)(i % 3)));
+	}
+	
+	vec_map.set_bulk(std::move(initial));
+	chunked_map.set_bulk(std::move(chunked_initial));
+	
+	ASSERT_EQ(flatten(chunked_map), vec_map.get_ranges());
+	
+	for(int step = 0; step < 4000; ++step)
+	{
+		off_t offset = rand() % 170000;
+		off_t length = (rand() % 4) == 0
+			? (rand() % 4000) + 1
+			: (rand() % 12) + 1;
+		
+		int value = rand() % 3;
+		
+		switch(rand() % 5)
+		{
+			case 0:
+			case 1:
+				vec_map.set_range(offset, length, value);
+				chunked_map.set_range(offset, length, value);
+				break;
+				
+			case 2:
+				vec_map.clear_range(offset, length);
+				chunked_map.clear_range(offset, length);
+				break;
+				
+			case 3:
+				EXPECT_EQ(chunked_map.data_inserted(offset, length), vec_map.data_inserted(offset, length));
+				break;
+				
+			case 4:
+				EXPECT_EQ(chunked_map.data_erased(offset, length), vec_map.data_erased(offset, length));
+				break;
+		}
+		
+		ASSERT_EQ(chunked_map.size(), vec_map.size()) << "Size matches at step " << step;
+		
+		auto vr = vec_map.get_range(offset);
+		auto cr = chunked_map.get_range(offset);
+		
+		ASSERT_EQ((cr == chunked_map.end()), (vr == vec_map.end()));
+		if(vr != vec_map.end())
+		{
+			EXPECT_EQ(cr->first.offset, vr->first.offset);
+			EXPECT_EQ(cr->second, vr->second);
+		}
+		
+		auto vi = vec_map.get_range_in(offset, length);
+		auto ci = chunked_map.get_range_in(offset, length);
+		
+		ASSERT_EQ((ci == chunked_map.end()), (vi == vec_map.end()));
+		if(vi != vec_map.end())
+		{
+			EXPECT_EQ(ci->first.offset, vi->first.offset);
+		}
+		
+		if((step % 50) == 0)
+		{
+			ASSERT_EQ(flatten(chunked_map), vec_map.get_ranges()) << "Ranges match at step " << step;
+		}
+	}
+	
+	EXPECT_EQ(flatten(chunked_map), vec_map.get_ranges());
+}
@@ -1581,3 +1581,117 @@ TEST(OrderedBitRangeSet, AddOverlappingRanges)
 	EXPECT_TRUE(brs.isset(BitOffset(70, 0), BitOffset(25, 0)));
 	EXPECT_FALSE(brs.isset(BitOffset(95, 0)));
 }
+
+/* Flatten a set into (offset, length) pairs so sets using different containers can be compared. */
+template<typename S> static std::vector< std::pair<off_t, off_t> > flatten_ranges(const S &set)
+{
+	std::vector< std::pair<off_t, off_t> > flat;
+	
+	for(auto r = set.begin(); r != set.end(); ++r)
+	{
+		flat.push_back(std::make_pair(r->offset, r->length));
+	}
+	
+	return flat;
+}
+
+TEST(ChunkedByteRangeSet, RandomisedAgainstByteRangeSet)
+{
+	/* Perform the same random operations on a ByteRangeSet and a ChunkedByteRangeSet,
+	 * with enough ranges to span many chunks, and check they always agree.
+	*/
+	
+	ByteRangeSet vec_set;
+	ChunkedByteRangeSet chunked_set;
+	
+	uint64_t lcg = 1;
+	auto rand = [&]()
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return (off_t)(lcg >> 24);
+	};
+	
+	/* Start off with a large number of disjoint ranges. */
+	
+	std::vector<ByteRangeSet::Range> initial;
+	std::vector<ChunkedByteRangeSet::Range> chunked_initial;
+	
+	for(off_t i = 0; i < 20000; ++i)
+	{
+		initial.push_back(ByteRangeSet::Range((i * 8), 4));
+		chunked_initial.push_back(ChunkedByteRangeSet::Range((i * 8), 4));
+	}
+	
+	vec_set.set_ranges(initial.begin(), initial.end());
+	chunked_set.set_ranges(chunked_initial.begin(), chunked_initial.end());
+	
+	ASSERT_EQ(flatten_ranges(chunked_set), flatten_ranges(vec_set));
+	
+	for(int step = 0; step < 4000; ++step)
+	{
+		off_t offset = rand() % 170000;
+		off_t length = (rand() % 4) == 0
+			? (rand() % 4000) + 1
+			: (rand() % 12) + 1;
+		
+		switch(rand() % 5)
+		{
+			case 0:
+			case 1:
+				vec_set.set_range(offset, length);
+				chunked_set.set_range(offset, length);
+				break;
+				
+			case 2:
+				vec_set.clear_range(offset, length);
+				chunked_set.clear_range(offset, length);
+				break;
+				
+			case 3:
+				vec_set.data_inserted(offset, length);
+				chunked_set.data_inserted(offset, length);
+				break;
+				
+			case 4:
+				vec_set.data_erased(offset, length);
+				chunked_set.data_erased(offset, length);
+				break;
+		}
+		
+		ASSERT_EQ(chunked_set.size(), vec_set.size()) << "Size matches at step " << step;
+		
+		EXPECT_EQ(chunked_set.isset(offset, length), vec_set.isset(offset, length));
+		EXPECT_EQ(chunked_set.isset_any(offset, length), vec_set.isset_any(offset, length));
+		
+		auto vf = vec_set.find_first_in(offset, 1000);
+		auto cf = chunked_set.find_first_in(offset, 1000);
+		
+		ASSERT_EQ((cf == chunked_set.end()), (vf == vec_set.end()));
+		if(vf != vec_set.end())
+		{
+			EXPECT_EQ(cf->offset, vf->offset);
+			EXPECT_EQ((cf - chunked_set.begin()), (vf - vec_set.begin()));
+		}
+		
+		auto vl = vec_set.find_last_in(offset, 1000);
+		auto cl = chunked_set.find_last_in(offset, 1000);
+		
+		ASSERT_EQ((cl == chunked_set.end()), (vl == vec_set.end()));
+		if(vl != vec_set.end())
+		{
+			EXPECT_EQ(cl->offset, vl->offset);
+		}
+		
+		if((step % 50) == 0)
+		{
+			ASSERT_EQ(flatten_ranges(chunked_set), flatten_ranges(vec_set)) << "Ranges match at step " << step;
+			EXPECT_EQ(chunked_set.total_bytes(), vec_set.total_bytes());
+		}
+	}
+	
+	EXPECT_EQ(flatten_ranges(chunked_set), flatten_ranges(vec_set));
+	
+	size_t idx = chunked_set.size() / 2;
+	EXPECT_EQ(chunked_set[idx].offset, vec_set[idx].offset);
+	EXPECT_EQ(chunked_set.get_ranges()[idx].length, vec_set.get_ranges()[idx].length);
+}
@@ -17,8 +17,12 @@
 
 #include "../src/platform.hpp"
 
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <iterator>
+#include <stdint.h>
+#include <utility>
+#include <vector>
 
 /* Enable extra sanity checks (expensive) in ByteRangeTree. */
 #define REHEX_BYTERANGETREE_CHECKS
@@ -475,3 +479,190 @@ TEST(BitRangeTree, DataInserted)
 		"  54+4b, 0+2b = 5\n"
 	);
 }
+
+TEST(BitRangeTree, BulkConstruct)
+{
+	std::vector< std::pair<BitRangeTreeKey, int> > elements = {
+		{ BitRangeTreeKey(BitOffset(10, 0), BitOffset(10, 0)), 1 },
+		{ BitRangeTreeKey(BitOffset(20, 2), BitOffset( 1, 0)), 2 },
+		{ BitRangeTreeKey(BitOffset(21, 2), BitOffset( 1, 0)), 3 },
+		{ BitRangeTreeKey(BitOffset(48, 0), BitOffset(10, 0)), 9 },
+		{ BitRangeTreeKey(BitOffset(50, 2), BitOffset( 0, 2)), 6 },
+		{ BitRangeTreeKey(BitOffset(50, 2), BitOffset( 0, 1)), 7 },
+		{ BitRangeTreeKey(BitOffset(50, 2), BitOffset( 0, 0)), 8 },
+		{ BitRangeTreeKey(BitOffset(50, 4), BitOffset( 0, 2)), 5 },
+	};
+	
+	BitRangeTree<int> tree(elements.begin(), elements.end());
+	
+	EXPECT_EQ(tree.size(), 8U);
+	
+	ASSERT_EQ(BitRangeTree_to_string(tree),
+		"10+0b, 10+0b = 1\n"
+		"20+2b, 1+0b = 2\n"
+		"21+2b, 1+0b = 3\n"
+		"48+0b, 10+0b = 9\n"
+		"  50+2b, 0+2b = 6\n"
+		"    50+2b, 0+1b = 7\n"
+		"      50+2b, 0+0b = 8\n"
+		"  50+4b, 0+2b = 5\n"
+	);
+	
+	int expect[] = { 1, 2, 3, 9, 6, 7, 8, 5 };
+	
+	auto it = tree.begin();
+	for(int i = 0; i < 8; ++i, ++it)
+	{
+		ASSERT_NE(it, tree.end());
+		EXPECT_EQ(it->value, expect[i]);
+	}
+	
+	EXPECT_EQ(it, tree.end());
+	
+	for(int i = 7; i >= 0; --i)
+	{
+		--it;
+		EXPECT_EQ(it->value, expect[i]);
+	}
+}
+
+TEST(ByteRangeTree, BulkConstructConflicts)
+{
+	/* Elements which conflict with earlier ones should be handled like set() would. */
+	
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements = {
+		{ ByteRangeTreeKey(0,  100), 1 },
+		{ ByteRangeTreeKey(10,  20), 2 },
+		{ ByteRangeTreeKey(10,  20), 3 }, /* Repeated key */
+		{ ByteRangeTreeKey(25,  10), 4 }, /* Straddles end of (10, 20) */
+		{ ByteRangeTreeKey(26,   2), 5 }, /* Nested under (10, 20) */
+		{ ByteRangeTreeKey(90,  20), 6 }, /* Straddles end of (0, 100) */
+		{ ByteRangeTreeKey(100,  0), 7 },
+		{ ByteRangeTreeKey(100, 10), 8 }, /* Out of order */
+		{ ByteRangeTreeKey(50,  10), 9 }, /* Out of order */
+	};
+	
+	ByteRangeTree<int> expect;
+	for(auto e = elements.begin(); e != elements.end(); ++e)
+	{
+		expect.set(e->first.offset, e->first.length, e->second);
+	}
+	
+	ByteRangeTree<int> tree(elements.begin(), elements.end());
+	
+	EXPECT_EQ(tree.size(), expect.size());
+	EXPECT_TRUE(tree == expect);
+	
+	ASSERT_NE(tree.find_node(ByteRangeTreeKey(10, 20)), nullptr);
+	EXPECT_EQ(tree.find_node(ByteRangeTreeKey(10, 20))->value, 3);
+	
+	EXPECT_EQ(tree.find_node(ByteRangeTreeKey(25, 10)), nullptr);
+	EXPECT_EQ(tree.find_node(ByteRangeTreeKey(90, 20)), nullptr);
+	
+	ASSERT_NE(tree.find_node(ByteRangeTreeKey(50, 10)), nullptr);
+	ASSERT_NE(tree.find_node(ByteRangeTreeKey(50, 10))->get_parent(), nullptr);
+	EXPECT_EQ(tree.find_node(ByteRangeTreeKey(50, 10))->get_parent()->value, 1);
+}
+
+TEST(ByteRangeTree, BulkConstructRandom)
+{
+	uint64_t lcg = 1;
+	auto rand = [&]()
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return (off_t)(lcg >> 24);
+	};
+	
+	/* Generate lots of random keys, some of which will straddle each other, and sort them
+	 * into depth-first order.
+	*/
+	
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements;
+	
+	for(int i = 0; i < 2000; ++i)
+	{
+		off_t offset = rand() % 100000;
+		off_t length = rand() % ((rand() % 4) == 0 ? 10000 : 100);
+		
+		elements.push_back(std::make_pair(ByteRangeTreeKey(offset, length), i));
+	}
+	
+	std::stable_sort(elements.begin(), elements.end(),
+		[](const std::pair<ByteRangeTreeKey, int> &a, const std::pair<ByteRangeTreeKey, int> &b)
+		{
+			return a.first.offset < b.first.offset
+				|| (a.first.offset == b.first.offset && a.first.length > b.first.length);
+		});
+	
+	ByteRangeTree<int> expect;
+	for(auto e = elements.begin(); e != elements.end(); ++e)
+	{
+		expect.set(e->first.offset, e->first.length, e->second);
+	}
+	
+	ByteRangeTree<int> tree(elements.begin(), elements.end());
+	
+	EXPECT_EQ(tree.size(), expect.size());
+	EXPECT_TRUE(tree == expect);
+	
+	/* Build another tree by iterating over the first. */
+	
+	ByteRangeTree<int> tree2(tree.begin(), tree.end());
+	
+	EXPECT_EQ(tree2.size(), tree.size());
+	EXPECT_TRUE(tree2 == tree);
+}
+
+TEST(ByteRangeTree, CopyAndMove)
+{
+	ByteRangeTree<int> tree;
+	
+	ASSERT_TRUE(tree.set(0, 100, 0));
+		ASSERT_TRUE(tree.set(0, 20, 1));
+			ASSERT_TRUE(tree.set(0,  5, 2));
+			ASSERT_TRUE(tree.set(5,  5, 3));
+		ASSERT_TRUE(tree.set(30, 20, 4));
+	ASSERT_TRUE(tree.set(100, 100, 5));
+	
+	ByteRangeTree<int> copy(tree);
+	
+	EXPECT_EQ(copy.size(), 6U);
+	EXPECT_TRUE(copy == tree);
+	EXPECT_NE(copy.find_node(ByteRangeTreeKey(5, 5)), tree.find_node(ByteRangeTreeKey(5, 5)));
+	
+	ByteRangeTree<int>::Node *node = tree.find_node(ByteRangeTreeKey(5, 5));
+	
+	ByteRangeTree<int> moved(std::move(tree));
+	
+	EXPECT_EQ(moved.size(), 6U);
+	EXPECT_TRUE(moved == copy);
+	EXPECT_EQ(moved.find_node(ByteRangeTreeKey(5, 5)), node) << "Node pointers remain valid after moving tree";
+	
+	EXPECT_TRUE(tree.empty());
+	EXPECT_EQ(tree.begin(), tree.end());
+	
+	tree = std::move(moved);
+	
+	EXPECT_EQ(tree.size(), 6U);
+	EXPECT_EQ(tree.find_node(ByteRangeTreeKey(5, 5)), node);
+	EXPECT_TRUE(moved.empty());
+	
+	copy = tree;
+	
+	EXPECT_TRUE(copy == tree);
+	
+	/* Erasing and re-adding nodes should reuse the freed storage. */
+	
+	size_t memory_usage = tree.memory_usage();
+	
+	tree.erase(node);
+	ASSERT_TRUE(tree.set(5, 5, 3));
+	
+	EXPECT_TRUE(tree == copy);
+	EXPECT_EQ(tree.memory_usage(), memory_usage);
+	
+	tree.clear();
+	
+	EXPECT_TRUE(tree.empty());
+	EXPECT_LT(tree.memory_usage(), memory_usage);
+}
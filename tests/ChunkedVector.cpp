@@ -0,0 +1,217 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../src/ChunkedVector.hpp"
+
+using namespace REHex;
+
+template<typename T> static std::vector<T> to_vector(const ChunkedVector<T> &cv)
+{
+	return std::vector<T>(cv.begin(), cv.end());
+}
+
+TEST(ChunkedVector, Empty)
+{
+	ChunkedVector<int> cv;
+	
+	EXPECT_TRUE(cv.empty());
+	EXPECT_EQ(cv.size(), 0U);
+	EXPECT_TRUE(cv.begin() == cv.end());
+	EXPECT_EQ((cv.end() - cv.begin()), 0);
+}
+
+TEST(ChunkedVector, PushBack)
+{
+	const int N = ChunkedVector<int>::CHUNK_SIZE * 10 + 7;
+	
+	ChunkedVector<int> cv;
+	std::vector<int> v;
+	
+	for(int i = 0; i < N; ++i)
+	{
+		cv.push_back(i);
+		v.push_back(i);
+	}
+	
+	EXPECT_EQ(cv.size(), (size_t)(N));
+	EXPECT_EQ(to_vector(cv), v);
+	
+	EXPECT_EQ(cv.front(), 0);
+	EXPECT_EQ(cv.back(), (N - 1));
+	
+	for(int i = 0; i < N; ++i)
+	{
+		ASSERT_EQ(cv[i], i) << "ChunkedVector::operator[] returns element " << i;
+	}
+}
+
+TEST(ChunkedVector, IteratorArithmetic)
+{
+	const int N = ChunkedVector<int>::CHUNK_SIZE * 5;
+	
+	ChunkedVector<int> cv;
+	
+	for(int i = 0; i < N; ++i)
+	{
+		cv.push_back(i);
+	}
+	
+	ChunkedVector<int>::iterator i = cv.begin();
+	
+	i += (N / 2);
+	EXPECT_EQ(*i, (N / 2));
+	EXPECT_EQ((i - cv.begin()), (N / 2));
+	
+	i -= (N / 3);
+	EXPECT_EQ(*i, (N / 2) - (N / 3));
+	
+	EXPECT_EQ(*(cv.begin() + (N - 1)), (N - 1));
+	EXPECT_TRUE((cv.begin() + N) == cv.end());
+	EXPECT_EQ(*(cv.end() - 1), (N - 1));
+	EXPECT_EQ(*std::prev(cv.end()), (N - 1));
+	
+	EXPECT_TRUE(cv.begin() < cv.end());
+	EXPECT_TRUE(i < cv.end());
+	EXPECT_TRUE(cv.begin() <= i);
+	
+	ChunkedVector<int>::const_iterator ci = i;
+	EXPECT_TRUE(ci == i) << "ChunkedVector::iterator converts to const_iterator";
+	
+	int expect = 0;
+	for(auto j = cv.begin(); j != cv.end(); ++j, ++expect)
+	{
+		ASSERT_EQ(*j, expect);
+	}
+	
+	EXPECT_EQ(expect, N);
+	
+	for(auto j = cv.end(); j != cv.begin();)
+	{
+		--j;
+		--expect;
+		
+		ASSERT_EQ(*j, expect);
+	}
+	
+	EXPECT_EQ(expect, 0);
+	
+	EXPECT_EQ(*std::lower_bound(cv.begin(), cv.end(), 1234), 1234);
+	EXPECT_TRUE(std::lower_bound(cv.begin(), cv.end(), N) == cv.end());
+}
+
+TEST(ChunkedVector, InsertErase)
+{
+	ChunkedVector<std::string> cv = { "a", "b", "c" };
+	
+	auto i = cv.insert(std::next(cv.begin()), "x");
+	EXPECT_EQ(*i, "x") << "ChunkedVector::insert() returns iterator to inserted element";
+	EXPECT_EQ(to_vector(cv), std::vector<std::string>({ "a", "x", "b", "c" }));
+	
+	std::vector<std::string> more = { "y", "z" };
+	i = cv.insert(cv.end(), more.begin(), more.end());
+	EXPECT_EQ(*i, "y");
+	EXPECT_EQ(to_vector(cv), std::vector<std::string>({ "a", "x", "b", "c", "y", "z" }));
+	
+	i = cv.emplace(cv.begin(), 3, 'q');
+	EXPECT_EQ(*i, "qqq");
+	
+	i = cv.erase(std::next(cv.begin()), std::next(cv.begin(), 3));
+	EXPECT_EQ(*i, "b") << "ChunkedVector::erase() returns iterator to following element";
+	EXPECT_EQ(to_vector(cv), std::vector<std::string>({ "qqq", "b", "c", "y", "z" }));
+	
+	i = cv.erase(std::prev(cv.end()));
+	EXPECT_TRUE(i == cv.end());
+	EXPECT_EQ(to_vector(cv), std::vector<std::string>({ "qqq", "b", "c", "y" }));
+	
+	cv.clear();
+	EXPECT_TRUE(cv.empty());
+	EXPECT_TRUE(cv.begin() == cv.end());
+}
+
+TEST(ChunkedVector, RandomisedAgainstVector)
+{
+	ChunkedVector<uint64_t> cv;
+	std::vector<uint64_t> v;
+	
+	uint64_t lcg = 1;
+	auto rand = [&]()
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return lcg >> 24;
+	};
+	
+	for(int step = 0; step < 5000; ++step)
+	{
+		size_t pos = v.empty() ? 0 : (rand() % (v.size() + 1));
+		int op = rand() % 10;
+		
+		if(op < 5 || v.empty())
+		{
+			/* Insert up to a few chunks worth of elements. */
+			
+			size_t n = (rand() % 4) == 0
+				? (rand() % (ChunkedVector<uint64_t>::CHUNK_SIZE * 3))
+				: (rand() % 4) + 1;
+			
+			std::vector<uint64_t> values;
+			for(size_t i = 0; i < n; ++i)
+			{
+				values.push_back(rand());
+			}
+			
+			v.insert(std::next(v.begin(), pos), values.begin(), values.end());
+			
+			auto i = cv.insert(std::next(cv.begin(), pos), values.begin(), values.end());
+			ASSERT_EQ((size_t)(i - cv.begin()), pos) << "Returned iterator is at insertion point at step " << step;
+		}
+		else{
+			size_t n = (rand() % 4) == 0
+				? (rand() % (ChunkedVector<uint64_t>::CHUNK_SIZE * 3))
+				: (rand() % 4) + 1;
+			
+			n = std::min(n, (v.size() - std::min(pos, v.size())));
+			
+			v.erase(std::next(v.begin(), pos), std::next(v.begin(), pos + n));
+			
+			auto i = cv.erase(std::next(cv.begin(), pos), std::next(cv.begin(), pos + n));
+			ASSERT_EQ((size_t)(i - cv.begin()), pos) << "Returned iterator is at erase point at step " << step;
+		}
+		
+		ASSERT_EQ(cv.size(), v.size()) << "Size matches at step " << step;
+		
+		if((step % 97) == 0)
+		{
+			ASSERT_EQ(to_vector(cv), v) << "Elements match at step " << step;
+			
+			for(size_t i = 0; i < v.size(); i += 37)
+			{
+				ASSERT_EQ(cv[i], v[i]);
+			}
+		}
+	}
+	
+	EXPECT_EQ(to_vector(cv), v);
+	EXPECT_TRUE(cv == ChunkedVector<uint64_t>(v.begin(), v.end())) << "ChunkedVector::operator== compares elements";
+}
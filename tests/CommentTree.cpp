@@ -20,6 +20,7 @@
 #include <functional>
 #include <gtest/gtest.h>
 #include <map>
+#include <memory>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string>
@@ -1001,3 +1002,125 @@ TEST(CommentTree, FilterMatchesDeepNode)
 	
 	model->DecRef();
 }
+
+TEST(CommentTree, ArrayComment)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	AutoFrame frame(NULL, wxID_ANY, "REHex Tests");
+	DocumentCtrl *doc_ctrl = new DocumentCtrl(frame.frame, doc);
+	
+	unsigned char z1k[1024];
+	memset(z1k, 0, 1024);
+	
+	doc->insert_data(0, z1k, 1024);
+	
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(8, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(8, 0), "record"),
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "id"),
+		Document::Comment::ArrayLayout::Field(BitOffset(4, 0), BitOffset(4, 0), "value"),
+	}));
+	
+	doc->set_comment(16, 16, REHex::Document::Comment("records", layout));
+	
+	CommentTreeModel *model = new CommentTreeModel(doc, doc_ctrl);
+	
+	refresh_check_notifications(model, [](){},
+		"ItemAdded(\"(null)\", \"records\" (container))",
+		NULL
+	);
+	
+	check_values(model,
+		"0000:0010+records",
+		"0000:0010+records/0000:0010+records[0]",
+		"0000:0010+records/0000:0010+records[0]/0000:0010+record",
+		"0000:0010+records/0000:0010+records[0]/0000:0010+record/0000:0010+id",
+		"0000:0010+records/0000:0010+records[0]/0000:0010+record/0000:0014+value",
+		"0000:0010+records/0000:0018+records[1]",
+		"0000:0010+records/0000:0018+records[1]/0000:0018+record",
+		"0000:0010+records/0000:0018+records[1]/0000:0018+record/0000:0018+id",
+		"0000:0010+records/0000:0018+records[1]/0000:0018+record/0000:001C+value",
+		NULL
+	);
+	
+	refresh_check_notifications(model,
+		[&]()
+		{
+			doc->set_comment(16, 16, REHex::Document::Comment("records"));
+		},
+		
+		"ItemDeleted(\"record\", \"id\")",
+		"ItemDeleted(\"record\", \"value\")",
+		"ItemDeleted(\"records[0]\", \"record\")",
+		"ItemDeleted(\"records\", \"records[0]\")",
+		"ItemDeleted(\"record\", \"id\")",
+		"ItemDeleted(\"record\", \"value\")",
+		"ItemDeleted(\"records[1]\", \"record\")",
+		"ItemDeleted(\"records\", \"records[1]\")",
+		"ItemDeleted(\"(null)\", \"records\")",
+		"ItemAdded(\"(null)\", \"records\")",
+		NULL
+	);
+	
+	check_values(model,
+		"0000:0010+records",
+		NULL
+	);
+	
+	model->DecRef();
+}
+
+TEST(CommentTree, ArrayCommentPages)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	AutoFrame frame(NULL, wxID_ANY, "REHex Tests");
+	DocumentCtrl *doc_ctrl = new DocumentCtrl(frame.frame, doc);
+	
+	std::vector<unsigned char> z1m(1024 * 1024, 0);
+	doc->insert_data(0, z1m.data(), z1m.size());
+	
+	/* 2,500,000 one-bit elements - 3 pages of 1,000,000, each made of pages of 1,000. */
+	
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(0, 1), {}));
+	doc->set_comment(0, 312500, REHex::Document::Comment("bits", layout));
+	
+	CommentTreeModel *model = new CommentTreeModel(doc, doc_ctrl);
+	model->refresh_comments();
+	
+	wxDataViewItemArray root;
+	ASSERT_EQ(model->GetChildren(wxDataViewItem(NULL), root), 1U);
+	EXPECT_TRUE(model->IsContainer(root[0]));
+	EXPECT_FALSE(model->is_array_item(root[0]));
+	
+	wxDataViewItemArray pages;
+	ASSERT_EQ(model->GetChildren(root[0], pages), 3U);
+	
+	wxVariant text;
+	model->GetValue(text, pages[2], MODEL_TEXT_COLUMN);
+	EXPECT_EQ(text.GetString().ToStdString(), "bits[2000000] ... bits[2499999]");
+	
+	EXPECT_TRUE(model->is_array_item(pages[2]));
+	EXPECT_TRUE(model->IsContainer(pages[2]));
+	EXPECT_EQ(model->GetParent(pages[2]).GetID(), root[0].GetID());
+	
+	wxDataViewItemArray subpages;
+	ASSERT_EQ(model->GetChildren(pages[2], subpages), 500U);
+	
+	model->GetValue(text, subpages[499], MODEL_TEXT_COLUMN);
+	EXPECT_EQ(text.GetString().ToStdString(), "bits[2499000] ... bits[2499999]");
+	
+	wxDataViewItemArray elements;
+	ASSERT_EQ(model->GetChildren(subpages[499], elements), 1000U);
+	
+	model->GetValue(text, elements[999], MODEL_TEXT_COLUMN);
+	EXPECT_EQ(text.GetString().ToStdString(), "bits[2499999]");
+	
+	const BitRangeTreeKey *key = CommentTreeModel::dv_item_to_key(elements[999]);
+	EXPECT_EQ(key->offset, BitOffset(312499, 7));
+	EXPECT_EQ(key->length, BitOffset(0, 1));
+	
+	EXPECT_FALSE(model->IsContainer(elements[999])) << "Elements of an array without fields have no children";
+	
+	model->DecRef();
+}
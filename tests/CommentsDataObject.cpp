@@ -119,3 +119,28 @@ TEST(CommentsDataObject, HighBitCharacters)
 	
 	EXPECT_EQ(got_comments, expect_comments) << "8 bit characters are preserved";
 }
+
+TEST(CommentsDataObject, ArrayComment)
+{
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(8, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "id"),
+		Document::Comment::ArrayLayout::Field(BitOffset(4, 0), BitOffset(4, 0), "value"),
+	}));
+	
+	BitRangeTree<Document::Comment> expect_comments;
+	expect_comments.set(100, 800, Document::Comment("records", layout));
+	expect_comments.set(900,  10, Document::Comment("plain"));
+	
+	std::list<BitRangeTree<Document::Comment>::const_iterator> in_comments;
+	in_comments.push_back(std::next(expect_comments.begin(), 0));
+	in_comments.push_back(std::next(expect_comments.begin(), 1));
+	
+	CommentsDataObject cdo_ser(in_comments);
+	
+	CommentsDataObject cdo_deser;
+	cdo_deser.SetData(cdo_ser.GetSize(), cdo_ser.GetData());
+	
+	auto got_comments = cdo_deser.get_comments();
+	
+	EXPECT_EQ(got_comments, expect_comments) << "Array layouts are preserved";
+}
@@ -18,6 +18,8 @@
 #include "../src/platform.hpp"
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <stdexcept>
 #include <stdint.h>
 #include <string>
 #include <string.h>
@@ -455,6 +457,28 @@ TEST_F(DocumentTest, OverwriteBits)
 	EXPECT_FALSE(doc->is_byte_dirty(2));
 }
 
+TEST_F(DocumentTest, GetDirtyRanges)
+{
+	const char *DATA1 = "cumbersomeadvertisement";
+	doc->insert_data(0, (const unsigned char*)(DATA1), strlen(DATA1));
+	doc->reset_to_clean();
+	
+	EXPECT_TRUE(doc->get_dirty_ranges(0, 23).empty());
+	
+	doc->overwrite_data(2, "XX", 2);
+	doc->overwrite_data(10, "YYYY", 4);
+	
+	std::vector<ByteRangeSet::Range> expect_all = { ByteRangeSet::Range(2, 2), ByteRangeSet::Range(10, 4) };
+	ByteRangeSet all = doc->get_dirty_ranges(0, 23);
+	EXPECT_EQ(std::vector<ByteRangeSet::Range>(all.begin(), all.end()), expect_all);
+	
+	std::vector<ByteRangeSet::Range> expect_clipped = { ByteRangeSet::Range(3, 1), ByteRangeSet::Range(10, 2) };
+	ByteRangeSet clipped = doc->get_dirty_ranges(3, 9);
+	EXPECT_EQ(std::vector<ByteRangeSet::Range>(clipped.begin(), clipped.end()), expect_clipped);
+	
+	EXPECT_TRUE(doc->get_dirty_ranges(4, 6).empty());
+}
+
 TEST_F(DocumentTest, EraseData)
 {
 	/* Preload document with data. */
@@ -4001,6 +4025,42 @@ TEST_F(DocumentTest, LoadMetadataCommentUnicode)
 	EXPECT_EQ(got, expect);
 }
 
+TEST_F(DocumentTest, LoadMetadataManyComments)
+{
+	const size_t N_COMMENTS = Document::LOAD_COMMENTS_THREAD_MIN * 2;
+	
+	std::vector<unsigned char> zero_data(N_COMMENTS * 2, 0);
+	doc->insert_data(0, zero_data.data(), zero_data.size());
+	
+	AutoJSON metadata(R"({
+		"comments": [],
+		"data_types": [],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": false
+	})");
+	
+	json_t *comments = json_object_get(metadata.json, "comments");
+	BitRangeTree<Document::Comment> expect;
+	
+	for(size_t i = 0; i < N_COMMENTS; ++i)
+	{
+		std::string text = "comment " + std::to_string(i);
+		
+		json_t *comment = json_object();
+		json_object_set_new(comment, "offset", json_integer(i * 2));
+		json_object_set_new(comment, "length", json_integer(2));
+		json_object_set_new(comment, "text", json_string(text.c_str()));
+		json_array_append_new(comments, comment);
+		
+		expect.set(BitOffset((i * 2), 0), BitOffset(2, 0), REHex::Document::Comment(text.c_str()));
+	}
+	
+	doc->load_metadata(metadata.json);
+	
+	EXPECT_EQ(doc->get_comments(), expect);
+}
+
 TEST_F(DocumentTest, LoadMetadataCommentsSkipBad)
 {
 	std::vector<unsigned char> zero_1k(1024, 0);
@@ -4062,6 +4122,133 @@ TEST_F(DocumentTest, LoadMetadataCommentsSkipBad)
 	EXPECT_EQ(got, expect);
 }
 
+TEST_F(DocumentTest, SerialiseMetadataCommentArray)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(8, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(4, 0), BitOffset(4, 0), "value"),
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "id"),
+	}));
+	
+	doc->set_comment(16, 800, Document::Comment("records", layout));
+	
+	AutoJSON got(doc->serialise_metadata(false));
+	
+	AutoJSON expect(R"({
+		"comments": [
+			{
+				"length": 800,
+				"offset": 16,
+				"text": "records",
+				"array": {
+					"element_length": 8,
+					"fields": [
+						{ "offset": 0, "length": 4, "text": "id" },
+						{ "offset": 4, "length": 4, "text": "value" }
+					]
+				}
+			}
+		],
+		"data_types": [],
+		"highlight-colours": [
+			{ "index": 0 },
+			{ "index": 1 },
+			{ "index": 2 },
+			{ "index": 3 },
+			{ "index": 4 },
+			{ "index": 5 }
+		],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": false
+	})");
+	
+	EXPECT_EQ(got, expect);
+}
+
+TEST_F(DocumentTest, LoadMetadataCommentArray)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	AutoJSON metadata(R"({
+		"comments": [
+			{
+				"length": 800,
+				"offset": 16,
+				"text": "records",
+				"array": {
+					"element_length": 8,
+					"fields": [
+						{ "offset": 0, "length": 4, "text": "id" },
+						{ "offset": 4, "length": 4, "text": "value" }
+					]
+				}
+			},
+			{
+				"length": 10,
+				"offset": 900,
+				"text": "bad layout",
+				"array": {
+					"element_length": 8,
+					"fields": [
+						{ "offset": 6, "length": 4, "text": "overflow" }
+					]
+				}
+			}
+		],
+		"data_types": [],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": false
+	})");
+	
+	doc->load_metadata(metadata.json);
+	
+	auto &got = doc->get_comments();
+	
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(8, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "id"),
+		Document::Comment::ArrayLayout::Field(BitOffset(4, 0), BitOffset(4, 0), "value"),
+	}));
+	
+	BitRangeTree<Document::Comment> expect;
+	expect.set( 16, 800, REHex::Document::Comment("records", layout));
+	expect.set(900,  10, REHex::Document::Comment("bad layout"));
+	
+	EXPECT_EQ(got, expect) << "Comments with an invalid array layout are loaded as plain comments";
+	
+	auto records = got.find(BitRangeTreeKey(16, 800));
+	ASSERT_NE(records, got.end());
+	ASSERT_TRUE(records->second.array);
+	
+	EXPECT_EQ(records->second.array->element_count(BitOffset(800, 0)), 100);
+}
+
+TEST(DocumentCommentArrayLayout, Construct)
+{
+	Document::Comment::ArrayLayout layout(BitOffset(16, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(8, 0), BitOffset(8, 0), "b"),
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "a.x"),
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(8, 0), "a"),
+	});
+	
+	ASSERT_EQ(layout.fields.size(), 3U);
+	EXPECT_EQ(layout.fields[0].text->ToStdString(), "a") << "Enclosing fields are sorted before the fields within them";
+	EXPECT_EQ(layout.fields[1].text->ToStdString(), "a.x");
+	EXPECT_EQ(layout.fields[2].text->ToStdString(), "b");
+	
+	EXPECT_EQ(layout.element_count(BitOffset(40, 0)), 2) << "Partial elements aren't counted";
+	EXPECT_EQ(Document::Comment::ArrayLayout::element_text("foo", 12).ToStdString(), "foo[12]");
+	
+	EXPECT_THROW(Document::Comment::ArrayLayout(BitOffset(0, 0), {}), std::invalid_argument);
+	
+	EXPECT_THROW(Document::Comment::ArrayLayout(BitOffset(4, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(2, 0), BitOffset(4, 0), "x") }), std::invalid_argument);
+}
+
 TEST_F(DocumentTest, SerialiseMetadataDataTypes)
 {
 	std::vector<unsigned char> zero_1k(1024, 0);
@@ -4649,6 +4836,204 @@ TEST_F(DocumentTest, LoadMetadataDataHighlightsCustomColours)
 	}
 }
 
+TEST_F(DocumentTest, SaveLoadMetadataBinary)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	doc->set_comment(BitOffset(  0, 0), BitOffset(10, 0), REHex::Document::Comment("cold"));
+	doc->set_comment(BitOffset( 20, 0), BitOffset(10, 0), REHex::Document::Comment("strong"));
+	doc->set_comment(BitOffset( 20, 0), BitOffset( 5, 0), REHex::Document::Comment(wxString::FromUTF8((const char*)(u8"mundané"))));
+	doc->set_comment(BitOffset( 25, 0), BitOffset( 5, 0), REHex::Document::Comment("cold"));
+	doc->set_comment(BitOffset(100, 3), BitOffset( 0, 2), REHex::Document::Comment("bury"));
+	
+	doc->set_highlight(BitOffset( 0, 0), BitOffset(10, 0), 1);
+	doc->set_highlight(BitOffset(20, 2), BitOffset( 0, 4), 2);
+	
+	doc->set_data_type(BitOffset(200, 0), BitOffset(4, 0), "u32le");
+	doc->set_data_type(BitOffset(204, 0), BitOffset(4, 0), "u32le");
+	doc->set_data_type(BitOffset(300, 0), BitOffset(10, 0), "custom-number", AutoJSON("{ \"base-type\": \"UNSIGNED_INT\", \"endianness\": \"BIG\", \"bits\": 2 }").json);
+	
+	doc->set_virt_mapping(500, 0x10000, 100);
+	doc->set_virt_mapping(600, 0x400, 100);
+	
+	doc->set_write_protect(true);
+	
+	BitRangeTree<Document::Comment> expect_comments = doc->get_comments();
+	BitRangeMap<int> expect_highlights = doc->get_highlights();
+	BitRangeMap<Document::TypeInfo> expect_types = doc->get_data_types();
+	ByteRangeMap<off_t> expect_real_to_virt_segs = doc->get_real_to_virt_segs();
+	ByteRangeMap<off_t> expect_virt_to_real_segs = doc->get_virt_to_real_segs();
+	
+	TempFilename tfn;
+	doc->save_metadata_binary(tfn.tmpfile);
+	
+	AutoJSON empty_metadata(R"({
+		"comments": [],
+		"data_types": [],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": false
+	})");
+	
+	doc->load_metadata(empty_metadata.json);
+	
+	ASSERT_TRUE(doc->get_comments().empty());
+	ASSERT_FALSE(doc->get_write_protect());
+	
+	doc->load_metadata(std::string(tfn.tmpfile));
+	
+	EXPECT_EQ(doc->get_comments(), expect_comments);
+	EXPECT_EQ(doc->get_highlights(), expect_highlights);
+	EXPECT_EQ(doc->get_data_types(), expect_types);
+	EXPECT_EQ(doc->get_real_to_virt_segs(), expect_real_to_virt_segs);
+	EXPECT_EQ(doc->get_virt_to_real_segs(), expect_virt_to_real_segs);
+	EXPECT_TRUE(doc->get_write_protect());
+}
+
+TEST_F(DocumentTest, SaveLoadMetadataBinaryArrayComments)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	std::shared_ptr<const Document::Comment::ArrayLayout> layout(new Document::Comment::ArrayLayout(BitOffset(8, 0), {
+		Document::Comment::ArrayLayout::Field(BitOffset(0, 0), BitOffset(4, 0), "id"),
+		Document::Comment::ArrayLayout::Field(BitOffset(4, 0), BitOffset(4, 0), wxString::FromUTF8((const char*)(u8"valué"))),
+	}));
+	
+	doc->set_comment(BitOffset(  0, 0), BitOffset(800, 0), REHex::Document::Comment("records", layout));
+	doc->set_comment(BitOffset(800, 0), BitOffset( 80, 0), REHex::Document::Comment("more records", layout));
+	doc->set_comment(BitOffset(900, 0), BitOffset( 10, 0), REHex::Document::Comment("records"));
+	
+	BitRangeTree<Document::Comment> expect_comments = doc->get_comments();
+	
+	TempFilename tfn;
+	doc->save_metadata_binary(tfn.tmpfile);
+	
+	AutoJSON empty_metadata(R"({
+		"comments": [],
+		"data_types": [],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": false
+	})");
+	
+	doc->load_metadata(empty_metadata.json);
+	
+	ASSERT_TRUE(doc->get_comments().empty());
+	
+	doc->load_metadata(std::string(tfn.tmpfile));
+	
+	auto &got = doc->get_comments();
+	EXPECT_EQ(got, expect_comments);
+	
+	auto records = got.find(BitRangeTreeKey(0, 800));
+	auto more_records = got.find(BitRangeTreeKey(800, 80));
+	
+	ASSERT_NE(records, got.end());
+	ASSERT_NE(more_records, got.end());
+	
+	ASSERT_TRUE(records->second.array);
+	EXPECT_EQ(records->second.array, more_records->second.array) << "Comments sharing a layout in the file share it when loaded";
+	
+	auto plain = got.find(BitRangeTreeKey(900, 10));
+	ASSERT_NE(plain, got.end());
+	EXPECT_FALSE(plain->second.array);
+}
+
+TEST_F(DocumentTest, LoadMetadataFileBinaryVersion1)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	/* Version 1 comment records have no array layout index. */
+	static const unsigned char DATA[] = {
+		'R', 'X', 'M', 'D', 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+		'S', 'T', 'R', 'S', 0x05, 0x00, 0x00, 0x00, 0x04, 'c', 'o', 'l', 'd',
+		'C', 'M', 'N', 'T', 0x07, 0x00, 0x00, 0x00, 0x00, 0x50, 0x00, 0x80, 0x02, 0x50, 0x00,
+	};
+	
+	TempFile tf(DATA, sizeof(DATA));
+	
+	doc->load_metadata(std::string(tf.tmpfile));
+	
+	BitRangeTree<Document::Comment> expect;
+	expect.set(BitOffset( 0, 0), BitOffset(10, 0), REHex::Document::Comment("cold"));
+	expect.set(BitOffset(16, 0), BitOffset(10, 0), REHex::Document::Comment("cold"));
+	
+	EXPECT_EQ(doc->get_comments(), expect);
+}
+
+TEST_F(DocumentTest, LoadMetadataFileJSON)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	TempFile tf(R"({
+		"comments": [
+			{
+				"length": 10,
+				"offset": 0,
+				"text": "cold"
+			}
+		],
+		"data_types": [],
+		"highlights": [],
+		"virt_mappings": [],
+		"write_protect": true
+	})");
+	
+	doc->load_metadata(std::string(tf.tmpfile));
+	
+	BitRangeTree<Document::Comment> expect;
+	expect.set(0, 10, REHex::Document::Comment("cold"));
+	
+	EXPECT_EQ(doc->get_comments(), expect);
+	EXPECT_TRUE(doc->get_write_protect());
+}
+
+TEST_F(DocumentTest, LoadMetadataFileBinaryTruncated)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	doc->set_comment(BitOffset(0, 0), BitOffset(10, 0), REHex::Document::Comment("cold"));
+	
+	/* Comment record containing a varint with no final byte. */
+	static const unsigned char DATA[] = {
+		'R', 'X', 'M', 'D', 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+		'C', 'M', 'N', 'T', 0x02, 0x00, 0x00, 0x00, 0x00, 0x80,
+	};
+	
+	TempFile tf(DATA, sizeof(DATA));
+	
+	EXPECT_THROW(doc->load_metadata(std::string(tf.tmpfile)), std::runtime_error);
+	
+	BitRangeTree<Document::Comment> expect;
+	expect.set(0, 10, REHex::Document::Comment("cold"));
+	
+	EXPECT_EQ(doc->get_comments(), expect) << "Metadata is unchanged after failing to load file";
+}
+
+TEST(Document, ConstructFromBuffer)
+{
+	static const char *REFERENCE_DATA = "cough rob greedy";
+	
+	std::unique_ptr<Buffer> buffer(new Buffer());
+	buffer->insert_data(0, (const unsigned char*)(REFERENCE_DATA), strlen(REFERENCE_DATA));
+	
+	Document doc(std::move(buffer));
+	
+	EXPECT_EQ(buffer.get(), nullptr) << "Document takes ownership of the Buffer";
+	EXPECT_EQ(doc.buffer_length(), (off_t)(strlen(REFERENCE_DATA)));
+	
+	std::vector<unsigned char> data = doc.read_data(0, 256);
+	
+	EXPECT_EQ(
+		std::string((const char*)(data.data()), data.size()),
+		std::string(REFERENCE_DATA, strlen(REFERENCE_DATA)));
+}
+
 TEST_F(DocumentTest, SerialiseDocumentWithoutBackingFile)
 {
 	static const char *REFERENCE_DATA = "cough rob greedy";
@@ -4725,6 +5110,185 @@ TEST_F(DocumentTest, SerialiseDocumentWithBackingFile)
 	EXPECT_FALSE(doc->is_dirty());
 }
 
+TEST_F(DocumentTest, AnnotationSession)
+{
+	/* Preload document with data. */
+	doc->insert_data(0, (const unsigned char*)(IPSUM), strlen(IPSUM));
+	doc->set_comment(100, 10, REHex::Document::Comment("existing"));
+	
+	events.clear();
+	
+	Document::AnnotationSession session(doc, "annotate");
+	
+	EXPECT_TRUE(session.set_comment(BitOffset(20, 0), BitOffset(4, 0), Document::Comment("child")));
+	EXPECT_TRUE(session.set_comment(BitOffset(10, 0), BitOffset(20, 0), Document::Comment("parent")));
+	EXPECT_TRUE(session.set_comment(BitOffset(0, 0), BitOffset(0, 0), Document::Comment("first")));
+	EXPECT_TRUE(session.set_comment(BitOffset(20, 0), BitOffset(4, 0), Document::Comment("replaced child")));
+	EXPECT_FALSE(session.set_comment(BitOffset(105, 0), BitOffset(10, 0), Document::Comment("straddles existing")));
+	
+	EXPECT_TRUE(session.set_data_type(BitOffset(20, 0), BitOffset(4, 0), "u32le"));
+	EXPECT_TRUE(session.set_data_type(BitOffset(0, 0), BitOffset(8, 0), "u16be"));
+	EXPECT_FALSE(session.set_data_type(BitOffset(0, 0), BitOffset(0, 0), "u16be"));
+	
+	EXPECT_TRUE(session.set_highlight(BitOffset(30, 0), BitOffset(10, 0), 0));
+	EXPECT_FALSE(session.set_highlight(BitOffset(30, 0), BitOffset(10, 0), 100));
+	
+	EXPECT_TRUE(session.set_virt_mapping(50, 2000, 10));
+	EXPECT_TRUE(session.set_virt_mapping(10, 1000, 20));
+	EXPECT_FALSE(session.set_virt_mapping(15, 3000, 10));
+	EXPECT_FALSE(session.set_virt_mapping(70, 1010, 10));
+	
+	EXPECT_EQ(session.size(), 9U);
+	
+	/* Nothing should happen until we commit. */
+	
+	EXPECT_EVENTS();
+	EXPECT_EQ(doc->get_comments().size(), 1U);
+	
+	session.commit();
+	
+	EXPECT_EQ(session.size(), 0U);
+	
+	EXPECT_EVENTS(
+		"EV_COMMENT_MODIFIED",
+		"EV_HIGHLIGHTS_CHANGED",
+		"EV_MAPPINGS_CHANGED",
+	);
+	
+	BitRangeTree<Document::Comment> expect_comments;
+	expect_comments.set(BitOffset(0, 0), BitOffset(0, 0), Document::Comment("first"));
+	expect_comments.set(BitOffset(10, 0), BitOffset(20, 0), Document::Comment("parent"));
+	expect_comments.set(BitOffset(20, 0), BitOffset(4, 0), Document::Comment("replaced child"));
+	expect_comments.set(BitOffset(100, 0), BitOffset(10, 0), Document::Comment("existing"));
+	
+	EXPECT_EQ(doc->get_comments(), expect_comments);
+	
+	EXPECT_DATA_TYPES(
+		DATA_TYPE(BitOffset(0, 0), BitOffset(8, 0), "u16be"),
+		DATA_TYPE(BitOffset(8, 0), BitOffset(12, 0), ""),
+		DATA_TYPE(BitOffset(20, 0), BitOffset(4, 0), "u32le"),
+		DATA_TYPE(BitOffset(24, 0), BitOffset((strlen(IPSUM) - 24), 0), ""),
+	);
+	
+	BitRangeMap<int> expect_highlights;
+	expect_highlights.set_range(30, 10, 0);
+	
+	EXPECT_EQ(doc->get_highlights(), expect_highlights);
+	
+	{
+		const std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > EXPECT_R2V = {
+			std::make_pair(ByteRangeMap<off_t>::Range(10, 20), 1000),
+			std::make_pair(ByteRangeMap<off_t>::Range(50, 10), 2000),
+		};
+		
+		EXPECT_EQ(doc->get_real_to_virt_segs().get_ranges(), EXPECT_R2V);
+	}
+	
+	{
+		const std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > EXPECT_V2R = {
+			std::make_pair(ByteRangeMap<off_t>::Range(1000, 20), 10),
+			std::make_pair(ByteRangeMap<off_t>::Range(2000, 10), 50),
+		};
+		
+		EXPECT_EQ(doc->get_virt_to_real_segs().get_ranges(), EXPECT_V2R);
+	}
+}
+
+TEST_F(DocumentTest, AnnotationSessionUndo)
+{
+	/* Preload document with data. */
+	doc->insert_data(0, (const unsigned char*)(IPSUM), strlen(IPSUM));
+	doc->set_comment(100, 10, REHex::Document::Comment("existing"));
+	
+	const BitRangeTree<Document::Comment> initial_comments = doc->get_comments();
+	const BitRangeMap<Document::TypeInfo> initial_types = doc->get_data_types();
+	
+	{
+		Document::AnnotationSession session(doc, "annotate");
+		
+		for(off_t i = 0; i < 50; ++i)
+		{
+			session.set_comment(BitOffset((i * 2), 0), BitOffset(2, 0), Document::Comment("field"));
+			session.set_data_type(BitOffset((i * 2), 0), BitOffset(2, 0), "u16le");
+		}
+		
+		session.set_highlight(BitOffset(0, 0), BitOffset(100, 0), 1);
+		session.set_virt_mapping(0, 1000, 100);
+		
+		session.commit();
+	}
+	
+	const BitRangeTree<Document::Comment> annotated_comments = doc->get_comments();
+	const BitRangeMap<Document::TypeInfo> annotated_types = doc->get_data_types();
+	
+	ASSERT_EQ(annotated_comments.size(), 51U) << "Sanity check";
+	
+	/* A single undo should revert the whole session... */
+	
+	events.clear();
+	doc->undo();
+	
+	EXPECT_EVENTS(
+		"EV_COMMENT_MODIFIED",
+		"EV_HIGHLIGHTS_CHANGED",
+		"EV_MAPPINGS_CHANGED",
+	);
+	
+	EXPECT_EQ(doc->get_comments(), initial_comments);
+	EXPECT_EQ(doc->get_data_types(), initial_types);
+	EXPECT_EQ(doc->get_highlights(), BitRangeMap<int>());
+	EXPECT_TRUE(doc->get_real_to_virt_segs().empty());
+	EXPECT_TRUE(doc->get_virt_to_real_segs().empty());
+	
+	/* ...and a single redo should reapply it. */
+	
+	events.clear();
+	doc->redo();
+	
+	EXPECT_EVENTS(
+		"EV_COMMENT_MODIFIED",
+		"EV_HIGHLIGHTS_CHANGED",
+		"EV_MAPPINGS_CHANGED",
+	);
+	
+	EXPECT_EQ(doc->get_comments(), annotated_comments);
+	EXPECT_EQ(doc->get_data_types(), annotated_types);
+	EXPECT_EQ(doc->get_real_to_virt_segs().size(), 1U);
+	
+	/* And then undo the comment we set before the session. */
+	
+	doc->undo();
+	doc->undo();
+	
+	EXPECT_TRUE(doc->get_comments().empty());
+}
+
+TEST_F(DocumentTest, AnnotationSessionOverlappingComments)
+{
+	/* Preload document with data. */
+	doc->insert_data(0, (const unsigned char*)(IPSUM), strlen(IPSUM));
+	
+	Document::AnnotationSession session(doc, "annotate");
+	
+	EXPECT_TRUE(session.set_comment(BitOffset(0, 0), BitOffset(10, 0), Document::Comment("first")));
+	EXPECT_FALSE(session.set_comment(BitOffset(5, 0), BitOffset(10, 0), Document::Comment("straddles end of first")));
+	EXPECT_TRUE(session.set_comment(BitOffset(20, 0), BitOffset(10, 0), Document::Comment("second")));
+	EXPECT_FALSE(session.set_comment(BitOffset(15, 0), BitOffset(10, 0), Document::Comment("straddles start of second")));
+	EXPECT_TRUE(session.set_comment(BitOffset(22, 0), BitOffset(4, 0), Document::Comment("within second")));
+	EXPECT_TRUE(session.set_comment(BitOffset(0, 0), BitOffset(10, 0), Document::Comment("replaces first")));
+	
+	EXPECT_EQ(session.size(), 4U);
+	
+	session.commit();
+	
+	BitRangeTree<Document::Comment> expect_comments;
+	expect_comments.set(BitOffset(0, 0), BitOffset(10, 0), Document::Comment("replaces first"));
+	expect_comments.set(BitOffset(20, 0), BitOffset(10, 0), Document::Comment("second"));
+	expect_comments.set(BitOffset(22, 0), BitOffset(4, 0), Document::Comment("within second"));
+	
+	EXPECT_EQ(doc->get_comments(), expect_comments);
+}
+
 TEST(Document, TypeInfoComparison)
 {
 	/* Check name comparison. */
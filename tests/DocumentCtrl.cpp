@@ -21,6 +21,7 @@
 #include <wx/event.h>
 #include <wx/frame.h>
 
+#include "../src/App.hpp"
 #include "../src/document.hpp"
 #include "../src/DocumentCtrl.hpp"
 #include "../src/SharedDocumentPointer.hpp"
@@ -2011,3 +2012,204 @@ TEST_F(DocumentCtrlTest, GetSelectionInRegionBitAligned)
 		doc_ctrl->get_selection_in_region(r3),
 		std::make_pair(BitOffset(300, 0), BitOffset(19, 2)));
 }
+
+/* Exposes the highlighting internals of DataRegionDocHighlight for testing. */
+class HighlightTestRegion: public DocumentCtrl::DataRegionDocHighlight
+{
+	public:
+		HighlightTestRegion(SharedDocumentPointer &document, off_t d_offset, off_t d_length):
+			DataRegionDocHighlight(document, d_offset, d_length, d_offset) {}
+		
+		using DataRegionDocHighlight::Highlight;
+		using DataRegionDocHighlight::HighlightRuns;
+		using DataRegionDocHighlight::highlight_at_off;
+		using DataRegionDocHighlight::resolve_highlights;
+};
+
+static std::string highlight_str(const HighlightTestRegion::Highlight *highlight)
+{
+	if(highlight == NULL || !highlight->enable)
+	{
+		return "none";
+	}
+	
+	return highlight->fg_colour.GetAsString(wxC2S_HTML_SYNTAX).ToStdString()
+		+ "/" + highlight->bg_colour.GetAsString(wxC2S_HTML_SYNTAX).ToStdString();
+}
+
+static HighlightTestRegion::Highlight RED()   { return HighlightTestRegion::Highlight(wxColour(0xFF, 0x00, 0x00), wxColour(0x00, 0x00, 0x00)); }
+static HighlightTestRegion::Highlight GREEN() { return HighlightTestRegion::Highlight(wxColour(0x00, 0xFF, 0x00), wxColour(0x00, 0x00, 0x00)); }
+static HighlightTestRegion::Highlight BLUE()  { return HighlightTestRegion::Highlight(wxColour(0x00, 0x00, 0xFF), wxColour(0x00, 0x00, 0x00)); }
+
+TEST(DocumentCtrlHighlightRuns, Empty)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(0, 0))), "none");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(100, 0))), "none");
+	
+	/* Zero length ranges are ignored. */
+	runs.set_range(BitOffset(10, 0), BitOffset(0, 0), RED());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(10, 0))), "none");
+}
+
+TEST(DocumentCtrlHighlightRuns, OutOfOrderRanges)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	runs.set_range(BitOffset(20, 0), BitOffset(10, 0), RED());
+	runs.set_range(BitOffset(0, 4), BitOffset(5, 0), GREEN());
+	runs.set_range(BitOffset(40, 0), BitOffset(1, 0), BLUE());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(0, 0))),  "none")          << "Lookup before first run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(0, 4))),  "#00FF00/#000000") << "Lookup at start of run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(3, 0))),  "#00FF00/#000000") << "Lookup inside run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(5, 0))),  "#00FF00/#000000") << "Lookup at end of run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(5, 4))),  "none")          << "Lookup after run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(19, 7))), "none")          << "Lookup between runs";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(20, 0))), "#FF0000/#000000") << "Lookup at start of run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(29, 7))), "#FF0000/#000000") << "Lookup at end of run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(30, 0))), "none")          << "Lookup between runs";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(40, 0))), "#0000FF/#000000") << "Lookup in last run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(41, 0))), "none")          << "Lookup after last run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(1000, 0))), "none")        << "Lookup far after last run";
+}
+
+TEST(DocumentCtrlHighlightRuns, OverlappingRanges)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	runs.set_range(BitOffset(0, 0), BitOffset(20, 0), RED());
+	runs.set_range(BitOffset(10, 0), BitOffset(5, 0), GREEN());   /* Inside RED */
+	runs.set_range(BitOffset(18, 0), BitOffset(4, 0), BLUE());    /* Over the end of RED */
+	runs.set_range(BitOffset(12, 0), BitOffset(8, 0), RED());     /* Over GREEN and BLUE */
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(0, 0))),  "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(9, 7))),  "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(10, 0))), "#00FF00/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(11, 7))), "#00FF00/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(12, 0))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(19, 7))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(20, 0))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(21, 7))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(22, 0))), "none");
+}
+
+TEST(DocumentCtrlHighlightRuns, AdjacentRanges)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	/* Distinct Highlight objects with the same colours are treated as the same highlight. */
+	const HighlightTestRegion::Highlight RED2(wxColour(0xFF, 0x00, 0x00), wxColour(0x00, 0x00, 0x00));
+	
+	runs.set_range(BitOffset(4, 0), BitOffset(4, 0), RED());
+	runs.set_range(BitOffset(8, 0), BitOffset(4, 0), RED2);
+	runs.set_range(BitOffset(0, 0), BitOffset(4, 0), GREEN());
+	runs.set_range(BitOffset(12, 0), BitOffset(0, 4), BLUE());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(3, 7))),  "#00FF00/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(4, 0))),  "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(7, 7))),  "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(8, 0))),  "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(11, 7))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(12, 0))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(12, 3))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(12, 4))), "none");
+}
+
+TEST(DocumentCtrlHighlightRuns, LookupsOutOfOrder)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	runs.set_range(BitOffset(10, 0), BitOffset(10, 0), RED());
+	runs.set_range(BitOffset(30, 0), BitOffset(10, 0), GREEN());
+	runs.set_range(BitOffset(50, 0), BitOffset(10, 0), BLUE());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(55, 0))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(35, 0))), "#00FF00/#000000") << "Lookup before previous run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(25, 0))), "none")          << "Lookup between runs before previous run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(5, 0))),  "none")          << "Lookup before first run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(60, 0))), "none")          << "Lookup after last run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(10, 0))), "#FF0000/#000000") << "Lookup in first run after last run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(19, 0))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(12, 0))), "#FF0000/#000000") << "Lookup backwards within a run";
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(59, 7))), "#0000FF/#000000");
+}
+
+TEST(DocumentCtrlHighlightRuns, SetRangeAfterGet)
+{
+	HighlightTestRegion::HighlightRuns runs;
+	
+	runs.set_range(BitOffset(10, 0), BitOffset(10, 0), RED());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(15, 0))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(25, 0))), "none");
+	
+	runs.set_range(BitOffset(0, 0), BitOffset(5, 0), GREEN());
+	runs.set_range(BitOffset(14, 0), BitOffset(2, 0), BLUE());
+	
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(0, 0))),  "#00FF00/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(13, 7))), "#FF0000/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(15, 0))), "#0000FF/#000000");
+	EXPECT_EQ(highlight_str(runs.get(BitOffset(16, 0))), "#FF0000/#000000");
+}
+
+TEST_F(DocumentCtrlTest, ResolveHighlightsMatchesHighlightAtOff)
+{
+	std::vector<unsigned char> file_data(64, 0x00);
+	TempFile tmpfile(file_data.data(), file_data.size());
+	
+	SharedDocumentPointer fdoc(SharedDocumentPointer::make(wxFileName(tmpfile.tmpfile)));
+	
+	const unsigned char X[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	
+	fdoc->overwrite_data(BitOffset(10, 0), X, 1);
+	fdoc->overwrite_data(BitOffset(20, 0), X, 4);
+	fdoc->overwrite_data(BitOffset(40, 0), X, 1);
+	fdoc->overwrite_data(BitOffset(42, 0), X, 1);
+	
+	ASSERT_FALSE(fdoc->get_highlight_colours().begin() == fdoc->get_highlight_colours().end());
+	fdoc->set_highlight(BitOffset(30, 0), BitOffset(11, 0), fdoc->get_highlight_colours().begin()->first);
+	
+	HighlightTestRegion region(fdoc, 0, 64);
+	
+	DirtyByteDisplayMode orig_dbd = wxGetApp().settings->get_dirty_byte_display_mode();
+	
+	const DirtyByteDisplayMode MODES[] = { DirtyByteDisplayMode::COLOURED, DirtyByteDisplayMode::INVERTED, DirtyByteDisplayMode::NORMAL };
+	
+	/* Nibbles and characters of various widths, anything drawn overlapping a dirty byte is
+	 * drawn as dirty, so dirty ranges are extended back to the start of whatever overlaps them.
+	*/
+	const BitOffset CHECK_LENGTHS[] = { BitOffset(0, 4), BitOffset(1, 0), BitOffset(2, 0), BitOffset(3, 0) };
+	
+	const off_t RESOLVE_FROM[] = { 0, 1, 9, 11, 19, 21, 38, 41 };
+	
+	for(size_t m = 0; m < (sizeof(MODES) / sizeof(*MODES)); ++m)
+	{
+		wxGetApp().settings->set_dirty_byte_display_mode(MODES[m]);
+		
+		for(size_t l = 0; l < (sizeof(CHECK_LENGTHS) / sizeof(*CHECK_LENGTHS)); ++l)
+		{
+			for(size_t f = 0; f < (sizeof(RESOLVE_FROM) / sizeof(*RESOLVE_FROM)); ++f)
+			{
+				BitOffset begin(RESOLVE_FROM[f], 0);
+				BitOffset end(64, 0);
+				
+				HighlightTestRegion::HighlightRuns runs;
+				region.resolve_highlights(begin, (end - begin), CHECK_LENGTHS[l], doc_ctrl, runs);
+				
+				for(BitOffset off = begin; off < end; off += CHECK_LENGTHS[l])
+				{
+					HighlightTestRegion::Highlight expect = region.highlight_at_off(off, CHECK_LENGTHS[l], doc_ctrl);
+					
+					EXPECT_EQ(highlight_str(runs.get(off)), highlight_str(&expect))
+						<< "Resolved highlight matches highlight_at_off() (mode " << m << ", length " << CHECK_LENGTHS[l].total_bits()
+						<< " bits, resolving from " << RESOLVE_FROM[f] << ", offset " << off.byte() << "+" << off.bit() << ")";
+				}
+			}
+		}
+	}
+	
+	wxGetApp().settings->set_dirty_byte_display_mode(orig_dbd);
+}
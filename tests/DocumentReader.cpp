@@ -0,0 +1,234 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/DocumentReader.hpp"
+
+using namespace REHex;
+
+class DocumentReaderTest: public ::testing::Test
+{
+	protected:
+		Document doc;
+		std::vector<unsigned char> data;
+		
+		DocumentReaderTest()
+		{
+			/* Enough data to span a few read-ahead blocks. */
+			
+			data.resize(DocumentReader::READ_AHEAD * 3 + 123);
+			
+			for(size_t i = 0; i < data.size(); ++i)
+			{
+				data[i] = (unsigned char)(i * 7);
+			}
+			
+			doc.insert_data(0, data.data(), data.size());
+		}
+		
+		std::string read_string(DocumentReader &reader, size_t length)
+		{
+			size_t got;
+			const unsigned char *p = reader.read(length, &got);
+			
+			return std::string((const char*)(p), got);
+		}
+		
+		std::string data_string(size_t offset, size_t length)
+		{
+			return std::string((const char*)(data.data() + offset), length);
+		}
+};
+
+TEST(DocumentReaderNumberType, Parse)
+{
+	DocumentReader::NumberType t;
+	
+	t = DocumentReader::NumberType::parse("u8");
+	EXPECT_EQ(t.kind, DocumentReader::NumberType::UNSIGNED);
+	EXPECT_EQ(t.size, 1U);
+	
+	t = DocumentReader::NumberType::parse("s16be");
+	EXPECT_EQ(t.kind, DocumentReader::NumberType::SIGNED);
+	EXPECT_EQ(t.size, 2U);
+	EXPECT_TRUE(t.big_endian);
+	
+	t = DocumentReader::NumberType::parse("u64le");
+	EXPECT_EQ(t.kind, DocumentReader::NumberType::UNSIGNED);
+	EXPECT_EQ(t.size, 8U);
+	EXPECT_FALSE(t.big_endian);
+	
+	t = DocumentReader::NumberType::parse("f32be");
+	EXPECT_EQ(t.kind, DocumentReader::NumberType::FLOAT);
+	EXPECT_EQ(t.size, 4U);
+	EXPECT_TRUE(t.big_endian);
+	
+	EXPECT_THROW(DocumentReader::NumberType::parse(""), std::invalid_argument);
+	EXPECT_THROW(DocumentReader::NumberType::parse("u16"), std::invalid_argument);
+	EXPECT_THROW(DocumentReader::NumberType::parse("u8le"), std::invalid_argument);
+	EXPECT_THROW(DocumentReader::NumberType::parse("u24le"), std::invalid_argument);
+	EXPECT_THROW(DocumentReader::NumberType::parse("f16le"), std::invalid_argument);
+	EXPECT_THROW(DocumentReader::NumberType::parse("x32le"), std::invalid_argument);
+}
+
+TEST(DocumentReaderNumberType, Decode)
+{
+	const unsigned char BYTES[] = { 0xFE, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x87 };
+	
+	EXPECT_EQ(DocumentReader::NumberType::parse("u8").decode_integer(BYTES), 0xFE);
+	EXPECT_EQ(DocumentReader::NumberType::parse("s8").decode_integer(BYTES), -2);
+	EXPECT_EQ(DocumentReader::NumberType::parse("u16le").decode_integer(BYTES), 0x01FE);
+	EXPECT_EQ(DocumentReader::NumberType::parse("u16be").decode_integer(BYTES), 0xFE01);
+	EXPECT_EQ(DocumentReader::NumberType::parse("s16be").decode_integer(BYTES), (int16_t)(0xFE01));
+	EXPECT_EQ(DocumentReader::NumberType::parse("u32le").decode_integer(BYTES), 0x030201FE);
+	EXPECT_EQ(DocumentReader::NumberType::parse("s32be").decode_integer(BYTES), (int32_t)(0xFE010203));
+	EXPECT_EQ(DocumentReader::NumberType::parse("u64be").decode_integer(BYTES), (int64_t)(0xFE01020304050687ULL));
+	EXPECT_EQ(DocumentReader::NumberType::parse("s64le").decode_integer(BYTES), (int64_t)(0x87060504030201FEULL));
+	
+	const unsigned char F32LE[] = { 0x00, 0x00, 0xC0, 0x3F };
+	const unsigned char F64BE[] = { 0xC0, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	
+	EXPECT_EQ(DocumentReader::NumberType::parse("f32le").decode_float(F32LE), 1.5);
+	EXPECT_EQ(DocumentReader::NumberType::parse("f64be").decode_float(F64BE), -2.5);
+	
+	EXPECT_EQ(DocumentReader::NumberType::parse("u8").decode_float(BYTES), 254.0);
+	EXPECT_EQ(DocumentReader::NumberType::parse("s8").decode_float(BYTES), -2.0);
+}
+
+TEST_F(DocumentReaderTest, ReadSequential)
+{
+	DocumentReader reader(&doc);
+	
+	EXPECT_EQ(reader.tell(), BitOffset(0, 0));
+	
+	/* Read in odd-sized pieces so they straddle the block boundaries. */
+	
+	size_t offset = 0;
+	while(offset < data.size())
+	{
+		size_t length = std::min<size_t>(1000, (data.size() - offset));
+		
+		ASSERT_EQ(read_string(reader, 1000), data_string(offset, length)) << "offset = " << offset;
+		offset += length;
+	}
+	
+	EXPECT_EQ(reader.tell(), BitOffset(data.size(), 0));
+	EXPECT_TRUE(reader.eof());
+	
+	EXPECT_EQ(read_string(reader, 10), "");
+}
+
+TEST_F(DocumentReaderTest, ReadLargerThanBlock)
+{
+	DocumentReader reader(&doc, BitOffset(10, 0));
+	
+	EXPECT_EQ(read_string(reader, 10), data_string(10, 10));
+	EXPECT_EQ(read_string(reader, DocumentReader::READ_AHEAD * 2), data_string(20, DocumentReader::READ_AHEAD * 2));
+	EXPECT_EQ(reader.tell(), BitOffset(20 + DocumentReader::READ_AHEAD * 2, 0));
+}
+
+TEST_F(DocumentReaderTest, ReadBitOffset)
+{
+	DocumentReader reader(&doc, BitOffset(1, 4));
+	
+	std::vector<unsigned char> expect = doc.read_data(BitOffset(1, 4), 16);
+	
+	EXPECT_EQ(read_string(reader, 16), std::string((const char*)(expect.data()), expect.size()));
+	EXPECT_EQ(reader.tell(), BitOffset(17, 4));
+}
+
+TEST_F(DocumentReaderTest, Seek)
+{
+	DocumentReader reader(&doc);
+	
+	EXPECT_EQ(read_string(reader, 100), data_string(0, 100));
+	
+	/* Within the current block. */
+	reader.seek(BitOffset(50, 0));
+	EXPECT_EQ(reader.tell(), BitOffset(50, 0));
+	EXPECT_EQ(read_string(reader, 10), data_string(50, 10));
+	
+	/* Outside of the current block. */
+	reader.seek(BitOffset(DocumentReader::READ_AHEAD * 2, 0));
+	EXPECT_EQ(read_string(reader, 10), data_string(DocumentReader::READ_AHEAD * 2, 10));
+	
+	/* Backwards out of the current block. */
+	reader.seek(BitOffset(5, 0));
+	EXPECT_EQ(read_string(reader, 10), data_string(5, 10));
+	
+	/* Before the start of the file. */
+	reader.seek(BitOffset(-5, 0));
+	EXPECT_EQ(reader.tell(), BitOffset(0, 0));
+	EXPECT_EQ(read_string(reader, 10), data_string(0, 10));
+	
+	/* Past the end of the file. */
+	reader.seek(BitOffset(data.size() + 10, 0));
+	EXPECT_TRUE(reader.eof());
+	EXPECT_EQ(read_string(reader, 10), "");
+}
+
+TEST_F(DocumentReaderTest, ReadIntegers)
+{
+	DocumentReader reader(&doc, BitOffset(1, 0));
+	DocumentReader::NumberType u32be = DocumentReader::NumberType::parse("u32be");
+	
+	size_t count = (data.size() - 1) / 4;
+	
+	std::vector<int64_t> values;
+	EXPECT_EQ(reader.read_integers(u32be, (count + 10), &values), count);
+	ASSERT_EQ(values.size(), count);
+	
+	for(size_t i = 0; i < count; ++i)
+	{
+		ASSERT_EQ(values[i], u32be.decode_integer(data.data() + 1 + (i * 4))) << "i = " << i;
+	}
+	
+	/* The trailing bytes too short for another value are left for the next read. */
+	
+	EXPECT_EQ(reader.tell(), BitOffset(1 + (count * 4), 0));
+	EXPECT_FALSE(reader.eof());
+	EXPECT_EQ(read_string(reader, 10), data_string(1 + (count * 4), (data.size() - 1) % 4));
+}
+
+TEST_F(DocumentReaderTest, ReadFloats)
+{
+	DocumentReader reader(&doc, BitOffset(100, 0));
+	DocumentReader::NumberType f64le = DocumentReader::NumberType::parse("f64le");
+	DocumentReader::NumberType s16le = DocumentReader::NumberType::parse("s16le");
+	
+	std::vector<double> values;
+	EXPECT_EQ(reader.read_floats(f64le, 3, &values), 3U);
+	EXPECT_EQ(reader.read_floats(s16le, 2, &values), 2U);
+	
+	ASSERT_EQ(values.size(), 5U);
+	
+	EXPECT_EQ(values[0], f64le.decode_float(data.data() + 100));
+	EXPECT_EQ(values[1], f64le.decode_float(data.data() + 108));
+	EXPECT_EQ(values[2], f64le.decode_float(data.data() + 116));
+	EXPECT_EQ(values[3], (double)(s16le.decode_integer(data.data() + 124)));
+	EXPECT_EQ(values[4], (double)(s16le.decode_integer(data.data() + 126)));
+	
+	EXPECT_EQ(reader.tell(), BitOffset(128, 0));
+}
@@ -0,0 +1,417 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../src/BitOffset.hpp"
+#include "../src/LRUCache.hpp"
+
+using namespace REHex;
+
+TEST(LRUCache, GetSet)
+{
+	LRUCache<int, std::string> cache(4);
+	
+	EXPECT_EQ(cache.get(1), (const std::string*)(NULL)) << "LRUCache::get() returns NULL for missing key";
+	
+	const std::string *v1 = cache.set(1, "one");
+	ASSERT_NE(v1, (const std::string*)(NULL));
+	EXPECT_EQ(*v1, "one") << "LRUCache::set() returns pointer to stored value";
+	
+	cache.set(2, "two");
+	cache.set(3, "three");
+	
+	ASSERT_NE(cache.get(1), (const std::string*)(NULL));
+	EXPECT_EQ(*(cache.get(1)), "one");
+	EXPECT_EQ(cache.get(1), v1) << "LRUCache::get() returns pointer to stored value";
+	
+	ASSERT_NE(cache.get(2), (const std::string*)(NULL));
+	EXPECT_EQ(*(cache.get(2)), "two");
+	
+	ASSERT_NE(cache.get(3), (const std::string*)(NULL));
+	EXPECT_EQ(*(cache.get(3)), "three");
+	
+	EXPECT_EQ(cache.get(4), (const std::string*)(NULL));
+	EXPECT_EQ(cache.size(), 3U);
+	
+	cache.set(2, "TWO");
+	
+	ASSERT_NE(cache.get(2), (const std::string*)(NULL));
+	EXPECT_EQ(*(cache.get(2)), "TWO") << "LRUCache::set() replaces existing value";
+	EXPECT_EQ(cache.size(), 3U);
+}
+
+TEST(LRUCache, EvictLeastRecentlyUsed)
+{
+	LRUCache<int, int> cache(3);
+	
+	cache.set(1, 10);
+	cache.set(2, 20);
+	cache.set(3, 30);
+	
+	/* Touch 1 so 2 becomes the least recently used. */
+	cache.get(1);
+	
+	cache.set(4, 40);
+	
+	EXPECT_EQ(cache.size(), 3U);
+	EXPECT_NE(cache.get(1), (const int*)(NULL));
+	EXPECT_EQ(cache.get(2), (const int*)(NULL)) << "LRUCache::set() evicts least recently read element";
+	EXPECT_NE(cache.get(3), (const int*)(NULL));
+	EXPECT_NE(cache.get(4), (const int*)(NULL));
+	
+	/* Replacing a value also counts as a use. */
+	cache.set(3, 31);
+	cache.set(5, 50);
+	
+	EXPECT_EQ(cache.get(1), (const int*)(NULL)) << "LRUCache::set() evicts least recently written element";
+	ASSERT_NE(cache.get(3), (const int*)(NULL));
+	EXPECT_EQ(*(cache.get(3)), 31);
+	EXPECT_NE(cache.get(4), (const int*)(NULL));
+	EXPECT_NE(cache.get(5), (const int*)(NULL));
+}
+
+TEST(LRUCache, Erase)
+{
+	LRUCache<int, int> cache(8);
+	
+	for(int i = 0; i < 8; ++i)
+	{
+		cache.set(i, i * 10);
+	}
+	
+	cache.erase(3);
+	cache.erase(100);
+	
+	EXPECT_EQ(cache.size(), 7U);
+	EXPECT_EQ(cache.get(3), (const int*)(NULL)) << "LRUCache::erase() removes element";
+	
+	for(int i = 0; i < 8; ++i)
+	{
+		if(i != 3)
+		{
+			ASSERT_NE(cache.get(i), (const int*)(NULL)) << "LRUCache::erase() doesn't remove other elements";
+			EXPECT_EQ(*(cache.get(i)), i * 10);
+		}
+	}
+	
+	/* Erased slot is reused without evicting anything. */
+	cache.set(8, 80);
+	
+	EXPECT_EQ(cache.size(), 8U);
+	
+	for(int i = 0; i <= 8; ++i)
+	{
+		if(i != 3)
+		{
+			EXPECT_NE(cache.get(i), (const int*)(NULL));
+		}
+	}
+}
+
+TEST(LRUCache, EraseRange)
+{
+	LRUCache<int, int> cache(16);
+	
+	for(int i = 0; i < 10; ++i)
+	{
+		cache.set(i, i);
+	}
+	
+	cache.erase(3, 7);
+	
+	EXPECT_EQ(cache.size(), 6U);
+	
+	for(int i = 0; i < 10; ++i)
+	{
+		if(i >= 3 && i < 7)
+		{
+			EXPECT_EQ(cache.get(i), (const int*)(NULL)) << "LRUCache::erase() removes elements in range";
+		}
+		else{
+			EXPECT_NE(cache.get(i), (const int*)(NULL)) << "LRUCache::erase() doesn't remove elements outside range";
+		}
+	}
+}
+
+TEST(LRUCache, Clear)
+{
+	LRUCache<int, std::string> cache(4);
+	
+	cache.set(1, "one");
+	cache.set(2, "two");
+	
+	cache.clear();
+	
+	EXPECT_EQ(cache.size(), 0U);
+	EXPECT_EQ(cache.get(1), (const std::string*)(NULL));
+	EXPECT_EQ(cache.get(2), (const std::string*)(NULL));
+	
+	cache.set(3, "three");
+	
+	ASSERT_NE(cache.get(3), (const std::string*)(NULL));
+	EXPECT_EQ(*(cache.get(3)), "three") << "LRUCache can be used after clear()";
+}
+
+TEST(LRUCache, DestroysValues)
+{
+	std::shared_ptr<int> p(new int(0));
+	
+	{
+		LRUCache<int, std::shared_ptr<int>> cache(2);
+		
+		cache.set(1, p);
+		cache.set(2, p);
+		
+		EXPECT_EQ(p.use_count(), 3);
+		
+		cache.set(3, p);
+		EXPECT_EQ(p.use_count(), 3) << "Evicted values are destroyed";
+		
+		cache.erase(2);
+		EXPECT_EQ(p.use_count(), 2) << "Erased values are destroyed";
+		
+		cache.set(4, p);
+		cache.clear();
+		EXPECT_EQ(p.use_count(), 1) << "Cleared values are destroyed";
+		
+		cache.set(5, p);
+		cache.set(6, p);
+	}
+	
+	EXPECT_EQ(p.use_count(), 1) << "Values are destroyed with the cache";
+}
+
+TEST(LRUCache, TupleAndBitOffsetKeys)
+{
+	LRUCache<std::tuple<int, unsigned, unsigned>, int> tuple_cache(4);
+	
+	tuple_cache.set(std::make_tuple(1, 2U, 3U), 123);
+	tuple_cache.set(std::make_tuple(3, 2U, 1U), 321);
+	
+	ASSERT_NE(tuple_cache.get(std::make_tuple(1, 2U, 3U)), (const int*)(NULL));
+	EXPECT_EQ(*(tuple_cache.get(std::make_tuple(1, 2U, 3U))), 123);
+	ASSERT_NE(tuple_cache.get(std::make_tuple(3, 2U, 1U)), (const int*)(NULL));
+	EXPECT_EQ(*(tuple_cache.get(std::make_tuple(3, 2U, 1U))), 321);
+	EXPECT_EQ(tuple_cache.get(std::make_tuple(1, 3U, 2U)), (const int*)(NULL));
+	
+	LRUCache<BitOffset, int> bo_cache(4);
+	
+	bo_cache.set(BitOffset(10, 0), 1);
+	bo_cache.set(BitOffset(10, 4), 2);
+	
+	ASSERT_NE(bo_cache.get(BitOffset(10, 0)), (const int*)(NULL));
+	EXPECT_EQ(*(bo_cache.get(BitOffset(10, 0))), 1);
+	ASSERT_NE(bo_cache.get(BitOffset(10, 4)), (const int*)(NULL));
+	EXPECT_EQ(*(bo_cache.get(BitOffset(10, 4))), 2);
+	EXPECT_EQ(bo_cache.get(BitOffset(11, 0)), (const int*)(NULL));
+}
+
+TEST(LRUCache, RandomisedAgainstReference)
+{
+	/* Compare against a simple list-based model, using keys which are multiples of a
+	 * large power of two, like the chunk offsets used by HierarchicalByteAccumulator.
+	*/
+	
+	const size_t MAX_ITEMS = 37;
+	
+	LRUCache<off_t, int> cache(MAX_ITEMS);
+	std::list< std::pair<off_t, int> > model;
+	
+	auto model_find = [&](off_t k)
+	{
+		for(auto i = model.begin(); i != model.end(); ++i)
+		{
+			if(i->first == k)
+			{
+				return i;
+			}
+		}
+		
+		return model.end();
+	};
+	
+	uint64_t lcg = 1;
+	
+	for(int i = 0; i < 100000; ++i)
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		
+		off_t k = (off_t)((lcg >> 33) % 100) * 4096;
+		int op = (lcg >> 20) % 16;
+		
+		if(op < 7)
+		{
+			const int *v = cache.get(k);
+			auto mi = model_find(k);
+			
+			if(mi != model.end())
+			{
+				ASSERT_NE(v, (const int*)(NULL)) << "Key " << k << " found at step " << i;
+				ASSERT_EQ(*v, mi->second);
+				
+				model.splice(model.begin(), model, mi);
+			}
+			else{
+				ASSERT_EQ(v, (const int*)(NULL)) << "Key " << k << " not found at step " << i;
+			}
+		}
+		else if(op < 14)
+		{
+			cache.set(k, i);
+			
+			auto mi = model_find(k);
+			if(mi != model.end())
+			{
+				model.erase(mi);
+			}
+			else if(model.size() >= MAX_ITEMS)
+			{
+				model.pop_back();
+			}
+			
+			model.emplace_front(k, i);
+		}
+		else if(op < 15)
+		{
+			cache.erase(k);
+			
+			auto mi = model_find(k);
+			if(mi != model.end())
+			{
+				model.erase(mi);
+			}
+		}
+		else{
+			off_t end = k + (off_t)((lcg >> 40) % 8) * 4096;
+			cache.erase(k, end);
+			
+			for(auto mi = model.begin(); mi != model.end();)
+			{
+				if(mi->first >= k && mi->first < end)
+				{
+					mi = model.erase(mi);
+				}
+				else{
+					++mi;
+				}
+			}
+		}
+		
+		ASSERT_EQ(cache.size(), model.size()) << "Size matches after step " << i;
+	}
+}
+
+TEST(ShardedLRUCache, GetSetErase)
+{
+	ShardedLRUCache<off_t, int> cache(64, 4);
+	
+	int v = -1;
+	EXPECT_FALSE(cache.get(0, &v)) << "ShardedLRUCache::get() returns false for missing key";
+	EXPECT_EQ(v, -1) << "ShardedLRUCache::get() doesn't modify output for missing key";
+	
+	for(int i = 0; i < 16; ++i)
+	{
+		cache.set(i * 4096, i);
+	}
+	
+	EXPECT_EQ(cache.size(), 16U);
+	
+	for(int i = 0; i < 16; ++i)
+	{
+		EXPECT_TRUE(cache.get(i * 4096, &v));
+		EXPECT_EQ(v, i) << "ShardedLRUCache::get() copies stored value";
+	}
+	
+	cache.erase(0);
+	EXPECT_FALSE(cache.get(0, &v)) << "ShardedLRUCache::erase() removes element";
+	
+	cache.erase(4 * 4096, 8 * 4096);
+	
+	for(int i = 1; i < 16; ++i)
+	{
+		EXPECT_EQ(cache.get(i * 4096, &v), (i < 4 || i >= 8)) << "ShardedLRUCache::erase() removes elements in range from every shard";
+	}
+	
+	cache.clear();
+	EXPECT_EQ(cache.size(), 0U) << "ShardedLRUCache::clear() removes all elements";
+}
+
+TEST(ShardedLRUCache, MaxItems)
+{
+	ShardedLRUCache<off_t, int> cache(32, 4);
+	
+	for(int i = 0; i < 1000; ++i)
+	{
+		cache.set(i * 4096, i);
+	}
+	
+	EXPECT_LE(cache.size(), 32U) << "ShardedLRUCache doesn't exceed max_items";
+	
+	int v;
+	EXPECT_TRUE(cache.get(999 * 4096, &v)) << "ShardedLRUCache retains most recent element";
+}
+
+TEST(ShardedLRUCache, ConcurrentAccess)
+{
+	ShardedLRUCache<off_t, off_t> cache(256);
+	
+	std::vector<std::thread> threads;
+	
+	for(int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&cache, t]()
+		{
+			uint64_t lcg = t + 1;
+			
+			for(int i = 0; i < 50000; ++i)
+			{
+				lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+				off_t k = (off_t)((lcg >> 33) % 1024) * 4096;
+				
+				off_t v;
+				if(cache.get(k, &v))
+				{
+					EXPECT_EQ(v, k * 2);
+				}
+				else{
+					cache.set(k, k * 2);
+				}
+				
+				if((i % 1000) == 0)
+				{
+					cache.erase(k, k + 16 * 4096);
+				}
+			}
+		});
+	}
+	
+	for(auto t = threads.begin(); t != threads.end(); ++t)
+	{
+		t->join();
+	}
+	
+	EXPECT_LE(cache.size(), 256U);
+}
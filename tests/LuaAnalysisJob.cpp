@@ -0,0 +1,202 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#include "testutil.hpp"
+
+#include "../src/document.hpp"
+#include "../src/Events.hpp"
+#include "../src/LuaAnalysisJob.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+class LuaAnalysisJobTest: public ::testing::Test
+{
+	protected:
+		SharedDocumentPointer doc;
+		TempFilename script_file;
+		
+		LuaAnalysisJobTest():
+			doc(SharedDocumentPointer::make())
+		{
+			std::vector<unsigned char> data(1024);
+			for(size_t i = 0; i < data.size(); ++i)
+			{
+				data[i] = i;
+			}
+			
+			doc->insert_data(0, data.data(), data.size());
+		}
+		
+		void write_script(const char *script)
+		{
+			write_file(script_file.tmpfile, script, strlen(script));
+		}
+		
+		bool wait_for_job(const LuaAnalysisJob &job)
+		{
+			return run_wx_until([&]() { return job.get_state() != LuaAnalysisJob::State::RUNNING; });
+		}
+};
+
+TEST_F(LuaAnalysisJobTest, Annotate)
+{
+	write_script(
+		"assert(job.length() == 1024)\n"
+		"\n"
+		"local data = job.read(2, 4)\n"
+		"assert(data == \"\\2\\3\\4\\5\")\n"
+		"\n"
+		"local values = job.read_numbers(16, \"u16be\", 2)\n"
+		"assert(#values == 2 and values[1] == 0x1011 and values[2] == 0x1213)\n"
+		"\n"
+		"job.set_comment(0, 16, \"header\")\n"
+		"job.set_data_type(16, 4, \"u32le\")\n"
+		"job.set_highlight(32, 8, 2)\n"
+		"job.progress(1, 1)\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::IDLE);
+	
+	ASSERT_TRUE(job.start());
+	EXPECT_FALSE(job.start()) << "LuaAnalysisJob::start() fails if the job has already been started";
+	
+	ASSERT_TRUE(wait_for_job(job));
+	
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::FINISHED);
+	EXPECT_EQ(job.get_error(), "");
+	EXPECT_EQ(job.get_progress(), 1.0);
+	
+	BitRangeTree<Document::Comment> expect_comments;
+	expect_comments.set(BitOffset(0, 0), BitOffset(16, 0), Document::Comment("header"));
+	
+	EXPECT_EQ(doc->get_comments(), expect_comments);
+	
+	auto type_at_16 = doc->get_data_types().get_range(BitOffset(16, 0));
+	ASSERT_NE(type_at_16, doc->get_data_types().end());
+	
+	EXPECT_EQ(type_at_16->first, BitRangeMap<Document::TypeInfo>::Range(BitOffset(16, 0), BitOffset(4, 0)));
+	EXPECT_EQ(type_at_16->second.name, "u32le");
+	
+	BitRangeMap<int> expect_highlights;
+	expect_highlights.set_range(BitOffset(32, 0), BitOffset(8, 0), 2);
+	
+	EXPECT_EQ(doc->get_highlights(), expect_highlights);
+}
+
+TEST_F(LuaAnalysisJobTest, ScriptError)
+{
+	write_script(
+		"job.set_comment(0, 16, \"header\")\n"
+		"error(\"something went wrong\")\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	ASSERT_TRUE(job.start());
+	ASSERT_TRUE(wait_for_job(job));
+	
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::FAILED);
+	EXPECT_NE(job.get_error().find("something went wrong"), std::string::npos);
+	
+	EXPECT_TRUE(doc->get_comments().empty()) << "Annotations not flushed before an error are discarded";
+}
+
+TEST_F(LuaAnalysisJobTest, Cancel)
+{
+	write_script(
+		"job.set_comment(0, 16, \"header\")\n"
+		"job.flush()\n"
+		"\n"
+		"while true do end\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	ASSERT_TRUE(job.start());
+	
+	/* Flushed annotations are applied while the job is still running. */
+	ASSERT_TRUE(run_wx_until([&]() { return !doc->get_comments().empty(); }));
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::RUNNING);
+	
+	job.cancel();
+	
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::CANCELLED);
+	EXPECT_EQ(doc->get_comments().size(), 1U) << "Annotations already applied are kept when a job is cancelled";
+}
+
+TEST_F(LuaAnalysisJobTest, CancelledWorkerFinishes)
+{
+	write_script(
+		"while true do end\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	
+	int stops = 0;
+	job.Bind(PROCESSING_STOP, [&](wxCommandEvent &event) { ++stops; });
+	
+	ASSERT_TRUE(job.start());
+	
+	job.cancel();
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::CANCELLED);
+	
+	/* The worker exits in the background and is reaped without changing the job's state. */
+	run_wx_for(500);
+	
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::CANCELLED);
+	EXPECT_EQ(job.get_error(), "Cancelled");
+	EXPECT_EQ(stops, 1);
+}
+
+TEST_F(LuaAnalysisJobTest, DataModifiedCancels)
+{
+	write_script(
+		"while true do end\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	ASSERT_TRUE(job.start());
+	
+	const unsigned char NEW_DATA[] = { 0xFF };
+	doc->overwrite_data(BitOffset(0, 0), NEW_DATA, sizeof(NEW_DATA));
+	
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::CANCELLED);
+	EXPECT_EQ(job.get_error(), "The document was modified");
+}
+
+TEST_F(LuaAnalysisJobTest, ProcessingEvents)
+{
+	write_script(
+		"job.progress(10, 20)\n");
+	
+	LuaAnalysisJob job(doc, script_file.tmpfile, "test analysis");
+	
+	int starts = 0, stops = 0;
+	job.Bind(PROCESSING_START, [&](wxCommandEvent &event) { ++starts; });
+	job.Bind(PROCESSING_STOP,  [&](wxCommandEvent &event) { ++stops; });
+	
+	EXPECT_EQ(job.get_progress(), -1.0);
+	
+	ASSERT_TRUE(job.start());
+	ASSERT_TRUE(run_wx_until([&]() { return stops > 0; }));
+	
+	EXPECT_EQ(starts, 1);
+	EXPECT_EQ(stops, 1);
+	EXPECT_EQ(job.get_state(), LuaAnalysisJob::State::FINISHED);
+}
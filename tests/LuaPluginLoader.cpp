@@ -183,6 +183,46 @@ TEST(LuaPluginLoader, ReadDataLimitLength)
 	}
 }
 
+TEST(LuaPluginLoader, DocumentReader)
+{
+	LuaPluginLoaderInitialiser lpl_init;
+	
+	App &app = wxGetApp();
+	app.console->clear();
+	
+	{
+		const char *SCRIPT =
+			"rehex.OnTabCreated(function(window, tab)\n"
+			"	local reader = rehex.DocumentReader(tab.doc, rehex.BitOffset(1, 0))\n"
+			"	\n"
+			"	local data = reader:read(3)\n"
+			"	print(string.format(\"%d %02x %02x\", data:len(), data:byte(1), data:byte(3)))\n"
+			"	\n"
+			"	local u16 = reader:read_numbers(\"u16be\", 2)\n"
+			"	print(string.format(\"%d %04x %04x\", #u16, u16[1], u16[2]))\n"
+			"	\n"
+			"	reader:seek(rehex.BitOffset(508, 0))\n"
+			"	local u32 = reader:read_numbers(\"u32le\", 10)\n"
+			"	print(string.format(\"%d %08x %s\", #u32, u32[1], tostring(reader:eof())))\n"
+			"end);\n";
+		
+		TempFilename script_file;
+		write_file(script_file.tmpfile, std::vector<unsigned char>((unsigned char*)(SCRIPT), (unsigned char*)(SCRIPT) + strlen(SCRIPT)));
+		
+		LuaPlugin p = LuaPluginLoader::load_plugin(script_file.tmpfile);
+		
+		MainWindow window(wxDefaultPosition, wxDefaultSize);
+		window.open_file(wxFileName("tests/bin-data.bin"));
+		
+		pump_events();
+		
+		EXPECT_EQ(app.console->get_messages_text(),
+			"3 01 03\n"
+			"2 0405 0607\n"
+			"1 fffefdfc true\n");
+	}
+}
+
 TEST(LuaPluginLoader, BitOffsetBindings)
 {
 	LuaPluginLoaderInitialiser lpl_init;
@@ -411,6 +451,100 @@ TEST(LuaPluginLoader, SetCommentBulkBitAligned)
 	EXPECT_EQ(app.console->get_messages_text(), "");
 }
 
+TEST(LuaPluginLoader, AnnotationSession)
+{
+	LuaPluginLoaderInitialiser lpl_init;
+	
+	App &app = wxGetApp();
+	app.console->clear();
+	
+	{
+		const char *SCRIPT =
+			"rehex.OnTabCreated(function(window, tab)\n"
+			"	local doc = tab.doc\n"
+			"	local session = rehex.AnnotationSession(doc, \"annotate\")\n"
+			"	\n"
+			"	session:set_comment(rehex.BitOffset(2, 0), rehex.BitOffset(8, 0), rehex.Comment.new(\"home\"))\n"
+			"	session:set_comment(rehex.BitOffset(0, 0), rehex.BitOffset(0, 0), rehex.Comment.new(\"fear\"))\n"
+			"	session:set_data_type(rehex.BitOffset(2, 0), rehex.BitOffset(4, 0), \"u32le\")\n"
+			"	\n"
+			"	assert(session:size() == 3)\n"
+			"	session:commit()\n"
+			"	assert(session:size() == 0)\n"
+			"end);\n";
+		
+		TempFilename script_file;
+		write_file(script_file.tmpfile, std::vector<unsigned char>((unsigned char*)(SCRIPT), (unsigned char*)(SCRIPT) + strlen(SCRIPT)));
+		
+		LuaPlugin p = LuaPluginLoader::load_plugin(script_file.tmpfile);
+		
+		MainWindow window(wxDefaultPosition, wxDefaultSize);
+		Tab *tab = window.open_file(wxFileName("tests/bin-data.bin"));
+		
+		pump_events();
+		
+		const BitRangeTree<Document::Comment> comments = tab->doc->get_comments();
+		
+		BitRangeTree<Document::Comment> expected_comments;
+		expected_comments.set(BitOffset(0, 0), BitOffset(0, 0), Document::Comment("fear"));
+		expected_comments.set(BitOffset(2, 0), BitOffset(8, 0), Document::Comment("home"));
+		
+		EXPECT_EQ(comments, expected_comments);
+		
+		auto type_at_2 = tab->doc->get_data_types().get_range(BitOffset(2, 0));
+		ASSERT_NE(type_at_2, tab->doc->get_data_types().end());
+		
+		EXPECT_EQ(type_at_2->first, BitRangeMap<Document::TypeInfo>::Range(BitOffset(2, 0), BitOffset(4, 0)));
+		EXPECT_EQ(type_at_2->second.name, "u32le");
+	}
+	
+	EXPECT_EQ(app.console->get_messages_text(), "");
+}
+
+TEST(LuaPluginLoader, AnalysisJob)
+{
+	LuaPluginLoaderInitialiser lpl_init;
+	
+	App &app = wxGetApp();
+	app.console->clear();
+	
+	{
+		const char *WORKER_SCRIPT =
+			"local magic = job.read(0, 2)\n"
+			"job.set_comment(0, 2, string.format(\"magic %02x%02x\", magic:byte(1, 2)))\n"
+			"job.set_data_type(2, 2, \"u16le\")\n";
+		
+		TempFilename worker_file;
+		write_file(worker_file.tmpfile, WORKER_SCRIPT, strlen(WORKER_SCRIPT));
+		
+		std::string script =
+			"analysis_jobs = {}\n"
+			"rehex.OnTabCreated(function(window, tab)\n"
+			"	local job = rehex.AnalysisJob(tab, [[" + std::string(worker_file.tmpfile) + "]], \"analyse\")\n"
+			"	assert(job:get_state() == \"idle\")\n"
+			"	assert(job:start())\n"
+			"	table.insert(analysis_jobs, job)\n"
+			"end);\n";
+		
+		TempFilename script_file;
+		write_file(script_file.tmpfile, script.data(), script.size());
+		
+		LuaPlugin p = LuaPluginLoader::load_plugin(script_file.tmpfile);
+		
+		MainWindow window(wxDefaultPosition, wxDefaultSize);
+		Tab *tab = window.open_file(wxFileName("tests/bin-data.bin"));
+		
+		ASSERT_TRUE(run_wx_until([&]() { return tab->doc->get_data_types().get_range(BitOffset(2, 0))->second.name == "u16le"; }));
+		
+		BitRangeTree<Document::Comment> expected_comments;
+		expected_comments.set(BitOffset(0, 0), BitOffset(2, 0), Document::Comment("magic 0001"));
+		
+		EXPECT_EQ(tab->doc->get_comments(), expected_comments);
+	}
+	
+	EXPECT_EQ(app.console->get_messages_text(), "");
+}
+
 TEST(LuaPluginLoader, SetDataType)
 {
 	LuaPluginLoaderInitialiser lpl_init;
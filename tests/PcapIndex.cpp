@@ -0,0 +1,541 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/PcapIndex.hpp"
+
+using namespace REHex;
+
+class PcapBuilder
+{
+	public:
+		std::vector<unsigned char> data;
+		bool big_endian;
+		
+		PcapBuilder(bool big_endian = false):
+			big_endian(big_endian) {}
+		
+		void u8(uint8_t value)
+		{
+			data.push_back(value);
+		}
+		
+		void u16(uint16_t value)
+		{
+			if(big_endian)
+			{
+				u8(value >> 8);
+				u8(value);
+			}
+			else{
+				u8(value);
+				u8(value >> 8);
+			}
+		}
+		
+		void u32(uint32_t value)
+		{
+			if(big_endian)
+			{
+				u16(value >> 16);
+				u16(value);
+			}
+			else{
+				u16(value);
+				u16(value >> 16);
+			}
+		}
+		
+		void bytes(const std::vector<unsigned char> &bytes)
+		{
+			data.insert(data.end(), bytes.begin(), bytes.end());
+		}
+		
+		void pad32()
+		{
+			while((data.size() % 4) != 0)
+			{
+				u8(0);
+			}
+		}
+		
+		/* Classic pcap file header. */
+		void pcap_header(uint32_t magic, uint32_t link_type)
+		{
+			u32(magic);
+			u16(2);
+			u16(4);
+			u32(0);
+			u32(0);
+			u32(65535);
+			u32(link_type);
+		}
+		
+		void pcap_record(uint32_t ts_sec, uint32_t ts_frac, const std::vector<unsigned char> &packet, uint32_t original_length = 0)
+		{
+			u32(ts_sec);
+			u32(ts_frac);
+			u32(packet.size());
+			u32(original_length != 0 ? original_length : packet.size());
+			bytes(packet);
+		}
+		
+		void pcapng_shb()
+		{
+			u32(0x0A0D0D0A);
+			u32(28);
+			u32(0x1A2B3C4D);
+			u16(1);
+			u16(0);
+			u32(0xFFFFFFFF);
+			u32(0xFFFFFFFF);
+			u32(28);
+		}
+		
+		/* Interface Description Block, with an if_tsresol option if tsresol is non-zero. */
+		void pcapng_idb(uint16_t link_type, uint8_t tsresol = 0)
+		{
+			uint32_t length = tsresol != 0 ? 32 : 20;
+			
+			u32(1);
+			u32(length);
+			u16(link_type);
+			u16(0);
+			u32(65535);
+			
+			if(tsresol != 0)
+			{
+				u16(9);
+				u16(1);
+				u8(tsresol);
+				pad32();
+				u32(0);
+			}
+			
+			u32(length);
+		}
+		
+		void pcapng_epb(uint32_t interface_id, uint64_t timestamp, const std::vector<unsigned char> &packet)
+		{
+			uint32_t length = 32 + ((packet.size() + 3) & ~3);
+			
+			u32(6);
+			u32(length);
+			u32(interface_id);
+			u32(timestamp >> 32);
+			u32(timestamp);
+			u32(packet.size());
+			u32(packet.size());
+			bytes(packet);
+			pad32();
+			u32(length);
+		}
+		
+		void pcapng_spb(const std::vector<unsigned char> &packet)
+		{
+			uint32_t length = 16 + ((packet.size() + 3) & ~3);
+			
+			u32(3);
+			u32(length);
+			u32(packet.size());
+			bytes(packet);
+			pad32();
+			u32(length);
+		}
+		
+		/* A block which doesn't contain a packet. */
+		void pcapng_other_block(uint32_t type)
+		{
+			u32(type);
+			u32(16);
+			u32(0);
+			u32(16);
+		}
+};
+
+static void build_index(PcapIndex *index, size_t max_packets = PcapIndex::PACKETS_PER_STEP)
+{
+	for(int i = 0; i < 1000 && !index->build_step(max_packets); ++i) {}
+}
+
+/* Ethernet frame containing an IPv4/UDP packet with a 4 byte payload. */
+static std::vector<unsigned char> udp_frame()
+{
+	return std::vector<unsigned char>({
+		/* Ethernet */
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+		0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB,
+		0x08, 0x00,
+		
+		/* IPv4 */
+		0x45, 0x00, 0x00, 0x20, 0x12, 0x34, 0x40, 0x00,
+		0x40, 0x11, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x01,
+		0x0A, 0x00, 0x00, 0x02,
+		
+		/* UDP */
+		0x04, 0x00, 0x00, 0x35, 0x00, 0x0C, 0x00, 0x00,
+		
+		/* Payload */
+		0xDE, 0xAD, 0xBE, 0xEF,
+	});
+}
+
+static bool has_field(const std::vector<PcapIndex::Field> &fields, off_t offset, off_t length, const std::string &text)
+{
+	for(auto f = fields.begin(); f != fields.end(); ++f)
+	{
+		if(f->offset == offset && f->length == length && f->text == text)
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+TEST(PcapIndex, ClassicLittleEndian)
+{
+	PcapBuilder b(false);
+	b.pcap_header(0xA1B2C3D4, PcapIndex::LINKTYPE_ETHERNET);
+	b.pcap_record(100, 500000, std::vector<unsigned char>(10, 0xAA));
+	b.pcap_record(101, 250, std::vector<unsigned char>(20, 0xBB), 1500);
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_TRUE(index.finished());
+	EXPECT_EQ(index.get_format(), PcapIndex::Format::PCAP);
+	EXPECT_EQ(index.get_error(), "");
+	
+	ASSERT_EQ(index.size(), 2U);
+	
+	PcapIndex::Packet p0 = index.get_packet(0);
+	EXPECT_EQ(p0.offset, 24);
+	EXPECT_EQ(p0.length, 26U);
+	EXPECT_EQ(p0.data_begin(), 40);
+	EXPECT_EQ(p0.captured_length, 10U);
+	EXPECT_EQ(p0.original_length, 10U);
+	EXPECT_EQ(p0.link_type, PcapIndex::LINKTYPE_ETHERNET);
+	EXPECT_EQ(p0.timestamp_ns, 100500000000LL);
+	
+	PcapIndex::Packet p1 = index.get_packet(1);
+	EXPECT_EQ(p1.offset, 50);
+	EXPECT_EQ(p1.length, 36U);
+	EXPECT_EQ(p1.captured_length, 20U);
+	EXPECT_EQ(p1.original_length, 1500U);
+	EXPECT_EQ(p1.timestamp_ns, 101000250000LL);
+}
+
+TEST(PcapIndex, ClassicBigEndianNanosecond)
+{
+	PcapBuilder b(true);
+	b.pcap_header(0xA1B23C4D, PcapIndex::LINKTYPE_RAW);
+	b.pcap_record(1, 123456789, std::vector<unsigned char>(4, 0x00));
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_EQ(index.get_format(), PcapIndex::Format::PCAP);
+	EXPECT_EQ(index.get_error(), "");
+	
+	ASSERT_EQ(index.size(), 1U);
+	
+	PcapIndex::Packet p0 = index.get_packet(0);
+	EXPECT_EQ(p0.link_type, PcapIndex::LINKTYPE_RAW);
+	EXPECT_EQ(p0.captured_length, 4U);
+	EXPECT_EQ(p0.timestamp_ns, 1123456789LL);
+	EXPECT_NE((p0.flags & PcapIndex::PF_BIG_ENDIAN), 0);
+}
+
+TEST(PcapIndex, BuildInSteps)
+{
+	PcapBuilder b(false);
+	b.pcap_header(0xA1B2C3D4, PcapIndex::LINKTYPE_ETHERNET);
+	
+	for(int i = 0; i < 100; ++i)
+	{
+		b.pcap_record(i, 0, std::vector<unsigned char>(i, i));
+	}
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	
+	EXPECT_FALSE(index.build_step(30));
+	EXPECT_EQ(index.size(), 30U);
+	EXPECT_FALSE(index.finished());
+	
+	build_index(&index, 30);
+	
+	EXPECT_TRUE(index.finished());
+	ASSERT_EQ(index.size(), 100U);
+	
+	for(size_t i = 0; i < 100; ++i)
+	{
+		EXPECT_EQ(index.get_packet(i).captured_length, i);
+		EXPECT_EQ(index.get_packet(i).timestamp_ns, (int64_t)(i) * 1000000000LL);
+	}
+}
+
+TEST(PcapIndex, TruncatedRecord)
+{
+	PcapBuilder b(false);
+	b.pcap_header(0xA1B2C3D4, PcapIndex::LINKTYPE_ETHERNET);
+	b.pcap_record(1, 0, std::vector<unsigned char>(10, 0));
+	b.pcap_record(2, 0, std::vector<unsigned char>(10, 0));
+	
+	b.data.resize(b.data.size() - 1);
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_TRUE(index.finished());
+	EXPECT_EQ(index.size(), 1U) << "Packets before a truncated record are kept";
+	EXPECT_EQ(index.get_error(), "Truncated packet record at offset 0x00000032");
+}
+
+TEST(PcapIndex, NotACapture)
+{
+	const char *DATA = "Hello, world!";
+	
+	Document doc;
+	doc.insert_data(0, (const unsigned char*)(DATA), strlen(DATA));
+	
+	PcapIndex index(&doc);
+	EXPECT_TRUE(index.build_step());
+	
+	EXPECT_TRUE(index.finished());
+	EXPECT_EQ(index.get_format(), PcapIndex::Format::UNKNOWN);
+	EXPECT_EQ(index.get_error(), "Not a pcap or pcapng file");
+	EXPECT_EQ(index.size(), 0U);
+}
+
+TEST(PcapIndex, Pcapng)
+{
+	PcapBuilder b(false);
+	b.pcapng_shb();
+	b.pcapng_idb(PcapIndex::LINKTYPE_ETHERNET);
+	b.pcapng_idb(PcapIndex::LINKTYPE_RAW, 9);
+	b.pcapng_epb(0, 1500000ULL, std::vector<unsigned char>(5, 0));
+	b.pcapng_other_block(5);
+	b.pcapng_epb(1, 2000000001ULL, std::vector<unsigned char>(8, 0));
+	b.pcapng_spb(std::vector<unsigned char>(3, 0));
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_TRUE(index.finished());
+	EXPECT_EQ(index.get_format(), PcapIndex::Format::PCAPNG);
+	EXPECT_EQ(index.get_error(), "");
+	
+	ASSERT_EQ(index.size(), 3U);
+	
+	PcapIndex::Packet p0 = index.get_packet(0);
+	EXPECT_EQ(p0.offset, 80);
+	EXPECT_EQ(p0.length, 40U);
+	EXPECT_EQ(p0.data_begin(), 108);
+	EXPECT_EQ(p0.captured_length, 5U);
+	EXPECT_EQ(p0.link_type, PcapIndex::LINKTYPE_ETHERNET);
+	EXPECT_EQ(p0.timestamp_ns, 1500000000LL) << "Interface timestamps default to microseconds";
+	
+	PcapIndex::Packet p1 = index.get_packet(1);
+	EXPECT_EQ(p1.offset, 136);
+	EXPECT_EQ(p1.captured_length, 8U);
+	EXPECT_EQ(p1.link_type, PcapIndex::LINKTYPE_RAW);
+	EXPECT_EQ(p1.timestamp_ns, 2000000001LL) << "if_tsresol option is applied to timestamps";
+	
+	PcapIndex::Packet p2 = index.get_packet(2);
+	EXPECT_EQ(p2.offset, 176);
+	EXPECT_EQ(p2.length, 20U);
+	EXPECT_EQ(p2.data_begin(), 188);
+	EXPECT_EQ(p2.captured_length, 3U);
+	EXPECT_EQ(p2.link_type, PcapIndex::LINKTYPE_ETHERNET);
+	EXPECT_EQ(p2.timestamp_ns, PcapIndex::NO_TIMESTAMP);
+}
+
+TEST(PcapIndex, PcapngBigEndian)
+{
+	PcapBuilder b(true);
+	b.pcapng_shb();
+	b.pcapng_idb(PcapIndex::LINKTYPE_ETHERNET, 0x80 | 10);
+	b.pcapng_epb(0, 3072ULL, std::vector<unsigned char>(4, 0));
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_EQ(index.get_error(), "");
+	ASSERT_EQ(index.size(), 1U);
+	
+	EXPECT_EQ(index.get_packet(0).captured_length, 4U);
+	EXPECT_EQ(index.get_packet(0).timestamp_ns, 3000000000LL) << "Binary if_tsresol option is applied to timestamps";
+}
+
+TEST(PcapIndex, PcapngUndefinedInterface)
+{
+	PcapBuilder b(false);
+	b.pcapng_shb();
+	b.pcapng_idb(PcapIndex::LINKTYPE_ETHERNET);
+	b.pcapng_epb(0, 0, std::vector<unsigned char>(4, 0));
+	b.pcapng_epb(1, 0, std::vector<unsigned char>(4, 0));
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	EXPECT_TRUE(index.finished());
+	EXPECT_EQ(index.size(), 1U);
+	EXPECT_EQ(index.get_error(), "Packet block references an undefined interface at offset 0x00000054");
+}
+
+TEST(PcapIndex, FindPacket)
+{
+	PcapBuilder b(false);
+	b.pcap_header(0xA1B2C3D4, PcapIndex::LINKTYPE_ETHERNET);
+	b.pcap_record(0, 0, std::vector<unsigned char>(10, 0));  /* 24 - 49 */
+	b.pcap_record(0, 0, std::vector<unsigned char>(10, 0));  /* 50 - 75 */
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	size_t packet_idx = 99;
+	
+	EXPECT_FALSE(index.find_packet(0, &packet_idx));
+	EXPECT_FALSE(index.find_packet(23, &packet_idx));
+	
+	EXPECT_TRUE(index.find_packet(24, &packet_idx));
+	EXPECT_EQ(packet_idx, 0U);
+	
+	EXPECT_TRUE(index.find_packet(49, &packet_idx));
+	EXPECT_EQ(packet_idx, 0U);
+	
+	EXPECT_TRUE(index.find_packet(50, &packet_idx));
+	EXPECT_EQ(packet_idx, 1U);
+	
+	EXPECT_TRUE(index.find_packet(75, &packet_idx));
+	EXPECT_EQ(packet_idx, 1U);
+	
+	EXPECT_FALSE(index.find_packet(76, &packet_idx));
+}
+
+TEST(PcapIndex, DissectClassicUDP)
+{
+	PcapBuilder b(false);
+	b.pcap_header(0xA1B2C3D4, PcapIndex::LINKTYPE_ETHERNET);
+	b.pcap_record(0, 0, udp_frame());
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	ASSERT_EQ(index.size(), 1U);
+	
+	std::vector<PcapIndex::Field> fields = index.dissect(0);
+	
+	ASSERT_FALSE(fields.empty());
+	EXPECT_EQ(fields[0].offset, 24);
+	EXPECT_EQ(fields[0].length, 62);
+	EXPECT_EQ(fields[0].text, "Packet #1");
+	
+	EXPECT_TRUE(has_field(fields, 24, 4, "Timestamp (seconds)"));
+	EXPECT_TRUE(has_field(fields, 28, 4, "Timestamp (microseconds)"));
+	EXPECT_TRUE(has_field(fields, 32, 4, "Captured length"));
+	EXPECT_TRUE(has_field(fields, 40, 46, "Packet data"));
+	
+	EXPECT_TRUE(has_field(fields, 40, 14, "Ethernet header"));
+	EXPECT_TRUE(has_field(fields, 52, 2, "EtherType"));
+	
+	EXPECT_TRUE(has_field(fields, 54, 20, "IPv4 header"));
+	EXPECT_TRUE(has_field(fields, 63, 1, "IPv4 protocol"));
+	EXPECT_TRUE(has_field(fields, 66, 4, "IPv4 source address"));
+	
+	EXPECT_TRUE(has_field(fields, 74, 8, "UDP header"));
+	EXPECT_TRUE(has_field(fields, 76, 2, "UDP destination port"));
+	EXPECT_TRUE(has_field(fields, 82, 4, "UDP payload"));
+}
+
+TEST(PcapIndex, DissectPcapngBlock)
+{
+	PcapBuilder b(false);
+	b.pcapng_shb();
+	b.pcapng_idb(PcapIndex::LINKTYPE_ETHERNET);
+	b.pcapng_epb(0, 0, std::vector<unsigned char>(5, 0));
+	
+	Document doc;
+	doc.insert_data(0, b.data.data(), b.data.size());
+	
+	PcapIndex index(&doc);
+	build_index(&index);
+	
+	ASSERT_EQ(index.size(), 1U);
+	
+	std::vector<PcapIndex::Field> fields = index.dissect(0);
+	
+	EXPECT_TRUE(has_field(fields, 48, 40, "Packet #1"));
+	EXPECT_TRUE(has_field(fields, 48, 4, "Block type"));
+	EXPECT_TRUE(has_field(fields, 56, 4, "Interface ID"));
+	EXPECT_TRUE(has_field(fields, 68, 4, "Captured length"));
+	EXPECT_TRUE(has_field(fields, 76, 5, "Packet data"));
+	EXPECT_TRUE(has_field(fields, 84, 4, "Block total length"));
+	
+	EXPECT_FALSE(has_field(fields, 76, 5, "Ethernet header")) << "Packets too short for a header aren't dissected";
+}
+
+TEST(PcapIndex, FormatTimestamp)
+{
+	EXPECT_EQ(PcapIndex::format_timestamp(0), "1970-01-01 00:00:00.000000000");
+	EXPECT_EQ(PcapIndex::format_timestamp(951782400123456789LL), "2000-02-29 00:00:00.123456789");
+	EXPECT_EQ(PcapIndex::format_timestamp(1700000000000000001LL), "2023-11-14 22:13:20.000000001");
+	EXPECT_EQ(PcapIndex::format_timestamp(-1), "1969-12-31 23:59:59.999999999");
+	EXPECT_EQ(PcapIndex::format_timestamp(PcapIndex::NO_TIMESTAMP), "");
+}
+
+TEST(PcapIndex, LinkTypeName)
+{
+	EXPECT_EQ(PcapIndex::link_type_name(PcapIndex::LINKTYPE_ETHERNET), "Ethernet");
+	EXPECT_EQ(PcapIndex::link_type_name(12345), "Link type 12345");
+}
@@ -22,6 +22,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -317,6 +318,184 @@ TEST(RangeProcessorTest, QueueRangeWhileBeingProcessed)
 	EXPECT_EQ(got_calls, EXPECT_CALLS);
 }
 
+TEST(RangeProcessorTest, StressSmallWindows)
+{
+	const off_t RANGE_SIZE = 1024 * 256;
+	
+	std::unique_ptr< std::atomic<unsigned int>[] > calls_per_byte(new std::atomic<unsigned int>[RANGE_SIZE]);
+	std::unique_ptr< std::atomic<bool>[] > byte_busy(new std::atomic<bool>[RANGE_SIZE]);
+	
+	for(off_t i = 0; i < RANGE_SIZE; ++i)
+	{
+		calls_per_byte[i] = 0;
+		byte_busy[i] = false;
+	}
+	
+	std::atomic<unsigned int> overlapping_calls(0);
+	
+	auto func = [&](off_t window_base, off_t window_size)
+	{
+		for(off_t i = window_base; i < (window_base + window_size); ++i)
+		{
+			if(byte_busy[i].exchange(true))
+			{
+				++overlapping_calls;
+			}
+			
+			++(calls_per_byte[i]);
+		}
+		
+		for(off_t i = window_base; i < (window_base + window_size); ++i)
+		{
+			byte_busy[i] = false;
+		}
+	};
+	
+	RangeProcessor rp(func, 16 /* 16 byte window */);
+	rp.set_max_threads(8);
+	
+	/* Queue the range in a few overlapping pieces, some of which will be queued while
+	 * the first ones are already being processed.
+	*/
+	
+	rp.queue_range(0, RANGE_SIZE);
+	rp.queue_range(RANGE_SIZE / 4, RANGE_SIZE / 2);
+	rp.queue_range(0, RANGE_SIZE / 2);
+	
+	rp.wait_for_completion();
+	
+	EXPECT_TRUE(rp.queue_empty());
+	EXPECT_EQ(overlapping_calls.load(), 0U) << "No byte was processed by more than one worker at a time";
+	
+	/* Each byte may be processed once for each queue_range() call covering it, but
+	 * only if it had already been claimed by a worker when the range was queued again.
+	*/
+	
+	off_t unprocessed_bytes = 0;
+	off_t overprocessed_bytes = 0;
+	
+	for(off_t i = 0; i < RANGE_SIZE; ++i)
+	{
+		unsigned int max_calls = 1
+			+ (i >= (RANGE_SIZE / 4) && i < ((RANGE_SIZE / 4) * 3))
+			+ (i < (RANGE_SIZE / 2));
+		
+		if(calls_per_byte[i] == 0)
+		{
+			++unprocessed_bytes;
+		}
+		else if(calls_per_byte[i] > max_calls)
+		{
+			++overprocessed_bytes;
+		}
+	}
+	
+	EXPECT_EQ(unprocessed_bytes, 0) << "Every byte was processed at least once";
+	EXPECT_EQ(overprocessed_bytes, 0) << "No byte was processed more times than it was queued";
+	
+	/* Queueing the same overlapping ranges while paused should process each byte once. */
+	
+	for(off_t i = 0; i < RANGE_SIZE; ++i)
+	{
+		calls_per_byte[i] = 0;
+	}
+	
+	rp.pause_threads();
+	
+	rp.queue_range(0, RANGE_SIZE);
+	rp.queue_range(RANGE_SIZE / 4, RANGE_SIZE / 2);
+	rp.queue_range(0, RANGE_SIZE / 2);
+	
+	rp.resume_threads();
+	rp.wait_for_completion();
+	
+	off_t wrong_count_bytes = 0;
+	
+	for(off_t i = 0; i < RANGE_SIZE; ++i)
+	{
+		if(calls_per_byte[i] != 1)
+		{
+			++wrong_count_bytes;
+		}
+	}
+	
+	EXPECT_EQ(wrong_count_bytes, 0) << "Every byte was processed exactly once";
+}
+
+TEST(RangeProcessorTest, UnqueueRangeWhileBeingProcessed)
+{
+	std::mutex lock;
+	std::vector< std::pair<off_t, off_t> > got_calls;
+	std::condition_variable cv;
+	bool hit = false, resume = false;
+	
+	auto func = [&](off_t window_base, off_t window_size)
+	{
+		std::unique_lock<std::mutex> l(lock);
+		
+		got_calls.push_back( std::make_pair(window_base, window_size) );
+		
+		if(window_base == 0 && window_size == 1024)
+		{
+			hit = true;
+			cv.notify_all();
+			
+			cv.wait(l, [&]() { return resume; });
+		}
+	};
+	
+	RangeProcessor rp(func, 1024 /* 1KiB window */);
+	rp.set_max_threads(1);
+	
+	rp.queue_range(0, 1024 * 10);
+	
+	/* Wait for our work function to be called with the window 0,1024... */
+	std::unique_lock<std::mutex> l(lock);
+	cv.wait(l, [&]() { return hit; });
+	
+	/* Remove a range which partially covers some of the remaining windows. */
+	rp.unqueue_range(2560, 3072);
+	
+	{
+		ByteRangeSet queue = rp.get_queue();
+		
+		std::vector< std::pair<off_t, off_t> > got_queue;
+		for(auto i = queue.begin(); i != queue.end(); ++i)
+		{
+			got_queue.push_back( std::make_pair(i->offset, i->length) );
+		}
+		
+		const std::vector< std::pair<off_t, off_t> > EXPECT_QUEUE = {
+			std::make_pair(0, 2560),
+			std::make_pair(5632, 4608),
+		};
+		
+		EXPECT_EQ(got_queue, EXPECT_QUEUE);
+	}
+	
+	/* Unblock the worker and let it finish the queue. */
+	resume = true;
+	l.unlock();
+	cv.notify_all();
+	
+	rp.wait_for_completion();
+	
+	std::sort(got_calls.begin(), got_calls.end());
+	
+	const std::vector< std::pair<off_t, off_t> > EXPECT_CALLS = {
+		std::make_pair(1024 * 0, 1024),
+		std::make_pair(1024 * 1, 1024),
+		std::make_pair(1024 * 2, 512),
+		std::make_pair(5632, 512),
+		std::make_pair(1024 * 6, 1024),
+		std::make_pair(1024 * 7, 1024),
+		std::make_pair(1024 * 8, 1024),
+		std::make_pair(1024 * 9, 1024),
+	};
+	
+	EXPECT_EQ(got_calls, EXPECT_CALLS);
+}
+
 TEST(RangeProcessorTest, DestructorDiscardsQueue)
 {
 	std::mutex lock;
@@ -350,6 +529,153 @@ TEST(RangeProcessorTest, DestructorDiscardsQueue)
 	EXPECT_EQ(got_calls, EXPECT_CALLS);
 }
 
+TEST(RangeProcessorTest, PauseCancelsWorkFunction)
+{
+	std::mutex lock;
+	std::vector< std::pair<off_t, off_t> > got_calls;
+	bool cancelled = false;
+	
+	RangeProcessor *rp_ptr = NULL;
+	
+	auto func = [&](off_t window_base, off_t window_size)
+	{
+		bool first_call;
+		
+		{
+			std::unique_lock<std::mutex> l(lock);
+			
+			first_call = got_calls.empty();
+			got_calls.push_back( std::make_pair(window_base, window_size) );
+		}
+		
+		if(first_call)
+		{
+			/* Simulate a long-running block which polls for cancellation. */
+			
+			for(int i = 0; i < 1000 && !rp_ptr->cancel_requested(); ++i)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			
+			std::unique_lock<std::mutex> l(lock);
+			cancelled = rp_ptr->cancel_requested();
+			
+			/* Pretend we got through the first half of the block. */
+			rp_ptr->report_progress(window_base + (window_size / 2));
+		}
+	};
+	
+	RangeProcessor rp(func, 1024 /* 1KiB window */);
+	rp_ptr = &rp;
+	
+	rp.set_max_threads(1);
+	
+	rp.queue_range(0, 1024 * 4);
+	
+	/* Should be enough time for worker thread to enter func() */
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	
+	auto pause_begin = std::chrono::steady_clock::now();
+	rp.pause_threads();
+	auto pause_end = std::chrono::steady_clock::now();
+	
+	EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(pause_end - pause_begin).count(), 1000)
+		<< "RangeProcessor::pause_threads() didn't wait for the whole block";
+	
+	EXPECT_TRUE(cancelled) << "Work function saw cancellation request";
+	EXPECT_FALSE(rp.cancel_requested()) << "Cancellation request cleared once paused";
+	
+	{
+		/* The unprocessed half of the cancelled block should have been returned to the queue. */
+		
+		ByteRangeSet queue = rp.get_queue();
+		
+		std::vector< std::pair<off_t, off_t> > got_queue;
+		for(auto i = queue.begin(); i != queue.end(); ++i)
+		{
+			got_queue.push_back( std::make_pair(i->offset, i->length) );
+		}
+		
+		const std::vector< std::pair<off_t, off_t> > EXPECT_QUEUE = {
+			std::make_pair(512, (1024 * 4) - 512),
+		};
+		
+		EXPECT_EQ(got_queue, EXPECT_QUEUE);
+	}
+	
+	rp.resume_threads();
+	rp.wait_for_completion();
+	
+	std::sort(got_calls.begin(), got_calls.end());
+	
+	const std::vector< std::pair<off_t, off_t> > EXPECT_CALLS = {
+		std::make_pair(0, 1024),
+		std::make_pair(512, 512), /* Remainder of cancelled window processed */
+		std::make_pair(1024 * 1, 1024),
+		std::make_pair(1024 * 2, 1024),
+		std::make_pair(1024 * 3, 1024),
+	};
+	
+	EXPECT_EQ(got_calls, EXPECT_CALLS);
+}
+
+TEST(RangeProcessorTest, PauseDoesntRequeueFinishedWork)
+{
+	std::mutex lock;
+	std::vector< std::pair<off_t, off_t> > got_calls;
+	
+	auto func = [&](off_t window_base, off_t window_size)
+	{
+		{
+			std::unique_lock<std::mutex> l(lock);
+			got_calls.push_back( std::make_pair(window_base, window_size) );
+		}
+		
+		/* Doesn't poll for cancellation, so always processes the whole block. */
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	};
+	
+	RangeProcessor rp(func, 1024 /* 1KiB window */);
+	rp.set_max_threads(1);
+	
+	rp.queue_range(0, 1024 * 4);
+	
+	/* Should be enough time for worker thread to enter func() */
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	
+	rp.pause_threads();
+	
+	{
+		ByteRangeSet queue = rp.get_queue();
+		
+		std::vector< std::pair<off_t, off_t> > got_queue;
+		for(auto i = queue.begin(); i != queue.end(); ++i)
+		{
+			got_queue.push_back( std::make_pair(i->offset, i->length) );
+		}
+		
+		const std::vector< std::pair<off_t, off_t> > EXPECT_QUEUE = {
+			std::make_pair(1024, 1024 * 3),
+		};
+		
+		EXPECT_EQ(got_queue, EXPECT_QUEUE) << "Block finished during pause isn't returned to the queue";
+	}
+	
+	rp.resume_threads();
+	rp.wait_for_completion();
+	
+	std::sort(got_calls.begin(), got_calls.end());
+	
+	const std::vector< std::pair<off_t, off_t> > EXPECT_CALLS = {
+		std::make_pair(1024 * 0, 1024),
+		std::make_pair(1024 * 1, 1024),
+		std::make_pair(1024 * 2, 1024),
+		std::make_pair(1024 * 3, 1024),
+	};
+	
+	EXPECT_EQ(got_calls, EXPECT_CALLS);
+}
+
 TEST(RangeProcessorTest, GetQueue)
 {
 	std::mutex lock;
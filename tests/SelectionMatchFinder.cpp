@@ -0,0 +1,211 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/SelectionMatchFinder.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+class SelectionMatchFinderTest: public ::testing::Test
+{
+	protected:
+		SharedDocumentPointer doc;
+		
+		SelectionMatchFinderTest():
+			doc(SharedDocumentPointer::make()) {}
+		
+		static std::vector<ByteRangeSet::Range> get_matches(const SelectionMatchFinder &finder, off_t offset, off_t length)
+		{
+			ByteRangeSet matches = finder.get_matches_in(offset, length);
+			return std::vector<ByteRangeSet::Range>(matches.begin(), matches.end());
+		}
+};
+
+TEST_F(SelectionMatchFinderTest, EmptyFile)
+{
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B' });
+	finder.wait_for_completion();
+	
+	EXPECT_FALSE(finder.processing());
+	EXPECT_TRUE(finder.complete_in(0, 0));
+	EXPECT_EQ(get_matches(finder, 0, 1024), std::vector<ByteRangeSet::Range>());
+}
+
+TEST_F(SelectionMatchFinderTest, FindMatches)
+{
+	std::vector<unsigned char> data(8 * 1024 * 1024, 0x00);
+	
+	/* Matches at the start, at the end, across a window boundary and some overlapping. */
+	data[0] = 'A'; data[1] = 'B'; data[2] = 'C';
+	data[1000] = 'A'; data[1001] = 'B'; data[1002] = 'C';
+	data[(2 * 1024 * 1024) - 1] = 'A'; data[2 * 1024 * 1024] = 'B'; data[(2 * 1024 * 1024) + 1] = 'C';
+	data[data.size() - 3] = 'A'; data[data.size() - 2] = 'B'; data[data.size() - 1] = 'C';
+	
+	doc->insert_data(0, data.data(), data.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B', 'C' });
+	finder.wait_for_completion();
+	
+	EXPECT_FALSE(finder.processing());
+	EXPECT_FALSE(finder.is_truncated());
+	EXPECT_TRUE(finder.complete_in(0, data.size()));
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(0, 3),
+		ByteRangeSet::Range(1000, 3),
+		ByteRangeSet::Range(((2 * 1024 * 1024) - 1), 3),
+		ByteRangeSet::Range((data.size() - 3), 3),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, data.size()), EXPECT_MATCHES);
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_PARTIAL_MATCHES = {
+		ByteRangeSet::Range(1000, 3),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 1002, 100), EXPECT_PARTIAL_MATCHES) << "Matches overlapping the start of the range are returned";
+	
+	EXPECT_TRUE(finder.match_in(1002, 1));
+	EXPECT_FALSE(finder.match_in(1003, 996));
+}
+
+TEST_F(SelectionMatchFinderTest, OverlappingMatches)
+{
+	const std::vector<unsigned char> DATA = { 'X', 'A', 'A', 'A', 'A', 'X', 'A', 'A', 'X' };
+	doc->insert_data(0, DATA.data(), DATA.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'A' });
+	finder.wait_for_completion();
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(1, 4),
+		ByteRangeSet::Range(6, 2),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, DATA.size()), EXPECT_MATCHES);
+}
+
+TEST_F(SelectionMatchFinderTest, SameNeedleKeepsResults)
+{
+	const std::vector<unsigned char> DATA = { 'A', 'B', 'X', 'A', 'B' };
+	doc->insert_data(0, DATA.data(), DATA.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B' });
+	finder.wait_for_completion();
+	
+	unsigned int generation = finder.get_generation();
+	
+	finder.set_needle({ 'A', 'B' });
+	
+	EXPECT_FALSE(finder.processing());
+	EXPECT_EQ(finder.get_generation(), generation) << "Setting the same needle doesn't restart search";
+	
+	finder.set_needle({ 'X' });
+	finder.wait_for_completion();
+	
+	EXPECT_NE(finder.get_generation(), generation);
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(2, 1),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, DATA.size()), EXPECT_MATCHES);
+	
+	finder.set_needle({});
+	
+	EXPECT_FALSE(finder.processing());
+	EXPECT_EQ(get_matches(finder, 0, DATA.size()), std::vector<ByteRangeSet::Range>());
+}
+
+TEST_F(SelectionMatchFinderTest, DataOverwritten)
+{
+	const std::vector<unsigned char> DATA = { 'A', 'B', 'C', 'X', 'X', 'X', 'A', 'B', 'C', 'X' };
+	doc->insert_data(0, DATA.data(), DATA.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B', 'C' });
+	finder.wait_for_completion();
+	
+	/* Break the first match and make a new one. */
+	doc->overwrite_data(BitOffset(1, 0), "X", 1);
+	doc->overwrite_data(BitOffset(3, 0), "ABC", 3);
+	finder.wait_for_completion();
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(3, 6),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, DATA.size()), EXPECT_MATCHES);
+}
+
+TEST_F(SelectionMatchFinderTest, DataInserted)
+{
+	const std::vector<unsigned char> DATA = { 'A', 'B', 'C', 'X', 'A', 'B', 'X', 'A', 'B', 'C' };
+	doc->insert_data(0, DATA.data(), DATA.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B', 'C' });
+	finder.wait_for_completion();
+	
+	/* Split the first match, complete the second and move the third. */
+	doc->insert_data(6, "C", 1);
+	doc->insert_data(1, "X", 1);
+	finder.wait_for_completion();
+	
+	/* A X B C X A B C X A B C */
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(5, 3),
+		ByteRangeSet::Range(9, 3),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, 12), EXPECT_MATCHES);
+}
+
+TEST_F(SelectionMatchFinderTest, DataErased)
+{
+	const std::vector<unsigned char> DATA = { 'A', 'B', 'C', 'X', 'A', 'B', 'X', 'C', 'X', 'A', 'B', 'C' };
+	doc->insert_data(0, DATA.data(), DATA.size());
+	
+	SelectionMatchFinder finder(doc);
+	finder.set_needle({ 'A', 'B', 'C' });
+	finder.wait_for_completion();
+	
+	/* Complete the second match and break the first. */
+	doc->erase_data(6, 1);
+	doc->erase_data(1, 1);
+	finder.wait_for_completion();
+	
+	/* A C X A B C X A B C */
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_MATCHES = {
+		ByteRangeSet::Range(3, 3),
+		ByteRangeSet::Range(7, 3),
+	};
+	
+	EXPECT_EQ(get_matches(finder, 0, 10), EXPECT_MATCHES);
+}
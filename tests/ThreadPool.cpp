@@ -854,3 +854,74 @@ TEST(ThreadPool, ChangeTaskConcurrency)
 	finished = true;
 	task.join();
 }
+
+TEST(ThreadPool, ChangeTaskPriority)
+{
+	ThreadPool pool(8);
+	
+	std::mutex mutex;
+	unsigned int t1_times_called = 0, t2_times_called = 0;
+	bool t1_finished = false, t2_finished = false;
+	
+	ThreadPool::TaskHandle task1 = pool.queue_task([&]()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++t1_times_called;
+		lock.unlock();
+		
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		
+		lock.lock();
+		return t1_finished;
+	}, -1, ThreadPool::TaskPriority::HIGH);
+	
+	ThreadPool::TaskHandle task2 = pool.queue_task([&]()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++t2_times_called;
+		lock.unlock();
+		
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		
+		lock.lock();
+		return t2_finished;
+	}, -1, ThreadPool::TaskPriority::NORMAL);
+	
+	/* Give the workers time to start servicing task 1. */
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	
+	mutex.lock();
+	
+	EXPECT_GT(t1_times_called, 0U) << "High priority function was called";
+	EXPECT_EQ(t2_times_called, 0U) << "Normal priority function wasn't called while high priority task was active";
+	
+	mutex.unlock();
+	
+	task1.change_priority(ThreadPool::TaskPriority::LOW);
+	EXPECT_EQ(task1.get_priority(), ThreadPool::TaskPriority::LOW);
+	
+	/* Wait for the workers to settle... */
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	
+	mutex.lock();
+	
+	unsigned int t1_base_times_called = t1_times_called;
+	unsigned int t2_base_times_called = t2_times_called;
+	
+	mutex.unlock();
+	
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	
+	mutex.lock();
+	
+	EXPECT_GT(t2_times_called, t2_base_times_called) << "Normal priority function was called once other task was demoted";
+	EXPECT_EQ(t1_times_called, t1_base_times_called) << "Demoted function wasn't called while normal priority task was active";
+	
+	mutex.unlock();
+	
+	t2_finished = true;
+	task2.join();
+	
+	t1_finished = true;
+	task1.join();
+}
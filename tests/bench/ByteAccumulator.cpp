@@ -0,0 +1,81 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <assert.h>
+#include <vector>
+
+#include "bench.hpp"
+#include "../../src/ByteAccumulator.hpp"
+
+using namespace REHex;
+
+/* Accumulate statistics over a buffer, as DataHistogramPanel does for each bucket. */
+static void BM_ByteAccumulator_AddByte(Bench::State &state)
+{
+	std::vector<unsigned char> data(state.arg());
+	
+	uint32_t lcg = 1;
+	for(size_t i = 0; i < data.size(); ++i)
+	{
+		lcg = (lcg * 1103515245) + 12345;
+		data[i] = lcg >> 24;
+	}
+	
+	while(state.keep_running())
+	{
+		ByteAccumulator accumulator;
+		
+		for(size_t i = 0; i < data.size(); ++i)
+		{
+			accumulator.add_byte(data[i]);
+		}
+		
+		Bench::do_not_optimise(accumulator);
+	}
+	
+	state.set_bytes_processed(state.iterations() * data.size());
+}
+
+REHEX_BENCHMARK(BM_ByteAccumulator_AddByte)->arg(4096)->arg(1024 * 1024);
+
+static void BM_ByteAccumulator_Merge(Bench::State &state)
+{
+	std::vector<ByteAccumulator> accumulators(state.arg());
+	
+	for(size_t i = 0; i < accumulators.size(); ++i)
+	{
+		accumulators[i].add_byte(i);
+	}
+	
+	while(state.keep_running())
+	{
+		ByteAccumulator total;
+		
+		for(auto i = accumulators.begin(); i != accumulators.end(); ++i)
+		{
+			total += *i;
+		}
+		
+		Bench::do_not_optimise(total);
+	}
+	
+	state.set_items_processed(state.iterations() * accumulators.size());
+}
+
+REHEX_BENCHMARK(BM_ByteAccumulator_Merge)->arg(256);
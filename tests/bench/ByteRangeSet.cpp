@@ -0,0 +1,151 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+
+#include "bench.hpp"
+#include "../../src/ByteRangeSet.hpp"
+
+using namespace REHex;
+
+/* Build a set of N two byte ranges, each four bytes apart. */
+template<typename S = ByteRangeSet> static S make_set(int64_t n)
+{
+	std::vector<typename S::Range> ranges;
+	ranges.reserve(n);
+	
+	for(int64_t i = 0; i < n; ++i)
+	{
+		ranges.emplace_back((i * 4), 2);
+	}
+	
+	S set;
+	set.set_ranges(ranges.begin(), ranges.end());
+	
+	return set;
+}
+
+/* Build a set of disjoint ranges in random order. */
+static void BM_ByteRangeSet_SetRandom(Bench::State &state)
+{
+	while(state.keep_running())
+	{
+		ByteRangeSet set;
+		uint64_t lcg = 1;
+		
+		for(int64_t i = 0; i < state.arg(); ++i)
+		{
+			lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+			off_t offset = ((lcg >> 16) % (state.arg() * 4)) * 4;
+			
+			set.set_range(offset, 2);
+		}
+		
+		Bench::do_not_optimise(set.size());
+	}
+	
+	state.set_items_processed(state.iterations() * state.arg());
+}
+
+REHEX_BENCHMARK(BM_ByteRangeSet_SetRandom)->arg(1000)->arg(10000);
+
+static void BM_ByteRangeSet_IsSet(Bench::State &state)
+{
+	ByteRangeSet set = make_set(state.arg());
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % (state.arg() * 4);
+		
+		Bench::do_not_optimise(set.isset(offset));
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_ByteRangeSet_IsSet)->arg(1000)->arg(1000000);
+
+/* Shift every range after an insertion near the start, as happens on each edit. */
+static void BM_ByteRangeSet_DataInserted(Bench::State &state)
+{
+	ByteRangeSet set = make_set(state.arg());
+	
+	while(state.keep_running())
+	{
+		set.data_inserted(1, 1);
+		set.data_erased(1, 1);
+	}
+	
+	state.set_items_processed(state.iterations() * 2);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeSet_DataInserted)->arg(1000)->arg(1000000);
+
+/* Set and clear small ranges at random points in a set of state.arg() ranges, which
+ * inserts and erases elements in the middle of the range container.
+*/
+template<typename S> static void range_set_churn(Bench::State &state)
+{
+	S set = make_set<S>(state.arg());
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = ((lcg >> 16) % state.arg()) * 4;
+		
+		/* Fill the gap after a range (merging it with the next one) and then punch the
+		 * gap back out again (splitting them).
+		*/
+		set.set_range((offset + 2), 2);
+		set.clear_range((offset + 2), 2);
+	}
+	
+	Bench::do_not_optimise(set.size());
+	state.set_items_processed(state.iterations() * 2);
+}
+
+static void BM_ByteRangeSet_Churn(Bench::State &state) { range_set_churn<ByteRangeSet>(state); }
+static void BM_ChunkedByteRangeSet_Churn(Bench::State &state) { range_set_churn<ChunkedByteRangeSet>(state); }
+
+REHEX_BENCHMARK(BM_ByteRangeSet_Churn)->arg(1000)->arg(1000000);
+REHEX_BENCHMARK(BM_ChunkedByteRangeSet_Churn)->arg(1000)->arg(1000000);
+
+static void BM_ChunkedByteRangeSet_IsSet(Bench::State &state)
+{
+	ChunkedByteRangeSet set = make_set<ChunkedByteRangeSet>(state.arg());
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % (state.arg() * 4);
+		
+		Bench::do_not_optimise(set.isset(offset));
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_ChunkedByteRangeSet_IsSet)->arg(1000)->arg(1000000);
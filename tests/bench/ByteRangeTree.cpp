@@ -0,0 +1,262 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "../../src/ByteRangeTree.hpp"
+
+using namespace REHex;
+
+/* Sorted elements for a two level tree, like a document with lots of nested comments. */
+static std::vector< std::pair<ByteRangeTreeKey, int> > nested_elements(int64_t n)
+{
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements;
+	elements.reserve(n * 2);
+	
+	for(int64_t i = 0; i < n; ++i)
+	{
+		elements.push_back(std::make_pair(ByteRangeTreeKey((i * 100), 100), (int)(i)));
+		elements.push_back(std::make_pair(ByteRangeTreeKey((i * 100) + 10, 10), (int)(i)));
+	}
+	
+	return elements;
+}
+
+/* Apply a stream of random operations to a tree, using the same mix of operations as
+ * tools/brt-fuzz.cpp (minus the whole-tree ones), but biased towards short ranges so
+ * the tree stays populated.
+*/
+static void fuzz_tree(ByteRangeTree<int> &tree, uint64_t &lcg, off_t space)
+{
+	auto rand = [&]()
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return (off_t)(lcg >> 24);
+	};
+	
+	off_t offset = rand() % space;
+	off_t length = (rand() % 8) == 0
+		? rand() % 1000
+		: rand() % 20;
+	
+	/* data_inserted() and data_erased() touch every node, so they are much less common
+	 * than in brt-fuzz to stop them dominating.
+	*/
+	
+	int op = rand() % 200;
+	
+	if(op < 96)
+	{
+		tree.set(offset, length, 0);
+	}
+	else if(op < 160)
+	{
+		ByteRangeTree<int>::Node *node = tree.find_most_specific_parent(offset);
+		if(node != NULL)
+		{
+			tree.erase(node);
+		}
+	}
+	else if(op < 198)
+	{
+		ByteRangeTree<int>::Node *node = tree.find_most_specific_parent(offset);
+		if(node != NULL)
+		{
+			tree.erase_recursive(node);
+		}
+	}
+	else if(op == 198)
+	{
+		tree.data_inserted(offset, (length % 4) + 1);
+	}
+	else{
+		tree.data_erased(offset, (length % 4) + 1);
+	}
+}
+
+/* Build a two level tree, like a document with lots of nested comments. */
+static void BM_ByteRangeTree_Set(Bench::State &state)
+{
+	while(state.keep_running())
+	{
+		ByteRangeTree<int> tree;
+		
+		for(int64_t i = 0; i < state.arg(); ++i)
+		{
+			tree.set((i * 100), 100, i);
+			tree.set((i * 100) + 10, 10, i);
+		}
+		
+		Bench::do_not_optimise(tree.size());
+	}
+	
+	state.set_items_processed(state.iterations() * state.arg() * 2);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_Set)->arg(1000)->arg(100000);
+
+/* Build the same tree as BM_ByteRangeTree_Set from sorted elements, like loading comments. */
+static void BM_ByteRangeTree_BulkConstruct(Bench::State &state)
+{
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements = nested_elements(state.arg());
+	
+	while(state.keep_running())
+	{
+		ByteRangeTree<int> tree(elements.begin(), elements.end());
+		Bench::do_not_optimise(tree.size());
+	}
+	
+	state.set_items_processed(state.iterations() * state.arg() * 2);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_BulkConstruct)->arg(1000)->arg(100000);
+
+static void BM_ByteRangeTree_Copy(Bench::State &state)
+{
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements = nested_elements(state.arg());
+	ByteRangeTree<int> tree(elements.begin(), elements.end());
+	
+	while(state.keep_running())
+	{
+		ByteRangeTree<int> copy(tree);
+		Bench::do_not_optimise(copy.size());
+	}
+	
+	state.set_items_processed(state.iterations() * tree.size());
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_Copy)->arg(1000)->arg(100000);
+
+/* Walk every node in depth-first order, like CommentTree and DocumentCtrl do. */
+static void iterate_tree(Bench::State &state, const ByteRangeTree<int> &tree)
+{
+	while(state.keep_running())
+	{
+		int sum = 0;
+		
+		for(auto it = tree.begin(); it != tree.end(); ++it)
+		{
+			sum += it->value;
+		}
+		
+		Bench::do_not_optimise(sum);
+	}
+	
+	state.set_items_processed(state.iterations() * tree.size());
+	state.set_counter("bytes_per_node", (double)(tree.memory_usage()) / tree.size());
+}
+
+static void BM_ByteRangeTree_Iterate(Bench::State &state)
+{
+	ByteRangeTree<int> tree;
+	
+	for(int64_t i = 0; i < state.arg(); ++i)
+	{
+		tree.set((i * 100), 100, i);
+		tree.set((i * 100) + 10, 10, i);
+	}
+	
+	iterate_tree(state, tree);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_Iterate)->arg(1000)->arg(100000);
+
+/* Walk a tree which has had lots of random modifications since it was built. */
+static void BM_ByteRangeTree_IterateFuzzed(Bench::State &state)
+{
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements = nested_elements(state.arg());
+	ByteRangeTree<int> tree(elements.begin(), elements.end());
+	
+	uint64_t lcg = 1;
+	
+	for(int64_t i = 0; i < state.arg(); ++i)
+	{
+		fuzz_tree(tree, lcg, (state.arg() * 100));
+	}
+	
+	iterate_tree(state, tree);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_IterateFuzzed)->arg(1000)->arg(100000);
+
+static void BM_ByteRangeTree_FuzzOps(Bench::State &state)
+{
+	std::vector< std::pair<ByteRangeTreeKey, int> > elements = nested_elements(state.arg());
+	ByteRangeTree<int> tree(elements.begin(), elements.end());
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		fuzz_tree(tree, lcg, (state.arg() * 100));
+	}
+	
+	Bench::do_not_optimise(tree.size());
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_FuzzOps)->arg(1000)->arg(100000);
+
+static void BM_ByteRangeTree_FindMostSpecificParent(Bench::State &state)
+{
+	ByteRangeTree<int> tree;
+	
+	for(int64_t i = 0; i < state.arg(); ++i)
+	{
+		tree.set((i * 100), 100, i);
+		tree.set((i * 100) + 10, 10, i);
+	}
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % (state.arg() * 100);
+		
+		Bench::do_not_optimise(tree.find_most_specific_parent(offset));
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_FindMostSpecificParent)->arg(1000)->arg(100000);
+
+static void BM_ByteRangeTree_DataInserted(Bench::State &state)
+{
+	ByteRangeTree<int> tree;
+	
+	for(int64_t i = 0; i < state.arg(); ++i)
+	{
+		tree.set((i * 100), 100, i);
+		tree.set((i * 100) + 10, 10, i);
+	}
+	
+	while(state.keep_running())
+	{
+		tree.data_inserted(1, 1);
+		tree.data_erased(1, 1);
+	}
+	
+	state.set_items_processed(state.iterations() * 2);
+}
+
+REHEX_BENCHMARK(BM_ByteRangeTree_DataInserted)->arg(1000)->arg(100000);
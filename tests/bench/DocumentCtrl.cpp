@@ -0,0 +1,84 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "../../src/platform.hpp"
+
+#include <assert.h>
+#include <vector>
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../testutil.hpp"
+#include "../../src/DocumentCtrl.hpp"
+#include "../../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+/* Repaint a screenful of data. The argument is the number of highlighted and
+ * dirty ranges scattered over the visible part of the document.
+*/
+static void BM_DocumentCtrl_Paint(Bench::State &state)
+{
+	AutoFrame frame(NULL, wxID_ANY, "REHex Benchmarks", wxDefaultPosition, wxSize(1024, 768));
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make(wxFileName(Bench::sparse_file())));
+	
+	assert(doc->get_highlight_colours().begin() != doc->get_highlight_colours().end());
+	int colour_idx = doc->get_highlight_colours().begin()->first;
+	
+	for(int i = 0; i < state.arg(); ++i)
+	{
+		static const unsigned char BYTE = 0xAA;
+		doc->overwrite_data(BitOffset((i * 16) + 3, 0), &BYTE, 1);
+		
+		doc->set_highlight(BitOffset((i * 16) + 8, 0), BitOffset(4, 0), colour_idx);
+	}
+	
+	DocumentCtrl *doc_ctrl = new DocumentCtrl(frame, doc);
+	
+	std::vector<DocumentCtrl::Region*> regions = { new DocumentCtrl::DataRegionDocHighlight(doc, 0, doc->buffer_length(), 0) };
+	doc_ctrl->replace_all_regions(regions);
+	
+	unsigned int paints = 0;
+	doc_ctrl->Bind(wxEVT_PAINT, [&](wxPaintEvent &event)
+	{
+		++paints;
+		event.Skip();
+	});
+	
+	frame->Show();
+	run_wx_until([&]() { return paints > 0; });
+	
+	while(state.keep_running())
+	{
+		unsigned int prev_paints = paints;
+		
+		doc_ctrl->Refresh();
+		doc_ctrl->Update();
+		
+		/* Some platforms defer painting to the event loop even after Update(). */
+		if(paints == prev_paints)
+		{
+			run_wx_until([&]() { return paints > prev_paints; }, 10000, 1);
+		}
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_DocumentCtrl_Paint)->arg(0)->arg(256);
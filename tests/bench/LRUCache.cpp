@@ -0,0 +1,210 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <sys/types.h>
+
+#include "bench.hpp"
+#include "../../src/ByteAccumulator.hpp"
+#include "../../src/LRUCache.hpp"
+
+using namespace REHex;
+
+namespace
+{
+	/* The previous std::list + std::map LRUCache implementation, kept as a baseline. */
+	template<typename K, typename V> class ListMapLRUCache
+	{
+		private:
+			const size_t max_items;
+			
+			mutable std::list< std::pair<K, V> > queue;
+			
+			typedef typename std::list< std::pair<K, V> >::iterator queue_iter_t;
+			std::map<K, queue_iter_t> map;
+		
+		public:
+			ListMapLRUCache(size_t max_items):
+				max_items(max_items) {}
+			
+			const V *get(const K &k) const
+			{
+				auto i = map.find(k);
+				
+				if(i != map.end())
+				{
+					queue.splice(queue.begin(), queue, i->second);
+					return &(i->second->second);
+				}
+				else{
+					return NULL;
+				}
+			}
+			
+			const V *set(const K &k, const V &v)
+			{
+				const V *old_v = get(k);
+				
+				if(old_v != NULL)
+				{
+					queue.pop_front();
+					
+					queue.push_front(std::make_pair(k, v));
+					map[k] = queue.begin();
+				}
+				else{
+					while(queue.size() >= max_items)
+					{
+						map.erase(queue.back().first);
+						queue.pop_back();
+					}
+					
+					queue.push_front(std::make_pair(k, v));
+					map[k] = queue.begin();
+				}
+				
+				return &(queue.front().second);
+			}
+	};
+	
+	/* Key pattern for a working set of state.arg() chunk offsets. */
+	inline off_t next_key(uint64_t &lcg, int64_t n_keys)
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		return (off_t)((lcg >> 16) % n_keys) * 4096;
+	}
+	
+	const size_t CACHE_SIZE = 512;
+}
+
+/* Mostly hits - working set is half the size of the cache. */
+
+template<typename C> static void lru_hits(Bench::State &state)
+{
+	C cache(CACHE_SIZE);
+	
+	for(int64_t i = 0; i < state.arg(); ++i)
+	{
+		cache.set(i * 4096, ByteAccumulator());
+	}
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		Bench::do_not_optimise(cache.get(next_key(lcg, state.arg())));
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+static void BM_LRUCache_ListMap_Hits(Bench::State &state) { lru_hits< ListMapLRUCache<off_t, ByteAccumulator> >(state); }
+static void BM_LRUCache_Hits(Bench::State &state) { lru_hits< LRUCache<off_t, ByteAccumulator> >(state); }
+
+REHEX_BENCHMARK(BM_LRUCache_ListMap_Hits)->arg(CACHE_SIZE / 2);
+REHEX_BENCHMARK(BM_LRUCache_Hits)->arg(CACHE_SIZE / 2);
+
+/* Get followed by set on miss - working set is twice the size of the cache, so about
+ * half of the lookups miss and evict something.
+*/
+
+template<typename C> static void lru_get_or_set(Bench::State &state)
+{
+	C cache(CACHE_SIZE);
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		off_t k = next_key(lcg, state.arg());
+		
+		const ByteAccumulator *v = cache.get(k);
+		if(v == NULL)
+		{
+			v = cache.set(k, ByteAccumulator());
+		}
+		
+		Bench::do_not_optimise(v);
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+static void BM_LRUCache_ListMap_GetOrSet(Bench::State &state) { lru_get_or_set< ListMapLRUCache<off_t, ByteAccumulator> >(state); }
+static void BM_LRUCache_GetOrSet(Bench::State &state) { lru_get_or_set< LRUCache<off_t, ByteAccumulator> >(state); }
+
+REHEX_BENCHMARK(BM_LRUCache_ListMap_GetOrSet)->arg(CACHE_SIZE * 2);
+REHEX_BENCHMARK(BM_LRUCache_GetOrSet)->arg(CACHE_SIZE * 2);
+
+/* The HierarchicalByteAccumulator access pattern: copy the value out under a lock
+ * and store new values under a lock.
+*/
+
+static void BM_LRUCache_ListMap_Locked(Bench::State &state)
+{
+	ListMapLRUCache<off_t, ByteAccumulator> cache(CACHE_SIZE);
+	std::mutex lock;
+	
+	uint64_t lcg = 1;
+	ByteAccumulator v;
+	
+	while(state.keep_running())
+	{
+		off_t k = next_key(lcg, state.arg());
+		
+		std::unique_lock<std::mutex> l(lock);
+		
+		const ByteAccumulator *cached = cache.get(k);
+		if(cached != NULL)
+		{
+			v = *cached;
+		}
+		else{
+			cache.set(k, v);
+		}
+	}
+	
+	Bench::do_not_optimise(v.get_total_bytes());
+	state.set_items_processed(state.iterations());
+}
+
+static void BM_LRUCache_Sharded(Bench::State &state)
+{
+	ShardedLRUCache<off_t, ByteAccumulator> cache(CACHE_SIZE);
+	
+	uint64_t lcg = 1;
+	ByteAccumulator v;
+	
+	while(state.keep_running())
+	{
+		off_t k = next_key(lcg, state.arg());
+		
+		if(!cache.get(k, &v))
+		{
+			cache.set(k, v);
+		}
+	}
+	
+	Bench::do_not_optimise(v.get_total_bytes());
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_LRUCache_ListMap_Locked)->arg(CACHE_SIZE * 2);
+REHEX_BENCHMARK(BM_LRUCache_Sharded)->arg(CACHE_SIZE * 2);
@@ -0,0 +1,92 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+#include "bench.hpp"
+#include "../../src/App.hpp"
+#include "../../src/RangeProcessor.hpp"
+#include "../../src/ThreadPool.hpp"
+
+using namespace REHex;
+
+static const off_t CONTENTION_RANGE_SIZE = 64 * 1024 * 1024; /* 64MiB */
+
+/* Process a fully queued range in small windows using the number of worker threads given by the
+ * benchmark argument, with the RangeProcessor running on a ThreadPool of that size.
+ *
+ * Each window is checksummed from a small buffer so there is some work to spread across threads,
+ * but little enough that claiming windows and marking them as done is a large part of the cost.
+*/
+static void rp_contention(Bench::State &state, size_t window_size)
+{
+	unsigned int threads = state.arg();
+	
+	ThreadPool pool(threads);
+	
+	ThreadPool *app_pool = wxGetApp().thread_pool;
+	wxGetApp().thread_pool = &pool;
+	
+	{
+		std::vector<unsigned char> data(window_size);
+		for(size_t i = 0; i < data.size(); ++i)
+		{
+			data[i] = i * 7;
+		}
+		
+		RangeProcessor rp([&](off_t window_base, off_t window_length)
+		{
+			uint32_t sum = window_base;
+			
+			for(off_t i = 0; i < window_length; ++i)
+			{
+				sum = (sum * 31) + data[i];
+			}
+			
+			Bench::do_not_optimise(sum);
+		}, window_size);
+		
+		rp.set_max_threads(threads);
+		
+		while(state.keep_running())
+		{
+			rp.queue_range(0, CONTENTION_RANGE_SIZE);
+			rp.wait_for_completion();
+		}
+	}
+	
+	wxGetApp().thread_pool = app_pool;
+	
+	state.set_bytes_processed(state.iterations() * CONTENTION_RANGE_SIZE);
+	state.set_items_processed(state.iterations() * (CONTENTION_RANGE_SIZE / window_size));
+}
+
+static void BM_RangeProcessor_Contention256(Bench::State &state)
+{
+	rp_contention(state, 256);
+}
+
+static void BM_RangeProcessor_Contention4K(Bench::State &state)
+{
+	rp_contention(state, 4096);
+}
+
+REHEX_BENCHMARK(BM_RangeProcessor_Contention256)->arg(1)->arg(2)->arg(4)->arg(8)->arg(16)->arg(32)->arg(64);
+REHEX_BENCHMARK(BM_RangeProcessor_Contention4K)->arg(1)->arg(2)->arg(4)->arg(8)->arg(16)->arg(32)->arg(64);
@@ -0,0 +1,55 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../../src/SelectionMatchFinder.hpp"
+#include "../../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+/* Search the whole sparse file for a byte sequence, as when selecting data with highlighting of
+ * matching data enabled.
+*/
+static void BM_SelectionMatchFinder_WholeFile(Bench::State &state)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make(wxFileName(Bench::sparse_file())));
+	
+	std::vector<unsigned char> needle(state.arg());
+	for(size_t i = 0; i < needle.size(); ++i)
+	{
+		needle[i] = 0x5A + i;
+	}
+	
+	while(state.keep_running())
+	{
+		SelectionMatchFinder finder(doc);
+		
+		finder.set_needle(needle);
+		finder.wait_for_completion();
+		
+		Bench::do_not_optimise(finder.get_generation());
+	}
+	
+	state.set_bytes_processed(state.iterations() * doc->buffer_length());
+}
+
+REHEX_BENCHMARK(BM_SelectionMatchFinder_WholeFile)->arg(4)->arg(16)->iterations(1);
@@ -0,0 +1,62 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../testutil.hpp"
+#include "../../src/DocumentCtrl.hpp"
+#include "../../src/SharedDocumentPointer.hpp"
+#include "../../src/StringPanel.hpp"
+
+using namespace REHex;
+
+/* Scan the whole sparse file for strings, from showing the panel until the scan finishes. */
+static void BM_StringPanel_WholeFile(Bench::State &state)
+{
+	AutoFrame frame(NULL, wxID_ANY, "REHex Benchmarks");
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make(wxFileName(Bench::sparse_file())));
+	DocumentCtrl *doc_ctrl = new DocumentCtrl(frame, doc);
+	
+	std::vector<DocumentCtrl::Region*> regions = { new DocumentCtrl::DataRegion(doc, 0, doc->buffer_length(), 0) };
+	doc_ctrl->replace_all_regions(regions);
+	
+	while(state.keep_running())
+	{
+		StringPanel *string_panel = new StringPanel(frame, doc, doc_ctrl);
+		string_panel->set_min_string_length(4);
+		string_panel->set_visible(true);
+		
+		/* No time limit, the default one is meant for the unit tests. */
+		run_wx_until([&]() { return !(string_panel->search_pending()); }, (24 * 60 * 60 * 1000));
+		
+		Bench::do_not_optimise(string_panel->get_clean_bytes());
+		
+		state.pause_timing();
+		string_panel->Destroy();
+		state.resume_timing();
+	}
+	
+	state.set_bytes_processed(state.iterations() * doc->buffer_length());
+}
+
+REHEX_BENCHMARK(BM_StringPanel_WholeFile)->iterations(1);
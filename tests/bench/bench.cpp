@@ -0,0 +1,469 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+/* A minimal benchmark runner, modelled on Google Benchmark.
+ *
+ * The command line options and JSON output format follow those of Google Benchmark, so
+ * results can be compared using its tools (e.g. compare.py) without us having to build
+ * and ship the library on every platform.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <jansson.h>
+#include <memory>
+#include <regex>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <wx/file.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "bench.hpp"
+#include "../../src/TempDirectory.hpp"
+
+static double min_time = 0.5;
+static off_t file_size = (off_t)(4) * 1024 * 1024 * 1024; /* 4GiB */
+
+static std::vector< std::unique_ptr<REHex::Bench::Benchmark> > &benchmarks()
+{
+	static std::vector< std::unique_ptr<REHex::Bench::Benchmark> > benchmarks;
+	return benchmarks;
+}
+
+REHex::Bench::Benchmark *REHex::Bench::register_benchmark(const std::string &name, const BenchmarkFunc &func)
+{
+	benchmarks().emplace_back(new Benchmark(name, func));
+	return benchmarks().back().get();
+}
+
+REHex::Bench::State::State(int64_t arg, uint64_t max_iterations):
+	m_arg(arg),
+	m_max_iterations(max_iterations),
+	m_iterations(0),
+	m_started(false),
+	m_paused(false),
+	m_cpu_begin(0.0),
+	m_real_seconds(0.0),
+	m_cpu_seconds(0.0),
+	m_bytes_processed(0),
+	m_items_processed(0) {}
+
+/**
+ * @brief Get the CPU time used by the calling thread, in seconds.
+ *
+ * std::clock() measures the whole process on most platforms (and wall time on Windows), which
+ * would count the time spent by every thread pool worker in a multithreaded benchmark.
+*/
+static double thread_cpu_seconds()
+{
+	#ifdef _WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if(!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+	{
+		return 0.0;
+	}
+	
+	ULARGE_INTEGER kernel_100ns, user_100ns;
+	
+	kernel_100ns.LowPart = kernel_time.dwLowDateTime;
+	kernel_100ns.HighPart = kernel_time.dwHighDateTime;
+	
+	user_100ns.LowPart = user_time.dwLowDateTime;
+	user_100ns.HighPart = user_time.dwHighDateTime;
+	
+	return (double)(kernel_100ns.QuadPart + user_100ns.QuadPart) / 10000000.0;
+	#else
+	struct timespec ts;
+	if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+	{
+		return 0.0;
+	}
+	
+	return (double)(ts.tv_sec) + ((double)(ts.tv_nsec) / 1000000000.0);
+	#endif
+}
+
+void REHex::Bench::State::start_timer()
+{
+	m_real_begin = std::chrono::steady_clock::now();
+	m_cpu_begin = thread_cpu_seconds();
+}
+
+void REHex::Bench::State::stop_timer()
+{
+	std::chrono::duration<double> real_elapsed = std::chrono::steady_clock::now() - m_real_begin;
+	m_real_seconds += real_elapsed.count();
+	
+	m_cpu_seconds += thread_cpu_seconds() - m_cpu_begin;
+}
+
+void REHex::Bench::State::pause_timing()
+{
+	if(!m_paused)
+	{
+		stop_timer();
+		m_paused = true;
+	}
+}
+
+void REHex::Bench::State::resume_timing()
+{
+	if(m_paused)
+	{
+		m_paused = false;
+		start_timer();
+	}
+}
+
+static std::unique_ptr<REHex::TempDirectory> sparse_file_dir;
+static std::string sparse_file_path;
+
+const std::string &REHex::Bench::sparse_file()
+{
+	if(sparse_file_path.empty())
+	{
+		sparse_file_dir.reset(new TempDirectory());
+		std::string path = sparse_file_dir->path() + "sparse.bin";
+		
+		fprintf(stderr, "Generating %" PRId64 " byte sparse file...\n", (int64_t)(file_size));
+		
+		wxFile file(path, wxFile::write);
+		if(!file.IsOpened())
+		{
+			throw std::runtime_error("Unable to create " + path);
+		}
+		
+		/* Fill each data block with a simple LCG so the contents are repeatable. */
+		
+		std::vector<unsigned char> data(SPARSE_FILE_DATA_SIZE);
+		uint32_t lcg = 1;
+		
+		for(off_t offset = 0; offset < file_size; offset += SPARSE_FILE_DATA_INTERVAL)
+		{
+			for(size_t i = 0; i < data.size(); ++i)
+			{
+				lcg = (lcg * 1103515245) + 12345;
+				data[i] = lcg >> 24;
+			}
+			
+			size_t write_size = std::min<off_t>(data.size(), (file_size - offset));
+			
+			if(file.Seek(offset) == wxInvalidOffset || file.Write(data.data(), write_size) != write_size)
+			{
+				throw std::runtime_error("Unable to write " + path);
+			}
+		}
+		
+		/* Extend the file to its full size, leaving a hole after the last block. */
+		
+		const unsigned char zero = 0;
+		if(file.Seek(file_size - 1) == wxInvalidOffset || file.Write(&zero, 1) != 1)
+		{
+			throw std::runtime_error("Unable to write " + path);
+		}
+		
+		sparse_file_path = path;
+	}
+	
+	return sparse_file_path;
+}
+
+off_t REHex::Bench::sparse_file_size()
+{
+	return file_size;
+}
+
+static std::string format_time(double seconds)
+{
+	char buf[64];
+	
+	if(seconds >= 1.0)
+	{
+		snprintf(buf, sizeof(buf), "%.3f s", seconds);
+	}
+	else if(seconds >= 0.001)
+	{
+		snprintf(buf, sizeof(buf), "%.3f ms", (seconds * 1000.0));
+	}
+	else if(seconds >= 0.000001)
+	{
+		snprintf(buf, sizeof(buf), "%.3f us", (seconds * 1000000.0));
+	}
+	else{
+		snprintf(buf, sizeof(buf), "%.1f ns", (seconds * 1000000000.0));
+	}
+	
+	return buf;
+}
+
+static std::string format_rate(double per_second, const char *unit)
+{
+	char buf[64];
+	
+	if(per_second >= (1024.0 * 1024.0 * 1024.0))
+	{
+		snprintf(buf, sizeof(buf), "%.2fGi%s/s", (per_second / (1024.0 * 1024.0 * 1024.0)), unit);
+	}
+	else if(per_second >= (1024.0 * 1024.0))
+	{
+		snprintf(buf, sizeof(buf), "%.2fMi%s/s", (per_second / (1024.0 * 1024.0)), unit);
+	}
+	else if(per_second >= 1024.0)
+	{
+		snprintf(buf, sizeof(buf), "%.2fki%s/s", (per_second / 1024.0), unit);
+	}
+	else{
+		snprintf(buf, sizeof(buf), "%.2f%s/s", per_second, unit);
+	}
+	
+	return buf;
+}
+
+/**
+ * @brief Run a benchmark, increasing the iteration count until it runs for min_time.
+*/
+static REHex::Bench::State run_one(const REHex::Bench::Benchmark &benchmark, int64_t arg)
+{
+	uint64_t iterations = benchmark.fixed_iterations > 0 ? benchmark.fixed_iterations : 1;
+	
+	while(true)
+	{
+		REHex::Bench::State state(arg, iterations);
+		benchmark.func(state);
+		
+		if(benchmark.fixed_iterations > 0 || state.real_seconds() >= min_time || iterations >= 1000000000)
+		{
+			return state;
+		}
+		
+		/* Aim 40% over the minimum time so we don't fall just short again. */
+		
+		double multiplier = state.real_seconds() > 0.0
+			? (min_time * 1.4) / state.real_seconds()
+			: 10.0;
+		
+		multiplier = std::max(multiplier, 2.0);
+		multiplier = std::min(multiplier, 10.0);
+		
+		iterations = (uint64_t)(iterations * multiplier);
+	}
+}
+
+int REHex::Bench::run_benchmarks(int argc, char **argv)
+{
+	std::string filter = ".";
+	std::string out_file;
+	bool list_only = false;
+	
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string a = argv[i];
+		
+		auto value_of = [&](const char *prefix, std::string *value)
+		{
+			size_t prefix_len = strlen(prefix);
+			
+			if(a.compare(0, prefix_len, prefix) == 0)
+			{
+				*value = a.substr(prefix_len);
+				return true;
+			}
+			
+			return false;
+		};
+		
+		std::string value;
+		
+		if(value_of("--benchmark_filter=", &value))
+		{
+			filter = value;
+		}
+		else if(value_of("--benchmark_out=", &value))
+		{
+			out_file = value;
+		}
+		else if(value_of("--benchmark_min_time=", &value))
+		{
+			min_time = atof(value.c_str());
+		}
+		else if(value_of("--bench_file_size=", &value))
+		{
+			file_size = strtoll(value.c_str(), NULL, 0);
+		}
+		else if(a == "--benchmark_list_tests")
+		{
+			list_only = true;
+		}
+		else{
+			fprintf(stderr, "Usage: %s [--benchmark_filter=<regex>] [--benchmark_out=<file.json>]\n"
+				"       [--benchmark_min_time=<seconds>] [--bench_file_size=<bytes>]\n"
+				"       [--benchmark_list_tests]\n", argv[0]);
+			
+			return 1;
+		}
+	}
+	
+	if(file_size < SPARSE_FILE_DATA_INTERVAL)
+	{
+		fprintf(stderr, "--bench_file_size must be at least %" PRId64 "\n", (int64_t)(SPARSE_FILE_DATA_INTERVAL));
+		return 1;
+	}
+	
+	std::regex filter_re;
+	
+	try {
+		filter_re = std::regex(filter);
+	}
+	catch(const std::regex_error &e)
+	{
+		fprintf(stderr, "Invalid --benchmark_filter: %s\n", e.what());
+		return 1;
+	}
+	
+	json_t *results = json_array();
+	
+	for(auto b = benchmarks().begin(); b != benchmarks().end(); ++b)
+	{
+		const Benchmark &benchmark = **b;
+		
+		std::vector<int64_t> args = benchmark.args;
+		bool has_arg = !args.empty();
+		
+		if(!has_arg)
+		{
+			args.push_back(0);
+		}
+		
+		for(auto arg = args.begin(); arg != args.end(); ++arg)
+		{
+			std::string name = has_arg
+				? benchmark.name + "/" + std::to_string(*arg)
+				: benchmark.name;
+			
+			if(!std::regex_search(name, filter_re))
+			{
+				continue;
+			}
+			
+			if(list_only)
+			{
+				printf("%s\n", name.c_str());
+				continue;
+			}
+			
+			State state = run_one(benchmark, *arg);
+			
+			double real_per_iter = state.real_seconds() / state.iterations();
+			double cpu_per_iter = state.cpu_seconds() / state.iterations();
+			
+			std::string counters;
+			
+			json_t *result = json_object();
+			json_object_set_new(result, "name", json_string(name.c_str()));
+			json_object_set_new(result, "run_name", json_string(name.c_str()));
+			json_object_set_new(result, "run_type", json_string("iteration"));
+			json_object_set_new(result, "iterations", json_integer(state.iterations()));
+			json_object_set_new(result, "real_time", json_real(real_per_iter * 1000000000.0));
+			json_object_set_new(result, "cpu_time", json_real(cpu_per_iter * 1000000000.0));
+			json_object_set_new(result, "time_unit", json_string("ns"));
+			
+			if(state.bytes_processed() > 0 && state.real_seconds() > 0.0)
+			{
+				double rate = state.bytes_processed() / state.real_seconds();
+				
+				json_object_set_new(result, "bytes_per_second", json_real(rate));
+				counters += " " + format_rate(rate, "B");
+			}
+			
+			if(state.items_processed() > 0 && state.real_seconds() > 0.0)
+			{
+				double rate = state.items_processed() / state.real_seconds();
+				
+				json_object_set_new(result, "items_per_second", json_real(rate));
+				counters += " " + format_rate(rate, "items");
+			}
+			
+			for(auto c = state.counters().begin(); c != state.counters().end(); ++c)
+			{
+				char value[64];
+				snprintf(value, sizeof(value), "%g", c->second);
+				
+				json_object_set_new(result, c->first.c_str(), json_real(c->second));
+				counters += " " + c->first + "=" + value;
+			}
+			
+			json_array_append_new(results, result);
+			
+			printf("%-50s %14s %14s %12" PRIu64 "%s\n",
+				name.c_str(),
+				format_time(real_per_iter).c_str(),
+				format_time(cpu_per_iter).c_str(),
+				state.iterations(),
+				counters.c_str());
+			
+			fflush(stdout);
+		}
+	}
+	
+	sparse_file_dir.reset();
+	
+	if(!out_file.empty())
+	{
+		char date[64];
+		time_t now = time(NULL);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+		
+		json_t *context = json_object();
+		json_object_set_new(context, "date", json_string(date));
+		json_object_set_new(context, "num_cpus", json_integer(std::thread::hardware_concurrency()));
+		json_object_set_new(context, "bench_file_size", json_integer(file_size));
+		
+		#ifdef NDEBUG
+		json_object_set_new(context, "library_build_type", json_string("release"));
+		#else
+		json_object_set_new(context, "library_build_type", json_string("debug"));
+		#endif
+		
+		json_t *root = json_object();
+		json_object_set_new(root, "context", context);
+		json_object_set(root, "benchmarks", results);
+		
+		int res = json_dump_file(root, out_file.c_str(), JSON_INDENT(2));
+		json_decref(root);
+		
+		if(res != 0)
+		{
+			fprintf(stderr, "Unable to write %s\n", out_file.c_str());
+			json_decref(results);
+			
+			return 1;
+		}
+	}
+	
+	json_decref(results);
+	
+	return 0;
+}
@@ -0,0 +1,261 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_BENCH_HPP
+#define REHEX_BENCH_HPP
+
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace REHex
+{
+	namespace Bench
+	{
+		/**
+		 * @brief State passed to a benchmark function.
+		 *
+		 * The function should do any setup, then run the code being measured once per
+		 * iteration of a keep_running() loop:
+		 *
+		 * @code
+		 * static void BM_Something(REHex::Bench::State &state)
+		 * {
+		 *     std::vector<unsigned char> data(state.arg());
+		 *
+		 *     while(state.keep_running())
+		 *     {
+		 *         do_something(data);
+		 *     }
+		 *
+		 *     state.set_bytes_processed(state.iterations() * data.size());
+		 * }
+		 * @endcode
+		 *
+		 * The number of iterations is chosen by the runner so the loop takes at least
+		 * the minimum benchmark time, unless the benchmark was registered with a fixed
+		 * number of iterations.
+		*/
+		class State
+		{
+			private:
+				int64_t m_arg;
+				uint64_t m_max_iterations;
+				uint64_t m_iterations;
+				
+				bool m_started;
+				bool m_paused;
+				
+				std::chrono::steady_clock::time_point m_real_begin;
+				double m_cpu_begin;
+				
+				double m_real_seconds;
+				double m_cpu_seconds;
+				
+				uint64_t m_bytes_processed;
+				uint64_t m_items_processed;
+				
+				std::vector< std::pair<std::string, double> > m_counters;
+				
+				void start_timer();
+				void stop_timer();
+			
+			public:
+				State(int64_t arg, uint64_t max_iterations);
+				
+				/**
+				 * @brief Returns true until the requested number of iterations have run.
+				*/
+				bool keep_running()
+				{
+					if(m_iterations < m_max_iterations)
+					{
+						if(!m_started)
+						{
+							m_started = true;
+							start_timer();
+						}
+						
+						++m_iterations;
+						return true;
+					}
+					else{
+						if(m_started && !m_paused)
+						{
+							stop_timer();
+							m_paused = true;
+						}
+						
+						return false;
+					}
+				}
+				
+				/**
+				 * @brief Stop timing, e.g. to reset state between iterations.
+				*/
+				void pause_timing();
+				
+				/**
+				 * @brief Resume timing after pause_timing().
+				*/
+				void resume_timing();
+				
+				/**
+				 * @brief Get the argument the benchmark was registered with.
+				*/
+				int64_t arg() const { return m_arg; }
+				
+				/**
+				 * @brief Get the number of iterations run so far.
+				*/
+				uint64_t iterations() const { return m_iterations; }
+				
+				/**
+				 * @brief Set the total number of bytes processed by all iterations.
+				*/
+				void set_bytes_processed(uint64_t bytes) { m_bytes_processed = bytes; }
+				
+				/**
+				 * @brief Set the total number of items processed by all iterations.
+				*/
+				void set_items_processed(uint64_t items) { m_items_processed = items; }
+				
+				/**
+				 * @brief Report an additional named measurement, e.g. memory usage.
+				*/
+				void set_counter(const std::string &name, double value)
+				{
+					for(auto c = m_counters.begin(); c != m_counters.end(); ++c)
+					{
+						if(c->first == name)
+						{
+							c->second = value;
+							return;
+						}
+					}
+					
+					m_counters.push_back(std::make_pair(name, value));
+				}
+				
+				double real_seconds() const { return m_real_seconds; }
+				
+				/**
+				 * @brief Get the CPU time used by the thread running the benchmark.
+				 *
+				 * Like Google Benchmark, this doesn't include any work done on other
+				 * threads (e.g. the thread pool), so only real_seconds() is meaningful
+				 * for benchmarks which hand their work off to other threads.
+				*/
+				double cpu_seconds() const { return m_cpu_seconds; }
+				uint64_t bytes_processed() const { return m_bytes_processed; }
+				uint64_t items_processed() const { return m_items_processed; }
+				const std::vector< std::pair<std::string, double> > &counters() const { return m_counters; }
+		};
+		
+		typedef std::function<void(State&)> BenchmarkFunc;
+		
+		/**
+		 * @brief A registered benchmark.
+		 *
+		 * Returned by register_benchmark() so options can be chained onto the
+		 * registration, e.g. `REHEX_BENCHMARK(BM_Foo)->arg(1024)->arg(4096);`
+		*/
+		class Benchmark
+		{
+			public:
+				const std::string name;
+				const BenchmarkFunc func;
+				
+				std::vector<int64_t> args;
+				uint64_t fixed_iterations;
+				
+				Benchmark(const std::string &name, const BenchmarkFunc &func):
+					name(name), func(func), fixed_iterations(0) {}
+				
+				/**
+				 * @brief Run the benchmark with an argument (may be called more than once).
+				*/
+				Benchmark *arg(int64_t arg)
+				{
+					args.push_back(arg);
+					return this;
+				}
+				
+				/**
+				 * @brief Run the benchmark for a fixed number of iterations.
+				 *
+				 * This is intended for macrobenchmarks where a single iteration
+				 * already takes a long time.
+				*/
+				Benchmark *iterations(uint64_t iterations)
+				{
+					fixed_iterations = iterations;
+					return this;
+				}
+		};
+		
+		Benchmark *register_benchmark(const std::string &name, const BenchmarkFunc &func);
+		
+		/**
+		 * @brief Get the path of a large sparse file for macrobenchmarks.
+		 *
+		 * The file is created the first time this is called and deleted when the
+		 * program exits. It mostly consists of holes, with a block of pseudo-random
+		 * data every SPARSE_FILE_DATA_INTERVAL bytes. The size defaults to 4GiB and
+		 * can be changed using the --bench_file_size option.
+		*/
+		const std::string &sparse_file();
+		
+		/**
+		 * @brief Get the size of the file returned by sparse_file().
+		*/
+		off_t sparse_file_size();
+		
+		static const off_t SPARSE_FILE_DATA_INTERVAL = 64 * 1024 * 1024; /* 64MiB */
+		static const size_t SPARSE_FILE_DATA_SIZE = 64 * 1024;           /* 64KiB */
+		
+		/**
+		 * @brief Prevent the compiler from optimising away a value.
+		*/
+		template<typename T> inline void do_not_optimise(const T &value)
+		{
+			#if defined(__GNUC__) || defined(__clang__)
+			asm volatile("" : : "r,m"(value) : "memory");
+			#else
+			static volatile const void *sink;
+			sink = &value;
+			#endif
+		}
+		
+		int run_benchmarks(int argc, char **argv);
+	}
+}
+
+#define REHEX_BENCHMARK_CONCAT2(a, b) a##b
+#define REHEX_BENCHMARK_CONCAT(a, b) REHEX_BENCHMARK_CONCAT2(a, b)
+
+/**
+ * @brief Register a benchmark function.
+*/
+#define REHEX_BENCHMARK(func) \
+	static REHex::Bench::Benchmark *REHEX_BENCHMARK_CONCAT(bench_reg_, __LINE__) = REHex::Bench::register_benchmark(#func, &func)
+
+#endif /* !REHEX_BENCH_HPP */
@@ -0,0 +1,69 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../../src/buffer.hpp"
+
+using namespace REHex;
+
+/* Read through the whole sparse file in 1MiB chunks, as a document-wide scan would. */
+static void BM_Buffer_ReadSequential(Bench::State &state)
+{
+	const off_t CHUNK_SIZE = 1024 * 1024;
+	
+	Buffer buffer(wxFileName(Bench::sparse_file()));
+	off_t length = buffer.length();
+	
+	while(state.keep_running())
+	{
+		for(off_t offset = 0; offset < length; offset += CHUNK_SIZE)
+		{
+			std::vector<unsigned char> data = buffer.read_data(offset, CHUNK_SIZE);
+			Bench::do_not_optimise(data.data());
+		}
+	}
+	
+	state.set_bytes_processed(state.iterations() * length);
+}
+
+REHEX_BENCHMARK(BM_Buffer_ReadSequential)->iterations(1);
+
+/* Read small blocks scattered throughout the sparse file, as when scrolling around. */
+static void BM_Buffer_ReadRandom(Bench::State &state)
+{
+	Buffer buffer(wxFileName(Bench::sparse_file()));
+	off_t length = buffer.length() - state.arg();
+	
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % length;
+		
+		std::vector<unsigned char> data = buffer.read_data(offset, state.arg());
+		Bench::do_not_optimise(data.data());
+	}
+	
+	state.set_bytes_processed(state.iterations() * state.arg());
+}
+
+REHEX_BENCHMARK(BM_Buffer_ReadRandom)->arg(16)->arg(4096)->arg(65536);
@@ -0,0 +1,101 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../../src/document.hpp"
+
+using namespace REHex;
+
+static void BM_Document_Overwrite(Bench::State &state)
+{
+	Document doc(wxFileName(Bench::sparse_file()));
+	off_t length = doc.buffer_length() - state.arg();
+	
+	std::vector<unsigned char> data(state.arg(), 0xAA);
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % length;
+		
+		doc.overwrite_data(offset, data.data(), data.size());
+	}
+	
+	state.set_items_processed(state.iterations());
+}
+
+REHEX_BENCHMARK(BM_Document_Overwrite)->arg(1)->arg(4096);
+
+static void BM_Document_InsertErase(Bench::State &state)
+{
+	Document doc(wxFileName(Bench::sparse_file()));
+	off_t length = doc.buffer_length();
+	
+	std::vector<unsigned char> data(state.arg(), 0xAA);
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+		off_t offset = (lcg >> 16) % length;
+		
+		doc.insert_data(offset, data.data(), data.size());
+		doc.erase_data(offset, data.size());
+	}
+	
+	state.set_items_processed(state.iterations() * 2);
+}
+
+REHEX_BENCHMARK(BM_Document_InsertErase)->arg(1)->arg(4096);
+
+/* Group a batch of changes into one transaction, then undo and redo it. */
+static void BM_Document_TransactionUndoRedo(Bench::State &state)
+{
+	Document doc(wxFileName(Bench::sparse_file()));
+	off_t length = doc.buffer_length() - 1;
+	
+	const unsigned char byte = 0xAA;
+	uint64_t lcg = 1;
+	
+	while(state.keep_running())
+	{
+		doc.transact_begin("benchmark");
+		
+		for(int64_t i = 0; i < state.arg(); ++i)
+		{
+			lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+			off_t offset = (lcg >> 16) % length;
+			
+			doc.overwrite_data(offset, &byte, 1);
+		}
+		
+		doc.transact_commit();
+		
+		doc.undo();
+		doc.redo();
+	}
+	
+	state.set_items_processed(state.iterations() * state.arg());
+}
+
+REHEX_BENCHMARK(BM_Document_TransactionUndoRedo)->arg(16)->arg(1024);
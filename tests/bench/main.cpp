@@ -0,0 +1,102 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+#include <stdio.h>
+#include <wx/app.h>
+#include <wx/init.h>
+
+#include "../../src/App.hpp"
+#include "bench.hpp"
+
+REHex::App &wxGetApp()
+{
+	return *(REHex::App*)(wxTheApp);
+}
+
+void REHex::App::_test_setup_hooks(SetupPhase phase)
+{
+	call_setup_hooks(phase);
+}
+
+int main(int argc, char **argv)
+{
+	REHex::App *app = new REHex::App();
+	
+	wxApp::SetInstance(app);
+	wxInitializer wxinit;
+	
+	app->bulk_updates_freeze_count = 0;
+	app->console = new REHex::ConsoleBuffer();
+	app->thread_pool = new REHex::ThreadPool(8);
+	app->config = new wxConfig("REHex-qwertyuiop"); /* Should be a name that won't load anything. */
+	app->settings = new REHex::AppSettings();
+	
+	#ifdef __APPLE__
+	app->recent_files = new REHex::MacFileHistory();
+	#else
+	app->recent_files = new wxFileHistory();
+	#endif
+	
+	app->_test_setup_hooks(REHex::App::SetupPhase::EARLY);
+	
+	int result;
+	
+	try {
+		result = REHex::Bench::run_benchmarks(argc, argv);
+	}
+	catch(const std::exception &e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		result = 1;
+	}
+	
+	app->_test_setup_hooks(REHex::App::SetupPhase::SHUTDOWN_LATE);
+	
+	app->CleanUp();
+	app->OnExit();
+	
+	wxApp::SetInstance(NULL);
+	delete app;
+	
+	return result;
+}
+
+bool REHex::App::Initialize(int& argc, wxChar **argv)
+{
+	return wxApp::Initialize(argc, argv);
+}
+
+bool REHex::App::OnInit()
+{
+	return true;
+}
+
+int REHex::App::OnExit()
+{
+	delete recent_files;
+	delete settings;
+	delete config;
+	delete console;
+	
+	return wxApp::OnExit();
+}
+
+int REHex::App::OnRun()
+{
+	return wxApp::OnRun();
+}
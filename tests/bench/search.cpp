@@ -0,0 +1,56 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+#include <wx/filename.h>
+
+#include "bench.hpp"
+#include "../testutil.hpp"
+#include "../../src/DocumentCtrl.hpp"
+#include "../../src/search.hpp"
+#include "../../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+/* Search the whole sparse file for a byte sequence which isn't in it. */
+static void BM_Search_ByteSequence_WholeFile(Bench::State &state)
+{
+	AutoFrame frame(NULL, wxID_ANY, "REHex Benchmarks");
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make(wxFileName(Bench::sparse_file())));
+	DocumentCtrl *doc_ctrl = new DocumentCtrl(frame, doc);
+	
+	std::vector<unsigned char> needle(state.arg());
+	for(size_t i = 0; i < needle.size(); ++i)
+	{
+		needle[i] = 0x5A + i;
+	}
+	
+	Search::ByteSequence search(frame, doc, doc_ctrl, needle);
+	
+	while(state.keep_running())
+	{
+		Bench::do_not_optimise(search.find_next(0));
+	}
+	
+	state.set_bytes_processed(state.iterations() * doc->buffer_length());
+}
+
+REHEX_BENCHMARK(BM_Search_ByteSequence_WholeFile)->arg(4)->arg(16)->iterations(1);
@@ -0,0 +1,59 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2026 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../../src/platform.hpp"
+
+#include <vector>
+
+#include "bench.hpp"
+#include "../../src/util.hpp"
+
+using namespace REHex;
+
+static void BM_memcpy_left(Bench::State &state)
+{
+	std::vector<unsigned char> src(state.arg(), 0xA5);
+	std::vector<unsigned char> dst(state.arg());
+	
+	while(state.keep_running())
+	{
+		CarryBits carry = memcpy_left(dst.data(), src.data(), src.size(), 3);
+		Bench::do_not_optimise(carry);
+		Bench::do_not_optimise(dst.data());
+	}
+	
+	state.set_bytes_processed(state.iterations() * src.size());
+}
+
+REHEX_BENCHMARK(BM_memcpy_left)->arg(64)->arg(4096)->arg(1024 * 1024);
+
+static void BM_memcpy_right(Bench::State &state)
+{
+	std::vector<unsigned char> src(state.arg(), 0xA5);
+	std::vector<unsigned char> dst(state.arg());
+	
+	while(state.keep_running())
+	{
+		CarryBits carry = memcpy_right(dst.data(), src.data(), src.size(), 3);
+		Bench::do_not_optimise(carry);
+		Bench::do_not_optimise(dst.data());
+	}
+	
+	state.set_bytes_processed(state.iterations() * src.size());
+}
+
+REHEX_BENCHMARK(BM_memcpy_right)->arg(64)->arg(4096)->arg(1024 * 1024);
@@ -421,3 +421,67 @@ TEST(Util, memcpy_right)
 	EXPECT_EQ(ret.mask, 254);
 	EXPECT_EQ(ret.value, 248);
 }
+
+/* Get bit N (counting from the most significant bit of the first byte) from a buffer. */
+static bool get_bit(const std::vector<unsigned char> &data, size_t bit)
+{
+	return (data[bit / 8] & (0x80 >> (bit % 8))) != 0;
+}
+
+TEST(Util, memcpy_left_long)
+{
+	/* Long enough to go through every block size used by memcpy_left(). */
+	
+	std::vector<unsigned char> src(200);
+	for(size_t i = 0; i < src.size(); ++i)
+	{
+		src[i] = (i * 37) + 11;
+	}
+	
+	for(size_t n = 0; n <= src.size(); ++n)
+	{
+		for(int shift = 1; shift < 8; ++shift)
+		{
+			std::vector<unsigned char> dst(n + 1, 0xAA);
+			memcpy_left(dst.data(), src.data(), n, shift);
+			
+			for(size_t bit = 0; bit < (n * 8); ++bit)
+			{
+				bool expect = (bit + shift) < (n * 8) && get_bit(src, (bit + shift));
+				ASSERT_EQ(get_bit(dst, bit), expect) << "n = " << n << ", shift = " << shift << ", bit = " << bit;
+			}
+			
+			EXPECT_EQ(dst[n], 0xAA) << "memcpy_left() doesn't write past end of buffer";
+		}
+	}
+}
+
+TEST(Util, memcpy_right_long)
+{
+	std::vector<unsigned char> src(200);
+	for(size_t i = 0; i < src.size(); ++i)
+	{
+		src[i] = (i * 37) + 11;
+	}
+	
+	for(size_t n = 1; n <= src.size(); ++n)
+	{
+		for(int shift = 1; shift < 8; ++shift)
+		{
+			std::vector<unsigned char> dst(n + 1, 0xAA);
+			CarryBits ret = memcpy_right(dst.data(), src.data(), n, shift);
+			
+			for(size_t bit = 0; bit < (n * 8); ++bit)
+			{
+				bool expect = bit < (size_t)(shift)
+					? get_bit(std::vector<unsigned char>({ 0xAA }), bit)
+					: get_bit(src, (bit - shift));
+				
+				ASSERT_EQ(get_bit(dst, bit), expect) << "n = " << n << ", shift = " << shift << ", bit = " << bit;
+			}
+			
+			EXPECT_EQ(dst[n], 0xAA) << "memcpy_right() doesn't write past end of buffer";
+			EXPECT_EQ(ret.value, (unsigned char)(src[n - 1] << (8 - shift)));
+		}
+	}
+}
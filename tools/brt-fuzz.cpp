@@ -20,6 +20,7 @@
  * arising from particular sequences of operations.
 */
 
+#include <assert.h>
 #include <list>
 #include <memory>
 #include <poll.h>
@@ -95,7 +96,7 @@ static void run(unsigned int seed)
 		
 		int op = rand_r(&seed) % 100;
 		
-		/* Low chance of major ops (copy/assignment/clear) */
+		/* Low chance of major ops (copy/assignment/clear/bulk construction/move) */
 		
 		if(op == 0)
 		{
@@ -114,6 +115,32 @@ static void run(unsigned int seed)
 		{
 			tree->clear();
 		}
+		else if(op == 3)
+		{
+			/* Test bulk construction from another tree. The result is compared against
+			 * calling set() for each element rather than the source tree since
+			 * data_erased() can produce trees which set() can't (e.g. a node nested
+			 * under another with the same key).
+			*/
+			REHex::ByteRangeTree<int> *new_tree = new REHex::ByteRangeTree<int>(tree->begin(), tree->end());
+			
+			REHex::ByteRangeTree<int> set_tree;
+			for(auto it = tree->begin(); it != tree->end(); ++it)
+			{
+				set_tree.set(it->key.offset, it->key.length, it->value);
+			}
+			
+			assert(*new_tree == set_tree);
+			tree.reset(new_tree);
+		}
+		else if(op == 4)
+		{
+			/* Test move c'tor. */
+			REHex::ByteRangeTree<int> *new_tree = new REHex::ByteRangeTree<int>(std::move(*tree));
+			
+			assert(tree->empty());
+			tree.reset(new_tree);
+		}
 		else{
 			/* Distribute the remaining chance roughly equally between minor ops. */
 			